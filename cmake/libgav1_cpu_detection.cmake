@@ -25,6 +25,7 @@ macro(libgav1_optimization_detect)
       set(libgav1_have_neon ON)
     elseif(cpu_lowercase MATCHES "^x86|amd64")
       set(libgav1_have_avx2 ON)
+      set(libgav1_have_avx512 ON)
       set(libgav1_have_sse4 ON)
     endif()
   endif()
@@ -36,6 +37,14 @@ macro(libgav1_optimization_detect)
     set(libgav1_have_avx2 OFF)
   endif()
 
+  # The avx512 code relies on components shared with the avx2 code.
+  if(libgav1_have_avx512 AND libgav1_have_avx2 AND LIBGAV1_ENABLE_AVX512)
+    list(APPEND libgav1_defines "LIBGAV1_ENABLE_AVX512=1")
+  else()
+    list(APPEND libgav1_defines "LIBGAV1_ENABLE_AVX512=0")
+    set(libgav1_have_avx512 OFF)
+  endif()
+
   if(libgav1_have_neon AND LIBGAV1_ENABLE_NEON)
     list(APPEND libgav1_defines "LIBGAV1_ENABLE_NEON=1")
   else()
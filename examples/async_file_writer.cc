@@ -0,0 +1,174 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/async_file_writer.h"
+
+#include <condition_variable>  // NOLINT (unapproved c++11 header)
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT (unapproved c++11 header)
+#include <new>
+#include <thread>  // NOLINT (unapproved c++11 header)
+#include <utility>
+
+#include "examples/file_writer.h"
+#include "examples/logging.h"
+
+namespace libgav1 {
+
+std::unique_ptr<AsyncFileWriter> AsyncFileWriter::Create(
+    const int max_queued_frames) {
+  if (max_queued_frames <= 0) {
+    LIBGAV1_EXAMPLES_LOG_ERROR("Invalid parameters");
+    return nullptr;
+  }
+  std::unique_ptr<AsyncFileWriter> writer(new (std::nothrow) AsyncFileWriter(
+      static_cast<size_t>(max_queued_frames)));
+  if (writer == nullptr) {
+    LIBGAV1_EXAMPLES_LOG_ERROR("Out of memory");
+  }
+  return writer;
+}
+
+AsyncFileWriter::~AsyncFileWriter() { Finish(); }
+
+StatusCode AsyncFileWriter::GetFrameBuffer(
+    int bitdepth, ImageFormat image_format, int width, int height,
+    int left_border, int right_border, int top_border, int bottom_border,
+    int stride_alignment, FrameBuffer* frame_buffer) {
+  FrameBufferInfo info;
+  StatusCode status = ComputeFrameBufferInfo(
+      bitdepth, image_format, width, height, left_border, right_border,
+      top_border, bottom_border, stride_alignment, &info);
+  if (status != kStatusOk) return status;
+
+  if (info.uv_buffer_size > SIZE_MAX / 2 ||
+      info.y_buffer_size > SIZE_MAX - 2 * info.uv_buffer_size) {
+    return kStatusInvalidArgument;
+  }
+  const size_t min_size = info.y_buffer_size + 2 * info.uv_buffer_size;
+
+  std::lock_guard<std::mutex> lock(buffers_mutex_);
+  Buffer* buffer = nullptr;
+  for (auto& buffer_ptr : buffers_) {
+    if (buffer_ptr->references == 0) {
+      buffer = buffer_ptr.get();
+      break;
+    }
+  }
+  if (buffer == nullptr) {
+    std::unique_ptr<Buffer> new_buffer(new (std::nothrow) Buffer);
+    if (new_buffer == nullptr) return kStatusOutOfMemory;
+    buffers_.push_back(std::move(new_buffer));
+    buffer = buffers_.back().get();
+  }
+
+  if (buffer->size < min_size) {
+    buffer->data.reset(new (std::nothrow) uint8_t[min_size]);
+    if (buffer->data == nullptr) {
+      buffer->size = 0;
+      return kStatusOutOfMemory;
+    }
+    buffer->size = min_size;
+  }
+
+  uint8_t* const y_buffer = buffer->data.get();
+  uint8_t* const u_buffer =
+      (info.uv_buffer_size == 0) ? nullptr : y_buffer + info.y_buffer_size;
+  uint8_t* const v_buffer =
+      (info.uv_buffer_size == 0) ? nullptr : u_buffer + info.uv_buffer_size;
+  status = SetFrameBuffer(&info, y_buffer, u_buffer, v_buffer, buffer,
+                          frame_buffer);
+  if (status != kStatusOk) return status;
+  buffer->references = 1;
+  return kStatusOk;
+}
+
+void AsyncFileWriter::ReleaseFrameBuffer(void* const buffer_private_data) {
+  RemoveReference(static_cast<Buffer*>(buffer_private_data));
+}
+
+bool AsyncFileWriter::Start(std::unique_ptr<FileWriter> file_writer) {
+  if (file_writer == nullptr || writer_thread_.joinable()) {
+    LIBGAV1_EXAMPLES_LOG_ERROR("Invalid parameters");
+    return false;
+  }
+  file_writer_ = std::move(file_writer);
+  writer_thread_ = std::thread(&AsyncFileWriter::WriterThread, this);
+  return true;
+}
+
+bool AsyncFileWriter::WriteFrame(const DecoderBuffer& frame_buffer) {
+  auto* const buffer = static_cast<Buffer*>(frame_buffer.buffer_private_data);
+  if (buffer == nullptr || !writer_thread_.joinable()) {
+    LIBGAV1_EXAMPLES_LOG_ERROR("Invalid parameters");
+    return false;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  condition_.wait(lock, [this] {
+    return queue_.size() < max_queued_frames_ || failed_;
+  });
+  if (failed_) return false;
+  AddReference(buffer);
+  queue_.push_back(frame_buffer);
+  condition_.notify_all();
+  return true;
+}
+
+bool AsyncFileWriter::Finish() {
+  if (writer_thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      finished_ = true;
+    }
+    condition_.notify_all();
+    writer_thread_.join();
+    // Closes the output file.
+    file_writer_ = nullptr;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  return !failed_;
+}
+
+void AsyncFileWriter::WriterThread() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    condition_.wait(lock, [this] { return !queue_.empty() || finished_; });
+    if (queue_.empty()) break;
+    const DecoderBuffer frame_buffer = queue_.front();
+    queue_.pop_front();
+    const bool failed = failed_;
+    lock.unlock();
+    // After a failure the remaining frames are only released.
+    const bool ok = failed || file_writer_->WriteFrame(frame_buffer);
+    RemoveReference(static_cast<Buffer*>(frame_buffer.buffer_private_data));
+    lock.lock();
+    if (!ok) failed_ = true;
+    // Wake up WriteFrame() since there is room in the queue.
+    condition_.notify_all();
+  }
+}
+
+void AsyncFileWriter::AddReference(Buffer* const buffer) {
+  std::lock_guard<std::mutex> lock(buffers_mutex_);
+  ++buffer->references;
+}
+
+void AsyncFileWriter::RemoveReference(Buffer* const buffer) {
+  std::lock_guard<std::mutex> lock(buffers_mutex_);
+  --buffer->references;
+}
+
+}  // namespace libgav1
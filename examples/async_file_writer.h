@@ -0,0 +1,113 @@
+/*
+ * Copyright 2024 The libgav1 Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGAV1_EXAMPLES_ASYNC_FILE_WRITER_H_
+#define LIBGAV1_EXAMPLES_ASYNC_FILE_WRITER_H_
+
+#include <condition_variable>  // NOLINT (unapproved c++11 header)
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>   // NOLINT (unapproved c++11 header)
+#include <thread>  // NOLINT (unapproved c++11 header)
+#include <vector>
+
+#include "examples/file_writer.h"
+#include "gav1/decoder_buffer.h"
+#include "gav1/frame_buffer.h"
+#include "gav1/status_code.h"
+
+namespace libgav1 {
+
+// Writes the decoded frames to a FileWriter from a separate thread, so that
+// the decoding loop does not wait for the output I/O.
+//
+// A DecoderBuffer returned by Decoder::DequeueFrame() is only valid until the
+// next DequeueFrame() call. To keep the frames alive while they wait to be
+// written, the decoder must allocate its frame buffers with the frame buffer
+// callbacks of this class (see GetFrameBuffer() and ReleaseFrameBuffer()).
+// The frame buffers are reference counted: a frame buffer is reused once both
+// the decoder and the writer thread are done with it.
+class AsyncFileWriter {
+ public:
+  // WriteFrame() blocks while |max_queued_frames| frames are waiting to be
+  // written. Returns nullptr on failure.
+  static std::unique_ptr<AsyncFileWriter> Create(int max_queued_frames);
+
+  AsyncFileWriter(const AsyncFileWriter&) = delete;
+  AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+  // Calls Finish(). The frame buffers are freed, so the AsyncFileWriter must
+  // outlive the Decoder that uses its frame buffer callbacks.
+  ~AsyncFileWriter();
+
+  // Implementations of the GetFrameBufferCallback and the
+  // ReleaseFrameBufferCallback. Both may be called from any thread.
+  StatusCode GetFrameBuffer(int bitdepth, ImageFormat image_format, int width,
+                            int height, int left_border, int right_border,
+                            int top_border, int bottom_border,
+                            int stride_alignment, FrameBuffer* frame_buffer);
+  void ReleaseFrameBuffer(void* buffer_private_data);
+
+  // Starts the writer thread, which writes the frames to |file_writer|.
+  // Returns false on failure.
+  bool Start(std::unique_ptr<FileWriter> file_writer);
+
+  // Queues |frame_buffer| to be written by the writer thread. |frame_buffer|
+  // must have been allocated by GetFrameBuffer(). Returns false if a
+  // previous write failed.
+  bool WriteFrame(const DecoderBuffer& frame_buffer);
+
+  // Waits for the queued frames to be written, stops the writer thread and
+  // closes the output file. Returns false if a write failed.
+  bool Finish();
+
+ private:
+  struct Buffer {
+    std::unique_ptr<uint8_t[]> data;
+    size_t size = 0;
+    // The number of users of the buffer: the decoder, and the writer thread
+    // while the frame is queued or being written.
+    int references = 0;
+  };
+
+  explicit AsyncFileWriter(size_t max_queued_frames)
+      : max_queued_frames_(max_queued_frames) {}
+
+  void WriterThread();
+  void AddReference(Buffer* buffer);
+  void RemoveReference(Buffer* buffer);
+
+  const size_t max_queued_frames_;
+  std::unique_ptr<FileWriter> file_writer_;
+  std::thread writer_thread_;
+
+  // Guards |buffers_| and the references of the buffers.
+  std::mutex buffers_mutex_;
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+
+  // Guards the members below.
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::deque<DecoderBuffer> queue_;
+  bool finished_ = false;
+  bool failed_ = false;
+};
+
+}  // namespace libgav1
+
+#endif  // LIBGAV1_EXAMPLES_ASYNC_FILE_WRITER_H_
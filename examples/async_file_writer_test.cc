@@ -0,0 +1,176 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/async_file_writer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "examples/file_reader.h"
+#include "examples/file_reader_interface.h"
+#include "examples/file_writer.h"
+#include "gav1/decoder.h"
+#include "gav1/decoder_buffer.h"
+#include "gav1/decoder_settings.h"
+#include "gav1/frame_buffer.h"
+#include "gav1/status_code.h"
+#include "gtest/gtest.h"
+#include "tests/utils.h"
+
+namespace libgav1 {
+namespace {
+
+Libgav1StatusCode GetFrameBuffer(void* callback_private_data, int bitdepth,
+                                 Libgav1ImageFormat image_format, int width,
+                                 int height, int left_border, int right_border,
+                                 int top_border, int bottom_border,
+                                 int stride_alignment,
+                                 Libgav1FrameBuffer* frame_buffer) {
+  return static_cast<AsyncFileWriter*>(callback_private_data)
+      ->GetFrameBuffer(bitdepth, image_format, width, height, left_border,
+                       right_border, top_border, bottom_border,
+                       stride_alignment, frame_buffer);
+}
+
+void ReleaseFrameBuffer(void* callback_private_data,
+                        void* buffer_private_data) {
+  static_cast<AsyncFileWriter*>(callback_private_data)
+      ->ReleaseFrameBuffer(buffer_private_data);
+}
+
+bool ReadFile(const std::string& file_name, std::vector<uint8_t>* const data) {
+  FILE* const file = fopen(file_name.c_str(), "rb");
+  if (file == nullptr) return false;
+  uint8_t buffer[4096];
+  size_t size;
+  while ((size = fread(buffer, 1, sizeof(buffer), file)) != 0) {
+    data->insert(data->end(), buffer, buffer + size);
+  }
+  const bool ok = ferror(file) == 0;
+  fclose(file);
+  return ok;
+}
+
+class AsyncFileWriterCompareTest : public testing::TestWithParam<int> {
+ protected:
+  // Decodes five-frames.ivf and writes the frames to |file_name|. The frames
+  // are written by an AsyncFileWriter that queues at most |max_queued_frames|
+  // frames, or directly by a FileWriter if |max_queued_frames| is 0.
+  void Decode(const std::string& file_name, const int max_queued_frames) {
+    std::unique_ptr<AsyncFileWriter> async_file_writer;
+    DecoderSettings settings;
+    settings.threads = 4;
+    if (max_queued_frames > 0) {
+      async_file_writer = AsyncFileWriter::Create(max_queued_frames);
+      ASSERT_NE(async_file_writer, nullptr);
+      settings.get_frame_buffer = GetFrameBuffer;
+      settings.release_frame_buffer = ReleaseFrameBuffer;
+      settings.callback_private_data = async_file_writer.get();
+    }
+    Decoder decoder;
+    ASSERT_EQ(decoder.Init(&settings), kStatusOk);
+
+    std::unique_ptr<FileReaderInterface> reader =
+        FileReader::Open(test_utils::GetTestInputFilePath("five-frames.ivf"));
+    ASSERT_NE(reader, nullptr);
+    std::unique_ptr<FileWriter> file_writer;
+    bool started = false;
+    int frames = 0;
+    std::vector<uint8_t> temporal_unit;
+    while (true) {
+      ASSERT_TRUE(reader->ReadTemporalUnit(&temporal_unit, nullptr));
+      if (temporal_unit.empty()) {
+        ASSERT_TRUE(reader->IsEndOfFile());
+        break;
+      }
+      ASSERT_EQ(decoder.EnqueueFrame(temporal_unit.data(),
+                                     temporal_unit.size(), frames,
+                                     /*buffer_private_data=*/nullptr),
+                kStatusOk);
+      const DecoderBuffer* buffer;
+      ASSERT_EQ(decoder.DequeueFrame(&buffer), kStatusOk);
+      ASSERT_NE(buffer, nullptr);
+      ++frames;
+      if (file_writer == nullptr && !started) {
+        FileWriter::Y4mParameters y4m_parameters(
+            buffer->displayed_width[0], buffer->displayed_height[0],
+            reader->frame_rate(), reader->time_scale(),
+            buffer->chroma_sample_position, buffer->image_format,
+            static_cast<size_t>(buffer->bitdepth));
+        file_writer =
+            FileWriter::Open(file_name, FileWriter::kFileTypeY4m,
+                             &y4m_parameters);
+        ASSERT_NE(file_writer, nullptr);
+        if (async_file_writer != nullptr) {
+          ASSERT_TRUE(async_file_writer->Start(std::move(file_writer)));
+          started = true;
+        }
+      }
+      if (async_file_writer != nullptr) {
+        ASSERT_TRUE(async_file_writer->WriteFrame(*buffer));
+      } else {
+        ASSERT_TRUE(file_writer->WriteFrame(*buffer));
+      }
+    }
+    EXPECT_EQ(frames, 5);
+    if (async_file_writer != nullptr) {
+      EXPECT_TRUE(async_file_writer->Finish());
+      // Finish() may be called more than once.
+      EXPECT_TRUE(async_file_writer->Finish());
+    }
+  }
+};
+
+TEST(AsyncFileWriterTest, FailCreate) {
+  EXPECT_EQ(AsyncFileWriter::Create(0), nullptr);
+  EXPECT_EQ(AsyncFileWriter::Create(-1), nullptr);
+}
+
+TEST(AsyncFileWriterTest, FailStart) {
+  std::unique_ptr<AsyncFileWriter> async_file_writer =
+      AsyncFileWriter::Create(1);
+  ASSERT_NE(async_file_writer, nullptr);
+  EXPECT_FALSE(async_file_writer->Start(nullptr));
+  // Frames cannot be queued before Start().
+  DecoderBuffer buffer = {};
+  EXPECT_FALSE(async_file_writer->WriteFrame(buffer));
+  EXPECT_TRUE(async_file_writer->Finish());
+}
+
+TEST_P(AsyncFileWriterCompareTest, WriteFrames) {
+  const std::string expected_file_name =
+      test_utils::GetTestOutputFilePath("async_file_writer_expected.y4m");
+  const std::string actual_file_name =
+      test_utils::GetTestOutputFilePath("async_file_writer_actual.y4m");
+  ASSERT_NO_FATAL_FAILURE(Decode(expected_file_name, 0));
+  ASSERT_NO_FATAL_FAILURE(Decode(actual_file_name, GetParam()));
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> actual;
+  ASSERT_TRUE(ReadFile(expected_file_name, &expected));
+  ASSERT_TRUE(ReadFile(actual_file_name, &actual));
+  EXPECT_FALSE(expected.empty());
+  EXPECT_EQ(actual, expected);
+}
+
+INSTANTIATE_TEST_SUITE_P(AsyncFileWriterCompareTest,
+                         AsyncFileWriterCompareTest,
+                         testing::Values(1, 2, 8));
+
+}  // namespace
+}  // namespace libgav1
@@ -163,8 +163,11 @@ bool FileReader::ReadTemporalUnit(std::vector<uint8_t>* const tu_data,
 // bytes 16-19  frame rate  timebase.den  framerate.numerator
 // bytes 20-23  time scale  timebase.num  framerate.denominator
 bool FileReader::ReadIvfFileHeader() {
+  static_assert(kIvfFileHeaderSize == kFileStartSize,
+                "The IVF file header must be the start of the file.");
   uint8_t header_buffer[kIvfFileHeaderSize];
-  const size_t num_read = fread(header_buffer, 1, kIvfFileHeaderSize, file_);
+  const size_t num_read =
+      FileReaderFactory::ReadFileStart(file_, header_buffer);
   if (num_read != kIvfFileHeaderSize) {
     LIBGAV1_EXAMPLES_LOG_ERROR(
         "Cannot read IVF header: Not enough data available");
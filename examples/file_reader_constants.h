@@ -23,6 +23,9 @@ enum {
   kIvfHeaderVersion = 0,
   kIvfFrameHeaderSize = 12,
   kIvfFileHeaderSize = 32,
+  // The number of bytes the readers read from the beginning of a file to
+  // detect its type. See FileReaderFactory::ReadFileStart().
+  kFileStartSize = 32,
 #ifdef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
   kMaxTemporalUnitSize = 512 * 1024,
 #else
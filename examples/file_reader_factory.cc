@@ -14,8 +14,10 @@
 
 #include "examples/file_reader_factory.h"
 
+#include <cstring>
 #include <new>
 
+#include "examples/file_reader_constants.h"
 #include "examples/logging.h"
 
 namespace libgav1 {
@@ -27,6 +29,12 @@ std::vector<FileReaderFactory::OpenFunction>* GetFileReaderOpenFunctions() {
   return open_functions;
 }
 
+struct StdinStart {
+  bool read = false;
+  size_t size = 0;
+  uint8_t data[kFileStartSize];
+};
+
 }  // namespace
 
 bool FileReaderFactory::RegisterReader(OpenFunction open_function) {
@@ -48,4 +56,15 @@ std::unique_ptr<FileReaderInterface> FileReaderFactory::OpenReader(
   return nullptr;
 }
 
+size_t FileReaderFactory::ReadFileStart(FILE* const file, uint8_t* const data) {
+  if (file != stdin) return fread(data, 1, kFileStartSize, file);
+  static StdinStart stdin_start;
+  if (!stdin_start.read) {
+    stdin_start.size = fread(stdin_start.data, 1, kFileStartSize, stdin);
+    stdin_start.read = true;
+  }
+  memcpy(data, stdin_start.data, stdin_start.size);
+  return stdin_start.size;
+}
+
 }  // namespace libgav1
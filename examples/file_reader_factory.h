@@ -17,6 +17,9 @@
 #ifndef LIBGAV1_EXAMPLES_FILE_READER_FACTORY_H_
 #define LIBGAV1_EXAMPLES_FILE_READER_FACTORY_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
 #include <memory>
 #include <string>
 
@@ -44,6 +47,12 @@ class FileReaderFactory {
   // format and read errors may be ignored and partial data returned.
   static std::unique_ptr<FileReaderInterface> OpenReader(
       const std::string& file_name, bool error_tolerant = false);
+
+  // Reads the first kFileStartSize bytes of |file| into |data| and returns the
+  // number of bytes read. The readers call this to detect the file type. stdin
+  // cannot be rewound, so its first bytes are read once and kept: every reader
+  // that opens "-" gets them, and reads the rest of stdin after them.
+  static size_t ReadFileStart(FILE* file, uint8_t* data);
 };
 
 }  // namespace libgav1
@@ -15,10 +15,13 @@
 #include "examples/file_writer.h"
 
 #include <cerrno>
+#include <cstddef>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <new>
 #include <string>
+#include <vector>
 
 #if defined(_WIN32)
 #include <fcntl.h>
@@ -120,14 +123,15 @@ std::unique_ptr<FileWriter> FileWriter::Open(
   return file;
 }
 
+// The rows of the frame are gathered in |write_buffer_| so that the frame is
+// written with a few large writes rather than one write per row. Planes
+// without padding between the rows are written directly.
 bool FileWriter::WriteFrame(const DecoderBuffer& frame_buffer) {
+  write_buffer_.clear();
   if (file_type_ == kFileTypeY4m) {
     const char kY4mFrameHeader[] = "FRAME\n";
-    if (fwrite(kY4mFrameHeader, 1, strlen(kY4mFrameHeader), file_) !=
-        strlen(kY4mFrameHeader)) {
-      LIBGAV1_EXAMPLES_LOG_ERROR("Error writing Y4M frame header");
-      return false;
-    }
+    write_buffer_.insert(write_buffer_.end(), kY4mFrameHeader,
+                         kY4mFrameHeader + strlen(kY4mFrameHeader));
   }
 
   const size_t pixel_size =
@@ -135,25 +139,52 @@ bool FileWriter::WriteFrame(const DecoderBuffer& frame_buffer) {
   for (int plane_index = 0; plane_index < frame_buffer.NumPlanes();
        ++plane_index) {
     const int height = frame_buffer.displayed_height[plane_index];
-    const int width = frame_buffer.displayed_width[plane_index];
+    const size_t row_size =
+        frame_buffer.displayed_width[plane_index] * pixel_size;
     const int stride = frame_buffer.stride[plane_index];
     const uint8_t* const plane_pointer = frame_buffer.plane[plane_index];
+    if (static_cast<size_t>(stride) == row_size) {
+      if (!FlushWriteBuffer() || !Write(plane_pointer, row_size * height)) {
+        return false;
+      }
+      continue;
+    }
     for (int row = 0; row < height; ++row) {
       const uint8_t* const row_pointer = &plane_pointer[row * stride];
-      if (fwrite(row_pointer, pixel_size, width, file_) !=
-          static_cast<size_t>(width)) {
-        char error_string[256];
-        snprintf(error_string, sizeof(error_string),
-                 "File write failed: %s (errno=%d)", strerror(errno), errno);
-        LIBGAV1_EXAMPLES_LOG_ERROR(error_string);
+      if (write_buffer_.size() + row_size > kWriteBufferSize &&
+          !FlushWriteBuffer()) {
         return false;
       }
+      if (row_size > kWriteBufferSize) {
+        if (!Write(row_pointer, row_size)) return false;
+        continue;
+      }
+      write_buffer_.insert(write_buffer_.end(), row_pointer,
+                           row_pointer + row_size);
     }
   }
 
+  return FlushWriteBuffer();
+}
+
+bool FileWriter::Write(const uint8_t* const data, const size_t size) {
+  if (fwrite(data, 1, size, file_) != size) {
+    char error_string[256];
+    snprintf(error_string, sizeof(error_string),
+             "File write failed: %s (errno=%d)", strerror(errno), errno);
+    LIBGAV1_EXAMPLES_LOG_ERROR(error_string);
+    return false;
+  }
   return true;
 }
 
+bool FileWriter::FlushWriteBuffer() {
+  if (write_buffer_.empty()) return true;
+  const bool ok = Write(write_buffer_.data(), write_buffer_.size());
+  write_buffer_.clear();
+  return ok;
+}
+
 // Writes Y4M file header to |file_| and returns true when successful.
 //
 // A Y4M file begins with a plaintext file signature of 'YUV4MPEG2 '.
@@ -22,6 +22,7 @@
 #include <cstdio>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "gav1/decoder_buffer.h"
 
@@ -91,10 +92,19 @@ class FileWriter {
  private:
   explicit FileWriter(FILE* file) : file_(file) {}
 
+  // The maximum number of bytes gathered in |write_buffer_| before they are
+  // written to |file_|.
+  static constexpr size_t kWriteBufferSize = 1 << 20;
+
   bool WriteY4mFileHeader(const Y4mParameters& y4m_parameters);
+  // Writes |size| bytes of |data| to |file_|. Returns false on error.
+  bool Write(const uint8_t* data, size_t size);
+  // Writes the contents of |write_buffer_| to |file_| and clears it.
+  bool FlushWriteBuffer();
 
   FILE* file_ = nullptr;
   FileType file_type_ = kFileTypeRaw;
+  std::vector<uint8_t> write_buffer_;
 };
 
 }  // namespace libgav1
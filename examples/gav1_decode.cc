@@ -20,15 +20,19 @@
 #include <cstring>
 #include <deque>
 #include <memory>
+#include <mutex>  // NOLINT (unapproved c++11 header)
 #include <new>
+#include <utility>
 #include <vector>
 
 #include "absl/strings/numbers.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
+#include "examples/async_file_writer.h"
 #include "examples/file_reader_factory.h"
 #include "examples/file_reader_interface.h"
 #include "examples/file_writer.h"
+#include "examples/mapped_file_reader.h"
 #include "gav1/decoder.h"
 
 #ifdef GAV1_DECODE_USE_CV_PIXEL_BUFFER_POOL
@@ -41,6 +45,7 @@ struct Options {
   const char* input_file_name = nullptr;
   const char* output_file_name = nullptr;
   const char* frame_timing_file_name = nullptr;
+  const char* frame_stats_file_name = nullptr;
   libgav1::FileWriter::FileType output_file_type =
       libgav1::FileWriter::kFileTypeRaw;
   uint8_t post_filter_mask = 0x1f;
@@ -48,6 +53,8 @@ struct Options {
   bool frame_parallel = false;
   bool output_all_layers = false;
   bool parse_only = false;
+  bool mmap = false;
+  bool async_output = false;
   int operating_point = 0;
   int limit = 0;
   int skip = 0;
@@ -90,6 +97,14 @@ void PrintHelp(FILE* const fout) {
           "  --frame_timing <file> Output per-frame timing to <file> in tsv"
           " format.\n   Yields meaningful results only when frame parallel is"
           " off.\n");
+  fprintf(fout,
+          "  --mmap Memory-map the input file and pass the temporal units to"
+          " the decoder\n   without copying them.\n");
+  fprintf(fout,
+          "  --async_output Write the output file from a separate thread.\n");
+  fprintf(fout,
+          "  --frame_stats <file> Output the per-stage decoding time of each"
+          " frame to\n   <file> in csv format.\n");
   fprintf(fout, "\nAdvanced settings:\n");
   fprintf(fout, "  --post_filter_mask <integer> (Default 0x1f).\n");
   fprintf(fout,
@@ -123,6 +138,13 @@ void ParseOptions(int argc, char* argv[], Options* const options) {
         exit(EXIT_FAILURE);
       }
       options->frame_timing_file_name = argv[i];
+    } else if (strcmp(argv[i], "--frame_stats") == 0) {
+      if (++i >= argc) {
+        fprintf(stderr, "Missing argument for '--frame_stats'\n");
+        PrintHelp(stderr);
+        exit(EXIT_FAILURE);
+      }
+      options->frame_stats_file_name = argv[i];
     } else if (strcmp(argv[i], "--version") == 0) {
       printf("gav1_decode, a libgav1 based AV1 decoder\n");
       printf("libgav1 %s\n", libgav1::GetVersionString());
@@ -144,6 +166,10 @@ void ParseOptions(int argc, char* argv[], Options* const options) {
       options->threads = value;
     } else if (strcmp(argv[i], "--frame_parallel") == 0) {
       options->frame_parallel = true;
+    } else if (strcmp(argv[i], "--mmap") == 0) {
+      options->mmap = true;
+    } else if (strcmp(argv[i], "--async_output") == 0) {
+      options->async_output = true;
     } else if (strcmp(argv[i], "--parse_only") == 0) {
       options->parse_only = true;
     } else if (strcmp(argv[i], "--all_layers") == 0) {
@@ -244,23 +270,111 @@ class InputBuffers {
   std::deque<InputBuffer*> free_buffers_;
 };
 
+// The objects the decoder callbacks operate on.
+struct CallbackContext {
+  InputBuffers* input_buffers = nullptr;
+  // With --mmap the temporal units are enqueued directly from the mapping of
+  // the input file, and |buffer_private_data| is the temporal unit data.
+  libgav1::MappedFileReader* mapped_file_reader = nullptr;
+  // With --async_output the frame buffers are allocated by the writer.
+  libgav1::AsyncFileWriter* async_file_writer = nullptr;
+};
+
 void ReleaseInputBuffer(void* callback_private_data,
                         void* buffer_private_data) {
-  auto* const input_buffers = static_cast<InputBuffers*>(callback_private_data);
-  input_buffers->ReleaseInputBuffer(
+  auto* const context = static_cast<CallbackContext*>(callback_private_data);
+  if (context->mapped_file_reader != nullptr) {
+    context->mapped_file_reader->ReleaseTemporalUnit(
+        static_cast<const uint8_t*>(buffer_private_data));
+    return;
+  }
+  context->input_buffers->ReleaseInputBuffer(
       static_cast<InputBuffer*>(buffer_private_data));
 }
 
+Libgav1StatusCode GetFrameBuffer(void* callback_private_data, int bitdepth,
+                                 Libgav1ImageFormat image_format, int width,
+                                 int height, int left_border, int right_border,
+                                 int top_border, int bottom_border,
+                                 int stride_alignment,
+                                 Libgav1FrameBuffer* frame_buffer) {
+  auto* const context = static_cast<CallbackContext*>(callback_private_data);
+  return context->async_file_writer->GetFrameBuffer(
+      bitdepth, image_format, width, height, left_border, right_border,
+      top_border, bottom_border, stride_alignment, frame_buffer);
+}
+
+void ReleaseFrameBuffer(void* callback_private_data,
+                        void* buffer_private_data) {
+  auto* const context = static_cast<CallbackContext*>(callback_private_data);
+  context->async_file_writer->ReleaseFrameBuffer(buffer_private_data);
+}
+
 int CloseFile(FILE* stream) { return (stream == nullptr) ? 0 : fclose(stream); }
 
+// Writes the FrameStats of the decoded frames as csv. The stats may be
+// reported by several decoder threads at once in frame parallel mode.
+class FrameStatsWriter {
+ public:
+  explicit FrameStatsWriter(FILE* file) : file_(file) {
+    static const char* const kStageNames[libgav1::kNumFrameStages] = {
+        "parse", "reconstruction", "inter prediction", "deblock", "cdef",
+        "super res", "loop restoration", "film grain", "reference wait",
+        "thread stall"};
+    fprintf(file_,
+            "temporal unit,width,height,frame type,show frame,decode us");
+    for (const char* const name : kStageNames) {
+      fprintf(file_, ",%s wall us,%s thread us,%s cpu us", name, name,
+              name);
+    }
+    fprintf(file_, "\n");
+  }
+
+  void Write(const libgav1::FrameStats& stats) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fprintf(file_, "%lld,%d,%d,%d,%d,%lld",
+            static_cast<long long>(stats.user_private_data), stats.width,
+            stats.height, stats.frame_type, stats.show_frame,
+            static_cast<long long>(stats.decode_time_ns / 1000));
+    for (const auto& stage : stats.stages) {
+      // An unknown CPU time (-1) is written as an empty field.
+      fprintf(file_, ",%lld,%lld,",
+              static_cast<long long>(stage.wall_time_ns / 1000),
+              static_cast<long long>(stage.thread_time_ns / 1000));
+      if (stage.cpu_time_ns >= 0) {
+        fprintf(file_, "%lld",
+                static_cast<long long>(stage.cpu_time_ns / 1000));
+      }
+    }
+    fprintf(file_, "\n");
+  }
+
+ private:
+  FILE* const file_;
+  std::mutex mutex_;
+};
+
+void WriteFrameStats(void* frame_stats_private_data,
+                     const libgav1::FrameStats* stats) {
+  static_cast<FrameStatsWriter*>(frame_stats_private_data)->Write(*stats);
+}
+
 }  // namespace
 
 int main(int argc, char* argv[]) {
   Options options;
   ParseOptions(argc, argv, &options);
 
-  auto file_reader =
-      libgav1::FileReaderFactory::OpenReader(options.input_file_name);
+  std::unique_ptr<libgav1::FileReaderInterface> file_reader;
+  libgav1::MappedFileReader* mapped_file_reader = nullptr;
+  if (options.mmap) {
+    file_reader = libgav1::MappedFileReader::Open(options.input_file_name);
+    mapped_file_reader =
+        static_cast<libgav1::MappedFileReader*>(file_reader.get());
+  } else {
+    file_reader =
+        libgav1::FileReaderFactory::OpenReader(options.input_file_name);
+  }
   if (file_reader == nullptr) {
     fprintf(stderr, "Cannot open input file!\n");
     return EXIT_FAILURE;
@@ -277,6 +391,24 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  std::unique_ptr<FILE, decltype(&CloseFile)> frame_stats_file(nullptr,
+                                                               &CloseFile);
+  std::unique_ptr<FrameStatsWriter> frame_stats_writer;
+  if (options.frame_stats_file_name != nullptr) {
+    frame_stats_file.reset(fopen(options.frame_stats_file_name, "wb"));
+    if (frame_stats_file == nullptr) {
+      fprintf(stderr, "Cannot open frame stats file '%s'!\n",
+              options.frame_stats_file_name);
+      return EXIT_FAILURE;
+    }
+    frame_stats_writer.reset(new (std::nothrow)
+                                 FrameStatsWriter(frame_stats_file.get()));
+    if (frame_stats_writer == nullptr) {
+      fprintf(stderr, "Failed to create the frame stats writer.\n");
+      return EXIT_FAILURE;
+    }
+  }
+
 #ifdef GAV1_DECODE_USE_CV_PIXEL_BUFFER_POOL
   // Reference frames + 1 scratch frame (for either the current frame or the
   // film grain frame).
@@ -290,6 +422,22 @@ int main(int argc, char* argv[]) {
 #endif
 
   InputBuffers input_buffers;
+  // Declared before |decoder| since it owns the frame buffers.
+  std::unique_ptr<libgav1::AsyncFileWriter> async_file_writer;
+  if (options.async_output && options.output_file_name != nullptr) {
+    // Bound the number of frames waiting to be written, to bound the memory
+    // use when the output is slower than the decoder.
+    constexpr int kMaxQueuedFrames = 8;
+    async_file_writer = libgav1::AsyncFileWriter::Create(kMaxQueuedFrames);
+    if (async_file_writer == nullptr) {
+      fprintf(stderr, "Failed to create the asynchronous writer.\n");
+      return EXIT_FAILURE;
+    }
+  }
+  CallbackContext callback_context;
+  callback_context.input_buffers = &input_buffers;
+  callback_context.mapped_file_reader = mapped_file_reader;
+  callback_context.async_file_writer = async_file_writer.get();
   libgav1::Decoder decoder;
   libgav1::DecoderSettings settings;
   settings.post_filter_mask = options.post_filter_mask;
@@ -299,8 +447,16 @@ int main(int argc, char* argv[]) {
   settings.output_all_layers = options.output_all_layers;
   settings.operating_point = options.operating_point;
   settings.blocking_dequeue = true;
-  settings.callback_private_data = &input_buffers;
+  settings.callback_private_data = &callback_context;
   settings.release_input_buffer = ReleaseInputBuffer;
+  if (async_file_writer != nullptr) {
+    settings.get_frame_buffer = GetFrameBuffer;
+    settings.release_frame_buffer = ReleaseFrameBuffer;
+  }
+  if (frame_stats_writer != nullptr) {
+    settings.frame_stats_callback = WriteFrameStats;
+    settings.frame_stats_private_data = frame_stats_writer.get();
+  }
 #ifdef GAV1_DECODE_USE_CV_PIXEL_BUFFER_POOL
   settings.on_frame_buffer_size_changed = Gav1DecodeOnCVPixelBufferSizeChanged;
   settings.get_frame_buffer = Gav1DecodeGetCVPixelBuffer;
@@ -310,6 +466,10 @@ int main(int argc, char* argv[]) {
   // TODO(vigneshv): Support frame parallel mode to be used with
   // CVPixelBufferPool.
   settings.frame_parallel = false;
+  // The frames are written synchronously since the CVPixelBuffers are not
+  // reference counted by the writer.
+  callback_context.async_file_writer = nullptr;
+  async_file_writer.reset();
 #endif
   libgav1::StatusCode status = decoder.Init(&settings);
   if (status != libgav1::kStatusOk) {
@@ -324,57 +484,95 @@ int main(int argc, char* argv[]) {
   }
 
   int input_frames = 0;
+  int64_t enqueued_frames = 0;
   int decoded_frames = 0;
   int parsed_frames = 0;
   Timing timing = {};
   std::vector<FrameTiming> frame_timing;
   const bool record_frame_timing = frame_timing_file != nullptr;
   std::unique_ptr<libgav1::FileWriter> file_writer;
+  // Set when |file_writer| has been handed over to |async_file_writer|.
+  bool output_started = false;
+  // The temporal unit read from the input file that has not been enqueued
+  // yet. |tu_data| points into |input_buffer|, or into the mapping of the
+  // input file with --mmap.
+  bool have_temporal_unit = false;
   InputBuffer* input_buffer = nullptr;
+  const uint8_t* tu_data = nullptr;
+  size_t tu_size = 0;
+  const auto release_temporal_unit = [&]() {
+    if (!have_temporal_unit) return;
+    if (mapped_file_reader != nullptr) {
+      mapped_file_reader->ReleaseTemporalUnit(tu_data);
+    } else {
+      input_buffers.ReleaseInputBuffer(input_buffer);
+    }
+    have_temporal_unit = false;
+    input_buffer = nullptr;
+    tu_data = nullptr;
+    tu_size = 0;
+  };
   bool limit_reached = false;
   bool dequeue_finished = false;
   const absl::Time decode_loop_start = absl::Now();
   do {
-    if (input_buffer == nullptr && !file_reader->IsEndOfFile() &&
+    if (!have_temporal_unit && !file_reader->IsEndOfFile() &&
         !limit_reached) {
-      input_buffer = input_buffers.GetFreeBuffer();
-      if (input_buffer == nullptr) return EXIT_FAILURE;
       const absl::Time read_start = absl::Now();
-      if (!file_reader->ReadTemporalUnit(input_buffer,
-                                         /*timestamp=*/nullptr)) {
-        fprintf(stderr, "Error reading input file.\n");
-        return EXIT_FAILURE;
+      if (mapped_file_reader != nullptr) {
+        if (!mapped_file_reader->ReadTemporalUnit(&tu_data, &tu_size,
+                                                  /*timestamp=*/nullptr)) {
+          fprintf(stderr, "Error reading input file.\n");
+          return EXIT_FAILURE;
+        }
+      } else {
+        input_buffer = input_buffers.GetFreeBuffer();
+        if (input_buffer == nullptr) return EXIT_FAILURE;
+        if (!file_reader->ReadTemporalUnit(input_buffer,
+                                           /*timestamp=*/nullptr)) {
+          fprintf(stderr, "Error reading input file.\n");
+          return EXIT_FAILURE;
+        }
+        tu_data = input_buffer->data();
+        tu_size = input_buffer->size();
       }
+      have_temporal_unit = true;
       timing.input += absl::Now() - read_start;
     }
 
     if (++input_frames <= options.skip) {
-      input_buffers.ReleaseInputBuffer(input_buffer);
-      input_buffer = nullptr;
+      release_temporal_unit();
       continue;
     }
 
-    if (input_buffer != nullptr) {
-      if (input_buffer->empty()) {
-        input_buffers.ReleaseInputBuffer(input_buffer);
-        input_buffer = nullptr;
+    if (have_temporal_unit) {
+      if (tu_size == 0) {
+        release_temporal_unit();
         continue;
       }
 
       const absl::Time enqueue_start = absl::Now();
-      status = decoder.EnqueueFrame(input_buffer->data(), input_buffer->size(),
-                                    static_cast<int64_t>(frame_timing.size()),
-                                    /*buffer_private_data=*/input_buffer);
+      void* const buffer_private_data =
+          (mapped_file_reader != nullptr)
+              ? static_cast<void*>(const_cast<uint8_t*>(tu_data))
+              : static_cast<void*>(input_buffer);
+      status = decoder.EnqueueFrame(tu_data, tu_size, enqueued_frames,
+                                    buffer_private_data);
       if (status == libgav1::kStatusOk) {
+        ++enqueued_frames;
         if (options.verbose > 1) {
-          fprintf(stderr, "enqueue frame (length %zu)\n", input_buffer->size());
+          fprintf(stderr, "enqueue frame (length %zu)\n", tu_size);
         }
         if (record_frame_timing) {
           FrameTiming enqueue_time = {enqueue_start, absl::UnixEpoch()};
           frame_timing.emplace_back(enqueue_time);
         }
 
+        // The decoder releases the temporal unit.
+        have_temporal_unit = false;
         input_buffer = nullptr;
+        tu_data = nullptr;
+        tu_size = 0;
         // Continue to enqueue frames until we get a kStatusTryAgain status.
         continue;
       }
@@ -428,7 +626,8 @@ int main(int argc, char* argv[]) {
           absl::Now();
     }
 
-    if (options.output_file_name != nullptr && file_writer == nullptr) {
+    if (options.output_file_name != nullptr && file_writer == nullptr &&
+        !output_started) {
       libgav1::FileWriter::Y4mParameters y4m_parameters;
       y4m_parameters.width = buffer->displayed_width[0];
       y4m_parameters.height = buffer->displayed_height[0];
@@ -443,26 +642,39 @@ int main(int argc, char* argv[]) {
         fprintf(stderr, "Cannot open output file!\n");
         return EXIT_FAILURE;
       }
+      if (async_file_writer != nullptr) {
+        if (!async_file_writer->Start(std::move(file_writer))) {
+          fprintf(stderr, "Cannot start the asynchronous writer.\n");
+          return EXIT_FAILURE;
+        }
+        output_started = true;
+      }
     }
 
-    if (!limit_reached && file_writer != nullptr &&
-        !file_writer->WriteFrame(*buffer)) {
-      fprintf(stderr, "Error writing output file.\n");
-      return EXIT_FAILURE;
+    if (!limit_reached) {
+      const bool write_ok =
+          (async_file_writer != nullptr)
+              ? !output_started || async_file_writer->WriteFrame(*buffer)
+              : file_writer == nullptr || file_writer->WriteFrame(*buffer);
+      if (!write_ok) {
+        fprintf(stderr, "Error writing output file.\n");
+        return EXIT_FAILURE;
+      }
     }
     if (options.limit > 0 && options.limit == decoded_frames) {
       limit_reached = true;
-      if (input_buffer != nullptr) {
-        input_buffers.ReleaseInputBuffer(input_buffer);
-      }
-      input_buffer = nullptr;
+      release_temporal_unit();
       // Clear any in progress frames to ensure the output frame limit is
       // respected.
       decoder.SignalEOS();
     }
-  } while (input_buffer != nullptr ||
+  } while (have_temporal_unit ||
            (!file_reader->IsEndOfFile() && !limit_reached) ||
            !dequeue_finished);
+  if (async_file_writer != nullptr && !async_file_writer->Finish()) {
+    fprintf(stderr, "Error writing output file.\n");
+    return EXIT_FAILURE;
+  }
   timing.dequeue = absl::Now() - decode_loop_start - timing.input;
 
   if (record_frame_timing) {
@@ -0,0 +1,505 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the end-to-end decoding performance of libgav1 over a matrix of
+// streams and decoder settings. The streams are synthesized by
+// StreamGenerator, so no test vectors are needed, and may be complemented by
+// AV1 files given on the command line. Each stream is loaded into memory
+// before it is decoded, so that file I/O is not measured.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>  // NOLINT (unapproved c++11 header)
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#elif !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "examples/file_reader_factory.h"
+#include "examples/file_reader_interface.h"
+#include "examples/stream_generator.h"
+#include "gav1/decoder.h"
+#include "gav1/frame_stats.h"
+
+namespace {
+
+struct Stream {
+  std::string name;
+  std::vector<std::vector<uint8_t>> temporal_units;
+};
+
+struct Preset {
+  const char* name;
+  const char* description;
+  void (*configure)(libgav1::StreamGenerator::Config* config);
+};
+
+const Preset kPresets[] = {
+    {"base", "1280x720 8-bit, single tile",
+     [](libgav1::StreamGenerator::Config* /*config*/) {}},
+    {"tiles", "1920x1080 8-bit, 2x2 tiles",
+     [](libgav1::StreamGenerator::Config* config) {
+       config->width = 1920;
+       config->height = 1080;
+       config->tile_columns_log2 = 1;
+       config->tile_rows_log2 = 1;
+     }},
+    {"1080p", "1920x1080 8-bit, single tile",
+     [](libgav1::StreamGenerator::Config* config) {
+       config->width = 1920;
+       config->height = 1080;
+     }},
+    {"2160p", "3840x2160 8-bit, single tile",
+     [](libgav1::StreamGenerator::Config* config) {
+       config->width = 3840;
+       config->height = 2160;
+     }},
+    {"10bit", "1280x720 10-bit",
+     [](libgav1::StreamGenerator::Config* config) { config->bitdepth = 10; }},
+    {"12bit", "1280x720 12-bit (profile 2)",
+     [](libgav1::StreamGenerator::Config* config) { config->bitdepth = 12; }},
+    {"film_grain", "1280x720 8-bit with film grain synthesis",
+     [](libgav1::StreamGenerator::Config* config) {
+       config->film_grain = true;
+     }},
+    {"superres", "1280x720 8-bit, coded at 2/3 width with superres",
+     [](libgav1::StreamGenerator::Config* config) {
+       config->superres_denominator = 12;
+     }},
+    {"sb128", "1280x720 8-bit with 128x128 superblocks",
+     [](libgav1::StreamGenerator::Config* config) {
+       config->use_128x128_superblock = true;
+     }},
+    {"screen", "1280x720 8-bit screen content (palette, intrabc key frames)",
+     [](libgav1::StreamGenerator::Config* config) {
+       config->screen_content = true;
+       config->key_frame_interval = 10;
+     }},
+};
+
+// The number of times each frame is generated again when it does not decode.
+// Only the intra block copy frames of the "screen" preset need a few retries.
+constexpr int kMaxGeneratorRetries = 100;
+
+struct Options {
+  std::vector<const char*> input_file_names;
+  std::vector<const char*> presets;
+  std::vector<int> threads = {1};
+  std::vector<bool> frame_parallel = {false};
+  const char* write_corpus_directory = nullptr;
+  int frames = 30;
+  int runs = 3;
+  uint32_t seed = 1;
+  bool parse_stats = false;
+};
+
+void PrintHelp(FILE* const fout) {
+  fprintf(fout, "Usage: libgav1_benchmark [options] [input files]\n");
+  fprintf(fout, "\n");
+  fprintf(fout,
+          "Decodes each stream with each combination of settings and reports"
+          " the frame\nrate, the latency percentiles, the parse time and the"
+          " peak resident set size.\nThe parse time is the percentage of the"
+          " decode time of the frames spent\nparsing the tiles. It is only"
+          " reported with --parse_stats, and only measured\nwhen the tiles"
+          " are parsed by threads of their own (with several threads or\n"
+          "frame parallel mode). For single tile streams it is the utilization"
+          " of the\nparsing thread, which bounds the speedup from more"
+          " threads. For example:\n"
+          "  libgav1_benchmark --presets 1080p,2160p --threads 4,8,16"
+          " --parse_stats\n"
+          "The peak resident set size is per decode on Linux and since the"
+          " start of the\nprocess elsewhere.\n");
+  fprintf(fout, "\n");
+  fprintf(fout, "Options:\n");
+  fprintf(fout, "  -h, --help This help message.\n");
+  fprintf(fout,
+          "  --presets <list> Comma separated list of the synthesized streams"
+          " to\n   decode (Default all of them, or none if input files are"
+          " given).\n   'none' disables them.\n");
+  fprintf(fout,
+          "  --threads <list> Comma separated list of thread counts"
+          " (Default 1).\n");
+  fprintf(fout,
+          "  --frame_parallel <list> Comma separated list of 0 and 1"
+          " (Default 0).\n");
+  fprintf(fout,
+          "  --frames <positive integer> Frames per synthesized stream"
+          " (Default 30).\n");
+  fprintf(fout,
+          "  --runs <positive integer> Decodes of each combination"
+          " (Default 3).\n");
+  fprintf(fout,
+          "  --seed <integer> Seed of the synthesized streams (Default 1).\n");
+  fprintf(fout,
+          "  --write_corpus <directory> Write the synthesized streams to"
+          " <directory>\n   as IVF files.\n");
+  fprintf(fout,
+          "  --parse_stats Measure the parse time in an extra decode of each"
+          "\n   combination with the frame statistics enabled. The timed"
+          " decodes never\n   collect frame statistics.\n");
+  fprintf(fout, "\nPresets:\n");
+  for (const Preset& preset : kPresets) {
+    fprintf(fout, "  %-10s %s\n", preset.name, preset.description);
+  }
+}
+
+[[noreturn]] void ExitWithHelp(const char* message) {
+  fprintf(stderr, "%s\n", message);
+  PrintHelp(stderr);
+  exit(EXIT_FAILURE);
+}
+
+bool ParseIntList(const char* value, int min, int max,
+                  std::vector<int>* const list) {
+  list->clear();
+  for (absl::string_view item : absl::StrSplit(value, ',')) {
+    int32_t number;
+    if (!absl::SimpleAtoi(item, &number) || number < min || number > max) {
+      return false;
+    }
+    list->push_back(number);
+  }
+  return !list->empty();
+}
+
+const Preset* FindPreset(absl::string_view name) {
+  for (const Preset& preset : kPresets) {
+    if (name == preset.name) return &preset;
+  }
+  return nullptr;
+}
+
+void ParseOptions(int argc, char* argv[], Options* const options) {
+  bool presets_set = false;
+  for (int i = 1; i < argc; ++i) {
+    std::vector<int> list;
+    if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+      PrintHelp(stdout);
+      exit(EXIT_SUCCESS);
+    } else if (strcmp(argv[i], "--presets") == 0) {
+      if (++i >= argc) ExitWithHelp("Missing argument for '--presets'");
+      presets_set = true;
+      options->presets.clear();
+      if (strcmp(argv[i], "none") == 0) continue;
+      for (absl::string_view name : absl::StrSplit(argv[i], ',')) {
+        const Preset* const preset = FindPreset(name);
+        if (preset == nullptr) ExitWithHelp("Unknown preset.");
+        options->presets.push_back(preset->name);
+      }
+    } else if (strcmp(argv[i], "--threads") == 0) {
+      if (++i >= argc || !ParseIntList(argv[i], 1, 1024, &options->threads)) {
+        ExitWithHelp("Missing/Invalid value for --threads.");
+      }
+    } else if (strcmp(argv[i], "--frame_parallel") == 0) {
+      if (++i >= argc || !ParseIntList(argv[i], 0, 1, &list)) {
+        ExitWithHelp("Missing/Invalid value for --frame_parallel.");
+      }
+      options->frame_parallel.assign(list.begin(), list.end());
+    } else if (strcmp(argv[i], "--frames") == 0) {
+      if (++i >= argc || !ParseIntList(argv[i], 1, 100000, &list) ||
+          list.size() != 1) {
+        ExitWithHelp("Missing/Invalid value for --frames.");
+      }
+      options->frames = list[0];
+    } else if (strcmp(argv[i], "--runs") == 0) {
+      if (++i >= argc || !ParseIntList(argv[i], 1, 1000, &list) ||
+          list.size() != 1) {
+        ExitWithHelp("Missing/Invalid value for --runs.");
+      }
+      options->runs = list[0];
+    } else if (strcmp(argv[i], "--seed") == 0) {
+      if (++i >= argc || !absl::SimpleAtoi(argv[i], &options->seed)) {
+        ExitWithHelp("Missing/Invalid value for --seed.");
+      }
+    } else if (strcmp(argv[i], "--write_corpus") == 0) {
+      if (++i >= argc) ExitWithHelp("Missing argument for '--write_corpus'");
+      options->write_corpus_directory = argv[i];
+    } else if (strcmp(argv[i], "--parse_stats") == 0) {
+      options->parse_stats = true;
+    } else if (strlen(argv[i]) > 1 && argv[i][0] == '-') {
+      fprintf(stderr, "Unknown option '%s'!\n", argv[i]);
+      exit(EXIT_FAILURE);
+    } else {
+      options->input_file_names.push_back(argv[i]);
+    }
+  }
+  if (!presets_set && options->input_file_names.empty()) {
+    for (const Preset& preset : kPresets) {
+      options->presets.push_back(preset.name);
+    }
+  }
+  if (options->presets.empty() && options->input_file_names.empty()) {
+    ExitWithHelp("Nothing to decode.");
+  }
+}
+
+bool LoadFile(const char* file_name, Stream* const stream) {
+  auto file_reader = libgav1::FileReaderFactory::OpenReader(file_name);
+  if (file_reader == nullptr) {
+    fprintf(stderr, "Cannot open input file '%s'!\n", file_name);
+    return false;
+  }
+  stream->name = file_name;
+  while (!file_reader->IsEndOfFile()) {
+    std::vector<uint8_t> temporal_unit;
+    if (!file_reader->ReadTemporalUnit(&temporal_unit,
+                                       /*timestamp=*/nullptr)) {
+      fprintf(stderr, "Error reading input file '%s'.\n", file_name);
+      return false;
+    }
+    if (temporal_unit.empty()) continue;
+    stream->temporal_units.push_back(std::move(temporal_unit));
+  }
+  return true;
+}
+
+// Resets the peak resident set size of the process. Returns false if the
+// platform does not allow it, in which case GetPeakRssKilobytes() returns the
+// peak since the process started.
+bool ResetPeakRss() {
+#if defined(__linux__)
+  // Writing "5" to clear_refs resets VmHWM to the current RSS (Linux 4.0+).
+  const int fd = open("/proc/self/clear_refs", O_WRONLY);
+  if (fd < 0) return false;
+  const bool ok = write(fd, "5", 1) == 1;
+  close(fd);
+  return ok;
+#else
+  return false;
+#endif
+}
+
+// Returns the peak resident set size in kilobytes, or -1 if it is unknown.
+int64_t GetPeakRssKilobytes() {
+#if defined(__linux__)
+  FILE* const status = fopen("/proc/self/status", "r");
+  if (status == nullptr) return -1;
+  char line[256];
+  long long peak = -1;  // NOLINT(runtime/int)
+  while (fgets(line, sizeof(line), status) != nullptr) {
+    if (sscanf(line, "VmHWM: %lld kB", &peak) == 1) break;
+  }
+  fclose(status);
+  return peak;
+#elif !defined(_WIN32)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#if defined(__APPLE__)
+  return usage.ru_maxrss / 1024;  // Bytes on macOS.
+#else
+  return usage.ru_maxrss;
+#endif
+#else
+  return -1;
+#endif
+}
+
+void ReleaseInputBuffer(void* /*callback_private_data*/,
+                        void* /*buffer_private_data*/) {
+  // The streams stay in memory until the end of the benchmark.
+}
+
+struct Result {
+  int frames = 0;
+  absl::Duration decode_time;
+  // The sums of the frame statistics of the decoded frames.
+  std::mutex frame_stats_mutex;
+  int64_t frame_decode_time_ns = 0;
+  int64_t frame_parse_time_ns = 0;
+  std::vector<double> latencies_ms;
+  int64_t peak_rss_kilobytes = -1;
+};
+
+// May be called from several decoder threads in frame parallel mode.
+void AccumulateFrameStats(void* frame_stats_private_data,
+                          const libgav1::FrameStats* stats) {
+  auto* const result = static_cast<Result*>(frame_stats_private_data);
+  std::lock_guard<std::mutex> lock(result->frame_stats_mutex);
+  result->frame_decode_time_ns += stats->decode_time_ns;
+  result->frame_parse_time_ns +=
+      stats->stages[libgav1::kFrameStageParse].thread_time_ns;
+}
+
+// Decodes |stream| once. The latency of a frame is the time from the
+// enqueuing of its temporal unit to the dequeuing of the frame. If
+// |frame_stats| is true, the statistics of the frames are added to |result|.
+// This slows down the decoder, so the timed decodes do not enable it.
+bool Decode(const Stream& stream, int threads, bool frame_parallel,
+            bool frame_stats, Result* const result) {
+  ResetPeakRss();
+  libgav1::Decoder decoder;
+  libgav1::DecoderSettings settings;
+  settings.threads = threads;
+  settings.frame_parallel = frame_parallel;
+  settings.blocking_dequeue = true;
+  settings.release_input_buffer = ReleaseInputBuffer;
+  if (frame_stats) {
+    settings.frame_stats_callback = AccumulateFrameStats;
+    settings.frame_stats_private_data = result;
+  }
+  libgav1::StatusCode status = decoder.Init(&settings);
+  if (status != libgav1::kStatusOk) {
+    fprintf(stderr, "Error initializing decoder: %s\n",
+            libgav1::GetErrorString(status));
+    return false;
+  }
+  const size_t num_temporal_units = stream.temporal_units.size();
+  std::vector<absl::Time> enqueue_time(num_temporal_units);
+  size_t next = 0;
+  const absl::Time start = absl::Now();
+  while (true) {
+    if (next < num_temporal_units) {
+      const std::vector<uint8_t>& temporal_unit = stream.temporal_units[next];
+      enqueue_time[next] = absl::Now();
+      status = decoder.EnqueueFrame(temporal_unit.data(), temporal_unit.size(),
+                                    next, /*buffer_private_data=*/nullptr);
+      if (status == libgav1::kStatusOk) {
+        ++next;
+        continue;
+      }
+      if (status != libgav1::kStatusTryAgain) {
+        fprintf(stderr, "Unable to enqueue frame: %s\n",
+                libgav1::GetErrorString(status));
+        return false;
+      }
+    }
+    const libgav1::DecoderBuffer* buffer;
+    status = decoder.DequeueFrame(&buffer);
+    if (status == libgav1::kStatusNothingToDequeue) {
+      if (next == num_temporal_units) break;
+      continue;
+    }
+    if (status != libgav1::kStatusOk) {
+      fprintf(stderr, "Unable to dequeue frame: %s\n",
+              libgav1::GetErrorString(status));
+      return false;
+    }
+    if (buffer == nullptr) continue;
+    ++result->frames;
+    result->latencies_ms.push_back(absl::ToDoubleMilliseconds(
+        absl::Now() - enqueue_time[buffer->user_private_data]));
+  }
+  result->decode_time += absl::Now() - start;
+  result->peak_rss_kilobytes =
+      std::max(result->peak_rss_kilobytes, GetPeakRssKilobytes());
+  return true;
+}
+
+double Percentile(const std::vector<double>& sorted_values, int percentile) {
+  if (sorted_values.empty()) return 0;
+  const size_t index = std::min(
+      sorted_values.size() - 1,
+      static_cast<size_t>(sorted_values.size() * percentile / 100));
+  return sorted_values[index];
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  ParseOptions(argc, argv, &options);
+
+  std::vector<Stream> streams;
+  for (const char* const name : options.presets) {
+    libgav1::StreamGenerator::Config config;
+    config.num_frames = options.frames;
+    config.seed = options.seed;
+    FindPreset(name)->configure(&config);
+    Stream stream;
+    stream.name = name;
+    fprintf(stderr, "generating '%s'\n", name);
+    if (!libgav1::GenerateStream(config, kMaxGeneratorRetries,
+                                 &stream.temporal_units)) {
+      fprintf(stderr, "Unable to generate the '%s' stream.\n", name);
+      return EXIT_FAILURE;
+    }
+    if (options.write_corpus_directory != nullptr) {
+      const std::string file_name =
+          std::string(options.write_corpus_directory) + "/" + name + ".ivf";
+      if (!libgav1::WriteIvfFile(file_name, config.width, config.height,
+                                 stream.temporal_units)) {
+        return EXIT_FAILURE;
+      }
+    }
+    streams.push_back(std::move(stream));
+  }
+  for (const char* const file_name : options.input_file_names) {
+    Stream stream;
+    if (!LoadFile(file_name, &stream)) return EXIT_FAILURE;
+    streams.push_back(std::move(stream));
+  }
+
+  printf("%-24s %7s %3s %6s %9s %9s %9s %9s %7s %10s\n", "stream",
+         "threads", "fp", "frames", "fps", "p50 ms", "p90 ms", "p99 ms",
+         "parse %", "peak MiB");
+  for (const Stream& stream : streams) {
+    for (const int threads : options.threads) {
+      for (const bool frame_parallel : options.frame_parallel) {
+        Result result;
+        for (int run = 0; run < options.runs; ++run) {
+          if (!Decode(stream, threads, frame_parallel, /*frame_stats=*/false,
+                      &result)) {
+            fprintf(stderr, "Failed to decode '%s'.\n", stream.name.c_str());
+            return EXIT_FAILURE;
+          }
+        }
+        Result stats_result;
+        if (options.parse_stats &&
+            !Decode(stream, threads, frame_parallel, /*frame_stats=*/true,
+                    &stats_result)) {
+          fprintf(stderr, "Failed to decode '%s'.\n", stream.name.c_str());
+          return EXIT_FAILURE;
+        }
+        std::sort(result.latencies_ms.begin(), result.latencies_ms.end());
+        const double seconds = absl::ToDoubleSeconds(result.decode_time);
+        const double fps = (seconds > 0) ? result.frames / seconds : 0;
+        char parse[16] = "-";
+        if (stats_result.frame_parse_time_ns > 0 &&
+            stats_result.frame_decode_time_ns > 0) {
+          snprintf(parse, sizeof(parse), "%.1f",
+                   100.0 * stats_result.frame_parse_time_ns /
+                       stats_result.frame_decode_time_ns);
+        }
+        char peak_rss[16] = "-";
+        if (result.peak_rss_kilobytes >= 0) {
+          snprintf(peak_rss, sizeof(peak_rss), "%.1f",
+                   result.peak_rss_kilobytes / 1024.0);
+        }
+        printf("%-24s %7d %3d %6d %9.2f %9.2f %9.2f %9.2f %7s %10s\n",
+               stream.name.c_str(), threads, frame_parallel ? 1 : 0,
+               result.frames / options.runs, fps,
+               Percentile(result.latencies_ms, 50),
+               Percentile(result.latencies_ms, 90),
+               Percentile(result.latencies_ms, 99), parse, peak_rss);
+        fflush(stdout);
+      }
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -33,14 +33,27 @@ set(libgav1_file_reader_sources "${libgav1_examples}/file_reader.cc"
                                 "${libgav1_examples}/file_reader_interface.h"
                                 "${libgav1_examples}/ivf_parser.cc"
                                 "${libgav1_examples}/ivf_parser.h"
-                                "${libgav1_examples}/logging.h")
+                                "${libgav1_examples}/logging.h"
+                                "${libgav1_examples}/mapped_file_reader.cc"
+                                "${libgav1_examples}/mapped_file_reader.h"
+                                "${libgav1_examples}/obu_file_reader.cc"
+                                "${libgav1_examples}/obu_file_reader.h")
 
-set(libgav1_file_writer_sources "${libgav1_examples}/file_writer.cc"
+set(libgav1_file_writer_sources "${libgav1_examples}/async_file_writer.cc"
+                                "${libgav1_examples}/async_file_writer.h"
+                                "${libgav1_examples}/file_writer.cc"
                                 "${libgav1_examples}/file_writer.h"
                                 "${libgav1_examples}/logging.h")
 
+set(libgav1_stream_generator_sources
+    "${libgav1_examples}/logging.h"
+    "${libgav1_examples}/stream_generator.cc"
+    "${libgav1_examples}/stream_generator.h")
+
 set(libgav1_decode_sources "${libgav1_examples}/gav1_decode.cc")
 
+set(libgav1_benchmark_sources "${libgav1_examples}/libgav1_benchmark.cc")
+
 macro(libgav1_add_examples_targets)
   libgav1_add_library(NAME libgav1_file_reader TYPE OBJECT SOURCES
                       ${libgav1_file_reader_sources} DEFINES ${libgav1_defines}
@@ -50,6 +63,10 @@ macro(libgav1_add_examples_targets)
                       ${libgav1_file_writer_sources} DEFINES ${libgav1_defines}
                       INCLUDES ${libgav1_include_paths})
 
+  libgav1_add_library(NAME libgav1_stream_generator TYPE OBJECT SOURCES
+                      ${libgav1_stream_generator_sources} DEFINES
+                      ${libgav1_defines} INCLUDES ${libgav1_include_paths})
+
   libgav1_add_executable(NAME
                          gav1_decode
                          SOURCES
@@ -67,4 +84,20 @@ macro(libgav1_add_examples_targets)
                          absl::str_format_internal
                          absl::time
                          ${libgav1_dependency})
+
+  libgav1_add_executable(NAME
+                         libgav1_benchmark
+                         SOURCES
+                         ${libgav1_benchmark_sources}
+                         DEFINES
+                         ${libgav1_defines}
+                         INCLUDES
+                         ${libgav1_include_paths}
+                         OBJLIB_DEPS
+                         libgav1_file_reader
+                         libgav1_stream_generator
+                         LIB_DEPS
+                         absl::strings
+                         absl::time
+                         ${libgav1_dependency})
 endmacro()
@@ -0,0 +1,274 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/mapped_file_reader.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT (unapproved c++11 header)
+#include <new>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "examples/file_reader_constants.h"
+#include "examples/file_reader_interface.h"
+#include "examples/ivf_parser.h"
+#include "examples/logging.h"
+
+namespace libgav1 {
+namespace {
+
+// Returns the page size, or a conservative default if it is unknown.
+size_t GetPageSize() {
+#if !defined(_WIN32)
+  const long page_size = sysconf(_SC_PAGESIZE);  // NOLINT(runtime/int)
+  if (page_size > 0) return static_cast<size_t>(page_size);
+#endif
+  return 4096;
+}
+
+}  // namespace
+
+constexpr size_t MappedFileReader::kDefaultReadaheadSize;
+
+MappedFileReader::MappedFileReader(const uint8_t* data, size_t size,
+                                   bool error_tolerant)
+    : data_(data),
+      size_(size),
+      page_size_(GetPageSize()),
+      error_tolerant_(error_tolerant) {}
+
+MappedFileReader::~MappedFileReader() {
+#if !defined(_WIN32)
+  munmap(const_cast<uint8_t*>(data_), size_);
+#endif
+}
+
+std::unique_ptr<FileReaderInterface> MappedFileReader::Open(
+    const std::string& file_name, const bool error_tolerant) {
+  if (file_name.empty() || file_name == "-") return nullptr;
+
+#if defined(_WIN32)
+  static_cast<void>(error_tolerant);
+  LIBGAV1_EXAMPLES_LOG_ERROR("Memory-mapped input is not supported");
+  return nullptr;
+#else
+  const int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+    LIBGAV1_EXAMPLES_LOG_ERROR("Input is not a regular file");
+    close(fd);
+    return nullptr;
+  }
+  const size_t size = static_cast<size_t>(file_stat.st_size);
+  if (size < kIvfFileHeaderSize) {
+    LIBGAV1_EXAMPLES_LOG_ERROR(
+        "Cannot read IVF header: Not enough data available");
+    close(fd);
+    return nullptr;
+  }
+
+  void* const mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps a reference to the file.
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    LIBGAV1_EXAMPLES_LOG_ERROR("Cannot map input file");
+    return nullptr;
+  }
+
+  std::unique_ptr<MappedFileReader> file(new (std::nothrow) MappedFileReader(
+      static_cast<const uint8_t*>(mapping), size, error_tolerant));
+  if (file == nullptr) {
+    LIBGAV1_EXAMPLES_LOG_ERROR("Out of memory");
+    munmap(mapping, size);
+    return nullptr;
+  }
+
+  if (!file->ReadIvfFileHeader()) {
+    LIBGAV1_EXAMPLES_LOG_ERROR("Unsupported file type");
+    return nullptr;
+  }
+  file->Readahead();
+
+  // See FileReader::Open() for why the explicit conversion is required.
+  return std::unique_ptr<FileReaderInterface>(file.release());
+#endif
+}
+
+bool MappedFileReader::ReadTemporalUnit(std::vector<uint8_t>* const tu_data,
+                                        int64_t* const timestamp) {
+  if (tu_data == nullptr) return false;
+  tu_data->clear();
+
+  size_t offset;
+  size_t size;
+  if (!ReadIvfFrame(&offset, &size, timestamp)) return false;
+  tu_data->assign(data_ + offset, data_ + offset + size);
+  return true;
+}
+
+bool MappedFileReader::ReadTemporalUnit(const uint8_t** const tu_data,
+                                        size_t* const tu_size,
+                                        int64_t* const timestamp) {
+  if (tu_data == nullptr || tu_size == nullptr) return false;
+  *tu_data = nullptr;
+  *tu_size = 0;
+
+  size_t offset;
+  size_t size;
+  if (!ReadIvfFrame(&offset, &size, timestamp)) return false;
+  if (end_of_file_) return true;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    temporal_units_.push_back({offset, size, /*released=*/false});
+  }
+  *tu_data = data_ + offset;
+  *tu_size = size;
+  return true;
+}
+
+void MappedFileReader::ReleaseTemporalUnit(const uint8_t* const tu_data) {
+  if (tu_data == nullptr) return;
+  const size_t offset = static_cast<size_t>(tu_data - data_);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find_if(
+      temporal_units_.begin(), temporal_units_.end(),
+      [offset](const TemporalUnit& unit) { return unit.offset == offset; });
+  if (it == temporal_units_.end()) {
+    LIBGAV1_EXAMPLES_LOG_ERROR("Unknown temporal unit");
+    return;
+  }
+  it->released = true;
+
+  // Only the pages before the first temporal unit still in use can be
+  // dropped.
+  size_t released_end = dropped_end_;
+  while (!temporal_units_.empty() && temporal_units_.front().released) {
+    released_end =
+        temporal_units_.front().offset + temporal_units_.front().size;
+    temporal_units_.pop_front();
+  }
+  if (!temporal_units_.empty()) {
+    released_end = temporal_units_.front().offset;
+  }
+  released_end -= released_end % page_size_;
+  if (released_end <= dropped_end_) return;
+#if !defined(_WIN32)
+  // The mapping is read-only, so the dropped pages are read back from the
+  // file if they are accessed again.
+  madvise(const_cast<uint8_t*>(data_) + dropped_end_,
+          released_end - dropped_end_, MADV_DONTNEED);
+#endif
+  dropped_end_ = released_end;
+}
+
+// See FileReader::ReadIvfFileHeader() for the IVF File Header format.
+bool MappedFileReader::ReadIvfFileHeader() {
+  IvfFileHeader ivf_file_header;
+  if (!ParseIvfFileHeader(data_, &ivf_file_header)) {
+    LIBGAV1_EXAMPLES_LOG_ERROR("Could not parse IVF file header");
+    if (error_tolerant_) {
+      ivf_file_header = {};
+    } else {
+      return false;
+    }
+  }
+
+  width_ = ivf_file_header.width;
+  height_ = ivf_file_header.height;
+  frame_rate_ = ivf_file_header.frame_rate_numerator;
+  time_scale_ = ivf_file_header.frame_rate_denominator;
+  position_ = kIvfFileHeaderSize;
+
+  return true;
+}
+
+// See FileReader::ReadTemporalUnit() for the IVF Frame Header format.
+bool MappedFileReader::ReadIvfFrame(size_t* const offset, size_t* const size,
+                                    int64_t* const timestamp) {
+  *offset = position_;
+  *size = 0;
+  const size_t remaining = size_ - position_;
+  if (remaining == 0) {
+    end_of_file_ = true;
+    return true;
+  }
+  if (remaining < kIvfFrameHeaderSize) {
+    LIBGAV1_EXAMPLES_LOG_ERROR(
+        "Cannot read IVF frame header: Not enough data available");
+    end_of_file_ = true;
+    return false;
+  }
+
+  IvfFrameHeader ivf_frame_header;
+  if (!ParseIvfFrameHeader(data_ + position_, &ivf_frame_header)) {
+    LIBGAV1_EXAMPLES_LOG_ERROR("Could not parse IVF frame header");
+    if (error_tolerant_) {
+      ivf_frame_header.frame_size =
+          std::min(ivf_frame_header.frame_size, size_t{kMaxTemporalUnitSize});
+    } else {
+      return false;
+    }
+  }
+
+  if (timestamp != nullptr) *timestamp = ivf_frame_header.timestamp;
+
+  *offset = position_ + kIvfFrameHeaderSize;
+  *size = ivf_frame_header.frame_size;
+  if (*size > remaining - kIvfFrameHeaderSize) {
+    LIBGAV1_EXAMPLES_LOG_ERROR(
+        "Unexpected EOF or I/O error reading frame data");
+    if (!error_tolerant_) {
+      end_of_file_ = true;
+      return false;
+    }
+    *size = remaining - kIvfFrameHeaderSize;
+  }
+  position_ = *offset + *size;
+  Readahead();
+  return true;
+}
+
+void MappedFileReader::Readahead() {
+  if (readahead_size_ == 0) return;
+  const size_t target = std::min(size_, position_ + readahead_size_);
+  // Hint in chunks of half the window rather than on every temporal unit.
+  if (target <= readahead_end_ ||
+      (target - readahead_end_ < readahead_size_ / 2 && target != size_)) {
+    return;
+  }
+  const size_t start =
+      std::max(readahead_end_, position_) / page_size_ * page_size_;
+#if !defined(_WIN32)
+  madvise(const_cast<uint8_t*>(data_) + start, target - start, MADV_WILLNEED);
+#else
+  static_cast<void>(start);
+#endif
+  readahead_end_ = target;
+}
+
+}  // namespace libgav1
@@ -0,0 +1,153 @@
+/*
+ * Copyright 2024 The libgav1 Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGAV1_EXAMPLES_MAPPED_FILE_READER_H_
+#define LIBGAV1_EXAMPLES_MAPPED_FILE_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>  // NOLINT (unapproved c++11 header)
+#include <string>
+#include <vector>
+
+#include "examples/file_reader_interface.h"
+
+namespace libgav1 {
+
+// Temporal Unit based file reader that memory-maps the whole file. Currently
+// supports only IVF files, and only on POSIX systems.
+//
+// The zero-copy ReadTemporalUnit() overload returns pointers into the mapping
+// that can be passed to Decoder::EnqueueFrame() directly. The reader asks the
+// kernel to read ahead of the current position so that the decoder does not
+// block on I/O, and ReleaseTemporalUnit() drops the pages of the temporal
+// units that the decoder no longer needs, so that the resident size stays
+// bounded when decoding very large files.
+//
+// Unlike FileReader, this reader is not registered in the FileReaderFactory
+// since it cannot read from stdin or from pipes. Use Open() directly.
+class MappedFileReader : public FileReaderInterface {
+ public:
+  // The default number of bytes to read ahead of the current position.
+  static constexpr size_t kDefaultReadaheadSize = 8 * 1024 * 1024;
+
+  // Creates and returns a MappedFileReader that reads from |file_name|.
+  // If |error_tolerant| is true format and read errors are ignored,
+  // ReadTemporalUnit() may return truncated data.
+  // Returns nullptr when the file does not exist, cannot be mapped, or is not
+  // an IVF file.
+  static std::unique_ptr<FileReaderInterface> Open(const std::string& file_name,
+                                                   bool error_tolerant = false);
+
+  MappedFileReader() = delete;
+  MappedFileReader(const MappedFileReader&) = delete;
+  MappedFileReader& operator=(const MappedFileReader&) = delete;
+
+  // Unmaps the file. All the pointers returned by ReadTemporalUnit() become
+  // invalid.
+  ~MappedFileReader() override;
+
+  // Reads a temporal unit and copies the data to |tu_data|. Returns true when:
+  // - A temporal unit is read successfully, or
+  // - At end of file.
+  // When ReadTemporalUnit() is called at the end of the file, it will return
+  // true without writing any data to |tu_data|.
+  //
+  // The |timestamp| pointer is optional: callers not interested in timestamps
+  // can pass nullptr. When |timestamp| is not a nullptr, this function returns
+  // the presentation timestamp from the IVF frame header.
+  /*LIBGAV1_MUST_USE_RESULT*/ bool ReadTemporalUnit(
+      std::vector<uint8_t>* tu_data, int64_t* timestamp) override;
+
+  // Same as above, without the copy: |*tu_data| is set to point to the
+  // temporal unit in the mapping and |*tu_size| to its size. At end of file
+  // |*tu_data| is set to nullptr and |*tu_size| to 0. The data remains valid
+  // until the reader is destroyed. Each |*tu_data| other than nullptr returned
+  // by this function must eventually be passed to ReleaseTemporalUnit().
+  /*LIBGAV1_MUST_USE_RESULT*/ bool ReadTemporalUnit(const uint8_t** tu_data,
+                                                    size_t* tu_size,
+                                                    int64_t* timestamp);
+
+  // Indicates that the temporal unit starting at |tu_data| is no longer
+  // needed. The pages that only hold released temporal units are dropped from
+  // memory. Temporal units may be released in any order; they are read back
+  // from the file if they are accessed again. This function is thread-safe,
+  // so it can be called from the Decoder's release_input_buffer callback.
+  void ReleaseTemporalUnit(const uint8_t* tu_data);
+
+  // Sets the number of bytes to read ahead of the current position. 0
+  // disables the readahead hints.
+  void set_readahead_size(size_t readahead_size) {
+    readahead_size_ = readahead_size;
+  }
+
+  /*LIBGAV1_MUST_USE_RESULT*/ bool IsEndOfFile() const override {
+    return end_of_file_;
+  }
+
+  // The values returned by these accessors are strictly informative. No
+  // validation is performed when they are read from the IVF file header.
+  size_t width() const override { return width_; }
+  size_t height() const override { return height_; }
+  size_t frame_rate() const override { return frame_rate_; }
+  size_t time_scale() const override { return time_scale_; }
+
+ private:
+  struct TemporalUnit {
+    size_t offset;
+    size_t size;
+    bool released;
+  };
+
+  MappedFileReader(const uint8_t* data, size_t size, bool error_tolerant);
+
+  bool ReadIvfFileHeader();
+  // Reads the next IVF frame header and sets |*offset| and |*size| to the
+  // location of the temporal unit in the mapping. Sets |*size| to 0 and
+  // |end_of_file_| to true at end of file.
+  bool ReadIvfFrame(size_t* offset, size_t* size, int64_t* timestamp);
+  // Issues the readahead hint for the bytes up to |readahead_size_| past
+  // |position_| that have not been hinted yet.
+  void Readahead();
+
+  const uint8_t* const data_;
+  const size_t size_;
+  const size_t page_size_;
+  size_t position_ = 0;
+  bool end_of_file_ = false;
+  size_t width_ = 0;
+  size_t height_ = 0;
+  size_t frame_rate_ = 0;
+  size_t time_scale_ = 0;
+  size_t readahead_size_ = kDefaultReadaheadSize;
+  // The end of the range covered by the readahead hints.
+  size_t readahead_end_ = 0;
+  const bool error_tolerant_;
+
+  // Guards |temporal_units_| and |dropped_end_|.
+  std::mutex mutex_;
+  // The temporal units returned by the zero-copy ReadTemporalUnit() that
+  // have not been dropped yet, in file order.
+  std::deque<TemporalUnit> temporal_units_;
+  // The pages before this offset have been dropped.
+  size_t dropped_end_ = 0;
+};
+
+}  // namespace libgav1
+
+#endif  // LIBGAV1_EXAMPLES_MAPPED_FILE_READER_H_
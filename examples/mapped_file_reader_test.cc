@@ -0,0 +1,157 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/mapped_file_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "examples/file_reader.h"
+#include "examples/file_reader_interface.h"
+#include "gtest/gtest.h"
+#include "tests/utils.h"
+
+namespace libgav1 {
+namespace {
+
+TEST(MappedFileReaderTest, FailOpen) {
+  EXPECT_EQ(MappedFileReader::Open(""), nullptr);
+  EXPECT_EQ(MappedFileReader::Open("-"), nullptr);
+  EXPECT_EQ(MappedFileReader::Open(
+                test_utils::GetTestInputFilePath("ivf-signature-only")),
+            nullptr);
+  EXPECT_EQ(MappedFileReader::Open(
+                test_utils::GetTestInputFilePath("does-not-exist.ivf")),
+            nullptr);
+}
+
+class MappedFileReaderCompareTest : public testing::TestWithParam<const char*> {
+ protected:
+  void SetUp() override {
+    file_name_ = test_utils::GetTestInputFilePath(GetParam());
+    reader_ = MappedFileReader::Open(file_name_);
+    ASSERT_NE(reader_, nullptr);
+    expected_reader_ = FileReader::Open(file_name_);
+    ASSERT_NE(expected_reader_, nullptr);
+  }
+
+  MappedFileReader* mapped_reader() {
+    return static_cast<MappedFileReader*>(reader_.get());
+  }
+
+  std::string file_name_;
+  std::unique_ptr<FileReaderInterface> reader_;
+  std::unique_ptr<FileReaderInterface> expected_reader_;
+};
+
+// The copying ReadTemporalUnit() behaves like FileReader.
+TEST_P(MappedFileReaderCompareTest, ReadTemporalUnit) {
+  EXPECT_EQ(reader_->width(), expected_reader_->width());
+  EXPECT_EQ(reader_->height(), expected_reader_->height());
+  EXPECT_EQ(reader_->frame_rate(), expected_reader_->frame_rate());
+  EXPECT_EQ(reader_->time_scale(), expected_reader_->time_scale());
+  std::vector<uint8_t> tu_data;
+  std::vector<uint8_t> expected_tu_data;
+  while (!expected_reader_->IsEndOfFile()) {
+    ASSERT_FALSE(reader_->IsEndOfFile());
+    int64_t timestamp = -1;
+    int64_t expected_timestamp = -1;
+    ASSERT_TRUE(expected_reader_->ReadTemporalUnit(&expected_tu_data,
+                                                   &expected_timestamp));
+    ASSERT_TRUE(reader_->ReadTemporalUnit(&tu_data, &timestamp));
+    EXPECT_EQ(tu_data, expected_tu_data);
+    if (!expected_tu_data.empty()) {
+      EXPECT_EQ(timestamp, expected_timestamp);
+    }
+  }
+  EXPECT_TRUE(reader_->IsEndOfFile());
+}
+
+TEST_P(MappedFileReaderCompareTest, ReadTemporalUnitZeroCopy) {
+  mapped_reader()->set_readahead_size(1);
+  std::vector<uint8_t> expected_tu_data;
+  std::vector<const uint8_t*> temporal_units;
+  while (!expected_reader_->IsEndOfFile()) {
+    ASSERT_TRUE(expected_reader_->ReadTemporalUnit(&expected_tu_data,
+                                                   /*timestamp=*/nullptr));
+    const uint8_t* tu_data;
+    size_t tu_size;
+    ASSERT_TRUE(mapped_reader()->ReadTemporalUnit(&tu_data, &tu_size,
+                                                  /*timestamp=*/nullptr));
+    if (reader_->IsEndOfFile()) {
+      EXPECT_EQ(tu_data, nullptr);
+      EXPECT_EQ(tu_size, 0);
+      continue;
+    }
+    ASSERT_NE(tu_data, nullptr);
+    EXPECT_EQ(std::vector<uint8_t>(tu_data, tu_data + tu_size),
+              expected_tu_data);
+    temporal_units.push_back(tu_data);
+  }
+  EXPECT_TRUE(reader_->IsEndOfFile());
+
+  // Release the temporal units out of order. The data stays readable once
+  // its pages are dropped.
+  for (size_t i = 1; i < temporal_units.size(); i += 2) {
+    mapped_reader()->ReleaseTemporalUnit(temporal_units[i]);
+  }
+  for (size_t i = 0; i < temporal_units.size(); i += 2) {
+    mapped_reader()->ReleaseTemporalUnit(temporal_units[i]);
+  }
+  expected_reader_ = FileReader::Open(file_name_);
+  ASSERT_NE(expected_reader_, nullptr);
+  for (const uint8_t* const tu_data : temporal_units) {
+    ASSERT_TRUE(expected_reader_->ReadTemporalUnit(&expected_tu_data,
+                                                   /*timestamp=*/nullptr));
+    EXPECT_EQ(std::vector<uint8_t>(tu_data, tu_data + expected_tu_data.size()),
+              expected_tu_data);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(MappedFileReader, MappedFileReaderCompareTest,
+                         testing::Values("five-frames.ivf", "ivf-header-only",
+                                         "one-frame.ivf",
+                                         "one-frame-large-timestamp.ivf"));
+
+TEST(MappedFileReaderTest, FailRead) {
+  for (const char* file_name :
+       {"ivf-header-and-truncated-frame-header", "one-frame-truncated.ivf"}) {
+    SCOPED_TRACE(file_name);
+    std::unique_ptr<FileReaderInterface> reader =
+        MappedFileReader::Open(test_utils::GetTestInputFilePath(file_name));
+    ASSERT_NE(reader, nullptr);
+    std::vector<uint8_t> tu_data;
+    EXPECT_FALSE(reader->ReadTemporalUnit(&tu_data, /*timestamp=*/nullptr));
+  }
+}
+
+TEST(MappedFileReaderTest, ErrorTolerant) {
+  std::unique_ptr<FileReaderInterface> reader = MappedFileReader::Open(
+      test_utils::GetTestInputFilePath("one-frame-truncated.ivf"),
+      /*error_tolerant=*/true);
+  ASSERT_NE(reader, nullptr);
+  std::vector<uint8_t> tu_data;
+  ASSERT_TRUE(reader->ReadTemporalUnit(&tu_data, /*timestamp=*/nullptr));
+  EXPECT_GT(tu_data.size(), 0);
+  EXPECT_FALSE(reader->IsEndOfFile());
+  ASSERT_TRUE(reader->ReadTemporalUnit(&tu_data, /*timestamp=*/nullptr));
+  EXPECT_TRUE(tu_data.empty());
+  EXPECT_TRUE(reader->IsEndOfFile());
+}
+
+}  // namespace
+}  // namespace libgav1
@@ -0,0 +1,411 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/obu_file_reader.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#include "examples/file_reader_constants.h"
+#include "examples/file_reader_factory.h"
+#include "examples/file_reader_interface.h"
+#include "examples/logging.h"
+
+namespace libgav1 {
+namespace {
+
+constexpr size_t kMaxLeb128Size = 8;
+// The largest OBU header: the header byte, the extension byte and obu_size.
+constexpr size_t kMaxObuHeaderSize = 2 + kMaxLeb128Size;
+
+constexpr int kObuTemporalDelimiter = 2;
+constexpr uint8_t kObuHasSizeFieldBit = 0x02;
+
+struct ObuHeader {
+  int type;
+  bool has_extension;
+  bool has_size_field;
+};
+
+FILE* SetBinaryMode(FILE* stream) {
+#if defined(_WIN32)
+  _setmode(_fileno(stream), _O_BINARY);
+#endif
+  return stream;
+}
+
+// OBU header syntax (5.3.2):
+//   obu_forbidden_bit     f(1)
+//   obu_type              f(4)
+//   obu_extension_flag    f(1)
+//   obu_has_size_field    f(1)
+//   obu_reserved_1bit     f(1)
+bool ParseObuHeader(const uint8_t byte, ObuHeader* const obu_header) {
+  if ((byte & 0x80) != 0) return false;
+  obu_header->type = (byte >> 3) & 0xf;
+  obu_header->has_extension = (byte & 0x04) != 0;
+  obu_header->has_size_field = (byte & kObuHasSizeFieldBit) != 0;
+  return true;
+}
+
+// Parses a leb128 value from the first |size| bytes of |data|. Returns the
+// number of bytes used, or 0 if the value is invalid or does not fit in
+// |size| bytes.
+size_t ParseLeb128(const uint8_t* const data, const size_t size,
+                   uint64_t* const value) {
+  *value = 0;
+  for (size_t i = 0; i < std::min(size, kMaxLeb128Size); ++i) {
+    *value |= static_cast<uint64_t>(data[i] & 0x7f) << (i * 7);
+    if ((data[i] & 0x80) == 0) {
+      return (*value <= UINT32_MAX) ? i + 1 : 0;
+    }
+  }
+  return 0;
+}
+
+size_t WriteLeb128(uint64_t value, uint8_t* const data) {
+  size_t size = 0;
+  do {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    if (value != 0) byte |= 0x80;
+    data[size++] = byte;
+  } while (value != 0);
+  return size;
+}
+
+// A low overhead bitstream format stream starts with a temporal delimiter
+// with an obu_size of 0.
+bool IsSection5Stream(const uint8_t* const data, const size_t size) {
+  ObuHeader obu_header;
+  if (size < 2 || !ParseObuHeader(data[0], &obu_header) ||
+      obu_header.type != kObuTemporalDelimiter || !obu_header.has_size_field) {
+    return false;
+  }
+  const size_t position = obu_header.has_extension ? 2 : 1;
+  if (position >= size) return false;
+  uint64_t obu_size;
+  return ParseLeb128(data + position, size - position, &obu_size) != 0 &&
+         obu_size == 0;
+}
+
+// A length delimited bitstream format stream starts with
+//   temporal_unit_size
+//   frame_unit_size
+//   obu_length
+// followed by a temporal delimiter, with consistent sizes.
+bool IsAnnexBStream(const uint8_t* const data, const size_t size) {
+  uint64_t temporal_unit_size;
+  size_t position = ParseLeb128(data, size, &temporal_unit_size);
+  if (position == 0) return false;
+  uint64_t frame_unit_size;
+  size_t leb128_size =
+      ParseLeb128(data + position, size - position, &frame_unit_size);
+  if (leb128_size == 0 || leb128_size + frame_unit_size > temporal_unit_size) {
+    return false;
+  }
+  position += leb128_size;
+  uint64_t obu_length;
+  leb128_size = ParseLeb128(data + position, size - position, &obu_length);
+  if (leb128_size == 0 || leb128_size + obu_length > frame_unit_size) {
+    return false;
+  }
+  position += leb128_size;
+  ObuHeader obu_header;
+  if (position >= size || !ParseObuHeader(data[position], &obu_header) ||
+      obu_header.type != kObuTemporalDelimiter) {
+    return false;
+  }
+  // The temporal delimiter has no payload.
+  const size_t header_size = obu_header.has_extension ? 2 : 1;
+  return obu_length >= header_size &&
+         obu_length <= header_size + (obu_header.has_size_field ? 1 : 0);
+}
+
+}  // namespace
+
+bool ObuFileReader::registered_in_factory_ =
+    FileReaderFactory::RegisterReader(ObuFileReader::Open);
+
+ObuFileReader::~ObuFileReader() {
+  if (owns_file_) fclose(file_);
+}
+
+std::unique_ptr<FileReaderInterface> ObuFileReader::Open(
+    const std::string& file_name, const bool error_tolerant) {
+  if (file_name.empty()) return nullptr;
+
+  FILE* raw_file_ptr;
+
+  bool owns_file = true;
+  if (file_name == "-") {
+    raw_file_ptr = SetBinaryMode(stdin);
+    owns_file = false;  // stdin is owned by the Standard C Library.
+  } else {
+    raw_file_ptr = fopen(file_name.c_str(), "rb");
+  }
+
+  if (raw_file_ptr == nullptr) {
+    return nullptr;
+  }
+
+  std::unique_ptr<ObuFileReader> file(new (std::nothrow) ObuFileReader(
+      raw_file_ptr, owns_file, error_tolerant));
+  if (file == nullptr) {
+    LIBGAV1_EXAMPLES_LOG_ERROR("Out of memory");
+    if (owns_file) fclose(raw_file_ptr);
+    return nullptr;
+  }
+
+  if (!file->DetectFileType()) {
+    LIBGAV1_EXAMPLES_LOG_ERROR("Unsupported file type");
+    return nullptr;
+  }
+
+  // See FileReader::Open() for why the explicit conversion is required.
+  return std::unique_ptr<FileReaderInterface>(file.release());
+}
+
+bool ObuFileReader::ReadTemporalUnit(std::vector<uint8_t>* const tu_data,
+                                     int64_t* const timestamp) {
+  if (tu_data == nullptr) return false;
+  tu_data->clear();
+
+  const bool ok = (type_ == kFileTypeSection5)
+                      ? ReadSection5TemporalUnit(tu_data)
+                      : ReadAnnexBTemporalUnit(tu_data);
+  if (!ok) return false;
+  if (!tu_data->empty()) {
+    if (timestamp != nullptr) *timestamp = temporal_unit_index_;
+    ++temporal_unit_index_;
+  }
+  return true;
+}
+
+bool ObuFileReader::DetectFileType() {
+  pending_.resize(kFileStartSize);
+  pending_.resize(FileReaderFactory::ReadFileStart(file_, pending_.data()));
+  if (IsSection5Stream(pending_.data(), pending_.size())) {
+    type_ = kFileTypeSection5;
+  } else if (IsAnnexBStream(pending_.data(), pending_.size())) {
+    type_ = kFileTypeAnnexB;
+  }
+  return type_ != kFileTypeUnknown;
+}
+
+size_t ObuFileReader::Read(uint8_t* const data, const size_t size) {
+  const size_t pending_size =
+      std::min(size, pending_.size() - pending_position_);
+  if (pending_size != 0) {
+    memcpy(data, pending_.data() + pending_position_, pending_size);
+    pending_position_ += pending_size;
+  }
+  if (pending_size == size) return size;
+  return pending_size +
+         fread(data + pending_size, 1, size - pending_size, file_);
+}
+
+void ObuFileReader::Unread(const uint8_t* const data, const size_t size) {
+  pending_.erase(pending_.begin(), pending_.begin() + pending_position_);
+  pending_.insert(pending_.begin(), data, data + size);
+  pending_position_ = 0;
+}
+
+bool ObuFileReader::ReadLeb128(uint8_t* const bytes, size_t* const size,
+                               uint64_t* const value) {
+  *size = 0;
+  for (size_t i = 0; i < kMaxLeb128Size; ++i) {
+    if (Read(&bytes[i], 1) != 1) {
+      if (i == 0) return true;
+      LIBGAV1_EXAMPLES_LOG_ERROR("Unexpected EOF reading leb128 value");
+      return false;
+    }
+    if ((bytes[i] & 0x80) == 0) {
+      *size = ParseLeb128(bytes, i + 1, value);
+      if (*size == 0) break;
+      return true;
+    }
+  }
+  LIBGAV1_EXAMPLES_LOG_ERROR("Invalid leb128 value");
+  return false;
+}
+
+bool ObuFileReader::AppendPayload(const size_t size,
+                                  std::vector<uint8_t>* const tu_data) {
+  if (size > kMaxTemporalUnitSize - std::min(tu_data->size(),
+                                             size_t{kMaxTemporalUnitSize})) {
+    LIBGAV1_EXAMPLES_LOG_ERROR("Temporal unit is too large");
+    return false;
+  }
+  const size_t offset = tu_data->size();
+  tu_data->resize(offset + size);
+  const size_t size_read = Read(tu_data->data() + offset, size);
+  if (size_read != size) {
+    LIBGAV1_EXAMPLES_LOG_ERROR(
+        "Unexpected EOF or I/O error reading frame data");
+    if (!error_tolerant_) return false;
+    tu_data->resize(offset + size_read);
+  }
+  return true;
+}
+
+// The OBUs are copied as they are. The temporal unit ends before the next
+// temporal delimiter, which is kept for the next call.
+bool ObuFileReader::ReadSection5TemporalUnit(
+    std::vector<uint8_t>* const tu_data) {
+  while (true) {
+    uint8_t header[kMaxObuHeaderSize];
+    size_t header_size = Read(header, 1);
+    if (header_size == 0) return true;
+    ObuHeader obu_header;
+    if (!ParseObuHeader(header[0], &obu_header)) {
+      LIBGAV1_EXAMPLES_LOG_ERROR("Invalid OBU header");
+      return false;
+    }
+    if (obu_header.has_extension) {
+      if (Read(&header[1], 1) != 1) {
+        LIBGAV1_EXAMPLES_LOG_ERROR("Unexpected EOF reading OBU header");
+        return error_tolerant_;
+      }
+      ++header_size;
+    }
+    if (!obu_header.has_size_field) {
+      LIBGAV1_EXAMPLES_LOG_ERROR("OBU without obu_size field");
+      return false;
+    }
+    size_t leb128_size;
+    uint64_t obu_size;
+    if (!ReadLeb128(&header[header_size], &leb128_size, &obu_size)) {
+      return error_tolerant_;
+    }
+    if (leb128_size == 0) {
+      LIBGAV1_EXAMPLES_LOG_ERROR("Unexpected EOF reading OBU header");
+      return error_tolerant_;
+    }
+    header_size += leb128_size;
+    if (obu_header.type == kObuTemporalDelimiter && !tu_data->empty()) {
+      Unread(header, header_size);
+      return true;
+    }
+    tu_data->insert(tu_data->end(), header, header + header_size);
+    if (!AppendPayload(static_cast<size_t>(obu_size), tu_data)) return false;
+  }
+}
+
+// Annex B syntax (B.2):
+//   temporal_unit( sz ) {
+//     while ( sz > 0 ) {
+//       frame_unit_size    leb128()
+//       sz -= Leb128Bytes
+//       frame_unit( frame_unit_size )
+//       sz -= frame_unit_size
+//     }
+//   }
+//   frame_unit( sz ) {
+//     while ( sz > 0 ) {
+//       obu_length         leb128()
+//       sz -= Leb128Bytes
+//       open_bitstream_unit( obu_length )
+//       sz -= obu_length
+//     }
+//   }
+// The sizes are removed, and obu_size is added to the OBU headers that do not
+// have it.
+bool ObuFileReader::ReadAnnexBTemporalUnit(
+    std::vector<uint8_t>* const tu_data) {
+  uint8_t leb128_bytes[kMaxLeb128Size];
+  size_t leb128_size;
+  uint64_t temporal_unit_size;
+  if (!ReadLeb128(leb128_bytes, &leb128_size, &temporal_unit_size)) {
+    return error_tolerant_;
+  }
+  if (leb128_size == 0) return true;
+  if (temporal_unit_size > kMaxTemporalUnitSize) {
+    LIBGAV1_EXAMPLES_LOG_ERROR("Temporal unit is too large");
+    return false;
+  }
+  tu_data->reserve(static_cast<size_t>(temporal_unit_size));
+
+  while (temporal_unit_size > 0) {
+    uint64_t frame_unit_size;
+    if (!ReadLeb128(leb128_bytes, &leb128_size, &frame_unit_size)) {
+      return error_tolerant_;
+    }
+    if (leb128_size == 0) {
+      LIBGAV1_EXAMPLES_LOG_ERROR("Unexpected EOF reading frame_unit_size");
+      return error_tolerant_;
+    }
+    if (leb128_size + frame_unit_size > temporal_unit_size) {
+      LIBGAV1_EXAMPLES_LOG_ERROR("Invalid frame_unit_size");
+      return false;
+    }
+    temporal_unit_size -= leb128_size + frame_unit_size;
+
+    while (frame_unit_size > 0) {
+      uint64_t obu_length;
+      if (!ReadLeb128(leb128_bytes, &leb128_size, &obu_length)) {
+        return error_tolerant_;
+      }
+      if (leb128_size == 0) {
+        LIBGAV1_EXAMPLES_LOG_ERROR("Unexpected EOF reading obu_length");
+        return error_tolerant_;
+      }
+      if (leb128_size + obu_length > frame_unit_size) {
+        LIBGAV1_EXAMPLES_LOG_ERROR("Invalid obu_length");
+        return false;
+      }
+      frame_unit_size -= leb128_size + obu_length;
+
+      uint8_t header[kMaxObuHeaderSize];
+      ObuHeader obu_header;
+      if (obu_length == 0 || Read(header, 1) != 1 ||
+          !ParseObuHeader(header[0], &obu_header)) {
+        LIBGAV1_EXAMPLES_LOG_ERROR("Invalid OBU header");
+        return false;
+      }
+      size_t header_size = 1;
+      if (obu_header.has_extension) {
+        if (obu_length < 2 || Read(&header[1], 1) != 1) {
+          LIBGAV1_EXAMPLES_LOG_ERROR("Invalid OBU header");
+          return false;
+        }
+        header_size = 2;
+      }
+      const size_t payload_size =
+          static_cast<size_t>(obu_length) - header_size;
+      if (!obu_header.has_size_field) {
+        header[0] |= kObuHasSizeFieldBit;
+        header_size += WriteLeb128(payload_size, &header[header_size]);
+      }
+      tu_data->insert(tu_data->end(), header, header + header_size);
+      if (!AppendPayload(payload_size, tu_data)) return false;
+      // The payload was truncated with |error_tolerant_|.
+      if (IsEndOfFile()) return true;
+    }
+  }
+  return true;
+}
+
+}  // namespace libgav1
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2024 The libgav1 Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGAV1_EXAMPLES_OBU_FILE_READER_H_
+#define LIBGAV1_EXAMPLES_OBU_FILE_READER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "examples/file_reader_interface.h"
+
+namespace libgav1 {
+
+// Temporal Unit based file reader for AV1 streams that are not in a container:
+// - Low overhead bitstream format streams (Section 5 of the AV1
+//   specification), where every OBU has an obu_size field. Temporal units are
+//   delimited by the temporal delimiter OBUs.
+// - Length delimited bitstream format streams (Annex B of the AV1
+//   specification), where every temporal unit, frame unit and OBU is prefixed
+//   with its size.
+//
+// The temporal unit boundaries are found from the OBU headers and sizes only.
+// The OBU payloads are read from the file directly into the temporal unit
+// buffer. libgav1 requires the obu_size field, so the reader adds it to the
+// headers of the Annex B OBUs that do not have it.
+class ObuFileReader : public FileReaderInterface {
+ public:
+  enum FileType {
+    kFileTypeUnknown,
+    kFileTypeSection5,
+    kFileTypeAnnexB,
+  };
+
+  // Creates and returns an ObuFileReader that reads from |file_name|, or from
+  // stdin if |file_name| is "-". stdin may also be opened through
+  // FileReaderFactory after other readers rejected it, see
+  // FileReaderFactory::ReadFileStart().
+  // If |error_tolerant| is true read errors are ignored, ReadTemporalUnit()
+  // may return truncated data.
+  // Returns nullptr when the file does not exist, cannot be read, or does not
+  // start with a temporal unit in one of the supported formats.
+  static std::unique_ptr<FileReaderInterface> Open(const std::string& file_name,
+                                                   bool error_tolerant = false);
+
+  ObuFileReader() = delete;
+  ObuFileReader(const ObuFileReader&) = delete;
+  ObuFileReader& operator=(const ObuFileReader&) = delete;
+
+  // Closes |file_|.
+  ~ObuFileReader() override;
+
+  // Reads a temporal unit from |file_| and writes the data to |tu_data|, in
+  // the low overhead bitstream format. Returns true when:
+  // - A temporal unit is read successfully, or
+  // - At end of file.
+  // When ReadTemporalUnit() is called at the end of the file, it will return
+  // true without writing any data to |tu_data|.
+  //
+  // The |timestamp| pointer is optional: callers not interested in timestamps
+  // can pass nullptr. The streams do not carry timestamps, when |timestamp| is
+  // not a nullptr this function returns the index of the temporal unit.
+  /*LIBGAV1_MUST_USE_RESULT*/ bool ReadTemporalUnit(
+      std::vector<uint8_t>* tu_data, int64_t* timestamp) override;
+
+  /*LIBGAV1_MUST_USE_RESULT*/ bool IsEndOfFile() const override {
+    return pending_position_ == pending_.size() && feof(file_) != 0;
+  }
+
+  FileType type() const { return type_; }
+
+  // The streams do not carry the frame size or the frame rate. width() and
+  // height() return 0, and the frame rate defaults to 30 frames per second.
+  size_t width() const override { return 0; }
+  size_t height() const override { return 0; }
+  size_t frame_rate() const override { return 30; }
+  size_t time_scale() const override { return 1; }
+
+ private:
+  ObuFileReader(FILE* file, bool owns_file, bool error_tolerant)
+      : file_(file), owns_file_(owns_file), error_tolerant_(error_tolerant) {}
+
+  // Reads the beginning of the file and sets |type_|. The bytes read are kept
+  // in |pending_|.
+  bool DetectFileType();
+  // Reads |size| bytes into |data|, starting with the bytes in |pending_|.
+  // Returns the number of bytes read.
+  size_t Read(uint8_t* data, size_t size);
+  // Puts |size| bytes back in front of the bytes that are not consumed yet.
+  void Unread(const uint8_t* data, size_t size);
+  // Reads a leb128 value, and copies its encoding to |bytes|, which must have
+  // room for 8 bytes. Sets |*size| to the number of bytes read, which is 0 at
+  // end of file. Returns false if the value is invalid or truncated.
+  bool ReadLeb128(uint8_t* bytes, size_t* size, uint64_t* value);
+  // Reads |size| bytes and appends them to |tu_data|. Returns false if the
+  // data is truncated, unless |error_tolerant_| is true.
+  bool AppendPayload(size_t size, std::vector<uint8_t>* tu_data);
+  bool ReadSection5TemporalUnit(std::vector<uint8_t>* tu_data);
+  bool ReadAnnexBTemporalUnit(std::vector<uint8_t>* tu_data);
+
+  FILE* file_ = nullptr;
+  FileType type_ = kFileTypeUnknown;
+  int64_t temporal_unit_index_ = 0;
+  // Bytes that were read from |file_| but not consumed yet: the beginning of
+  // the file after DetectFileType(), and the temporal delimiter that ends a
+  // Section 5 temporal unit.
+  std::vector<uint8_t> pending_;
+  size_t pending_position_ = 0;
+  // True if this object owns file_ and is responsible for closing it when
+  // done.
+  const bool owns_file_;
+  const bool error_tolerant_;
+
+  static bool registered_in_factory_;
+};
+
+}  // namespace libgav1
+
+#endif  // LIBGAV1_EXAMPLES_OBU_FILE_READER_H_
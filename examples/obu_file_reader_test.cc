@@ -0,0 +1,226 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/obu_file_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "examples/file_reader.h"
+#include "examples/file_reader_factory.h"
+#include "examples/file_reader_interface.h"
+#include "gtest/gtest.h"
+#include "tests/utils.h"
+
+namespace libgav1 {
+namespace {
+
+void AppendLeb128(uint64_t value, std::vector<uint8_t>* const data) {
+  do {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    if (value != 0) byte |= 0x80;
+    data->push_back(byte);
+  } while (value != 0);
+}
+
+size_t ReadLeb128(const uint8_t* const data, uint64_t* const value) {
+  *value = 0;
+  size_t i = 0;
+  do {
+    *value |= static_cast<uint64_t>(data[i] & 0x7f) << (i * 7);
+  } while ((data[i++] & 0x80) != 0);
+  return i;
+}
+
+// Converts a temporal unit in the low overhead bitstream format to the length
+// delimited bitstream format, with all the OBUs in one frame unit. The
+// obu_size fields are removed if |remove_obu_size| is true.
+std::vector<uint8_t> ToAnnexB(const std::vector<uint8_t>& temporal_unit,
+                              const bool remove_obu_size) {
+  std::vector<uint8_t> frame_unit;
+  size_t position = 0;
+  while (position < temporal_unit.size()) {
+    const uint8_t* const obu = &temporal_unit[position];
+    const size_t header_size = ((obu[0] & 0x04) != 0) ? 2 : 1;
+    EXPECT_NE(obu[0] & 0x02, 0);
+    uint64_t obu_size;
+    const size_t leb128_size = ReadLeb128(obu + header_size, &obu_size);
+    const size_t obu_length = header_size + leb128_size + obu_size;
+    if (remove_obu_size) {
+      AppendLeb128(obu_length - leb128_size, &frame_unit);
+      frame_unit.push_back(obu[0] & ~0x02);
+      frame_unit.insert(frame_unit.end(), obu + 1, obu + header_size);
+      frame_unit.insert(frame_unit.end(), obu + header_size + leb128_size,
+                        obu + obu_length);
+    } else {
+      AppendLeb128(obu_length, &frame_unit);
+      frame_unit.insert(frame_unit.end(), obu, obu + obu_length);
+    }
+    position += obu_length;
+  }
+  std::vector<uint8_t> frame_unit_size;
+  AppendLeb128(frame_unit.size(), &frame_unit_size);
+  std::vector<uint8_t> data;
+  AppendLeb128(frame_unit_size.size() + frame_unit.size(), &data);
+  data.insert(data.end(), frame_unit_size.begin(), frame_unit_size.end());
+  data.insert(data.end(), frame_unit.begin(), frame_unit.end());
+  return data;
+}
+
+bool WriteFile(const std::string& file_name,
+               const std::vector<uint8_t>& data) {
+  FILE* const file = fopen(file_name.c_str(), "wb");
+  if (file == nullptr) return false;
+  const bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+  return fclose(file) == 0 && ok;
+}
+
+class ObuFileReaderTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    std::unique_ptr<FileReaderInterface> reader = FileReader::Open(
+        test_utils::GetTestInputFilePath("five-frames.ivf"));
+    ASSERT_NE(reader, nullptr);
+    while (!reader->IsEndOfFile()) {
+      std::vector<uint8_t> temporal_unit;
+      ASSERT_TRUE(reader->ReadTemporalUnit(&temporal_unit, nullptr));
+      if (!temporal_unit.empty()) temporal_units_.push_back(temporal_unit);
+    }
+    ASSERT_EQ(temporal_units_.size(), 5);
+  }
+
+  // Reads all the temporal units of |file_name| with ObuFileReader and
+  // compares them with |temporal_units_|.
+  void TestReadTemporalUnits(const std::string& file_name,
+                             const ObuFileReader::FileType expected_type) {
+    std::unique_ptr<FileReaderInterface> reader =
+        ObuFileReader::Open(file_name);
+    ASSERT_NE(reader, nullptr);
+    EXPECT_EQ(static_cast<ObuFileReader*>(reader.get())->type(),
+              expected_type);
+    std::vector<uint8_t> temporal_unit;
+    for (size_t i = 0; i < temporal_units_.size(); ++i) {
+      ASSERT_FALSE(reader->IsEndOfFile());
+      int64_t timestamp = -1;
+      ASSERT_TRUE(reader->ReadTemporalUnit(&temporal_unit, &timestamp));
+      EXPECT_EQ(temporal_unit, temporal_units_[i]);
+      EXPECT_EQ(timestamp, static_cast<int64_t>(i));
+    }
+    // The end of file may only be detected by the next read.
+    if (!reader->IsEndOfFile()) {
+      ASSERT_TRUE(reader->ReadTemporalUnit(&temporal_unit, nullptr));
+      EXPECT_TRUE(temporal_unit.empty());
+    }
+    EXPECT_TRUE(reader->IsEndOfFile());
+  }
+
+  std::vector<std::vector<uint8_t>> temporal_units_;
+};
+
+TEST_F(ObuFileReaderTest, FailOpen) {
+  EXPECT_EQ(ObuFileReader::Open(""), nullptr);
+  EXPECT_EQ(ObuFileReader::Open(
+                test_utils::GetTestInputFilePath("five-frames.ivf")),
+            nullptr);
+  EXPECT_EQ(ObuFileReader::Open(
+                test_utils::GetTestInputFilePath("ivf-signature-only")),
+            nullptr);
+}
+
+TEST_F(ObuFileReaderTest, Section5) {
+  std::vector<uint8_t> data;
+  for (const auto& temporal_unit : temporal_units_) {
+    data.insert(data.end(), temporal_unit.begin(), temporal_unit.end());
+  }
+  const std::string file_name =
+      test_utils::GetTestOutputFilePath("five-frames.obu");
+  ASSERT_TRUE(WriteFile(file_name, data));
+  TestReadTemporalUnits(file_name, ObuFileReader::kFileTypeSection5);
+
+  // The factory finds the reader.
+  EXPECT_NE(FileReaderFactory::OpenReader(file_name), nullptr);
+
+  // Truncated streams.
+  data.resize(data.size() - 1);
+  ASSERT_TRUE(WriteFile(file_name, data));
+  std::unique_ptr<FileReaderInterface> reader =
+      ObuFileReader::Open(file_name);
+  ASSERT_NE(reader, nullptr);
+  std::vector<uint8_t> temporal_unit;
+  for (size_t i = 0; i + 1 < temporal_units_.size(); ++i) {
+    ASSERT_TRUE(reader->ReadTemporalUnit(&temporal_unit, nullptr));
+  }
+  EXPECT_FALSE(reader->ReadTemporalUnit(&temporal_unit, nullptr));
+
+  reader = ObuFileReader::Open(file_name, /*error_tolerant=*/true);
+  ASSERT_NE(reader, nullptr);
+  for (size_t i = 0; i + 1 < temporal_units_.size(); ++i) {
+    ASSERT_TRUE(reader->ReadTemporalUnit(&temporal_unit, nullptr));
+  }
+  ASSERT_TRUE(reader->ReadTemporalUnit(&temporal_unit, nullptr));
+  EXPECT_EQ(temporal_unit.size(), temporal_units_.back().size() - 1);
+  EXPECT_TRUE(reader->IsEndOfFile());
+}
+
+// stdin cannot be rewound, so the bytes read by a reader that rejects the
+// stream must still be seen by the next reader. This is the case when the
+// factory tries FileReader first.
+TEST_F(ObuFileReaderTest, Stdin) {
+  std::vector<uint8_t> data;
+  for (const auto& temporal_unit : temporal_units_) {
+    data.insert(data.end(), temporal_unit.begin(), temporal_unit.end());
+  }
+  const std::string file_name =
+      test_utils::GetTestOutputFilePath("five-frames-stdin.obu");
+  ASSERT_TRUE(WriteFile(file_name, data));
+  ASSERT_NE(freopen(file_name.c_str(), "rb", stdin), nullptr);
+  EXPECT_EQ(FileReader::Open("-"), nullptr);
+  TestReadTemporalUnits("-", ObuFileReader::kFileTypeSection5);
+}
+
+TEST_F(ObuFileReaderTest, AnnexB) {
+  for (const bool remove_obu_size : {false, true}) {
+    SCOPED_TRACE(remove_obu_size);
+    std::vector<uint8_t> data;
+    for (const auto& temporal_unit : temporal_units_) {
+      const std::vector<uint8_t> annexb =
+          ToAnnexB(temporal_unit, remove_obu_size);
+      data.insert(data.end(), annexb.begin(), annexb.end());
+    }
+    const std::string file_name =
+        test_utils::GetTestOutputFilePath("five-frames.annexb");
+    ASSERT_TRUE(WriteFile(file_name, data));
+    TestReadTemporalUnits(file_name, ObuFileReader::kFileTypeAnnexB);
+    EXPECT_NE(FileReaderFactory::OpenReader(file_name), nullptr);
+
+    data.resize(data.size() - 1);
+    ASSERT_TRUE(WriteFile(file_name, data));
+    std::unique_ptr<FileReaderInterface> reader =
+        ObuFileReader::Open(file_name);
+    ASSERT_NE(reader, nullptr);
+    std::vector<uint8_t> temporal_unit;
+    for (size_t i = 0; i + 1 < temporal_units_.size(); ++i) {
+      ASSERT_TRUE(reader->ReadTemporalUnit(&temporal_unit, nullptr));
+    }
+    EXPECT_FALSE(reader->ReadTemporalUnit(&temporal_unit, nullptr));
+  }
+}
+
+}  // namespace
+}  // namespace libgav1
@@ -0,0 +1,586 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/stream_generator.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include "examples/file_reader_constants.h"
+#include "examples/logging.h"
+#include "gav1/decoder.h"
+
+namespace libgav1 {
+namespace {
+
+enum ObuType : uint8_t {
+  kObuSequenceHeader = 1,
+  kObuTemporalDelimiter = 2,
+  kObuFrame = 6,
+};
+
+constexpr int kNumReferenceFrames = 8;
+constexpr int kNumInterReferenceFrames = 7;
+constexpr int kOrderHintBits = 7;
+constexpr int kMaxTileWidth = 4096;
+constexpr int kMaxTileArea = 4096 * 2304;
+constexpr int kMaxTileColumns = 64;
+constexpr int kMaxTileRows = 64;
+constexpr int kTileSizeBytes = 4;
+
+// Writes the syntax elements of the headers, most significant bit first.
+class BitWriter {
+ public:
+  explicit BitWriter(std::vector<uint8_t>* data) : data_(data) {}
+
+  void WriteBit(int bit) {
+    if (bit_offset_ == 0) data_->push_back(0);
+    if (bit != 0) data_->back() |= 0x80 >> bit_offset_;
+    bit_offset_ = (bit_offset_ + 1) & 7;
+  }
+
+  void WriteLiteral(uint32_t value, int bits) {
+    for (int i = bits - 1; i >= 0; --i) WriteBit((value >> i) & 1);
+  }
+
+  // Pads with zero bits up to the next byte boundary.
+  void ByteAlign() { bit_offset_ = 0; }
+
+  // Writes the trailing_bits() of an OBU.
+  void WriteTrailingBits() {
+    WriteBit(1);
+    ByteAlign();
+  }
+
+ private:
+  std::vector<uint8_t>* const data_;
+  int bit_offset_ = 0;
+};
+
+int CeilLog2(int n) {
+  int log2 = 0;
+  while ((1 << log2) < n) ++log2;
+  return log2;
+}
+
+// Returns the smallest k such that (block_size << k) >= target.
+int TileLog2(int block_size, int target) {
+  int k = 0;
+  while ((block_size << k) < target) ++k;
+  return k;
+}
+
+void WriteLeb128(size_t value, std::vector<uint8_t>* data) {
+  do {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    if (value != 0) byte |= 0x80;
+    data->push_back(byte);
+  } while (value != 0);
+}
+
+// Appends an OBU of |type| with |payload| to |data|.
+void WriteObu(ObuType type, const std::vector<uint8_t>& payload,
+              std::vector<uint8_t>* data) {
+  // obu_forbidden_bit = 0, obu_extension_flag = 0, obu_has_size_field = 1.
+  data->push_back(static_cast<uint8_t>((type << 3) | 0x02));
+  WriteLeb128(payload.size(), data);
+  data->insert(data->end(), payload.begin(), payload.end());
+}
+
+void WriteLittleEndian(uint64_t value, int bytes, uint8_t* buffer) {
+  for (int i = 0; i < bytes; ++i) {
+    buffer[i] = static_cast<uint8_t>(value >> (8 * i));
+  }
+}
+
+}  // namespace
+
+StreamGenerator::StreamGenerator(const Config& config) : config_(config) {
+  config_.width = std::max(config_.width, 16);
+  config_.height = std::max(config_.height, 16);
+  if (config_.bitdepth != 10 && config_.bitdepth != 12) config_.bitdepth = 8;
+  config_.num_frames = std::max(config_.num_frames, 1);
+  config_.key_frame_interval = std::max(config_.key_frame_interval, 0);
+  if (config_.superres_denominator < 9 || config_.superres_denominator > 16) {
+    config_.superres_denominator = 8;
+  }
+  config_.base_q_index = std::min(std::max(config_.base_q_index, 1), 255);
+
+  // The tile layout is computed from the frame width before superres
+  // upscaling. See ParseTileInfoSyntax() in src/obu_parser.cc.
+  const int width = (config_.width * 8 + config_.superres_denominator / 2) /
+                    config_.superres_denominator;
+  const int columns4x4 = ((width + 7) >> 3) << 1;
+  const int rows4x4 = ((config_.height + 7) >> 3) << 1;
+  const int sb_shift = config_.use_128x128_superblock ? 5 : 4;
+  sb_columns_ = (columns4x4 + (1 << sb_shift) - 1) >> sb_shift;
+  sb_rows_ = (rows4x4 + (1 << sb_shift) - 1) >> sb_shift;
+  const int sb_size_log2 = sb_shift + 2;
+  const int min_log2_tile_columns =
+      TileLog2(kMaxTileWidth >> sb_size_log2, sb_columns_);
+  const int max_log2_tile_columns =
+      CeilLog2(std::min(sb_columns_, kMaxTileColumns));
+  const int max_log2_tile_rows = CeilLog2(std::min(sb_rows_, kMaxTileRows));
+  const int min_log2_tiles =
+      std::max(min_log2_tile_columns,
+               TileLog2(kMaxTileArea >> (2 * sb_size_log2),
+                        sb_rows_ * sb_columns_));
+  config_.tile_columns_log2 =
+      std::min(std::max(config_.tile_columns_log2, min_log2_tile_columns),
+               max_log2_tile_columns);
+  config_.tile_rows_log2 = std::min(
+      std::max(config_.tile_rows_log2,
+               std::max(min_log2_tiles - config_.tile_columns_log2, 0)),
+      max_log2_tile_rows);
+}
+
+bool StreamGenerator::GenerateTemporalUnit(
+    std::vector<uint8_t>* const temporal_unit) {
+  if (frame_index_ == config_.num_frames) return false;
+  FrameState frame;
+  frame.key_frame =
+      frame_index_ == 0 || (config_.key_frame_interval != 0 &&
+                            frame_index_ % config_.key_frame_interval == 0);
+  frame.order_hint = frame_index_ & ((1 << kOrderHintBits) - 1);
+  // Each inter frame replaces the oldest reference frame, so that the seven
+  // references of the next frame are at different distances.
+  if (frame.key_frame) {
+    frame.refresh_frame_flags = 0xff;
+  } else if (config_.non_reference_frames && (frame_index_ & 1) != 0) {
+    frame.refresh_frame_flags = 0;
+  } else {
+    frame.refresh_frame_flags = 1 << (frame_index_ % kNumReferenceFrames);
+  }
+  memcpy(previous_reference_order_hint_, reference_order_hint_,
+         sizeof(reference_order_hint_));
+  retries_ = 0;
+  WriteTemporalUnit(frame, temporal_unit);
+  last_frame_ = frame;
+  ++frame_index_;
+  return true;
+}
+
+void StreamGenerator::RegenerateTemporalUnit(
+    std::vector<uint8_t>* const temporal_unit) {
+  memcpy(reference_order_hint_, previous_reference_order_hint_,
+         sizeof(reference_order_hint_));
+  ++retries_;
+  --frame_index_;
+  WriteTemporalUnit(last_frame_, temporal_unit);
+  ++frame_index_;
+}
+
+void StreamGenerator::WriteTemporalUnit(
+    const FrameState& frame, std::vector<uint8_t>* const temporal_unit) {
+  std::seed_seq seed = {config_.seed, static_cast<uint32_t>(frame_index_),
+                        static_cast<uint32_t>(retries_)};
+  random_.seed(seed);
+  temporal_unit->clear();
+  WriteObu(kObuTemporalDelimiter, {}, temporal_unit);
+  std::vector<uint8_t> payload;
+  if (frame.key_frame) {
+    WriteSequenceHeader(&payload);
+    WriteObu(kObuSequenceHeader, payload, temporal_unit);
+    payload.clear();
+  }
+  WriteFrame(frame, &payload);
+  WriteObu(kObuFrame, payload, temporal_unit);
+  for (int i = 0; i < kNumReferenceFrames; ++i) {
+    if ((frame.refresh_frame_flags & (1 << i)) != 0) {
+      reference_order_hint_[i] = frame.order_hint;
+    }
+  }
+}
+
+void StreamGenerator::WriteSequenceHeader(
+    std::vector<uint8_t>* const data) const {
+  BitWriter writer(data);
+  const int profile = (config_.bitdepth == 12) ? 2 : 0;
+  writer.WriteLiteral(profile, 3);
+  writer.WriteBit(0);  // still_picture.
+  writer.WriteBit(0);  // reduced_still_picture_header.
+  writer.WriteBit(0);  // timing_info_present_flag.
+  writer.WriteBit(0);  // initial_display_delay_present_flag.
+  writer.WriteLiteral(0, 5);    // operating_points_cnt_minus_1.
+  writer.WriteLiteral(0, 12);   // operating_point_idc[0].
+  writer.WriteLiteral(31, 5);   // seq_level_idx[0]: no level constraints.
+  writer.WriteBit(0);           // seq_tier[0].
+  writer.WriteLiteral(15, 4);   // frame_width_bits_minus_1.
+  writer.WriteLiteral(15, 4);   // frame_height_bits_minus_1.
+  writer.WriteLiteral(config_.width - 1, 16);
+  writer.WriteLiteral(config_.height - 1, 16);
+  writer.WriteBit(0);  // frame_id_numbers_present_flag.
+  writer.WriteBit(config_.use_128x128_superblock ? 1 : 0);
+  writer.WriteBit(1);  // enable_filter_intra.
+  writer.WriteBit(1);  // enable_intra_edge_filter.
+  writer.WriteBit(1);  // enable_interintra_compound.
+  writer.WriteBit(1);  // enable_masked_compound.
+  writer.WriteBit(1);  // enable_warped_motion.
+  writer.WriteBit(1);  // enable_dual_filter.
+  writer.WriteBit(1);  // enable_order_hint.
+  writer.WriteBit(1);  // enable_jnt_comp.
+  writer.WriteBit(1);  // enable_ref_frame_mvs.
+  writer.WriteBit(0);  // seq_choose_screen_content_tools.
+  writer.WriteBit(config_.screen_content ? 1 : 0);
+  if (config_.screen_content) {
+    writer.WriteBit(0);  // seq_choose_integer_mv.
+    writer.WriteBit(0);  // seq_force_integer_mv.
+  }
+  writer.WriteLiteral(kOrderHintBits - 1, 3);
+  writer.WriteBit(config_.superres_denominator != 8 ? 1 : 0);
+  writer.WriteBit(config_.cdef ? 1 : 0);  // enable_cdef.
+  writer.WriteBit(1);  // enable_restoration.
+  // color_config(): 4:2:0 with unspecified colors.
+  writer.WriteBit(config_.bitdepth != 8 ? 1 : 0);  // high_bitdepth.
+  if (profile == 2) writer.WriteBit(1);             // twelve_bit.
+  writer.WriteBit(0);  // mono_chrome.
+  writer.WriteBit(0);  // color_description_present_flag.
+  writer.WriteBit(0);  // color_range.
+  if (profile == 2) {
+    writer.WriteBit(1);  // subsampling_x.
+    writer.WriteBit(1);  // subsampling_y.
+  }
+  writer.WriteLiteral(0, 2);  // chroma_sample_position.
+  writer.WriteBit(0);         // separate_uv_delta_q.
+  writer.WriteBit(config_.film_grain ? 1 : 0);
+  writer.WriteTrailingBits();
+}
+
+void StreamGenerator::WriteFrame(const FrameState& frame,
+                                 std::vector<uint8_t>* const data) {
+  BitWriter writer(data);
+  const bool use_superres = config_.superres_denominator != 8;
+  // uncompressed_header().
+  writer.WriteBit(0);                             // show_existing_frame.
+  writer.WriteLiteral(frame.key_frame ? 0 : 1, 2);  // frame_type.
+  writer.WriteBit(1);                             // show_frame.
+  // error_resilient_mode is implied for shown key frames.
+  if (!frame.key_frame) writer.WriteBit(0);
+  writer.WriteBit(0);  // disable_cdf_update.
+  writer.WriteBit(0);  // frame_size_override_flag.
+  writer.WriteLiteral(frame.order_hint, kOrderHintBits);
+  if (!frame.key_frame) {
+    writer.WriteLiteral(0, 3);  // primary_ref_frame: LAST_FRAME.
+    writer.WriteLiteral(frame.refresh_frame_flags, 8);
+    writer.WriteBit(0);  // frame_refs_short_signaling.
+    for (int i = 0; i < kNumInterReferenceFrames; ++i) {
+      writer.WriteLiteral(i, 3);  // ref_frame_idx[i].
+    }
+  }
+  // frame_size() and render_size().
+  if (use_superres) {
+    writer.WriteBit(1);  // use_superres.
+    writer.WriteLiteral(config_.superres_denominator - 9, 3);
+  }
+  writer.WriteBit(0);  // render_and_frame_size_different.
+  const bool allow_intrabc = frame.key_frame && config_.screen_content &&
+                             !use_superres;
+  if (frame.key_frame) {
+    if (config_.screen_content && !use_superres) {
+      writer.WriteBit(allow_intrabc ? 1 : 0);
+    }
+  } else {
+    writer.WriteBit(1);  // allow_high_precision_mv.
+    writer.WriteBit(1);  // is_filter_switchable.
+    writer.WriteBit(1);  // is_motion_mode_switchable.
+    writer.WriteBit(1);  // use_ref_frame_mvs.
+  }
+  writer.WriteBit(0);  // disable_frame_end_update_cdf.
+
+  // tile_info(): uniform spacing.
+  const int sb_shift = config_.use_128x128_superblock ? 5 : 4;
+  const int max_log2_tile_columns =
+      CeilLog2(std::min(sb_columns_, kMaxTileColumns));
+  const int max_log2_tile_rows = CeilLog2(std::min(sb_rows_, kMaxTileRows));
+  writer.WriteBit(1);  // uniform_tile_spacing_flag.
+  const int sb_size_log2 = sb_shift + 2;
+  const int min_log2_tile_columns =
+      TileLog2(kMaxTileWidth >> sb_size_log2, sb_columns_);
+  for (int i = min_log2_tile_columns; i < config_.tile_columns_log2; ++i) {
+    writer.WriteBit(1);  // increment_tile_cols_log2.
+  }
+  if (config_.tile_columns_log2 < max_log2_tile_columns) writer.WriteBit(0);
+  const int min_log2_tiles =
+      std::max(min_log2_tile_columns,
+               TileLog2(kMaxTileArea >> (2 * sb_size_log2),
+                        sb_rows_ * sb_columns_));
+  const int min_log2_tile_rows =
+      std::max(min_log2_tiles - config_.tile_columns_log2, 0);
+  for (int i = min_log2_tile_rows; i < config_.tile_rows_log2; ++i) {
+    writer.WriteBit(1);  // increment_tile_rows_log2.
+  }
+  if (config_.tile_rows_log2 < max_log2_tile_rows) writer.WriteBit(0);
+  const int tile_bits = config_.tile_columns_log2 + config_.tile_rows_log2;
+  if (tile_bits != 0) {
+    writer.WriteLiteral(0, tile_bits);  // context_update_tile_id.
+    writer.WriteLiteral(kTileSizeBytes - 1, 2);
+  }
+  // The tile sizes in superblocks, like in ParseTileInfoSyntax().
+  const int sb_tile_width =
+      (sb_columns_ + (1 << config_.tile_columns_log2) - 1) >>
+      config_.tile_columns_log2;
+  const int sb_tile_height = (sb_rows_ + (1 << config_.tile_rows_log2) - 1) >>
+                             config_.tile_rows_log2;
+  const int tile_columns = (sb_columns_ + sb_tile_width - 1) / sb_tile_width;
+  const int tile_rows = (sb_rows_ + sb_tile_height - 1) / sb_tile_height;
+
+  // quantization_params().
+  writer.WriteLiteral(config_.base_q_index, 8);
+  writer.WriteBit(0);  // DeltaQYDc.
+  writer.WriteBit(0);  // DeltaQUDc.
+  writer.WriteBit(0);  // DeltaQUAc.
+  writer.WriteBit(0);  // using_qmatrix.
+  writer.WriteBit(0);  // segmentation_enabled.
+  if (config_.base_q_index > 0) {
+    writer.WriteBit(config_.delta_lf ? 1 : 0);  // delta_q_present.
+    if (config_.delta_lf) {
+      writer.WriteLiteral(0, 2);  // delta_q_res.
+      if (!allow_intrabc) {
+        writer.WriteBit(1);         // delta_lf_present.
+        writer.WriteLiteral(0, 2);  // delta_lf_res.
+        writer.WriteBit(1);         // delta_lf_multi.
+      }
+    }
+  }
+  if (!allow_intrabc) {
+    // loop_filter_params().
+    writer.WriteLiteral(10, 6);  // loop_filter_level[0].
+    writer.WriteLiteral(8, 6);   // loop_filter_level[1].
+    writer.WriteLiteral(6, 6);   // loop_filter_level[2].
+    writer.WriteLiteral(6, 6);   // loop_filter_level[3].
+    writer.WriteLiteral(0, 3);   // loop_filter_sharpness.
+    writer.WriteBit(0);          // loop_filter_delta_enabled.
+    if (config_.cdef) {
+      // cdef_params().
+      writer.WriteLiteral(1, 2);  // cdef_damping_minus_3.
+      writer.WriteLiteral(1, 2);  // cdef_bits.
+      for (int i = 0; i < 2; ++i) {
+        writer.WriteLiteral(4 + 4 * i, 4);  // cdef_y_pri_strength[i].
+        writer.WriteLiteral(1 + i, 2);      // cdef_y_sec_strength[i].
+        writer.WriteLiteral(2 + 2 * i, 4);  // cdef_uv_pri_strength[i].
+        writer.WriteLiteral(1, 2);          // cdef_uv_sec_strength[i].
+      }
+    }
+    // lr_params(): switchable for luma, Wiener and self guided for chroma.
+    writer.WriteLiteral(1, 2);
+    writer.WriteLiteral(2, 2);
+    writer.WriteLiteral(3, 2);
+    if (config_.use_128x128_superblock) {
+      writer.WriteBit(0);  // lr_unit_shift.
+    } else {
+      writer.WriteBit(1);  // lr_unit_shift.
+      writer.WriteBit(0);  // lr_unit_extra_shift.
+    }
+    writer.WriteBit(1);  // lr_uv_shift.
+  }
+  writer.WriteBit(1);  // tx_mode_select.
+  if (!frame.key_frame) {
+    writer.WriteBit(1);  // reference_select.
+    if (IsSkipModeAllowed(frame.order_hint)) {
+      writer.WriteBit(1);  // skip_mode_present.
+    }
+    writer.WriteBit(1);  // allow_warped_motion.
+  }
+  writer.WriteBit(0);  // reduced_tx_set.
+  if (!frame.key_frame) {
+    for (int i = 0; i < kNumInterReferenceFrames; ++i) {
+      writer.WriteBit(0);  // is_global.
+    }
+  }
+  if (config_.film_grain) {
+    // film_grain_params().
+    writer.WriteBit(1);  // apply_grain.
+    writer.WriteLiteral(random_() & 0xffff, 16);  // grain_seed.
+    if (!frame.key_frame) writer.WriteBit(1);     // update_grain.
+    writer.WriteLiteral(2, 4);                    // num_y_points.
+    writer.WriteLiteral(16, 8);                   // point_y_value[0].
+    writer.WriteLiteral(40, 8);                   // point_y_scaling[0].
+    writer.WriteLiteral(200, 8);                  // point_y_value[1].
+    writer.WriteLiteral(64, 8);                   // point_y_scaling[1].
+    writer.WriteBit(0);  // chroma_scaling_from_luma.
+    writer.WriteLiteral(1, 4);    // num_cb_points.
+    writer.WriteLiteral(128, 8);  // point_cb_value[0].
+    writer.WriteLiteral(32, 8);   // point_cb_scaling[0].
+    writer.WriteLiteral(1, 4);    // num_cr_points.
+    writer.WriteLiteral(128, 8);  // point_cr_value[0].
+    writer.WriteLiteral(32, 8);   // point_cr_scaling[0].
+    writer.WriteLiteral(3, 2);    // grain_scaling_minus_8.
+    writer.WriteLiteral(2, 2);    // ar_coeff_lag.
+    // 12 luma coefficients and 13 coefficients for each chroma plane.
+    for (int i = 0; i < 12 + 2 * 13; ++i) {
+      writer.WriteLiteral(128 + static_cast<int>(random_() % 17) - 8, 8);
+    }
+    writer.WriteLiteral(1, 2);    // ar_coeff_shift_minus_6.
+    writer.WriteLiteral(0, 2);    // grain_scale_shift.
+    writer.WriteLiteral(128, 8);  // cb_mult.
+    writer.WriteLiteral(192, 8);  // cb_luma_mult.
+    writer.WriteLiteral(256, 9);  // cb_offset.
+    writer.WriteLiteral(128, 8);  // cr_mult.
+    writer.WriteLiteral(192, 8);  // cr_luma_mult.
+    writer.WriteLiteral(256, 9);  // cr_offset.
+    writer.WriteBit(1);           // overlap_flag.
+    writer.WriteBit(0);           // clip_to_restricted_range.
+  }
+  writer.ByteAlign();
+
+  // tile_group_obu().
+  if (tile_bits != 0) {
+    writer.WriteBit(0);  // tile_start_and_end_present_flag.
+    writer.ByteAlign();
+  }
+  const int sb_size = 1 << sb_size_log2;
+  const double frame_bits_per_pixel =
+      config_.bits_per_pixel * (frame.key_frame ? 4 : 1);
+  for (int row = 0; row < tile_rows; ++row) {
+    const int tile_height =
+        std::min(sb_tile_height, sb_rows_ - row * sb_tile_height) * sb_size;
+    for (int column = 0; column < tile_columns; ++column) {
+      const int tile_width =
+          std::min(sb_tile_width, sb_columns_ - column * sb_tile_width) *
+          sb_size;
+      const size_t tile_size = std::max<size_t>(
+          16, static_cast<size_t>(tile_width * tile_height *
+                                  frame_bits_per_pixel / 8));
+      const bool last_tile = row == tile_rows - 1 && column == tile_columns - 1;
+      if (!last_tile) {
+        uint8_t size_bytes[kTileSizeBytes];
+        WriteLittleEndian(tile_size - 1, kTileSizeBytes, size_bytes);
+        data->insert(data->end(), size_bytes, size_bytes + kTileSizeBytes);
+      }
+      for (size_t i = 0; i < tile_size; ++i) {
+        data->push_back(static_cast<uint8_t>(random_()));
+      }
+    }
+  }
+}
+
+bool StreamGenerator::IsSkipModeAllowed(int order_hint) const {
+  // See ObuParser::IsSkipModeAllowed(). ref_frame_idx[i] is i.
+  int forward_hint = -1;
+  int backward_hint = -1;
+  for (int i = 0; i < kNumInterReferenceFrames; ++i) {
+    const int hint = reference_order_hint_[i];
+    const int distance = GetRelativeDistance(hint, order_hint);
+    if (distance < 0) {
+      if (forward_hint < 0 || GetRelativeDistance(hint, forward_hint) > 0) {
+        forward_hint = hint;
+      }
+    } else if (distance > 0) {
+      if (backward_hint < 0 || GetRelativeDistance(hint, backward_hint) < 0) {
+        backward_hint = hint;
+      }
+    }
+  }
+  if (forward_hint < 0) return false;
+  if (backward_hint >= 0) return true;
+  for (int i = 0; i < kNumInterReferenceFrames; ++i) {
+    if (GetRelativeDistance(reference_order_hint_[i], forward_hint) < 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int StreamGenerator::GetRelativeDistance(int a, int b) const {
+  const int diff = a - b;
+  const int m = 1 << (kOrderHintBits - 1);
+  return (diff & (m - 1)) - (diff & m);
+}
+
+bool GenerateStream(const StreamGenerator::Config& config, int max_retries,
+                    std::vector<std::vector<uint8_t>>* const temporal_units) {
+  StreamGenerator generator(config);
+  temporal_units->clear();
+  std::unique_ptr<Decoder> decoder;
+  std::vector<uint8_t> temporal_unit;
+  while (generator.GenerateTemporalUnit(&temporal_unit)) {
+    int retries = 0;
+    while (true) {
+      if (decoder == nullptr) {
+        // Replay the accepted temporal units into a new decoder, since the
+        // state of a decoder is undefined after an error.
+        decoder.reset(new (std::nothrow) Decoder());
+        if (decoder == nullptr || decoder->Init(nullptr) != kStatusOk) {
+          LIBGAV1_EXAMPLES_LOG_ERROR("Unable to create the decoder");
+          return false;
+        }
+        for (const auto& accepted : *temporal_units) {
+          const DecoderBuffer* buffer;
+          if (decoder->EnqueueFrame(accepted.data(), accepted.size(),
+                                    /*user_private_data=*/0,
+                                    /*buffer_private_data=*/nullptr) !=
+                  kStatusOk ||
+              decoder->DequeueFrame(&buffer) != kStatusOk) {
+            LIBGAV1_EXAMPLES_LOG_ERROR("Unable to decode the stream again");
+            return false;
+          }
+        }
+      }
+      const DecoderBuffer* buffer;
+      if (decoder->EnqueueFrame(temporal_unit.data(), temporal_unit.size(),
+                                /*user_private_data=*/0,
+                                /*buffer_private_data=*/nullptr) ==
+              kStatusOk &&
+          decoder->DequeueFrame(&buffer) == kStatusOk && buffer != nullptr) {
+        break;
+      }
+      decoder = nullptr;
+      if (++retries > max_retries) {
+        LIBGAV1_EXAMPLES_LOG_ERROR("Unable to generate a decodable frame");
+        return false;
+      }
+      generator.RegenerateTemporalUnit(&temporal_unit);
+    }
+    temporal_units->push_back(temporal_unit);
+  }
+  return true;
+}
+
+bool WriteIvfFile(const std::string& file_name, int width, int height,
+                  const std::vector<std::vector<uint8_t>>& temporal_units) {
+  FILE* const file = fopen(file_name.c_str(), "wb");
+  if (file == nullptr) {
+    LIBGAV1_EXAMPLES_LOG_ERROR("Unable to open the output file");
+    return false;
+  }
+  uint8_t header[kIvfFileHeaderSize] = {};
+  memcpy(header, kIvfSignature, sizeof(kIvfSignature));
+  WriteLittleEndian(kIvfHeaderVersion, 2, &header[4]);
+  WriteLittleEndian(kIvfFileHeaderSize, 2, &header[6]);
+  memcpy(&header[8], kAv1FourCcUpper, 4);
+  WriteLittleEndian(width, 2, &header[12]);
+  WriteLittleEndian(height, 2, &header[14]);
+  WriteLittleEndian(30, 4, &header[16]);  // Frame rate numerator.
+  WriteLittleEndian(1, 4, &header[20]);   // Frame rate denominator.
+  WriteLittleEndian(temporal_units.size(), 4, &header[24]);
+  bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+  for (size_t i = 0; ok && i < temporal_units.size(); ++i) {
+    uint8_t frame_header[kIvfFrameHeaderSize];
+    WriteLittleEndian(temporal_units[i].size(), 4, &frame_header[0]);
+    WriteLittleEndian(i, 8, &frame_header[4]);  // Timestamp.
+    ok = fwrite(frame_header, 1, sizeof(frame_header), file) ==
+             sizeof(frame_header) &&
+         fwrite(temporal_units[i].data(), 1, temporal_units[i].size(), file) ==
+             temporal_units[i].size();
+  }
+  if (fclose(file) != 0) ok = false;
+  if (!ok) LIBGAV1_EXAMPLES_LOG_ERROR("Unable to write the output file");
+  return ok;
+}
+
+}  // namespace libgav1
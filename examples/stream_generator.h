@@ -0,0 +1,136 @@
+/*
+ * Copyright 2024 The libgav1 Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGAV1_EXAMPLES_STREAM_GENERATOR_H_
+#define LIBGAV1_EXAMPLES_STREAM_GENERATOR_H_
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace libgav1 {
+
+// Synthesizes AV1 streams for benchmarking without an encoder. The sequence
+// and frame headers are written like an encoder would write them, with the
+// requested set of coding tools enabled. The tile data is pseudo-random: the
+// decoder reads it like any other entropy coded data, so the streams exercise
+// the same prediction, transform and filtering paths as real content, even
+// though they do not look like natural video.
+//
+// Random tile data may decode to motion vectors that the decoder rejects (in
+// particular intra block copy vectors). GenerateStream() decodes every frame
+// it generates and regenerates the frames that fail with a different seed, so
+// the streams it returns always decode successfully.
+//
+// The output is fully determined by the configuration, including the seed.
+class StreamGenerator {
+ public:
+  struct Config {
+    int width = 1280;
+    int height = 720;
+    // 8, 10 or 12.
+    int bitdepth = 8;
+    int num_frames = 30;
+    // The distance between key frames. 0 means that only the first frame is a
+    // key frame.
+    int key_frame_interval = 0;
+    // The requested number of tile columns and rows (log2). The values are
+    // clamped to the range allowed by the frame size.
+    int tile_columns_log2 = 0;
+    int tile_rows_log2 = 0;
+    bool use_128x128_superblock = false;
+    bool film_grain = false;
+    // Makes the inter frames at odd indices non-reference frames, which are
+    // not saved in any reference frame slot.
+    bool non_reference_frames = false;
+    // The superres denominator, in the range [9, 16]. 8 disables superres.
+    int superres_denominator = 8;
+    // Enables the screen content tools (palette, and intra block copy in the
+    // intra frames when superres is disabled).
+    bool screen_content = false;
+    int base_q_index = 120;
+    // Enables the superblock level deltas of the quantizer and of the loop
+    // filter levels (delta_q_present and delta_lf_present, with a separate
+    // delta for each loop filter level).
+    bool delta_lf = false;
+    bool cdef = true;
+    // The size of the tile data of inter frames. Key frames are four times
+    // larger. Once the random tile data is exhausted the remaining blocks take
+    // the cheapest decoding paths, so this controls the decoding complexity.
+    double bits_per_pixel = 0.2;
+    uint32_t seed = 1;
+  };
+
+  explicit StreamGenerator(const Config& config);
+
+  StreamGenerator(const StreamGenerator&) = delete;
+  StreamGenerator& operator=(const StreamGenerator&) = delete;
+
+  // Returns the configuration, with the tile layout clamped to the values
+  // that are actually written.
+  const Config& config() const { return config_; }
+
+  // Generates the next temporal unit into |temporal_unit|. Each temporal unit
+  // contains one shown frame. Returns false after |num_frames| temporal units
+  // have been generated.
+  bool GenerateTemporalUnit(std::vector<uint8_t>* temporal_unit);
+
+  // Generates the last temporal unit again, with a different seed for the
+  // tile data. Used to replace a temporal unit that does not decode.
+  void RegenerateTemporalUnit(std::vector<uint8_t>* temporal_unit);
+
+ private:
+  struct FrameState {
+    bool key_frame;
+    int order_hint;
+    int refresh_frame_flags;
+  };
+
+  void WriteTemporalUnit(const FrameState& frame,
+                         std::vector<uint8_t>* temporal_unit);
+  void WriteSequenceHeader(std::vector<uint8_t>* data) const;
+  void WriteFrame(const FrameState& frame, std::vector<uint8_t>* data);
+  bool IsSkipModeAllowed(int order_hint) const;
+  int GetRelativeDistance(int a, int b) const;
+
+  Config config_;
+  int sb_columns_ = 0;
+  int sb_rows_ = 0;
+  int frame_index_ = 0;
+  int retries_ = 0;
+  FrameState last_frame_ = {};
+  // The order hints of the frames in the reference frame slots.
+  int reference_order_hint_[8] = {};
+  int previous_reference_order_hint_[8] = {};
+  std::mt19937 random_;
+};
+
+// Generates all the temporal units of a stream with |config|. Every temporal
+// unit is decoded with libgav1, and the ones that fail to decode are generated
+// again, at most |max_retries| times each. Returns false if a temporal unit
+// could not be generated or the decoder could not be created.
+bool GenerateStream(const StreamGenerator::Config& config, int max_retries,
+                    std::vector<std::vector<uint8_t>>* temporal_units);
+
+// Writes |temporal_units| to |file_name| as an IVF file. Returns false on
+// error.
+bool WriteIvfFile(const std::string& file_name, int width, int height,
+                  const std::vector<std::vector<uint8_t>>& temporal_units);
+
+}  // namespace libgav1
+
+#endif  // LIBGAV1_EXAMPLES_STREAM_GENERATOR_H_
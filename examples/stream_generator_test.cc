@@ -0,0 +1,584 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/stream_generator.h"
+
+#include <algorithm>
+#include <condition_variable>  // NOLINT (unapproved c++11 header)
+#include <cstddef>
+#include <cstdio>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>  // NOLINT (unapproved c++11 header)
+#include <new>
+#include <ostream>
+#include <string>
+#include <thread>  // NOLINT (unapproved c++11 header)
+#include <utility>
+#include <vector>
+
+#include "examples/file_reader_factory.h"
+#include "examples/file_reader_interface.h"
+#include "gav1/decoder.h"
+#include "gav1/frame_buffer.h"
+#include "gav1/multi_stream_decoder.h"
+#include "gtest/gtest.h"
+#include "tests/utils.h"
+
+namespace libgav1 {
+namespace {
+
+constexpr int kNumFrames = 6;
+constexpr int kMaxRetries = 100;
+
+struct StreamGeneratorTestParam {
+  const char* name;
+  int width;
+  int height;
+  int bitdepth;
+  int tile_columns_log2;
+  int tile_rows_log2;
+  bool use_128x128_superblock;
+  bool film_grain;
+  int superres_denominator;
+  bool screen_content;
+};
+
+std::ostream& operator<<(std::ostream& stream,
+                         const StreamGeneratorTestParam& param) {
+  return stream << param.name;
+}
+
+const StreamGeneratorTestParam kStreamGeneratorTestParams[] = {
+    {"base", 352, 288, 8, 0, 0, false, false, 8, false},
+    {"tiles", 640, 360, 8, 1, 1, false, false, 8, false},
+    {"10bit", 352, 288, 10, 0, 0, false, false, 8, false},
+    {"12bit", 352, 288, 12, 0, 0, false, false, 8, false},
+    {"sb128", 352, 288, 8, 1, 0, true, false, 8, false},
+    {"film_grain", 352, 288, 8, 0, 0, false, true, 8, false},
+    {"superres", 352, 288, 8, 0, 0, false, false, 16, false},
+    {"screen", 352, 288, 8, 0, 0, false, false, 8, true},
+};
+
+StreamGenerator::Config GetConfig(const StreamGeneratorTestParam& param) {
+  StreamGenerator::Config config;
+  config.width = param.width;
+  config.height = param.height;
+  config.bitdepth = param.bitdepth;
+  config.num_frames = kNumFrames;
+  config.key_frame_interval = 4;
+  config.tile_columns_log2 = param.tile_columns_log2;
+  config.tile_rows_log2 = param.tile_rows_log2;
+  config.use_128x128_superblock = param.use_128x128_superblock;
+  config.film_grain = param.film_grain;
+  config.superres_denominator = param.superres_denominator;
+  config.screen_content = param.screen_content;
+  return config;
+}
+
+void ReleaseInputBuffer(void* /*callback_private_data*/,
+                        void* /*buffer_private_data*/) {}
+
+// Decodes |temporal_units| with |settings| and stores the md5 digest of each
+// output frame in |md5s|.
+void DecodeStream(const std::vector<std::vector<uint8_t>>& temporal_units,
+                  DecoderSettings settings, std::vector<std::string>* md5s) {
+  Decoder decoder;
+  settings.blocking_dequeue = true;
+  settings.release_input_buffer = ReleaseInputBuffer;
+  ASSERT_EQ(decoder.Init(&settings), kStatusOk);
+  md5s->clear();
+  size_t next = 0;
+  while (true) {
+    if (next < temporal_units.size()) {
+      const StatusCode status = decoder.EnqueueFrame(
+          temporal_units[next].data(), temporal_units[next].size(), next,
+          /*buffer_private_data=*/nullptr);
+      if (status == kStatusOk) {
+        ++next;
+        continue;
+      }
+      ASSERT_EQ(status, kStatusTryAgain);
+    }
+    const DecoderBuffer* buffer;
+    const StatusCode status = decoder.DequeueFrame(&buffer);
+    if (status == kStatusNothingToDequeue && next == temporal_units.size()) {
+      break;
+    }
+    ASSERT_TRUE(status == kStatusOk || status == kStatusNothingToDequeue);
+    if (buffer == nullptr) continue;
+    EXPECT_EQ(buffer->user_private_data, static_cast<int64_t>(md5s->size()));
+    md5s->push_back(test_utils::GetMd5Sum(*buffer));
+  }
+}
+
+// Returns the settings of a decoder that uses |threads| threads.
+DecoderSettings ThreadedSettings(int threads, bool frame_parallel = false) {
+  DecoderSettings settings;
+  settings.threads = threads;
+  settings.frame_parallel = frame_parallel;
+  return settings;
+}
+
+// Generates the stream of |config| and checks that decoding it with each of
+// |settings_list| produces |expected_md5s|, one digest per frame.
+template <size_t kNumMd5s>
+void ExpectMd5s(const StreamGenerator::Config& config,
+                const char* const (&expected_md5s)[kNumMd5s],
+                const std::vector<DecoderSettings>& settings_list) {
+  ASSERT_EQ(config.num_frames, static_cast<int>(kNumMd5s));
+  std::vector<std::vector<uint8_t>> temporal_units;
+  ASSERT_TRUE(GenerateStream(config, kMaxRetries, &temporal_units));
+  const std::vector<std::string> expected(std::begin(expected_md5s),
+                                          std::end(expected_md5s));
+  for (const DecoderSettings& settings : settings_list) {
+    SCOPED_TRACE(testing::Message()
+                 << "threads: " << settings.threads
+                 << " frame_parallel: " << settings.frame_parallel
+                 << " post_filter_mask: " << settings.post_filter_mask);
+    std::vector<std::string> md5s;
+    DecodeStream(temporal_units, settings, &md5s);
+    EXPECT_EQ(md5s, expected);
+  }
+}
+
+// Counts the frame buffers that a decoder gets through the frame buffer
+// callbacks.
+struct FrameBufferCounter {
+  int allocations = 0;
+  int in_use = 0;
+  int max_in_use = 0;
+};
+
+extern "C" {
+
+static Libgav1StatusCode GetCountedFrameBuffer(
+    void* callback_private_data, int bitdepth, Libgav1ImageFormat image_format,
+    int width, int height, int left_border, int right_border, int top_border,
+    int bottom_border, int stride_alignment, Libgav1FrameBuffer* frame_buffer) {
+  Libgav1FrameBufferInfo info;
+  Libgav1StatusCode status = Libgav1ComputeFrameBufferInfo(
+      bitdepth, image_format, width, height, left_border, right_border,
+      top_border, bottom_border, stride_alignment, &info);
+  if (status != kLibgav1StatusOk) return status;
+  const size_t size = info.y_buffer_size + 2 * info.uv_buffer_size;
+  std::unique_ptr<uint8_t[]> data(new (std::nothrow) uint8_t[size]);
+  if (data == nullptr) return kLibgav1StatusOutOfMemory;
+  uint8_t* const y_buffer = data.get();
+  uint8_t* const u_buffer =
+      (info.uv_buffer_size != 0) ? y_buffer + info.y_buffer_size : nullptr;
+  uint8_t* const v_buffer =
+      (info.uv_buffer_size != 0) ? u_buffer + info.uv_buffer_size : nullptr;
+  status = Libgav1SetFrameBuffer(&info, y_buffer, u_buffer, v_buffer,
+                                 data.release(), frame_buffer);
+  if (status != kLibgav1StatusOk) return status;
+  auto* const counter = static_cast<FrameBufferCounter*>(callback_private_data);
+  ++counter->allocations;
+  counter->max_in_use = std::max(counter->max_in_use, ++counter->in_use);
+  return kLibgav1StatusOk;
+}
+
+static void ReleaseCountedFrameBuffer(void* callback_private_data,
+                                      void* buffer_private_data) {
+  delete[] static_cast<uint8_t*>(buffer_private_data);
+  --static_cast<FrameBufferCounter*>(callback_private_data)->in_use;
+}
+
+}  // extern "C"
+
+// A first-in first-out executor with a fixed number of threads.
+class Executor {
+ public:
+  explicit Executor(int num_threads) {
+    for (int i = 0; i < num_threads; ++i) {
+      threads_.emplace_back([this]() { Run(); });
+    }
+  }
+
+  ~Executor() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      exit_ = true;
+    }
+    condvar_.notify_all();
+    for (auto& thread : threads_) thread.join();
+  }
+
+  // Libgav1ScheduleJobCallback.
+  static void ScheduleJob(void* executor_private_data, JobFunction job,
+                          void* job_private_data) {
+    auto* const executor = static_cast<Executor*>(executor_private_data);
+    {
+      std::lock_guard<std::mutex> lock(executor->mutex_);
+      executor->jobs_.emplace_back(job, job_private_data);
+    }
+    executor->condvar_.notify_one();
+  }
+
+ private:
+  void Run() {
+    while (true) {
+      std::pair<JobFunction, void*> job;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condvar_.wait(lock, [this]() { return exit_ || !jobs_.empty(); });
+        if (jobs_.empty()) return;
+        job = jobs_.front();
+        jobs_.pop_front();
+      }
+      job.first(job.second);
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable condvar_;
+  std::deque<std::pair<JobFunction, void*>> jobs_;
+  bool exit_ = false;
+  std::vector<std::thread> threads_;
+};
+
+class StreamGeneratorTest
+    : public testing::TestWithParam<StreamGeneratorTestParam> {};
+
+TEST_P(StreamGeneratorTest, Decode) {
+  const StreamGeneratorTestParam& param = GetParam();
+  std::vector<std::vector<uint8_t>> temporal_units;
+  ASSERT_TRUE(GenerateStream(GetConfig(param), kMaxRetries, &temporal_units));
+  ASSERT_EQ(temporal_units.size(), static_cast<size_t>(kNumFrames));
+
+  // The streams decode with any decoder settings.
+  Decoder decoder;
+  DecoderSettings settings;
+  settings.threads = 4;
+  settings.frame_parallel = true;
+  settings.blocking_dequeue = true;
+  settings.release_input_buffer = ReleaseInputBuffer;
+  ASSERT_EQ(decoder.Init(&settings), kStatusOk);
+  int frames = 0;
+  size_t next = 0;
+  while (true) {
+    if (next < temporal_units.size()) {
+      const StatusCode status = decoder.EnqueueFrame(
+          temporal_units[next].data(), temporal_units[next].size(), next,
+          /*buffer_private_data=*/nullptr);
+      if (status == kStatusOk) {
+        ++next;
+        continue;
+      }
+      ASSERT_EQ(status, kStatusTryAgain);
+    }
+    const DecoderBuffer* buffer;
+    const StatusCode status = decoder.DequeueFrame(&buffer);
+    if (status == kStatusNothingToDequeue && next == temporal_units.size()) {
+      break;
+    }
+    ASSERT_TRUE(status == kStatusOk || status == kStatusNothingToDequeue);
+    if (buffer == nullptr) continue;
+    EXPECT_EQ(buffer->user_private_data, frames);
+    EXPECT_EQ(buffer->bitdepth, param.bitdepth);
+    EXPECT_EQ(buffer->displayed_width[0], param.width);
+    EXPECT_EQ(buffer->displayed_height[0], param.height);
+    ++frames;
+  }
+  EXPECT_EQ(frames, kNumFrames);
+}
+
+// The threaded decoders produce the same output as the single threaded one.
+// Without frame parallelism the post filters are pipelined with the decoding
+// of the tiles or of the superblock rows. The frame parallel decoder filters
+// the frames without pipelining.
+TEST_P(StreamGeneratorTest, Threads) {
+  std::vector<std::vector<uint8_t>> temporal_units;
+  ASSERT_TRUE(
+      GenerateStream(GetConfig(GetParam()), kMaxRetries, &temporal_units));
+  std::vector<std::string> expected_md5s;
+  DecodeStream(temporal_units, DecoderSettings(), &expected_md5s);
+  ASSERT_EQ(expected_md5s.size(), static_cast<size_t>(kNumFrames));
+  for (const int threads : {2, 4, 8}) {
+    for (const bool frame_parallel : {false, true}) {
+      SCOPED_TRACE(testing::Message() << "threads: " << threads
+                                      << " frame_parallel: " << frame_parallel);
+      DecoderSettings settings;
+      settings.threads = threads;
+      settings.frame_parallel = frame_parallel;
+      std::vector<std::string> md5s;
+      DecodeStream(temporal_units, settings, &md5s);
+      EXPECT_EQ(md5s, expected_md5s);
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(StreamGenerator, StreamGeneratorTest,
+                         testing::ValuesIn(kStreamGeneratorTestParams));
+
+// Decoders that together may use more threads than a shared executor has
+// neither stall nor change their output.
+TEST(StreamGeneratorTest, SharedExecutor) {
+  constexpr int kNumDecoders = 4;
+  constexpr int kThreadsPerDecoder = 4;
+  constexpr int kExecutorThreads = 2;
+  Executor executor(kExecutorThreads);
+  DecoderSettings settings;
+  settings.threads = kThreadsPerDecoder;
+  settings.schedule_job = Executor::ScheduleJob;
+  settings.executor_private_data = &executor;
+  // A single tile is decoded with superblock row threads, multiple tiles with
+  // tile threads.
+  for (const auto& param : {kStreamGeneratorTestParams[0],
+                            kStreamGeneratorTestParams[1]}) {
+    SCOPED_TRACE(param.name);
+    std::vector<std::vector<uint8_t>> temporal_units;
+    ASSERT_TRUE(GenerateStream(GetConfig(param), kMaxRetries, &temporal_units));
+    std::vector<std::string> expected_md5s;
+    DecodeStream(temporal_units, DecoderSettings(), &expected_md5s);
+    ASSERT_EQ(expected_md5s.size(), static_cast<size_t>(kNumFrames));
+
+    std::vector<std::string> md5s[kNumDecoders];
+    std::vector<std::thread> threads;
+    for (auto& decoder_md5s : md5s) {
+      threads.emplace_back([&temporal_units, &settings, &decoder_md5s]() {
+        DecodeStream(temporal_units, settings, &decoder_md5s);
+      });
+    }
+    for (auto& thread : threads) thread.join();
+    for (const auto& decoder_md5s : md5s) {
+      EXPECT_EQ(decoder_md5s, expected_md5s);
+    }
+  }
+}
+
+// The streams of a MultiStreamDecoder that have more than one thread take them
+// from its worker threads, and produce the same output as a decoder that does
+// not use threads.
+TEST(StreamGeneratorTest, MultiStreamDecoderThreads) {
+  constexpr int kNumStreams = 3;
+  std::vector<std::vector<uint8_t>> temporal_units;
+  ASSERT_TRUE(GenerateStream(GetConfig(kStreamGeneratorTestParams[1]),
+                             kMaxRetries, &temporal_units));
+  std::vector<std::string> expected_md5s;
+  DecodeStream(temporal_units, DecoderSettings(), &expected_md5s);
+  ASSERT_EQ(expected_md5s.size(), static_cast<size_t>(kNumFrames));
+
+  DecoderSettings settings;
+  settings.threads = 4;
+  settings.blocking_dequeue = true;
+  settings.release_input_buffer = ReleaseInputBuffer;
+  for (int worker_threads = 1; worker_threads <= 3; ++worker_threads) {
+    SCOPED_TRACE(worker_threads);
+    MultiStreamDecoder decoder;
+    ASSERT_EQ(decoder.Init(worker_threads), kStatusOk);
+    int stream_ids[kNumStreams];
+    for (auto& stream_id : stream_ids) {
+      ASSERT_EQ(decoder.AddStream(&settings, &stream_id), kStatusOk);
+    }
+    std::vector<std::string> md5s[kNumStreams];
+    for (size_t i = 0; i < temporal_units.size(); ++i) {
+      // The streams decode the temporal unit at the same time.
+      for (const int stream_id : stream_ids) {
+        ASSERT_EQ(decoder.EnqueueFrame(stream_id, temporal_units[i].data(),
+                                       temporal_units[i].size(), i,
+                                       /*buffer_private_data=*/nullptr),
+                  kStatusOk);
+      }
+      for (int j = 0; j < kNumStreams; ++j) {
+        const DecoderBuffer* buffer;
+        ASSERT_EQ(decoder.DequeueFrame(stream_ids[j], &buffer), kStatusOk);
+        ASSERT_NE(buffer, nullptr);
+        EXPECT_EQ(buffer->user_private_data, static_cast<int64_t>(i));
+        md5s[j].push_back(test_utils::GetMd5Sum(*buffer));
+      }
+    }
+    for (const auto& stream_md5s : md5s) {
+      EXPECT_EQ(stream_md5s, expected_md5s);
+    }
+  }
+}
+
+// The generated inter frames set use_ref_frame_mvs, so their temporal motion
+// field is projected from the motion vectors of the reference frames. The
+// output matches digests recorded with the decoder from before the motion
+// field was set up one superblock row at a time.
+TEST(StreamGeneratorTest, RefFrameMvs) {
+  constexpr int kNumInterFrames = 7;
+  static const char* const kExpectedMd5s[][kNumInterFrames + 1] = {
+      // 352x288, one tile.
+      {"5ed6f669f49d0196343d14e91ba540cc", "d21036e1cb7a190e15cce6a535c4f441",
+       "9dd3c78797a93dfcb16f7b08b282eba6", "d600c00d9f5b2b3b4e9620db1edd3198",
+       "09ff50fc1a94954640fe60b6343f5574", "e85ddb431f5d39e42552cc3c20b7e2d5",
+       "935ef7a5e4f29978a02001d602c59651", "873e1eab554106db5d2c6952d1ebe141"},
+      // 640x360, 2x2 tiles of 128x128 superblocks.
+      {"bc08681634a49415355c17f3a8daccc6", "362454dd87323434b8da0dd38adc9886",
+       "40684bb5fb8905545b81b22b533e6892", "6059f47841b9f591322d0cd4490a2ff8",
+       "53a4ab71344d4a5b2820dc13d4575535", "0f1282c1ee55adedc2e940f0a5346a72",
+       "f484348f49cf22decf3089ef2be04b1f", "111028271beb3130ac30453a89d426d1"},
+  };
+  StreamGenerator::Config configs[2] = {
+      GetConfig(kStreamGeneratorTestParams[0]),
+      GetConfig(kStreamGeneratorTestParams[1])};
+  configs[1].use_128x128_superblock = true;
+  for (int i = 0; i < 2; ++i) {
+    SCOPED_TRACE(i);
+    configs[i].num_frames = kNumInterFrames + 1;
+    configs[i].key_frame_interval = 0;
+    ExpectMd5s(configs[i], kExpectedMd5s[i],
+               {DecoderSettings(), ThreadedSettings(4),
+                ThreadedSettings(4, /*frame_parallel=*/true)});
+  }
+}
+
+// The loop filter levels of the superblocks of these streams change with
+// delta_lf, so the deblocking filter levels of each block are only known once
+// the superblock has been parsed. The output matches digests recorded with the
+// decoder from before the deblocking filter levels and the CDEF skip flags
+// were computed by the superblock decoding jobs.
+TEST(StreamGeneratorTest, DeltaLf) {
+  static const char* const kExpectedMd5s[][kNumFrames] = {
+      // 352x288, one tile.
+      {"e1eec1966b45287d35cb305a980258da", "79dc06573a555489c52dd8b2fb95813b",
+       "a9f80ec5631b2d60376bbbb741e7275c", "f082e215be9548b77a90b4060e233b3c",
+       "e1306d03c11c857fc9b8b01001376f13", "5df13e1779c67c95af39cf680ea784e1"},
+      // 352x288, one tile, without CDEF.
+      {"c270dccfc1a19b9fb5758778d2e35820", "262af1e7c94544ed596bb9a3feca349d",
+       "018590448694ce29981ba4bd696c8a5c", "4b304c60f85c1f00423e7253a6ddad22",
+       "37218c99473e8b2b7c34351e5b121c4a", "db752a0cdca0a86ac71e4a2ea9e1bdde"},
+      // 640x360, 2x2 tiles.
+      {"d95c0a3e84ab588d878be2955c1b9d76", "06a693eca2d0e473bb182781894c0e04",
+       "34169bb4076c300c3afc040cf7b760fa", "a0f4791484f0ef0b6d77e8b5443106a6",
+       "f96eb1dcf2c34a8f6e10f78b9cc84402", "8ed0caa13bff04dc04255b2e3eb3622b"},
+  };
+  StreamGenerator::Config configs[3] = {
+      GetConfig(kStreamGeneratorTestParams[0]),
+      GetConfig(kStreamGeneratorTestParams[0]),
+      GetConfig(kStreamGeneratorTestParams[1])};
+  configs[1].cdef = false;
+  for (int i = 0; i < 3; ++i) {
+    SCOPED_TRACE(i);
+    configs[i].delta_lf = true;
+    // A single tile is parsed on one thread and decoded by the superblock
+    // jobs once there are threads left for them.
+    ExpectMd5s(configs[i], kExpectedMd5s[i],
+               {DecoderSettings(), ThreadedSettings(2), ThreadedSettings(4),
+                ThreadedSettings(8)});
+  }
+}
+
+// Film grain is added in place to the frames that are not reference frames.
+// Only the noisy copies of the reference frames take another frame buffer,
+// which is released when the next frame is dequeued.
+TEST(StreamGeneratorTest, FilmGrainFrameBuffers) {
+  // The output of the decoder before film grain was moved to the output path.
+  static const char* const kExpectedMd5s[kNumFrames] = {
+      "c9934f0c880db519e8cce0c55361eac7", "7ccd8d605140afce9a9e9fdf7441d4d7",
+      "abfc43c3d1222e8ccc684fb21e9ad613", "27a45f03b958f4743f3a52ed6c5b5fec",
+      "e9ac3547590e7a52b14f45e386e56022", "422d2762bb4be60b17d1ac218430c4ea",
+  };
+  // Frames 1, 3 and 5 are not reference frames.
+  constexpr int kNumReferenceFramesShown = 3;
+  StreamGenerator::Config config = GetConfig(kStreamGeneratorTestParams[5]);
+  ASSERT_TRUE(config.film_grain);
+  config.non_reference_frames = true;
+
+  FrameBufferCounter without_film_grain;
+  FrameBufferCounter with_film_grain;
+  DecoderSettings settings;
+  settings.get_frame_buffer = GetCountedFrameBuffer;
+  settings.release_frame_buffer = ReleaseCountedFrameBuffer;
+  settings.callback_private_data = &with_film_grain;
+  settings.post_filter_mask = 0x1f;
+  // The frame parallel decoder applies film grain as each frame is decoded.
+  ExpectMd5s(config, kExpectedMd5s,
+             {settings, ThreadedSettings(4, /*frame_parallel=*/true)});
+
+  std::vector<std::vector<uint8_t>> temporal_units;
+  ASSERT_TRUE(GenerateStream(config, kMaxRetries, &temporal_units));
+  settings.callback_private_data = &without_film_grain;
+  settings.post_filter_mask = 0x0f;
+  std::vector<std::string> md5s;
+  DecodeStream(temporal_units, settings, &md5s);
+  EXPECT_EQ(without_film_grain.in_use, 0);
+  EXPECT_EQ(with_film_grain.in_use, 0);
+  EXPECT_EQ(with_film_grain.allocations,
+            without_film_grain.allocations + kNumReferenceFramesShown);
+  EXPECT_LE(with_film_grain.max_in_use, without_film_grain.max_in_use + 1);
+}
+
+TEST(StreamGeneratorTest, Deterministic) {
+  StreamGenerator::Config config;
+  config.width = 352;
+  config.height = 288;
+  config.num_frames = 3;
+  StreamGenerator generator1(config);
+  StreamGenerator generator2(config);
+  config.seed = 2;
+  StreamGenerator generator3(config);
+  std::vector<uint8_t> temporal_unit1;
+  std::vector<uint8_t> temporal_unit2;
+  std::vector<uint8_t> temporal_unit3;
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(generator1.GenerateTemporalUnit(&temporal_unit1));
+    ASSERT_TRUE(generator2.GenerateTemporalUnit(&temporal_unit2));
+    ASSERT_TRUE(generator3.GenerateTemporalUnit(&temporal_unit3));
+    EXPECT_EQ(temporal_unit1, temporal_unit2);
+    EXPECT_NE(temporal_unit1, temporal_unit3);
+    // A regenerated temporal unit has the same headers but different tile
+    // data.
+    generator2.RegenerateTemporalUnit(&temporal_unit2);
+    EXPECT_EQ(temporal_unit1.size(), temporal_unit2.size());
+    EXPECT_NE(temporal_unit1, temporal_unit2);
+  }
+  EXPECT_FALSE(generator1.GenerateTemporalUnit(&temporal_unit1));
+}
+
+TEST(StreamGeneratorTest, ClampsTileLayout) {
+  StreamGenerator::Config config;
+  config.width = 352;
+  config.height = 288;
+  config.tile_columns_log2 = 6;
+  config.tile_rows_log2 = 6;
+  StreamGenerator generator(config);
+  // 6x5 superblocks of 64x64.
+  EXPECT_EQ(generator.config().tile_columns_log2, 3);
+  EXPECT_EQ(generator.config().tile_rows_log2, 3);
+}
+
+TEST(StreamGeneratorTest, WriteIvfFile) {
+  StreamGenerator::Config config;
+  config.width = 352;
+  config.height = 288;
+  config.num_frames = 3;
+  std::vector<std::vector<uint8_t>> temporal_units;
+  ASSERT_TRUE(GenerateStream(config, kMaxRetries, &temporal_units));
+  const std::string file_name =
+      test_utils::GetTestOutputFilePath("stream_generator.ivf");
+  ASSERT_TRUE(WriteIvfFile(file_name, config.width, config.height,
+                           temporal_units));
+
+  std::unique_ptr<FileReaderInterface> reader =
+      FileReaderFactory::OpenReader(file_name);
+  ASSERT_NE(reader, nullptr);
+  EXPECT_EQ(reader->width(), static_cast<size_t>(config.width));
+  EXPECT_EQ(reader->height(), static_cast<size_t>(config.height));
+  for (const auto& temporal_unit : temporal_units) {
+    std::vector<uint8_t> data;
+    ASSERT_TRUE(reader->ReadTemporalUnit(&data, /*timestamp=*/nullptr));
+    EXPECT_EQ(data, temporal_unit);
+  }
+  reader.reset();
+  EXPECT_EQ(std::remove(file_name.c_str()), 0);
+}
+
+}  // namespace
+}  // namespace libgav1
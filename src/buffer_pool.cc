@@ -15,7 +15,10 @@
 #include "src/buffer_pool.h"
 
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
+#include <utility>
 
 #include "src/utils/common.h"
 #include "src/utils/constants.h"
@@ -61,7 +64,106 @@ bool RefCountedBuffer::Realloc(int bitdepth, bool is_monochrome, int width,
   return true;
 }
 
-bool RefCountedBuffer::SetFrameDimensions(const ObuFrameHeader& frame_header) {
+bool RefCountedBuffer::CopyFrom(const RefCountedBuffer& source) {
+  const YuvBuffer& from = source.yuv_buffer_;
+  if (!Realloc(from.bitdepth(), from.is_monochrome(), from.width(kPlaneY),
+               from.height(kPlaneY), from.subsampling_x(),
+               from.subsampling_y(), from.left_border(kPlaneY),
+               from.right_border(kPlaneY), from.top_border(kPlaneY),
+               from.bottom_border(kPlaneY))) {
+    return false;
+  }
+  const int pixel_size =
+      (from.bitdepth() == 8) ? sizeof(uint8_t) : sizeof(uint16_t);
+  const int num_planes = from.is_monochrome() ? 1 : kMaxPlanes;
+  for (int plane = kPlaneY; plane < num_planes; ++plane) {
+    // The borders are copied too. They have been extended, and the motion
+    // vectors of the frames that use this frame as a reference may point
+    // into them.
+    const int top_border = from.top_border(plane);
+    const size_t left_border_size = from.left_border(plane) * pixel_size;
+    const size_t row_size =
+        left_border_size +
+        (from.width(plane) + from.right_border(plane)) * pixel_size;
+    const uint8_t* src = from.data(plane) -
+                         top_border * from.stride(plane) - left_border_size;
+    uint8_t* dst = yuv_buffer_.data(plane) -
+                   top_border * yuv_buffer_.stride(plane) - left_border_size;
+    const int rows =
+        top_border + from.height(plane) + from.bottom_border(plane);
+    for (int y = 0; y < rows; ++y) {
+      memcpy(dst, src, row_size);
+      src += from.stride(plane);
+      dst += yuv_buffer_.stride(plane);
+    }
+  }
+
+  frame_type_ = source.frame_type_;
+  chroma_sample_position_ = source.chroma_sample_position_;
+  showable_frame_ = source.showable_frame_;
+  upscaled_width_ = source.upscaled_width_;
+  frame_width_ = source.frame_width_;
+  frame_height_ = source.frame_height_;
+  render_width_ = source.render_width_;
+  render_height_ = source.render_height_;
+  rows4x4_ = source.rows4x4_;
+  columns4x4_ = source.columns4x4_;
+  spatial_id_ = source.spatial_id_;
+  temporal_id_ = source.temporal_id_;
+  hdr_cll_ = source.hdr_cll_;
+  hdr_cll_set_ = source.hdr_cll_set_;
+  hdr_mdcv_ = source.hdr_mdcv_;
+  hdr_mdcv_set_ = source.hdr_mdcv_set_;
+  itut_t35_set_ = false;
+  if (source.itut_t35_set_ &&
+      !set_itut_t35(source.itut_t35_, source.itut_t35_.payload_bytes)) {
+    return false;
+  }
+
+  if (!segmentation_map_.Allocate(rows4x4_, columns4x4_)) return false;
+  segmentation_map_.CopyFrom(source.segmentation_map_);
+  global_motion_ = source.global_motion_;
+  // The frame context is immutable, so it is shared within a buffer pool. A
+  // buffer of another pool gets its own copy, so that it does not depend on
+  // the lifetime of the source pool.
+  if (source.frame_context_ == nullptr ||
+      source.frame_context_.pool() == pool_->frame_context_pool()) {
+    frame_context_ = source.frame_context_;
+  } else {
+    frame_context_ = pool_->frame_context_pool()->Get();
+    if (frame_context_ == nullptr) return false;
+    *frame_context_.Mutable() = *source.frame_context_;
+  }
+  loop_filter_ref_deltas_ = source.loop_filter_ref_deltas_;
+  loop_filter_mode_deltas_ = source.loop_filter_mode_deltas_;
+  segmentation_ = source.segmentation_;
+  film_grain_params_ = source.film_grain_params_;
+
+  const ReferenceInfo& from_info = source.reference_info_;
+  reference_info_.order_hint = from_info.order_hint;
+  reference_info_.relative_distance_from = from_info.relative_distance_from;
+  reference_info_.relative_distance_to = from_info.relative_distance_to;
+  reference_info_.skip_references = from_info.skip_references;
+  reference_info_.projection_divisions = from_info.projection_divisions;
+  // The saved motion vectors are only allocated for inter frames.
+  const int mv_rows = from_info.motion_field_mv.rows();
+  const int mv_columns = from_info.motion_field_mv.columns();
+  if (mv_rows != 0) {
+    if (!reference_info_.Reset(mv_rows, mv_columns)) return false;
+    memcpy(reference_info_.motion_field_reference_frame.data(),
+           from_info.motion_field_reference_frame.data(),
+           from_info.motion_field_reference_frame.size() *
+               sizeof(ReferenceFrameType));
+    memcpy(reference_info_.motion_field_mv.data(),
+           from_info.motion_field_mv.data(),
+           from_info.motion_field_mv.size() * sizeof(MotionVector));
+  }
+
+  SetFrameState(kFrameStateDecoded);
+  return true;
+}
+
+void RefCountedBuffer::SetFrameSize(const ObuFrameHeader& frame_header) {
   upscaled_width_ = frame_header.upscaled_width;
   frame_width_ = frame_header.width;
   frame_height_ = frame_header.height;
@@ -69,6 +171,10 @@ bool RefCountedBuffer::SetFrameDimensions(const ObuFrameHeader& frame_header) {
   render_height_ = frame_header.render_height;
   rows4x4_ = frame_header.rows4x4;
   columns4x4_ = frame_header.columns4x4;
+}
+
+bool RefCountedBuffer::SetFrameDimensions(const ObuFrameHeader& frame_header) {
+  SetFrameSize(frame_header);
   if (frame_header.refresh_frame_flags != 0 &&
       !IsIntraFrame(frame_header.frame_type)) {
     const int rows4x4_half = DivideBy2(rows4x4_);
@@ -91,10 +197,10 @@ void RefCountedBuffer::SetGlobalMotions(
   }
 }
 
-void RefCountedBuffer::SetFrameContext(const SymbolDecoderContext& context) {
-  frame_context_ = context;
-  frame_context_.ResetIntraFrameYModeCdf();
-  frame_context_.ResetCounters();
+void RefCountedBuffer::SetFrameContext(SymbolDecoderContextSnapshot context) {
+  context.Mutable()->ResetIntraFrameYModeCdf();
+  context.Mutable()->ResetCounters();
+  frame_context_ = std::move(context);
 }
 
 void RefCountedBuffer::GetSegmentationParameters(
@@ -113,6 +219,10 @@ void RefCountedBuffer::ReturnToBufferPool(RefCountedBuffer* ptr) {
   ptr->pool_->ReturnUnusedBuffer(ptr);
 }
 
+void RefCountedBuffer::ReleaseControlBlock(RefCountedBuffer* ptr) {
+  ptr->pool_->MarkBufferUnused(ptr);
+}
+
 BufferPool::BufferPool(
     FrameBufferSizeChangedCallback on_frame_buffer_size_changed,
     GetFrameBufferCallback get_frame_buffer,
@@ -166,7 +276,9 @@ RefCountedBufferPtr BufferPool::GetFreeBuffer() {
       buffer->hdr_mdcv_set_ = false;
       buffer->itut_t35_set_ = false;
       lock.unlock();
-      return RefCountedBufferPtr(buffer, RefCountedBuffer::ReturnToBufferPool);
+      return RefCountedBufferPtr(
+          buffer, RefCountedBuffer::ReturnToBufferPool,
+          RefCountedBuffer::ControlBlockAllocator<RefCountedBuffer>(buffer));
     }
   }
   lock.unlock();
@@ -189,7 +301,9 @@ RefCountedBufferPtr BufferPool::GetFreeBuffer() {
     delete buffer;
     return RefCountedBufferPtr();
   }
-  return RefCountedBufferPtr(buffer, RefCountedBuffer::ReturnToBufferPool);
+  return RefCountedBufferPtr(
+      buffer, RefCountedBuffer::ReturnToBufferPool,
+      RefCountedBuffer::ControlBlockAllocator<RefCountedBuffer>(buffer));
 }
 
 void BufferPool::Abort() {
@@ -204,11 +318,19 @@ void BufferPool::Abort() {
 void BufferPool::ReturnUnusedBuffer(RefCountedBuffer* buffer) {
   std::lock_guard<std::mutex> lock(mutex_);
   assert(buffer->in_use_);
-  buffer->in_use_ = false;
   if (buffer->buffer_private_data_valid_) {
     release_frame_buffer_(callback_private_data_, buffer->buffer_private_data_);
     buffer->buffer_private_data_valid_ = false;
   }
+  // The frame context may be shared with other frames. Do not keep it alive
+  // while the buffer is unused.
+  buffer->frame_context_ = nullptr;
+}
+
+void BufferPool::MarkBufferUnused(RefCountedBuffer* buffer) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  assert(buffer->in_use_);
+  buffer->in_use_ = false;
 }
 
 }  // namespace libgav1
@@ -19,12 +19,17 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>  // NOLINT (unapproved c++11 header)
 #include <climits>
 #include <condition_variable>  // NOLINT (unapproved c++11 header)
+#include <cstddef>
 #include <cstdint>
 #include <memory>
 #include <mutex>  // NOLINT (unapproved c++11 header)
+#include <thread>  // NOLINT (unapproved c++11 header)
+#include <utility>
 
 #include "src/dsp/common.h"
 #include "src/gav1/decoder_buffer.h"
@@ -54,9 +59,7 @@ enum FrameState : uint8_t {
 
 // A reference-counted frame buffer. Clients should access it via
 // RefCountedBufferPtr, which manages reference counting transparently.
-// The alignment requirement is due to the SymbolDecoderContext member
-// frame_context_.
-class RefCountedBuffer : public MaxAlignedAllocable {
+class RefCountedBuffer {
  public:
   // Not copyable or movable.
   RefCountedBuffer(const RefCountedBuffer&) = delete;
@@ -82,6 +85,13 @@ class RefCountedBuffer : public MaxAlignedAllocable {
                int subsampling_x, int subsampling_y, int left_border,
                int right_border, int top_border, int bottom_border);
 
+  // Allocates the YUV buffer with the same layout as |source| and copies into
+  // this buffer the pixels of |source|, including the borders, and all the
+  // state that is saved for a reference frame. |source| may belong to another
+  // BufferPool. The frame state is set to kFrameStateDecoded. Returns true on
+  // success, false on failure.
+  LIBGAV1_MUST_USE_RESULT bool CopyFrom(const RefCountedBuffer& source);
+
   YuvBuffer* buffer() { return &yuv_buffer_; }
 
   // Returns the buffer private data set by the get frame buffer callback when
@@ -115,7 +125,11 @@ class RefCountedBuffer : public MaxAlignedAllocable {
 
   // Sets upscaled_width_, frame_width_, frame_height_, render_width_,
   // render_height_, rows4x4_ and columns4x4_ from the corresponding fields
-  // in frame_header. Allocates reference_info_.motion_field_reference_frame,
+  // in frame_header.
+  void SetFrameSize(const ObuFrameHeader& frame_header);
+
+  // Calls SetFrameSize(). Allocates
+  // reference_info_.motion_field_reference_frame,
   // reference_info_.motion_field_mv_, and segmentation_map_. Returns true on
   // success, false on failure.
   bool SetFrameDimensions(const ObuFrameHeader& frame_header);
@@ -179,11 +193,19 @@ class RefCountedBuffer : public MaxAlignedAllocable {
       const std::array<GlobalMotion, kNumReferenceFrameTypes>& global_motions);
 
   // Returns the saved CDF tables.
-  const SymbolDecoderContext& FrameContext() const { return frame_context_; }
-  // Saves the CDF tables. The intra_frame_y_mode_cdf table is reset to the
-  // default. The last entry in each table, representing the symbol count for
-  // that context, is set to 0.
-  void SetFrameContext(const SymbolDecoderContext& context);
+  const SymbolDecoderContextSnapshot& FrameContext() const {
+    return frame_context_;
+  }
+  // Saves the CDF tables. |context| must not be shared yet. Its
+  // intra_frame_y_mode_cdf table is reset to the default. The last entry in
+  // each table, representing the symbol count for that context, is set to 0.
+  void SetFrameContext(SymbolDecoderContextSnapshot context);
+  // Saves the CDF tables of a frame that does not update them. |context| is
+  // shared, so it must already have been reset by SetFrameContext() or be a
+  // default context.
+  void ShareFrameContext(SymbolDecoderContextSnapshot context) {
+    frame_context_ = std::move(context);
+  }
 
   const std::array<int8_t, kNumReferenceFrameTypes>& loop_filter_ref_deltas()
       const {
@@ -219,43 +241,35 @@ class RefCountedBuffer : public MaxAlignedAllocable {
 
   // This will wake up the WaitUntil*() functions and make them return false.
   void Abort() {
-    {
-      std::lock_guard<std::mutex> lock(mutex_);
-      abort_ = true;
-    }
-    parsed_condvar_.notify_all();
-    decoded_condvar_.notify_all();
-    progress_row_condvar_.notify_all();
+    abort_.store(true);
+    NotifyWaiters(parsed_condvar_);
+    NotifyWaiters(decoded_condvar_);
+    NotifyWaiters(progress_row_condvar_);
   }
 
   void SetFrameState(FrameState frame_state) {
-    {
-      std::lock_guard<std::mutex> lock(mutex_);
-      frame_state_ = frame_state;
-    }
+    frame_state_.store(frame_state);
     if (frame_state == kFrameStateParsed) {
-      parsed_condvar_.notify_all();
+      NotifyWaiters(parsed_condvar_);
     } else if (frame_state == kFrameStateDecoded) {
-      decoded_condvar_.notify_all();
-      progress_row_condvar_.notify_all();
+      NotifyWaiters(decoded_condvar_);
+      NotifyWaiters(progress_row_condvar_);
     }
   }
 
   // Sets the progress of this frame to |progress_row| and notifies any threads
   // that may be waiting on rows <= |progress_row|.
   void SetProgress(int progress_row) {
-    {
-      std::lock_guard<std::mutex> lock(mutex_);
-      if (progress_row_ >= progress_row) return;
-      progress_row_ = progress_row;
-    }
-    progress_row_condvar_.notify_all();
+    int current = progress_row_.load();
+    do {
+      if (current >= progress_row) return;
+    } while (!progress_row_.compare_exchange_weak(current, progress_row));
+    NotifyWaiters(progress_row_condvar_);
   }
 
   void MarkFrameAsStarted() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (frame_state_ != kFrameStateUnknown) return;
-    frame_state_ = kFrameStateStarted;
+    FrameState expected = kFrameStateUnknown;
+    frame_state_.compare_exchange_strong(expected, kFrameStateStarted);
   }
 
   // All the WaitUntil* functions will return true if the desired wait state was
@@ -265,11 +279,10 @@ class RefCountedBuffer : public MaxAlignedAllocable {
 
   // Waits until the frame has been parsed.
   bool WaitUntilParsed() {
-    std::unique_lock<std::mutex> lock(mutex_);
-    while (frame_state_ < kFrameStateParsed && !abort_) {
-      parsed_condvar_.wait(lock);
-    }
-    return !abort_;
+    Wait(parsed_condvar_, [this]() {
+      return frame_state_.load() >= kFrameStateParsed || abort_.load();
+    });
+    return !abort_.load();
   }
 
   // Waits until the |progress_row| has been decoded (as indicated either by
@@ -280,51 +293,163 @@ class RefCountedBuffer : public MaxAlignedAllocable {
   // Typical usage of |progress_row_cache| is as follows:
   //  * Initialize |*progress_row_cache| to INT_MIN.
   //  * Call WaitUntil only if |*progress_row_cache| < |progress_row|.
-  bool WaitUntil(int progress_row, int* progress_row_cache) {
+  //
+  // If |wait_time_ns| is not nullptr, the time (in nanoseconds) that this
+  // function spends blocked on the condition variable is added to it.
+  bool WaitUntil(int progress_row, int* progress_row_cache,
+                 std::atomic<int64_t>* wait_time_ns = nullptr) {
     // If |progress_row| is negative, it means that the wait is on the top
     // border to be available. The top border will be available when row 0 has
     // been decoded. So we can simply wait on row 0 instead.
     progress_row = std::max(progress_row, 0);
-    std::unique_lock<std::mutex> lock(mutex_);
-    while (progress_row_ < progress_row && frame_state_ != kFrameStateDecoded &&
-           !abort_) {
-      progress_row_condvar_.wait(lock);
-    }
+    Wait(
+        progress_row_condvar_,
+        [this, progress_row]() {
+          return progress_row_.load() >= progress_row ||
+                 frame_state_.load() == kFrameStateDecoded || abort_.load();
+        },
+        wait_time_ns);
     // Once |frame_state_| reaches kFrameStateDecoded, |progress_row_| may no
     // longer be updated. So we set |*progress_row_cache| to INT_MAX in that
-    // case.
+    // case. |progress_row_| is read before |frame_state_| so that a frame that
+    // completes in between is reported as fully decoded.
+    const int row = progress_row_.load();
     *progress_row_cache =
-        (frame_state_ != kFrameStateDecoded) ? progress_row_ : INT_MAX;
-    return !abort_;
+        (frame_state_.load() != kFrameStateDecoded) ? row : INT_MAX;
+    return !abort_.load();
   }
 
   // Waits until the entire frame has been decoded.
   bool WaitUntilDecoded() {
-    std::unique_lock<std::mutex> lock(mutex_);
-    while (frame_state_ != kFrameStateDecoded && !abort_) {
-      decoded_condvar_.wait(lock);
-    }
-    return !abort_;
+    Wait(decoded_condvar_, [this]() {
+      return frame_state_.load() == kFrameStateDecoded || abort_.load();
+    });
+    return !abort_.load();
   }
 
  private:
   friend class BufferPool;
 
+  // The allocator of the std::shared_ptr control block of the
+  // RefCountedBufferPtr that holds the buffer. The control block is stored in
+  // |control_block_|, so that BufferPool::GetFreeBuffer() does not allocate.
+  // The buffer is only made available again when its control block is
+  // deallocated, since std::shared_ptr may access the control block until
+  // then.
+  template <typename T>
+  class ControlBlockAllocator {
+   public:
+    using value_type = T;
+
+    explicit ControlBlockAllocator(RefCountedBuffer* buffer)
+        : buffer_(buffer) {}
+    template <typename U>
+    ControlBlockAllocator(const ControlBlockAllocator<U>& other)  // NOLINT
+        : buffer_(other.buffer_) {}
+
+    T* allocate(size_t n) {
+      static_assert(sizeof(T) <= sizeof(RefCountedBuffer::control_block_),
+                    "The control block does not fit in control_block_.");
+      static_assert(alignof(T) <= alignof(std::max_align_t),
+                    "The control block is overaligned.");
+      assert(n == 1);
+      static_cast<void>(n);
+      return reinterpret_cast<T*>(buffer_->control_block_);
+    }
+    void deallocate(T* /*p*/, size_t /*n*/) {
+      RefCountedBuffer::ReleaseControlBlock(buffer_);
+    }
+
+    template <typename U>
+    bool operator==(const ControlBlockAllocator<U>& other) const {
+      return buffer_ == other.buffer_;
+    }
+    template <typename U>
+    bool operator!=(const ControlBlockAllocator<U>& other) const {
+      return buffer_ != other.buffer_;
+    }
+
+   private:
+    template <typename U>
+    friend class ControlBlockAllocator;
+
+    RefCountedBuffer* buffer_;
+  };
+
   // Methods for BufferPool:
   RefCountedBuffer();
   ~RefCountedBuffer();
   void SetBufferPool(BufferPool* pool);
   static void ReturnToBufferPool(RefCountedBuffer* ptr);
+  static void ReleaseControlBlock(RefCountedBuffer* ptr);
 
   BufferPool* pool_ = nullptr;
+  // The storage of the std::shared_ptr control block. See
+  // ControlBlockAllocator.
+  alignas(std::max_align_t) uint8_t control_block_[64];
   bool buffer_private_data_valid_ = false;
   void* buffer_private_data_ = nullptr;
   YuvBuffer yuv_buffer_;
   bool in_use_ = false;  // Only used by BufferPool.
 
+  // Number of times Wait() polls its condition before blocking on a condition
+  // variable. Most waits in frame parallel mode are for a reference frame that
+  // is only a few superblock rows ahead, so a short spin avoids the cost of
+  // sleeping and being woken up.
+  static constexpr int kSpinCount = 64;
+
+  // Polls |condition| up to kSpinCount times and then blocks on |condvar|
+  // until |condition| becomes true. If |wait_time_ns| is not nullptr, the time
+  // spent blocked is added to it. The clock is only read once spinning has
+  // failed.
+  template <typename Condition>
+  void Wait(std::condition_variable& condvar, Condition condition,
+            std::atomic<int64_t>* wait_time_ns = nullptr) {
+    for (int i = 0; i < kSpinCount; ++i) {
+      if (condition()) return;
+      std::this_thread::yield();
+    }
+    const std::chrono::steady_clock::time_point start =
+        (wait_time_ns != nullptr) ? std::chrono::steady_clock::now()
+                                  : std::chrono::steady_clock::time_point();
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ++num_waiters_;
+      while (!condition()) {
+        condvar.wait(lock);
+      }
+      --num_waiters_;
+    }
+    if (wait_time_ns != nullptr) {
+      *wait_time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+    }
+  }
+
+  // Wakes up the threads blocked on |condvar| in Wait(). The state change that
+  // is being signaled must have been stored before calling this function. All
+  // the atomics below use sequentially consistent ordering, so either a
+  // blocking thread observes the new state when it checks its condition (with
+  // |mutex_| held), or this function observes a non-zero |num_waiters_|. In the
+  // latter case, acquiring |mutex_| ensures that the waiter is inside
+  // condvar.wait() before the notification is sent.
+  void NotifyWaiters(std::condition_variable& condvar) {
+    if (num_waiters_.load() == 0) return;
+    { std::lock_guard<std::mutex> lock(mutex_); }
+    condvar.notify_all();
+  }
+
+  // The frame state, progress and abort flag are updated and polled without
+  // holding |mutex_|. |mutex_| is only used to block on the condition
+  // variables once spinning in Wait() has failed.
   std::mutex mutex_;
-  FrameState frame_state_ = kFrameStateUnknown LIBGAV1_GUARDED_BY(mutex_);
-  int progress_row_ = -1 LIBGAV1_GUARDED_BY(mutex_);
+  std::atomic<FrameState> frame_state_{kFrameStateUnknown};
+  std::atomic<int> progress_row_{-1};
+  std::atomic<bool> abort_{false};
+  // Number of threads that are blocked (or about to block) on one of the
+  // condition variables below.
+  std::atomic<int> num_waiters_{0};
   // Signaled when progress_row_ is updated or when frame_state_ is set to
   // kFrameStateDecoded.
   std::condition_variable progress_row_condvar_;
@@ -332,7 +457,6 @@ class RefCountedBuffer : public MaxAlignedAllocable {
   std::condition_variable parsed_condvar_;
   // Signaled when the frame state is set to kFrameStateDecoded.
   std::condition_variable decoded_condvar_;
-  bool abort_ = false LIBGAV1_GUARDED_BY(mutex_);
 
   FrameType frame_type_ = kFrameKey;
   ChromaSamplePosition chroma_sample_position_ = kChromaSamplePositionUnknown;
@@ -362,7 +486,7 @@ class RefCountedBuffer : public MaxAlignedAllocable {
   // Only the |params| field of each GlobalMotion struct is used.
   // global_motion_[0] (for kReferenceFrameIntra) is not used.
   std::array<GlobalMotion, kNumReferenceFrameTypes> global_motion_ = {};
-  SymbolDecoderContext frame_context_;
+  SymbolDecoderContextSnapshot frame_context_;
   std::array<int8_t, kNumReferenceFrameTypes> loop_filter_ref_deltas_;
   std::array<int8_t, kLoopFilterMaxModeDeltas> loop_filter_mode_deltas_;
   // Only the feature_enabled, feature_data, segment_id_pre_skip, and
@@ -379,10 +503,10 @@ class RefCountedBuffer : public MaxAlignedAllocable {
 // RefCountedBufferPtr contains a reference to a RefCountedBuffer.
 //
 // Note: For simplicity, RefCountedBufferPtr is implemented as a
-// std::shared_ptr<RefCountedBuffer>. This requires a heap allocation of the
-// control block for std::shared_ptr. To avoid that heap allocation, we can
-// add a |ref_count_| field to RefCountedBuffer and implement a custom
-// RefCountedBufferPtr class.
+// std::shared_ptr<RefCountedBuffer>. The control block of the std::shared_ptr
+// is stored in the RefCountedBuffer (see
+// RefCountedBuffer::ControlBlockAllocator), so it does not require a heap
+// allocation.
 using RefCountedBufferPtr = std::shared_ptr<RefCountedBuffer>;
 
 // BufferPool maintains a pool of RefCountedBuffers.
@@ -411,12 +535,22 @@ class BufferPool {
   // Aborts all the buffers that are in use.
   void Abort();
 
+  // The storage of the frame contexts of the buffers. It is destroyed after
+  // the buffers.
+  SymbolDecoderContextPool* frame_context_pool() {
+    return &frame_context_pool_;
+  }
+
  private:
   friend class RefCountedBuffer;
 
   // Returns an unused buffer to the buffer pool. Called by RefCountedBuffer
   // only. This function is thread safe.
   void ReturnUnusedBuffer(RefCountedBuffer* buffer);
+  // Makes an unused buffer available to GetFreeBuffer() once its control block
+  // has been deallocated. Called by RefCountedBuffer only. This function is
+  // thread safe.
+  void MarkBufferUnused(RefCountedBuffer* buffer);
 
   // Used to make the following functions thread safe: GetFreeBuffer(),
   // ReturnUnusedBuffer(), RefCountedBuffer::Realloc().
@@ -434,6 +568,8 @@ class BufferPool {
   ReleaseFrameBufferCallback release_frame_buffer_;
   // Private data associated with the frame buffer callbacks.
   void* callback_private_data_;
+
+  SymbolDecoderContextPool frame_context_pool_;
 };
 
 }  // namespace libgav1
@@ -14,18 +14,25 @@
 
 #include "src/buffer_pool.h"
 
+#include <atomic>
 #include <climits>
 #include <cstdint>
+#include <cstdio>
 #include <memory>
 #include <ostream>
+#include <thread>  // NOLINT (unapproved c++11 header)
 #include <tuple>
 #include <utility>
+#include <vector>
 
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "gtest/gtest.h"
 #include "src/frame_buffer_utils.h"
 #include "src/gav1/decoder_buffer.h"
 #include "src/gav1/frame_buffer.h"
 #include "src/internal_frame_buffer_list.h"
+#include "src/symbol_decoder_context.h"
 #include "src/utils/constants.h"
 #include "src/utils/types.h"
 #include "src/yuv_buffer.h"
@@ -82,6 +89,51 @@ TEST(RefCountedBufferTest, SetFrameDimensions) {
   EXPECT_EQ(buffer_ptr->columns4x4(), 30);
 }
 
+TEST(RefCountedBufferTest, FrameContext) {
+  InternalFrameBufferList buffer_list;
+  BufferPool buffer_pool(OnInternalFrameBufferSizeChanged,
+                         GetInternalFrameBuffer, ReleaseInternalFrameBuffer,
+                         &buffer_list);
+  RefCountedBufferPtr buffer_ptr = buffer_pool.GetFreeBuffer();
+  ASSERT_NE(buffer_ptr, nullptr);
+  EXPECT_EQ(buffer_ptr->FrameContext(), nullptr);
+
+  // SetFrameContext() resets the counters and the intra frame y mode cdf.
+  SymbolDecoderContextSnapshot context =
+      buffer_pool.frame_context_pool()->Get();
+  ASSERT_NE(context, nullptr);
+  EXPECT_EQ(context.use_count(), 1);
+  const SymbolDecoderContext default_context(0);
+  context.Mutable()->Initialize(0);
+  context.Mutable()->skip_cdf[0][kBooleanFieldCdfSize - 1] = 5;
+  context.Mutable()->intra_frame_y_mode_cdf[0][0][0] = 1;
+  const SymbolDecoderContext* const context_address = context.get();
+  buffer_ptr->SetFrameContext(std::move(context));
+  ASSERT_EQ(buffer_ptr->FrameContext().get(), context_address);
+  EXPECT_EQ(buffer_ptr->FrameContext()->skip_cdf[0][kBooleanFieldCdfSize - 1],
+            0);
+  EXPECT_EQ(buffer_ptr->FrameContext()->intra_frame_y_mode_cdf[0][0][0],
+            default_context.intra_frame_y_mode_cdf[0][0][0]);
+
+  // A frame that does not update the context shares it.
+  RefCountedBufferPtr buffer_ptr2 = buffer_pool.GetFreeBuffer();
+  ASSERT_NE(buffer_ptr2, nullptr);
+  buffer_ptr2->ShareFrameContext(buffer_ptr->FrameContext());
+  EXPECT_EQ(buffer_ptr2->FrameContext().get(), context_address);
+  EXPECT_EQ(buffer_ptr->FrameContext().use_count(), 2);
+
+  // An unused buffer drops its reference.
+  buffer_ptr = nullptr;
+  EXPECT_EQ(buffer_ptr2->FrameContext().use_count(), 1);
+
+  // The storage of the last reference is reused by the next frame context.
+  buffer_ptr2 = nullptr;
+  context = buffer_pool.frame_context_pool()->Get();
+  ASSERT_NE(context, nullptr);
+  EXPECT_EQ(context.get(), context_address);
+  EXPECT_EQ(context.use_count(), 1);
+}
+
 TEST(RefCountedBuffertTest, WaitUntil) {
   InternalFrameBufferList buffer_list;
   BufferPool buffer_pool(OnInternalFrameBufferSizeChanged,
@@ -103,6 +155,76 @@ TEST(RefCountedBuffertTest, WaitUntil) {
   EXPECT_FALSE(buffer_ptr->WaitUntil(50, &progress_row_cache));
 }
 
+// Returns the number of frames per second decoded by a simulated frame
+// parallel decoder with |num_threads| workers. Every frame references the
+// previous frame (as in a short GOP of P frames) and each of its |num_rows|
+// superblock rows waits for the co-located row of the reference frame plus a
+// motion vector margin of |lag_rows| before publishing its own progress. Each
+// row does |work_per_row| iterations of dummy work.
+double MeasureFrameParallelThroughput(int num_threads, int num_frames,
+                                      int num_rows, int lag_rows,
+                                      int work_per_row) {
+  InternalFrameBufferList buffer_list;
+  BufferPool buffer_pool(OnInternalFrameBufferSizeChanged,
+                         GetInternalFrameBuffer, ReleaseInternalFrameBuffer,
+                         &buffer_list);
+  std::vector<RefCountedBufferPtr> frames(num_frames);
+  for (auto& frame : frames) {
+    frame = buffer_pool.GetFreeBuffer();
+    if (frame == nullptr) return 0;
+  }
+  std::atomic<int> next_frame(0);
+  std::atomic<uint32_t> sink(0);
+  const auto worker = [&]() {
+    int frame_index;
+    while ((frame_index = next_frame.fetch_add(1)) < num_frames) {
+      RefCountedBuffer* const frame = frames[frame_index].get();
+      RefCountedBuffer* const reference =
+          (frame_index == 0) ? nullptr : frames[frame_index - 1].get();
+      frame->MarkFrameAsStarted();
+      frame->SetFrameState(kFrameStateParsed);
+      int progress_row_cache = INT_MIN;
+      uint32_t value = frame_index;
+      for (int row = 0; row < num_rows; ++row) {
+        const int reference_row = row + lag_rows;
+        if (reference != nullptr && progress_row_cache < reference_row &&
+            !reference->WaitUntil(reference_row, &progress_row_cache)) {
+          return;
+        }
+        for (int i = 0; i < work_per_row; ++i) {
+          value = value * 1664525u + 1013904223u;
+        }
+        frame->SetProgress(row);
+      }
+      sink += value;
+      frame->SetFrameState(kFrameStateDecoded);
+    }
+  };
+  const absl::Time start = absl::Now();
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i) threads.emplace_back(worker);
+  for (auto& thread : threads) thread.join();
+  const double seconds = absl::ToDoubleSeconds(absl::Now() - start);
+  EXPECT_NE(sink.load(), 0u);
+  return num_frames / seconds;
+}
+
+TEST(RefCountedBufferTest, DISABLED_FrameParallelSpeed) {
+  // Roughly 1080p with 64x64 superblocks.
+  constexpr int kNumFrames = 2000;
+  constexpr int kNumRows = 17;
+  constexpr int kLagRows = 2;
+  for (const int work_per_row : {0, 2000, 20000}) {
+    for (const int num_threads : {8, 16, 32}) {
+      const double throughput = MeasureFrameParallelThroughput(
+          num_threads, kNumFrames, kNumRows, kLagRows, work_per_row);
+      printf("threads: %2d work per row: %5d frames/s: %10.0f\n", num_threads,
+             work_per_row, throughput);
+    }
+  }
+}
+
 constexpr struct Params {
   int width;
   int height;
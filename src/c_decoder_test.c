@@ -467,6 +467,57 @@ static void DecoderTestMetadataObu(void) {
   Libgav1DecoderDestroy(test.decoder);
 }
 
+static void DecoderTestCheckpoint(void) {
+  DecoderTest test;
+  DecoderTestInit(&test);
+  DecoderTestSetUp(&test);
+
+  Libgav1StatusCode status;
+  const Libgav1DecoderBuffer* buffer;
+  Libgav1DecoderCheckpoint* checkpoint = NULL;
+
+  status = Libgav1DecoderCheckpointCreate(&checkpoint);
+  ASSERT_EQ(status, kLibgav1StatusOk);
+  ASSERT_NE(checkpoint, NULL);
+
+  // Nothing has been saved in the checkpoint yet.
+  status = Libgav1DecoderRestoreCheckpoint(test.decoder, checkpoint);
+  ASSERT_EQ(status, kLibgav1StatusInvalidArgument);
+
+  // Decode frame1 and save the state after it.
+  status = Libgav1DecoderEnqueueFrame(test.decoder, kFrame1, sizeof(kFrame1), 0,
+                                      (uint8_t*)&kFrame1);
+  ASSERT_EQ(status, kLibgav1StatusOk);
+  status = Libgav1DecoderDequeueFrame(test.decoder, &buffer);
+  ASSERT_EQ(status, kLibgav1StatusOk);
+  ASSERT_NE(buffer, NULL);
+  status = Libgav1DecoderSaveCheckpoint(test.decoder, checkpoint);
+  ASSERT_EQ(status, kLibgav1StatusOk);
+
+  // The checkpoint holds its own copy of frame1.
+  ASSERT_EQ(test.frames_in_use, 1);
+  status = Libgav1DecoderSignalEOS(test.decoder);
+  ASSERT_EQ(status, kLibgav1StatusOk);
+  ASSERT_EQ(test.frames_in_use, 0);
+
+  // After restoring the checkpoint, frame2 can be decoded without frame1.
+  status = Libgav1DecoderRestoreCheckpoint(test.decoder, checkpoint);
+  ASSERT_EQ(status, kLibgav1StatusOk);
+  ASSERT_EQ(test.frames_in_use, 1);
+  status = Libgav1DecoderEnqueueFrame(test.decoder, kFrame2, sizeof(kFrame2), 0,
+                                      (uint8_t*)&kFrame2);
+  ASSERT_EQ(status, kLibgav1StatusOk);
+  status = Libgav1DecoderDequeueFrame(test.decoder, &buffer);
+  ASSERT_EQ(status, kLibgav1StatusOk);
+  ASSERT_NE(buffer, NULL);
+  ASSERT_EQ(test.released_input_buffer, &kFrame2);
+
+  Libgav1DecoderDestroy(test.decoder);
+  test.decoder = NULL;
+  ASSERT_EQ(test.frames_in_use, 0);
+  Libgav1DecoderCheckpointDestroy(checkpoint);
+}
+
 int main(void) {
   fprintf(stderr, "C DecoderTest started\n");
   DecoderTestAPIFlowForNonFrameParallelMode();
@@ -474,6 +525,7 @@ int main(void) {
   DecoderTestNonFrameParallelModeEOSBeforeDequeuingLastFrame();
   DecoderTestNonFrameParallelModeInvalidFrameAfterEOS();
   DecoderTestMetadataObu();
+  DecoderTestCheckpoint();
   fprintf(stderr, "C DecoderTest passed\n");
   return 0;
 }
@@ -42,6 +42,10 @@ Libgav1StatusCode Libgav1DecoderCreate(const Libgav1DecoderSettings* settings,
   cxx_settings.operating_point = settings->operating_point;
   cxx_settings.post_filter_mask = settings->post_filter_mask;
   cxx_settings.parse_only = settings->parse_only != 0;
+  cxx_settings.schedule_job = settings->schedule_job;
+  cxx_settings.executor_private_data = settings->executor_private_data;
+  cxx_settings.frame_stats_callback = settings->frame_stats_callback;
+  cxx_settings.frame_stats_private_data = settings->frame_stats_private_data;
 
   const Libgav1StatusCode status = cxx_decoder->Init(&cxx_settings);
   if (status == kLibgav1StatusOk) {
@@ -79,10 +83,44 @@ int Libgav1DecoderGetMaxBitdepth() {
   return libgav1::Decoder::GetMaxBitdepth();
 }
 
+Libgav1StatusCode Libgav1DecoderCheckpointCreate(
+    Libgav1DecoderCheckpoint** checkpoint_out) {
+  auto* cxx_checkpoint = new (std::nothrow) libgav1::DecoderCheckpoint();
+  if (cxx_checkpoint == nullptr) return kLibgav1StatusOutOfMemory;
+  *checkpoint_out = reinterpret_cast<Libgav1DecoderCheckpoint*>(cxx_checkpoint);
+  return kLibgav1StatusOk;
+}
+
+void Libgav1DecoderCheckpointDestroy(Libgav1DecoderCheckpoint* checkpoint) {
+  auto* cxx_checkpoint =
+      reinterpret_cast<libgav1::DecoderCheckpoint*>(checkpoint);
+  delete cxx_checkpoint;
+}
+
+Libgav1StatusCode Libgav1DecoderSaveCheckpoint(
+    Libgav1Decoder* decoder, Libgav1DecoderCheckpoint* checkpoint) {
+  auto* cxx_decoder = reinterpret_cast<libgav1::Decoder*>(decoder);
+  auto* cxx_checkpoint =
+      reinterpret_cast<libgav1::DecoderCheckpoint*>(checkpoint);
+  return cxx_decoder->SaveCheckpoint(cxx_checkpoint);
+}
+
+Libgav1StatusCode Libgav1DecoderRestoreCheckpoint(
+    Libgav1Decoder* decoder, const Libgav1DecoderCheckpoint* checkpoint) {
+  auto* cxx_decoder = reinterpret_cast<libgav1::Decoder*>(decoder);
+  const auto* cxx_checkpoint =
+      reinterpret_cast<const libgav1::DecoderCheckpoint*>(checkpoint);
+  return cxx_decoder->RestoreCheckpoint(*cxx_checkpoint);
+}
+
 }  // extern "C"
 
 namespace libgav1 {
 
+DecoderCheckpoint::DecoderCheckpoint() = default;
+
+DecoderCheckpoint::~DecoderCheckpoint() = default;
+
 Decoder::Decoder() = default;
 
 Decoder::~Decoder() = default;
@@ -119,6 +157,30 @@ StatusCode Decoder::SignalEOS() {
   return DecoderImpl::Create(&settings_, &impl_);
 }
 
+StatusCode Decoder::SaveCheckpoint(DecoderCheckpoint* const checkpoint) {
+  if (impl_ == nullptr) return kStatusNotInitialized;
+  if (checkpoint == nullptr) return kStatusInvalidArgument;
+  if (checkpoint->impl_ == nullptr) {
+    checkpoint->impl_.reset(new (std::nothrow) DecoderCheckpointImpl());
+    if (checkpoint->impl_ == nullptr) return kStatusOutOfMemory;
+  }
+  return impl_->SaveCheckpoint(checkpoint->impl_.get());
+}
+
+StatusCode Decoder::RestoreCheckpoint(const DecoderCheckpoint& checkpoint) {
+  if (impl_ == nullptr) return kStatusNotInitialized;
+  if (checkpoint.impl_ == nullptr || !checkpoint.impl_->valid()) {
+    return kStatusInvalidArgument;
+  }
+  // As in SignalEOS(), replace |impl_| with a new instance to release the
+  // frames and clear the state.
+  impl_ = nullptr;
+  frame_mean_qps_.clear();
+  StatusCode status = DecoderImpl::Create(&settings_, &impl_);
+  if (status != kStatusOk) return status;
+  return impl_->RestoreCheckpoint(*checkpoint.impl_);
+}
+
 // static.
 int Decoder::GetMaxBitdepth() { return DecoderImpl::GetMaxBitdepth(); }
 
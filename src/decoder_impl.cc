@@ -17,7 +17,9 @@
 #include <algorithm>
 #include <atomic>
 #include <cassert>
+#include <chrono>  // NOLINT (unapproved c++11 header)
 #include <cmath>
+#include <cstdint>
 #include <iterator>
 #include <new>
 #include <utility>
@@ -29,10 +31,13 @@
 #include "src/film_grain.h"
 #include "src/frame_buffer_utils.h"
 #include "src/frame_scratch_buffer.h"
+#include "src/frame_stats_collector.h"
+#include "src/gav1/frame_stats.h"
 #include "src/loop_restoration_info.h"
 #include "src/obu_parser.h"
 #include "src/post_filter.h"
 #include "src/prediction_mask.h"
+#include "src/quantizer.h"
 #include "src/threading_strategy.h"
 #include "src/utils/blocking_counter.h"
 #include "src/utils/common.h"
@@ -97,6 +102,10 @@ class FrameScratchBufferReleaser {
       : frame_scratch_buffer_pool_(frame_scratch_buffer_pool),
         frame_scratch_buffer_(frame_scratch_buffer) {}
   ~FrameScratchBufferReleaser() {
+    // The frame context belongs to the buffer pool of the decoder, which may
+    // be destroyed before |frame_scratch_buffer_pool_|. It is only set while a
+    // frame is decoded, and not cleared yet if the frame failed.
+    (*frame_scratch_buffer_)->frame_context = nullptr;
     frame_scratch_buffer_pool_->Release(std::move(*frame_scratch_buffer_));
   }
 
@@ -105,6 +114,57 @@ class FrameScratchBufferReleaser {
   std::unique_ptr<FrameScratchBuffer>* const frame_scratch_buffer_;
 };
 
+// Helper class that destroys the tiles of a frame, which are constructed in
+// place by Tile::Create(), in the destructor.
+class TileDestroyer {
+ public:
+  explicit TileDestroyer(Vector<Tile*>* tiles) : tiles_(*tiles) {}
+  ~TileDestroyer() {
+    for (Tile* const tile : tiles_) {
+      tile->~Tile();
+    }
+    tiles_.clear();
+  }
+
+ private:
+  Vector<Tile*>& tiles_;
+};
+
+// Helper class that acquires the worker threads of a frame from the
+// FrameParallelThreadBalancer in the constructor and releases them, along with
+// the stall times of the frame, in the destructor.
+class FrameWorkerThreads {
+ public:
+  FrameWorkerThreads(FrameParallelThreadBalancer* balancer,
+                     const ObuFrameHeader& frame_header,
+                     FrameScratchBuffer* frame_scratch_buffer)
+      : balancer_(balancer),
+        frame_scratch_buffer_(frame_scratch_buffer),
+        num_workers_(balancer->AcquireWorkers(frame_header)),
+        start_(std::chrono::steady_clock::now()) {
+    frame_scratch_buffer->reference_wait_time_ns = 0;
+    frame_scratch_buffer->row_wait_time_ns = 0;
+  }
+  ~FrameWorkerThreads() {
+    const int64_t decode_time_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_)
+            .count();
+    balancer_->ReleaseWorkers(
+        num_workers_, decode_time_ns,
+        frame_scratch_buffer_->reference_wait_time_ns.load(),
+        frame_scratch_buffer_->row_wait_time_ns);
+  }
+
+  int num_workers() const { return num_workers_; }
+
+ private:
+  FrameParallelThreadBalancer* const balancer_;
+  FrameScratchBuffer* const frame_scratch_buffer_;
+  const int num_workers_;
+  const std::chrono::steady_clock::time_point start_;
+};
+
 // Sets the |frame|'s segmentation map for two cases. The third case is handled
 // in Tile::DecodeBlock().
 void SetSegmentationMap(const ObuFrameHeader& frame_header,
@@ -128,7 +188,7 @@ void SetSegmentationMap(const ObuFrameHeader& frame_header,
 StatusCode DecodeTilesNonFrameParallel(
     const ObuSequenceHeader& sequence_header,
     const ObuFrameHeader& frame_header,
-    const Vector<std::unique_ptr<Tile>>& tiles,
+    const Vector<Tile*>& tiles,
     FrameScratchBuffer* const frame_scratch_buffer,
     PostFilter* const post_filter) {
   // Decode in superblock row order.
@@ -154,7 +214,8 @@ StatusCode DecodeTilesNonFrameParallel(
 }
 
 StatusCode DecodeTilesThreadedNonFrameParallel(
-    const Vector<std::unique_ptr<Tile>>& tiles,
+    const ObuSequenceHeader& sequence_header,
+    const Vector<Tile*>& tiles,
     FrameScratchBuffer* const frame_scratch_buffer,
     PostFilter* const post_filter,
     BlockingCounterWithStatus* const pending_tiles) {
@@ -165,6 +226,13 @@ StatusCode DecodeTilesThreadedNonFrameParallel(
   std::atomic<int> tile_counter(0);
   const int tile_count = static_cast<int>(tiles.size());
   bool tile_decoding_failed = false;
+  // The post filters are applied to the decoded superblock rows while the rest
+  // of the frame is still being decoded.
+  const int block_width4x4 = sequence_header.use_128x128_superblock ? 32 : 16;
+  if (!post_filter->EnableFilterPipelining(block_width4x4)) {
+    LIBGAV1_DLOG(ERROR, "Failed to enable filter pipelining.");
+    return kStatusOutOfMemory;
+  }
   // Submit tile decoding jobs to the thread pool.
   for (int i = 0; i < num_workers; ++i) {
     threading_strategy.tile_thread_pool()->Schedule([&tiles, tile_count,
@@ -202,18 +270,43 @@ StatusCode DecodeTilesThreadedNonFrameParallel(
       pending_tiles->Decrement(false);
     }
   }
-  // Wait until all the workers are done. This ensures that all the tiles have
-  // been parsed.
-  tile_decoding_failed |= !pending_workers.Wait();
-  // Wait until all the tiles have been decoded.
-  tile_decoding_failed |= !pending_tiles->Wait();
-  if (tile_decoding_failed) return kStatusUnknownError;
+  {
+    ScopedFrameStageTimer timer(&frame_scratch_buffer->frame_stats,
+                                kFrameStageThreadStall);
+    // Wait until all the workers are done. This ensures that all the tiles
+    // have been parsed.
+    tile_decoding_failed |= !pending_workers.Wait();
+    // Wait until all the tiles have been decoded.
+    tile_decoding_failed |= !pending_tiles->Wait();
+  }
+  if (tile_decoding_failed) {
+    post_filter->StopFilterPipelining();
+    return kStatusUnknownError;
+  }
   assert(threading_strategy.post_filter_thread_pool() != nullptr);
   post_filter->ApplyFilteringThreaded();
   return kStatusOk;
 }
 
-StatusCode ParseTiles(const Vector<std::unique_ptr<Tile>>& tiles) {
+// Saves the CDF tables of |current_frame| once its tiles have been parsed. If
+// the frame updates them, |saved_symbol_decoder_context| holds the tables of
+// the context update tile and becomes the frame context. Otherwise the frame
+// shares the context it started with, without copying it.
+void SetFrameContext(
+    const ObuFrameHeader& frame_header,
+    SymbolDecoderContextSnapshot saved_symbol_decoder_context,
+    FrameScratchBuffer* const frame_scratch_buffer,
+    RefCountedBuffer* const current_frame) {
+  if (frame_header.enable_frame_end_update_cdf) {
+    current_frame->SetFrameContext(std::move(saved_symbol_decoder_context));
+  } else {
+    current_frame->ShareFrameContext(
+        std::move(frame_scratch_buffer->frame_context));
+  }
+  frame_scratch_buffer->frame_context = nullptr;
+}
+
+StatusCode ParseTiles(const Vector<Tile*>& tiles) {
   for (const auto& tile : tiles) {
     if (!tile->Parse()) {
       LIBGAV1_DLOG(ERROR, "Failed to parse tile number: %d\n", tile->number());
@@ -226,18 +319,16 @@ StatusCode ParseTiles(const Vector<std::unique_ptr<Tile>>& tiles) {
 StatusCode DecodeTilesFrameParallel(
     const ObuSequenceHeader& sequence_header,
     const ObuFrameHeader& frame_header,
-    const Vector<std::unique_ptr<Tile>>& tiles,
-    const SymbolDecoderContext& saved_symbol_decoder_context,
+    const Vector<Tile*>& tiles,
+    SymbolDecoderContextSnapshot saved_symbol_decoder_context,
     const SegmentationMap* const prev_segment_ids,
     FrameScratchBuffer* const frame_scratch_buffer,
     PostFilter* const post_filter, RefCountedBuffer* const current_frame) {
   // Parse the frame.
   StatusCode status = ParseTiles(tiles);
   if (status != kStatusOk) return status;
-  if (frame_header.enable_frame_end_update_cdf) {
-    frame_scratch_buffer->symbol_decoder_context = saved_symbol_decoder_context;
-  }
-  current_frame->SetFrameContext(frame_scratch_buffer->symbol_decoder_context);
+  SetFrameContext(frame_header, std::move(saved_symbol_decoder_context),
+                  frame_scratch_buffer, current_frame);
   SetSegmentationMap(frame_header, prev_segment_ids, current_frame);
   // Mark frame as parsed.
   current_frame->SetFrameState(kFrameStateParsed);
@@ -277,7 +368,7 @@ StatusCode DecodeTilesFrameParallel(
 // Helper function used by DecodeTilesThreadedFrameParallel. Applies the
 // deblocking filter for tile boundaries for the superblock row at |row4x4|.
 void ApplyDeblockingFilterForTileBoundaries(
-    PostFilter* const post_filter, const std::unique_ptr<Tile>* tile_row_base,
+    PostFilter* const post_filter, Tile* const* tile_row_base,
     const ObuFrameHeader& frame_header, int row4x4, int block_width4x4,
     int tile_columns, bool decode_entire_tiles_in_worker_threads) {
   // Apply vertical deblock filtering for the first 64 columns of each tile.
@@ -345,7 +436,7 @@ void ApplyDeblockingFilterForTileBoundaries(
 //   * If an entire superblock row of the frame has been decoded, it notifies
 //     the waiters (if there are any).
 void DecodeSuperBlockRowInTile(
-    const Vector<std::unique_ptr<Tile>>& tiles, size_t tile_index, int row4x4,
+    const Vector<Tile*>& tiles, size_t tile_index, int row4x4,
     const int superblock_size4x4, const int tile_columns,
     const int superblock_rows, FrameScratchBuffer* const frame_scratch_buffer,
     PostFilter* const post_filter, BlockingCounter* const pending_jobs) {
@@ -421,8 +512,8 @@ void DecodeSuperBlockRowInTile(
 StatusCode DecodeTilesThreadedFrameParallel(
     const ObuSequenceHeader& sequence_header,
     const ObuFrameHeader& frame_header,
-    const Vector<std::unique_ptr<Tile>>& tiles,
-    const SymbolDecoderContext& saved_symbol_decoder_context,
+    const Vector<Tile*>& tiles,
+    SymbolDecoderContextSnapshot saved_symbol_decoder_context,
     const SegmentationMap* const prev_segment_ids,
     FrameScratchBuffer* const frame_scratch_buffer,
     PostFilter* const post_filter, RefCountedBuffer* const current_frame) {
@@ -468,13 +559,17 @@ StatusCode DecodeTilesThreadedFrameParallel(
 
   // Wait until all the parse workers are done. This ensures that all the tiles
   // have been parsed.
-  if (!parse_workers.Wait() || failed) {
-    return kLibgav1StatusUnknownError;
+  bool parse_failed;
+  {
+    ScopedFrameStageTimer timer(&frame_scratch_buffer->frame_stats,
+                                kFrameStageThreadStall);
+    parse_failed = !parse_workers.Wait();
   }
-  if (frame_header.enable_frame_end_update_cdf) {
-    frame_scratch_buffer->symbol_decoder_context = saved_symbol_decoder_context;
+  if (parse_failed || failed) {
+    return kLibgav1StatusUnknownError;
   }
-  current_frame->SetFrameContext(frame_scratch_buffer->symbol_decoder_context);
+  SetFrameContext(frame_header, std::move(saved_symbol_decoder_context),
+                  frame_scratch_buffer, current_frame);
   SetSegmentationMap(frame_header, prev_segment_ids, current_frame);
   current_frame->SetFrameState(kFrameStateParsed);
 
@@ -541,7 +636,7 @@ StatusCode DecodeTilesThreadedFrameParallel(
   // Current thread will do the post filters.
   std::condition_variable* const superblock_row_progress_condvar =
       frame_scratch_buffer->superblock_row_progress_condvar.get();
-  const std::unique_ptr<Tile>* tile_row_base = &tiles[0];
+  Tile* const* tile_row_base = &tiles[0];
   for (int row4x4 = 0, index = 0; row4x4 < frame_header.rows4x4;
        row4x4 += block_width4x4, ++index) {
     if (!tile_row_base[0]->IsRow4x4Inside(row4x4)) {
@@ -550,9 +645,17 @@ StatusCode DecodeTilesThreadedFrameParallel(
     {
       std::unique_lock<std::mutex> lock(
           frame_scratch_buffer->superblock_row_mutex);
-      while (superblock_row_progress[index] != tile_columns &&
-             !frame_scratch_buffer->tile_decoding_failed) {
-        superblock_row_progress_condvar[index].wait(lock);
+      if (superblock_row_progress[index] != tile_columns &&
+          !frame_scratch_buffer->tile_decoding_failed) {
+        const auto start = std::chrono::steady_clock::now();
+        do {
+          superblock_row_progress_condvar[index].wait(lock);
+        } while (superblock_row_progress[index] != tile_columns &&
+                 !frame_scratch_buffer->tile_decoding_failed);
+        frame_scratch_buffer->row_wait_time_ns +=
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count();
       }
       if (frame_scratch_buffer->tile_decoding_failed) break;
     }
@@ -575,7 +678,11 @@ StatusCode DecodeTilesThreadedFrameParallel(
   }
   // Wait until all the pending jobs are done. This ensures that all the tiles
   // have been decoded and wrapped up.
-  pending_jobs.Wait();
+  {
+    ScopedFrameStageTimer timer(&frame_scratch_buffer->frame_stats,
+                                kFrameStageThreadStall);
+    pending_jobs.Wait();
+  }
   {
     std::lock_guard<std::mutex> lock(
         frame_scratch_buffer->superblock_row_mutex);
@@ -588,7 +695,7 @@ StatusCode DecodeTilesThreadedFrameParallel(
   return kStatusOk;
 }
 
-int CalcFrameMeanQp(const Vector<std::unique_ptr<Tile>>& tiles) {
+int CalcFrameMeanQp(const Vector<Tile*>& tiles) {
   int cumulative_frame_qp = 0;
   for (const auto& tile : tiles) {
     cumulative_frame_qp += tile->GetTileMeanQP();
@@ -604,11 +711,72 @@ int CalcFrameMeanQp(const Vector<std::unique_ptr<Tile>>& tiles) {
   return frame_mean_qp;
 }
 
+// Fills in |stats| for a frame whose stages were timed by |collector|.
+void GetFrameStats(const ObuFrameHeader& frame_header,
+                   int64_t user_private_data,
+                   const FrameStatsCollector& collector,
+                   FrameStats* const stats) {
+  stats->user_private_data = user_private_data;
+  stats->width = frame_header.upscaled_width;
+  stats->height = frame_header.height;
+  stats->frame_type = frame_header.frame_type;
+  stats->show_frame = static_cast<int>(frame_header.show_frame);
+  collector.GetStats(stats);
+}
+
+// Calls the frame buffer size changed callback of |buffer_pool| for the
+// frames of |sequence_header|.
+bool OnFrameBufferSizeChanged(const ObuSequenceHeader& sequence_header,
+                              BufferPool* const buffer_pool) {
+  const Libgav1ImageFormat image_format =
+      ComposeImageFormat(sequence_header.color_config.is_monochrome,
+                         sequence_header.color_config.subsampling_x,
+                         sequence_header.color_config.subsampling_y);
+  const int max_bottom_border = GetBottomBorderPixels(
+      /*do_cdef=*/true, /*do_restoration=*/true,
+      /*do_superres=*/true, sequence_header.color_config.subsampling_y);
+  if (!buffer_pool->OnFrameBufferSizeChanged(
+          sequence_header.color_config.bitdepth, image_format,
+          sequence_header.max_frame_width, sequence_header.max_frame_height,
+          kBorderPixels, kBorderPixels, kBorderPixels, max_bottom_border)) {
+    LIBGAV1_DLOG(ERROR, "buffer_pool->OnFrameBufferSizeChanged failed.");
+    return false;
+  }
+  return true;
+}
+
+// Copies |from| to |to|. The reference frames are copied into buffers
+// allocated from |buffer_pool|. The reference slots that hold the same frame
+// share the copy. On failure, the reference frames of |to| are cleared.
+bool CopyDecoderState(const DecoderState& from, BufferPool* const buffer_pool,
+                      DecoderState* const to) {
+  *to = from;
+  for (int i = 0; i < kNumReferenceFrameTypes; ++i) {
+    const RefCountedBufferPtr& frame = from.reference_frame[i];
+    if (frame == nullptr) continue;
+    int j = 0;
+    while (from.reference_frame[j] != frame) ++j;
+    if (j < i) {
+      to->reference_frame[i] = to->reference_frame[j];
+      continue;
+    }
+    RefCountedBufferPtr copy = buffer_pool->GetFreeBuffer();
+    if (copy == nullptr || !copy->CopyFrom(*frame)) {
+      LIBGAV1_DLOG(ERROR, "Failed to copy reference frame %d.", i);
+      to->ClearReferenceFrames();
+      return false;
+    }
+    to->reference_frame[i] = std::move(copy);
+  }
+  return true;
+}
+
 }  // namespace
 
 // static
 StatusCode DecoderImpl::Create(const DecoderSettings* settings,
-                               std::unique_ptr<DecoderImpl>* output) {
+                               std::unique_ptr<DecoderImpl>* output,
+                               DecoderSharedResources* shared_resources) {
   if (settings->threads <= 0) {
     LIBGAV1_DLOG(ERROR, "Invalid settings->threads: %d.", settings->threads);
     return kStatusInvalidArgument;
@@ -629,7 +797,13 @@ StatusCode DecoderImpl::Create(const DecoderSettings* settings,
         "the frame_parallel option cannot be used in the parse_only mode.");
     return kStatusInvalidArgument;
   }
-  std::unique_ptr<DecoderImpl> impl(new (std::nothrow) DecoderImpl(settings));
+  if (shared_resources != nullptr && settings->frame_parallel) {
+    LIBGAV1_DLOG(ERROR,
+                 "frame_parallel cannot be used with shared resources.");
+    return kStatusInvalidArgument;
+  }
+  std::unique_ptr<DecoderImpl> impl(
+      new (std::nothrow) DecoderImpl(settings, shared_resources));
   if (impl == nullptr) {
     LIBGAV1_DLOG(ERROR, "Failed to allocate DecoderImpl.");
     return kStatusOutOfMemory;
@@ -640,10 +814,17 @@ StatusCode DecoderImpl::Create(const DecoderSettings* settings,
   return kStatusOk;
 }
 
-DecoderImpl::DecoderImpl(const DecoderSettings* settings)
+DecoderImpl::DecoderImpl(const DecoderSettings* settings,
+                         DecoderSharedResources* shared_resources)
     : buffer_pool_(settings->on_frame_buffer_size_changed,
                    settings->get_frame_buffer, settings->release_frame_buffer,
                    settings->callback_private_data),
+      obu_parser_(nullptr, 0, settings->operating_point, &buffer_pool_,
+                  &state_),
+      frame_scratch_buffer_pool_(
+          (shared_resources != nullptr)
+              ? shared_resources->frame_scratch_buffer_pool()
+              : &own_frame_scratch_buffer_pool_),
       settings_(*settings) {
   dsp::DspInit();
 }
@@ -669,34 +850,16 @@ StatusCode DecoderImpl::Init() {
   return kStatusOk;
 }
 
-StatusCode DecoderImpl::InitializeFrameThreadPoolAndTemporalUnitQueue(
-    const uint8_t* data, size_t size) {
+StatusCode DecoderImpl::InitializeFrameThreadPoolAndTemporalUnitQueue() {
   is_frame_parallel_ = false;
-  if (settings_.frame_parallel) {
-    DecoderState state;
-    std::unique_ptr<ObuParser> obu(new (std::nothrow) ObuParser(
-        data, size, settings_.operating_point, &buffer_pool_, &state));
-    if (obu == nullptr) {
-      LIBGAV1_DLOG(ERROR, "Failed to allocate OBU parser.");
-      return kStatusOutOfMemory;
-    }
-    RefCountedBufferPtr current_frame;
-    const StatusCode status = obu->ParseOneFrame(&current_frame);
-    if (status != kStatusOk) {
-      LIBGAV1_DLOG(ERROR, "Failed to parse OBU.");
-      return status;
-    }
-    current_frame = nullptr;
-    // We assume that the first frame that was parsed will contain the frame
-    // header. This assumption is usually true in practice. So we will simply
-    // not use frame parallel mode if this is not the case.
-    if (settings_.threads > 1 &&
-        !InitializeThreadPoolsForFrameParallel(
-            settings_.threads, obu->frame_header().tile_info.tile_count,
-            obu->frame_header().tile_info.tile_columns, &frame_thread_pool_,
-            &frame_scratch_buffer_pool_)) {
-      return kStatusOutOfMemory;
-    }
+  // Frame parallel decoding is not used with a caller-owned executor because
+  // the frame jobs block while they wait for their reference frames.
+  if (settings_.frame_parallel && settings_.schedule_job == nullptr &&
+      settings_.threads > 1 &&
+      !InitializeThreadPoolsForFrameParallel(
+          settings_.threads, &frame_thread_pool_, &frame_worker_thread_pool_,
+          &frame_parallel_thread_balancer_)) {
+    return kStatusOutOfMemory;
   }
   const int max_allowed_frames =
       (frame_thread_pool_ != nullptr) ? frame_thread_pool_->num_threads() : 1;
@@ -717,7 +880,7 @@ StatusCode DecoderImpl::EnqueueFrame(const uint8_t* data, size_t size,
   if (!seen_first_frame_) {
     seen_first_frame_ = true;
     const StatusCode status =
-        InitializeFrameThreadPoolAndTemporalUnitQueue(data, size);
+        InitializeFrameThreadPoolAndTemporalUnitQueue();
     if (status != kStatusOk) {
       return SignalFailure(status);
     }
@@ -726,6 +889,13 @@ StatusCode DecoderImpl::EnqueueFrame(const uint8_t* data, size_t size,
     return kStatusTryAgain;
   }
   if (is_frame_parallel_) {
+    // The number of frames decoded in parallel is adapted at runtime and may
+    // be lower than the capacity of |temporal_units_|.
+    if (temporal_units_.Size() >=
+        static_cast<size_t>(
+            frame_parallel_thread_balancer_.max_frames_in_flight())) {
+      return kStatusTryAgain;
+    }
     return ParseAndSchedule(data, size, user_private_data, buffer_private_data);
   }
   TemporalUnit temporal_unit(data, size, user_private_data,
@@ -858,18 +1028,54 @@ StatusCode DecoderImpl::DequeueFrame(const DecoderBuffer** out_ptr) {
 
 std::vector<int> DecoderImpl::GetFrameQps() { return frame_mean_qps_; }
 
+StatusCode DecoderImpl::SaveCheckpoint(
+    DecoderCheckpointImpl* const checkpoint) {
+  if (HasFailure()) return kStatusUnknownError;
+  // In frame parallel mode, the enqueued temporal units may still be in
+  // flight and |state_| already includes their frames.
+  if (!temporal_units_.Empty()) return kStatusTryAgain;
+  checkpoint->valid_ = false;
+  // Release the frames of the previous checkpoint so that their buffers are
+  // reused.
+  checkpoint->state_.ClearReferenceFrames();
+  if (!CopyDecoderState(state_, &checkpoint->buffer_pool_,
+                        &checkpoint->state_)) {
+    return kStatusOutOfMemory;
+  }
+  checkpoint->sequence_header_ = sequence_header_;
+  checkpoint->has_sequence_header_ = has_sequence_header_;
+  checkpoint->valid_ = true;
+  return kStatusOk;
+}
+
+StatusCode DecoderImpl::RestoreCheckpoint(
+    const DecoderCheckpointImpl& checkpoint) {
+  assert(!seen_first_frame_);
+  assert(checkpoint.valid_);
+  // The frame buffer size changed callback describes the frame buffers that
+  // are requested after it, so it must be called before the reference frames
+  // are copied.
+  if (checkpoint.has_sequence_header_) {
+    if (!OnFrameBufferSizeChanged(checkpoint.sequence_header_,
+                                  &buffer_pool_)) {
+      return kStatusUnknownError;
+    }
+    sequence_header_ = checkpoint.sequence_header_;
+    has_sequence_header_ = true;
+  }
+  if (!CopyDecoderState(checkpoint.state_, &buffer_pool_, &state_)) {
+    return kStatusOutOfMemory;
+  }
+  return kStatusOk;
+}
+
 StatusCode DecoderImpl::ParseAndSchedule(const uint8_t* data, size_t size,
                                          int64_t user_private_data,
                                          void* buffer_private_data) {
   TemporalUnit temporal_unit(data, size, user_private_data,
                              buffer_private_data);
-  std::unique_ptr<ObuParser> obu(new (std::nothrow) ObuParser(
-      temporal_unit.data, temporal_unit.size, settings_.operating_point,
-      &buffer_pool_, &state_));
-  if (obu == nullptr) {
-    LIBGAV1_DLOG(ERROR, "Failed to allocate OBU parser.");
-    return kStatusOutOfMemory;
-  }
+  ObuParser* const obu = &obu_parser_;
+  obu->Reset(temporal_unit.data, temporal_unit.size);
   if (has_sequence_header_) {
     obu->set_sequence_header(sequence_header_);
   }
@@ -891,21 +1097,9 @@ StatusCode DecoderImpl::ParseAndSchedule(const uint8_t* data, size_t size,
       return kStatusOutOfMemory;
     }
     if (IsNewSequenceHeader(*obu)) {
-      const ObuSequenceHeader& sequence_header = obu->sequence_header();
-      const Libgav1ImageFormat image_format =
-          ComposeImageFormat(sequence_header.color_config.is_monochrome,
-                             sequence_header.color_config.subsampling_x,
-                             sequence_header.color_config.subsampling_y);
-      const int max_bottom_border = GetBottomBorderPixels(
-          /*do_cdef=*/true, /*do_restoration=*/true,
-          /*do_superres=*/true, sequence_header.color_config.subsampling_y);
       // TODO(vigneshv): This may not be the right place to call this callback
       // for the frame parallel case. Investigate and fix it.
-      if (!buffer_pool_.OnFrameBufferSizeChanged(
-              sequence_header.color_config.bitdepth, image_format,
-              sequence_header.max_frame_width, sequence_header.max_frame_height,
-              kBorderPixels, kBorderPixels, kBorderPixels, max_bottom_border)) {
-        LIBGAV1_DLOG(ERROR, "buffer_pool_.OnFrameBufferSizeChanged failed.");
+      if (!OnFrameBufferSizeChanged(obu->sequence_header(), &buffer_pool_)) {
         return kStatusUnknownError;
       }
     }
@@ -917,7 +1111,7 @@ StatusCode DecoderImpl::ParseAndSchedule(const uint8_t* data, size_t size,
     // Note that we cannot set EncodedFrame.temporal_unit here. It will be set
     // in the code below after |temporal_unit| is std::move'd into the
     // |temporal_units_| queue.
-    if (!temporal_unit.frames.emplace_back(obu.get(), state_, current_frame,
+    if (!temporal_unit.frames.emplace_back(obu, state_, current_frame,
                                            position_in_temporal_unit++)) {
       LIBGAV1_DLOG(ERROR, "temporal_unit.frames.emplace_back failed.");
       return kStatusOutOfMemory;
@@ -978,7 +1172,7 @@ StatusCode DecoderImpl::DecodeFrame(EncodedFrame* const encoded_frame) {
   RefCountedBufferPtr current_frame = std::move(encoded_frame->frame);
 
   std::unique_ptr<FrameScratchBuffer> frame_scratch_buffer =
-      frame_scratch_buffer_pool_.Get();
+      frame_scratch_buffer_pool_->Get();
   if (frame_scratch_buffer == nullptr) {
     LIBGAV1_DLOG(ERROR, "Error when getting FrameScratchBuffer.");
     return kStatusOutOfMemory;
@@ -986,7 +1180,16 @@ StatusCode DecoderImpl::DecodeFrame(EncodedFrame* const encoded_frame) {
   // |frame_scratch_buffer| will be released when this local variable goes out
   // of scope (i.e.) on any return path in this function.
   FrameScratchBufferReleaser frame_scratch_buffer_releaser(
-      &frame_scratch_buffer_pool_, &frame_scratch_buffer);
+      frame_scratch_buffer_pool_, &frame_scratch_buffer);
+  FrameWorkerThreads worker_threads(&frame_parallel_thread_balancer_,
+                                    frame_header, frame_scratch_buffer.get());
+  if (!frame_scratch_buffer->threading_strategy.Reset(
+          frame_worker_thread_pool_.get(), worker_threads.num_workers())) {
+    return kStatusOutOfMemory;
+  }
+  FrameStatsCollector& frame_stats = frame_scratch_buffer->frame_stats;
+  frame_stats.Reset(settings_.frame_stats_callback != nullptr &&
+                    !frame_header.show_existing_frame);
 
   StatusCode status;
   if (!frame_header.show_existing_frame) {
@@ -1008,19 +1211,33 @@ StatusCode DecoderImpl::DecodeFrame(EncodedFrame* const encoded_frame) {
       return kStatusUnknownError;
     }
   }
+  TemporalUnit& temporal_unit = *encoded_frame->temporal_unit;
   if (!frame_header.show_frame && !frame_header.show_existing_frame) {
+    ReportFrameStatsFrameParallel(frame_header, temporal_unit.user_private_data,
+                                  frame_scratch_buffer.get());
     // This frame is not displayable. Not an error.
     return kStatusOk;
   }
+  // If show_existing_frame is true, then the current frame is a previously
+  // saved reference frame. If refresh_frame_flags is nonzero, then the
+  // current frame is saved as a reference frame. Otherwise |current_frame| is
+  // not used by any other frame and the noise can be added in place.
+  const bool add_noise_in_place = !frame_header.show_existing_frame &&
+                                  frame_header.refresh_frame_flags == 0;
   RefCountedBufferPtr film_grain_frame;
-  status = ApplyFilmGrain(
-      sequence_header, frame_header, current_frame, &film_grain_frame,
-      frame_scratch_buffer->threading_strategy.thread_pool());
+  {
+    ScopedFrameStageTimer timer(&frame_stats, kFrameStageFilmGrain);
+    status = ApplyFilmGrain(
+        sequence_header, current_frame, add_noise_in_place, &film_grain_frame,
+        frame_scratch_buffer->threading_strategy.thread_pool(),
+        frame_scratch_buffer.get());
+  }
   if (status != kStatusOk) {
     return status;
   }
+  ReportFrameStatsFrameParallel(frame_header, temporal_unit.user_private_data,
+                                frame_scratch_buffer.get());
 
-  TemporalUnit& temporal_unit = *encoded_frame->temporal_unit;
   std::lock_guard<std::mutex> lock(mutex_);
   if (temporal_unit.has_displayable_frame && !settings_.output_all_layers) {
     assert(temporal_unit.output_frame_position >= 0);
@@ -1048,22 +1265,32 @@ StatusCode DecoderImpl::DecodeFrame(EncodedFrame* const encoded_frame) {
   return kStatusOk;
 }
 
+void DecoderImpl::ReportFrameStatsFrameParallel(
+    const ObuFrameHeader& frame_header, int64_t user_private_data,
+    FrameScratchBuffer* const frame_scratch_buffer) {
+  FrameStatsCollector& frame_stats = frame_scratch_buffer->frame_stats;
+  if (!frame_stats.enabled()) return;
+  frame_stats.AddStageDuration(
+      kFrameStageReferenceWait,
+      frame_scratch_buffer->reference_wait_time_ns.load());
+  frame_stats.AddStageDuration(kFrameStageThreadStall,
+                               frame_scratch_buffer->row_wait_time_ns);
+  FrameStats stats;
+  GetFrameStats(frame_header, user_private_data, frame_stats, &stats);
+  settings_.frame_stats_callback(settings_.frame_stats_private_data, &stats);
+}
+
 StatusCode DecoderImpl::DecodeTemporalUnit(const TemporalUnit& temporal_unit,
                                            const DecoderBuffer** out_ptr) {
-  std::unique_ptr<ObuParser> obu(new (std::nothrow) ObuParser(
-      temporal_unit.data, temporal_unit.size, settings_.operating_point,
-      &buffer_pool_, &state_));
-  if (obu == nullptr) {
-    LIBGAV1_DLOG(ERROR, "Failed to allocate OBU parser.");
-    return kStatusOutOfMemory;
-  }
+  ObuParser* const obu = &obu_parser_;
+  obu->Reset(temporal_unit.data, temporal_unit.size);
   frame_mean_qps_.clear();
   if (has_sequence_header_) {
     obu->set_sequence_header(sequence_header_);
   }
   StatusCode status;
   std::unique_ptr<FrameScratchBuffer> frame_scratch_buffer =
-      frame_scratch_buffer_pool_.Get();
+      frame_scratch_buffer_pool_->Get();
   if (frame_scratch_buffer == nullptr) {
     LIBGAV1_DLOG(ERROR, "Error when getting FrameScratchBuffer.");
     return kStatusOutOfMemory;
@@ -1071,7 +1298,11 @@ StatusCode DecoderImpl::DecodeTemporalUnit(const TemporalUnit& temporal_unit,
   // |frame_scratch_buffer| will be released when this local variable goes out
   // of scope (i.e.) on any return path in this function.
   FrameScratchBufferReleaser frame_scratch_buffer_releaser(
-      &frame_scratch_buffer_pool_, &frame_scratch_buffer);
+      frame_scratch_buffer_pool_, &frame_scratch_buffer);
+  FrameStatsCollector& frame_stats = frame_scratch_buffer->frame_stats;
+  // The stats of the frames in |output_frame_queue_|, which are reported once
+  // film grain has been applied to the frames.
+  PendingFrameStats output_frame_stats[kMaxLayers];
 
   while (obu->HasData()) {
     RefCountedBufferPtr current_frame;
@@ -1089,19 +1320,7 @@ StatusCode DecoderImpl::DecodeTemporalUnit(const TemporalUnit& temporal_unit,
       return kStatusOutOfMemory;
     }
     if (IsNewSequenceHeader(*obu)) {
-      const ObuSequenceHeader& sequence_header = obu->sequence_header();
-      const Libgav1ImageFormat image_format =
-          ComposeImageFormat(sequence_header.color_config.is_monochrome,
-                             sequence_header.color_config.subsampling_x,
-                             sequence_header.color_config.subsampling_y);
-      const int max_bottom_border = GetBottomBorderPixels(
-          /*do_cdef=*/true, /*do_restoration=*/true,
-          /*do_superres=*/true, sequence_header.color_config.subsampling_y);
-      if (!buffer_pool_.OnFrameBufferSizeChanged(
-              sequence_header.color_config.bitdepth, image_format,
-              sequence_header.max_frame_width, sequence_header.max_frame_height,
-              kBorderPixels, kBorderPixels, kBorderPixels, max_bottom_border)) {
-        LIBGAV1_DLOG(ERROR, "buffer_pool_.OnFrameBufferSizeChanged failed.");
+      if (!OnFrameBufferSizeChanged(obu->sequence_header(), &buffer_pool_)) {
         return kStatusUnknownError;
       }
     }
@@ -1113,6 +1332,7 @@ StatusCode DecoderImpl::DecodeTemporalUnit(const TemporalUnit& temporal_unit,
         // not have a reason to handle those cases, so we simply continue.
         continue;
       }
+      frame_stats.Reset(settings_.frame_stats_callback != nullptr);
       status = DecodeTiles(obu->sequence_header(), obu->frame_header(),
                            obu->tile_buffers(), state_,
                            frame_scratch_buffer.get(), current_frame.get());
@@ -1125,6 +1345,12 @@ StatusCode DecoderImpl::DecodeTemporalUnit(const TemporalUnit& temporal_unit,
     }
     state_.UpdateReferenceFrames(current_frame,
                                  obu->frame_header().refresh_frame_flags);
+    PendingFrameStats pending_stats;
+    if (frame_stats.enabled() && !obu->frame_header().show_existing_frame) {
+      pending_stats.valid = true;
+      GetFrameStats(obu->frame_header(), temporal_unit.user_private_data,
+                    frame_stats, &pending_stats.stats);
+    }
     if (obu->frame_header().show_frame ||
         obu->frame_header().show_existing_frame) {
       if (!output_frame_queue_.Empty() && !settings_.output_all_layers) {
@@ -1134,23 +1360,67 @@ StatusCode DecoderImpl::DecodeTemporalUnit(const TemporalUnit& temporal_unit,
         // ignore the rest.
         assert(output_frame_queue_.Size() == 1);
         output_frame_queue_.Pop();
+        ReportFrameStats(&output_frame_stats[0]);
       }
       if (!settings_.parse_only) {
-        RefCountedBufferPtr film_grain_frame;
-        status = ApplyFilmGrain(
-            obu->sequence_header(), obu->frame_header(), current_frame,
-            &film_grain_frame,
-            frame_scratch_buffer->threading_strategy.film_grain_thread_pool());
-        if (status != kStatusOk) return status;
-        output_frame_queue_.Push(std::move(film_grain_frame));
+        output_frame_stats[output_frame_queue_.Size()] = pending_stats;
+        pending_stats.valid = false;
+        output_frame_queue_.Push(std::move(current_frame));
       }
     }
+    ReportFrameStats(&pending_stats);
   }
   if (output_frame_queue_.Empty()) {
     // No displayable frame in the temporal unit. Not an error.
     *out_ptr = nullptr;
     return kStatusOk;
   }
+  // Film grain is synthesized on the output path, after all the frames of the
+  // temporal unit are decoded. Frames that are replaced by a later layer never
+  // get a noisy copy, and the reference count of each output frame tells
+  // whether the decoder still needs the frame without noise.
+  for (size_t i = 0, size = output_frame_queue_.Size(); i < size; ++i) {
+    RefCountedBufferPtr frame = std::move(output_frame_queue_.Front());
+    output_frame_queue_.Pop();
+    // A frame that is not held by a reference slot is only owned by the
+    // output queue, so the noise is written over it instead of into a second
+    // buffer from the pool. A reference frame still takes a second buffer for
+    // its noisy copy. That buffer goes back to the pool when the next frame is
+    // dequeued, so it is reused by the next reference frame with film grain.
+    const bool add_noise_in_place = frame.use_count() == 1;
+    RefCountedBufferPtr film_grain_frame;
+    const int64_t film_grain_start_ns =
+        output_frame_stats[i].valid ? FrameStatsCollector::Now() : 0;
+    const int64_t film_grain_start_cpu_ns =
+        output_frame_stats[i].valid ? FrameStatsCollector::ThreadCpuNow() : 0;
+    status = ApplyFilmGrain(
+        obu->sequence_header(), frame, add_noise_in_place, &film_grain_frame,
+        frame_scratch_buffer->threading_strategy.film_grain_thread_pool(),
+        frame_scratch_buffer.get());
+    if (status != kStatusOk) {
+      // Drop the frames that have been moved to the back of the queue along
+      // with the ones that have not been reached yet.
+      output_frame_queue_.Clear();
+      return status;
+    }
+    if (output_frame_stats[i].valid) {
+      const int64_t film_grain_end_cpu_ns = FrameStatsCollector::ThreadCpuNow();
+      const int64_t film_grain_time_ns =
+          FrameStatsCollector::Now() - film_grain_start_ns;
+      FrameStats& stats = output_frame_stats[i].stats;
+      // Film grain is only timed on this thread, which waits for the film
+      // grain jobs on the other threads, so the two times are the same.
+      stats.stages[kFrameStageFilmGrain].wall_time_ns = film_grain_time_ns;
+      stats.stages[kFrameStageFilmGrain].thread_time_ns = film_grain_time_ns;
+      stats.stages[kFrameStageFilmGrain].cpu_time_ns =
+          (film_grain_start_cpu_ns < 0 || film_grain_end_cpu_ns < 0)
+              ? -1
+              : film_grain_end_cpu_ns - film_grain_start_cpu_ns;
+      stats.decode_time_ns += film_grain_time_ns;
+      ReportFrameStats(&output_frame_stats[i]);
+    }
+    output_frame_queue_.Push(std::move(film_grain_frame));
+  }
   status = CopyFrameToOutputBuffer(output_frame_queue_.Front());
   output_frame_queue_.Pop();
   if (status != kStatusOk) {
@@ -1259,7 +1529,9 @@ StatusCode DecoderImpl::DecodeTiles(
   ThreadingStrategy& threading_strategy =
       frame_scratch_buffer->threading_strategy;
   if (!is_frame_parallel_ &&
-      !threading_strategy.Reset(frame_header, settings_.threads)) {
+      !threading_strategy.Reset(frame_header, settings_.threads,
+                                settings_.schedule_job,
+                                settings_.executor_private_data)) {
     return kStatusOutOfMemory;
   }
   const bool do_cdef =
@@ -1326,21 +1598,8 @@ StatusCode DecoderImpl::DecodeTiles(
                    "Failed to allocate memory for temporal motion vectors.");
       return kStatusOutOfMemory;
     }
-
-    // For each motion vector, only mv[0] needs to be initialized to
-    // kInvalidMvValue, mv[1] is not necessary to be initialized and can be
-    // set to an arbitrary value. For simplicity, mv[1] is set to 0.
-    // The following memory initialization of contiguous memory is very fast. It
-    // is not recommended to make the initialization multi-threaded, unless the
-    // memory which needs to be initialized in each thread is still contiguous.
-    MotionVector invalid_mv;
-    invalid_mv.mv[0] = kInvalidMvValue;
-    invalid_mv.mv[1] = 0;
-    MotionVector* const motion_field_mv =
-        &frame_scratch_buffer->motion_field.mv[0][0];
-    std::fill(motion_field_mv,
-              motion_field_mv + frame_scratch_buffer->motion_field.mv.size(),
-              invalid_mv);
+    // The motion field is initialized by the tiles, one superblock row at a
+    // time (see Tile::SetupMotionFieldRows()).
   }
 
   // The addition of kMaxBlockHeight4x4 and kMaxBlockWidth4x4 is necessary so
@@ -1348,7 +1607,8 @@ StatusCode DecoderImpl::DecodeTiles(
   // without having to check for boundary conditions.
   if (!frame_scratch_buffer->block_parameters_holder.Reset(
           frame_header.rows4x4 + kMaxBlockHeight4x4,
-          frame_header.columns4x4 + kMaxBlockWidth4x4)) {
+          frame_header.columns4x4 + kMaxBlockWidth4x4,
+          PostFilter::DoDeblock(frame_header, settings_.post_filter_mask))) {
     return kStatusOutOfMemory;
   }
   const dsp::Dsp* const dsp =
@@ -1361,11 +1621,18 @@ StatusCode DecoderImpl::DecodeTiles(
 
   const int tile_count = frame_header.tile_info.tile_count;
   assert(tile_count >= 1);
-  Vector<std::unique_ptr<Tile>> tiles;
-  if (!tiles.reserve(tile_count)) {
-    LIBGAV1_DLOG(ERROR, "tiles.reserve(%d) failed.\n", tile_count);
+  // The memory of the tiles is kept in |frame_scratch_buffer|, so that the
+  // tiles of the next frames reuse it.
+  Vector<Tile*>& tiles = frame_scratch_buffer->tiles;
+  assert(tiles.empty());
+  if (!tiles.reserve(tile_count) ||
+      !frame_scratch_buffer->tile_buffers.Resize(tile_count) ||
+      !frame_scratch_buffer->tile_memory.Resize(tile_count * sizeof(Tile))) {
+    LIBGAV1_DLOG(ERROR, "Failed to allocate the memory of %d tiles.",
+                 tile_count);
     return kStatusOutOfMemory;
   }
+  TileDestroyer tile_destroyer(&tiles);
 
   if (threading_strategy.row_thread_pool(0) != nullptr || is_frame_parallel_ ||
       settings_.parse_only) {
@@ -1391,6 +1658,13 @@ StatusCode DecoderImpl::DecodeTiles(
     }
   }
 
+  if (threading_strategy.post_filter_thread_pool() != nullptr &&
+      !frame_scratch_buffer->post_filter_task_state.Resize(
+          RightShiftWithCeiling(frame_header.rows4x4, 4) + 1)) {
+    LIBGAV1_DLOG(ERROR, "Failed to resize post_filter_task_state.");
+    return kStatusOutOfMemory;
+  }
+
   if (threading_strategy.post_filter_thread_pool() != nullptr && do_cdef) {
     // We need to store 4 rows per 64x64 unit.
     const int num_units =
@@ -1468,10 +1742,10 @@ StatusCode DecoderImpl::DecodeTiles(
   }
 
   if (do_superres && threading_strategy.post_filter_thread_pool() != nullptr) {
-    const int num_threads =
-        threading_strategy.post_filter_thread_pool()->num_threads() + 1;
+    // We need to store 1 row per 64x64 unit.
+    const int num_units = RightShiftWithCeiling(frame_header.rows4x4, 4);
     // subsampling_y is set to zero irrespective of the actual frame's
-    // subsampling since we need to store exactly |num_threads| rows of the
+    // subsampling since we need to store exactly |num_units| rows of the
     // down-scaled pixels.
     // Left and right borders are for line extension. They are doubled for the Y
     // plane to make sure the U and V planes have enough space after possible
@@ -1479,7 +1753,7 @@ StatusCode DecoderImpl::DecodeTiles(
     if (!frame_scratch_buffer->superres_line_buffer.Realloc(
             sequence_header.color_config.bitdepth,
             sequence_header.color_config.is_monochrome,
-            MultiplyBy4(frame_header.columns4x4), num_threads,
+            MultiplyBy4(frame_header.columns4x4), num_units,
             sequence_header.color_config.subsampling_x,
             /*subsampling_y=*/0, 2 * kSuperResHorizontalBorder,
             2 * (kSuperResHorizontalBorder + kSuperResHorizontalPadding), 0, 0,
@@ -1503,7 +1777,13 @@ StatusCode DecoderImpl::DecodeTiles(
   // a segmentation map containing all 0s.
   const SegmentationMap* prev_segment_ids = nullptr;
   if (frame_header.primary_reference_frame == kPrimaryReferenceNone) {
-    frame_scratch_buffer->symbol_decoder_context.Initialize(
+    frame_scratch_buffer->frame_context =
+        buffer_pool_.frame_context_pool()->Get();
+    if (frame_scratch_buffer->frame_context == nullptr) {
+      LIBGAV1_DLOG(ERROR, "Failed to allocate the symbol decoder context.");
+      return kStatusOutOfMemory;
+    }
+    frame_scratch_buffer->frame_context.Mutable()->Initialize(
         frame_header.quantizer.base_index);
   } else {
     const int index =
@@ -1511,7 +1791,8 @@ StatusCode DecoderImpl::DecodeTiles(
             .reference_frame_index[frame_header.primary_reference_frame];
     assert(index != -1);
     const RefCountedBuffer* prev_frame = state.reference_frame[index].get();
-    frame_scratch_buffer->symbol_decoder_context = prev_frame->FrameContext();
+    frame_scratch_buffer->frame_context = prev_frame->FrameContext();
+    assert(frame_scratch_buffer->frame_context != nullptr);
     if (frame_header.segmentation.enabled &&
         prev_frame->columns4x4() == frame_header.columns4x4 &&
         prev_frame->rows4x4() == frame_header.rows4x4) {
@@ -1524,8 +1805,9 @@ StatusCode DecoderImpl::DecodeTiles(
   // only when one of the following conditions are true:
   //   * is_frame_parallel_ is true.
   //   * settings_.threads == 1.
-  // In the non-frame-parallel multi-threaded case, we do not run the post
-  // filters in the decode loop. So this buffer need not be used.
+  // In the non-frame-parallel multi-threaded case, the post filters are
+  // applied to a superblock row only after the superblock row below it has
+  // been decoded. So this buffer need not be used.
   const bool use_intra_prediction_buffer =
       is_frame_parallel_ || settings_.threads == 1;
   if (use_intra_prediction_buffer) {
@@ -1560,22 +1842,34 @@ StatusCode DecoderImpl::DecodeTiles(
   PostFilter post_filter(frame_header, sequence_header, frame_scratch_buffer,
                          current_frame->buffer(), dsp,
                          settings_.post_filter_mask);
-  SymbolDecoderContext saved_symbol_decoder_context;
+  // The tables of the context update tile. They become the frame context of
+  // |current_frame|, so they are taken from the pool of the frame contexts.
+  SymbolDecoderContextSnapshot saved_symbol_decoder_context;
+  if (frame_header.enable_frame_end_update_cdf) {
+    saved_symbol_decoder_context = buffer_pool_.frame_context_pool()->Get();
+    if (saved_symbol_decoder_context == nullptr) {
+      LIBGAV1_DLOG(ERROR, "Failed to allocate the symbol decoder context.");
+      return kStatusOutOfMemory;
+    }
+  }
   BlockingCounterWithStatus pending_tiles(tile_count);
   for (int tile_number = 0; tile_number < tile_count; ++tile_number) {
-    std::unique_ptr<Tile> tile = Tile::Create(
+    Tile* const tile = Tile::Create(
         tile_number, tile_buffers[tile_number].data,
         tile_buffers[tile_number].size, sequence_header, frame_header,
-        current_frame, state, frame_scratch_buffer, wedge_masks_,
-        quantizer_matrix_, &saved_symbol_decoder_context, prev_segment_ids,
-        &post_filter, dsp, threading_strategy.row_thread_pool(tile_number),
-        &pending_tiles, is_frame_parallel_, use_intra_prediction_buffer,
-        settings_.parse_only);
+        current_frame, state, frame_scratch_buffer, GetSharedWedgeMasks(),
+        GetSharedQuantizerMatrix(),
+        frame_header.enable_frame_end_update_cdf
+            ? saved_symbol_decoder_context.Mutable()
+            : nullptr,
+        prev_segment_ids, &post_filter, dsp,
+        threading_strategy.row_thread_pool(tile_number), &pending_tiles,
+        is_frame_parallel_, use_intra_prediction_buffer, settings_.parse_only);
     if (tile == nullptr) {
       LIBGAV1_DLOG(ERROR, "Failed to create tile.");
       return kStatusOutOfMemory;
     }
-    tiles.push_back_unchecked(std::move(tile));
+    tiles.push_back_unchecked(tile);
   }
   assert(tiles.size() == static_cast<size_t>(tile_count));
   if (settings_.parse_only) {  // Parse only.
@@ -1587,13 +1881,14 @@ StatusCode DecoderImpl::DecodeTiles(
     if (is_frame_parallel_) {
       if (frame_scratch_buffer->threading_strategy.thread_pool() == nullptr) {
         return DecodeTilesFrameParallel(sequence_header, frame_header, tiles,
-                                        saved_symbol_decoder_context,
+                                        std::move(saved_symbol_decoder_context),
                                         prev_segment_ids, frame_scratch_buffer,
                                         &post_filter, current_frame);
       }
       return DecodeTilesThreadedFrameParallel(
-          sequence_header, frame_header, tiles, saved_symbol_decoder_context,
-          prev_segment_ids, frame_scratch_buffer, &post_filter, current_frame);
+          sequence_header, frame_header, tiles,
+          std::move(saved_symbol_decoder_context), prev_segment_ids,
+          frame_scratch_buffer, &post_filter, current_frame);
     }
     StatusCode status;
     if (settings_.threads == 1) {
@@ -1601,38 +1896,32 @@ StatusCode DecoderImpl::DecodeTiles(
                                            frame_scratch_buffer, &post_filter);
     } else {
       status = DecodeTilesThreadedNonFrameParallel(
-          tiles, frame_scratch_buffer, &post_filter, &pending_tiles);
+          sequence_header, tiles, frame_scratch_buffer, &post_filter,
+          &pending_tiles);
     }
     if (status != kStatusOk) return status;
   }
 
-  if (frame_header.enable_frame_end_update_cdf) {
-    frame_scratch_buffer->symbol_decoder_context = saved_symbol_decoder_context;
-  }
-  current_frame->SetFrameContext(frame_scratch_buffer->symbol_decoder_context);
+  SetFrameContext(frame_header, std::move(saved_symbol_decoder_context),
+                  frame_scratch_buffer, current_frame);
   SetSegmentationMap(frame_header, prev_segment_ids, current_frame);
   return kStatusOk;
 }
 
 StatusCode DecoderImpl::ApplyFilmGrain(
     const ObuSequenceHeader& sequence_header,
-    const ObuFrameHeader& frame_header,
-    const RefCountedBufferPtr& displayable_frame,
-    RefCountedBufferPtr* film_grain_frame, ThreadPool* thread_pool) {
+    const RefCountedBufferPtr& displayable_frame, bool add_noise_in_place,
+    RefCountedBufferPtr* film_grain_frame, ThreadPool* thread_pool,
+    FrameScratchBuffer* frame_scratch_buffer) {
   if (!sequence_header.film_grain_params_present ||
       !displayable_frame->film_grain_params().apply_grain ||
       (settings_.post_filter_mask & 0x10) == 0) {
     *film_grain_frame = displayable_frame;
     return kStatusOk;
   }
-  if (!frame_header.show_existing_frame &&
-      frame_header.refresh_frame_flags == 0) {
-    // If show_existing_frame is true, then the current frame is a previously
-    // saved reference frame. If refresh_frame_flags is nonzero, then the
-    // state_.UpdateReferenceFrames() call above has saved the current frame as
-    // a reference frame. Therefore, if both of these conditions are false, then
-    // the current frame is not saved as a reference frame. displayable_frame
-    // should hold the only reference to the current frame.
+  if (add_noise_in_place) {
+    // The frame is not saved as a reference frame. |displayable_frame| should
+    // hold the only reference to it.
     assert(displayable_frame.use_count() == 1);
     // Add film grain noise in place.
     *film_grain_frame = displayable_frame;
@@ -1672,13 +1961,13 @@ StatusCode DecoderImpl::ApplyFilmGrain(
   const int output_stride_uv = (*film_grain_frame)->buffer()->stride(kPlaneU);
 #if LIBGAV1_MAX_BITDEPTH >= 10
   if (displayable_frame->buffer()->bitdepth() == 10) {
-    FilmGrain<10> film_grain(displayable_frame->film_grain_params(),
-                             displayable_frame->buffer()->is_monochrome(),
-                             color_matrix_is_identity,
-                             displayable_frame->buffer()->subsampling_x(),
-                             displayable_frame->buffer()->subsampling_y(),
-                             displayable_frame->upscaled_width(),
-                             displayable_frame->frame_height(), thread_pool);
+    FilmGrain<10> film_grain(
+        displayable_frame->film_grain_params(),
+        displayable_frame->buffer()->is_monochrome(), color_matrix_is_identity,
+        displayable_frame->buffer()->subsampling_x(),
+        displayable_frame->buffer()->subsampling_y(),
+        displayable_frame->upscaled_width(), displayable_frame->frame_height(),
+        thread_pool, &frame_scratch_buffer->film_grain_buffers_high_bitdepth);
     if (!film_grain.AddNoise(
             displayable_frame->buffer()->data(kPlaneY),
             displayable_frame->buffer()->stride(kPlaneY),
@@ -1696,13 +1985,13 @@ StatusCode DecoderImpl::ApplyFilmGrain(
 #endif  // LIBGAV1_MAX_BITDEPTH >= 10
 #if LIBGAV1_MAX_BITDEPTH == 12
   if (displayable_frame->buffer()->bitdepth() == 12) {
-    FilmGrain<12> film_grain(displayable_frame->film_grain_params(),
-                             displayable_frame->buffer()->is_monochrome(),
-                             color_matrix_is_identity,
-                             displayable_frame->buffer()->subsampling_x(),
-                             displayable_frame->buffer()->subsampling_y(),
-                             displayable_frame->upscaled_width(),
-                             displayable_frame->frame_height(), thread_pool);
+    FilmGrain<12> film_grain(
+        displayable_frame->film_grain_params(),
+        displayable_frame->buffer()->is_monochrome(), color_matrix_is_identity,
+        displayable_frame->buffer()->subsampling_x(),
+        displayable_frame->buffer()->subsampling_y(),
+        displayable_frame->upscaled_width(), displayable_frame->frame_height(),
+        thread_pool, &frame_scratch_buffer->film_grain_buffers_high_bitdepth);
     if (!film_grain.AddNoise(
             displayable_frame->buffer()->data(kPlaneY),
             displayable_frame->buffer()->stride(kPlaneY),
@@ -1724,7 +2013,8 @@ StatusCode DecoderImpl::ApplyFilmGrain(
                           displayable_frame->buffer()->subsampling_x(),
                           displayable_frame->buffer()->subsampling_y(),
                           displayable_frame->upscaled_width(),
-                          displayable_frame->frame_height(), thread_pool);
+                          displayable_frame->frame_height(), thread_pool,
+                          &frame_scratch_buffer->film_grain_buffers);
   if (!film_grain.AddNoise(
           displayable_frame->buffer()->data(kPlaneY),
           displayable_frame->buffer()->stride(kPlaneY),
@@ -1765,27 +2055,16 @@ bool DecoderImpl::IsNewSequenceHeader(const ObuParser& obu) {
   return sequence_header_changed;
 }
 
+// static
 bool DecoderImpl::MaybeInitializeWedgeMasks(FrameType frame_type) {
-  if (IsIntraFrame(frame_type) || wedge_masks_initialized_) {
-    return true;
-  }
-  if (!GenerateWedgeMask(&wedge_masks_)) {
-    return false;
-  }
-  wedge_masks_initialized_ = true;
-  return true;
+  return IsIntraFrame(frame_type) || InitializeSharedWedgeMasks();
 }
 
+// static
 bool DecoderImpl::MaybeInitializeQuantizerMatrix(
     const ObuFrameHeader& frame_header) {
-  if (quantizer_matrix_initialized_ || !frame_header.quantizer.use_matrix) {
-    return true;
-  }
-  if (!InitializeQuantizerMatrix(&quantizer_matrix_)) {
-    return false;
-  }
-  quantizer_matrix_initialized_ = true;
-  return true;
+  return !frame_header.quantizer.use_matrix ||
+         InitializeSharedQuantizerMatrix();
 }
 
 }  // namespace libgav1
@@ -31,11 +31,13 @@
 #include "src/frame_scratch_buffer.h"
 #include "src/gav1/decoder_buffer.h"
 #include "src/gav1/decoder_settings.h"
+#include "src/gav1/frame_stats.h"
 #include "src/gav1/status_code.h"
 #include "src/obu_parser.h"
 #include "src/quantizer.h"
 #include "src/residual_buffer_pool.h"
 #include "src/symbol_decoder_context.h"
+#include "src/threading_strategy.h"
 #include "src/tile.h"
 #include "src/utils/array_2d.h"
 #include "src/utils/block_parameters_holder.h"
@@ -129,14 +131,58 @@ struct TemporalUnit : public Allocable {
   bool released_input_buffer;
 };
 
+// The resources that the DecoderImpl objects of a MultiStreamDecoder share.
+// The frame scratch buffers are only used while a frame is being decoded, so
+// the streams of a MultiStreamDecoder need no more of them than there are
+// worker threads.
+class DecoderSharedResources : public Allocable {
+ public:
+  FrameScratchBufferPool* frame_scratch_buffer_pool() {
+    return &frame_scratch_buffer_pool_;
+  }
+
+ private:
+  FrameScratchBufferPool frame_scratch_buffer_pool_;
+};
+
+// The decoding state saved by DecoderImpl::SaveCheckpoint(). The reference
+// frames are copied into frame buffers owned by the checkpoint, so that the
+// checkpoint outlives the decoder that saved it and can be restored into any
+// decoder.
+class DecoderCheckpointImpl : public Allocable {
+ public:
+  DecoderCheckpointImpl()
+      : buffer_pool_(/*on_frame_buffer_size_changed=*/nullptr,
+                     /*get_frame_buffer=*/nullptr,
+                     /*release_frame_buffer=*/nullptr,
+                     /*callback_private_data=*/nullptr) {}
+
+  bool valid() const { return valid_; }
+
+ private:
+  friend class DecoderImpl;
+
+  // |buffer_pool_| must be destroyed after |state_|.
+  BufferPool buffer_pool_;
+  DecoderState state_;
+  ObuSequenceHeader sequence_header_ = {};
+  bool has_sequence_header_ = false;
+  bool valid_ = false;
+};
+
 class DecoderImpl : public Allocable {
  public:
   // The constructor saves a const reference to |*settings|. Therefore
   // |*settings| must outlive the DecoderImpl object. On success, |*output|
   // contains a pointer to the newly-created DecoderImpl object. On failure,
   // |*output| is not modified.
+  //
+  // If |shared_resources| is not nullptr, the decoder uses its frame scratch
+  // buffers instead of its own. |*shared_resources| must outlive the
+  // DecoderImpl object. Frame parallel mode must not be used in this case.
   static StatusCode Create(const DecoderSettings* settings,
-                           std::unique_ptr<DecoderImpl>* output);
+                           std::unique_ptr<DecoderImpl>* output,
+                           DecoderSharedResources* shared_resources = nullptr);
   ~DecoderImpl();
   StatusCode EnqueueFrame(const uint8_t* data, size_t size,
                           int64_t user_private_data, void* buffer_private_data);
@@ -149,22 +195,40 @@ class DecoderImpl : public Allocable {
   }
   std::vector<int> GetFrameQps();
 
+  // Saves the decoding state into |checkpoint|. Returns kStatusTryAgain if
+  // there are enqueued temporal units that have not been dequeued yet.
+  StatusCode SaveCheckpoint(DecoderCheckpointImpl* checkpoint);
+  // Restores the decoding state saved in |checkpoint|. Must be called before
+  // the first EnqueueFrame() call.
+  StatusCode RestoreCheckpoint(const DecoderCheckpointImpl& checkpoint);
+
+  // Returns the frame that backs the DecoderBuffer returned by the last
+  // DequeueFrame() call, or nullptr if there is none. Holding a reference to
+  // it keeps the planes of that DecoderBuffer valid after the next
+  // DequeueFrame() call.
+  const RefCountedBufferPtr& output_frame() const { return output_frame_; }
+
  private:
-  explicit DecoderImpl(const DecoderSettings* settings);
+  // The stats of a frame that have not been reported yet. Used only in non
+  // frame parallel mode, where film grain is applied after all the frames of
+  // the temporal unit are decoded.
+  struct PendingFrameStats {
+    bool valid = false;
+    FrameStats stats;
+  };
+
+  DecoderImpl(const DecoderSettings* settings,
+              DecoderSharedResources* shared_resources);
   StatusCode Init();
-  // Called when the first frame is enqueued. It does the OBU parsing for one
-  // temporal unit to retrieve the tile configuration and sets up the frame
-  // threading if frame parallel mode is allowed. It also initializes the
-  // |temporal_units_| queue based on the number of frame threads.
+  // Called when the first frame is enqueued. It sets up the frame threading if
+  // frame parallel mode is allowed. It also initializes the |temporal_units_|
+  // queue based on the number of frame threads.
   //
-  // The following are the limitations of the current implementation:
-  //  * It assumes that all frames in the video have the same tile
-  //    configuration. The frame parallel threading model will not be updated
-  //    based on tile configuration changes mid-stream.
-  //  * The above assumption holds true even when there is a new coded video
-  //    sequence (i.e.) a new sequence header.
-  StatusCode InitializeFrameThreadPoolAndTemporalUnitQueue(const uint8_t* data,
-                                                           size_t size);
+  // The frame threads only depend on the number of threads. The tile layout of
+  // the frames may change at any frame, so the number of frames that are
+  // decoded in parallel is chosen for each frame by
+  // |frame_parallel_thread_balancer_|.
+  StatusCode InitializeFrameThreadPoolAndTemporalUnitQueue();
   // Used only in frame parallel mode. Signals failure and waits until the
   // worker threads are aborted if |status| is a failure status. If |status| is
   // equal to kStatusOk or kStatusTryAgain, this function does not do anything.
@@ -200,12 +264,32 @@ class DecoderImpl : public Allocable {
                          FrameScratchBuffer* frame_scratch_buffer,
                          RefCountedBuffer* current_frame);
   // Applies film grain synthesis to the |displayable_frame| and stores the film
-  // grain applied frame into |film_grain_frame|. Returns kStatusOk on success.
+  // grain applied frame into |film_grain_frame|. If |add_noise_in_place| is
+  // true, |displayable_frame| must not be used as a reference frame and the
+  // noise is written over it. Otherwise the noise is written into a new frame
+  // from the buffer pool and |displayable_frame| is left untouched. The
+  // memory of the noise is reused from |frame_scratch_buffer|. Returns
+  // kStatusOk on success.
   StatusCode ApplyFilmGrain(const ObuSequenceHeader& sequence_header,
-                            const ObuFrameHeader& frame_header,
                             const RefCountedBufferPtr& displayable_frame,
+                            bool add_noise_in_place,
                             RefCountedBufferPtr* film_grain_frame,
-                            ThreadPool* thread_pool);
+                            ThreadPool* thread_pool,
+                            FrameScratchBuffer* frame_scratch_buffer);
+
+  // Passes the stats to the frame_stats_callback setting if they are valid
+  // and then marks them as invalid.
+  void ReportFrameStats(PendingFrameStats* pending_stats) {
+    if (!pending_stats->valid) return;
+    settings_.frame_stats_callback(settings_.frame_stats_private_data,
+                                   &pending_stats->stats);
+    pending_stats->valid = false;
+  }
+  // Used only in frame parallel mode. Reports the stats of a frame that was
+  // decoded with |frame_scratch_buffer|, if they were collected.
+  void ReportFrameStatsFrameParallel(const ObuFrameHeader& frame_header,
+                                     int64_t user_private_data,
+                                     FrameScratchBuffer* frame_scratch_buffer);
 
   bool IsNewSequenceHeader(const ObuParser& obu);
 
@@ -214,13 +298,14 @@ class DecoderImpl : public Allocable {
     return failure_status_ != kStatusOk;
   }
 
-  // Initializes the |quantizer_matrix_| if necessary and sets
-  // |quantizer_matrix_initialized_| to true.
-  bool MaybeInitializeQuantizerMatrix(const ObuFrameHeader& frame_header);
+  // Initializes the quantizer matrix that is shared by all the decoders if
+  // it is needed by |frame_header| and has not been initialized yet.
+  static bool MaybeInitializeQuantizerMatrix(
+      const ObuFrameHeader& frame_header);
 
-  // Allocates and generates the |wedge_masks_| if necessary and sets
-  // |wedge_masks_initialized_| to true.
-  bool MaybeInitializeWedgeMasks(FrameType frame_type);
+  // Generates the wedge masks that are shared by all the decoders if they are
+  // needed by |frame_type| and have not been generated yet.
+  static bool MaybeInitializeWedgeMasks(FrameType frame_type);
 
   // Elements in this queue cannot be moved with std::move since the
   // |EncodedFrame.temporal_unit| stores a pointer to elements in this queue.
@@ -239,17 +324,28 @@ class DecoderImpl : public Allocable {
   Queue<RefCountedBufferPtr> output_frame_queue_;
 
   BufferPool buffer_pool_;
-  WedgeMaskArray wedge_masks_;
-  bool wedge_masks_initialized_ = false;
-  QuantizerMatrix quantizer_matrix_;
-  bool quantizer_matrix_initialized_ = false;
-  FrameScratchBufferPool frame_scratch_buffer_pool_;
+  // Parses the temporal units in ParseAndSchedule() and DecodeTemporalUnit().
+  // It is reused for all the temporal units so that it does not allocate once
+  // it has parsed the first ones.
+  ObuParser obu_parser_;
+  // The worker threads shared by the frame threads in frame parallel mode. The
+  // thread pools of the ThreadingStrategy objects in
+  // |own_frame_scratch_buffer_pool_| run their jobs on it, so it must outlive
+  // them.
+  std::unique_ptr<ThreadPool> frame_worker_thread_pool_;
+  FrameScratchBufferPool own_frame_scratch_buffer_pool_;
+  // Points to either |own_frame_scratch_buffer_pool_| or the pool of the
+  // DecoderSharedResources passed to Create().
+  FrameScratchBufferPool* const frame_scratch_buffer_pool_;
 
   // Used to synchronize the accesses into |temporal_units_| in order to update
   // the "decoded" state of a temporal unit.
   std::mutex mutex_;
   std::condition_variable decoded_condvar_;
   bool is_frame_parallel_;
+  // Hands out the threads of |frame_worker_thread_pool_| to the frames and
+  // adapts the number of frames in flight.
+  FrameParallelThreadBalancer frame_parallel_thread_balancer_;
   std::unique_ptr<ThreadPool> frame_thread_pool_;
 
   // In frame parallel mode, there are two primary points of failure:
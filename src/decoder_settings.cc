@@ -29,6 +29,10 @@ void Libgav1DecoderSettingsInitDefault(Libgav1DecoderSettings* settings) {
   settings->operating_point = 0;
   settings->post_filter_mask = 0x1f;
   settings->parse_only = 0;  // false
+  settings->schedule_job = nullptr;
+  settings->executor_private_data = nullptr;
+  settings->frame_stats_callback = nullptr;
+  settings->frame_stats_private_data = nullptr;
 }
 
 }  // extern "C"
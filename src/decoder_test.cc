@@ -14,14 +14,22 @@
 
 #include "src/gav1/decoder.h"
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
+#include <ctime>
 #include <memory>
 #include <new>
+#include <thread>  // NOLINT (unapproved c++11 header)
 #include <vector>
 
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "gtest/gtest.h"
 #include "src/decoder_test_data.h"
+#include "src/utils/threadpool.h"
+#include "tests/counting_allocator.h"
 
 namespace libgav1 {
 namespace {
@@ -51,10 +59,13 @@ class DecoderTest : public testing::Test {
   void SetReleasedInputBuffer(void* released_input_buffer) {
     released_input_buffer_ = released_input_buffer;
   }
+  void SetFrameBufferSizeChanged() { frame_buffer_size_changed_ = true; }
+  bool frame_buffer_size_changed() const { return frame_buffer_size_changed_; }
 
  protected:
   std::unique_ptr<Decoder> decoder_;
   int frames_in_use_ = 0;
+  bool frame_buffer_size_changed_ = false;
   void* buffer_private_data_ = nullptr;
   void* released_input_buffer_ = nullptr;
 };
@@ -119,6 +130,31 @@ static void ReleaseInputBuffer(void* private_data, void* input_buffer) {
   decoder_test->SetReleasedInputBuffer(input_buffer);
 }
 
+static Libgav1StatusCode OnFrameBufferSizeChanged(
+    void* callback_private_data, int /*bitdepth*/,
+    Libgav1ImageFormat /*image_format*/, int /*width*/, int /*height*/,
+    int /*left_border*/, int /*right_border*/, int /*top_border*/,
+    int /*bottom_border*/, int /*stride_alignment*/) {
+  static_cast<DecoderTest*>(callback_private_data)->SetFrameBufferSizeChanged();
+  return kLibgav1StatusOk;
+}
+
+// Like GetFrameBuffer(), but fails unless the frame buffer size changed
+// callback has been called before, like an application that creates its pool
+// of frame buffers in that callback.
+static Libgav1StatusCode GetFrameBufferAfterSizeChanged(
+    void* callback_private_data, int bitdepth, Libgav1ImageFormat image_format,
+    int width, int height, int left_border, int right_border, int top_border,
+    int bottom_border, int stride_alignment, Libgav1FrameBuffer* frame_buffer) {
+  if (!static_cast<DecoderTest*>(callback_private_data)
+           ->frame_buffer_size_changed()) {
+    return kLibgav1StatusInvalidArgument;
+  }
+  return GetFrameBuffer(callback_private_data, bitdepth, image_format, width,
+                        height, left_border, right_border, top_border,
+                        bottom_border, stride_alignment, frame_buffer);
+}
+
 }  // extern "C"
 
 void DecoderTest::SetUp() {
@@ -432,5 +468,363 @@ TEST_F(ParseOnlyTest, NonFrameParallelModeParseOnly) {
   EXPECT_EQ(frame2_qp[0], kFrame2MeanQp);
 }
 
+// Runs the jobs of the decoders on the ThreadPool |executor_private_data|.
+void ScheduleJob(void* executor_private_data, JobFunction job,
+                 void* job_private_data) {
+  static_cast<ThreadPool*>(executor_private_data)->Schedule(
+      [job, job_private_data]() { job(job_private_data); });
+}
+
+// Decodes |data| with |decoder| and returns the luma plane of the output.
+std::vector<uint8_t> DecodeLuma(Decoder* decoder, const uint8_t* data,
+                                size_t size) {
+  std::vector<uint8_t> luma;
+  if (decoder->EnqueueFrame(data, size, 0, nullptr) != kStatusOk) return luma;
+  const DecoderBuffer* buffer;
+  if (decoder->DequeueFrame(&buffer) != kStatusOk || buffer == nullptr) {
+    return luma;
+  }
+  const int row_size =
+      buffer->displayed_width[0] * ((buffer->bitdepth == 8) ? 1 : 2);
+  for (int y = 0; y < buffer->displayed_height[0]; ++y) {
+    const uint8_t* const row = buffer->plane[0] + y * buffer->stride[0];
+    luma.insert(luma.end(), row, row + row_size);
+  }
+  return luma;
+}
+
+// Two decoders that share one caller-owned executor produce the same output
+// as a decoder that does not use threads.
+TEST(SharedExecutorTest, TwoDecoders) {
+  std::unique_ptr<ThreadPool> executor = ThreadPool::Create(2);
+  ASSERT_NE(executor, nullptr);
+  DecoderSettings settings = {};
+  settings.threads = 3;
+  settings.schedule_job = ScheduleJob;
+  settings.executor_private_data = executor.get();
+  Decoder decoders[2];
+  for (auto& decoder : decoders) {
+    ASSERT_EQ(decoder.Init(&settings), kStatusOk);
+  }
+  Decoder reference;
+  DecoderSettings reference_settings = {};
+  ASSERT_EQ(reference.Init(&reference_settings), kStatusOk);
+
+  const std::vector<uint8_t> expected1 =
+      DecodeLuma(&reference, kFrame1, sizeof(kFrame1));
+  const std::vector<uint8_t> expected2 =
+      DecodeLuma(&reference, kFrame2, sizeof(kFrame2));
+  ASSERT_FALSE(expected1.empty());
+  ASSERT_FALSE(expected2.empty());
+  for (auto& decoder : decoders) {
+    EXPECT_EQ(DecodeLuma(&decoder, kFrame1, sizeof(kFrame1)), expected1);
+  }
+  for (auto& decoder : decoders) {
+    EXPECT_EQ(DecodeLuma(&decoder, kFrame2, sizeof(kFrame2)), expected2);
+  }
+}
+
+// The executor_private_data of a decoder that shares the ThreadPool |pool|
+// with other decoders.
+struct SharedExecutorClient {
+  ThreadPool* pool;
+  // The number of jobs of the decoder that have finished.
+  std::atomic<int> finished_jobs{0};
+  // If not nullptr, the first job of the decoder holds its executor thread
+  // until a job of |wait_for| has finished on another executor thread.
+  const SharedExecutorClient* wait_for = nullptr;
+  std::atomic<bool> first_job{true};
+  std::atomic<bool> other_finished_job{false};
+};
+
+void ScheduleClientJob(void* executor_private_data, JobFunction job,
+                       void* job_private_data) {
+  auto* const client =
+      static_cast<SharedExecutorClient*>(executor_private_data);
+  client->pool->Schedule([client, job, job_private_data]() {
+    if (client->wait_for != nullptr && client->first_job.exchange(false)) {
+      const absl::Time deadline = absl::Now() + absl::Seconds(10);
+      while (client->wait_for->finished_jobs.load() == 0 &&
+             absl::Now() < deadline) {
+        absl::SleepFor(absl::Milliseconds(1));
+      }
+      client->other_finished_job = client->wait_for->finished_jobs.load() > 0;
+    }
+    job(job_private_data);
+    client->finished_jobs.fetch_add(1);
+  });
+}
+
+// Two decoders decode concurrently from two threads on an executor that has
+// fewer threads than the decoders may use together. A job of one decoder that
+// holds an executor thread does not stop the other decoder.
+TEST(SharedExecutorTest, ConcurrentDecoders) {
+  constexpr int kNumDecoders = 2;
+  constexpr int kThreadsPerDecoder = 3;
+  constexpr int kIterations = 20;
+  std::unique_ptr<ThreadPool> executor = ThreadPool::Create(2);
+  ASSERT_NE(executor, nullptr);
+  ASSERT_LT(executor->num_threads(), kThreadsPerDecoder * kNumDecoders);
+  SharedExecutorClient clients[kNumDecoders];
+  Decoder decoders[kNumDecoders];
+  for (int i = 0; i < kNumDecoders; ++i) {
+    clients[i].pool = executor.get();
+    DecoderSettings settings = {};
+    settings.threads = kThreadsPerDecoder;
+    settings.schedule_job = ScheduleClientJob;
+    settings.executor_private_data = &clients[i];
+    ASSERT_EQ(decoders[i].Init(&settings), kStatusOk);
+  }
+  clients[0].wait_for = &clients[1];
+
+  Decoder reference;
+  DecoderSettings reference_settings = {};
+  ASSERT_EQ(reference.Init(&reference_settings), kStatusOk);
+  const std::vector<uint8_t> expected1 =
+      DecodeLuma(&reference, kFrame1, sizeof(kFrame1));
+  const std::vector<uint8_t> expected2 =
+      DecodeLuma(&reference, kFrame2, sizeof(kFrame2));
+  ASSERT_FALSE(expected1.empty());
+  ASSERT_FALSE(expected2.empty());
+
+  std::atomic<bool> start{false};
+  int mismatches[kNumDecoders] = {};
+  std::thread threads[kNumDecoders];
+  for (int i = 0; i < kNumDecoders; ++i) {
+    threads[i] = std::thread([&, i]() {
+      while (!start.load()) std::this_thread::yield();
+      for (int j = 0; j < kIterations; ++j) {
+        if (DecodeLuma(&decoders[i], kFrame1, sizeof(kFrame1)) != expected1) {
+          ++mismatches[i];
+        }
+        if (DecodeLuma(&decoders[i], kFrame2, sizeof(kFrame2)) != expected2) {
+          ++mismatches[i];
+        }
+      }
+    });
+  }
+  start = true;
+  for (auto& thread : threads) thread.join();
+
+  for (int i = 0; i < kNumDecoders; ++i) {
+    SCOPED_TRACE(i);
+    EXPECT_EQ(mismatches[i], 0);
+    // Every decoder ran its jobs on the executor.
+    EXPECT_GT(clients[i].finished_jobs.load(), 0);
+  }
+  // The second decoder finished a job while the first job of the first decoder
+  // was holding an executor thread.
+  EXPECT_FALSE(clients[0].first_job.load());
+  EXPECT_TRUE(clients[0].other_finished_job.load());
+}
+
+// Once the decoder has warmed up, decoding more frames of the same size does
+// not allocate, with or without threads.
+TEST(DecoderAllocationTest, SteadyStateDecodeDoesNotAllocate) {
+  for (const int threads : {1, 4}) {
+    SCOPED_TRACE(threads);
+    DecoderSettings settings = {};
+    settings.threads = threads;
+    Decoder decoder;
+    ASSERT_EQ(decoder.Init(&settings), kStatusOk);
+    const DecoderBuffer* buffer;
+    ASSERT_EQ(decoder.EnqueueFrame(kFrame1, sizeof(kFrame1), 0, nullptr),
+              kStatusOk);
+    ASSERT_EQ(decoder.DequeueFrame(&buffer), kStatusOk);
+    ASSERT_NE(buffer, nullptr);
+    // Warm up: the inter frames allocate their scratch buffers and fill the
+    // buffer pool.
+    for (int i = 0; i < 4; ++i) {
+      ASSERT_EQ(decoder.EnqueueFrame(kFrame2, sizeof(kFrame2), 0, nullptr),
+                kStatusOk);
+      ASSERT_EQ(decoder.DequeueFrame(&buffer), kStatusOk);
+      ASSERT_NE(buffer, nullptr);
+    }
+    const int count_before = test_utils::allocation_count.load();
+    for (int i = 0; i < 10; ++i) {
+      ASSERT_EQ(decoder.EnqueueFrame(kFrame2, sizeof(kFrame2), 0, nullptr),
+                kStatusOk);
+      ASSERT_EQ(decoder.DequeueFrame(&buffer), kStatusOk);
+      ASSERT_NE(buffer, nullptr);
+    }
+    EXPECT_EQ(test_utils::allocation_count.load(), count_before);
+  }
+}
+
+void AppendFrameStats(void* frame_stats_private_data,
+                      const FrameStats* stats) {
+  static_cast<std::vector<FrameStats>*>(frame_stats_private_data)
+      ->push_back(*stats);
+}
+
+TEST(FrameStatsTest, ReportsEveryDecodedFrame) {
+  std::vector<FrameStats> frame_stats;
+  DecoderSettings settings = {};
+  settings.frame_stats_callback = AppendFrameStats;
+  settings.frame_stats_private_data = &frame_stats;
+  Decoder decoder;
+  ASSERT_EQ(decoder.Init(&settings), kStatusOk);
+
+  const DecoderBuffer* buffer;
+  ASSERT_EQ(decoder.EnqueueFrame(kFrame1, sizeof(kFrame1), 10, nullptr),
+            kStatusOk);
+  ASSERT_EQ(decoder.DequeueFrame(&buffer), kStatusOk);
+  ASSERT_NE(buffer, nullptr);
+  ASSERT_EQ(frame_stats.size(), 1);
+  ASSERT_EQ(decoder.EnqueueFrame(kFrame2, sizeof(kFrame2), 11, nullptr),
+            kStatusOk);
+  ASSERT_EQ(decoder.DequeueFrame(&buffer), kStatusOk);
+  ASSERT_NE(buffer, nullptr);
+  ASSERT_EQ(frame_stats.size(), 2);
+
+  for (size_t i = 0; i < frame_stats.size(); ++i) {
+    const FrameStats& stats = frame_stats[i];
+    SCOPED_TRACE(i);
+    EXPECT_EQ(stats.user_private_data, 10 + static_cast<int64_t>(i));
+    EXPECT_EQ(stats.width, buffer->displayed_width[0]);
+    EXPECT_EQ(stats.height, buffer->displayed_height[0]);
+    EXPECT_EQ(stats.show_frame, 1);
+    EXPECT_GT(stats.decode_time_ns, 0);
+    EXPECT_GT(stats.stages[kFrameStageReconstruction].thread_time_ns, 0);
+    for (const FrameStageTime& time : stats.stages) {
+      EXPECT_GE(time.wall_time_ns, 0);
+      EXPECT_GE(time.thread_time_ns, 0);
+      EXPECT_GE(time.cpu_time_ns, -1);
+      EXPECT_LE(time.wall_time_ns, stats.decode_time_ns);
+    }
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    // The CPU time of the thread is measured for each superblock.
+    EXPECT_GE(stats.stages[kFrameStageReconstruction].cpu_time_ns, 0);
+    EXPECT_LE(stats.stages[kFrameStageReconstruction].cpu_time_ns,
+              stats.decode_time_ns);
+#endif
+    // Without threads, the tiles are parsed and decoded in one pass.
+    EXPECT_EQ(stats.stages[kFrameStageParse].thread_time_ns, 0);
+    // There are no other threads to wait for.
+    EXPECT_EQ(stats.stages[kFrameStageThreadStall].thread_time_ns, 0);
+    EXPECT_EQ(stats.stages[kFrameStageReferenceWait].thread_time_ns, 0);
+  }
+  EXPECT_EQ(frame_stats[0].frame_type, 0);  // Key frame.
+  EXPECT_EQ(frame_stats[1].frame_type, 1);  // Inter frame.
+  EXPECT_EQ(frame_stats[0].stages[kFrameStageInterPrediction].thread_time_ns,
+            0);
+}
+
+TEST(DecoderCheckpointTest, Errors) {
+  Decoder decoder;
+  DecoderCheckpoint checkpoint;
+  EXPECT_EQ(decoder.SaveCheckpoint(&checkpoint), kStatusNotInitialized);
+  EXPECT_EQ(decoder.RestoreCheckpoint(checkpoint), kStatusNotInitialized);
+  DecoderSettings settings = {};
+  ASSERT_EQ(decoder.Init(&settings), kStatusOk);
+  EXPECT_EQ(decoder.SaveCheckpoint(nullptr), kStatusInvalidArgument);
+  // Nothing was saved in |checkpoint|.
+  EXPECT_EQ(decoder.RestoreCheckpoint(checkpoint), kStatusInvalidArgument);
+  // The state is only saved between temporal units.
+  ASSERT_EQ(decoder.EnqueueFrame(kFrame1, sizeof(kFrame1), 0, nullptr),
+            kStatusOk);
+  EXPECT_EQ(decoder.SaveCheckpoint(&checkpoint), kStatusTryAgain);
+  const DecoderBuffer* buffer;
+  ASSERT_EQ(decoder.DequeueFrame(&buffer), kStatusOk);
+  EXPECT_EQ(decoder.SaveCheckpoint(&checkpoint), kStatusOk);
+}
+
+class DecoderCheckpointRestoreTest : public DecoderTest,
+                                     public testing::WithParamInterface<bool> {
+};
+
+// A decoder restored from a checkpoint taken after kFrame1 decodes kFrame2,
+// which has no sequence header and uses kFrame1 as a reference, like the
+// decoder that saved the checkpoint.
+TEST_P(DecoderCheckpointRestoreTest, DecodeNextFrame) {
+  DecoderSettings settings = {};
+  settings.threads = 2;
+  settings.frame_parallel = GetParam();
+  settings.blocking_dequeue = true;
+  settings.get_frame_buffer = GetFrameBuffer;
+  settings.release_frame_buffer = ReleaseFrameBuffer;
+  settings.release_input_buffer = ReleaseInputBuffer;
+  settings.callback_private_data = this;
+
+  DecoderCheckpoint checkpoint;
+  std::vector<uint8_t> expected;
+  {
+    Decoder decoder;
+    ASSERT_EQ(decoder.Init(&settings), kStatusOk);
+    ASSERT_FALSE(DecodeLuma(&decoder, kFrame1, sizeof(kFrame1)).empty());
+    ASSERT_EQ(decoder.SaveCheckpoint(&checkpoint), kStatusOk);
+    expected = DecodeLuma(&decoder, kFrame2, sizeof(kFrame2));
+    ASSERT_FALSE(expected.empty());
+  }
+  // The checkpoint outlives the decoder that saved it and does not use its
+  // frame buffer callbacks.
+  EXPECT_EQ(frames_in_use_, 0);
+
+  Decoder decoder;
+  ASSERT_EQ(decoder.Init(&settings), kStatusOk);
+  for (int i = 0; i < 2; ++i) {
+    SCOPED_TRACE(i);
+    ASSERT_EQ(decoder.RestoreCheckpoint(checkpoint), kStatusOk);
+    EXPECT_EQ(DecodeLuma(&decoder, kFrame2, sizeof(kFrame2)), expected);
+  }
+
+  // Without the checkpoint, kFrame2 cannot be decoded.
+  ASSERT_EQ(decoder.SignalEOS(), kStatusOk);
+  EXPECT_TRUE(DecodeLuma(&decoder, kFrame2, sizeof(kFrame2)).empty());
+}
+
+// Restoring a checkpoint calls the frame buffer size changed callback before
+// it allocates the reference frames.
+TEST_P(DecoderCheckpointRestoreTest, FrameBufferSizeChangedFirst) {
+  DecoderSettings settings = {};
+  settings.threads = 2;
+  settings.frame_parallel = GetParam();
+  settings.blocking_dequeue = true;
+  settings.on_frame_buffer_size_changed = OnFrameBufferSizeChanged;
+  settings.get_frame_buffer = GetFrameBufferAfterSizeChanged;
+  settings.release_frame_buffer = ReleaseFrameBuffer;
+  settings.release_input_buffer = ReleaseInputBuffer;
+  settings.callback_private_data = this;
+
+  DecoderCheckpoint checkpoint;
+  std::vector<uint8_t> expected;
+  {
+    Decoder decoder;
+    ASSERT_EQ(decoder.Init(&settings), kStatusOk);
+    ASSERT_FALSE(DecodeLuma(&decoder, kFrame1, sizeof(kFrame1)).empty());
+    ASSERT_EQ(decoder.SaveCheckpoint(&checkpoint), kStatusOk);
+    expected = DecodeLuma(&decoder, kFrame2, sizeof(kFrame2));
+    ASSERT_FALSE(expected.empty());
+  }
+
+  frame_buffer_size_changed_ = false;
+  Decoder decoder;
+  ASSERT_EQ(decoder.Init(&settings), kStatusOk);
+  ASSERT_EQ(decoder.RestoreCheckpoint(checkpoint), kStatusOk);
+  EXPECT_TRUE(frame_buffer_size_changed_);
+  EXPECT_EQ(DecodeLuma(&decoder, kFrame2, sizeof(kFrame2)), expected);
+}
+
+INSTANTIATE_TEST_SUITE_P(DecoderCheckpointRestoreTest,
+                         DecoderCheckpointRestoreTest, testing::Bool());
+
+// Measures the time it takes a freshly created decoder to output its first
+// frames, which includes the initialization of the decoder and of any tables
+// it needs. kFrame2 is an inter frame, so it needs the wedge masks.
+TEST(DecoderStartupTest, DISABLED_TimeToFirstFrame) {
+  constexpr int kNumDecoders = 1000;
+  const absl::Time start = absl::Now();
+  for (int i = 0; i < kNumDecoders; ++i) {
+    Decoder decoder;
+    DecoderSettings settings = {};
+    ASSERT_EQ(decoder.Init(&settings), kStatusOk);
+    ASSERT_FALSE(DecodeLuma(&decoder, kFrame1, sizeof(kFrame1)).empty());
+    ASSERT_FALSE(DecodeLuma(&decoder, kFrame2, sizeof(kFrame2)).empty());
+  }
+  const absl::Duration elapsed = absl::Now() - start;
+  printf("Time to first frames (create, decode 2 frames, destroy): %d us\n",
+         static_cast<int>(absl::ToInt64Microseconds(elapsed) / kNumDecoders));
+}
+
 }  // namespace
 }  // namespace libgav1
@@ -167,6 +167,10 @@ INSTANTIATE_TEST_SUITE_P(C, CdefDirectionTest10bpp, testing::Values(0));
 #if LIBGAV1_ENABLE_NEON
 INSTANTIATE_TEST_SUITE_P(NEON, CdefDirectionTest10bpp, testing::Values(0));
 #endif
+
+#if LIBGAV1_ENABLE_SSE4_1
+INSTANTIATE_TEST_SUITE_P(SSE41, CdefDirectionTest10bpp, testing::Values(0));
+#endif
 #endif  // LIBGAV1_MAX_BITDEPTH >= 10
 
 #if LIBGAV1_MAX_BITDEPTH == 12
@@ -179,6 +183,10 @@ TEST_P(CdefDirectionTest12bpp, DISABLED_Speed) {
 }
 
 INSTANTIATE_TEST_SUITE_P(C, CdefDirectionTest12bpp, testing::Values(0));
+
+#if LIBGAV1_ENABLE_SSE4_1
+INSTANTIATE_TEST_SUITE_P(SSE41, CdefDirectionTest12bpp, testing::Values(0));
+#endif
 #endif  // LIBGAV1_MAX_BITDEPTH == 12
 
 const char* GetDigest8bpp(int id) {
@@ -277,6 +285,12 @@ class CdefFilteringTest : public testing::TestWithParam<CdefTestParam> {
     } else if (absl::StartsWith(test_case, "SSE41/")) {
       if ((GetCpuInfo() & kSSE4_1) == 0) GTEST_SKIP() << "No SSE4.1 support!";
       CdefInit_SSE4_1();
+    } else if (absl::StartsWith(test_case, "AVX512/")) {
+      if ((GetCpuInfo() & (kAVX512BW | kAVX512VL)) !=
+          (kAVX512BW | kAVX512VL)) {
+        GTEST_SKIP() << "No AVX-512 support!";
+      }
+      CdefInit_AVX512();
     } else if (absl::StartsWith(test_case, "AVX2/")) {
       if ((GetCpuInfo() & kAVX2) == 0) GTEST_SKIP() << "No AVX2 support!";
       CdefInit_AVX2();
@@ -417,6 +431,11 @@ INSTANTIATE_TEST_SUITE_P(AVX2, CdefFilteringTest8bpp,
                          testing::ValuesIn(cdef_test_param));
 #endif  // LIBGAV1_ENABLE_AVX2
 
+#if LIBGAV1_ENABLE_AVX512
+INSTANTIATE_TEST_SUITE_P(AVX512, CdefFilteringTest8bpp,
+                         testing::ValuesIn(cdef_test_param));
+#endif  // LIBGAV1_ENABLE_AVX512
+
 #if LIBGAV1_MAX_BITDEPTH >= 10
 using CdefFilteringTest10bpp = CdefFilteringTest<10, uint16_t>;
 
@@ -433,6 +452,11 @@ INSTANTIATE_TEST_SUITE_P(C, CdefFilteringTest10bpp,
 INSTANTIATE_TEST_SUITE_P(NEON, CdefFilteringTest10bpp,
                          testing::ValuesIn(cdef_test_param));
 #endif
+
+#if LIBGAV1_ENABLE_SSE4_1
+INSTANTIATE_TEST_SUITE_P(SSE41, CdefFilteringTest10bpp,
+                         testing::ValuesIn(cdef_test_param));
+#endif
 #endif  // LIBGAV1_MAX_BITDEPTH >= 10
 
 #if LIBGAV1_MAX_BITDEPTH == 12
@@ -446,6 +470,11 @@ TEST_P(CdefFilteringTest12bpp, DISABLED_Speed) {
 
 INSTANTIATE_TEST_SUITE_P(C, CdefFilteringTest12bpp,
                          testing::ValuesIn(cdef_test_param));
+
+#if LIBGAV1_ENABLE_SSE4_1
+INSTANTIATE_TEST_SUITE_P(SSE41, CdefFilteringTest12bpp,
+                         testing::ValuesIn(cdef_test_param));
+#endif
 #endif  // LIBGAV1_MAX_BITDEPTH == 12
 
 }  // namespace
@@ -626,9 +626,21 @@ class ConvolveTest : public testing::TestWithParam<
     } else if (absl::StartsWith(test_case, "SSE41/")) {
       if ((GetCpuInfo() & kSSE4_1) == 0) GTEST_SKIP() << "No SSE4.1 support!";
       ConvolveInit_SSE4_1();
+#if LIBGAV1_MAX_BITDEPTH >= 10
+      ConvolveInit10bpp_SSE4_1();
+#endif
+#if LIBGAV1_MAX_BITDEPTH == 12
+      ConvolveInit12bpp_SSE4_1();
+#endif
     } else if (absl::StartsWith(test_case, "AVX2/")) {
       if ((GetCpuInfo() & kAVX2) == 0) GTEST_SKIP() << "No AVX2 support!";
       ConvolveInit_AVX2();
+#if LIBGAV1_MAX_BITDEPTH >= 10
+      ConvolveInit10bpp_AVX2();
+#endif
+#if LIBGAV1_MAX_BITDEPTH == 12
+      ConvolveInit12bpp_AVX2();
+#endif
     } else if (absl::StartsWith(test_case, "NEON/")) {
       ConvolveInit_NEON();
 #if LIBGAV1_MAX_BITDEPTH >= 10
@@ -671,6 +683,10 @@ class ConvolveTest : public testing::TestWithParam<
   // under each category (16).
   void Test(bool use_fixed_values, int value,
             int num_runs = kMinimumViableRuns);
+  // Compares the optimized function with the C function on sources made of
+  // only 0 and the maximum pixel value. These give the largest intermediate
+  // values of the filters, which the random sources rarely reach.
+  void TestExtremeValues();
 
   const ConvolveTypeParam type_param_ = std::get<0>(GetParam());
   const ConvolveTestParam param_ = std::get<1>(GetParam());
@@ -684,6 +700,8 @@ class ConvolveTest : public testing::TestWithParam<
   uint16_t source_16bit_[kMaxBlockHeight * kMaxBlockWidth] = {};
   uint16_t dest_16bit_[kMaxBlockHeight * kMaxBlockWidth] = {};
   Pixel dest_clipped_[kMaxBlockHeight * kMaxBlockWidth] = {};
+  uint16_t base_dest_16bit_[kMaxBlockHeight * kMaxBlockWidth] = {};
+  Pixel base_dest_clipped_[kMaxBlockHeight * kMaxBlockWidth] = {};
 
   const int source_stride_ = kMaxBlockWidth;
   const int source_height_ = kMaxBlockHeight;
@@ -923,6 +941,80 @@ void ConvolveTest<bitdepth, Pixel>::Test(
   }
 }
 
+template <int bitdepth, typename Pixel>
+void ConvolveTest<bitdepth, Pixel>::TestExtremeValues() {
+  if (type_param_.is_intra_block_copy && type_param_.is_compound) return;
+  if (type_param_.is_compound || type_param_.is_intra_block_copy) {
+    if (param_.width < 4 || param_.height < 4) {
+      GTEST_SKIP();
+    }
+  }
+  if (cur_convolve_func_ == nullptr || base_convolve_func_ == nullptr) {
+    GTEST_SKIP();
+  }
+
+  constexpr int kMaxPixel = (1 << bitdepth) - 1;
+  constexpr int kNumPatterns = 4;
+  libvpx_test::ACMRandom rnd(libvpx_test::ACMRandom::DeterministicSeed());
+  const int offset =
+      kConvolveBorderLeftTop * kMaxBlockWidth + kConvolveBorderLeftTop;
+  const Pixel* const src = source_ + offset;
+  const ptrdiff_t src_stride = source_stride_ * sizeof(Pixel);
+  for (int pattern = 0; pattern < kNumPatterns; ++pattern) {
+    for (int y = 0; y < source_height_; ++y) {
+      for (int x = 0; x < source_stride_; ++x) {
+        int bit;
+        switch (pattern) {
+          case 0:
+            bit = x & 1;
+            break;
+          case 1:
+            bit = y & 1;
+            break;
+          case 2:
+            bit = (x ^ y) & 1;
+            break;
+          default:
+            bit = rnd.Rand8() & 1;
+            break;
+        }
+        source_[y * source_stride_ + x] = bit * kMaxPixel;
+      }
+    }
+    // Filter indices 4 and 5 are selected from 0 to 3 by GetFilterIndex().
+    for (int filter_index = 0; filter_index < 4; ++filter_index) {
+      for (int filter_id = 1; filter_id < 16; ++filter_id) {
+        if (type_param_.is_compound) {
+          base_convolve_func_(src, src_stride, filter_index, filter_index,
+                              filter_id, filter_id, param_.width,
+                              param_.height, base_dest_16bit_, param_.width);
+          cur_convolve_func_(src, src_stride, filter_index, filter_index,
+                             filter_id, filter_id, param_.width, param_.height,
+                             dest_16bit_, param_.width);
+          ASSERT_TRUE(test_utils::CompareBlocks(
+              base_dest_16bit_, dest_16bit_, param_.width, param_.height,
+              param_.width, param_.width, false))
+              << "pattern " << pattern << " filter " << filter_index << "/"
+              << filter_id;
+        } else {
+          const ptrdiff_t dst_stride = kMaxBlockWidth * sizeof(Pixel);
+          base_convolve_func_(src, src_stride, filter_index, filter_index,
+                              filter_id, filter_id, param_.width,
+                              param_.height, base_dest_clipped_, dst_stride);
+          cur_convolve_func_(src, src_stride, filter_index, filter_index,
+                             filter_id, filter_id, param_.width, param_.height,
+                             dest_clipped_, dst_stride);
+          ASSERT_TRUE(test_utils::CompareBlocks(
+              base_dest_clipped_, dest_clipped_, param_.width, param_.height,
+              kMaxBlockWidth, kMaxBlockWidth, false))
+              << "pattern " << pattern << " filter " << filter_index << "/"
+              << filter_id;
+        }
+      }
+    }
+  }
+}
+
 void ApplyFilterToSignedInput(const int min_input, const int max_input,
                               const int8_t filter[kSubPixelTaps],
                               int* min_output, int* max_output) {
@@ -1054,6 +1146,8 @@ TEST_P(ConvolveTest8bpp, FixedValues) {
 
 TEST_P(ConvolveTest8bpp, RandomValues) { Test(false, 0); }
 
+TEST_P(ConvolveTest8bpp, ExtremeValues) { TestExtremeValues(); }
+
 TEST_P(ConvolveTest8bpp, DISABLED_Speed) {
   const int num_runs = static_cast<int>(1.0e7 / (param_.width * param_.height));
   Test(false, 0, num_runs);
@@ -1084,9 +1178,21 @@ class ConvolveScaleTest
     } else if (absl::StartsWith(test_case, "SSE41/")) {
       if ((GetCpuInfo() & kSSE4_1) == 0) GTEST_SKIP() << "No SSE4.1 support!";
       ConvolveInit_SSE4_1();
+#if LIBGAV1_MAX_BITDEPTH >= 10
+      ConvolveInit10bpp_SSE4_1();
+#endif
+#if LIBGAV1_MAX_BITDEPTH == 12
+      ConvolveInit12bpp_SSE4_1();
+#endif
     } else if (absl::StartsWith(test_case, "AVX2/")) {
       if ((GetCpuInfo() & kAVX2) == 0) GTEST_SKIP() << "No AVX2 support!";
       ConvolveInit_AVX2();
+#if LIBGAV1_MAX_BITDEPTH >= 10
+      ConvolveInit10bpp_AVX2();
+#endif
+#if LIBGAV1_MAX_BITDEPTH == 12
+      ConvolveInit12bpp_AVX2();
+#endif
     } else if (absl::StartsWith(test_case, "NEON/")) {
       ConvolveInit_NEON();
 #if LIBGAV1_MAX_BITDEPTH >= 10
@@ -1460,6 +1566,8 @@ TEST_P(ConvolveTest10bpp, FixedValues) {
 
 TEST_P(ConvolveTest10bpp, RandomValues) { Test(false, 0); }
 
+TEST_P(ConvolveTest10bpp, ExtremeValues) { TestExtremeValues(); }
+
 TEST_P(ConvolveTest10bpp, DISABLED_Speed) {
   const int num_runs = static_cast<int>(1.0e7 / (param_.width * param_.height));
   Test(false, 0, num_runs);
@@ -1497,6 +1605,18 @@ INSTANTIATE_TEST_SUITE_P(NEON, ConvolveScaleTest10bpp,
                                           testing::ValuesIn(kConvolveParam)));
 #endif  // LIBGAV1_ENABLE_NEON
 
+#if LIBGAV1_ENABLE_SSE4_1
+INSTANTIATE_TEST_SUITE_P(SSE41, ConvolveTest10bpp,
+                         testing::Combine(testing::ValuesIn(kConvolveTypeParam),
+                                          testing::ValuesIn(kConvolveParam)));
+#endif  // LIBGAV1_ENABLE_SSE4_1
+
+#if LIBGAV1_ENABLE_AVX2
+INSTANTIATE_TEST_SUITE_P(AVX2, ConvolveTest10bpp,
+                         testing::Combine(testing::ValuesIn(kConvolveTypeParam),
+                                          testing::ValuesIn(kConvolveParam)));
+#endif  // LIBGAV1_ENABLE_AVX2
+
 #endif  // LIBGAV1_MAX_BITDEPTH >= 10
 
 #if LIBGAV1_MAX_BITDEPTH == 12
@@ -1511,6 +1631,8 @@ TEST_P(ConvolveTest12bpp, FixedValues) {
 
 TEST_P(ConvolveTest12bpp, RandomValues) { Test(false, 0); }
 
+TEST_P(ConvolveTest12bpp, ExtremeValues) { TestExtremeValues(); }
+
 TEST_P(ConvolveTest12bpp, DISABLED_Speed) {
   const int num_runs = static_cast<int>(1.0e7 / (param_.width * param_.height));
   Test(false, 0, num_runs);
@@ -1538,6 +1660,18 @@ INSTANTIATE_TEST_SUITE_P(C, ConvolveTest12bpp,
 INSTANTIATE_TEST_SUITE_P(C, ConvolveScaleTest12bpp,
                          testing::Combine(testing::Bool(),
                                           testing::ValuesIn(kConvolveParam)));
+
+#if LIBGAV1_ENABLE_SSE4_1
+INSTANTIATE_TEST_SUITE_P(SSE41, ConvolveTest12bpp,
+                         testing::Combine(testing::ValuesIn(kConvolveTypeParam),
+                                          testing::ValuesIn(kConvolveParam)));
+#endif  // LIBGAV1_ENABLE_SSE4_1
+
+#if LIBGAV1_ENABLE_AVX2
+INSTANTIATE_TEST_SUITE_P(AVX2, ConvolveTest12bpp,
+                         testing::Combine(testing::ValuesIn(kConvolveTypeParam),
+                                          testing::ValuesIn(kConvolveParam)));
+#endif  // LIBGAV1_ENABLE_AVX2
 #endif  // LIBGAV1_MAX_BITDEPTH == 12
 
 }  // namespace
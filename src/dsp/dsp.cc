@@ -123,20 +123,45 @@ void DspInit() {
       WarpInit_SSE4_1();
       WeightMaskInit_SSE4_1();
 #if LIBGAV1_MAX_BITDEPTH >= 10
+      ConvolveInit10bpp_SSE4_1();
+      InverseTransformInit10bpp_SSE4_1();
       LoopRestorationInit10bpp_SSE4_1();
+      WarpInit10bpp_SSE4_1();
 #endif  // LIBGAV1_MAX_BITDEPTH >= 10
+#if LIBGAV1_MAX_BITDEPTH == 12
+      ConvolveInit12bpp_SSE4_1();
+      InverseTransformInit12bpp_SSE4_1();
+      LoopRestorationInit12bpp_SSE4_1();
+#endif  // LIBGAV1_MAX_BITDEPTH == 12
     }
 #endif  // LIBGAV1_ENABLE_SSE4_1
 #if LIBGAV1_ENABLE_AVX2
     if ((cpu_features & kAVX2) != 0) {
       CdefInit_AVX2();
       ConvolveInit_AVX2();
+      InverseTransformInit_AVX2();
       LoopRestorationInit_AVX2();
 #if LIBGAV1_MAX_BITDEPTH >= 10
+      ConvolveInit10bpp_AVX2();
+      InverseTransformInit10bpp_AVX2();
       LoopRestorationInit10bpp_AVX2();
 #endif  // LIBGAV1_MAX_BITDEPTH >= 10
+#if LIBGAV1_MAX_BITDEPTH == 12
+      ConvolveInit12bpp_AVX2();
+      InverseTransformInit12bpp_AVX2();
+      LoopRestorationInit12bpp_AVX2();
+#endif  // LIBGAV1_MAX_BITDEPTH == 12
     }
 #endif  // LIBGAV1_ENABLE_AVX2
+#if LIBGAV1_ENABLE_AVX512
+    // These are run after the avx2 functions, replacing the entries they
+    // implement.
+    constexpr uint32_t kAVX512 = kAVX2 | kAVX512BW | kAVX512VL;
+    if ((cpu_features & kAVX512) == kAVX512) {
+      CdefInit_AVX512();
+      LoopRestorationInit_AVX512();
+    }
+#endif  // LIBGAV1_ENABLE_AVX512
 #endif  // LIBGAV1_ENABLE_SSE4_1 || LIBGAV1_ENABLE_AVX2
 #if LIBGAV1_ENABLE_NEON
     AverageBlendInit_NEON();
@@ -183,6 +183,18 @@ class InverseTransformTest
     } else if (absl::StartsWith(test_case, "SSE41/")) {
       if ((GetCpuInfo() & kSSE4_1) == 0) GTEST_SKIP() << "No SSE4.1 support!";
       InverseTransformInit_SSE4_1();
+      InverseTransformInit10bpp_SSE4_1();
+      InverseTransformInit12bpp_SSE4_1();
+    } else if (absl::StartsWith(test_case, "AVX2/")) {
+      if ((GetCpuInfo() & kAVX2) == 0) GTEST_SKIP() << "No AVX2 support!";
+      // The avx2 transforms only cover the larger sizes; the remaining 1D
+      // transforms are implemented with sse4.
+      InverseTransformInit_SSE4_1();
+      InverseTransformInit10bpp_SSE4_1();
+      InverseTransformInit12bpp_SSE4_1();
+      InverseTransformInit_AVX2();
+      InverseTransformInit10bpp_AVX2();
+      InverseTransformInit12bpp_AVX2();
     } else if (absl::StartsWith(test_case, "NEON/")) {
       InverseTransformInit_NEON();
       InverseTransformInit10bpp_NEON();
@@ -217,6 +229,7 @@ class InverseTransformTest
   // These tests modify inverse_transform_mem_.
   void TestRandomValues(int num_tests);
   void TestDcOnlyRandomValue(int num_tests);
+  void TestExtremeValues();
 
   Array2DView<DstPixel> base_frame_buffer_;
   Array2DView<DstPixel> cur_frame_buffer_;
@@ -488,6 +501,95 @@ void InverseTransformTest<bitdepth, Pixel, DstPixel>::TestDcOnlyRandomValue(
   }
 }
 
+// Fills the coefficients with the largest magnitudes the dequantizer can
+// produce (bitdepth + 8 bits), in patterns that maximize the intermediate
+// values of the butterflies. The random tests use much smaller coefficients,
+// so they do not catch intermediates that overflow their lanes.
+template <int bitdepth, typename Pixel, typename DstPixel>
+void InverseTransformTest<bitdepth, Pixel, DstPixel>::TestExtremeValues() {
+  constexpr int kMaxCoefficient = (1 << (bitdepth + 7)) - 1;
+  constexpr int kMinCoefficient = -(1 << (bitdepth + 7));
+  constexpr int kNumPatterns = 5;
+  libvpx_test::ACMRandom rnd(libvpx_test::ACMRandom::DeterministicSeed());
+
+  for (int tx_type_idx = 0; tx_type_idx < kNumTransformTypes; ++tx_type_idx) {
+    const TransformType tx_type = kLibgav1TxType[tx_type_idx];
+    const Transform1d row_transform = kRowTransform[tx_type];
+    const Transform1d column_transform = kColumnTransform[tx_type];
+
+    if (base_inverse_transforms_[row_transform][tx_size_1d_row_][kRow] ==
+            nullptr ||
+        cur_inverse_transforms_[row_transform][tx_size_1d_row_][kRow] ==
+            nullptr ||
+        base_inverse_transforms_[column_transform][tx_size_1d_column_]
+                                [kColumn] == nullptr ||
+        cur_inverse_transforms_[column_transform][tx_size_1d_column_]
+                               [kColumn] == nullptr) {
+      continue;
+    }
+
+    // Only test valid tx_size for given tx_type.  See 5.11.40.
+    if (!IsTxSizeTypeValid(tx_size_, tx_type)) continue;
+
+    for (int pattern = 0; pattern < kNumPatterns; ++pattern) {
+      const int tx_height = std::min(block_height_, 32);
+      inverse_transform_mem_.Reset(&rnd, block_width_, block_height_);
+      Pixel* const src = inverse_transform_mem_.ref_src;
+      for (int y = 0; y < tx_height; ++y) {
+        for (int x = 0; x < std::min(block_width_, 32); ++x) {
+          bool positive;
+          switch (pattern) {
+            case 0:
+              positive = true;
+              break;
+            case 1:
+              positive = false;
+              break;
+            case 2:
+              positive = (x & 1) == 0;
+              break;
+            case 3:
+              positive = ((x ^ y) & 1) == 0;
+              break;
+            default:
+              positive = (rnd.Rand8() & 1) != 0;
+              break;
+          }
+          src[y * block_width_ + x] = positive ? kMaxCoefficient
+                                               : kMinCoefficient;
+        }
+      }
+      memcpy(inverse_transform_mem_.base_residual, src,
+             sizeof(inverse_transform_mem_.ref_src));
+      memcpy(inverse_transform_mem_.cur_residual, src,
+             sizeof(inverse_transform_mem_.ref_src));
+
+      base_inverse_transforms_[row_transform][tx_size_1d_row_][kRow](
+          tx_type, tx_size_, tx_height, inverse_transform_mem_.base_residual,
+          0, 0, &base_frame_buffer_);
+      cur_inverse_transforms_[row_transform][tx_size_1d_row_][kRow](
+          tx_type, tx_size_, tx_height, inverse_transform_mem_.cur_residual, 0,
+          0, &cur_frame_buffer_);
+      base_inverse_transforms_[column_transform][tx_size_1d_column_][kColumn](
+          tx_type, tx_size_, tx_height, inverse_transform_mem_.base_residual,
+          0, 0, &base_frame_buffer_);
+      cur_inverse_transforms_[column_transform][tx_size_1d_column_][kColumn](
+          tx_type, tx_size_, tx_height, inverse_transform_mem_.cur_residual, 0,
+          0, &cur_frame_buffer_);
+
+      if (!test_utils::CompareBlocks(inverse_transform_mem_.base_frame,
+                                     inverse_transform_mem_.cur_frame,
+                                     block_width_, block_height_, kMaxBlockSize,
+                                     kMaxBlockSize, false)) {
+        ADD_FAILURE() << "Result from optimized version of "
+                      << ToString(tx_type) << " differs from reference with "
+                      << "extreme coefficient pattern #" << pattern;
+        break;
+      }
+    }
+  }
+}
+
 using InverseTransformTest8bpp = InverseTransformTest<8, int16_t, uint8_t>;
 
 TEST_P(InverseTransformTest8bpp, Random) { TestRandomValues(1); }
@@ -515,6 +617,10 @@ INSTANTIATE_TEST_SUITE_P(NEON, InverseTransformTest8bpp,
 INSTANTIATE_TEST_SUITE_P(SSE41, InverseTransformTest8bpp,
                          testing::ValuesIn(kTransformSizesAll));
 #endif
+#if LIBGAV1_ENABLE_AVX2
+INSTANTIATE_TEST_SUITE_P(AVX2, InverseTransformTest8bpp,
+                         testing::ValuesIn(kTransformSizesAll));
+#endif
 
 #if LIBGAV1_MAX_BITDEPTH >= 10
 using InverseTransformTest10bpp = InverseTransformTest<10, int32_t, uint16_t>;
@@ -525,6 +631,8 @@ TEST_P(InverseTransformTest10bpp, DISABLED_Speed) { TestRandomValues(10000); }
 
 TEST_P(InverseTransformTest10bpp, DcRandom) { TestDcOnlyRandomValue(1); }
 
+TEST_P(InverseTransformTest10bpp, ExtremeValues) { TestExtremeValues(); }
+
 INSTANTIATE_TEST_SUITE_P(C, InverseTransformTest10bpp,
                          testing::ValuesIn(kTransformSizesAll));
 
@@ -532,6 +640,14 @@ INSTANTIATE_TEST_SUITE_P(C, InverseTransformTest10bpp,
 INSTANTIATE_TEST_SUITE_P(NEON, InverseTransformTest10bpp,
                          testing::ValuesIn(kTransformSizesAll));
 #endif
+#if LIBGAV1_ENABLE_SSE4_1
+INSTANTIATE_TEST_SUITE_P(SSE41, InverseTransformTest10bpp,
+                         testing::ValuesIn(kTransformSizesAll));
+#endif
+#if LIBGAV1_ENABLE_AVX2
+INSTANTIATE_TEST_SUITE_P(AVX2, InverseTransformTest10bpp,
+                         testing::ValuesIn(kTransformSizesAll));
+#endif
 #endif  // LIBGAV1_MAX_BITDEPTH >= 10
 
 #if LIBGAV1_MAX_BITDEPTH == 12
@@ -543,8 +659,19 @@ TEST_P(InverseTransformTest12bpp, DISABLED_Speed) { TestRandomValues(12000); }
 
 TEST_P(InverseTransformTest12bpp, DcRandom) { TestDcOnlyRandomValue(1); }
 
+TEST_P(InverseTransformTest12bpp, ExtremeValues) { TestExtremeValues(); }
+
 INSTANTIATE_TEST_SUITE_P(C, InverseTransformTest12bpp,
                          testing::ValuesIn(kTransformSizesAll));
+
+#if LIBGAV1_ENABLE_SSE4_1
+INSTANTIATE_TEST_SUITE_P(SSE41, InverseTransformTest12bpp,
+                         testing::ValuesIn(kTransformSizesAll));
+#endif
+#if LIBGAV1_ENABLE_AVX2
+INSTANTIATE_TEST_SUITE_P(AVX2, InverseTransformTest12bpp,
+                         testing::ValuesIn(kTransformSizesAll));
+#endif
 #endif  // LIBGAV1_MAX_BITDEPTH == 12
 
 }  // namespace
@@ -74,12 +74,24 @@ list(APPEND libgav1_dsp_sources
             "${libgav1_source}/dsp/weight_mask.cc"
             "${libgav1_source}/dsp/weight_mask.h")
 
+list(APPEND libgav1_dsp_sources_avx512
+            ${libgav1_dsp_sources_avx512}
+            "${libgav1_source}/dsp/x86/cdef_avx512.cc"
+            "${libgav1_source}/dsp/x86/cdef_avx512.h"
+            "${libgav1_source}/dsp/x86/common_avx512.h"
+            "${libgav1_source}/dsp/x86/loop_restoration_avx512.cc"
+            "${libgav1_source}/dsp/x86/loop_restoration_avx512.h")
+
 list(APPEND libgav1_dsp_sources_avx2
             ${libgav1_dsp_sources_avx2}
             "${libgav1_source}/dsp/x86/cdef_avx2.cc"
             "${libgav1_source}/dsp/x86/cdef_avx2.h"
+            "${libgav1_source}/dsp/x86/convolve_10bit_avx2.cc"
             "${libgav1_source}/dsp/x86/convolve_avx2.cc"
             "${libgav1_source}/dsp/x86/convolve_avx2.h"
+            "${libgav1_source}/dsp/x86/inverse_transform_10bit_avx2.cc"
+            "${libgav1_source}/dsp/x86/inverse_transform_avx2.cc"
+            "${libgav1_source}/dsp/x86/inverse_transform_avx2.h"
             "${libgav1_source}/dsp/x86/loop_restoration_10bit_avx2.cc"
             "${libgav1_source}/dsp/x86/loop_restoration_avx2.cc"
             "${libgav1_source}/dsp/x86/loop_restoration_avx2.h")
@@ -141,6 +153,7 @@ list(APPEND libgav1_dsp_sources_sse4
             "${libgav1_source}/dsp/x86/common_sse4.h"
             "${libgav1_source}/dsp/x86/cdef_sse4.cc"
             "${libgav1_source}/dsp/x86/cdef_sse4.h"
+            "${libgav1_source}/dsp/x86/convolve_10bit_sse4.cc"
             "${libgav1_source}/dsp/x86/convolve_sse4.cc"
             "${libgav1_source}/dsp/x86/convolve_sse4.h"
             "${libgav1_source}/dsp/x86/convolve_sse4.inc"
@@ -160,6 +173,8 @@ list(APPEND libgav1_dsp_sources_sse4
             "${libgav1_source}/dsp/x86/intrapred_sse4.h"
             "${libgav1_source}/dsp/x86/intrapred_smooth_sse4.cc"
             "${libgav1_source}/dsp/x86/intrapred_smooth_sse4.h"
+            "${libgav1_source}/dsp/x86/inverse_transform_10bit_sse4.cc"
+            "${libgav1_source}/dsp/x86/inverse_transform_10bit_sse4.inc"
             "${libgav1_source}/dsp/x86/inverse_transform_sse4.cc"
             "${libgav1_source}/dsp/x86/inverse_transform_sse4.h"
             "${libgav1_source}/dsp/x86/loop_filter_sse4.cc"
@@ -178,6 +193,7 @@ list(APPEND libgav1_dsp_sources_sse4
             "${libgav1_source}/dsp/x86/super_res_sse4.cc"
             "${libgav1_source}/dsp/x86/super_res_sse4.h"
             "${libgav1_source}/dsp/x86/transpose_sse4.h"
+            "${libgav1_source}/dsp/x86/warp_10bit_sse4.cc"
             "${libgav1_source}/dsp/x86/warp_sse4.cc"
             "${libgav1_source}/dsp/x86/warp_sse4.h"
             "${libgav1_source}/dsp/x86/weight_mask_sse4.cc"
@@ -187,6 +203,7 @@ macro(libgav1_add_dsp_targets)
   unset(dsp_sources)
   list(APPEND dsp_sources ${libgav1_dsp_sources}
               ${libgav1_dsp_sources_neon}
+              ${libgav1_dsp_sources_avx512}
               ${libgav1_dsp_sources_avx2}
               ${libgav1_dsp_sources_sse4})
 
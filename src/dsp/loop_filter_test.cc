@@ -397,6 +397,11 @@ TEST_P(LoopFilterTest12bpp, SaturatedValues) { TestSaturatedValues(); }
 
 INSTANTIATE_TEST_SUITE_P(C, LoopFilterTest12bpp,
                          testing::ValuesIn(kLoopFilterSizes));
+
+#if LIBGAV1_ENABLE_SSE4_1
+INSTANTIATE_TEST_SUITE_P(SSE41, LoopFilterTest12bpp,
+                         testing::ValuesIn(kLoopFilterSizes));
+#endif
 #endif  // LIBGAV1_MAX_BITDEPTH == 12
 
 }  // namespace
@@ -79,6 +79,9 @@ class SelfGuidedFilterTest : public testing::TestWithParam<int>,
       LoopRestorationInit_SSE4_1();
 #if LIBGAV1_MAX_BITDEPTH >= 10
       LoopRestorationInit10bpp_SSE4_1();
+#endif
+#if LIBGAV1_MAX_BITDEPTH == 12
+      LoopRestorationInit12bpp_SSE4_1();
 #endif
     } else if (absl::StartsWith(test_case, "NEON/")) {
       LoopRestorationInit_NEON();
@@ -356,6 +359,11 @@ TEST_P(SelfGuidedFilterTest12bpp, DISABLED_Speed) { TestRandomValues(true); }
 
 INSTANTIATE_TEST_SUITE_P(C, SelfGuidedFilterTest12bpp,
                          testing::ValuesIn(kUnitWidths));
+
+#if LIBGAV1_ENABLE_SSE4_1
+INSTANTIATE_TEST_SUITE_P(SSE41, SelfGuidedFilterTest12bpp,
+                         testing::ValuesIn(kUnitWidths));
+#endif
 #endif  // LIBGAV1_MAX_BITDEPTH == 12
 
 template <int bitdepth, typename Pixel>
@@ -378,17 +386,29 @@ class WienerFilterTest : public testing::TestWithParam<int>,
         testing::UnitTest::GetInstance()->current_test_info();
     const char* const test_case = test_info->test_suite_name();
     if (absl::StartsWith(test_case, "C/")) {
+    } else if (absl::StartsWith(test_case, "AVX512/")) {
+      if ((GetCpuInfo() & (kAVX512BW | kAVX512VL)) !=
+          (kAVX512BW | kAVX512VL)) {
+        GTEST_SKIP() << "No AVX-512 support!";
+      }
+      LoopRestorationInit_AVX512();
     } else if (absl::StartsWith(test_case, "AVX2/")) {
       if ((GetCpuInfo() & kAVX2) == 0) GTEST_SKIP() << "No AVX2 support!";
       LoopRestorationInit_AVX2();
 #if LIBGAV1_MAX_BITDEPTH >= 10
       LoopRestorationInit10bpp_AVX2();
+#endif
+#if LIBGAV1_MAX_BITDEPTH == 12
+      LoopRestorationInit12bpp_AVX2();
 #endif
     } else if (absl::StartsWith(test_case, "SSE41/")) {
       if ((GetCpuInfo() & kSSE4_1) == 0) GTEST_SKIP() << "No SSE4.1 support!";
       LoopRestorationInit_SSE4_1();
 #if LIBGAV1_MAX_BITDEPTH >= 10
       LoopRestorationInit10bpp_SSE4_1();
+#endif
+#if LIBGAV1_MAX_BITDEPTH == 12
+      LoopRestorationInit12bpp_SSE4_1();
 #endif
     } else if (absl::StartsWith(test_case, "NEON/")) {
       LoopRestorationInit_NEON();
@@ -637,6 +657,10 @@ INSTANTIATE_TEST_SUITE_P(C, WienerFilterTest8bpp,
 INSTANTIATE_TEST_SUITE_P(AVX2, WienerFilterTest8bpp,
                          testing::ValuesIn(kUnitWidths));
 #endif
+#if LIBGAV1_ENABLE_AVX512
+INSTANTIATE_TEST_SUITE_P(AVX512, WienerFilterTest8bpp,
+                         testing::ValuesIn(kUnitWidths));
+#endif
 #if LIBGAV1_ENABLE_SSE4_1
 INSTANTIATE_TEST_SUITE_P(SSE41, WienerFilterTest8bpp,
                          testing::ValuesIn(kUnitWidths));
@@ -695,6 +719,15 @@ TEST_P(WienerFilterTest12bpp, TestCompare2C) { TestCompare2C(); }
 
 INSTANTIATE_TEST_SUITE_P(C, WienerFilterTest12bpp,
                          testing::ValuesIn(kUnitWidths));
+
+#if LIBGAV1_ENABLE_AVX2
+INSTANTIATE_TEST_SUITE_P(AVX2, WienerFilterTest12bpp,
+                         testing::ValuesIn(kUnitWidths));
+#endif
+#if LIBGAV1_ENABLE_SSE4_1
+INSTANTIATE_TEST_SUITE_P(SSE41, WienerFilterTest12bpp,
+                         testing::ValuesIn(kUnitWidths));
+#endif
 #endif  // LIBGAV1_MAX_BITDEPTH == 12
 
 }  // namespace
@@ -277,6 +277,7 @@ class WarpTest : public testing::TestWithParam<WarpTestParam> {
     } else if (absl::StartsWith(test_case, "SSE41/")) {
       if ((GetCpuInfo() & kSSE4_1) == 0) GTEST_SKIP() << "No SSE4.1 support!";
       WarpInit_SSE4_1();
+      WarpInit10bpp_SSE4_1();
     } else {
       FAIL() << "Unrecognized architecture prefix in test case name: "
              << test_case;
@@ -669,9 +670,7 @@ INSTANTIATE_TEST_SUITE_P(SSE41, WarpTest8bpp,
 
 #if LIBGAV1_MAX_BITDEPTH >= 10
 using WarpTest10bpp = WarpTest</*is_compound=*/false, 10, uint16_t>;
-// TODO(jzern): Coverage could be added for kInterRoundBitsCompoundVertical via
-// WarpCompoundTest.
-// using WarpCompoundTest10bpp = WarpTest</*is_compound=*/true, 10, uint16_t>;
+using WarpCompoundTest10bpp = WarpTest</*is_compound=*/true, 10, uint16_t>;
 
 TEST_P(WarpTest10bpp, FixedValues) { TestFixedValues(); }
 
@@ -679,12 +678,27 @@ TEST_P(WarpTest10bpp, RandomValues) { TestRandomValues(); }
 
 TEST_P(WarpTest10bpp, DISABLED_Speed) { TestSpeed(); }
 
+TEST_P(WarpCompoundTest10bpp, FixedValues) { TestFixedValues(); }
+
+TEST_P(WarpCompoundTest10bpp, RandomValues) { TestRandomValues(); }
+
+TEST_P(WarpCompoundTest10bpp, DISABLED_Speed) { TestSpeed(); }
+
 INSTANTIATE_TEST_SUITE_P(C, WarpTest10bpp, testing::ValuesIn(warp_test_param));
+INSTANTIATE_TEST_SUITE_P(C, WarpCompoundTest10bpp,
+                         testing::ValuesIn(warp_test_param));
 
 #if LIBGAV1_ENABLE_NEON
 INSTANTIATE_TEST_SUITE_P(NEON, WarpTest10bpp,
                          testing::ValuesIn(warp_test_param));
 #endif
+
+#if LIBGAV1_ENABLE_SSE4_1
+INSTANTIATE_TEST_SUITE_P(SSE41, WarpTest10bpp,
+                         testing::ValuesIn(warp_test_param));
+INSTANTIATE_TEST_SUITE_P(SSE41, WarpCompoundTest10bpp,
+                         testing::ValuesIn(warp_test_param));
+#endif
 #endif  // LIBGAV1_MAX_BITDEPTH >= 10
 
 #if LIBGAV1_MAX_BITDEPTH == 12
@@ -0,0 +1,318 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "src/dsp/cdef.h"
+#include "src/utils/cpu.h"
+
+#if LIBGAV1_TARGETING_AVX512
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include "src/dsp/constants.h"
+#include "src/dsp/dsp.h"
+#include "src/dsp/x86/common_avx512.h"
+#include "src/utils/common.h"
+#include "src/utils/constants.h"
+
+namespace libgav1 {
+namespace dsp {
+namespace low_bitdepth {
+namespace {
+
+#include "src/dsp/cdef.inc"
+
+// -------------------------------------------------------------------------
+// CdefFilter
+//
+// Each 128-bit lane of a vector holds an independent group of pixels: one row
+// when |width| == 8 and two rows when |width| == 4. This allows each tap to be
+// applied to 4 or 8 rows with one instruction, compared to 1 or 2 rows with
+// avx2, which packs the two taps of a direction into the halves of a vector.
+
+// Loads the 4 lanes starting at |src|. |num_lanes| is the number of lanes which
+// hold valid rows. When it is 2 the first two lanes are repeated.
+template <int width>
+inline __m512i LoadLanes(const uint16_t* LIBGAV1_RESTRICT const src,
+                         const ptrdiff_t stride, const int num_lanes) {
+  const ptrdiff_t lane_stride = (width == 8) ? stride : stride << 1;
+  const int mask = num_lanes - 1;
+  __m128i lanes[4];
+  for (int i = 0; i < 4; ++i) {
+    const uint16_t* const lane = src + (i & mask) * lane_stride;
+    if (width == 8) {
+      lanes[i] = LoadUnaligned16(lane);
+    } else {
+      lanes[i] = LoadHi8(LoadLo8(lane), lane + stride);
+    }
+  }
+  return SetrM128i(lanes[0], lanes[1], lanes[2], lanes[3]);
+}
+
+// Load 2 vectors based on the given |direction|. See LoadDirection() in
+// cdef_avx2.cc for the layout of the taps.
+template <int width>
+inline void LoadDirection(const uint16_t* LIBGAV1_RESTRICT const src,
+                          const ptrdiff_t stride, const int num_lanes,
+                          __m512i* output, const int direction,
+                          const int tap) {
+  const int y = kCdefDirections[direction][tap][0];
+  const int x = kCdefDirections[direction][tap][1];
+  output[0] = LoadLanes<width>(src - y * stride - x, stride, num_lanes);
+  output[1] = LoadLanes<width>(src + y * stride + x, stride, num_lanes);
+}
+
+inline __m512i Constrain(const __m512i& pixel, const __m512i& reference,
+                         const __m128i& damping, const __m512i& threshold) {
+  const __m512i diff = _mm512_sub_epi16(pixel, reference);
+  const __m512i abs_diff = _mm512_abs_epi16(diff);
+  // sign(diff) * Clip3(threshold - (std::abs(diff) >> damping),
+  //                    0, std::abs(diff))
+  const __m512i shifted_diff = _mm512_srl_epi16(abs_diff, damping);
+  // For bitdepth == 8, the threshold range is [0, 15] and the damping range is
+  // [3, 6]. If pixel == kCdefLargeValue(0x4000), shifted_diff will always be
+  // larger than threshold. Subtract using saturation will return 0 when pixel
+  // == kCdefLargeValue.
+  static_assert(kCdefLargeValue == 0x4000, "Invalid kCdefLargeValue");
+  const __m512i thresh_minus_shifted_diff =
+      _mm512_subs_epu16(threshold, shifted_diff);
+  const __m512i clamp_abs_diff =
+      _mm512_min_epi16(thresh_minus_shifted_diff, abs_diff);
+  // Restore the sign. There is no avx512 version of _mm256_sign_epi16().
+  const __mmask32 negative =
+      _mm512_cmplt_epi16_mask(diff, _mm512_setzero_si512());
+  return _mm512_mask_sub_epi16(clamp_abs_diff, negative, _mm512_setzero_si512(),
+                               clamp_abs_diff);
+}
+
+inline __m512i ApplyConstrainAndTap(const __m512i& pixel, const __m512i& val,
+                                    const __m512i& tap, const __m128i& damping,
+                                    const __m512i& threshold) {
+  const __m512i constrained = Constrain(val, pixel, damping, threshold);
+  return _mm512_mullo_epi16(constrained, tap);
+}
+
+template <int width, bool enable_primary = true, bool enable_secondary = true>
+void CdefFilter_AVX512(const uint16_t* LIBGAV1_RESTRICT src,
+                       const ptrdiff_t src_stride, const int height,
+                       const int primary_strength,
+                       const int secondary_strength, const int damping,
+                       const int direction, void* LIBGAV1_RESTRICT dest,
+                       const ptrdiff_t dst_stride) {
+  static_assert(width == 8 || width == 4, "Invalid CDEF width.");
+  static_assert(enable_primary || enable_secondary, "");
+  constexpr bool clipping_required = enable_primary && enable_secondary;
+  constexpr int rows_per_lane = (width == 8) ? 1 : 2;
+  auto* dst = static_cast<uint8_t*>(dest);
+  __m128i primary_damping_shift, secondary_damping_shift;
+
+  // FloorLog2() requires input to be > 0.
+  // 8-bit damping range: Y: [3, 6], UV: [2, 5].
+  if (enable_primary) {
+    // primary_strength: [0, 15] -> FloorLog2: [0, 3] so a clamp is necessary
+    // for UV filtering.
+    primary_damping_shift =
+        _mm_cvtsi32_si128(std::max(0, damping - FloorLog2(primary_strength)));
+  }
+  if (enable_secondary) {
+    // secondary_strength: [0, 4] -> FloorLog2: [0, 2] so no clamp to 0 is
+    // necessary.
+    assert(damping - FloorLog2(secondary_strength) >= 0);
+    secondary_damping_shift =
+        _mm_cvtsi32_si128(damping - FloorLog2(secondary_strength));
+  }
+  const __m512i primary_tap_0 =
+      _mm512_set1_epi16(kCdefPrimaryTaps[primary_strength & 1][0]);
+  const __m512i primary_tap_1 =
+      _mm512_set1_epi16(kCdefPrimaryTaps[primary_strength & 1][1]);
+  const __m512i secondary_tap_0 = _mm512_set1_epi16(kCdefSecondaryTap0);
+  const __m512i secondary_tap_1 = _mm512_set1_epi16(kCdefSecondaryTap1);
+  const __m512i cdef_large_value_mask =
+      _mm512_set1_epi16(static_cast<int16_t>(~kCdefLargeValue));
+  const __m512i primary_threshold = _mm512_set1_epi16(primary_strength);
+  const __m512i secondary_threshold = _mm512_set1_epi16(secondary_strength);
+
+  // |height| is 4 or 8. When 4 rows of 4 pixels are filtered only 2 lanes
+  // are needed.
+  const int num_lanes = std::min(4, height / rows_per_lane);
+  const int rows_per_step = num_lanes * rows_per_lane;
+  int y = height;
+  do {
+    const __m512i pixel = LoadLanes<width>(src, src_stride, num_lanes);
+
+    __m512i min = pixel;
+    __m512i max = pixel;
+    __m512i sum;
+
+    if (enable_primary) {
+      // Primary |direction|.
+      __m512i primary_val[4];
+      LoadDirection<width>(src, src_stride, num_lanes, primary_val, direction,
+                           0);
+      LoadDirection<width>(src, src_stride, num_lanes, primary_val + 2,
+                           direction, 1);
+
+      if (clipping_required) {
+        min = _mm512_min_epu16(min, primary_val[0]);
+        min = _mm512_min_epu16(min, primary_val[1]);
+        min = _mm512_min_epu16(min, primary_val[2]);
+        min = _mm512_min_epu16(min, primary_val[3]);
+
+        // The source is 16 bits, however, we only really care about the lower
+        // 8 bits.  The upper 8 bits contain the "large" flag.  After the final
+        // primary max has been calculated, zero out the upper 8 bits.  Use this
+        // to find the "16 bit" max.
+        const __m512i max_p01 = _mm512_max_epu8(primary_val[0], primary_val[1]);
+        const __m512i max_p23 = _mm512_max_epu8(primary_val[2], primary_val[3]);
+        const __m512i max_p = _mm512_max_epu8(max_p01, max_p23);
+        max = _mm512_max_epu16(max,
+                               _mm512_and_si512(max_p, cdef_large_value_mask));
+      }
+
+      sum = ApplyConstrainAndTap(pixel, primary_val[0], primary_tap_0,
+                                 primary_damping_shift, primary_threshold);
+      sum = _mm512_add_epi16(
+          sum, ApplyConstrainAndTap(pixel, primary_val[1], primary_tap_0,
+                                    primary_damping_shift, primary_threshold));
+      sum = _mm512_add_epi16(
+          sum, ApplyConstrainAndTap(pixel, primary_val[2], primary_tap_1,
+                                    primary_damping_shift, primary_threshold));
+      sum = _mm512_add_epi16(
+          sum, ApplyConstrainAndTap(pixel, primary_val[3], primary_tap_1,
+                                    primary_damping_shift, primary_threshold));
+    } else {
+      sum = _mm512_setzero_si512();
+    }
+
+    if (enable_secondary) {
+      // Secondary |direction| values (+/- 2). Clamp |direction|.
+      __m512i secondary_val[8];
+      LoadDirection<width>(src, src_stride, num_lanes, secondary_val,
+                           direction + 2, 0);
+      LoadDirection<width>(src, src_stride, num_lanes, secondary_val + 2,
+                           direction + 2, 1);
+      LoadDirection<width>(src, src_stride, num_lanes, secondary_val + 4,
+                           direction - 2, 0);
+      LoadDirection<width>(src, src_stride, num_lanes, secondary_val + 6,
+                           direction - 2, 1);
+
+      if (clipping_required) {
+        __m512i max_s = secondary_val[0];
+        for (int i = 0; i < 8; ++i) {
+          min = _mm512_min_epu16(min, secondary_val[i]);
+          max_s = _mm512_max_epu8(max_s, secondary_val[i]);
+        }
+        max = _mm512_max_epu16(max,
+                               _mm512_and_si512(max_s, cdef_large_value_mask));
+      }
+
+      for (int i = 0; i < 8; i += 4) {
+        sum = _mm512_add_epi16(
+            sum,
+            ApplyConstrainAndTap(pixel, secondary_val[i], secondary_tap_0,
+                                 secondary_damping_shift, secondary_threshold));
+        sum = _mm512_add_epi16(
+            sum,
+            ApplyConstrainAndTap(pixel, secondary_val[i + 1], secondary_tap_0,
+                                 secondary_damping_shift, secondary_threshold));
+        sum = _mm512_add_epi16(
+            sum,
+            ApplyConstrainAndTap(pixel, secondary_val[i + 2], secondary_tap_1,
+                                 secondary_damping_shift, secondary_threshold));
+        sum = _mm512_add_epi16(
+            sum,
+            ApplyConstrainAndTap(pixel, secondary_val[i + 3], secondary_tap_1,
+                                 secondary_damping_shift, secondary_threshold));
+      }
+    }
+
+    // Clip3(pixel + ((8 + sum - (sum < 0)) >> 4), min, max))
+    const __m512i sum_lt_0 = _mm512_srai_epi16(sum, 15);
+    // 8 + sum
+    sum = _mm512_add_epi16(sum, _mm512_set1_epi16(8));
+    // (... - (sum < 0)) >> 4
+    sum = _mm512_add_epi16(sum, sum_lt_0);
+    sum = _mm512_srai_epi16(sum, 4);
+    // pixel + ...
+    sum = _mm512_add_epi16(sum, pixel);
+    if (clipping_required) {
+      // Clip3
+      sum = _mm512_min_epi16(sum, max);
+      sum = _mm512_max_epi16(sum, min);
+    } else {
+      sum = _mm512_max_epi16(sum, _mm512_setzero_si512());
+    }
+
+    // The lanes are stored in order, giving the rows in order.
+    const __m256i result = _mm512_cvtusepi16_epi8(sum);
+    const __m128i result_lo = _mm256_castsi256_si128(result);
+    const __m128i result_hi = _mm256_extracti128_si256(result, 1);
+    if (width == 8) {
+      StoreLo8(dst, result_lo);
+      StoreHi8(dst + dst_stride, result_lo);
+      StoreLo8(dst + dst_stride * 2, result_hi);
+      StoreHi8(dst + dst_stride * 3, result_hi);
+    } else {
+      Store4(dst, result_lo);
+      Store4(dst + dst_stride, _mm_srli_si128(result_lo, 4));
+      Store4(dst + dst_stride * 2, _mm_srli_si128(result_lo, 8));
+      Store4(dst + dst_stride * 3, _mm_srli_si128(result_lo, 12));
+      if (num_lanes == 4) {
+        Store4(dst + dst_stride * 4, result_hi);
+        Store4(dst + dst_stride * 5, _mm_srli_si128(result_hi, 4));
+        Store4(dst + dst_stride * 6, _mm_srli_si128(result_hi, 8));
+        Store4(dst + dst_stride * 7, _mm_srli_si128(result_hi, 12));
+      }
+    }
+    src += src_stride * rows_per_step;
+    dst += dst_stride * rows_per_step;
+    y -= rows_per_step;
+  } while (y != 0);
+}
+
+void Init8bpp() {
+  Dsp* const dsp = dsp_internal::GetWritableDspTable(8);
+  assert(dsp != nullptr);
+#if DSP_ENABLED_8BPP_AVX512(CdefFilters)
+  dsp->cdef_filters[0][0] = CdefFilter_AVX512<4>;
+  dsp->cdef_filters[0][1] =
+      CdefFilter_AVX512<4, /*enable_primary=*/true, /*enable_secondary=*/false>;
+  dsp->cdef_filters[0][2] = CdefFilter_AVX512<4, /*enable_primary=*/false>;
+  dsp->cdef_filters[1][0] = CdefFilter_AVX512<8>;
+  dsp->cdef_filters[1][1] =
+      CdefFilter_AVX512<8, /*enable_primary=*/true, /*enable_secondary=*/false>;
+  dsp->cdef_filters[1][2] = CdefFilter_AVX512<8, /*enable_primary=*/false>;
+#endif
+}
+
+}  // namespace
+}  // namespace low_bitdepth
+
+void CdefInit_AVX512() { low_bitdepth::Init8bpp(); }
+
+}  // namespace dsp
+}  // namespace libgav1
+#else   // !LIBGAV1_TARGETING_AVX512
+namespace libgav1 {
+namespace dsp {
+
+void CdefInit_AVX512() {}
+
+}  // namespace dsp
+}  // namespace libgav1
+#endif  // LIBGAV1_TARGETING_AVX512
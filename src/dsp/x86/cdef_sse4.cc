@@ -35,7 +35,6 @@
 
 namespace libgav1 {
 namespace dsp {
-namespace low_bitdepth {
 namespace {
 
 #include "src/dsp/cdef.inc"
@@ -241,9 +240,12 @@ LIBGAV1_ALWAYS_INLINE void AddPartial_D5_D7(__m128i* v_src, __m128i* partial_lo,
   *partial_hi = _mm_add_epi16(*partial_hi, _mm_srli_si128(v_pair_add[3], 10));
 }
 
-LIBGAV1_ALWAYS_INLINE void AddPartial(const uint8_t* LIBGAV1_RESTRICT src,
+template <int bitdepth>
+LIBGAV1_ALWAYS_INLINE void AddPartial(const void* LIBGAV1_RESTRICT const source,
                                       ptrdiff_t stride, __m128i* partial_lo,
                                       __m128i* partial_hi) {
+  const auto* src = static_cast<const uint8_t*>(source);
+
   // 8x8 input
   // 00 01 02 03 04 05 06 07
   // 10 11 12 13 14 15 16 17
@@ -254,9 +256,19 @@ LIBGAV1_ALWAYS_INLINE void AddPartial(const uint8_t* LIBGAV1_RESTRICT src,
   // 60 61 62 63 64 65 66 67
   // 70 71 72 73 74 75 76 77
   __m128i v_src[8];
-  for (auto& i : v_src) {
-    i = LoadLo8(src);
-    src += stride;
+  if (bitdepth == kBitdepth8) {
+    for (auto& i : v_src) {
+      i = LoadLo8(src);
+      src += stride;
+    }
+  } else {
+    // The direction search only looks at the 8 most significant bits, which
+    // turns the high bitdepth input into the 8 bit case.
+    for (auto& i : v_src) {
+      const __m128i v = _mm_srli_epi16(LoadUnaligned16(src), bitdepth - 8);
+      i = _mm_packus_epi16(v, v);
+      src += stride;
+    }
   }
 
   const __m128i v_zero = _mm_setzero_si128();
@@ -395,17 +407,17 @@ inline uint32_t SquareSum_S16(const __m128i a) {
   return SumVector_S32(square);
 }
 
+template <int bitdepth>
 void CdefDirection_SSE4_1(const void* LIBGAV1_RESTRICT const source,
                           ptrdiff_t stride,
                           uint8_t* LIBGAV1_RESTRICT const direction,
                           int* LIBGAV1_RESTRICT const variance) {
   assert(direction != nullptr);
   assert(variance != nullptr);
-  const auto* src = static_cast<const uint8_t*>(source);
   uint32_t cost[8];
   __m128i partial_lo[8], partial_hi[8];
 
-  AddPartial(src, stride, partial_lo, partial_hi);
+  AddPartial<bitdepth>(source, stride, partial_lo, partial_hi);
 
   cost[2] = kCdefDivisionTable[7] * SquareSum_S16(partial_lo[2]);
   cost[6] = kCdefDivisionTable[7] * SquareSum_S16(partial_lo[6]);
@@ -510,7 +522,50 @@ inline __m128i ApplyConstrainAndTap(const __m128i& pixel, const __m128i& val,
   return _mm_mullo_epi16(constrained, tap);
 }
 
-template <int width, bool enable_primary = true, bool enable_secondary = true>
+template <int bitdepth>
+inline __m128i GetMaxPrimary(const __m128i* const primary_val, __m128i max,
+                             const __m128i cdef_large_value_mask) {
+  if (bitdepth == kBitdepth8) {
+    // The source is 16 bits, however, we only really care about the lower
+    // 8 bits.  The upper 8 bits contain the "large" flag.  After the final
+    // primary max has been calculated, zero out the upper 8 bits.  Use this
+    // to find the "16 bit" max.
+    const __m128i max_p01 = _mm_max_epu8(primary_val[0], primary_val[1]);
+    const __m128i max_p23 = _mm_max_epu8(primary_val[2], primary_val[3]);
+    const __m128i max_p = _mm_max_epu8(max_p01, max_p23);
+    max = _mm_max_epu16(max, _mm_and_si128(max_p, cdef_large_value_mask));
+  } else {
+    // Convert kCdefLargeValue to 0 before calculating max.
+    for (int i = 0; i < 4; ++i) {
+      max = _mm_max_epu16(max,
+                          _mm_and_si128(primary_val[i], cdef_large_value_mask));
+    }
+  }
+  return max;
+}
+
+template <int bitdepth>
+inline __m128i GetMaxSecondary(const __m128i* const secondary_val, __m128i max,
+                               const __m128i cdef_large_value_mask) {
+  if (bitdepth == kBitdepth8) {
+    const __m128i max_s01 = _mm_max_epu8(secondary_val[0], secondary_val[1]);
+    const __m128i max_s23 = _mm_max_epu8(secondary_val[2], secondary_val[3]);
+    const __m128i max_s45 = _mm_max_epu8(secondary_val[4], secondary_val[5]);
+    const __m128i max_s67 = _mm_max_epu8(secondary_val[6], secondary_val[7]);
+    const __m128i max_s = _mm_max_epu8(_mm_max_epu8(max_s01, max_s23),
+                                       _mm_max_epu8(max_s45, max_s67));
+    max = _mm_max_epu16(max, _mm_and_si128(max_s, cdef_large_value_mask));
+  } else {
+    for (int i = 0; i < 8; ++i) {
+      max = _mm_max_epu16(
+          max, _mm_and_si128(secondary_val[i], cdef_large_value_mask));
+    }
+  }
+  return max;
+}
+
+template <int width, int bitdepth, bool enable_primary = true,
+          bool enable_secondary = true>
 void CdefFilter_SSE4_1(const uint16_t* LIBGAV1_RESTRICT src,
                        const ptrdiff_t src_stride, const int height,
                        const int primary_strength, const int secondary_strength,
@@ -525,24 +580,33 @@ void CdefFilter_SSE4_1(const uint16_t* LIBGAV1_RESTRICT src,
 
   // FloorLog2() requires input to be > 0.
   // 8-bit damping range: Y: [3, 6], UV: [2, 5].
+  // High bitdepth damping range: Y: [3, 6 + coeff_shift],
+  // UV: [2, 5 + coeff_shift].
   if (enable_primary) {
-    // primary_strength: [0, 15] -> FloorLog2: [0, 3] so a clamp is necessary
-    // for UV filtering.
+    // primary_strength: [0, 15 << coeff_shift] -> FloorLog2:
+    // [0, 3 + coeff_shift] so a clamp is necessary for UV filtering.
     primary_damping_shift =
         _mm_cvtsi32_si128(std::max(0, damping - FloorLog2(primary_strength)));
   }
   if (enable_secondary) {
-    // secondary_strength: [0, 4] -> FloorLog2: [0, 2] so no clamp to 0 is
-    // necessary.
-    assert(damping - FloorLog2(secondary_strength) >= 0);
-    secondary_damping_shift =
-        _mm_cvtsi32_si128(damping - FloorLog2(secondary_strength));
+    if (bitdepth == kBitdepth8) {
+      // secondary_strength: [0, 4] -> FloorLog2: [0, 2] so no clamp to 0 is
+      // necessary.
+      assert(damping - FloorLog2(secondary_strength) >= 0);
+      secondary_damping_shift =
+          _mm_cvtsi32_si128(damping - FloorLog2(secondary_strength));
+    } else {
+      // secondary_strength: [0, 4 << coeff_shift]
+      secondary_damping_shift = _mm_cvtsi32_si128(
+          std::max(0, damping - FloorLog2(secondary_strength)));
+    }
   }
 
-  const __m128i primary_tap_0 =
-      _mm_set1_epi16(kCdefPrimaryTaps[primary_strength & 1][0]);
-  const __m128i primary_tap_1 =
-      _mm_set1_epi16(kCdefPrimaryTaps[primary_strength & 1][1]);
+  constexpr int coeff_shift = bitdepth - 8;
+  const __m128i primary_tap_0 = _mm_set1_epi16(
+      kCdefPrimaryTaps[(primary_strength >> coeff_shift) & 1][0]);
+  const __m128i primary_tap_1 = _mm_set1_epi16(
+      kCdefPrimaryTaps[(primary_strength >> coeff_shift) & 1][1]);
   const __m128i secondary_tap_0 = _mm_set1_epi16(kCdefSecondaryTap0);
   const __m128i secondary_tap_1 = _mm_set1_epi16(kCdefSecondaryTap1);
   const __m128i cdef_large_value_mask =
@@ -577,15 +641,7 @@ void CdefFilter_SSE4_1(const uint16_t* LIBGAV1_RESTRICT src,
         min = _mm_min_epu16(min, primary_val[1]);
         min = _mm_min_epu16(min, primary_val[2]);
         min = _mm_min_epu16(min, primary_val[3]);
-
-        // The source is 16 bits, however, we only really care about the lower
-        // 8 bits.  The upper 8 bits contain the "large" flag.  After the final
-        // primary max has been calculated, zero out the upper 8 bits.  Use this
-        // to find the "16 bit" max.
-        const __m128i max_p01 = _mm_max_epu8(primary_val[0], primary_val[1]);
-        const __m128i max_p23 = _mm_max_epu8(primary_val[2], primary_val[3]);
-        const __m128i max_p = _mm_max_epu8(max_p01, max_p23);
-        max = _mm_max_epu16(max, _mm_and_si128(max_p, cdef_large_value_mask));
+        max = GetMaxPrimary<bitdepth>(primary_val, max, cdef_large_value_mask);
       }
 
       sum = ApplyConstrainAndTap(pixel, primary_val[0], primary_tap_0,
@@ -623,18 +679,8 @@ void CdefFilter_SSE4_1(const uint16_t* LIBGAV1_RESTRICT src,
         min = _mm_min_epu16(min, secondary_val[5]);
         min = _mm_min_epu16(min, secondary_val[6]);
         min = _mm_min_epu16(min, secondary_val[7]);
-
-        const __m128i max_s01 =
-            _mm_max_epu8(secondary_val[0], secondary_val[1]);
-        const __m128i max_s23 =
-            _mm_max_epu8(secondary_val[2], secondary_val[3]);
-        const __m128i max_s45 =
-            _mm_max_epu8(secondary_val[4], secondary_val[5]);
-        const __m128i max_s67 =
-            _mm_max_epu8(secondary_val[6], secondary_val[7]);
-        const __m128i max_s = _mm_max_epu8(_mm_max_epu8(max_s01, max_s23),
-                                           _mm_max_epu8(max_s45, max_s67));
-        max = _mm_max_epu16(max, _mm_and_si128(max_s, cdef_large_value_mask));
+        max = GetMaxSecondary<bitdepth>(secondary_val, max,
+                                        cdef_large_value_mask);
       }
 
       sum = _mm_add_epi16(
@@ -685,41 +731,101 @@ void CdefFilter_SSE4_1(const uint16_t* LIBGAV1_RESTRICT src,
       sum = _mm_max_epi16(sum, min);
     }
 
-    const __m128i result = _mm_packus_epi16(sum, sum);
-    if (width == 8) {
-      src += src_stride;
-      StoreLo8(dst, result);
-      dst += dst_stride;
-      --y;
+    if (bitdepth == kBitdepth8) {
+      const __m128i result = _mm_packus_epi16(sum, sum);
+      if (width == 8) {
+        src += src_stride;
+        StoreLo8(dst, result);
+        dst += dst_stride;
+        --y;
+      } else {
+        src += src_stride << 1;
+        Store4(dst, result);
+        dst += dst_stride;
+        Store4(dst, _mm_srli_si128(result, 4));
+        dst += dst_stride;
+        y -= 2;
+      }
     } else {
-      src += src_stride << 1;
-      Store4(dst, result);
-      dst += dst_stride;
-      Store4(dst, _mm_srli_si128(result, 4));
-      dst += dst_stride;
-      y -= 2;
+      if (width == 8) {
+        src += src_stride;
+        StoreUnaligned16(dst, sum);
+        dst += dst_stride;
+        --y;
+      } else {
+        src += src_stride << 1;
+        StoreLo8(dst, sum);
+        dst += dst_stride;
+        StoreHi8(dst, sum);
+        dst += dst_stride;
+        y -= 2;
+      }
     }
   } while (y != 0);
 }
 
+}  // namespace
+
+namespace low_bitdepth {
+namespace {
+
 void Init8bpp() {
-  Dsp* const dsp = dsp_internal::GetWritableDspTable(8);
+  Dsp* const dsp = dsp_internal::GetWritableDspTable(kBitdepth8);
   assert(dsp != nullptr);
-  dsp->cdef_direction = CdefDirection_SSE4_1;
-  dsp->cdef_filters[0][0] = CdefFilter_SSE4_1<4>;
+  dsp->cdef_direction = CdefDirection_SSE4_1<kBitdepth8>;
+  dsp->cdef_filters[0][0] = CdefFilter_SSE4_1<4, kBitdepth8>;
   dsp->cdef_filters[0][1] =
-      CdefFilter_SSE4_1<4, /*enable_primary=*/true, /*enable_secondary=*/false>;
-  dsp->cdef_filters[0][2] = CdefFilter_SSE4_1<4, /*enable_primary=*/false>;
-  dsp->cdef_filters[1][0] = CdefFilter_SSE4_1<8>;
+      CdefFilter_SSE4_1<4, kBitdepth8, /*enable_primary=*/true,
+                        /*enable_secondary=*/false>;
+  dsp->cdef_filters[0][2] =
+      CdefFilter_SSE4_1<4, kBitdepth8, /*enable_primary=*/false>;
+  dsp->cdef_filters[1][0] = CdefFilter_SSE4_1<8, kBitdepth8>;
   dsp->cdef_filters[1][1] =
-      CdefFilter_SSE4_1<8, /*enable_primary=*/true, /*enable_secondary=*/false>;
-  dsp->cdef_filters[1][2] = CdefFilter_SSE4_1<8, /*enable_primary=*/false>;
+      CdefFilter_SSE4_1<8, kBitdepth8, /*enable_primary=*/true,
+                        /*enable_secondary=*/false>;
+  dsp->cdef_filters[1][2] =
+      CdefFilter_SSE4_1<8, kBitdepth8, /*enable_primary=*/false>;
 }
 
 }  // namespace
 }  // namespace low_bitdepth
 
-void CdefInit_SSE4_1() { low_bitdepth::Init8bpp(); }
+#if LIBGAV1_MAX_BITDEPTH >= 10
+namespace high_bitdepth {
+namespace {
+
+template <int bitdepth>
+void InitHighBitdepth() {
+  Dsp* const dsp = dsp_internal::GetWritableDspTable(bitdepth);
+  assert(dsp != nullptr);
+  dsp->cdef_direction = CdefDirection_SSE4_1<bitdepth>;
+  dsp->cdef_filters[0][0] = CdefFilter_SSE4_1<4, bitdepth>;
+  dsp->cdef_filters[0][1] =
+      CdefFilter_SSE4_1<4, bitdepth, /*enable_primary=*/true,
+                        /*enable_secondary=*/false>;
+  dsp->cdef_filters[0][2] =
+      CdefFilter_SSE4_1<4, bitdepth, /*enable_primary=*/false>;
+  dsp->cdef_filters[1][0] = CdefFilter_SSE4_1<8, bitdepth>;
+  dsp->cdef_filters[1][1] =
+      CdefFilter_SSE4_1<8, bitdepth, /*enable_primary=*/true,
+                        /*enable_secondary=*/false>;
+  dsp->cdef_filters[1][2] =
+      CdefFilter_SSE4_1<8, bitdepth, /*enable_primary=*/false>;
+}
+
+}  // namespace
+}  // namespace high_bitdepth
+#endif  // LIBGAV1_MAX_BITDEPTH >= 10
+
+void CdefInit_SSE4_1() {
+  low_bitdepth::Init8bpp();
+#if LIBGAV1_MAX_BITDEPTH >= 10
+  high_bitdepth::InitHighBitdepth<kBitdepth10>();
+#endif
+#if LIBGAV1_MAX_BITDEPTH == 12
+  high_bitdepth::InitHighBitdepth<kBitdepth12>();
+#endif
+}
 
 }  // namespace dsp
 }  // namespace libgav1
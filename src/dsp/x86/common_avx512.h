@@ -0,0 +1,157 @@
+/*
+ * Copyright 2024 The libgav1 Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGAV1_SRC_DSP_X86_COMMON_AVX512_H_
+#define LIBGAV1_SRC_DSP_X86_COMMON_AVX512_H_
+
+#include "src/utils/compiler_attributes.h"
+#include "src/utils/cpu.h"
+
+#if LIBGAV1_TARGETING_AVX512
+
+#include <immintrin.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Before version 13, GCC reports -W(maybe-)uninitialized for the
+// _mm512_undefined_*() values which many of the unmasked avx512 intrinsics
+// pass through. The warnings are issued where the intrinsics are inlined, so
+// they are disabled for the remainder of each file including this header.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ < 13
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace libgav1 {
+namespace dsp {
+namespace avx512 {
+
+#include "src/dsp/x86/common_avx2.inc"
+#include "src/dsp/x86/common_sse4.inc"
+
+// Returns a vector with |a| in the lowest 128-bit lane through |d| in the
+// highest.
+inline __m512i SetrM128i(const __m128i a, const __m128i b, const __m128i c,
+                         const __m128i d) {
+  const __m512i ab =
+      _mm512_inserti32x4(_mm512_castsi128_si512(a), b, /*imm8=*/1);
+  const __m512i abc = _mm512_inserti32x4(ab, c, /*imm8=*/2);
+  return _mm512_inserti32x4(abc, d, /*imm8=*/3);
+}
+
+//------------------------------------------------------------------------------
+// Load functions.
+
+inline __m512i LoadUnaligned64(const void* a) {
+  return _mm512_loadu_si512(a);
+}
+
+// Loads the bytes of |a| selected by |mask|. The unselected bytes are zeroed
+// and are not read, so it is safe to use at the end of a buffer.
+inline __m512i LoadUnaligned64Masked(const void* a, const __mmask64 mask) {
+  return _mm512_maskz_loadu_epi8(mask, a);
+}
+
+//------------------------------------------------------------------------------
+// Store functions.
+
+inline void StoreUnaligned64(void* a, const __m512i v) {
+  _mm512_storeu_si512(a, v);
+}
+
+//------------------------------------------------------------------------------
+// Arithmetic utilities.
+
+// Returns a mask selecting the first |n| bytes of a 64 byte vector.
+inline __mmask64 MaskLowNBytes64(const int n) {
+  assert(n >= 0);
+  return (n >= 64) ? ~__mmask64{0} : ((__mmask64{1} << n) - 1);
+}
+
+inline __m512i RightShiftWithRounding_S16(const __m512i v_val_d, int bits) {
+  assert(bits <= 16);
+  const __m512i v_bias_d =
+      _mm512_set1_epi16(static_cast<int16_t>((1 << bits) >> 1));
+  const __m512i v_tmp_d = _mm512_add_epi16(v_val_d, v_bias_d);
+  return _mm512_sra_epi16(v_tmp_d, _mm_cvtsi32_si128(bits));
+}
+
+inline __m512i RightShiftWithRounding_S32(const __m512i v_val_d, int bits) {
+  const __m512i v_bias_d = _mm512_set1_epi32((1 << bits) >> 1);
+  const __m512i v_tmp_d = _mm512_add_epi32(v_val_d, v_bias_d);
+  return _mm512_sra_epi32(v_tmp_d, _mm_cvtsi32_si128(bits));
+}
+
+}  // namespace avx512
+
+// NOLINTBEGIN(misc-unused-using-decls)
+// These function aliases shall not be visible to external code. They are
+// restricted to x86/*_avx512.cc files only. The shared .inc files are placed
+// in a separate namespace so the copies compiled with avx512 instructions
+// cannot be merged with the avx2 or sse4 versions.
+
+// common_sse4.inc
+using avx512::Load2;
+using avx512::Load2x2;
+using avx512::Load4;
+using avx512::Load4x2;
+using avx512::LoadAligned16;
+using avx512::LoadAligned16Msan;
+using avx512::LoadHi8;
+using avx512::LoadHi8Msan;
+using avx512::LoadLo8;
+using avx512::LoadLo8Msan;
+using avx512::LoadUnaligned16;
+using avx512::LoadUnaligned16Msan;
+using avx512::MaskHighNBytes;
+using avx512::RightShiftWithRounding_S16;
+using avx512::RightShiftWithRounding_S32;
+using avx512::RightShiftWithRounding_U16;
+using avx512::RightShiftWithRounding_U32;
+using avx512::Store2;
+using avx512::Store4;
+using avx512::StoreAligned16;
+using avx512::StoreHi8;
+using avx512::StoreLo8;
+using avx512::StoreUnaligned16;
+
+// common_avx2.inc
+using avx512::LoadAligned32;
+using avx512::LoadAligned32Msan;
+using avx512::LoadAligned64;
+using avx512::LoadAligned64Msan;
+using avx512::LoadUnaligned32;
+using avx512::LoadUnaligned32Msan;
+using avx512::SetrM128i;
+using avx512::StoreAligned32;
+using avx512::StoreAligned64;
+using avx512::StoreUnaligned32;
+
+// common_avx512.h
+using avx512::LoadUnaligned64;
+using avx512::LoadUnaligned64Masked;
+using avx512::MaskLowNBytes64;
+using avx512::StoreUnaligned64;
+// NOLINTEND
+
+}  // namespace dsp
+}  // namespace libgav1
+
+#endif  // LIBGAV1_TARGETING_AVX512
+#endif  // LIBGAV1_SRC_DSP_X86_COMMON_AVX512_H_
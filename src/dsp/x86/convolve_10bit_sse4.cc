@@ -0,0 +1,501 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/dsp/convolve.h"
+#include "src/utils/cpu.h"
+
+#if LIBGAV1_TARGETING_SSE4_1 && LIBGAV1_MAX_BITDEPTH >= 10
+#include <smmintrin.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include "src/dsp/constants.h"
+#include "src/dsp/dsp.h"
+#include "src/dsp/x86/common_sse4.h"
+#include "src/utils/common.h"
+#include "src/utils/compiler_attributes.h"
+#include "src/utils/constants.h"
+
+namespace libgav1 {
+namespace dsp {
+namespace {
+
+constexpr int kHorizontalOffset = 3;
+constexpr int kVerticalOffset = 3;
+
+// 12 bit pixels are rounded by two more bits in the horizontal pass and two
+// fewer bits in the vertical pass, which keeps the intermediate values of both
+// bitdepths within int16_t.
+constexpr int RoundBitsHorizontal(int bitdepth) {
+  return (bitdepth == 12) ? kInterRoundBitsHorizontal12bpp
+                          : kInterRoundBitsHorizontal;
+}
+
+constexpr int RoundBitsVertical(int bitdepth) {
+  return (bitdepth == 12) ? kInterRoundBitsVertical12bpp
+                          : kInterRoundBitsVertical;
+}
+
+// The 10 and 12 bit pixels and the 2D intermediate values all fit in int16_t,
+// so the filters are applied with _mm_madd_epi16(). |taps[k]| holds the pair
+// of coefficients (2 * k, 2 * k + 1) in every 32 bit lane.
+inline void SetupTaps(const int8_t* const filter, __m128i taps[4]) {
+  const __m128i coefficients = _mm_cvtepi8_epi16(LoadLo8(filter));
+  taps[0] = _mm_shuffle_epi32(coefficients, 0x00);
+  taps[1] = _mm_shuffle_epi32(coefficients, 0x55);
+  taps[2] = _mm_shuffle_epi32(coefficients, 0xaa);
+  taps[3] = _mm_shuffle_epi32(coefficients, 0xff);
+}
+
+//------------------------------------------------------------------------------
+// Horizontal filter.
+
+// Computes 8 horizontal outputs. |src| points to the first tap of the first
+// output. The even outputs come from the loads at even offsets and the odd
+// outputs from the loads at odd offsets, so no shuffles are needed. The
+// results are rounded by RoundBitsHorizontal() - 1 and interleaved back into
+// 16 bit lanes.
+template <int bitdepth>
+inline __m128i HorizontalTaps8(const uint16_t* const src,
+                               const __m128i taps[4]) {
+  __m128i even = _mm_madd_epi16(LoadUnaligned16(src + 0), taps[0]);
+  __m128i odd = _mm_madd_epi16(LoadUnaligned16(src + 1), taps[0]);
+  even = _mm_add_epi32(even, _mm_madd_epi16(LoadUnaligned16(src + 2), taps[1]));
+  odd = _mm_add_epi32(odd, _mm_madd_epi16(LoadUnaligned16(src + 3), taps[1]));
+  even = _mm_add_epi32(even, _mm_madd_epi16(LoadUnaligned16(src + 4), taps[2]));
+  odd = _mm_add_epi32(odd, _mm_madd_epi16(LoadUnaligned16(src + 5), taps[2]));
+  even = _mm_add_epi32(even, _mm_madd_epi16(LoadUnaligned16(src + 6), taps[3]));
+  odd = _mm_add_epi32(odd, _mm_madd_epi16(LoadUnaligned16(src + 7), taps[3]));
+  even = RightShiftWithRounding_S32(even, RoundBitsHorizontal(bitdepth) - 1);
+  odd = RightShiftWithRounding_S32(odd, RoundBitsHorizontal(bitdepth) - 1);
+  return _mm_blend_epi16(even, _mm_slli_epi32(odd, 16), 0xAA);
+}
+
+// Computes 4 horizontal outputs in the low 64 bits. Blocks of width 2 and 4
+// use the 4 tap filters, so only taps 2 through 5 are applied. This keeps the
+// loads within the 8 tap footprint of a 2 wide block.
+template <int bitdepth>
+inline __m128i HorizontalTaps4(const uint16_t* const src,
+                               const __m128i taps[4]) {
+  const __m128i src_1 = LoadUnaligned16(src + 1);
+  const __m128i src_2 = _mm_srli_si128(src_1, 2);
+  const __m128i src_3 = _mm_srli_si128(src_1, 4);
+  const __m128i src_4 = _mm_srli_si128(src_1, 6);
+  const __m128i src_5 = _mm_srli_si128(src_1, 8);
+  __m128i sum = _mm_madd_epi16(_mm_unpacklo_epi16(src_2, src_3), taps[1]);
+  sum = _mm_add_epi32(
+      sum, _mm_madd_epi16(_mm_unpacklo_epi16(src_4, src_5), taps[2]));
+  sum = RightShiftWithRounding_S32(sum, RoundBitsHorizontal(bitdepth) - 1);
+  return _mm_packs_epi32(sum, sum);
+}
+
+// The 2D intermediate values are stored as is. Single predictions are rounded
+// the rest of the way and clipped, compound predictions are offset by
+// kCompoundOffset. The compound values fit in uint16_t so the 16 bit addition
+// does not lose any bits.
+template <int bitdepth, bool is_2d, bool is_compound>
+inline __m128i FinalizeHorizontal(const __m128i v) {
+  if (is_2d) return v;
+  if (is_compound) return _mm_add_epi16(v, _mm_set1_epi16(kCompoundOffset));
+  const __m128i rounded =
+      RightShiftWithRounding_S16(v,
+                                 kFilterBits - RoundBitsHorizontal(bitdepth));
+  return _mm_min_epi16(_mm_max_epi16(rounded, _mm_setzero_si128()),
+                       _mm_set1_epi16((1 << bitdepth) - 1));
+}
+
+// |src| points to the first tap of the top left output. |dest| is either the
+// int16_t intermediate buffer of the 2D filter or the uint16_t prediction.
+template <int bitdepth, bool is_2d, bool is_compound, typename DestType>
+void FilterHorizontal(const uint16_t* LIBGAV1_RESTRICT src,
+                      const ptrdiff_t src_stride, const int width,
+                      const int height, const int8_t* const filter,
+                      DestType* LIBGAV1_RESTRICT dest,
+                      const ptrdiff_t dest_stride) {
+  __m128i taps[4];
+  SetupTaps(filter, taps);
+  int y = height;
+  if (width >= 8) {
+    do {
+      int x = 0;
+      do {
+        StoreUnaligned16(dest + x,
+                         FinalizeHorizontal<bitdepth, is_2d, is_compound>(
+                             HorizontalTaps8<bitdepth>(src + x, taps)));
+        x += 8;
+      } while (x < width);
+      src += src_stride;
+      dest += dest_stride;
+    } while (--y != 0);
+  } else if (width == 4) {
+    do {
+      StoreLo8(dest, FinalizeHorizontal<bitdepth, is_2d, is_compound>(
+                         HorizontalTaps4<bitdepth>(src, taps)));
+      src += src_stride;
+      dest += dest_stride;
+    } while (--y != 0);
+  } else {
+    // Compound blocks are at least 4 wide.
+    assert(width == 2);
+    assert(!is_compound);
+    do {
+      Store4(dest, FinalizeHorizontal<bitdepth, is_2d, is_compound>(
+                       HorizontalTaps4<bitdepth>(src, taps)));
+      src += src_stride;
+      dest += dest_stride;
+    } while (--y != 0);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Vertical filter.
+
+// Applies the 8 tap filter down the columns of |rows|. Each pair of rows is
+// interleaved so the even and odd taps are multiplied together.
+inline void VerticalTaps8(const __m128i rows[8], const __m128i taps[4],
+                          __m128i* const sum_lo, __m128i* const sum_hi) {
+  __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(rows[0], rows[1]), taps[0]);
+  __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(rows[0], rows[1]), taps[0]);
+  for (int k = 1; k < 4; ++k) {
+    lo = _mm_add_epi32(
+        lo, _mm_madd_epi16(_mm_unpacklo_epi16(rows[2 * k], rows[2 * k + 1]),
+                           taps[k]));
+    hi = _mm_add_epi32(
+        hi, _mm_madd_epi16(_mm_unpackhi_epi16(rows[2 * k], rows[2 * k + 1]),
+                           taps[k]));
+  }
+  *sum_lo = lo;
+  *sum_hi = hi;
+}
+
+// Rounds the vertical sums by |rounding_bits| and packs them to 16 bits.
+// Single predictions are clipped to the pixel range. The offset of compound
+// predictions is added before packing, as the results exceed int16_t.
+template <int bitdepth, int rounding_bits, bool is_compound>
+inline __m128i RoundAndPack(__m128i sum_lo, __m128i sum_hi) {
+  sum_lo = RightShiftWithRounding_S32(sum_lo, rounding_bits);
+  sum_hi = RightShiftWithRounding_S32(sum_hi, rounding_bits);
+  if (is_compound) {
+    const __m128i offset = _mm_set1_epi32(kCompoundOffset);
+    return _mm_packus_epi32(_mm_add_epi32(sum_lo, offset),
+                            _mm_add_epi32(sum_hi, offset));
+  }
+  return _mm_min_epu16(_mm_packus_epi32(sum_lo, sum_hi),
+                       _mm_set1_epi16((1 << bitdepth) - 1));
+}
+
+// |src| points to the first tap of the top left output. It is either the
+// uint16_t reference or the int16_t intermediate buffer of the 2D filter.
+template <int bitdepth, int rounding_bits, bool is_compound, typename SrcType>
+void FilterVertical(const SrcType* LIBGAV1_RESTRICT src,
+                    const ptrdiff_t src_stride, const int width,
+                    const int height, const int8_t* const filter,
+                    uint16_t* LIBGAV1_RESTRICT dest,
+                    const ptrdiff_t dest_stride) {
+  __m128i taps[4];
+  SetupTaps(filter, taps);
+  __m128i rows[8];
+  if (width >= 8) {
+    int x = 0;
+    do {
+      const SrcType* src_x = src + x;
+      uint16_t* dest_x = dest + x;
+      for (int i = 0; i < 7; ++i) {
+        rows[i] = LoadUnaligned16(src_x);
+        src_x += src_stride;
+      }
+      int y = height;
+      do {
+        rows[7] = LoadUnaligned16(src_x);
+        __m128i sum_lo, sum_hi;
+        VerticalTaps8(rows, taps, &sum_lo, &sum_hi);
+        StoreUnaligned16(dest_x,
+                         RoundAndPack<bitdepth, rounding_bits, is_compound>(
+                             sum_lo, sum_hi));
+        for (int i = 0; i < 7; ++i) rows[i] = rows[i + 1];
+        src_x += src_stride;
+        dest_x += dest_stride;
+      } while (--y != 0);
+      x += 8;
+    } while (x < width);
+    return;
+  }
+
+  // Only the low half of each row is used for 4 and 2 wide blocks.
+  assert(width == 4 || width == 2);
+  for (int i = 0; i < 7; ++i) {
+    rows[i] = (width == 4) ? LoadLo8(src) : Load4(src);
+    src += src_stride;
+  }
+  int y = height;
+  do {
+    rows[7] = (width == 4) ? LoadLo8(src) : Load4(src);
+    __m128i sum_lo, sum_hi;
+    VerticalTaps8(rows, taps, &sum_lo, &sum_hi);
+    const __m128i result =
+        RoundAndPack<bitdepth, rounding_bits, is_compound>(sum_lo, sum_hi);
+    if (width == 4) {
+      StoreLo8(dest, result);
+    } else {
+      Store4(dest, result);
+    }
+    for (int i = 0; i < 7; ++i) rows[i] = rows[i + 1];
+    src += src_stride;
+    dest += dest_stride;
+  } while (--y != 0);
+}
+
+//------------------------------------------------------------------------------
+// Convolve functions.
+
+template <int bitdepth>
+void ConvolveHorizontal_SSE4_1(
+    const void* LIBGAV1_RESTRICT const reference,
+    const ptrdiff_t reference_stride, const int horizontal_filter_index,
+    const int /*vertical_filter_index*/, const int horizontal_filter_id,
+    const int /*vertical_filter_id*/, const int width, const int height,
+    void* LIBGAV1_RESTRICT const prediction, const ptrdiff_t pred_stride) {
+  const int filter_index = GetFilterIndex(horizontal_filter_index, width);
+  const auto* const src =
+      static_cast<const uint16_t*>(reference) - kHorizontalOffset;
+  auto* const dest = static_cast<uint16_t*>(prediction);
+  FilterHorizontal<bitdepth, /*is_2d=*/false, /*is_compound=*/false>(
+      src, reference_stride >> 1, width, height,
+      kHalfSubPixelFilters[filter_index][horizontal_filter_id], dest,
+      pred_stride >> 1);
+}
+
+template <int bitdepth>
+void ConvolveCompoundHorizontal_SSE4_1(
+    const void* LIBGAV1_RESTRICT const reference,
+    const ptrdiff_t reference_stride, const int horizontal_filter_index,
+    const int /*vertical_filter_index*/, const int horizontal_filter_id,
+    const int /*vertical_filter_id*/, const int width, const int height,
+    void* LIBGAV1_RESTRICT const prediction, const ptrdiff_t pred_stride) {
+  // All compound functions output to the predictor buffer with |pred_stride|
+  // equal to |width|.
+  assert(pred_stride == width);
+  const int filter_index = GetFilterIndex(horizontal_filter_index, width);
+  const auto* const src =
+      static_cast<const uint16_t*>(reference) - kHorizontalOffset;
+  auto* const dest = static_cast<uint16_t*>(prediction);
+  FilterHorizontal<bitdepth, /*is_2d=*/false, /*is_compound=*/true>(
+      src, reference_stride >> 1, width, height,
+      kHalfSubPixelFilters[filter_index][horizontal_filter_id], dest,
+      pred_stride);
+}
+
+template <int bitdepth>
+void ConvolveVertical_SSE4_1(
+    const void* LIBGAV1_RESTRICT const reference,
+    const ptrdiff_t reference_stride, const int /*horizontal_filter_index*/,
+    const int vertical_filter_index, const int /*horizontal_filter_id*/,
+    const int vertical_filter_id, const int width, const int height,
+    void* LIBGAV1_RESTRICT const prediction, const ptrdiff_t pred_stride) {
+  const int filter_index = GetFilterIndex(vertical_filter_index, height);
+  const ptrdiff_t src_stride = reference_stride >> 1;
+  const auto* const src =
+      static_cast<const uint16_t*>(reference) - kVerticalOffset * src_stride;
+  auto* const dest = static_cast<uint16_t*>(prediction);
+  FilterVertical<bitdepth, kFilterBits - 1, /*is_compound=*/false>(
+      src, src_stride, width, height,
+      kHalfSubPixelFilters[filter_index][vertical_filter_id], dest,
+      pred_stride >> 1);
+}
+
+template <int bitdepth>
+void ConvolveCompoundVertical_SSE4_1(
+    const void* LIBGAV1_RESTRICT const reference,
+    const ptrdiff_t reference_stride, const int /*horizontal_filter_index*/,
+    const int vertical_filter_index, const int /*horizontal_filter_id*/,
+    const int vertical_filter_id, const int width, const int height,
+    void* LIBGAV1_RESTRICT const prediction, const ptrdiff_t pred_stride) {
+  assert(pred_stride == width);
+  const int filter_index = GetFilterIndex(vertical_filter_index, height);
+  const ptrdiff_t src_stride = reference_stride >> 1;
+  const auto* const src =
+      static_cast<const uint16_t*>(reference) - kVerticalOffset * src_stride;
+  auto* const dest = static_cast<uint16_t*>(prediction);
+  constexpr int kRoundBitsVertical = RoundBitsHorizontal(bitdepth) - 1;
+  FilterVertical<bitdepth, kRoundBitsVertical, /*is_compound=*/true>(
+      src, src_stride, width, height,
+      kHalfSubPixelFilters[filter_index][vertical_filter_id], dest,
+      pred_stride);
+}
+
+template <int bitdepth, bool is_compound>
+void Convolve2D_SSE4_1(const void* LIBGAV1_RESTRICT const reference,
+                       const ptrdiff_t reference_stride,
+                       const int horizontal_filter_index,
+                       const int vertical_filter_index,
+                       const int horizontal_filter_id,
+                       const int vertical_filter_id, const int width,
+                       const int height,
+                       void* LIBGAV1_RESTRICT const prediction,
+                       const ptrdiff_t pred_stride) {
+  assert(!is_compound || pred_stride == width);
+  // The output of the horizontal filter is guaranteed to fit in int16_t.
+  alignas(16) int16_t
+      intermediate_result[kMaxSuperBlockSizeInPixels *
+                          (kMaxSuperBlockSizeInPixels + kSubPixelTaps - 1)];
+  const int intermediate_height = height + kSubPixelTaps - 1;
+  const ptrdiff_t src_stride = reference_stride >> 1;
+  const auto* const src = static_cast<const uint16_t*>(reference) -
+                          kVerticalOffset * src_stride - kHorizontalOffset;
+  const int horiz_filter_index = GetFilterIndex(horizontal_filter_index, width);
+  FilterHorizontal<bitdepth, /*is_2d=*/true, is_compound>(
+      src, src_stride, width, intermediate_height,
+      kHalfSubPixelFilters[horiz_filter_index][horizontal_filter_id],
+      intermediate_result, width);
+
+  const int vert_filter_index = GetFilterIndex(vertical_filter_index, height);
+  auto* const dest = static_cast<uint16_t*>(prediction);
+  constexpr int kRoundBitsVertical = is_compound
+                                         ? kInterRoundBitsCompoundVertical - 1
+                                         : RoundBitsVertical(bitdepth) - 1;
+  FilterVertical<bitdepth, kRoundBitsVertical, is_compound>(
+      intermediate_result, width, width, height,
+      kHalfSubPixelFilters[vert_filter_index][vertical_filter_id], dest,
+      is_compound ? pred_stride : pred_stride >> 1);
+}
+
+template <int bitdepth>
+void ConvolveCompoundCopy_SSE4_1(
+    const void* LIBGAV1_RESTRICT const reference,
+    const ptrdiff_t reference_stride, const int /*horizontal_filter_index*/,
+    const int /*vertical_filter_index*/, const int /*horizontal_filter_id*/,
+    const int /*vertical_filter_id*/, const int width, const int height,
+    void* LIBGAV1_RESTRICT const prediction, const ptrdiff_t pred_stride) {
+  assert(pred_stride == width);
+  // Compound functions start at 4x4.
+  assert(width >= 4 && height >= 4);
+  constexpr int kRoundBitsVertical =
+      RoundBitsVertical(bitdepth) - kInterRoundBitsCompoundVertical;
+  // The sum is at most (1023 + 1536) << 4 for 10 bit and (4095 + 6144) << 2 for
+  // 12 bit pixels, which both fit in uint16_t.
+  constexpr int kCopyOffset = (1 << bitdepth) + (1 << (bitdepth - 1));
+  const __m128i offset = _mm_set1_epi16(kCopyOffset);
+  const auto* src = static_cast<const uint16_t*>(reference);
+  const ptrdiff_t src_stride = reference_stride >> 1;
+  auto* dest = static_cast<uint16_t*>(prediction);
+  int y = height;
+  if (width >= 8) {
+    do {
+      int x = 0;
+      do {
+        const __m128i v = _mm_add_epi16(LoadUnaligned16(src + x), offset);
+        StoreUnaligned16(dest + x, _mm_slli_epi16(v, kRoundBitsVertical));
+        x += 8;
+      } while (x < width);
+      src += src_stride;
+      dest += pred_stride;
+    } while (--y != 0);
+  } else {
+    assert(width == 4);
+    do {
+      const __m128i v = _mm_add_epi16(LoadLo8(src), offset);
+      StoreLo8(dest, _mm_slli_epi16(v, kRoundBitsVertical));
+      src += src_stride;
+      dest += pred_stride;
+    } while (--y != 0);
+  }
+}
+
+void Init10bpp() {
+  Dsp* const dsp = dsp_internal::GetWritableDspTable(kBitdepth10);
+  assert(dsp != nullptr);
+  static_cast<void>(dsp);
+#if DSP_ENABLED_10BPP_SSE4_1(ConvolveHorizontal)
+  dsp->convolve[0][0][0][1] = ConvolveHorizontal_SSE4_1<kBitdepth10>;
+#endif
+#if DSP_ENABLED_10BPP_SSE4_1(ConvolveVertical)
+  dsp->convolve[0][0][1][0] = ConvolveVertical_SSE4_1<kBitdepth10>;
+#endif
+#if DSP_ENABLED_10BPP_SSE4_1(Convolve2D)
+  dsp->convolve[0][0][1][1] =
+      Convolve2D_SSE4_1<kBitdepth10, /*is_compound=*/false>;
+#endif
+
+#if DSP_ENABLED_10BPP_SSE4_1(ConvolveCompoundCopy)
+  dsp->convolve[0][1][0][0] = ConvolveCompoundCopy_SSE4_1<kBitdepth10>;
+#endif
+#if DSP_ENABLED_10BPP_SSE4_1(ConvolveCompoundHorizontal)
+  dsp->convolve[0][1][0][1] = ConvolveCompoundHorizontal_SSE4_1<kBitdepth10>;
+#endif
+#if DSP_ENABLED_10BPP_SSE4_1(ConvolveCompoundVertical)
+  dsp->convolve[0][1][1][0] = ConvolveCompoundVertical_SSE4_1<kBitdepth10>;
+#endif
+#if DSP_ENABLED_10BPP_SSE4_1(ConvolveCompound2D)
+  dsp->convolve[0][1][1][1] =
+      Convolve2D_SSE4_1<kBitdepth10, /*is_compound=*/true>;
+#endif
+}
+
+#if LIBGAV1_MAX_BITDEPTH == 12
+void Init12bpp() {
+  Dsp* const dsp = dsp_internal::GetWritableDspTable(kBitdepth12);
+  assert(dsp != nullptr);
+  static_cast<void>(dsp);
+#if DSP_ENABLED_12BPP_SSE4_1(ConvolveHorizontal)
+  dsp->convolve[0][0][0][1] = ConvolveHorizontal_SSE4_1<kBitdepth12>;
+#endif
+#if DSP_ENABLED_12BPP_SSE4_1(ConvolveVertical)
+  dsp->convolve[0][0][1][0] = ConvolveVertical_SSE4_1<kBitdepth12>;
+#endif
+#if DSP_ENABLED_12BPP_SSE4_1(Convolve2D)
+  dsp->convolve[0][0][1][1] =
+      Convolve2D_SSE4_1<kBitdepth12, /*is_compound=*/false>;
+#endif
+
+#if DSP_ENABLED_12BPP_SSE4_1(ConvolveCompoundCopy)
+  dsp->convolve[0][1][0][0] = ConvolveCompoundCopy_SSE4_1<kBitdepth12>;
+#endif
+#if DSP_ENABLED_12BPP_SSE4_1(ConvolveCompoundHorizontal)
+  dsp->convolve[0][1][0][1] = ConvolveCompoundHorizontal_SSE4_1<kBitdepth12>;
+#endif
+#if DSP_ENABLED_12BPP_SSE4_1(ConvolveCompoundVertical)
+  dsp->convolve[0][1][1][0] = ConvolveCompoundVertical_SSE4_1<kBitdepth12>;
+#endif
+#if DSP_ENABLED_12BPP_SSE4_1(ConvolveCompound2D)
+  dsp->convolve[0][1][1][1] =
+      Convolve2D_SSE4_1<kBitdepth12, /*is_compound=*/true>;
+#endif
+}
+#endif  // LIBGAV1_MAX_BITDEPTH == 12
+
+}  // namespace
+
+void ConvolveInit10bpp_SSE4_1() { Init10bpp(); }
+
+void ConvolveInit12bpp_SSE4_1() {
+#if LIBGAV1_MAX_BITDEPTH == 12
+  Init12bpp();
+#endif
+}
+
+}  // namespace dsp
+}  // namespace libgav1
+
+#else   // !(LIBGAV1_TARGETING_SSE4_1 && LIBGAV1_MAX_BITDEPTH >= 10)
+namespace libgav1 {
+namespace dsp {
+
+void ConvolveInit10bpp_SSE4_1() {}
+void ConvolveInit12bpp_SSE4_1() {}
+
+}  // namespace dsp
+}  // namespace libgav1
+#endif  // LIBGAV1_TARGETING_SSE4_1 && LIBGAV1_MAX_BITDEPTH >= 10
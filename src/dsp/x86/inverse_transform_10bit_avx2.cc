@@ -0,0 +1,291 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/dsp/inverse_transform.h"
+#include "src/utils/cpu.h"
+
+#if LIBGAV1_TARGETING_AVX2 && LIBGAV1_MAX_BITDEPTH >= 10
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+#include "src/dsp/constants.h"
+#include "src/dsp/dsp.h"
+#include "src/dsp/x86/common_avx2.h"
+#include "src/utils/array_2d.h"
+#include "src/utils/common.h"
+#include "src/utils/compiler_attributes.h"
+#include "src/utils/constants.h"
+
+namespace libgav1 {
+namespace dsp {
+namespace {
+
+// Include the constants and utility functions inside the anonymous namespace.
+#include "src/dsp/inverse_transform.inc"
+
+constexpr int kLanes = 8;
+using Vec = __m256i;
+
+LIBGAV1_ALWAYS_INLINE Vec VecZero() { return _mm256_setzero_si256(); }
+LIBGAV1_ALWAYS_INLINE Vec VecSet1(int32_t value) {
+  return _mm256_set1_epi32(value);
+}
+LIBGAV1_ALWAYS_INLINE Vec VecAdd(const Vec a, const Vec b) {
+  return _mm256_add_epi32(a, b);
+}
+LIBGAV1_ALWAYS_INLINE Vec VecSub(const Vec a, const Vec b) {
+  return _mm256_sub_epi32(a, b);
+}
+LIBGAV1_ALWAYS_INLINE Vec VecMul(const Vec a, const Vec b) {
+  return _mm256_mullo_epi32(a, b);
+}
+LIBGAV1_ALWAYS_INLINE Vec VecMin(const Vec a, const Vec b) {
+  return _mm256_min_epi32(a, b);
+}
+LIBGAV1_ALWAYS_INLINE Vec VecMax(const Vec a, const Vec b) {
+  return _mm256_max_epi32(a, b);
+}
+LIBGAV1_ALWAYS_INLINE Vec VecShiftRight(const Vec a, int bits) {
+  return _mm256_sra_epi32(a, _mm_cvtsi32_si128(bits));
+}
+
+// The int64_t lane functions used by the 12bpp transforms.
+LIBGAV1_ALWAYS_INLINE Vec VecMulEven(const Vec a, const Vec b) {
+  return _mm256_mul_epi32(a, b);
+}
+LIBGAV1_ALWAYS_INLINE Vec VecOddToEven(const Vec a) {
+  return _mm256_srli_epi64(a, 32);
+}
+LIBGAV1_ALWAYS_INLINE Vec VecSet1Wide(int64_t value) {
+  return _mm256_set1_epi64x(value);
+}
+LIBGAV1_ALWAYS_INLINE Vec VecAddWide(const Vec a, const Vec b) {
+  return _mm256_add_epi64(a, b);
+}
+LIBGAV1_ALWAYS_INLINE Vec VecSubWide(const Vec a, const Vec b) {
+  return _mm256_sub_epi64(a, b);
+}
+LIBGAV1_ALWAYS_INLINE Vec VecShiftRightWide(const Vec a, int bits) {
+  return _mm256_srl_epi64(a, _mm_cvtsi32_si128(bits));
+}
+LIBGAV1_ALWAYS_INLINE Vec VecMergeWide(const Vec even, const Vec odd) {
+  return _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+}
+
+// Only the column transforms of 4 wide blocks use 4 lanes. The 1D transforms
+// of size 4 are left to the sse4 implementation.
+LIBGAV1_ALWAYS_INLINE Vec VecLoad(const int32_t* src, int lanes) {
+  assert(lanes == 4 || lanes == kLanes);
+  if (lanes == kLanes) return LoadUnaligned32(src);
+  return _mm256_inserti128_si256(VecZero(), LoadUnaligned16(src), 0);
+}
+
+LIBGAV1_ALWAYS_INLINE void VecStore(int32_t* dst, const Vec a, int lanes) {
+  assert(lanes == 4 || lanes == kLanes);
+  if (lanes == kLanes) {
+    StoreUnaligned32(dst, a);
+    return;
+  }
+  StoreUnaligned16(dst, _mm256_castsi256_si128(a));
+}
+
+LIBGAV1_ALWAYS_INLINE Vec VecReverse(const Vec a, int lanes) {
+  assert(lanes == 4 || lanes == kLanes);
+  if (lanes == kLanes) {
+    return _mm256_permutevar8x32_epi32(
+        a, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+  }
+  // Only the low 128 bits are used.
+  return _mm256_shuffle_epi32(a, 0x1B);
+}
+
+LIBGAV1_ALWAYS_INLINE void VecAddToPixels(uint16_t* dst, const Vec a,
+                                          int lanes, const Vec max) {
+  assert(lanes == 4 || lanes == kLanes);
+  if (lanes == kLanes) {
+    const __m256i pixels = _mm256_cvtepu16_epi32(LoadUnaligned16(dst));
+    const __m256i sum = _mm256_min_epi32(_mm256_add_epi32(pixels, a), max);
+    // _mm_packus_epi32() clamps the negative sums to 0.
+    StoreUnaligned16(dst, _mm_packus_epi32(_mm256_castsi256_si128(sum),
+                                           _mm256_extracti128_si256(sum, 1)));
+    return;
+  }
+  const __m128i pixels = _mm_cvtepu16_epi32(LoadLo8(dst));
+  const __m128i sum = _mm_min_epi32(
+      _mm_add_epi32(pixels, _mm256_castsi256_si128(a)),
+      _mm256_castsi256_si128(max));
+  StoreLo8(dst, _mm_packus_epi32(sum, sum));
+}
+
+LIBGAV1_ALWAYS_INLINE void Transpose(const Vec in[kLanes], Vec out[kLanes]) {
+  // Transpose the 4x4 blocks within each 128 bit lane.
+  const __m256i a0 = _mm256_unpacklo_epi32(in[0], in[1]);
+  const __m256i a1 = _mm256_unpacklo_epi32(in[2], in[3]);
+  const __m256i a2 = _mm256_unpackhi_epi32(in[0], in[1]);
+  const __m256i a3 = _mm256_unpackhi_epi32(in[2], in[3]);
+  const __m256i a4 = _mm256_unpacklo_epi32(in[4], in[5]);
+  const __m256i a5 = _mm256_unpacklo_epi32(in[6], in[7]);
+  const __m256i a6 = _mm256_unpackhi_epi32(in[4], in[5]);
+  const __m256i a7 = _mm256_unpackhi_epi32(in[6], in[7]);
+  const __m256i b0 = _mm256_unpacklo_epi64(a0, a1);
+  const __m256i b1 = _mm256_unpackhi_epi64(a0, a1);
+  const __m256i b2 = _mm256_unpacklo_epi64(a2, a3);
+  const __m256i b3 = _mm256_unpackhi_epi64(a2, a3);
+  const __m256i b4 = _mm256_unpacklo_epi64(a4, a5);
+  const __m256i b5 = _mm256_unpackhi_epi64(a4, a5);
+  const __m256i b6 = _mm256_unpacklo_epi64(a6, a7);
+  const __m256i b7 = _mm256_unpackhi_epi64(a6, a7);
+  // Swap the off diagonal 4x4 blocks.
+  out[0] = _mm256_permute2x128_si256(b0, b4, 0x20);
+  out[1] = _mm256_permute2x128_si256(b1, b5, 0x20);
+  out[2] = _mm256_permute2x128_si256(b2, b6, 0x20);
+  out[3] = _mm256_permute2x128_si256(b3, b7, 0x20);
+  out[4] = _mm256_permute2x128_si256(b0, b4, 0x31);
+  out[5] = _mm256_permute2x128_si256(b1, b5, 0x31);
+  out[6] = _mm256_permute2x128_si256(b2, b6, 0x31);
+  out[7] = _mm256_permute2x128_si256(b3, b7, 0x31);
+}
+
+#include "src/dsp/x86/inverse_transform_10bit_sse4.inc"
+
+void Init10bpp() {
+  Dsp* const dsp = dsp_internal::GetWritableDspTable(kBitdepth10);
+  assert(dsp != nullptr);
+  static_cast<void>(dsp);
+
+  // Maximum transform size for Dct is 64.
+#if DSP_ENABLED_10BPP_AVX2(Transform1dSize8_Transform1dDct)
+  SetTransformLoops<kBitdepth10, kTransform1dDct, 3, Dct<kBitdepth10, 3>,
+                    Dct<kBitdepth10, 3>>(dsp);
+#endif
+#if DSP_ENABLED_10BPP_AVX2(Transform1dSize16_Transform1dDct)
+  SetTransformLoops<kBitdepth10, kTransform1dDct, 4, Dct<kBitdepth10, 4>,
+                    Dct<kBitdepth10, 4>>(dsp);
+#endif
+#if DSP_ENABLED_10BPP_AVX2(Transform1dSize32_Transform1dDct)
+  SetTransformLoops<kBitdepth10, kTransform1dDct, 5, Dct<kBitdepth10, 5>,
+                    Dct<kBitdepth10, 5>>(dsp);
+#endif
+#if DSP_ENABLED_10BPP_AVX2(Transform1dSize64_Transform1dDct)
+  SetTransformLoops<kBitdepth10, kTransform1dDct, 6, Dct<kBitdepth10, 6>,
+                    Dct<kBitdepth10, 6>>(dsp);
+#endif
+
+  // Maximum transform size for Adst is 16.
+#if DSP_ENABLED_10BPP_AVX2(Transform1dSize8_Transform1dAdst)
+  SetTransformLoops<kBitdepth10, kTransform1dAdst, 3, Adst8<kBitdepth10>,
+                    Adst8<kBitdepth10>>(dsp);
+#endif
+#if DSP_ENABLED_10BPP_AVX2(Transform1dSize16_Transform1dAdst)
+  SetTransformLoops<kBitdepth10, kTransform1dAdst, 4, Adst16<kBitdepth10>,
+                    Adst16<kBitdepth10>>(dsp);
+#endif
+
+  // Maximum transform size for Identity transform is 32.
+#if DSP_ENABLED_10BPP_AVX2(Transform1dSize8_Transform1dIdentity)
+  SetTransformLoops<kBitdepth10, kTransform1dIdentity, 3,
+                    IdentityRow<kBitdepth10, 8>,
+                    IdentityColumn<kBitdepth10, 8>>(dsp);
+#endif
+#if DSP_ENABLED_10BPP_AVX2(Transform1dSize16_Transform1dIdentity)
+  SetTransformLoops<kBitdepth10, kTransform1dIdentity, 4,
+                    IdentityRow<kBitdepth10, 16>,
+                    IdentityColumn<kBitdepth10, 16>>(dsp);
+#endif
+#if DSP_ENABLED_10BPP_AVX2(Transform1dSize32_Transform1dIdentity)
+  SetTransformLoops<kBitdepth10, kTransform1dIdentity, 5,
+                    IdentityRow<kBitdepth10, 32>,
+                    IdentityColumn<kBitdepth10, 32>>(dsp);
+#endif
+}
+
+#if LIBGAV1_MAX_BITDEPTH == 12
+void Init12bpp() {
+  Dsp* const dsp = dsp_internal::GetWritableDspTable(kBitdepth12);
+  assert(dsp != nullptr);
+  static_cast<void>(dsp);
+
+  // Maximum transform size for Dct is 64.
+#if DSP_ENABLED_12BPP_AVX2(Transform1dSize8_Transform1dDct)
+  SetTransformLoops<kBitdepth12, kTransform1dDct, 3, Dct<kBitdepth12, 3>,
+                    Dct<kBitdepth12, 3>>(dsp);
+#endif
+#if DSP_ENABLED_12BPP_AVX2(Transform1dSize16_Transform1dDct)
+  SetTransformLoops<kBitdepth12, kTransform1dDct, 4, Dct<kBitdepth12, 4>,
+                    Dct<kBitdepth12, 4>>(dsp);
+#endif
+#if DSP_ENABLED_12BPP_AVX2(Transform1dSize32_Transform1dDct)
+  SetTransformLoops<kBitdepth12, kTransform1dDct, 5, Dct<kBitdepth12, 5>,
+                    Dct<kBitdepth12, 5>>(dsp);
+#endif
+#if DSP_ENABLED_12BPP_AVX2(Transform1dSize64_Transform1dDct)
+  SetTransformLoops<kBitdepth12, kTransform1dDct, 6, Dct<kBitdepth12, 6>,
+                    Dct<kBitdepth12, 6>>(dsp);
+#endif
+
+  // Maximum transform size for Adst is 16.
+#if DSP_ENABLED_12BPP_AVX2(Transform1dSize8_Transform1dAdst)
+  SetTransformLoops<kBitdepth12, kTransform1dAdst, 3, Adst8<kBitdepth12>,
+                    Adst8<kBitdepth12>>(dsp);
+#endif
+#if DSP_ENABLED_12BPP_AVX2(Transform1dSize16_Transform1dAdst)
+  SetTransformLoops<kBitdepth12, kTransform1dAdst, 4, Adst16<kBitdepth12>,
+                    Adst16<kBitdepth12>>(dsp);
+#endif
+
+  // Maximum transform size for Identity transform is 32.
+#if DSP_ENABLED_12BPP_AVX2(Transform1dSize8_Transform1dIdentity)
+  SetTransformLoops<kBitdepth12, kTransform1dIdentity, 3,
+                    IdentityRow<kBitdepth12, 8>,
+                    IdentityColumn<kBitdepth12, 8>>(dsp);
+#endif
+#if DSP_ENABLED_12BPP_AVX2(Transform1dSize16_Transform1dIdentity)
+  SetTransformLoops<kBitdepth12, kTransform1dIdentity, 4,
+                    IdentityRow<kBitdepth12, 16>,
+                    IdentityColumn<kBitdepth12, 16>>(dsp);
+#endif
+#if DSP_ENABLED_12BPP_AVX2(Transform1dSize32_Transform1dIdentity)
+  SetTransformLoops<kBitdepth12, kTransform1dIdentity, 5,
+                    IdentityRow<kBitdepth12, 32>,
+                    IdentityColumn<kBitdepth12, 32>>(dsp);
+#endif
+}
+#endif  // LIBGAV1_MAX_BITDEPTH == 12
+
+}  // namespace
+
+void InverseTransformInit10bpp_AVX2() { Init10bpp(); }
+
+void InverseTransformInit12bpp_AVX2() {
+#if LIBGAV1_MAX_BITDEPTH == 12
+  Init12bpp();
+#endif
+}
+
+}  // namespace dsp
+}  // namespace libgav1
+#else   // !(LIBGAV1_TARGETING_AVX2 && LIBGAV1_MAX_BITDEPTH >= 10)
+namespace libgav1 {
+namespace dsp {
+
+void InverseTransformInit10bpp_AVX2() {}
+void InverseTransformInit12bpp_AVX2() {}
+
+}  // namespace dsp
+}  // namespace libgav1
+#endif  // LIBGAV1_TARGETING_AVX2 && LIBGAV1_MAX_BITDEPTH >= 10
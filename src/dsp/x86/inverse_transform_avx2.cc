@@ -0,0 +1,1113 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/dsp/inverse_transform.h"
+#include "src/utils/cpu.h"
+
+#if LIBGAV1_TARGETING_AVX2
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+#include "src/dsp/constants.h"
+#include "src/dsp/dsp.h"
+#include "src/dsp/x86/common_avx2.h"
+#include "src/utils/array_2d.h"
+#include "src/utils/common.h"
+#include "src/utils/compiler_attributes.h"
+#include "src/utils/constants.h"
+
+namespace libgav1 {
+namespace dsp {
+namespace low_bitdepth {
+namespace {
+
+// Include the constants and utility functions inside the anonymous namespace.
+#include "src/dsp/inverse_transform.inc"
+
+// The transforms here mirror inverse_transform_sse4.cc with 16 lanes per
+// register. Rows are processed 16 at a time: an 8x8 transpose within each 128
+// bit lane puts rows 0-7 in the low lane and rows 8-15 in the high lane of
+// every coefficient. Columns are processed 16 at a time without transposes;
+// 4 and 8 wide blocks only use the low lanes.
+
+// Transposes two 8x8 blocks of 16 bit values, one in each 128 bit lane.
+LIBGAV1_ALWAYS_INLINE void Transpose8x8x2_U16(const __m256i* const in,
+                                              __m256i* const out) {
+  const __m256i a0 = _mm256_unpacklo_epi16(in[0], in[1]);
+  const __m256i a1 = _mm256_unpacklo_epi16(in[2], in[3]);
+  const __m256i a2 = _mm256_unpacklo_epi16(in[4], in[5]);
+  const __m256i a3 = _mm256_unpacklo_epi16(in[6], in[7]);
+  const __m256i a4 = _mm256_unpackhi_epi16(in[0], in[1]);
+  const __m256i a5 = _mm256_unpackhi_epi16(in[2], in[3]);
+  const __m256i a6 = _mm256_unpackhi_epi16(in[4], in[5]);
+  const __m256i a7 = _mm256_unpackhi_epi16(in[6], in[7]);
+
+  const __m256i b0 = _mm256_unpacklo_epi32(a0, a1);
+  const __m256i b1 = _mm256_unpacklo_epi32(a2, a3);
+  const __m256i b2 = _mm256_unpacklo_epi32(a4, a5);
+  const __m256i b3 = _mm256_unpacklo_epi32(a6, a7);
+  const __m256i b4 = _mm256_unpackhi_epi32(a0, a1);
+  const __m256i b5 = _mm256_unpackhi_epi32(a2, a3);
+  const __m256i b6 = _mm256_unpackhi_epi32(a4, a5);
+  const __m256i b7 = _mm256_unpackhi_epi32(a6, a7);
+
+  out[0] = _mm256_unpacklo_epi64(b0, b1);
+  out[1] = _mm256_unpackhi_epi64(b0, b1);
+  out[2] = _mm256_unpacklo_epi64(b4, b5);
+  out[3] = _mm256_unpackhi_epi64(b4, b5);
+  out[4] = _mm256_unpacklo_epi64(b2, b3);
+  out[5] = _mm256_unpackhi_epi64(b2, b3);
+  out[6] = _mm256_unpacklo_epi64(b6, b7);
+  out[7] = _mm256_unpackhi_epi64(b6, b7);
+}
+
+// Loads an 8 column block of up to 16 rows and transposes it. |x[k]| holds
+// column |k| of rows 0-7 in the low lane and of rows 8-15 in the high lane.
+// Rows at or beyond |num_rows| are treated as zero.
+LIBGAV1_ALWAYS_INLINE void LoadTransposed(const int16_t* LIBGAV1_RESTRICT src,
+                                          const int32_t step,
+                                          const int num_rows,
+                                          __m256i* const x) {
+  const __m128i zero = _mm_setzero_si128();
+  __m256i input[8];
+  for (int i = 0; i < 8; ++i) {
+    const __m128i lo = (i < num_rows) ? LoadUnaligned16(&src[i * step]) : zero;
+    const __m128i hi =
+        (i + 8 < num_rows) ? LoadUnaligned16(&src[(i + 8) * step]) : zero;
+    input[i] = SetrM128i(lo, hi);
+  }
+  Transpose8x8x2_U16(input, x);
+}
+
+// The inverse of LoadTransposed(). Only the first |num_rows| rows are stored.
+LIBGAV1_ALWAYS_INLINE void StoreTransposed(int16_t* LIBGAV1_RESTRICT dst,
+                                           const int32_t step,
+                                           const int num_rows,
+                                           const __m256i* const s) {
+  __m256i output[8];
+  Transpose8x8x2_U16(s, output);
+  for (int i = 0; i < 8; ++i) {
+    if (i < num_rows) {
+      StoreUnaligned16(&dst[i * step], _mm256_castsi256_si128(output[i]));
+    }
+    if (i + 8 < num_rows) {
+      StoreUnaligned16(&dst[(i + 8) * step],
+                       _mm256_extracti128_si256(output[i], 1));
+    }
+  }
+}
+
+// Loads the first |width| (4, 8 or 16) values of a row. The remaining lanes
+// are zero. If |flip| is true the values are loaded in reverse order.
+LIBGAV1_ALWAYS_INLINE __m256i LoadColumns(const int16_t* LIBGAV1_RESTRICT src,
+                                          const int width, const bool flip) {
+  const __m128i word_reverse_8 =
+      _mm_set_epi32(0x01000302, 0x05040706, 0x09080b0a, 0x0d0c0f0e);
+  if (width == 16) {
+    const __m256i v = LoadUnaligned32(src);
+    if (!flip) return v;
+    const __m256i word_reverse_16 = SetrM128i(word_reverse_8, word_reverse_8);
+    return _mm256_permute4x64_epi64(_mm256_shuffle_epi8(v, word_reverse_16),
+                                    0x4e);
+  }
+  __m128i v;
+  if (width == 8) {
+    v = LoadUnaligned16(src);
+    if (flip) v = _mm_shuffle_epi8(v, word_reverse_8);
+  } else {
+    assert(width == 4);
+    v = LoadLo8(src);
+    if (flip) v = _mm_shufflelo_epi16(v, 0x1b);
+  }
+  return SetrM128i(v, _mm_setzero_si128());
+}
+
+// Rounds the first |width| residuals of |residual| and adds them to the frame
+// pixels at |dst|.
+LIBGAV1_ALWAYS_INLINE void AddToFrameWithRound(uint8_t* LIBGAV1_RESTRICT dst,
+                                               const __m256i residual,
+                                               const int width) {
+  // Saturate to prevent overflowing int16_t.
+  const __m256i a = _mm256_adds_epi16(residual, _mm256_set1_epi16(8));
+  const __m256i b = _mm256_srai_epi16(a, 4);
+  if (width == 16) {
+    const __m256i frame_data = _mm256_cvtepu8_epi16(LoadUnaligned16(dst));
+    const __m256i c = _mm256_adds_epi16(frame_data, b);
+    StoreUnaligned16(dst, _mm_packus_epi16(_mm256_castsi256_si128(c),
+                                           _mm256_extracti128_si256(c, 1)));
+    return;
+  }
+  const __m128i b_lo = _mm256_castsi256_si128(b);
+  if (width == 8) {
+    const __m128i frame_data = _mm_cvtepu8_epi16(LoadLo8(dst));
+    const __m128i c = _mm_adds_epi16(frame_data, b_lo);
+    StoreLo8(dst, _mm_packus_epi16(c, c));
+    return;
+  }
+  assert(width == 4);
+  const __m128i frame_data = _mm_cvtepu8_epi16(Load4(dst));
+  const __m128i c = _mm_adds_epi16(frame_data, b_lo);
+  Store4(dst, _mm_packus_epi16(c, c));
+}
+
+// Butterfly rotate 16 values.
+LIBGAV1_ALWAYS_INLINE void ButterflyRotation_16(__m256i* a, __m256i* b,
+                                                const int angle,
+                                                const bool flip) {
+  const int16_t cos128 = Cos128(angle);
+  const int16_t sin128 = Sin128(angle);
+  const __m256i psin_pcos = _mm256_set1_epi32(
+      static_cast<uint16_t>(cos128) | (static_cast<uint32_t>(sin128) << 16));
+  const __m256i sign = _mm256_set1_epi32(static_cast<int>(0x80000001));
+  // -sin cos, -sin cos, -sin cos, -sin cos
+  const __m256i msin_pcos = _mm256_sign_epi16(psin_pcos, sign);
+  const __m256i ba = _mm256_unpacklo_epi16(*a, *b);
+  const __m256i ab = _mm256_unpacklo_epi16(*b, *a);
+  const __m256i ba_hi = _mm256_unpackhi_epi16(*a, *b);
+  const __m256i ab_hi = _mm256_unpackhi_epi16(*b, *a);
+  const __m256i x0 = _mm256_madd_epi16(ba, msin_pcos);
+  const __m256i y0 = _mm256_madd_epi16(ab, psin_pcos);
+  const __m256i x0_hi = _mm256_madd_epi16(ba_hi, msin_pcos);
+  const __m256i y0_hi = _mm256_madd_epi16(ab_hi, psin_pcos);
+  const __m256i x1 = RightShiftWithRounding_S32(x0, 12);
+  const __m256i y1 = RightShiftWithRounding_S32(y0, 12);
+  const __m256i x1_hi = RightShiftWithRounding_S32(x0_hi, 12);
+  const __m256i y1_hi = RightShiftWithRounding_S32(y0_hi, 12);
+  const __m256i x = _mm256_packs_epi32(x1, x1_hi);
+  const __m256i y = _mm256_packs_epi32(y1, y1_hi);
+  if (flip) {
+    *a = y;
+    *b = x;
+  } else {
+    *a = x;
+    *b = y;
+  }
+}
+
+LIBGAV1_ALWAYS_INLINE void ButterflyRotation_FirstIsZero(__m256i* a, __m256i* b,
+                                                         const int angle,
+                                                         const bool flip) {
+  const int16_t cos128 = Cos128(angle);
+  const int16_t sin128 = Sin128(angle);
+  const __m256i pcos = _mm256_set1_epi16(cos128 << 3);
+  const __m256i psin = _mm256_set1_epi16(-(sin128 << 3));
+  const __m256i x = _mm256_mulhrs_epi16(*b, psin);
+  const __m256i y = _mm256_mulhrs_epi16(*b, pcos);
+  if (flip) {
+    *a = y;
+    *b = x;
+  } else {
+    *a = x;
+    *b = y;
+  }
+}
+
+LIBGAV1_ALWAYS_INLINE void ButterflyRotation_SecondIsZero(__m256i* a,
+                                                          __m256i* b,
+                                                          const int angle,
+                                                          const bool flip) {
+  const int16_t cos128 = Cos128(angle);
+  const int16_t sin128 = Sin128(angle);
+  const __m256i pcos = _mm256_set1_epi16(cos128 << 3);
+  const __m256i psin = _mm256_set1_epi16(sin128 << 3);
+  const __m256i x = _mm256_mulhrs_epi16(*a, pcos);
+  const __m256i y = _mm256_mulhrs_epi16(*a, psin);
+  if (flip) {
+    *a = y;
+    *b = x;
+  } else {
+    *a = x;
+    *b = y;
+  }
+}
+
+LIBGAV1_ALWAYS_INLINE void HadamardRotation(__m256i* a, __m256i* b, bool flip) {
+  __m256i x, y;
+  if (flip) {
+    y = _mm256_adds_epi16(*b, *a);
+    x = _mm256_subs_epi16(*b, *a);
+  } else {
+    x = _mm256_adds_epi16(*a, *b);
+    y = _mm256_subs_epi16(*a, *b);
+  }
+  *a = x;
+  *b = y;
+}
+
+LIBGAV1_ALWAYS_INLINE __m256i ShiftResidual(const __m256i residual,
+                                            const __m256i v_row_shift_add,
+                                            const __m128i v_row_shift) {
+  const __m256i k7ffd = _mm256_set1_epi16(0x7ffd);
+  // The max row_shift is 2, so int16_t values greater than 0x7ffd may
+  // overflow.  Generate a mask for this case.
+  const __m256i mask = _mm256_cmpgt_epi16(residual, k7ffd);
+  const __m256i x = _mm256_add_epi16(residual, v_row_shift_add);
+  // Assume int16_t values.
+  const __m256i a = _mm256_sra_epi16(x, v_row_shift);
+  // Assume uint16_t values.
+  const __m256i b = _mm256_srl_epi16(x, v_row_shift);
+  // Select the correct shifted value.
+  return _mm256_blendv_epi8(a, b, mask);
+}
+
+//------------------------------------------------------------------------------
+// Discrete Cosine Transforms (DCT).
+
+template <int width>
+LIBGAV1_ALWAYS_INLINE bool DctDcOnly(void* dest, int adjusted_tx_height,
+                                     bool should_round, int row_shift) {
+  if (adjusted_tx_height > 1) return false;
+
+  auto* dst = static_cast<int16_t*>(dest);
+  const __m128i v_src = _mm_set1_epi16(dst[0]);
+  const __m128i v_mask =
+      _mm_set1_epi16(should_round ? static_cast<int16_t>(0xffff) : 0);
+  const __m128i v_kTransformRowMultiplier =
+      _mm_set1_epi16(kTransformRowMultiplier << 3);
+  const __m128i v_src_round =
+      _mm_mulhrs_epi16(v_src, v_kTransformRowMultiplier);
+  const __m128i s0 = _mm_blendv_epi8(v_src, v_src_round, v_mask);
+  const int16_t cos128 = Cos128(32);
+  const __m128i xy = _mm_mulhrs_epi16(s0, _mm_set1_epi16(cos128 << 3));
+
+  // Expand to 32 bits to prevent int16_t overflows during the shift add.
+  const __m128i v_row_shift_add = _mm_set1_epi32(row_shift);
+  const __m128i v_row_shift = _mm_cvtepu32_epi64(v_row_shift_add);
+  const __m128i a = _mm_add_epi32(_mm_cvtepi16_epi32(xy), v_row_shift_add);
+  const __m128i b = _mm_sra_epi32(a, v_row_shift);
+  const __m256i xy_shifted = _mm256_broadcastsi128_si256(_mm_packs_epi32(b, b));
+
+  for (int i = 0; i < width; i += 16) {
+    StoreUnaligned32(&dst[i], xy_shifted);
+  }
+  return true;
+}
+
+// Adds the dc only column transform of the first row of |src| to every row of
+// the frame.
+template <int height>
+LIBGAV1_ALWAYS_INLINE bool DctDcOnlyColumn(const int16_t* LIBGAV1_RESTRICT src,
+                                           int adjusted_tx_height, int width,
+                                           bool flip_columns, uint8_t* dst,
+                                           int stride) {
+  if (adjusted_tx_height > 1) return false;
+
+  const int16_t cos128 = Cos128(32);
+  const __m256i v_cos128 = _mm256_set1_epi16(cos128 << 3);
+  const int step = std::min(width, 16);
+  int i = 0;
+  do {
+    const __m256i xy =
+        _mm256_mulhrs_epi16(LoadColumns(&src[i], step, flip_columns), v_cos128);
+    for (int y = 0; y < height; ++y) {
+      AddToFrameWithRound(&dst[y * stride + i], xy, step);
+    }
+    i += 16;
+  } while (i < width);
+  return true;
+}
+
+template <bool is_fast_butterfly = false>
+LIBGAV1_ALWAYS_INLINE void Dct4Stages(__m256i* s) {
+  // stage 12.
+  if (is_fast_butterfly) {
+    ButterflyRotation_SecondIsZero(&s[0], &s[1], 32, true);
+    ButterflyRotation_SecondIsZero(&s[2], &s[3], 48, false);
+  } else {
+    ButterflyRotation_16(&s[0], &s[1], 32, true);
+    ButterflyRotation_16(&s[2], &s[3], 48, false);
+  }
+
+  // stage 17.
+  HadamardRotation(&s[0], &s[3], false);
+  HadamardRotation(&s[1], &s[2], false);
+}
+
+template <bool is_fast_butterfly = false>
+LIBGAV1_ALWAYS_INLINE void Dct8Stages(__m256i* s) {
+  // stage 8.
+  if (is_fast_butterfly) {
+    ButterflyRotation_SecondIsZero(&s[4], &s[7], 56, false);
+    ButterflyRotation_FirstIsZero(&s[5], &s[6], 24, false);
+  } else {
+    ButterflyRotation_16(&s[4], &s[7], 56, false);
+    ButterflyRotation_16(&s[5], &s[6], 24, false);
+  }
+
+  // stage 13.
+  HadamardRotation(&s[4], &s[5], false);
+  HadamardRotation(&s[6], &s[7], true);
+
+  // stage 18.
+  ButterflyRotation_16(&s[6], &s[5], 32, true);
+
+  // stage 22.
+  HadamardRotation(&s[0], &s[7], false);
+  HadamardRotation(&s[1], &s[6], false);
+  HadamardRotation(&s[2], &s[5], false);
+  HadamardRotation(&s[3], &s[4], false);
+}
+
+template <bool is_fast_butterfly = false>
+LIBGAV1_ALWAYS_INLINE void Dct16Stages(__m256i* s) {
+  // stage 5.
+  if (is_fast_butterfly) {
+    ButterflyRotation_SecondIsZero(&s[8], &s[15], 60, false);
+    ButterflyRotation_FirstIsZero(&s[9], &s[14], 28, false);
+    ButterflyRotation_SecondIsZero(&s[10], &s[13], 44, false);
+    ButterflyRotation_FirstIsZero(&s[11], &s[12], 12, false);
+  } else {
+    ButterflyRotation_16(&s[8], &s[15], 60, false);
+    ButterflyRotation_16(&s[9], &s[14], 28, false);
+    ButterflyRotation_16(&s[10], &s[13], 44, false);
+    ButterflyRotation_16(&s[11], &s[12], 12, false);
+  }
+
+  // stage 9.
+  HadamardRotation(&s[8], &s[9], false);
+  HadamardRotation(&s[10], &s[11], true);
+  HadamardRotation(&s[12], &s[13], false);
+  HadamardRotation(&s[14], &s[15], true);
+
+  // stage 14.
+  ButterflyRotation_16(&s[14], &s[9], 48, true);
+  ButterflyRotation_16(&s[13], &s[10], 112, true);
+
+  // stage 19.
+  HadamardRotation(&s[8], &s[11], false);
+  HadamardRotation(&s[9], &s[10], false);
+  HadamardRotation(&s[12], &s[15], true);
+  HadamardRotation(&s[13], &s[14], true);
+
+  // stage 23.
+  ButterflyRotation_16(&s[13], &s[10], 32, true);
+  ButterflyRotation_16(&s[12], &s[11], 32, true);
+
+  // stage 26.
+  HadamardRotation(&s[0], &s[15], false);
+  HadamardRotation(&s[1], &s[14], false);
+  HadamardRotation(&s[2], &s[13], false);
+  HadamardRotation(&s[3], &s[12], false);
+  HadamardRotation(&s[4], &s[11], false);
+  HadamardRotation(&s[5], &s[10], false);
+  HadamardRotation(&s[6], &s[9], false);
+  HadamardRotation(&s[7], &s[8], false);
+}
+
+template <bool is_fast_butterfly = false>
+LIBGAV1_ALWAYS_INLINE void Dct32Stages(__m256i* s) {
+  // stage 3
+  if (is_fast_butterfly) {
+    ButterflyRotation_SecondIsZero(&s[16], &s[31], 62, false);
+    ButterflyRotation_FirstIsZero(&s[17], &s[30], 30, false);
+    ButterflyRotation_SecondIsZero(&s[18], &s[29], 46, false);
+    ButterflyRotation_FirstIsZero(&s[19], &s[28], 14, false);
+    ButterflyRotation_SecondIsZero(&s[20], &s[27], 54, false);
+    ButterflyRotation_FirstIsZero(&s[21], &s[26], 22, false);
+    ButterflyRotation_SecondIsZero(&s[22], &s[25], 38, false);
+    ButterflyRotation_FirstIsZero(&s[23], &s[24], 6, false);
+  } else {
+    ButterflyRotation_16(&s[16], &s[31], 62, false);
+    ButterflyRotation_16(&s[17], &s[30], 30, false);
+    ButterflyRotation_16(&s[18], &s[29], 46, false);
+    ButterflyRotation_16(&s[19], &s[28], 14, false);
+    ButterflyRotation_16(&s[20], &s[27], 54, false);
+    ButterflyRotation_16(&s[21], &s[26], 22, false);
+    ButterflyRotation_16(&s[22], &s[25], 38, false);
+    ButterflyRotation_16(&s[23], &s[24], 6, false);
+  }
+  // stage 6.
+  HadamardRotation(&s[16], &s[17], false);
+  HadamardRotation(&s[18], &s[19], true);
+  HadamardRotation(&s[20], &s[21], false);
+  HadamardRotation(&s[22], &s[23], true);
+  HadamardRotation(&s[24], &s[25], false);
+  HadamardRotation(&s[26], &s[27], true);
+  HadamardRotation(&s[28], &s[29], false);
+  HadamardRotation(&s[30], &s[31], true);
+
+  // stage 10.
+  ButterflyRotation_16(&s[30], &s[17], 24 + 32, true);
+  ButterflyRotation_16(&s[29], &s[18], 24 + 64 + 32, true);
+  ButterflyRotation_16(&s[26], &s[21], 24, true);
+  ButterflyRotation_16(&s[25], &s[22], 24 + 64, true);
+
+  // stage 15.
+  HadamardRotation(&s[16], &s[19], false);
+  HadamardRotation(&s[17], &s[18], false);
+  HadamardRotation(&s[20], &s[23], true);
+  HadamardRotation(&s[21], &s[22], true);
+  HadamardRotation(&s[24], &s[27], false);
+  HadamardRotation(&s[25], &s[26], false);
+  HadamardRotation(&s[28], &s[31], true);
+  HadamardRotation(&s[29], &s[30], true);
+
+  // stage 20.
+  ButterflyRotation_16(&s[29], &s[18], 48, true);
+  ButterflyRotation_16(&s[28], &s[19], 48, true);
+  ButterflyRotation_16(&s[27], &s[20], 48 + 64, true);
+  ButterflyRotation_16(&s[26], &s[21], 48 + 64, true);
+
+  // stage 24.
+  HadamardRotation(&s[16], &s[23], false);
+  HadamardRotation(&s[17], &s[22], false);
+  HadamardRotation(&s[18], &s[21], false);
+  HadamardRotation(&s[19], &s[20], false);
+  HadamardRotation(&s[24], &s[31], true);
+  HadamardRotation(&s[25], &s[30], true);
+  HadamardRotation(&s[26], &s[29], true);
+  HadamardRotation(&s[27], &s[28], true);
+
+  // stage 27.
+  ButterflyRotation_16(&s[27], &s[20], 32, true);
+  ButterflyRotation_16(&s[26], &s[21], 32, true);
+  ButterflyRotation_16(&s[25], &s[22], 32, true);
+  ButterflyRotation_16(&s[24], &s[23], 32, true);
+
+  // stage 29.
+  HadamardRotation(&s[0], &s[31], false);
+  HadamardRotation(&s[1], &s[30], false);
+  HadamardRotation(&s[2], &s[29], false);
+  HadamardRotation(&s[3], &s[28], false);
+  HadamardRotation(&s[4], &s[27], false);
+  HadamardRotation(&s[5], &s[26], false);
+  HadamardRotation(&s[6], &s[25], false);
+  HadamardRotation(&s[7], &s[24], false);
+  HadamardRotation(&s[8], &s[23], false);
+  HadamardRotation(&s[9], &s[22], false);
+  HadamardRotation(&s[10], &s[21], false);
+  HadamardRotation(&s[11], &s[20], false);
+  HadamardRotation(&s[12], &s[19], false);
+  HadamardRotation(&s[13], &s[18], false);
+  HadamardRotation(&s[14], &s[17], false);
+  HadamardRotation(&s[15], &s[16], false);
+}
+
+LIBGAV1_ALWAYS_INLINE void Dct16(const __m256i* x, __m256i* s) {
+  // stage 1
+  // kBitReverseLookup 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15,
+  s[0] = x[0];
+  s[1] = x[8];
+  s[2] = x[4];
+  s[3] = x[12];
+  s[4] = x[2];
+  s[5] = x[10];
+  s[6] = x[6];
+  s[7] = x[14];
+  s[8] = x[1];
+  s[9] = x[9];
+  s[10] = x[5];
+  s[11] = x[13];
+  s[12] = x[3];
+  s[13] = x[11];
+  s[14] = x[7];
+  s[15] = x[15];
+
+  Dct4Stages(s);
+  Dct8Stages(s);
+  Dct16Stages(s);
+}
+
+LIBGAV1_ALWAYS_INLINE void Dct32(const __m256i* x, __m256i* s) {
+  // stage 1
+  // kBitReverseLookup
+  // 0, 16, 8, 24, 4, 20, 12, 28, 2, 18, 10, 26, 6, 22, 14, 30,
+  s[0] = x[0];
+  s[1] = x[16];
+  s[2] = x[8];
+  s[3] = x[24];
+  s[4] = x[4];
+  s[5] = x[20];
+  s[6] = x[12];
+  s[7] = x[28];
+  s[8] = x[2];
+  s[9] = x[18];
+  s[10] = x[10];
+  s[11] = x[26];
+  s[12] = x[6];
+  s[13] = x[22];
+  s[14] = x[14];
+  s[15] = x[30];
+
+  // 1, 17, 9, 25, 5, 21, 13, 29, 3, 19, 11, 27, 7, 23, 15, 31,
+  s[16] = x[1];
+  s[17] = x[17];
+  s[18] = x[9];
+  s[19] = x[25];
+  s[20] = x[5];
+  s[21] = x[21];
+  s[22] = x[13];
+  s[23] = x[29];
+  s[24] = x[3];
+  s[25] = x[19];
+  s[26] = x[11];
+  s[27] = x[27];
+  s[28] = x[7];
+  s[29] = x[23];
+  s[30] = x[15];
+  s[31] = x[31];
+
+  Dct4Stages(s);
+  Dct8Stages(s);
+  Dct16Stages(s);
+  Dct32Stages(s);
+}
+
+// Only the first 32 of the 64 inputs can be non-zero. Allow the compiler to
+// call this function instead of force inlining.
+void Dct64(const __m256i* x, __m256i* s) {
+  // stage 1
+  // kBitReverseLookup
+  // 0, 32, 16, 48, 8, 40, 24, 56, 4, 36, 20, 52, 12, 44, 28, 60,
+  s[0] = x[0];
+  s[2] = x[16];
+  s[4] = x[8];
+  s[6] = x[24];
+  s[8] = x[4];
+  s[10] = x[20];
+  s[12] = x[12];
+  s[14] = x[28];
+
+  // 2, 34, 18, 50, 10, 42, 26, 58, 6, 38, 22, 54, 14, 46, 30, 62,
+  s[16] = x[2];
+  s[18] = x[18];
+  s[20] = x[10];
+  s[22] = x[26];
+  s[24] = x[6];
+  s[26] = x[22];
+  s[28] = x[14];
+  s[30] = x[30];
+
+  // 1, 33, 17, 49, 9, 41, 25, 57, 5, 37, 21, 53, 13, 45, 29, 61,
+  s[32] = x[1];
+  s[34] = x[17];
+  s[36] = x[9];
+  s[38] = x[25];
+  s[40] = x[5];
+  s[42] = x[21];
+  s[44] = x[13];
+  s[46] = x[29];
+
+  // 3, 35, 19, 51, 11, 43, 27, 59, 7, 39, 23, 55, 15, 47, 31, 63
+  s[48] = x[3];
+  s[50] = x[19];
+  s[52] = x[11];
+  s[54] = x[27];
+  s[56] = x[7];
+  s[58] = x[23];
+  s[60] = x[15];
+  s[62] = x[31];
+
+  Dct4Stages</*is_fast_butterfly=*/true>(s);
+  Dct8Stages</*is_fast_butterfly=*/true>(s);
+  Dct16Stages</*is_fast_butterfly=*/true>(s);
+  Dct32Stages</*is_fast_butterfly=*/true>(s);
+
+  //-- start dct 64 stages
+  // stage 2.
+  ButterflyRotation_SecondIsZero(&s[32], &s[63], 63 - 0, false);
+  ButterflyRotation_FirstIsZero(&s[33], &s[62], 63 - 32, false);
+  ButterflyRotation_SecondIsZero(&s[34], &s[61], 63 - 16, false);
+  ButterflyRotation_FirstIsZero(&s[35], &s[60], 63 - 48, false);
+  ButterflyRotation_SecondIsZero(&s[36], &s[59], 63 - 8, false);
+  ButterflyRotation_FirstIsZero(&s[37], &s[58], 63 - 40, false);
+  ButterflyRotation_SecondIsZero(&s[38], &s[57], 63 - 24, false);
+  ButterflyRotation_FirstIsZero(&s[39], &s[56], 63 - 56, false);
+  ButterflyRotation_SecondIsZero(&s[40], &s[55], 63 - 4, false);
+  ButterflyRotation_FirstIsZero(&s[41], &s[54], 63 - 36, false);
+  ButterflyRotation_SecondIsZero(&s[42], &s[53], 63 - 20, false);
+  ButterflyRotation_FirstIsZero(&s[43], &s[52], 63 - 52, false);
+  ButterflyRotation_SecondIsZero(&s[44], &s[51], 63 - 12, false);
+  ButterflyRotation_FirstIsZero(&s[45], &s[50], 63 - 44, false);
+  ButterflyRotation_SecondIsZero(&s[46], &s[49], 63 - 28, false);
+  ButterflyRotation_FirstIsZero(&s[47], &s[48], 63 - 60, false);
+
+  // stage 4.
+  HadamardRotation(&s[32], &s[33], false);
+  HadamardRotation(&s[34], &s[35], true);
+  HadamardRotation(&s[36], &s[37], false);
+  HadamardRotation(&s[38], &s[39], true);
+  HadamardRotation(&s[40], &s[41], false);
+  HadamardRotation(&s[42], &s[43], true);
+  HadamardRotation(&s[44], &s[45], false);
+  HadamardRotation(&s[46], &s[47], true);
+  HadamardRotation(&s[48], &s[49], false);
+  HadamardRotation(&s[50], &s[51], true);
+  HadamardRotation(&s[52], &s[53], false);
+  HadamardRotation(&s[54], &s[55], true);
+  HadamardRotation(&s[56], &s[57], false);
+  HadamardRotation(&s[58], &s[59], true);
+  HadamardRotation(&s[60], &s[61], false);
+  HadamardRotation(&s[62], &s[63], true);
+
+  // stage 7.
+  ButterflyRotation_16(&s[62], &s[33], 60 - 0, true);
+  ButterflyRotation_16(&s[61], &s[34], 60 - 0 + 64, true);
+  ButterflyRotation_16(&s[58], &s[37], 60 - 32, true);
+  ButterflyRotation_16(&s[57], &s[38], 60 - 32 + 64, true);
+  ButterflyRotation_16(&s[54], &s[41], 60 - 16, true);
+  ButterflyRotation_16(&s[53], &s[42], 60 - 16 + 64, true);
+  ButterflyRotation_16(&s[50], &s[45], 60 - 48, true);
+  ButterflyRotation_16(&s[49], &s[46], 60 - 48 + 64, true);
+
+  // stage 11.
+  HadamardRotation(&s[32], &s[35], false);
+  HadamardRotation(&s[33], &s[34], false);
+  HadamardRotation(&s[36], &s[39], true);
+  HadamardRotation(&s[37], &s[38], true);
+  HadamardRotation(&s[40], &s[43], false);
+  HadamardRotation(&s[41], &s[42], false);
+  HadamardRotation(&s[44], &s[47], true);
+  HadamardRotation(&s[45], &s[46], true);
+  HadamardRotation(&s[48], &s[51], false);
+  HadamardRotation(&s[49], &s[50], false);
+  HadamardRotation(&s[52], &s[55], true);
+  HadamardRotation(&s[53], &s[54], true);
+  HadamardRotation(&s[56], &s[59], false);
+  HadamardRotation(&s[57], &s[58], false);
+  HadamardRotation(&s[60], &s[63], true);
+  HadamardRotation(&s[61], &s[62], true);
+
+  // stage 16.
+  ButterflyRotation_16(&s[61], &s[34], 56, true);
+  ButterflyRotation_16(&s[60], &s[35], 56, true);
+  ButterflyRotation_16(&s[59], &s[36], 56 + 64, true);
+  ButterflyRotation_16(&s[58], &s[37], 56 + 64, true);
+  ButterflyRotation_16(&s[53], &s[42], 56 - 32, true);
+  ButterflyRotation_16(&s[52], &s[43], 56 - 32, true);
+  ButterflyRotation_16(&s[51], &s[44], 56 - 32 + 64, true);
+  ButterflyRotation_16(&s[50], &s[45], 56 - 32 + 64, true);
+
+  // stage 21.
+  HadamardRotation(&s[32], &s[39], false);
+  HadamardRotation(&s[33], &s[38], false);
+  HadamardRotation(&s[34], &s[37], false);
+  HadamardRotation(&s[35], &s[36], false);
+  HadamardRotation(&s[40], &s[47], true);
+  HadamardRotation(&s[41], &s[46], true);
+  HadamardRotation(&s[42], &s[45], true);
+  HadamardRotation(&s[43], &s[44], true);
+  HadamardRotation(&s[48], &s[55], false);
+  HadamardRotation(&s[49], &s[54], false);
+  HadamardRotation(&s[50], &s[53], false);
+  HadamardRotation(&s[51], &s[52], false);
+  HadamardRotation(&s[56], &s[63], true);
+  HadamardRotation(&s[57], &s[62], true);
+  HadamardRotation(&s[58], &s[61], true);
+  HadamardRotation(&s[59], &s[60], true);
+
+  // stage 25.
+  ButterflyRotation_16(&s[59], &s[36], 48, true);
+  ButterflyRotation_16(&s[58], &s[37], 48, true);
+  ButterflyRotation_16(&s[57], &s[38], 48, true);
+  ButterflyRotation_16(&s[56], &s[39], 48, true);
+  ButterflyRotation_16(&s[55], &s[40], 112, true);
+  ButterflyRotation_16(&s[54], &s[41], 112, true);
+  ButterflyRotation_16(&s[53], &s[42], 112, true);
+  ButterflyRotation_16(&s[52], &s[43], 112, true);
+
+  // stage 28.
+  HadamardRotation(&s[32], &s[47], false);
+  HadamardRotation(&s[33], &s[46], false);
+  HadamardRotation(&s[34], &s[45], false);
+  HadamardRotation(&s[35], &s[44], false);
+  HadamardRotation(&s[36], &s[43], false);
+  HadamardRotation(&s[37], &s[42], false);
+  HadamardRotation(&s[38], &s[41], false);
+  HadamardRotation(&s[39], &s[40], false);
+  HadamardRotation(&s[48], &s[63], true);
+  HadamardRotation(&s[49], &s[62], true);
+  HadamardRotation(&s[50], &s[61], true);
+  HadamardRotation(&s[51], &s[60], true);
+  HadamardRotation(&s[52], &s[59], true);
+  HadamardRotation(&s[53], &s[58], true);
+  HadamardRotation(&s[54], &s[57], true);
+  HadamardRotation(&s[55], &s[56], true);
+
+  // stage 30.
+  ButterflyRotation_16(&s[55], &s[40], 32, true);
+  ButterflyRotation_16(&s[54], &s[41], 32, true);
+  ButterflyRotation_16(&s[53], &s[42], 32, true);
+  ButterflyRotation_16(&s[52], &s[43], 32, true);
+  ButterflyRotation_16(&s[51], &s[44], 32, true);
+  ButterflyRotation_16(&s[50], &s[45], 32, true);
+  ButterflyRotation_16(&s[49], &s[46], 32, true);
+  ButterflyRotation_16(&s[48], &s[47], 32, true);
+
+  // stage 31.
+  for (int i = 0; i < 32; i += 4) {
+    HadamardRotation(&s[i], &s[63 - i], false);
+    HadamardRotation(&s[i + 1], &s[63 - i - 1], false);
+    HadamardRotation(&s[i + 2], &s[63 - i - 2], false);
+    HadamardRotation(&s[i + 3], &s[63 - i - 3], false);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Asymmetric Discrete Sine Transforms (ADST).
+
+LIBGAV1_ALWAYS_INLINE void Adst16(const __m256i* x, __m256i* out) {
+  __m256i s[16];
+
+  // stage 1.
+  s[0] = x[15];
+  s[1] = x[0];
+  s[2] = x[13];
+  s[3] = x[2];
+  s[4] = x[11];
+  s[5] = x[4];
+  s[6] = x[9];
+  s[7] = x[6];
+  s[8] = x[7];
+  s[9] = x[8];
+  s[10] = x[5];
+  s[11] = x[10];
+  s[12] = x[3];
+  s[13] = x[12];
+  s[14] = x[1];
+  s[15] = x[14];
+
+  // stage 2.
+  ButterflyRotation_16(&s[0], &s[1], 62 - 0, true);
+  ButterflyRotation_16(&s[2], &s[3], 62 - 8, true);
+  ButterflyRotation_16(&s[4], &s[5], 62 - 16, true);
+  ButterflyRotation_16(&s[6], &s[7], 62 - 24, true);
+  ButterflyRotation_16(&s[8], &s[9], 62 - 32, true);
+  ButterflyRotation_16(&s[10], &s[11], 62 - 40, true);
+  ButterflyRotation_16(&s[12], &s[13], 62 - 48, true);
+  ButterflyRotation_16(&s[14], &s[15], 62 - 56, true);
+
+  // stage 3.
+  HadamardRotation(&s[0], &s[8], false);
+  HadamardRotation(&s[1], &s[9], false);
+  HadamardRotation(&s[2], &s[10], false);
+  HadamardRotation(&s[3], &s[11], false);
+  HadamardRotation(&s[4], &s[12], false);
+  HadamardRotation(&s[5], &s[13], false);
+  HadamardRotation(&s[6], &s[14], false);
+  HadamardRotation(&s[7], &s[15], false);
+
+  // stage 4.
+  ButterflyRotation_16(&s[8], &s[9], 56 - 0, true);
+  ButterflyRotation_16(&s[13], &s[12], 8 + 0, true);
+  ButterflyRotation_16(&s[10], &s[11], 56 - 32, true);
+  ButterflyRotation_16(&s[15], &s[14], 8 + 32, true);
+
+  // stage 5.
+  HadamardRotation(&s[0], &s[4], false);
+  HadamardRotation(&s[8], &s[12], false);
+  HadamardRotation(&s[1], &s[5], false);
+  HadamardRotation(&s[9], &s[13], false);
+  HadamardRotation(&s[2], &s[6], false);
+  HadamardRotation(&s[10], &s[14], false);
+  HadamardRotation(&s[3], &s[7], false);
+  HadamardRotation(&s[11], &s[15], false);
+
+  // stage 6.
+  ButterflyRotation_16(&s[4], &s[5], 48 - 0, true);
+  ButterflyRotation_16(&s[12], &s[13], 48 - 0, true);
+  ButterflyRotation_16(&s[7], &s[6], 48 - 32, true);
+  ButterflyRotation_16(&s[15], &s[14], 48 - 32, true);
+
+  // stage 7.
+  HadamardRotation(&s[0], &s[2], false);
+  HadamardRotation(&s[4], &s[6], false);
+  HadamardRotation(&s[8], &s[10], false);
+  HadamardRotation(&s[12], &s[14], false);
+  HadamardRotation(&s[1], &s[3], false);
+  HadamardRotation(&s[5], &s[7], false);
+  HadamardRotation(&s[9], &s[11], false);
+  HadamardRotation(&s[13], &s[15], false);
+
+  // stage 8.
+  ButterflyRotation_16(&s[2], &s[3], 32, true);
+  ButterflyRotation_16(&s[6], &s[7], 32, true);
+  ButterflyRotation_16(&s[10], &s[11], 32, true);
+  ButterflyRotation_16(&s[14], &s[15], 32, true);
+
+  // stage 9.
+  const __m256i v_zero = _mm256_setzero_si256();
+  out[0] = s[0];
+  out[1] = _mm256_subs_epi16(v_zero, s[8]);
+  out[2] = s[12];
+  out[3] = _mm256_subs_epi16(v_zero, s[4]);
+  out[4] = s[6];
+  out[5] = _mm256_subs_epi16(v_zero, s[14]);
+  out[6] = s[10];
+  out[7] = _mm256_subs_epi16(v_zero, s[2]);
+  out[8] = s[3];
+  out[9] = _mm256_subs_epi16(v_zero, s[11]);
+  out[10] = s[15];
+  out[11] = _mm256_subs_epi16(v_zero, s[7]);
+  out[12] = s[5];
+  out[13] = _mm256_subs_epi16(v_zero, s[13]);
+  out[14] = s[9];
+  out[15] = _mm256_subs_epi16(v_zero, s[1]);
+
+}
+
+//------------------------------------------------------------------------------
+// Row and column loops.
+
+using Transform1dFunc = void (*)(const __m256i* x, __m256i* s);
+
+// Runs the row transform on up to 16 rows per iteration. The input rounding
+// and the row shift are applied in registers so every row is loaded and stored
+// only once.
+template <int tx_width, Transform1dFunc transform>
+LIBGAV1_ALWAYS_INLINE void TransformRows(int16_t* src, int adjusted_tx_height,
+                                         bool should_round, int row_shift) {
+  // The last 32 values of every row are always zero if the |tx_width| is 64.
+  constexpr int kNumColumns = (tx_width < 64) ? tx_width : 32;
+  const __m256i v_kTransformRowMultiplier =
+      _mm256_set1_epi16(kTransformRowMultiplier << 3);
+  const __m256i v_row_shift_add = _mm256_set1_epi16(row_shift);
+  const __m128i v_row_shift =
+      _mm_cvtepu16_epi64(_mm256_castsi256_si128(v_row_shift_add));
+  int i = 0;
+  do {
+    int16_t* const rows = &src[i * tx_width];
+    const int num_rows = std::min(adjusted_tx_height - i, 16);
+    __m256i x[kNumColumns], s[tx_width];
+    for (int j = 0; j < kNumColumns; j += 8) {
+      LoadTransposed(&rows[j], tx_width, num_rows, &x[j]);
+    }
+    if (should_round) {
+      for (int j = 0; j < kNumColumns; ++j) {
+        x[j] = _mm256_mulhrs_epi16(x[j], v_kTransformRowMultiplier);
+      }
+    }
+    transform(x, s);
+    for (int j = 0; j < tx_width; ++j) {
+      s[j] = ShiftResidual(s[j], v_row_shift_add, v_row_shift);
+    }
+    for (int j = 0; j < tx_width; j += 8) {
+      StoreTransposed(&rows[j], tx_width, num_rows, &s[j]);
+    }
+    i += 16;
+  } while (i < adjusted_tx_height);
+}
+
+// Runs the column transform on up to 16 columns per iteration and adds the
+// result directly to the frame.
+template <int tx_height, Transform1dFunc transform, bool enable_flip_rows>
+LIBGAV1_ALWAYS_INLINE void TransformColumns(const int16_t* LIBGAV1_RESTRICT src,
+                                            int adjusted_tx_height,
+                                            int tx_width, TransformType tx_type,
+                                            uint8_t* LIBGAV1_RESTRICT dst,
+                                            int stride) {
+  // The last 32 values of every column are always zero if the |tx_height| is
+  // 64.
+  constexpr int kNumRows = (tx_height < 64) ? tx_height : 32;
+  const bool flip_columns = kTransformFlipColumnsMask.Contains(tx_type);
+  const bool flip_rows =
+      enable_flip_rows ? kTransformFlipRowsMask.Contains(tx_type) : false;
+  const int num_rows = std::min(adjusted_tx_height, kNumRows);
+  const int step = std::min(tx_width, 16);
+  int i = 0;
+  do {
+    __m256i x[kNumRows], s[tx_height];
+    for (int j = 0; j < kNumRows; ++j) {
+      x[j] = (j < num_rows) ? LoadColumns(&src[j * tx_width + i], step,
+                                          flip_columns)
+                            : _mm256_setzero_si256();
+    }
+    transform(x, s);
+    for (int j = 0; j < tx_height; ++j) {
+      const int row = flip_rows ? tx_height - j - 1 : j;
+      AddToFrameWithRound(&dst[j * stride + i], s[row], step);
+    }
+    i += 16;
+  } while (i < tx_width);
+}
+
+void Dct16TransformLoopRow_AVX2(TransformType /*tx_type*/,
+                                TransformSize tx_size, int adjusted_tx_height,
+                                void* src_buffer, int /*start_x*/,
+                                int /*start_y*/, void* /*dst_frame*/) {
+  auto* src = static_cast<int16_t*>(src_buffer);
+  const bool should_round = kShouldRound[tx_size];
+  const uint8_t row_shift = kTransformRowShift[tx_size];
+
+  if (DctDcOnly<16>(src, adjusted_tx_height, should_round, row_shift)) {
+    return;
+  }
+  TransformRows<16, Dct16>(src, adjusted_tx_height, should_round, row_shift);
+}
+
+void Dct16TransformLoopColumn_AVX2(TransformType tx_type, TransformSize tx_size,
+                                   int adjusted_tx_height,
+                                   void* LIBGAV1_RESTRICT src_buffer,
+                                   int start_x, int start_y,
+                                   void* LIBGAV1_RESTRICT dst_frame) {
+  const auto* src = static_cast<const int16_t*>(src_buffer);
+  auto& frame = *static_cast<Array2DView<uint8_t>*>(dst_frame);
+  const int tx_width = kTransformWidth[tx_size];
+  const int stride = frame.columns();
+  uint8_t* const dst = frame[start_y] + start_x;
+
+  if (DctDcOnlyColumn<16>(src, adjusted_tx_height, tx_width,
+                          kTransformFlipColumnsMask.Contains(tx_type), dst,
+                          stride)) {
+    return;
+  }
+  TransformColumns<16, Dct16, /*enable_flip_rows=*/false>(
+      src, adjusted_tx_height, tx_width, tx_type, dst, stride);
+}
+
+void Dct32TransformLoopRow_AVX2(TransformType /*tx_type*/,
+                                TransformSize tx_size, int adjusted_tx_height,
+                                void* src_buffer, int /*start_x*/,
+                                int /*start_y*/, void* /*dst_frame*/) {
+  auto* src = static_cast<int16_t*>(src_buffer);
+  const bool should_round = kShouldRound[tx_size];
+  const uint8_t row_shift = kTransformRowShift[tx_size];
+
+  if (DctDcOnly<32>(src, adjusted_tx_height, should_round, row_shift)) {
+    return;
+  }
+  TransformRows<32, Dct32>(src, adjusted_tx_height, should_round, row_shift);
+}
+
+void Dct32TransformLoopColumn_AVX2(TransformType tx_type, TransformSize tx_size,
+                                   int adjusted_tx_height,
+                                   void* LIBGAV1_RESTRICT src_buffer,
+                                   int start_x, int start_y,
+                                   void* LIBGAV1_RESTRICT dst_frame) {
+  const auto* src = static_cast<const int16_t*>(src_buffer);
+  auto& frame = *static_cast<Array2DView<uint8_t>*>(dst_frame);
+  const int tx_width = kTransformWidth[tx_size];
+  const int stride = frame.columns();
+  uint8_t* const dst = frame[start_y] + start_x;
+
+  if (DctDcOnlyColumn<32>(src, adjusted_tx_height, tx_width,
+                          /*flip_columns=*/false, dst, stride)) {
+    return;
+  }
+  TransformColumns<32, Dct32, /*enable_flip_rows=*/false>(
+      src, adjusted_tx_height, tx_width, tx_type, dst, stride);
+}
+
+void Dct64TransformLoopRow_AVX2(TransformType /*tx_type*/,
+                                TransformSize tx_size, int adjusted_tx_height,
+                                void* src_buffer, int /*start_x*/,
+                                int /*start_y*/, void* /*dst_frame*/) {
+  auto* src = static_cast<int16_t*>(src_buffer);
+  const bool should_round = kShouldRound[tx_size];
+  const uint8_t row_shift = kTransformRowShift[tx_size];
+
+  if (DctDcOnly<64>(src, adjusted_tx_height, should_round, row_shift)) {
+    return;
+  }
+  TransformRows<64, Dct64>(src, adjusted_tx_height, should_round, row_shift);
+}
+
+void Dct64TransformLoopColumn_AVX2(TransformType tx_type, TransformSize tx_size,
+                                   int adjusted_tx_height,
+                                   void* LIBGAV1_RESTRICT src_buffer,
+                                   int start_x, int start_y,
+                                   void* LIBGAV1_RESTRICT dst_frame) {
+  const auto* src = static_cast<const int16_t*>(src_buffer);
+  auto& frame = *static_cast<Array2DView<uint8_t>*>(dst_frame);
+  const int tx_width = kTransformWidth[tx_size];
+  const int stride = frame.columns();
+  uint8_t* const dst = frame[start_y] + start_x;
+
+  if (DctDcOnlyColumn<64>(src, adjusted_tx_height, tx_width,
+                          /*flip_columns=*/false, dst, stride)) {
+    return;
+  }
+  TransformColumns<64, Dct64, /*enable_flip_rows=*/false>(
+      src, adjusted_tx_height, tx_width, tx_type, dst, stride);
+}
+
+void Adst16TransformLoopRow_AVX2(TransformType /*tx_type*/,
+                                 TransformSize tx_size, int adjusted_tx_height,
+                                 void* src_buffer, int /*start_x*/,
+                                 int /*start_y*/, void* /*dst_frame*/) {
+  auto* src = static_cast<int16_t*>(src_buffer);
+  const bool should_round = kShouldRound[tx_size];
+  const uint8_t row_shift = kTransformRowShift[tx_size];
+
+  TransformRows<16, Adst16>(src, adjusted_tx_height, should_round, row_shift);
+}
+
+void Adst16TransformLoopColumn_AVX2(TransformType tx_type,
+                                    TransformSize tx_size,
+                                    int adjusted_tx_height,
+                                    void* LIBGAV1_RESTRICT src_buffer,
+                                    int start_x, int start_y,
+                                    void* LIBGAV1_RESTRICT dst_frame) {
+  const auto* src = static_cast<const int16_t*>(src_buffer);
+  auto& frame = *static_cast<Array2DView<uint8_t>*>(dst_frame);
+  const int tx_width = kTransformWidth[tx_size];
+
+  TransformColumns<16, Adst16, /*enable_flip_rows=*/true>(
+      src, adjusted_tx_height, tx_width, tx_type, frame[start_y] + start_x,
+      frame.columns());
+}
+
+void Init8bpp() {
+  Dsp* const dsp = dsp_internal::GetWritableDspTable(kBitdepth8);
+  assert(dsp != nullptr);
+  static_cast<void>(dsp);
+
+  // Maximum transform size for Dct is 64.
+#if DSP_ENABLED_8BPP_AVX2(Transform1dSize16_Transform1dDct)
+  dsp->inverse_transforms[kTransform1dDct][kTransform1dSize16][kRow] =
+      Dct16TransformLoopRow_AVX2;
+  dsp->inverse_transforms[kTransform1dDct][kTransform1dSize16][kColumn] =
+      Dct16TransformLoopColumn_AVX2;
+#endif
+#if DSP_ENABLED_8BPP_AVX2(Transform1dSize32_Transform1dDct)
+  dsp->inverse_transforms[kTransform1dDct][kTransform1dSize32][kRow] =
+      Dct32TransformLoopRow_AVX2;
+  dsp->inverse_transforms[kTransform1dDct][kTransform1dSize32][kColumn] =
+      Dct32TransformLoopColumn_AVX2;
+#endif
+#if DSP_ENABLED_8BPP_AVX2(Transform1dSize64_Transform1dDct)
+  dsp->inverse_transforms[kTransform1dDct][kTransform1dSize64][kRow] =
+      Dct64TransformLoopRow_AVX2;
+  dsp->inverse_transforms[kTransform1dDct][kTransform1dSize64][kColumn] =
+      Dct64TransformLoopColumn_AVX2;
+#endif
+
+  // Maximum transform size for Adst is 16.
+#if DSP_ENABLED_8BPP_AVX2(Transform1dSize16_Transform1dAdst)
+  dsp->inverse_transforms[kTransform1dAdst][kTransform1dSize16][kRow] =
+      Adst16TransformLoopRow_AVX2;
+  dsp->inverse_transforms[kTransform1dAdst][kTransform1dSize16][kColumn] =
+      Adst16TransformLoopColumn_AVX2;
+#endif
+}
+
+}  // namespace
+}  // namespace low_bitdepth
+
+void InverseTransformInit_AVX2() { low_bitdepth::Init8bpp(); }
+
+}  // namespace dsp
+}  // namespace libgav1
+#else   // !LIBGAV1_TARGETING_AVX2
+namespace libgav1 {
+namespace dsp {
+
+void InverseTransformInit_AVX2() {}
+
+}  // namespace dsp
+}  // namespace libgav1
+#endif  // LIBGAV1_TARGETING_AVX2
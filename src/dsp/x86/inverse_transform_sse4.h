@@ -24,8 +24,10 @@ namespace libgav1 {
 namespace dsp {
 
 // Initializes Dsp::inverse_transforms, see the defines below for specifics.
-// This function is not thread-safe.
+// These functions are not thread-safe.
 void InverseTransformInit_SSE4_1();
+void InverseTransformInit10bpp_SSE4_1();
+void InverseTransformInit12bpp_SSE4_1();
 
 }  // namespace dsp
 }  // namespace libgav1
@@ -85,5 +87,109 @@ void InverseTransformInit_SSE4_1();
 #ifndef LIBGAV1_Dsp8bpp_Transform1dSize4_Transform1dWht
 #define LIBGAV1_Dsp8bpp_Transform1dSize4_Transform1dWht LIBGAV1_CPU_SSE4_1
 #endif
+
+#ifndef LIBGAV1_Dsp10bpp_Transform1dSize4_Transform1dDct
+#define LIBGAV1_Dsp10bpp_Transform1dSize4_Transform1dDct LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp10bpp_Transform1dSize8_Transform1dDct
+#define LIBGAV1_Dsp10bpp_Transform1dSize8_Transform1dDct LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp10bpp_Transform1dSize16_Transform1dDct
+#define LIBGAV1_Dsp10bpp_Transform1dSize16_Transform1dDct LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp10bpp_Transform1dSize32_Transform1dDct
+#define LIBGAV1_Dsp10bpp_Transform1dSize32_Transform1dDct LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp10bpp_Transform1dSize64_Transform1dDct
+#define LIBGAV1_Dsp10bpp_Transform1dSize64_Transform1dDct LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp10bpp_Transform1dSize4_Transform1dAdst
+#define LIBGAV1_Dsp10bpp_Transform1dSize4_Transform1dAdst LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp10bpp_Transform1dSize8_Transform1dAdst
+#define LIBGAV1_Dsp10bpp_Transform1dSize8_Transform1dAdst LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp10bpp_Transform1dSize16_Transform1dAdst
+#define LIBGAV1_Dsp10bpp_Transform1dSize16_Transform1dAdst LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp10bpp_Transform1dSize4_Transform1dIdentity
+#define LIBGAV1_Dsp10bpp_Transform1dSize4_Transform1dIdentity LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp10bpp_Transform1dSize8_Transform1dIdentity
+#define LIBGAV1_Dsp10bpp_Transform1dSize8_Transform1dIdentity LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp10bpp_Transform1dSize16_Transform1dIdentity
+#define LIBGAV1_Dsp10bpp_Transform1dSize16_Transform1dIdentity LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp10bpp_Transform1dSize32_Transform1dIdentity
+#define LIBGAV1_Dsp10bpp_Transform1dSize32_Transform1dIdentity LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp10bpp_Transform1dSize4_Transform1dWht
+#define LIBGAV1_Dsp10bpp_Transform1dSize4_Transform1dWht LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp12bpp_Transform1dSize4_Transform1dDct
+#define LIBGAV1_Dsp12bpp_Transform1dSize4_Transform1dDct LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp12bpp_Transform1dSize8_Transform1dDct
+#define LIBGAV1_Dsp12bpp_Transform1dSize8_Transform1dDct LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp12bpp_Transform1dSize16_Transform1dDct
+#define LIBGAV1_Dsp12bpp_Transform1dSize16_Transform1dDct LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp12bpp_Transform1dSize32_Transform1dDct
+#define LIBGAV1_Dsp12bpp_Transform1dSize32_Transform1dDct LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp12bpp_Transform1dSize64_Transform1dDct
+#define LIBGAV1_Dsp12bpp_Transform1dSize64_Transform1dDct LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp12bpp_Transform1dSize4_Transform1dAdst
+#define LIBGAV1_Dsp12bpp_Transform1dSize4_Transform1dAdst LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp12bpp_Transform1dSize8_Transform1dAdst
+#define LIBGAV1_Dsp12bpp_Transform1dSize8_Transform1dAdst LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp12bpp_Transform1dSize16_Transform1dAdst
+#define LIBGAV1_Dsp12bpp_Transform1dSize16_Transform1dAdst LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp12bpp_Transform1dSize4_Transform1dIdentity
+#define LIBGAV1_Dsp12bpp_Transform1dSize4_Transform1dIdentity LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp12bpp_Transform1dSize8_Transform1dIdentity
+#define LIBGAV1_Dsp12bpp_Transform1dSize8_Transform1dIdentity LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp12bpp_Transform1dSize16_Transform1dIdentity
+#define LIBGAV1_Dsp12bpp_Transform1dSize16_Transform1dIdentity LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp12bpp_Transform1dSize32_Transform1dIdentity
+#define LIBGAV1_Dsp12bpp_Transform1dSize32_Transform1dIdentity LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp12bpp_Transform1dSize4_Transform1dWht
+#define LIBGAV1_Dsp12bpp_Transform1dSize4_Transform1dWht LIBGAV1_CPU_SSE4_1
+#endif
 #endif  // LIBGAV1_TARGETING_SSE4_1
 #endif  // LIBGAV1_SRC_DSP_X86_INVERSE_TRANSFORM_SSE4_H_
@@ -35,26 +35,37 @@ namespace libgav1 {
 namespace dsp {
 namespace {
 
+// The rounding of the two wiener passes depends on the bitdepth.
+constexpr int WienerRoundBitsHorizontal(int bitdepth) {
+  return (bitdepth == 12) ? kInterRoundBitsHorizontal12bpp
+                          : kInterRoundBitsHorizontal;
+}
+
+constexpr int WienerRoundBitsVertical(int bitdepth) {
+  return (bitdepth == 12) ? kInterRoundBitsVertical12bpp
+                          : kInterRoundBitsVertical;
+}
+
+template <int bitdepth>
 inline void WienerHorizontalClip(const __m256i s[2],
                                  int16_t* const wiener_buffer) {
-  constexpr int offset =
-      1 << (10 + kWienerFilterBits - kInterRoundBitsHorizontal - 1);
+  constexpr int kRoundBits = WienerRoundBitsHorizontal(bitdepth);
+  constexpr int offset = 1 << (bitdepth + kWienerFilterBits - kRoundBits - 1);
   constexpr int limit = (offset << 2) - 1;
   const __m256i offsets = _mm256_set1_epi16(-offset);
   const __m256i limits = _mm256_set1_epi16(limit - offset);
-  const __m256i round = _mm256_set1_epi32(1 << (kInterRoundBitsHorizontal - 1));
+  const __m256i round = _mm256_set1_epi32(1 << (kRoundBits - 1));
   const __m256i sum0 = _mm256_add_epi32(s[0], round);
   const __m256i sum1 = _mm256_add_epi32(s[1], round);
-  const __m256i rounded_sum0 =
-      _mm256_srai_epi32(sum0, kInterRoundBitsHorizontal);
-  const __m256i rounded_sum1 =
-      _mm256_srai_epi32(sum1, kInterRoundBitsHorizontal);
+  const __m256i rounded_sum0 = _mm256_srai_epi32(sum0, kRoundBits);
+  const __m256i rounded_sum1 = _mm256_srai_epi32(sum1, kRoundBits);
   const __m256i rounded_sum = _mm256_packs_epi32(rounded_sum0, rounded_sum1);
   const __m256i d0 = _mm256_max_epi16(rounded_sum, offsets);
   const __m256i d1 = _mm256_min_epi16(d0, limits);
   StoreAligned32(wiener_buffer, d1);
 }
 
+template <int bitdepth>
 inline void WienerHorizontalTap7Kernel(const __m256i s[7],
                                        const __m256i filter[2],
                                        int16_t* const wiener_buffer) {
@@ -72,9 +83,10 @@ inline void WienerHorizontalTap7Kernel(const __m256i s[7],
   madds[3] = _mm256_madd_epi16(ss3, filter[1]);
   madds[0] = _mm256_add_epi32(madds[0], madds[2]);
   madds[1] = _mm256_add_epi32(madds[1], madds[3]);
-  WienerHorizontalClip(madds, wiener_buffer);
+  WienerHorizontalClip<bitdepth>(madds, wiener_buffer);
 }
 
+template <int bitdepth>
 inline void WienerHorizontalTap5Kernel(const __m256i s[5], const __m256i filter,
                                        int16_t* const wiener_buffer) {
   const __m256i s04 = _mm256_add_epi16(s[0], s[4]);
@@ -93,9 +105,10 @@ inline void WienerHorizontalTap5Kernel(const __m256i s[5], const __m256i filter,
   const __m256i s2x128_hi = _mm256_slli_epi32(s2_hi, 7);
   madds[0] = _mm256_add_epi32(madds[0], s2x128_lo);
   madds[1] = _mm256_add_epi32(madds[1], s2x128_hi);
-  WienerHorizontalClip(madds, wiener_buffer);
+  WienerHorizontalClip<bitdepth>(madds, wiener_buffer);
 }
 
+template <int bitdepth>
 inline void WienerHorizontalTap3Kernel(const __m256i s[3], const __m256i filter,
                                        int16_t* const wiener_buffer) {
   const __m256i s02 = _mm256_add_epi16(s[0], s[2]);
@@ -104,9 +117,10 @@ inline void WienerHorizontalTap3Kernel(const __m256i s[3], const __m256i filter,
   __m256i madds[2];
   madds[0] = _mm256_madd_epi16(ss0, filter);
   madds[1] = _mm256_madd_epi16(ss1, filter);
-  WienerHorizontalClip(madds, wiener_buffer);
+  WienerHorizontalClip<bitdepth>(madds, wiener_buffer);
 }
 
+template <int bitdepth>
 inline void WienerHorizontalTap7(const uint16_t* src,
                                  const ptrdiff_t src_stride,
                                  const ptrdiff_t width, const int height,
@@ -126,7 +140,7 @@ inline void WienerHorizontalTap7(const uint16_t* src,
       s[4] = LoadUnaligned32(src + x + 4);
       s[5] = LoadUnaligned32(src + x + 5);
       s[6] = LoadUnaligned32(src + x + 6);
-      WienerHorizontalTap7Kernel(s, filter, *wiener_buffer + x);
+      WienerHorizontalTap7Kernel<bitdepth>(s, filter, *wiener_buffer + x);
       x += 16;
     } while (x < width);
     src += src_stride;
@@ -134,6 +148,7 @@ inline void WienerHorizontalTap7(const uint16_t* src,
   }
 }
 
+template <int bitdepth>
 inline void WienerHorizontalTap5(const uint16_t* src,
                                  const ptrdiff_t src_stride,
                                  const ptrdiff_t width, const int height,
@@ -150,7 +165,7 @@ inline void WienerHorizontalTap5(const uint16_t* src,
       s[2] = LoadUnaligned32(src + x + 2);
       s[3] = LoadUnaligned32(src + x + 3);
       s[4] = LoadUnaligned32(src + x + 4);
-      WienerHorizontalTap5Kernel(s, filter, *wiener_buffer + x);
+      WienerHorizontalTap5Kernel<bitdepth>(s, filter, *wiener_buffer + x);
       x += 16;
     } while (x < width);
     src += src_stride;
@@ -158,6 +173,7 @@ inline void WienerHorizontalTap5(const uint16_t* src,
   }
 }
 
+template <int bitdepth>
 inline void WienerHorizontalTap3(const uint16_t* src,
                                  const ptrdiff_t src_stride,
                                  const ptrdiff_t width, const int height,
@@ -171,7 +187,7 @@ inline void WienerHorizontalTap3(const uint16_t* src,
       s[0] = LoadUnaligned32(src + x + 0);
       s[1] = LoadUnaligned32(src + x + 1);
       s[2] = LoadUnaligned32(src + x + 2);
-      WienerHorizontalTap3Kernel(s, filter, *wiener_buffer + x);
+      WienerHorizontalTap3Kernel<bitdepth>(s, filter, *wiener_buffer + x);
       x += 16;
     } while (x < width);
     src += src_stride;
@@ -179,15 +195,18 @@ inline void WienerHorizontalTap3(const uint16_t* src,
   }
 }
 
+template <int bitdepth>
 inline void WienerHorizontalTap1(const uint16_t* src,
                                  const ptrdiff_t src_stride,
                                  const ptrdiff_t width, const int height,
                                  int16_t** const wiener_buffer) {
+  constexpr int kShift =
+      kWienerFilterBits - WienerRoundBitsHorizontal(bitdepth);
   for (int y = height; y != 0; --y) {
     ptrdiff_t x = 0;
     do {
       const __m256i s0 = LoadUnaligned32(src + x);
-      const __m256i d0 = _mm256_slli_epi16(s0, 4);
+      const __m256i d0 = _mm256_slli_epi16(s0, kShift);
       StoreAligned32(*wiener_buffer + x, d0);
       x += 16;
     } while (x < width);
@@ -196,6 +215,7 @@ inline void WienerHorizontalTap1(const uint16_t* src,
   }
 }
 
+template <int bitdepth>
 inline __m256i WienerVertical7(const __m256i a[4], const __m256i filter[4]) {
   const __m256i madd0 = _mm256_madd_epi16(a[0], filter[0]);
   const __m256i madd1 = _mm256_madd_epi16(a[1], filter[1]);
@@ -204,75 +224,85 @@ inline __m256i WienerVertical7(const __m256i a[4], const __m256i filter[4]) {
   const __m256i madd01 = _mm256_add_epi32(madd0, madd1);
   const __m256i madd23 = _mm256_add_epi32(madd2, madd3);
   const __m256i sum = _mm256_add_epi32(madd01, madd23);
-  return _mm256_srai_epi32(sum, kInterRoundBitsVertical);
+  return _mm256_srai_epi32(sum, WienerRoundBitsVertical(bitdepth));
 }
 
+template <int bitdepth>
 inline __m256i WienerVertical5(const __m256i a[3], const __m256i filter[3]) {
   const __m256i madd0 = _mm256_madd_epi16(a[0], filter[0]);
   const __m256i madd1 = _mm256_madd_epi16(a[1], filter[1]);
   const __m256i madd2 = _mm256_madd_epi16(a[2], filter[2]);
   const __m256i madd01 = _mm256_add_epi32(madd0, madd1);
   const __m256i sum = _mm256_add_epi32(madd01, madd2);
-  return _mm256_srai_epi32(sum, kInterRoundBitsVertical);
+  return _mm256_srai_epi32(sum, WienerRoundBitsVertical(bitdepth));
 }
 
+template <int bitdepth>
 inline __m256i WienerVertical3(const __m256i a[2], const __m256i filter[2]) {
   const __m256i madd0 = _mm256_madd_epi16(a[0], filter[0]);
   const __m256i madd1 = _mm256_madd_epi16(a[1], filter[1]);
   const __m256i sum = _mm256_add_epi32(madd0, madd1);
-  return _mm256_srai_epi32(sum, kInterRoundBitsVertical);
+  return _mm256_srai_epi32(sum, WienerRoundBitsVertical(bitdepth));
 }
 
+template <int bitdepth>
 inline __m256i WienerVerticalClip(const __m256i s[2]) {
   const __m256i d = _mm256_packus_epi32(s[0], s[1]);
-  return _mm256_min_epu16(d, _mm256_set1_epi16(1023));
+  return _mm256_min_epu16(d, _mm256_set1_epi16((1 << bitdepth) - 1));
 }
 
+template <int bitdepth>
 inline __m256i WienerVerticalFilter7(const __m256i a[7],
                                      const __m256i filter[2]) {
-  const __m256i round = _mm256_set1_epi16(1 << (kInterRoundBitsVertical - 1));
+  const __m256i round =
+      _mm256_set1_epi16(1 << (WienerRoundBitsVertical(bitdepth) - 1));
   __m256i b[4], c[2];
   b[0] = _mm256_unpacklo_epi16(a[0], a[1]);
   b[1] = _mm256_unpacklo_epi16(a[2], a[3]);
   b[2] = _mm256_unpacklo_epi16(a[4], a[5]);
   b[3] = _mm256_unpacklo_epi16(a[6], round);
-  c[0] = WienerVertical7(b, filter);
+  c[0] = WienerVertical7<bitdepth>(b, filter);
   b[0] = _mm256_unpackhi_epi16(a[0], a[1]);
   b[1] = _mm256_unpackhi_epi16(a[2], a[3]);
   b[2] = _mm256_unpackhi_epi16(a[4], a[5]);
   b[3] = _mm256_unpackhi_epi16(a[6], round);
-  c[1] = WienerVertical7(b, filter);
-  return WienerVerticalClip(c);
+  c[1] = WienerVertical7<bitdepth>(b, filter);
+  return WienerVerticalClip<bitdepth>(c);
 }
 
+template <int bitdepth>
 inline __m256i WienerVerticalFilter5(const __m256i a[5],
                                      const __m256i filter[3]) {
-  const __m256i round = _mm256_set1_epi16(1 << (kInterRoundBitsVertical - 1));
+  const __m256i round =
+      _mm256_set1_epi16(1 << (WienerRoundBitsVertical(bitdepth) - 1));
   __m256i b[3], c[2];
   b[0] = _mm256_unpacklo_epi16(a[0], a[1]);
   b[1] = _mm256_unpacklo_epi16(a[2], a[3]);
   b[2] = _mm256_unpacklo_epi16(a[4], round);
-  c[0] = WienerVertical5(b, filter);
+  c[0] = WienerVertical5<bitdepth>(b, filter);
   b[0] = _mm256_unpackhi_epi16(a[0], a[1]);
   b[1] = _mm256_unpackhi_epi16(a[2], a[3]);
   b[2] = _mm256_unpackhi_epi16(a[4], round);
-  c[1] = WienerVertical5(b, filter);
-  return WienerVerticalClip(c);
+  c[1] = WienerVertical5<bitdepth>(b, filter);
+  return WienerVerticalClip<bitdepth>(c);
 }
 
+template <int bitdepth>
 inline __m256i WienerVerticalFilter3(const __m256i a[3],
                                      const __m256i filter[2]) {
-  const __m256i round = _mm256_set1_epi16(1 << (kInterRoundBitsVertical - 1));
+  const __m256i round =
+      _mm256_set1_epi16(1 << (WienerRoundBitsVertical(bitdepth) - 1));
   __m256i b[2], c[2];
   b[0] = _mm256_unpacklo_epi16(a[0], a[1]);
   b[1] = _mm256_unpacklo_epi16(a[2], round);
-  c[0] = WienerVertical3(b, filter);
+  c[0] = WienerVertical3<bitdepth>(b, filter);
   b[0] = _mm256_unpackhi_epi16(a[0], a[1]);
   b[1] = _mm256_unpackhi_epi16(a[2], round);
-  c[1] = WienerVertical3(b, filter);
-  return WienerVerticalClip(c);
+  c[1] = WienerVertical3<bitdepth>(b, filter);
+  return WienerVerticalClip<bitdepth>(c);
 }
 
+template <int bitdepth>
 inline __m256i WienerVerticalTap7Kernel(const int16_t* wiener_buffer,
                                         const ptrdiff_t wiener_stride,
                                         const __m256i filter[2], __m256i a[7]) {
@@ -283,9 +313,10 @@ inline __m256i WienerVerticalTap7Kernel(const int16_t* wiener_buffer,
   a[4] = LoadAligned32(wiener_buffer + 4 * wiener_stride);
   a[5] = LoadAligned32(wiener_buffer + 5 * wiener_stride);
   a[6] = LoadAligned32(wiener_buffer + 6 * wiener_stride);
-  return WienerVerticalFilter7(a, filter);
+  return WienerVerticalFilter7<bitdepth>(a, filter);
 }
 
+template <int bitdepth>
 inline __m256i WienerVerticalTap5Kernel(const int16_t* wiener_buffer,
                                         const ptrdiff_t wiener_stride,
                                         const __m256i filter[3], __m256i a[5]) {
@@ -294,45 +325,53 @@ inline __m256i WienerVerticalTap5Kernel(const int16_t* wiener_buffer,
   a[2] = LoadAligned32(wiener_buffer + 2 * wiener_stride);
   a[3] = LoadAligned32(wiener_buffer + 3 * wiener_stride);
   a[4] = LoadAligned32(wiener_buffer + 4 * wiener_stride);
-  return WienerVerticalFilter5(a, filter);
+  return WienerVerticalFilter5<bitdepth>(a, filter);
 }
 
+template <int bitdepth>
 inline __m256i WienerVerticalTap3Kernel(const int16_t* wiener_buffer,
                                         const ptrdiff_t wiener_stride,
                                         const __m256i filter[2], __m256i a[3]) {
   a[0] = LoadAligned32(wiener_buffer + 0 * wiener_stride);
   a[1] = LoadAligned32(wiener_buffer + 1 * wiener_stride);
   a[2] = LoadAligned32(wiener_buffer + 2 * wiener_stride);
-  return WienerVerticalFilter3(a, filter);
+  return WienerVerticalFilter3<bitdepth>(a, filter);
 }
 
+template <int bitdepth>
 inline void WienerVerticalTap7Kernel2(const int16_t* wiener_buffer,
                                       const ptrdiff_t wiener_stride,
                                       const __m256i filter[2], __m256i d[2]) {
   __m256i a[8];
-  d[0] = WienerVerticalTap7Kernel(wiener_buffer, wiener_stride, filter, a);
+  d[0] = WienerVerticalTap7Kernel<bitdepth>(wiener_buffer, wiener_stride,
+                                            filter, a);
   a[7] = LoadAligned32(wiener_buffer + 7 * wiener_stride);
-  d[1] = WienerVerticalFilter7(a + 1, filter);
+  d[1] = WienerVerticalFilter7<bitdepth>(a + 1, filter);
 }
 
+template <int bitdepth>
 inline void WienerVerticalTap5Kernel2(const int16_t* wiener_buffer,
                                       const ptrdiff_t wiener_stride,
                                       const __m256i filter[3], __m256i d[2]) {
   __m256i a[6];
-  d[0] = WienerVerticalTap5Kernel(wiener_buffer, wiener_stride, filter, a);
+  d[0] = WienerVerticalTap5Kernel<bitdepth>(wiener_buffer, wiener_stride,
+                                            filter, a);
   a[5] = LoadAligned32(wiener_buffer + 5 * wiener_stride);
-  d[1] = WienerVerticalFilter5(a + 1, filter);
+  d[1] = WienerVerticalFilter5<bitdepth>(a + 1, filter);
 }
 
+template <int bitdepth>
 inline void WienerVerticalTap3Kernel2(const int16_t* wiener_buffer,
                                       const ptrdiff_t wiener_stride,
                                       const __m256i filter[2], __m256i d[2]) {
   __m256i a[4];
-  d[0] = WienerVerticalTap3Kernel(wiener_buffer, wiener_stride, filter, a);
+  d[0] = WienerVerticalTap3Kernel<bitdepth>(wiener_buffer, wiener_stride,
+                                            filter, a);
   a[3] = LoadAligned32(wiener_buffer + 3 * wiener_stride);
-  d[1] = WienerVerticalFilter3(a + 1, filter);
+  d[1] = WienerVerticalFilter3<bitdepth>(a + 1, filter);
 }
 
+template <int bitdepth>
 inline void WienerVerticalTap7(const int16_t* wiener_buffer,
                                const ptrdiff_t width, const int height,
                                const int16_t coefficients[4], uint16_t* dst,
@@ -348,7 +387,7 @@ inline void WienerVerticalTap7(const int16_t* wiener_buffer,
     ptrdiff_t x = 0;
     do {
       __m256i d[2];
-      WienerVerticalTap7Kernel2(wiener_buffer + x, width, filter, d);
+      WienerVerticalTap7Kernel2<bitdepth>(wiener_buffer + x, width, filter, d);
       StoreUnaligned32(dst + x, d[0]);
       StoreUnaligned32(dst + dst_stride + x, d[1]);
       x += 16;
@@ -361,14 +400,15 @@ inline void WienerVerticalTap7(const int16_t* wiener_buffer,
     ptrdiff_t x = 0;
     do {
       __m256i a[7];
-      const __m256i d =
-          WienerVerticalTap7Kernel(wiener_buffer + x, width, filter, a);
+      const __m256i d = WienerVerticalTap7Kernel<bitdepth>(wiener_buffer + x,
+                                                           width, filter, a);
       StoreUnaligned32(dst + x, d);
       x += 16;
     } while (x < width);
   }
 }
 
+template <int bitdepth>
 inline void WienerVerticalTap5(const int16_t* wiener_buffer,
                                const ptrdiff_t width, const int height,
                                const int16_t coefficients[3], uint16_t* dst,
@@ -383,7 +423,7 @@ inline void WienerVerticalTap5(const int16_t* wiener_buffer,
     ptrdiff_t x = 0;
     do {
       __m256i d[2];
-      WienerVerticalTap5Kernel2(wiener_buffer + x, width, filter, d);
+      WienerVerticalTap5Kernel2<bitdepth>(wiener_buffer + x, width, filter, d);
       StoreUnaligned32(dst + x, d[0]);
       StoreUnaligned32(dst + dst_stride + x, d[1]);
       x += 16;
@@ -396,14 +436,15 @@ inline void WienerVerticalTap5(const int16_t* wiener_buffer,
     ptrdiff_t x = 0;
     do {
       __m256i a[5];
-      const __m256i d =
-          WienerVerticalTap5Kernel(wiener_buffer + x, width, filter, a);
+      const __m256i d = WienerVerticalTap5Kernel<bitdepth>(wiener_buffer + x,
+                                                           width, filter, a);
       StoreUnaligned32(dst + x, d);
       x += 16;
     } while (x < width);
   }
 }
 
+template <int bitdepth>
 inline void WienerVerticalTap3(const int16_t* wiener_buffer,
                                const ptrdiff_t width, const int height,
                                const int16_t coefficients[2], uint16_t* dst,
@@ -417,7 +458,8 @@ inline void WienerVerticalTap3(const int16_t* wiener_buffer,
     ptrdiff_t x = 0;
     do {
       __m256i d[2][2];
-      WienerVerticalTap3Kernel2(wiener_buffer + x, width, filter, d[0]);
+      WienerVerticalTap3Kernel2<bitdepth>(wiener_buffer + x, width, filter,
+                                          d[0]);
       StoreUnaligned32(dst + x, d[0][0]);
       StoreUnaligned32(dst + dst_stride + x, d[0][1]);
       x += 16;
@@ -430,32 +472,37 @@ inline void WienerVerticalTap3(const int16_t* wiener_buffer,
     ptrdiff_t x = 0;
     do {
       __m256i a[3];
-      const __m256i d =
-          WienerVerticalTap3Kernel(wiener_buffer + x, width, filter, a);
+      const __m256i d = WienerVerticalTap3Kernel<bitdepth>(wiener_buffer + x,
+                                                           width, filter, a);
       StoreUnaligned32(dst + x, d);
       x += 16;
     } while (x < width);
   }
 }
 
+template <int bitdepth>
 inline void WienerVerticalTap1Kernel(const int16_t* const wiener_buffer,
                                      uint16_t* const dst) {
   const __m256i a = LoadAligned32(wiener_buffer);
-  const __m256i b = _mm256_add_epi16(a, _mm256_set1_epi16(8));
-  const __m256i c = _mm256_srai_epi16(b, 4);
+  constexpr int kShift = WienerRoundBitsVertical(bitdepth) - kWienerFilterBits;
+  const __m256i b = _mm256_add_epi16(a, _mm256_set1_epi16(1 << (kShift - 1)));
+  const __m256i c = _mm256_srai_epi16(b, kShift);
   const __m256i d = _mm256_max_epi16(c, _mm256_setzero_si256());
-  const __m256i e = _mm256_min_epi16(d, _mm256_set1_epi16(1023));
+  const __m256i e =
+      _mm256_min_epi16(d, _mm256_set1_epi16((1 << bitdepth) - 1));
   StoreUnaligned32(dst, e);
 }
 
+template <int bitdepth>
 inline void WienerVerticalTap1(const int16_t* wiener_buffer,
                                const ptrdiff_t width, const int height,
                                uint16_t* dst, const ptrdiff_t dst_stride) {
   for (int y = height >> 1; y > 0; --y) {
     ptrdiff_t x = 0;
     do {
-      WienerVerticalTap1Kernel(wiener_buffer + x, dst + x);
-      WienerVerticalTap1Kernel(wiener_buffer + width + x, dst + dst_stride + x);
+      WienerVerticalTap1Kernel<bitdepth>(wiener_buffer + x, dst + x);
+      WienerVerticalTap1Kernel<bitdepth>(wiener_buffer + width + x,
+                                         dst + dst_stride + x);
       x += 16;
     } while (x < width);
     dst += 2 * dst_stride;
@@ -465,12 +512,13 @@ inline void WienerVerticalTap1(const int16_t* wiener_buffer,
   if ((height & 1) != 0) {
     ptrdiff_t x = 0;
     do {
-      WienerVerticalTap1Kernel(wiener_buffer + x, dst + x);
+      WienerVerticalTap1Kernel<bitdepth>(wiener_buffer + x, dst + x);
       x += 16;
     } while (x < width);
   }
 }
 
+template <int bitdepth>
 void WienerFilter_AVX2(
     const RestorationUnitInfo& LIBGAV1_RESTRICT restoration_info,
     const void* LIBGAV1_RESTRICT const source, const ptrdiff_t stride,
@@ -504,42 +552,51 @@ void WienerFilter_AVX2(
       LoadLo8(restoration_info.wiener_info.filter[WienerInfo::kHorizontal]);
   const __m256i coefficients_horizontal = _mm256_broadcastq_epi64(c);
   if (number_leading_zero_coefficients[WienerInfo::kHorizontal] == 0) {
-    WienerHorizontalTap7(top + (2 - height_extra) * top_border_stride - 3,
-                         top_border_stride, wiener_stride, height_extra,
-                         &coefficients_horizontal, &wiener_buffer_horizontal);
-    WienerHorizontalTap7(src - 3, stride, wiener_stride, height,
-                         &coefficients_horizontal, &wiener_buffer_horizontal);
-    WienerHorizontalTap7(bottom - 3, bottom_border_stride, wiener_stride,
-                         height_extra, &coefficients_horizontal,
-                         &wiener_buffer_horizontal);
+    WienerHorizontalTap7<bitdepth>(
+        top + (2 - height_extra) * top_border_stride - 3, top_border_stride,
+        wiener_stride, height_extra, &coefficients_horizontal,
+        &wiener_buffer_horizontal);
+    WienerHorizontalTap7<bitdepth>(src - 3, stride, wiener_stride, height,
+                                   &coefficients_horizontal,
+                                   &wiener_buffer_horizontal);
+    WienerHorizontalTap7<bitdepth>(bottom - 3, bottom_border_stride,
+                                   wiener_stride, height_extra,
+                                   &coefficients_horizontal,
+                                   &wiener_buffer_horizontal);
   } else if (number_leading_zero_coefficients[WienerInfo::kHorizontal] == 1) {
-    WienerHorizontalTap5(top + (2 - height_extra) * top_border_stride - 2,
-                         top_border_stride, wiener_stride, height_extra,
-                         &coefficients_horizontal, &wiener_buffer_horizontal);
-    WienerHorizontalTap5(src - 2, stride, wiener_stride, height,
-                         &coefficients_horizontal, &wiener_buffer_horizontal);
-    WienerHorizontalTap5(bottom - 2, bottom_border_stride, wiener_stride,
-                         height_extra, &coefficients_horizontal,
-                         &wiener_buffer_horizontal);
+    WienerHorizontalTap5<bitdepth>(
+        top + (2 - height_extra) * top_border_stride - 2, top_border_stride,
+        wiener_stride, height_extra, &coefficients_horizontal,
+        &wiener_buffer_horizontal);
+    WienerHorizontalTap5<bitdepth>(src - 2, stride, wiener_stride, height,
+                                   &coefficients_horizontal,
+                                   &wiener_buffer_horizontal);
+    WienerHorizontalTap5<bitdepth>(bottom - 2, bottom_border_stride,
+                                   wiener_stride, height_extra,
+                                   &coefficients_horizontal,
+                                   &wiener_buffer_horizontal);
   } else if (number_leading_zero_coefficients[WienerInfo::kHorizontal] == 2) {
     // The maximum over-reads happen here.
-    WienerHorizontalTap3(top + (2 - height_extra) * top_border_stride - 1,
-                         top_border_stride, wiener_stride, height_extra,
-                         &coefficients_horizontal, &wiener_buffer_horizontal);
-    WienerHorizontalTap3(src - 1, stride, wiener_stride, height,
-                         &coefficients_horizontal, &wiener_buffer_horizontal);
-    WienerHorizontalTap3(bottom - 1, bottom_border_stride, wiener_stride,
-                         height_extra, &coefficients_horizontal,
-                         &wiener_buffer_horizontal);
+    WienerHorizontalTap3<bitdepth>(
+        top + (2 - height_extra) * top_border_stride - 1, top_border_stride,
+        wiener_stride, height_extra, &coefficients_horizontal,
+        &wiener_buffer_horizontal);
+    WienerHorizontalTap3<bitdepth>(src - 1, stride, wiener_stride, height,
+                                   &coefficients_horizontal,
+                                   &wiener_buffer_horizontal);
+    WienerHorizontalTap3<bitdepth>(bottom - 1, bottom_border_stride,
+                                   wiener_stride, height_extra,
+                                   &coefficients_horizontal,
+                                   &wiener_buffer_horizontal);
   } else {
     assert(number_leading_zero_coefficients[WienerInfo::kHorizontal] == 3);
-    WienerHorizontalTap1(top + (2 - height_extra) * top_border_stride,
-                         top_border_stride, wiener_stride, height_extra,
-                         &wiener_buffer_horizontal);
-    WienerHorizontalTap1(src, stride, wiener_stride, height,
-                         &wiener_buffer_horizontal);
-    WienerHorizontalTap1(bottom, bottom_border_stride, wiener_stride,
-                         height_extra, &wiener_buffer_horizontal);
+    WienerHorizontalTap1<bitdepth>(top + (2 - height_extra) * top_border_stride,
+                                   top_border_stride, wiener_stride,
+                                   height_extra, &wiener_buffer_horizontal);
+    WienerHorizontalTap1<bitdepth>(src, stride, wiener_stride, height,
+                                   &wiener_buffer_horizontal);
+    WienerHorizontalTap1<bitdepth>(bottom, bottom_border_stride, wiener_stride,
+                                   height_extra, &wiener_buffer_horizontal);
   }
 
   // vertical filtering.
@@ -556,18 +613,20 @@ void WienerFilter_AVX2(
     memcpy(restoration_buffer->wiener_buffer,
            restoration_buffer->wiener_buffer + wiener_stride,
            sizeof(*restoration_buffer->wiener_buffer) * wiener_stride);
-    WienerVerticalTap7(wiener_buffer_vertical, wiener_stride, height,
-                       filter_vertical, dst, stride);
+    WienerVerticalTap7<bitdepth>(wiener_buffer_vertical, wiener_stride, height,
+                                 filter_vertical, dst, stride);
   } else if (number_leading_zero_coefficients[WienerInfo::kVertical] == 1) {
-    WienerVerticalTap5(wiener_buffer_vertical + wiener_stride, wiener_stride,
-                       height, filter_vertical + 1, dst, stride);
+    WienerVerticalTap5<bitdepth>(wiener_buffer_vertical + wiener_stride,
+                                 wiener_stride, height, filter_vertical + 1,
+                                 dst, stride);
   } else if (number_leading_zero_coefficients[WienerInfo::kVertical] == 2) {
-    WienerVerticalTap3(wiener_buffer_vertical + 2 * wiener_stride,
-                       wiener_stride, height, filter_vertical + 2, dst, stride);
+    WienerVerticalTap3<bitdepth>(wiener_buffer_vertical + 2 * wiener_stride,
+                                 wiener_stride, height, filter_vertical + 2,
+                                 dst, stride);
   } else {
     assert(number_leading_zero_coefficients[WienerInfo::kVertical] == 3);
-    WienerVerticalTap1(wiener_buffer_vertical + 3 * wiener_stride,
-                       wiener_stride, height, dst, stride);
+    WienerVerticalTap1<bitdepth>(wiener_buffer_vertical + 3 * wiener_stride,
+                                 wiener_stride, height, dst, stride);
   }
 }
 
@@ -3138,17 +3197,35 @@ void Init10bpp() {
   Dsp* const dsp = dsp_internal::GetWritableDspTable(kBitdepth10);
   assert(dsp != nullptr);
 #if DSP_ENABLED_10BPP_AVX2(WienerFilter)
-  dsp->loop_restorations[0] = WienerFilter_AVX2;
+  dsp->loop_restorations[0] = WienerFilter_AVX2<kBitdepth10>;
 #endif
 #if DSP_ENABLED_10BPP_AVX2(SelfGuidedFilter)
   dsp->loop_restorations[1] = SelfGuidedFilter_AVX2;
 #endif
 }
 
+#if LIBGAV1_MAX_BITDEPTH == 12
+// The 12bpp self-guided filter is left to the sse4.1 version, which widens the
+// 5x5 box sums to 32 bits.
+void Init12bpp() {
+  Dsp* const dsp = dsp_internal::GetWritableDspTable(kBitdepth12);
+  assert(dsp != nullptr);
+#if DSP_ENABLED_12BPP_AVX2(WienerFilter)
+  dsp->loop_restorations[0] = WienerFilter_AVX2<kBitdepth12>;
+#endif
+}
+#endif  // LIBGAV1_MAX_BITDEPTH == 12
+
 }  // namespace
 
 void LoopRestorationInit10bpp_AVX2() { Init10bpp(); }
 
+void LoopRestorationInit12bpp_AVX2() {
+#if LIBGAV1_MAX_BITDEPTH == 12
+  Init12bpp();
+#endif
+}
+
 }  // namespace dsp
 }  // namespace libgav1
 
@@ -3157,6 +3234,7 @@ namespace libgav1 {
 namespace dsp {
 
 void LoopRestorationInit10bpp_AVX2() {}
+void LoopRestorationInit12bpp_AVX2() {}
 
 }  // namespace dsp
 }  // namespace libgav1
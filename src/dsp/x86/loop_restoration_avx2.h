@@ -27,6 +27,7 @@ namespace dsp {
 // These functions are not thread-safe.
 void LoopRestorationInit_AVX2();
 void LoopRestorationInit10bpp_AVX2();
+void LoopRestorationInit12bpp_AVX2();
 
 }  // namespace dsp
 }  // namespace libgav1
@@ -51,6 +52,10 @@ void LoopRestorationInit10bpp_AVX2();
 #define LIBGAV1_Dsp10bpp_SelfGuidedFilter LIBGAV1_CPU_AVX2
 #endif
 
+#ifndef LIBGAV1_Dsp12bpp_WienerFilter
+#define LIBGAV1_Dsp12bpp_WienerFilter LIBGAV1_CPU_AVX2
+#endif
+
 #endif  // LIBGAV1_TARGETING_AVX2
 
 #endif  // LIBGAV1_SRC_DSP_X86_LOOP_RESTORATION_AVX2_H_
@@ -0,0 +1,508 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "src/dsp/loop_restoration.h"
+#include "src/utils/cpu.h"
+
+#if LIBGAV1_TARGETING_AVX512
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "src/dsp/common.h"
+#include "src/dsp/constants.h"
+#include "src/dsp/dsp.h"
+#include "src/dsp/x86/common_avx512.h"
+#include "src/utils/common.h"
+#include "src/utils/constants.h"
+
+namespace libgav1 {
+namespace dsp {
+namespace low_bitdepth {
+namespace {
+
+// This is a 512-bit port of WienerFilter_AVX2(). Each horizontal step filters
+// 64 pixels of a row. As in the avx2 version the 16-bit intermediate values of
+// each step are stored with the 8 pixel groups interleaved: the first 32
+// values hold groups 0, 2, 4, 6 and the next 32 hold groups 1, 3, 5, 7. The
+// vertical pass packs the two halves, which restores the pixel order.
+//
+// The source loads and the destination stores are masked to the |width| of
+// the unit, so unlike the avx2 version there are no over-reads or over-writes.
+
+inline void WienerHorizontalClip(const __m512i s[2], const __m512i s_3x128,
+                                 int16_t* const wiener_buffer) {
+  constexpr int offset =
+      1 << (8 + kWienerFilterBits - kInterRoundBitsHorizontal - 1);
+  constexpr int limit =
+      (1 << (8 + 1 + kWienerFilterBits - kInterRoundBitsHorizontal)) - 1;
+  const __m512i offsets = _mm512_set1_epi16(-offset);
+  const __m512i limits = _mm512_set1_epi16(limit - offset);
+  const __m512i round = _mm512_set1_epi16(1 << (kInterRoundBitsHorizontal - 1));
+  // The sum range here is [-128 * 255, 90 * 255].
+  const __m512i madd = _mm512_add_epi16(s[0], s[1]);
+  const __m512i sum = _mm512_add_epi16(madd, round);
+  const __m512i rounded_sum0 =
+      _mm512_srai_epi16(sum, kInterRoundBitsHorizontal);
+  // Add back scaled down offset correction.
+  const __m512i rounded_sum1 = _mm512_add_epi16(rounded_sum0, s_3x128);
+  const __m512i d0 = _mm512_max_epi16(rounded_sum1, offsets);
+  const __m512i d1 = _mm512_min_epi16(d0, limits);
+  StoreUnaligned64(wiener_buffer, d1);
+}
+
+inline void WienerHorizontalTap7Kernel(const __m512i s[2],
+                                       const __m512i filter[4],
+                                       int16_t* const wiener_buffer) {
+  const auto s01 = _mm512_alignr_epi8(s[1], s[0], 1);
+  const auto s23 = _mm512_alignr_epi8(s[1], s[0], 5);
+  const auto s45 = _mm512_alignr_epi8(s[1], s[0], 9);
+  const auto s67 = _mm512_alignr_epi8(s[1], s[0], 13);
+  __m512i madds[4];
+  madds[0] = _mm512_maddubs_epi16(s01, filter[0]);
+  madds[1] = _mm512_maddubs_epi16(s23, filter[1]);
+  madds[2] = _mm512_maddubs_epi16(s45, filter[2]);
+  madds[3] = _mm512_maddubs_epi16(s67, filter[3]);
+  madds[0] = _mm512_add_epi16(madds[0], madds[2]);
+  madds[1] = _mm512_add_epi16(madds[1], madds[3]);
+  const __m512i s_3x128 = _mm512_slli_epi16(_mm512_srli_epi16(s23, 8),
+                                            7 - kInterRoundBitsHorizontal);
+  WienerHorizontalClip(madds, s_3x128, wiener_buffer);
+}
+
+inline void WienerHorizontalTap5Kernel(const __m512i s[2],
+                                       const __m512i filter[3],
+                                       int16_t* const wiener_buffer) {
+  const auto s01 = _mm512_alignr_epi8(s[1], s[0], 1);
+  const auto s23 = _mm512_alignr_epi8(s[1], s[0], 5);
+  const auto s45 = _mm512_alignr_epi8(s[1], s[0], 9);
+  __m512i madds[3];
+  madds[0] = _mm512_maddubs_epi16(s01, filter[0]);
+  madds[1] = _mm512_maddubs_epi16(s23, filter[1]);
+  madds[2] = _mm512_maddubs_epi16(s45, filter[2]);
+  madds[0] = _mm512_add_epi16(madds[0], madds[2]);
+  const __m512i s_3x128 = _mm512_srli_epi16(_mm512_slli_epi16(s23, 8),
+                                            kInterRoundBitsHorizontal + 1);
+  WienerHorizontalClip(madds, s_3x128, wiener_buffer);
+}
+
+inline void WienerHorizontalTap3Kernel(const __m512i s[2],
+                                       const __m512i filter[2],
+                                       int16_t* const wiener_buffer) {
+  const auto s01 = _mm512_alignr_epi8(s[1], s[0], 1);
+  const auto s23 = _mm512_alignr_epi8(s[1], s[0], 5);
+  __m512i madds[2];
+  madds[0] = _mm512_maddubs_epi16(s01, filter[0]);
+  madds[1] = _mm512_maddubs_epi16(s23, filter[1]);
+  const __m512i s_3x128 = _mm512_slli_epi16(_mm512_srli_epi16(s01, 8),
+                                            7 - kInterRoundBitsHorizontal);
+  WienerHorizontalClip(madds, s_3x128, wiener_buffer);
+}
+
+// Loads the bytes of the row at |src| + |x| which are needed for the |width|
+// outputs. |num_taps| - 1 extra bytes are needed beyond |width|.
+template <int num_taps>
+inline __m512i LoadRow(const uint8_t* const src, const ptrdiff_t x,
+                       const int width) {
+  const int num_bytes = width + num_taps - 1 - static_cast<int>(x);
+  return LoadUnaligned64Masked(src + x,
+                               MaskLowNBytes64(std::max(num_bytes, 0)));
+}
+
+template <int num_taps>
+inline void WienerHorizontalKernel(const __m512i s[2], const __m512i* filter,
+                                   int16_t* const wiener_buffer) {
+  if (num_taps == 7) {
+    WienerHorizontalTap7Kernel(s, filter, wiener_buffer);
+  } else if (num_taps == 5) {
+    WienerHorizontalTap5Kernel(s, filter, wiener_buffer);
+  } else {
+    WienerHorizontalTap3Kernel(s, filter, wiener_buffer);
+  }
+}
+
+template <int num_taps>
+inline void WienerHorizontal(const uint8_t* src, const ptrdiff_t src_stride,
+                             const int width, const ptrdiff_t wiener_stride,
+                             const int height, const __m512i coefficients,
+                             int16_t** const wiener_buffer) {
+  __m512i filter[4];
+  if (num_taps == 7) {
+    filter[0] = _mm512_shuffle_epi8(coefficients, _mm512_set1_epi16(0x0100));
+    filter[1] = _mm512_shuffle_epi8(coefficients, _mm512_set1_epi16(0x0302));
+    filter[2] = _mm512_shuffle_epi8(coefficients, _mm512_set1_epi16(0x0102));
+    filter[3] = _mm512_shuffle_epi8(
+        coefficients, _mm512_set1_epi16(static_cast<int16_t>(0x8000)));
+  } else if (num_taps == 5) {
+    filter[0] = _mm512_shuffle_epi8(coefficients, _mm512_set1_epi16(0x0201));
+    filter[1] = _mm512_shuffle_epi8(coefficients, _mm512_set1_epi16(0x0203));
+    filter[2] = _mm512_shuffle_epi8(
+        coefficients, _mm512_set1_epi16(static_cast<int16_t>(0x8001)));
+  } else {
+    assert(num_taps == 3);
+    filter[0] = _mm512_shuffle_epi8(coefficients, _mm512_set1_epi16(0x0302));
+    filter[1] = _mm512_shuffle_epi8(
+        coefficients, _mm512_set1_epi16(static_cast<int16_t>(0x8002)));
+  }
+  for (int y = height; y != 0; --y) {
+    __m512i s = LoadRow<num_taps>(src, 0, width);
+    __m512i ss[4];
+    ss[0] = _mm512_unpacklo_epi8(s, s);
+    ptrdiff_t x = 0;
+    do {
+      ss[1] = _mm512_unpackhi_epi8(s, s);
+      s = LoadRow<num_taps>(src, x + 64, width);
+      ss[3] = _mm512_unpacklo_epi8(s, s);
+      // Shift the 128-bit lanes of |ss[0]| down by one, filling the top lane
+      // from |ss[3]|.
+      ss[2] = _mm512_alignr_epi64(ss[3], ss[0], 2);
+      WienerHorizontalKernel<num_taps>(ss + 0, filter, *wiener_buffer + x + 0);
+      WienerHorizontalKernel<num_taps>(ss + 1, filter, *wiener_buffer + x + 32);
+      ss[0] = ss[3];
+      x += 64;
+    } while (x < width);
+    src += src_stride;
+    *wiener_buffer += wiener_stride;
+  }
+}
+
+inline void WienerHorizontalTap1(const uint8_t* src, const ptrdiff_t src_stride,
+                                 const int width, const ptrdiff_t wiener_stride,
+                                 const int height,
+                                 int16_t** const wiener_buffer) {
+  for (int y = height; y != 0; --y) {
+    ptrdiff_t x = 0;
+    do {
+      const __m512i s = LoadRow<1>(src, x, width);
+      const __m512i s0 = _mm512_unpacklo_epi8(s, _mm512_setzero_si512());
+      const __m512i s1 = _mm512_unpackhi_epi8(s, _mm512_setzero_si512());
+      StoreUnaligned64(*wiener_buffer + x, _mm512_slli_epi16(s0, 4));
+      StoreUnaligned64(*wiener_buffer + x + 32, _mm512_slli_epi16(s1, 4));
+      x += 64;
+    } while (x < width);
+    src += src_stride;
+    *wiener_buffer += wiener_stride;
+  }
+}
+
+inline __m512i WienerVertical7(const __m512i a[2], const __m512i filter[2]) {
+  const __m512i round = _mm512_set1_epi32(1 << (kInterRoundBitsVertical - 1));
+  const __m512i madd0 = _mm512_madd_epi16(a[0], filter[0]);
+  const __m512i madd1 = _mm512_madd_epi16(a[1], filter[1]);
+  const __m512i sum0 = _mm512_add_epi32(round, madd0);
+  const __m512i sum1 = _mm512_add_epi32(sum0, madd1);
+  return _mm512_srai_epi32(sum1, kInterRoundBitsVertical);
+}
+
+inline __m512i WienerVertical5(const __m512i a[2], const __m512i filter[2]) {
+  const __m512i madd0 = _mm512_madd_epi16(a[0], filter[0]);
+  const __m512i madd1 = _mm512_madd_epi16(a[1], filter[1]);
+  const __m512i sum = _mm512_add_epi32(madd0, madd1);
+  return _mm512_srai_epi32(sum, kInterRoundBitsVertical);
+}
+
+inline __m512i WienerVertical3(const __m512i a, const __m512i filter) {
+  const __m512i round = _mm512_set1_epi32(1 << (kInterRoundBitsVertical - 1));
+  const __m512i madd = _mm512_madd_epi16(a, filter);
+  const __m512i sum = _mm512_add_epi32(round, madd);
+  return _mm512_srai_epi32(sum, kInterRoundBitsVertical);
+}
+
+inline __m512i WienerVerticalFilter7(const __m512i a[7],
+                                     const __m512i filter[2]) {
+  __m512i b[2];
+  const __m512i a06 = _mm512_add_epi16(a[0], a[6]);
+  const __m512i a15 = _mm512_add_epi16(a[1], a[5]);
+  const __m512i a24 = _mm512_add_epi16(a[2], a[4]);
+  b[0] = _mm512_unpacklo_epi16(a06, a15);
+  b[1] = _mm512_unpacklo_epi16(a24, a[3]);
+  const __m512i sum0 = WienerVertical7(b, filter);
+  b[0] = _mm512_unpackhi_epi16(a06, a15);
+  b[1] = _mm512_unpackhi_epi16(a24, a[3]);
+  const __m512i sum1 = WienerVertical7(b, filter);
+  return _mm512_packs_epi32(sum0, sum1);
+}
+
+inline __m512i WienerVerticalFilter5(const __m512i a[5],
+                                     const __m512i filter[2]) {
+  const __m512i round = _mm512_set1_epi16(1 << (kInterRoundBitsVertical - 1));
+  __m512i b[2];
+  const __m512i a04 = _mm512_add_epi16(a[0], a[4]);
+  const __m512i a13 = _mm512_add_epi16(a[1], a[3]);
+  b[0] = _mm512_unpacklo_epi16(a04, a13);
+  b[1] = _mm512_unpacklo_epi16(a[2], round);
+  const __m512i sum0 = WienerVertical5(b, filter);
+  b[0] = _mm512_unpackhi_epi16(a04, a13);
+  b[1] = _mm512_unpackhi_epi16(a[2], round);
+  const __m512i sum1 = WienerVertical5(b, filter);
+  return _mm512_packs_epi32(sum0, sum1);
+}
+
+inline __m512i WienerVerticalFilter3(const __m512i a[3], const __m512i filter) {
+  __m512i b;
+  const __m512i a02 = _mm512_add_epi16(a[0], a[2]);
+  b = _mm512_unpacklo_epi16(a02, a[1]);
+  const __m512i sum0 = WienerVertical3(b, filter);
+  b = _mm512_unpackhi_epi16(a02, a[1]);
+  const __m512i sum1 = WienerVertical3(b, filter);
+  return _mm512_packs_epi32(sum0, sum1);
+}
+
+template <int num_taps>
+inline __m512i WienerVerticalFilter(const __m512i* const a,
+                                    const __m512i filter[2]) {
+  if (num_taps == 7) return WienerVerticalFilter7(a, filter);
+  if (num_taps == 5) return WienerVerticalFilter5(a, filter);
+  return WienerVerticalFilter3(a, filter[0]);
+}
+
+// Filters 32 values of 2 rows.
+template <int num_taps>
+inline void WienerVerticalKernel2(const int16_t* wiener_buffer,
+                                  const ptrdiff_t wiener_stride,
+                                  const __m512i filter[2], __m512i d[2]) {
+  __m512i a[num_taps + 1];
+  for (int i = 0; i <= num_taps; ++i) {
+    a[i] = LoadUnaligned64(wiener_buffer + i * wiener_stride);
+  }
+  d[0] = WienerVerticalFilter<num_taps>(a, filter);
+  d[1] = WienerVerticalFilter<num_taps>(a + 1, filter);
+}
+
+// Filters 32 values of 1 row.
+template <int num_taps>
+inline __m512i WienerVerticalKernel(const int16_t* wiener_buffer,
+                                    const ptrdiff_t wiener_stride,
+                                    const __m512i filter[2]) {
+  __m512i a[num_taps];
+  for (int i = 0; i < num_taps; ++i) {
+    a[i] = LoadUnaligned64(wiener_buffer + i * wiener_stride);
+  }
+  return WienerVerticalFilter<num_taps>(a, filter);
+}
+
+inline void StoreRow(uint8_t* const dst, const ptrdiff_t x, const int width,
+                     const __m512i d) {
+  _mm512_mask_storeu_epi8(dst + x,
+                          MaskLowNBytes64(width - static_cast<int>(x)), d);
+}
+
+// |coefficients| starts with the first non-zero coefficient of the vertical
+// filter.
+template <int num_taps>
+inline void WienerVertical(const int16_t* wiener_buffer, const int width,
+                           const ptrdiff_t wiener_stride, const int height,
+                           const int16_t* const coefficients, uint8_t* dst,
+                           const ptrdiff_t dst_stride) {
+  __m512i filter[2];
+  if (num_taps == 7) {
+    filter[0] = _mm512_broadcastd_epi32(Load4(coefficients));
+    filter[1] = _mm512_broadcastd_epi32(Load4(coefficients + 2));
+  } else if (num_taps == 5) {
+    filter[0] = _mm512_broadcastd_epi32(Load4(coefficients));
+    filter[1] =
+        _mm512_set1_epi32((1 << 16) | static_cast<uint16_t>(coefficients[2]));
+  } else {
+    assert(num_taps == 3);
+    filter[0] = _mm512_broadcastd_epi32(Load4(coefficients));
+  }
+  for (int y = height >> 1; y > 0; --y) {
+    ptrdiff_t x = 0;
+    do {
+      __m512i d[2][2];
+      WienerVerticalKernel2<num_taps>(wiener_buffer + x + 0, wiener_stride,
+                                      filter, d[0]);
+      WienerVerticalKernel2<num_taps>(wiener_buffer + x + 32, wiener_stride,
+                                      filter, d[1]);
+      StoreRow(dst, x, width, _mm512_packus_epi16(d[0][0], d[1][0]));
+      StoreRow(dst + dst_stride, x, width,
+               _mm512_packus_epi16(d[0][1], d[1][1]));
+      x += 64;
+    } while (x < width);
+    dst += 2 * dst_stride;
+    wiener_buffer += 2 * wiener_stride;
+  }
+
+  if ((height & 1) != 0) {
+    ptrdiff_t x = 0;
+    do {
+      const __m512i d0 = WienerVerticalKernel<num_taps>(wiener_buffer + x + 0,
+                                                        wiener_stride, filter);
+      const __m512i d1 = WienerVerticalKernel<num_taps>(wiener_buffer + x + 32,
+                                                        wiener_stride, filter);
+      StoreRow(dst, x, width, _mm512_packus_epi16(d0, d1));
+      x += 64;
+    } while (x < width);
+  }
+}
+
+inline void WienerVerticalTap1Kernel(const int16_t* const wiener_buffer,
+                                     uint8_t* const dst, const ptrdiff_t x,
+                                     const int width) {
+  const __m512i a0 = LoadUnaligned64(wiener_buffer + x + 0);
+  const __m512i a1 = LoadUnaligned64(wiener_buffer + x + 32);
+  const __m512i b0 = _mm512_add_epi16(a0, _mm512_set1_epi16(8));
+  const __m512i b1 = _mm512_add_epi16(a1, _mm512_set1_epi16(8));
+  const __m512i c0 = _mm512_srai_epi16(b0, 4);
+  const __m512i c1 = _mm512_srai_epi16(b1, 4);
+  StoreRow(dst, x, width, _mm512_packus_epi16(c0, c1));
+}
+
+inline void WienerVerticalTap1(const int16_t* wiener_buffer, const int width,
+                               const ptrdiff_t wiener_stride, const int height,
+                               uint8_t* dst, const ptrdiff_t dst_stride) {
+  for (int y = height; y != 0; --y) {
+    ptrdiff_t x = 0;
+    do {
+      WienerVerticalTap1Kernel(wiener_buffer, dst, x, width);
+      x += 64;
+    } while (x < width);
+    dst += dst_stride;
+    wiener_buffer += wiener_stride;
+  }
+}
+
+void WienerFilter_AVX512(
+    const RestorationUnitInfo& LIBGAV1_RESTRICT restoration_info,
+    const void* LIBGAV1_RESTRICT const source, const ptrdiff_t stride,
+    const void* LIBGAV1_RESTRICT const top_border,
+    const ptrdiff_t top_border_stride,
+    const void* LIBGAV1_RESTRICT const bottom_border,
+    const ptrdiff_t bottom_border_stride, const int width, const int height,
+    RestorationBuffer* LIBGAV1_RESTRICT const restoration_buffer,
+    void* LIBGAV1_RESTRICT const dest) {
+  const int16_t* const number_leading_zero_coefficients =
+      restoration_info.wiener_info.number_leading_zero_coefficients;
+  const int number_rows_to_skip = std::max(
+      static_cast<int>(number_leading_zero_coefficients[WienerInfo::kVertical]),
+      1);
+  const ptrdiff_t wiener_stride = Align(width, 64);
+  int16_t* const wiener_buffer_vertical = restoration_buffer->wiener_buffer;
+  // The values are saturated to 13 bits before storing.
+  int16_t* wiener_buffer_horizontal =
+      wiener_buffer_vertical + number_rows_to_skip * wiener_stride;
+
+  // horizontal filtering.
+  const int height_horizontal =
+      height + kWienerFilterTaps - 1 - 2 * number_rows_to_skip;
+  const int height_extra = (height_horizontal - height) >> 1;
+  assert(height_extra <= 2);
+  const auto* const src = static_cast<const uint8_t*>(source);
+  const auto* const top = static_cast<const uint8_t*>(top_border);
+  const auto* const bottom = static_cast<const uint8_t*>(bottom_border);
+  const __m128i c =
+      LoadLo8(restoration_info.wiener_info.filter[WienerInfo::kHorizontal]);
+  // In order to keep the horizontal pass intermediate values within 16 bits we
+  // offset |filter[3]| by 128. The 128 offset will be added back in the loop.
+  __m128i c_horizontal =
+      _mm_sub_epi16(c, _mm_setr_epi16(0, 0, 0, 128, 0, 0, 0, 0));
+  c_horizontal = _mm_packs_epi16(c_horizontal, c_horizontal);
+  const __m512i coefficients_horizontal = _mm512_broadcastd_epi32(c_horizontal);
+  if (number_leading_zero_coefficients[WienerInfo::kHorizontal] == 0) {
+    WienerHorizontal<7>(top + (2 - height_extra) * top_border_stride - 3,
+                        top_border_stride, width, wiener_stride, height_extra,
+                        coefficients_horizontal, &wiener_buffer_horizontal);
+    WienerHorizontal<7>(src - 3, stride, width, wiener_stride, height,
+                        coefficients_horizontal, &wiener_buffer_horizontal);
+    WienerHorizontal<7>(bottom - 3, bottom_border_stride, width, wiener_stride,
+                        height_extra, coefficients_horizontal,
+                        &wiener_buffer_horizontal);
+  } else if (number_leading_zero_coefficients[WienerInfo::kHorizontal] == 1) {
+    WienerHorizontal<5>(top + (2 - height_extra) * top_border_stride - 2,
+                        top_border_stride, width, wiener_stride, height_extra,
+                        coefficients_horizontal, &wiener_buffer_horizontal);
+    WienerHorizontal<5>(src - 2, stride, width, wiener_stride, height,
+                        coefficients_horizontal, &wiener_buffer_horizontal);
+    WienerHorizontal<5>(bottom - 2, bottom_border_stride, width, wiener_stride,
+                        height_extra, coefficients_horizontal,
+                        &wiener_buffer_horizontal);
+  } else if (number_leading_zero_coefficients[WienerInfo::kHorizontal] == 2) {
+    WienerHorizontal<3>(top + (2 - height_extra) * top_border_stride - 1,
+                        top_border_stride, width, wiener_stride, height_extra,
+                        coefficients_horizontal, &wiener_buffer_horizontal);
+    WienerHorizontal<3>(src - 1, stride, width, wiener_stride, height,
+                        coefficients_horizontal, &wiener_buffer_horizontal);
+    WienerHorizontal<3>(bottom - 1, bottom_border_stride, width, wiener_stride,
+                        height_extra, coefficients_horizontal,
+                        &wiener_buffer_horizontal);
+  } else {
+    assert(number_leading_zero_coefficients[WienerInfo::kHorizontal] == 3);
+    WienerHorizontalTap1(top + (2 - height_extra) * top_border_stride,
+                         top_border_stride, width, wiener_stride, height_extra,
+                         &wiener_buffer_horizontal);
+    WienerHorizontalTap1(src, stride, width, wiener_stride, height,
+                         &wiener_buffer_horizontal);
+    WienerHorizontalTap1(bottom, bottom_border_stride, width, wiener_stride,
+                         height_extra, &wiener_buffer_horizontal);
+  }
+
+  // vertical filtering.
+  const int16_t* const filter_vertical =
+      restoration_info.wiener_info.filter[WienerInfo::kVertical];
+  auto* dst = static_cast<uint8_t*>(dest);
+  if (number_leading_zero_coefficients[WienerInfo::kVertical] == 0) {
+    // Because the top row of |source| is a duplicate of the second row, and the
+    // bottom row of |source| is a duplicate of its above row, we can duplicate
+    // the top and bottom row of |wiener_buffer| accordingly.
+    memcpy(wiener_buffer_horizontal, wiener_buffer_horizontal - wiener_stride,
+           sizeof(*wiener_buffer_horizontal) * wiener_stride);
+    memcpy(restoration_buffer->wiener_buffer,
+           restoration_buffer->wiener_buffer + wiener_stride,
+           sizeof(*restoration_buffer->wiener_buffer) * wiener_stride);
+    WienerVertical<7>(wiener_buffer_vertical, width, wiener_stride, height,
+                      filter_vertical, dst, stride);
+  } else if (number_leading_zero_coefficients[WienerInfo::kVertical] == 1) {
+    WienerVertical<5>(wiener_buffer_vertical + wiener_stride, width,
+                      wiener_stride, height, filter_vertical + 1, dst, stride);
+  } else if (number_leading_zero_coefficients[WienerInfo::kVertical] == 2) {
+    WienerVertical<3>(wiener_buffer_vertical + 2 * wiener_stride, width,
+                      wiener_stride, height, filter_vertical + 2, dst, stride);
+  } else {
+    assert(number_leading_zero_coefficients[WienerInfo::kVertical] == 3);
+    WienerVerticalTap1(wiener_buffer_vertical + 3 * wiener_stride, width,
+                       wiener_stride, height, dst, stride);
+  }
+}
+
+void Init8bpp() {
+  Dsp* const dsp = dsp_internal::GetWritableDspTable(kBitdepth8);
+  assert(dsp != nullptr);
+  // loop_restorations[1] (the self-guided filter) is left to the avx2 tier.
+#if DSP_ENABLED_8BPP_AVX512(WienerFilter)
+  dsp->loop_restorations[0] = WienerFilter_AVX512;
+#endif
+}
+
+}  // namespace
+}  // namespace low_bitdepth
+
+void LoopRestorationInit_AVX512() { low_bitdepth::Init8bpp(); }
+
+}  // namespace dsp
+}  // namespace libgav1
+
+#else   // !LIBGAV1_TARGETING_AVX512
+namespace libgav1 {
+namespace dsp {
+
+void LoopRestorationInit_AVX512() {}
+
+}  // namespace dsp
+}  // namespace libgav1
+#endif  // LIBGAV1_TARGETING_AVX512
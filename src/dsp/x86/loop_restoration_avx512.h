@@ -0,0 +1,45 @@
+/*
+ * Copyright 2024 The libgav1 Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGAV1_SRC_DSP_X86_LOOP_RESTORATION_AVX512_H_
+#define LIBGAV1_SRC_DSP_X86_LOOP_RESTORATION_AVX512_H_
+
+#include "src/dsp/dsp.h"
+#include "src/utils/cpu.h"
+
+namespace libgav1 {
+namespace dsp {
+
+// Initializes Dsp::loop_restorations, see the defines below for specifics.
+// Only the 8bpp Wiener filter has an avx512 version. The self-guided filter
+// and the 10bpp and 12bpp tables keep the versions installed by
+// LoopRestorationInit_AVX2() and earlier tiers.
+// This function is not thread-safe.
+void LoopRestorationInit_AVX512();
+
+}  // namespace dsp
+}  // namespace libgav1
+
+// If avx512 is enabled signal the avx512 implementation should be used.
+#if LIBGAV1_TARGETING_AVX512
+
+#ifndef LIBGAV1_Dsp8bpp_WienerFilter
+#define LIBGAV1_Dsp8bpp_WienerFilter LIBGAV1_CPU_AVX512BW
+#endif
+
+#endif  // LIBGAV1_TARGETING_AVX512
+
+#endif  // LIBGAV1_SRC_DSP_X86_LOOP_RESTORATION_AVX512_H_
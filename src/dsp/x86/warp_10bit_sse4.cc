@@ -0,0 +1,436 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/dsp/warp.h"
+#include "src/utils/cpu.h"
+
+#if LIBGAV1_TARGETING_SSE4_1 && LIBGAV1_MAX_BITDEPTH >= 10
+
+#include <smmintrin.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "src/dsp/constants.h"
+#include "src/dsp/dsp.h"
+#include "src/dsp/x86/common_sse4.h"
+#include "src/dsp/x86/transpose_sse4.h"
+#include "src/utils/common.h"
+#include "src/utils/constants.h"
+
+namespace libgav1 {
+namespace dsp {
+namespace {
+
+// Number of extra bits of precision in warped filtering.
+constexpr int kWarpedDiffPrecisionBits = 10;
+
+// Applies the horizontal filter to one source row and stores the result in
+// |intermediate_result_row|. |intermediate_result_row| is a row in the 15x8
+// |intermediate_result| two-dimensional array. |src_row| holds the 16 samples
+// starting at &row[ix4 - 7], the 16th of which is ignored.
+inline void HorizontalFilter(const int sx4, const int16_t alpha,
+                             const __m128i src_row[2],
+                             int16_t intermediate_result_row[8]) {
+  int sx = sx4 - MultiplyBy4(alpha);
+  __m128i filter[8];
+  for (__m128i& f : filter) {
+    const int offset = RightShiftWithRounding(sx, kWarpedDiffPrecisionBits) +
+                       kWarpedPixelPrecisionShifts;
+    f = LoadUnaligned16(kWarpedFilters[offset]);
+    sx += alpha;
+  }
+  // The samples are at most 10 bits so they can be treated as int16_t. Output
+  // x is the dot product of filter[x] and the 8 samples starting at x.
+  __m128i product[8];
+  product[0] = _mm_madd_epi16(src_row[0], filter[0]);
+  product[1] =
+      _mm_madd_epi16(_mm_alignr_epi8(src_row[1], src_row[0], 2), filter[1]);
+  product[2] =
+      _mm_madd_epi16(_mm_alignr_epi8(src_row[1], src_row[0], 4), filter[2]);
+  product[3] =
+      _mm_madd_epi16(_mm_alignr_epi8(src_row[1], src_row[0], 6), filter[3]);
+  product[4] =
+      _mm_madd_epi16(_mm_alignr_epi8(src_row[1], src_row[0], 8), filter[4]);
+  product[5] =
+      _mm_madd_epi16(_mm_alignr_epi8(src_row[1], src_row[0], 10), filter[5]);
+  product[6] =
+      _mm_madd_epi16(_mm_alignr_epi8(src_row[1], src_row[0], 12), filter[6]);
+  product[7] =
+      _mm_madd_epi16(_mm_alignr_epi8(src_row[1], src_row[0], 14), filter[7]);
+  // Reduce the partial sums of each product.
+  const __m128i sum_low =
+      _mm_hadd_epi32(_mm_hadd_epi32(product[0], product[1]),
+                     _mm_hadd_epi32(product[2], product[3]));
+  const __m128i sum_high =
+      _mm_hadd_epi32(_mm_hadd_epi32(product[4], product[5]),
+                     _mm_hadd_epi32(product[6], product[7]));
+  // The range of the rounded sums is within int16_t.
+  const __m128i sum = _mm_packs_epi32(
+      RightShiftWithRounding_S32(sum_low, kInterRoundBitsHorizontal),
+      RightShiftWithRounding_S32(sum_high, kInterRoundBitsHorizontal));
+  StoreUnaligned16(intermediate_result_row, sum);
+}
+
+template <bool is_compound>
+inline void StoreVerticalSums(__m128i sum_low, __m128i sum_high,
+                              uint16_t* LIBGAV1_RESTRICT dst_row) {
+  constexpr int kRoundBitsVertical =
+      is_compound ? kInterRoundBitsCompoundVertical : kInterRoundBitsVertical;
+  sum_low = RightShiftWithRounding_S32(sum_low, kRoundBitsVertical);
+  sum_high = RightShiftWithRounding_S32(sum_high, kRoundBitsVertical);
+  if (is_compound) {
+    // The compound outputs with the offset are within uint16_t.
+    const __m128i offset = _mm_set1_epi32(kCompoundOffset);
+    StoreUnaligned16(dst_row,
+                     _mm_packus_epi32(_mm_add_epi32(sum_low, offset),
+                                      _mm_add_epi32(sum_high, offset)));
+  } else {
+    const __m128i sum = _mm_packus_epi32(sum_low, sum_high);
+    StoreUnaligned16(
+        dst_row, _mm_min_epi16(sum, _mm_set1_epi16((1 << kBitdepth10) - 1)));
+  }
+}
+
+template <bool is_compound>
+inline void WriteVerticalFilter(const __m128i filter[8],
+                                const int16_t intermediate_result[15][8], int y,
+                                uint16_t* LIBGAV1_RESTRICT dst_row) {
+  __m128i sum_low = _mm_setzero_si128();
+  __m128i sum_high = sum_low;
+  for (int k = 0; k < 8; k += 2) {
+    const __m128i filters_low = _mm_unpacklo_epi16(filter[k], filter[k + 1]);
+    const __m128i filters_high = _mm_unpackhi_epi16(filter[k], filter[k + 1]);
+    const __m128i intermediate_0 = LoadUnaligned16(intermediate_result[y + k]);
+    const __m128i intermediate_1 =
+        LoadUnaligned16(intermediate_result[y + k + 1]);
+    const __m128i intermediate_low =
+        _mm_unpacklo_epi16(intermediate_0, intermediate_1);
+    const __m128i intermediate_high =
+        _mm_unpackhi_epi16(intermediate_0, intermediate_1);
+
+    const __m128i product_low = _mm_madd_epi16(filters_low, intermediate_low);
+    const __m128i product_high =
+        _mm_madd_epi16(filters_high, intermediate_high);
+    sum_low = _mm_add_epi32(sum_low, product_low);
+    sum_high = _mm_add_epi32(sum_high, product_high);
+  }
+  StoreVerticalSums<is_compound>(sum_low, sum_high, dst_row);
+}
+
+template <bool is_compound>
+inline void WriteVerticalFilter(const __m128i filter[8],
+                                const int16_t* LIBGAV1_RESTRICT
+                                    intermediate_result_column,
+                                uint16_t* LIBGAV1_RESTRICT dst_row) {
+  __m128i sum_low = _mm_setzero_si128();
+  __m128i sum_high = _mm_setzero_si128();
+  for (int k = 0; k < 8; k += 2) {
+    const __m128i filters_low = _mm_unpacklo_epi16(filter[k], filter[k + 1]);
+    const __m128i filters_high = _mm_unpackhi_epi16(filter[k], filter[k + 1]);
+    // Equivalent to unpacking two vectors made by duplicating int16_t values.
+    const __m128i intermediate =
+        _mm_set1_epi32((intermediate_result_column[k + 1] << 16) |
+                       static_cast<uint16_t>(intermediate_result_column[k]));
+    const __m128i product_low = _mm_madd_epi16(filters_low, intermediate);
+    const __m128i product_high = _mm_madd_epi16(filters_high, intermediate);
+    sum_low = _mm_add_epi32(sum_low, product_low);
+    sum_high = _mm_add_epi32(sum_high, product_high);
+  }
+  StoreVerticalSums<is_compound>(sum_low, sum_high, dst_row);
+}
+
+template <bool is_compound>
+inline void VerticalFilter(const int16_t source[15][8], int64_t y4, int gamma,
+                           int delta, uint16_t* LIBGAV1_RESTRICT dest_row,
+                           ptrdiff_t dest_stride) {
+  int sy4 = (y4 & ((1 << kWarpedModelPrecisionBits) - 1)) - MultiplyBy4(delta);
+  for (int y = 0; y < 8; ++y) {
+    int sy = sy4 - MultiplyBy4(gamma);
+    __m128i filter[8];
+    for (__m128i& f : filter) {
+      const int offset = RightShiftWithRounding(sy, kWarpedDiffPrecisionBits) +
+                         kWarpedPixelPrecisionShifts;
+      f = LoadUnaligned16(kWarpedFilters[offset]);
+      sy += gamma;
+    }
+    Transpose8x8_U16(filter, filter);
+    WriteVerticalFilter<is_compound>(filter, source, y, dest_row);
+    dest_row += dest_stride;
+    sy4 += delta;
+  }
+}
+
+template <bool is_compound>
+inline void VerticalFilter(const int16_t* LIBGAV1_RESTRICT source_cols,
+                           int64_t y4, int gamma, int delta,
+                           uint16_t* LIBGAV1_RESTRICT dest_row,
+                           ptrdiff_t dest_stride) {
+  int sy4 = (y4 & ((1 << kWarpedModelPrecisionBits) - 1)) - MultiplyBy4(delta);
+  for (int y = 0; y < 8; ++y) {
+    int sy = sy4 - MultiplyBy4(gamma);
+    __m128i filter[8];
+    for (__m128i& f : filter) {
+      const int offset = RightShiftWithRounding(sy, kWarpedDiffPrecisionBits) +
+                         kWarpedPixelPrecisionShifts;
+      f = LoadUnaligned16(kWarpedFilters[offset]);
+      sy += gamma;
+    }
+    Transpose8x8_U16(filter, filter);
+    WriteVerticalFilter<is_compound>(filter, &source_cols[y], dest_row);
+    dest_row += dest_stride;
+    sy4 += delta;
+  }
+}
+
+template <bool is_compound>
+inline void WarpRegion1(const uint16_t* LIBGAV1_RESTRICT src,
+                        ptrdiff_t source_stride, int source_width,
+                        int source_height, int ix4, int iy4,
+                        uint16_t* LIBGAV1_RESTRICT dst_row,
+                        ptrdiff_t dest_stride) {
+  // Region 1
+  // Points to the left or right border of the first row of |src|.
+  const uint16_t* first_row_border =
+      (ix4 + 7 <= 0) ? src : src + source_width - 1;
+  // Every sample used to calculate the prediction block has the same
+  // value. So the whole prediction block has the same value.
+  const int row = (iy4 + 7 <= 0) ? 0 : source_height - 1;
+  const uint16_t row_border_pixel = first_row_border[row * source_stride];
+
+  const __m128i value =
+      is_compound
+          ? _mm_set1_epi16(static_cast<int16_t>(
+                (row_border_pixel << (kInterRoundBitsVertical -
+                                      kInterRoundBitsCompoundVertical)) +
+                kCompoundOffset))
+          : _mm_set1_epi16(row_border_pixel);
+  for (int y = 0; y < 8; ++y) {
+    StoreUnaligned16(dst_row, value);
+    dst_row += dest_stride;
+  }
+}
+
+template <bool is_compound>
+inline void WarpRegion2(const uint16_t* LIBGAV1_RESTRICT src,
+                        ptrdiff_t source_stride, int source_width, int64_t y4,
+                        int ix4, int iy4, int gamma, int delta,
+                        int16_t intermediate_result_column[15],
+                        uint16_t* LIBGAV1_RESTRICT dst_row,
+                        ptrdiff_t dest_stride) {
+  // Region 2.
+  // Points to the left or right border of the first row of |src|.
+  const uint16_t* first_row_border =
+      (ix4 + 7 <= 0) ? src : src + source_width - 1;
+
+  // Horizontal filter.
+  // The input values in this region are generated by extending the border
+  // which makes them identical in the horizontal direction.
+  for (int y = -7; y < 8; ++y) {
+    // We may over-read up to 13 pixels above the top source row, or up
+    // to 13 pixels below the bottom source row. This is proved in
+    // warp.cc.
+    const int row = iy4 + y;
+    int sum = first_row_border[row * source_stride];
+    sum <<= (kFilterBits - kInterRoundBitsHorizontal);
+    intermediate_result_column[y + 7] = sum;
+  }
+  // Region 2 vertical filter.
+  VerticalFilter<is_compound>(intermediate_result_column, y4, gamma, delta,
+                              dst_row, dest_stride);
+}
+
+inline void LoadSrcRow(const uint16_t* LIBGAV1_RESTRICT src_row,
+                       __m128i src_row_v[2]) {
+  src_row_v[0] = LoadUnaligned16(src_row);
+  src_row_v[1] = LoadUnaligned16(src_row + 8);
+}
+
+inline void WarpRegion3(const uint16_t* LIBGAV1_RESTRICT src,
+                        ptrdiff_t source_stride, int source_height, int alpha,
+                        int beta, int64_t x4, int ix4, int iy4,
+                        int16_t intermediate_result[15][8]) {
+  // Region 3
+  // At this point, we know ix4 - 7 < source_width - 1 and ix4 + 7 > 0.
+  // Horizontal filter.
+  const int row = (iy4 + 7 <= 0) ? 0 : source_height - 1;
+  const uint16_t* const src_row = src + row * source_stride;
+  // Read 15 samples from &src_row[ix4 - 7]. The 16th sample is also
+  // read but is ignored.
+  //
+  // NOTE: This may read up to 13 pixels before src_row[0] or up to 14
+  // pixels after src_row[source_width - 1]. We assume the source frame
+  // has left and right borders of at least 13 pixels that extend the
+  // frame boundary pixels. We also assume there is at least one extra
+  // padding pixel after the right border of the last source row.
+  __m128i src_row_v[2];
+  LoadSrcRow(&src_row[ix4 - 7], src_row_v);
+  int sx4 = (x4 & ((1 << kWarpedModelPrecisionBits) - 1)) - beta * 7;
+  for (int y = -7; y < 8; ++y) {
+    HorizontalFilter(sx4, alpha, src_row_v, intermediate_result[y + 7]);
+    sx4 += beta;
+  }
+}
+
+inline void WarpRegion4(const uint16_t* LIBGAV1_RESTRICT src,
+                        ptrdiff_t source_stride, int alpha, int beta,
+                        int64_t x4, int ix4, int iy4,
+                        int16_t intermediate_result[15][8]) {
+  // Region 4.
+  // At this point, we know ix4 - 7 < source_width - 1 and ix4 + 7 > 0.
+  // Horizontal filter.
+  int sx4 = (x4 & ((1 << kWarpedModelPrecisionBits) - 1)) - beta * 7;
+  for (int y = -7; y < 8; ++y) {
+    // We may over-read up to 13 pixels above the top source row, or up
+    // to 13 pixels below the bottom source row. This is proved in
+    // warp.cc.
+    const int row = iy4 + y;
+    const uint16_t* const src_row = src + row * source_stride;
+    // Read 15 samples from &src_row[ix4 - 7]. The 16th sample is also
+    // read but is ignored. See the NOTE in WarpRegion3().
+    __m128i src_row_v[2];
+    LoadSrcRow(&src_row[ix4 - 7], src_row_v);
+    HorizontalFilter(sx4, alpha, src_row_v, intermediate_result[y + 7]);
+    sx4 += beta;
+  }
+}
+
+template <bool is_compound>
+inline void HandleWarpBlock(const uint16_t* LIBGAV1_RESTRICT src,
+                            ptrdiff_t source_stride, int source_width,
+                            int source_height,
+                            const int* LIBGAV1_RESTRICT warp_params,
+                            int subsampling_x, int subsampling_y, int src_x,
+                            int src_y, int16_t alpha, int16_t beta,
+                            int16_t gamma, int16_t delta,
+                            uint16_t* LIBGAV1_RESTRICT dst_row,
+                            ptrdiff_t dest_stride) {
+  union {
+    // Intermediate_result is the output of the horizontal filtering and
+    // rounding. The range is within int16_t (see the ranges in warp.cc).
+    int16_t intermediate_result[15][8];  // 15 rows, 8 columns.
+    // In the simple special cases where the samples in each row are all the
+    // same, store one sample per row in a column vector.
+    int16_t intermediate_result_column[15];
+  };
+
+  const WarpFilterParams filter_params = GetWarpFilterParams(
+      src_x, src_y, subsampling_x, subsampling_y, warp_params);
+  // The prediction block is divided into the regions described in warp.cc and
+  // warp_sse4.cc.
+  if (filter_params.ix4 - 7 >= source_width - 1 || filter_params.ix4 + 7 <= 0) {
+    if ((filter_params.iy4 - 7 >= source_height - 1 ||
+         filter_params.iy4 + 7 <= 0)) {
+      // Outside the frame in both directions. One repeated value.
+      WarpRegion1<is_compound>(src, source_stride, source_width,
+                               source_height, filter_params.ix4,
+                               filter_params.iy4, dst_row, dest_stride);
+      return;
+    }
+    // Outside the frame horizontally. Rows repeated.
+    WarpRegion2<is_compound>(src, source_stride, source_width,
+                             filter_params.y4, filter_params.ix4,
+                             filter_params.iy4, gamma, delta,
+                             intermediate_result_column, dst_row, dest_stride);
+    return;
+  }
+
+  if ((filter_params.iy4 - 7 >= source_height - 1 ||
+       filter_params.iy4 + 7 <= 0)) {
+    // Outside the frame vertically.
+    WarpRegion3(src, source_stride, source_height, alpha, beta,
+                filter_params.x4, filter_params.ix4, filter_params.iy4,
+                intermediate_result);
+  } else {
+    // Inside the frame.
+    WarpRegion4(src, source_stride, alpha, beta, filter_params.x4,
+                filter_params.ix4, filter_params.iy4, intermediate_result);
+  }
+  // Region 3 and 4 vertical filter.
+  VerticalFilter<is_compound>(intermediate_result, filter_params.y4, gamma,
+                              delta, dst_row, dest_stride);
+}
+
+template <bool is_compound>
+void Warp_SSE4_1(const void* LIBGAV1_RESTRICT source, ptrdiff_t source_stride,
+                 int source_width, int source_height,
+                 const int* LIBGAV1_RESTRICT warp_params, int subsampling_x,
+                 int subsampling_y, int block_start_x, int block_start_y,
+                 int block_width, int block_height, int16_t alpha, int16_t beta,
+                 int16_t gamma, int16_t delta, void* LIBGAV1_RESTRICT dest,
+                 ptrdiff_t dest_stride) {
+  const auto* const src = static_cast<const uint16_t*>(source);
+  const ptrdiff_t src_stride = source_stride >> 1;
+  // The compound prediction is written to a uint16_t buffer whose stride is
+  // given in elements.
+  auto* dst = static_cast<uint16_t*>(dest);
+  const ptrdiff_t dst_stride = is_compound ? dest_stride : dest_stride >> 1;
+
+  // Warp process applies for each 8x8 block.
+  assert(block_width >= 8);
+  assert(block_height >= 8);
+  const int block_end_x = block_start_x + block_width;
+  const int block_end_y = block_start_y + block_height;
+
+  const int start_x = block_start_x;
+  const int start_y = block_start_y;
+  int src_x = (start_x + 4) << subsampling_x;
+  int src_y = (start_y + 4) << subsampling_y;
+  const int end_x = (block_end_x + 4) << subsampling_x;
+  const int end_y = (block_end_y + 4) << subsampling_y;
+  do {
+    uint16_t* dst_row = dst;
+    src_x = (start_x + 4) << subsampling_x;
+    do {
+      HandleWarpBlock<is_compound>(src, src_stride, source_width,
+                                   source_height, warp_params, subsampling_x,
+                                   subsampling_y, src_x, src_y, alpha, beta,
+                                   gamma, delta, dst_row, dst_stride);
+      src_x += (8 << subsampling_x);
+      dst_row += 8;
+    } while (src_x < end_x);
+    dst += 8 * dst_stride;
+    src_y += (8 << subsampling_y);
+  } while (src_y < end_y);
+}
+
+void Init10bpp() {
+  Dsp* const dsp = dsp_internal::GetWritableDspTable(kBitdepth10);
+  assert(dsp != nullptr);
+  static_cast<void>(dsp);
+#if DSP_ENABLED_10BPP_SSE4_1(Warp)
+  dsp->warp = Warp_SSE4_1</*is_compound=*/false>;
+#endif
+#if DSP_ENABLED_10BPP_SSE4_1(WarpCompound)
+  dsp->warp_compound = Warp_SSE4_1</*is_compound=*/true>;
+#endif
+}
+
+}  // namespace
+
+void WarpInit10bpp_SSE4_1() { Init10bpp(); }
+
+}  // namespace dsp
+}  // namespace libgav1
+#else   // !(LIBGAV1_TARGETING_SSE4_1 && LIBGAV1_MAX_BITDEPTH >= 10)
+namespace libgav1 {
+namespace dsp {
+
+void WarpInit10bpp_SSE4_1() {}
+
+}  // namespace dsp
+}  // namespace libgav1
+#endif  // LIBGAV1_TARGETING_SSE4_1 && LIBGAV1_MAX_BITDEPTH >= 10
@@ -23,8 +23,9 @@
 namespace libgav1 {
 namespace dsp {
 
-// Initializes Dsp::warp. This function is not thread-safe.
+// Initializes Dsp::warp. These functions are not thread-safe.
 void WarpInit_SSE4_1();
+void WarpInit10bpp_SSE4_1();
 
 }  // namespace dsp
 }  // namespace libgav1
@@ -39,6 +40,14 @@ void WarpInit_SSE4_1();
 #define LIBGAV1_Dsp8bpp_WarpCompound LIBGAV1_CPU_SSE4_1
 #endif
 
+#ifndef LIBGAV1_Dsp10bpp_Warp
+#define LIBGAV1_Dsp10bpp_Warp LIBGAV1_CPU_SSE4_1
+#endif
+
+#ifndef LIBGAV1_Dsp10bpp_WarpCompound
+#define LIBGAV1_Dsp10bpp_WarpCompound LIBGAV1_CPU_SSE4_1
+#endif
+
 #endif  // LIBGAV1_TARGETING_SSE4_1
 
 #endif  // LIBGAV1_SRC_DSP_X86_WARP_SSE4_H_
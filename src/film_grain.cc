@@ -19,7 +19,6 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
-#include <new>
 
 #include "src/dsp/common.h"
 #include "src/dsp/constants.h"
@@ -264,7 +263,8 @@ FilmGrain<bitdepth>::FilmGrain(const FilmGrainParams& params,
                                bool is_monochrome,
                                bool color_matrix_is_identity, int subsampling_x,
                                int subsampling_y, int width, int height,
-                               ThreadPool* thread_pool)
+                               ThreadPool* thread_pool,
+                               FilmGrainBuffers<GrainType>* buffers)
     : params_(params),
       is_monochrome_(is_monochrome),
       color_matrix_is_identity_(color_matrix_is_identity),
@@ -276,6 +276,8 @@ FilmGrain<bitdepth>::FilmGrain(const FilmGrainParams& params,
                                               : kMaxChromaWidth),
       template_uv_height_((subsampling_y != 0) ? kMinChromaHeight
                                                : kMaxChromaHeight),
+      buffers_(*buffers),
+      noise_image_(buffers->noise_image),
       thread_pool_(thread_pool) {}
 
 template <int bitdepth>
@@ -346,10 +348,9 @@ bool FilmGrain<bitdepth>::Init() {
       const size_t buffer_size =
           kScalingLutLength * (static_cast<int>(params_.num_u_points > 0) +
                                static_cast<int>(params_.num_v_points > 0));
-      scaling_lut_chroma_buffer_.reset(new (std::nothrow) int16_t[buffer_size]);
-      if (scaling_lut_chroma_buffer_ == nullptr) return false;
+      if (!buffers_.scaling_lut_chroma.Resize(buffer_size)) return false;
 
-      int16_t* buffer = scaling_lut_chroma_buffer_.get();
+      int16_t* buffer = buffers_.scaling_lut_chroma.get();
 #if LIBGAV1_MSAN
       // Quiet film grain / md5 msan warnings.
       memset(buffer, 0, buffer_size * 2);
@@ -451,9 +452,8 @@ bool FilmGrain<bitdepth>::AllocateNoiseStripes() {
                          (kNoiseStripeHeight >> subsampling_y_) *
                          SubsampledValue(width_, subsampling_x_);
   }
-  noise_buffer_.reset(new (std::nothrow) GrainType[noise_buffer_size]);
-  if (noise_buffer_ == nullptr) return false;
-  GrainType* noise_buffer = noise_buffer_.get();
+  if (!buffers_.noise_stripes.Resize(noise_buffer_size)) return false;
+  GrainType* noise_buffer = buffers_.noise_stripes.get();
   if (params_.num_y_points > 0) {
     noise_stripes_[kPlaneY].Reset(max_luma_num, kNoiseStripeHeight * width_,
                                   noise_buffer);
@@ -755,24 +755,27 @@ bool FilmGrain<bitdepth>::AddNoise(
       const int num_workers = thread_pool_->num_threads();
       BlockingCounter pending_workers(num_workers);
       std::atomic<int> job_counter(0);
+      // The scheduled jobs refer to |blend_noise_chroma| so that their
+      // captures fit in a Closure.
+      const auto blend_noise_chroma = [this, &dsp, &planes_to_blend, num_planes,
+                                       &job_counter, min_value, max_chroma,
+                                       source_plane_y, source_stride_y,
+                                       source_plane_u, source_plane_v,
+                                       source_stride_uv, dest_plane_u,
+                                       dest_plane_v, dest_stride_uv]() {
+        BlendNoiseChromaWorker(dsp, planes_to_blend, num_planes, &job_counter,
+                               min_value, max_chroma, source_plane_y,
+                               source_stride_y, source_plane_u, source_plane_v,
+                               source_stride_uv, dest_plane_u, dest_plane_v,
+                               dest_stride_uv);
+      };
       for (int i = 0; i < num_workers; ++i) {
-        thread_pool_->Schedule([this, dsp, &pending_workers, &planes_to_blend,
-                                num_planes, &job_counter, min_value, max_chroma,
-                                source_plane_y, source_stride_y, source_plane_u,
-                                source_plane_v, source_stride_uv, dest_plane_u,
-                                dest_plane_v, dest_stride_uv]() {
-          BlendNoiseChromaWorker(dsp, planes_to_blend, num_planes, &job_counter,
-                                 min_value, max_chroma, source_plane_y,
-                                 source_stride_y, source_plane_u,
-                                 source_plane_v, source_stride_uv, dest_plane_u,
-                                 dest_plane_v, dest_stride_uv);
+        thread_pool_->Schedule([&blend_noise_chroma, &pending_workers]() {
+          blend_noise_chroma();
           pending_workers.Decrement();
         });
       }
-      BlendNoiseChromaWorker(
-          dsp, planes_to_blend, num_planes, &job_counter, min_value, max_chroma,
-          source_plane_y, source_stride_y, source_plane_u, source_plane_v,
-          source_stride_uv, dest_plane_u, dest_plane_v, dest_stride_uv);
+      blend_noise_chroma();
 
       pending_workers.Wait();
     } else {
@@ -798,20 +801,23 @@ bool FilmGrain<bitdepth>::AddNoise(
       const int num_workers = thread_pool_->num_threads();
       BlockingCounter pending_workers(num_workers);
       std::atomic<int> job_counter(0);
+      // The scheduled jobs refer to |blend_noise_luma| so that their captures
+      // fit in a Closure.
+      const auto blend_noise_luma = [this, &dsp, &job_counter, min_value,
+                                     max_luma, source_plane_y, source_stride_y,
+                                     dest_plane_y, dest_stride_y]() {
+        BlendNoiseLumaWorker(dsp, &job_counter, min_value, max_luma,
+                             source_plane_y, source_stride_y, dest_plane_y,
+                             dest_stride_y);
+      };
       for (int i = 0; i < num_workers; ++i) {
-        thread_pool_->Schedule(
-            [this, dsp, &pending_workers, &job_counter, min_value, max_luma,
-             source_plane_y, source_stride_y, dest_plane_y, dest_stride_y]() {
-              BlendNoiseLumaWorker(dsp, &job_counter, min_value, max_luma,
-                                   source_plane_y, source_stride_y,
-                                   dest_plane_y, dest_stride_y);
-              pending_workers.Decrement();
-            });
+        thread_pool_->Schedule([&blend_noise_luma, &pending_workers]() {
+          blend_noise_luma();
+          pending_workers.Decrement();
+        });
       }
 
-      BlendNoiseLumaWorker(dsp, &job_counter, min_value, max_luma,
-                           source_plane_y, source_stride_y, dest_plane_y,
-                           dest_stride_y);
+      blend_noise_luma();
       pending_workers.Wait();
     } else {
       dsp.film_grain.blend_noise_luma(
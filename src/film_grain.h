@@ -29,6 +29,7 @@
 #include "src/utils/array_2d.h"
 #include "src/utils/constants.h"
 #include "src/utils/cpu.h"
+#include "src/utils/dynamic_buffer.h"
 #include "src/utils/threadpool.h"
 #include "src/utils/types.h"
 #include "src/utils/vector.h"
@@ -63,6 +64,20 @@ using FilmGrainSynthesisFunc = bool (*)(
     void* dest_plane_u, ptrdiff_t dest_stride_u, void* dest_plane_v,
     ptrdiff_t dest_stride_v);
 
+// The memory that FilmGrain uses to add noise to a frame. It is owned by the
+// caller so that it can be passed to the FilmGrain of each frame; the buffers
+// only grow, so frames of the same size do not allocate. |GrainType| is int8_t
+// for 8-bit frames and int16_t otherwise.
+template <typename GrainType>
+struct FilmGrainBuffers {
+  // Holds the scaling lookup tables of the U and V planes when they are not
+  // the same as the table of the Y plane.
+  DynamicBuffer<int16_t> scaling_lut_chroma;
+  // Holds the noise stripes of all the planes.
+  DynamicBuffer<GrainType> noise_stripes;
+  Array2D<GrainType> noise_image[kMaxPlanes];
+};
+
 // Section 7.18.3.5. Add noise synthesis process.
 template <int bitdepth>
 class FilmGrain {
@@ -70,9 +85,12 @@ class FilmGrain {
   using GrainType =
       typename std::conditional<bitdepth == 8, int8_t, int16_t>::type;
 
+  // |buffers| is used for all the memory that depends on the frame size and
+  // must not be used by another FilmGrain at the same time.
   FilmGrain(const FilmGrainParams& params, bool is_monochrome,
             bool color_matrix_is_identity, int subsampling_x, int subsampling_y,
-            int width, int height, ThreadPool* thread_pool);
+            int width, int height, ThreadPool* thread_pool,
+            FilmGrainBuffers<GrainType>* buffers);
   ~FilmGrain();
 
   // Note: These static methods are declared public so that the unit tests can
@@ -164,10 +182,8 @@ class FilmGrain {
   int16_t scaling_lut_y_[kScalingLutLength];
   int16_t* scaling_lut_u_ = nullptr;
   int16_t* scaling_lut_v_ = nullptr;
-  // If allocated, this buffer is 256 * 2 values long and scaling_lut_u_ and
-  // scaling_lut_v_ point into this buffer. Otherwise, scaling_lut_u_ and
-  // scaling_lut_v_ point to scaling_lut_y_.
-  std::unique_ptr<int16_t[]> scaling_lut_chroma_buffer_;
+  // scaling_lut_u_ and scaling_lut_v_ either point into
+  // buffers_.scaling_lut_chroma or to scaling_lut_y_.
 
   // A two-dimensional array of noise data for each plane. Generated for each 32
   // luma sample high stripe of the image. The first dimension is called
@@ -185,11 +201,13 @@ class FilmGrain {
   // is an array that has (34 >> subsampling_y_) rows and
   // SubsampledValue(width_, subsampling_x_) columns and contains noise for the
   // chroma components.
+  //
+  // The elements of noise_stripes_ point into buffers_.noise_stripes.
   Array2DView<GrainType> noise_stripes_[kMaxPlanes];
-  // Owns the memory that the elements of noise_stripes_ point to.
-  std::unique_ptr<GrainType[]> noise_buffer_;
 
-  Array2D<GrainType> noise_image_[kMaxPlanes];
+  FilmGrainBuffers<GrainType>& buffers_;
+  // Points to buffers_.noise_image.
+  Array2D<GrainType>* const noise_image_;
   ThreadPool* const thread_pool_;
 };
 
@@ -2605,12 +2605,15 @@ void FilmGrainSpeedTest<bitdepth, Pixel>::TestSpeed(const int num_runs) {
   }
   for (int k = 0; k < kNumFilmGrainTestParams; ++k) {
     const FilmGrainParams& params = kFilmGrainParams[k];
+    // The buffers are reused by all the runs, which must not change the
+    // output.
+    FilmGrainBuffers<typename FilmGrain<bitdepth>::GrainType> buffers;
     const absl::Time start = absl::Now();
     for (int i = 0; i < num_runs; ++i) {
       FilmGrain<bitdepth> film_grain(params, /*is_monochrome=*/false,
                                      /*color_matrix_is_identity=*/false,
                                      subsampling_x_, subsampling_y_, width_,
-                                     height_, thread_pool_.get());
+                                     height_, thread_pool_.get(), &buffers);
       EXPECT_TRUE(film_grain.AddNoise(
           source_plane_y_, y_stride_, source_plane_u_, source_plane_v_,
           uv_stride_, dest_plane_y_, y_stride_, dest_plane_u_, dest_plane_v_,
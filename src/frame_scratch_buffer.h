@@ -18,6 +18,7 @@
 #define LIBGAV1_SRC_FRAME_SCRATCH_BUFFER_H_
 
 #include <array>
+#include <atomic>
 #include <condition_variable>  // NOLINT (unapproved c++11 header)
 #include <cstdint>
 #include <memory>
@@ -25,6 +26,8 @@
 #include <new>
 #include <utility>
 
+#include "src/film_grain.h"
+#include "src/frame_stats_collector.h"
 #include "src/loop_restoration_info.h"
 #include "src/residual_buffer_pool.h"
 #include "src/symbol_decoder_context.h"
@@ -38,19 +41,35 @@
 #include "src/utils/memory.h"
 #include "src/utils/stack.h"
 #include "src/utils/types.h"
+#include "src/utils/vector.h"
 #include "src/yuv_buffer.h"
 
 namespace libgav1 {
 
+class Tile;
+
 // Buffer used to store the unfiltered pixels that are necessary for decoding
 // the next superblock row (for the intra prediction process).
 using IntraPredictionBuffer =
     std::array<AlignedDynamicBuffer<uint8_t, kMaxAlignment>, kMaxPlanes>;
 
+// The buffers of a tile that are kept in the FrameScratchBuffer, so that the
+// tiles of the next frames reuse them instead of allocating their own. See the
+// members of the Tile class with the same names.
+struct TileBuffers {
+  std::array<Array2D<uint8_t>, 2> coefficient_levels;
+  std::array<Array2D<int8_t>, 2> dc_categories;
+  AlignedUniquePtr<uint8_t> residual_buffer;
+  DynamicBuffer<std::unique_ptr<ResidualBuffer>> residual_buffer_threaded;
+  std::unique_ptr<PredictionParameters> prediction_parameters;
+  DynamicBuffer<BlockCdfContext> top_context;
+  // Tile::ThreadingParameters::sb_dependencies points into this buffer.
+  DynamicBuffer<std::atomic<int>> sb_dependencies;
+};
+
 // Buffer to facilitate decoding a frame. This struct is used only within
 // DecoderImpl::DecodeTiles().
-// The alignment requirement is due to the SymbolDecoderContext member
-// symbol_decoder_context and the TileScratchBufferPool member
+// The alignment requirement is due to the TileScratchBufferPool member
 // tile_scratch_buffer_pool.
 struct FrameScratchBuffer : public MaxAlignedAllocable {
   LoopRestorationInfo loop_restoration_info;
@@ -70,7 +89,8 @@ struct FrameScratchBuffer : public MaxAlignedAllocable {
   Array2D<TransformSize> inter_transform_sizes;
   BlockParametersHolder block_parameters_holder;
   TemporalMotionField motion_field;
-  SymbolDecoderContext symbol_decoder_context;
+  // The CDF tables at the start of the frame. The tiles make their own copy.
+  SymbolDecoderContextSnapshot frame_context;
   std::unique_ptr<ResidualBufferPool> residual_buffer_pool;
   // Buffer used to store the cdef borders. This buffer will store 4 rows for
   // every 64x64 block (4 rows for every 32x32 for chroma with subsampling). The
@@ -87,6 +107,20 @@ struct FrameScratchBuffer : public MaxAlignedAllocable {
   // The size of this dynamic buffer is |tile_rows|.
   DynamicBuffer<IntraPredictionBuffer> intra_prediction_buffers;
   TileScratchBufferPool tile_scratch_buffer_pool;
+  // The size of this buffer is at least the number of tiles.
+  // |tile_buffers[i]| is used by the tile whose tile number is i.
+  DynamicBuffer<TileBuffers> tile_buffers;
+  // The memory of the Tile objects of the frame, which are constructed in
+  // place by Tile::Create().
+  AlignedDynamicBuffer<uint8_t, kMaxAlignment> tile_memory;
+  // The Tile objects of the frame. Only used within DecoderImpl::DecodeTiles().
+  Vector<Tile*> tiles;
+  // The memory used to add the film grain noise to the frames that are output
+  // with this FrameScratchBuffer.
+  FilmGrainBuffers<int8_t> film_grain_buffers;
+#if LIBGAV1_MAX_BITDEPTH >= 10
+  FilmGrainBuffers<int16_t> film_grain_buffers_high_bitdepth;
+#endif
   ThreadingStrategy threading_strategy;
   std::mutex superblock_row_mutex;
   // The size of this buffer is the number of superblock rows.
@@ -100,6 +134,22 @@ struct FrameScratchBuffer : public MaxAlignedAllocable {
   DynamicBuffer<std::condition_variable> superblock_row_progress_condvar;
   // Used to signal tile decoding failure in the combined multithreading mode.
   bool tile_decoding_failed LIBGAV1_GUARDED_BY(superblock_row_mutex);
+  // Stall times of the frame in frame parallel mode, in nanoseconds. They are
+  // reset when the frame starts decoding and are reported to the
+  // FrameParallelThreadBalancer when it is done.
+  //  * |reference_wait_time_ns| is the total time that the tiles of the frame
+  //    were blocked waiting for the reference frames to be decoded.
+  //  * |row_wait_time_ns| is the time that the post filter thread was blocked
+  //    waiting for superblock rows to be decoded.
+  std::atomic<int64_t> reference_wait_time_ns{0};
+  int64_t row_wait_time_ns = 0;
+  // Stage timings of the frame. Only collected when the frame_stats_callback
+  // setting is not nullptr.
+  FrameStatsCollector frame_stats;
+  // Used by the multi-threaded post filter to track the filter stages that are
+  // done for each row of 64x64 loop filter units. The size of this buffer is
+  // the number of unit rows plus one.
+  DynamicBuffer<uint16_t> post_filter_task_state;
 };
 
 class FrameScratchBufferPool {
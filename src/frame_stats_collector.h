@@ -0,0 +1,279 @@
+/*
+ * Copyright 2024 The libgav1 Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGAV1_SRC_FRAME_STATS_COLLECTOR_H_
+#define LIBGAV1_SRC_FRAME_STATS_COLLECTOR_H_
+
+#include <time.h>
+
+#include <atomic>
+#include <chrono>  // NOLINT (unapproved c++11 header)
+#include <cstdint>
+#include <limits>
+
+#include "src/gav1/frame_stats.h"
+
+namespace libgav1 {
+
+// Accumulates the time spent in each FrameStage while a frame is decoded.
+// The stages are timed by any number of threads at once, so all the counters
+// are atomic. When the collector is disabled, the timers do not read the
+// clocks and nothing is recorded.
+class FrameStatsCollector {
+ public:
+  // Returns a monotonic timestamp in nanoseconds.
+  static int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  // Returns the CPU time consumed by the calling thread in nanoseconds, or -1
+  // if the platform has no per-thread CPU clock.
+  static int64_t ThreadCpuNow() {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec now;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) return -1;
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+#else
+    return -1;
+#endif
+  }
+
+  // Clears the counters and marks the start of a frame. Must not be called
+  // while any thread is timing a stage of the previous frame.
+  void Reset(bool enabled) {
+    enabled_ = enabled;
+    if (!enabled) return;
+    for (auto& stage : stages_) {
+      stage.thread_time_ns.store(0, std::memory_order_relaxed);
+      stage.cpu_time_ns.store(0, std::memory_order_relaxed);
+      stage.cpu_time_unknown.store(false, std::memory_order_relaxed);
+      stage.first_start_ns.store(std::numeric_limits<int64_t>::max(),
+                                 std::memory_order_relaxed);
+      stage.last_end_ns.store(std::numeric_limits<int64_t>::min(),
+                              std::memory_order_relaxed);
+    }
+    start_ns_ = Now();
+  }
+
+  bool enabled() const { return enabled_; }
+
+  // Records pieces of work of |stage| that ran between |first_start_ns| and
+  // |last_end_ns| and took |thread_time_ns| in total. |cpu_time_ns| is their
+  // thread CPU time, or -1 if it was not measured.
+  void AddStageTime(FrameStage stage, int64_t first_start_ns,
+                    int64_t last_end_ns, int64_t thread_time_ns,
+                    int64_t cpu_time_ns) {
+    Stage& s = stages_[stage];
+    s.thread_time_ns.fetch_add(thread_time_ns, std::memory_order_relaxed);
+    AddCpuTime(&s, cpu_time_ns);
+    int64_t first = s.first_start_ns.load(std::memory_order_relaxed);
+    while (first_start_ns < first &&
+           !s.first_start_ns.compare_exchange_weak(
+               first, first_start_ns, std::memory_order_relaxed)) {
+    }
+    int64_t last = s.last_end_ns.load(std::memory_order_relaxed);
+    while (last_end_ns > last &&
+           !s.last_end_ns.compare_exchange_weak(last, last_end_ns,
+                                                std::memory_order_relaxed)) {
+    }
+  }
+
+  // Adds |duration_ns| to |stage| without a start and end time or a CPU time.
+  // Used for the waiting times that are measured elsewhere.
+  void AddStageDuration(FrameStage stage, int64_t duration_ns) {
+    Stage& s = stages_[stage];
+    s.thread_time_ns.fetch_add(duration_ns, std::memory_order_relaxed);
+    AddCpuTime(&s, -1);
+  }
+
+  // Fills in the |decode_time_ns| and |stages| fields of |stats|. For the
+  // waiting stages, the wall time is the total waiting time of all the
+  // threads, like the thread time.
+  void GetStats(FrameStats* const stats) const {
+    stats->decode_time_ns = Now() - start_ns_;
+    for (int i = 0; i < kNumFrameStages; ++i) {
+      const Stage& s = stages_[i];
+      FrameStageTime& time = stats->stages[i];
+      time.thread_time_ns = s.thread_time_ns.load(std::memory_order_relaxed);
+      time.cpu_time_ns = s.cpu_time_unknown.load(std::memory_order_relaxed)
+                             ? -1
+                             : s.cpu_time_ns.load(std::memory_order_relaxed);
+      const int64_t first = s.first_start_ns.load(std::memory_order_relaxed);
+      const int64_t last = s.last_end_ns.load(std::memory_order_relaxed);
+      if (i == kFrameStageReferenceWait || i == kFrameStageThreadStall) {
+        time.wall_time_ns = time.thread_time_ns;
+      } else {
+        time.wall_time_ns = (last >= first) ? last - first : 0;
+      }
+    }
+  }
+
+ private:
+  struct Stage {
+    std::atomic<int64_t> thread_time_ns{0};
+    std::atomic<int64_t> cpu_time_ns{0};
+    // Set when a piece of work of the stage did not measure its CPU time.
+    std::atomic<bool> cpu_time_unknown{false};
+    std::atomic<int64_t> first_start_ns{0};
+    std::atomic<int64_t> last_end_ns{0};
+  };
+
+  static void AddCpuTime(Stage* const s, int64_t cpu_time_ns) {
+    if (cpu_time_ns < 0) {
+      s->cpu_time_unknown.store(true, std::memory_order_relaxed);
+    } else {
+      s->cpu_time_ns.fetch_add(cpu_time_ns, std::memory_order_relaxed);
+    }
+  }
+
+  bool enabled_ = false;
+  int64_t start_ns_ = 0;
+  Stage stages_[kNumFrameStages];
+};
+
+// Sums up the pieces of work of the stages that one thread runs, without
+// atomic operations, so that fine grained work such as the prediction of each
+// inter block is cheap to time. Flush() adds the sums to a collector in one
+// update per stage.
+class FrameStageAccumulator {
+ public:
+  FrameStageAccumulator() { Clear(); }
+
+  // Records that |stage| ran from |start_ns| to |end_ns|. |cpu_time_ns| is the
+  // thread CPU time of the piece of work, or -1 if it was not measured.
+  void Add(FrameStage stage, int64_t start_ns, int64_t end_ns,
+           int64_t cpu_time_ns) {
+    Stage& s = stages_[stage];
+    s.thread_time_ns += end_ns - start_ns;
+    if (cpu_time_ns < 0 || s.cpu_time_ns < 0) {
+      s.cpu_time_ns = -1;
+    } else {
+      s.cpu_time_ns += cpu_time_ns;
+    }
+    if (start_ns < s.first_start_ns) s.first_start_ns = start_ns;
+    if (end_ns > s.last_end_ns) s.last_end_ns = end_ns;
+    used_stages_ |= 1u << stage;
+  }
+
+  // Adds the pieces of work recorded since the last call to |collector| and
+  // clears them.
+  void Flush(FrameStatsCollector* const collector) {
+    if (used_stages_ == 0) return;
+    for (int i = 0; i < kNumFrameStages; ++i) {
+      if ((used_stages_ & (1u << i)) == 0) continue;
+      const Stage& s = stages_[i];
+      collector->AddStageTime(static_cast<FrameStage>(i), s.first_start_ns,
+                              s.last_end_ns, s.thread_time_ns, s.cpu_time_ns);
+    }
+    Clear();
+  }
+
+ private:
+  struct Stage {
+    int64_t thread_time_ns;
+    int64_t cpu_time_ns;
+    int64_t first_start_ns;
+    int64_t last_end_ns;
+  };
+
+  void Clear() {
+    for (auto& stage : stages_) {
+      stage.thread_time_ns = 0;
+      stage.cpu_time_ns = 0;
+      stage.first_start_ns = std::numeric_limits<int64_t>::max();
+      stage.last_end_ns = std::numeric_limits<int64_t>::min();
+    }
+    used_stages_ = 0;
+  }
+
+  uint32_t used_stages_;
+  Stage stages_[kNumFrameStages];
+};
+
+// Times the enclosing scope as a piece of work of |stage|, with the wall clock
+// and with the thread CPU clock. With an |accumulator|, the piece of work is
+// added to it and then all of the |accumulator| is flushed to |collector|.
+class ScopedFrameStageTimer {
+ public:
+  ScopedFrameStageTimer(FrameStatsCollector* const collector, FrameStage stage,
+                        FrameStageAccumulator* const accumulator = nullptr)
+      : collector_(collector->enabled() ? collector : nullptr),
+        accumulator_(accumulator),
+        stage_(stage),
+        start_ns_((collector_ != nullptr) ? FrameStatsCollector::Now() : 0),
+        start_cpu_ns_((collector_ != nullptr)
+                          ? FrameStatsCollector::ThreadCpuNow()
+                          : 0) {}
+  ~ScopedFrameStageTimer() {
+    if (collector_ == nullptr) return;
+    const int64_t end_cpu_ns = FrameStatsCollector::ThreadCpuNow();
+    const int64_t end_ns = FrameStatsCollector::Now();
+    const int64_t cpu_time_ns =
+        (start_cpu_ns_ < 0 || end_cpu_ns < 0) ? -1 : end_cpu_ns - start_cpu_ns_;
+    if (accumulator_ == nullptr) {
+      collector_->AddStageTime(stage_, start_ns_, end_ns, end_ns - start_ns_,
+                               cpu_time_ns);
+      return;
+    }
+    accumulator_->Add(stage_, start_ns_, end_ns, cpu_time_ns);
+    accumulator_->Flush(collector_);
+  }
+
+  ScopedFrameStageTimer(const ScopedFrameStageTimer&) = delete;
+  ScopedFrameStageTimer& operator=(const ScopedFrameStageTimer&) = delete;
+
+ private:
+  FrameStatsCollector* const collector_;
+  FrameStageAccumulator* const accumulator_;
+  const FrameStage stage_;
+  const int64_t start_ns_;
+  const int64_t start_cpu_ns_;
+};
+
+// Times the enclosing scope as a piece of work of |stage| and adds it to
+// |accumulator|, which must be flushed to |collector| later. Only the wall
+// clock is read, since the CPU clock costs a system call on most platforms and
+// this timer runs for every block. The CPU time of |stage| is then reported as
+// unknown.
+class ScopedBlockStageTimer {
+ public:
+  ScopedBlockStageTimer(const FrameStatsCollector& collector,
+                        FrameStageAccumulator* const accumulator,
+                        FrameStage stage)
+      : accumulator_(collector.enabled() ? accumulator : nullptr),
+        stage_(stage),
+        start_ns_((accumulator_ != nullptr) ? FrameStatsCollector::Now() : 0) {}
+  ~ScopedBlockStageTimer() {
+    if (accumulator_ != nullptr) {
+      accumulator_->Add(stage_, start_ns_, FrameStatsCollector::Now(),
+                        /*cpu_time_ns=*/-1);
+    }
+  }
+
+  ScopedBlockStageTimer(const ScopedBlockStageTimer&) = delete;
+  ScopedBlockStageTimer& operator=(const ScopedBlockStageTimer&) = delete;
+
+ private:
+  FrameStageAccumulator* const accumulator_;
+  const FrameStage stage_;
+  const int64_t start_ns_;
+};
+
+}  // namespace libgav1
+
+#endif  // LIBGAV1_SRC_FRAME_STATS_COLLECTOR_H_
@@ -43,6 +43,9 @@ extern "C" {
 struct Libgav1Decoder;
 typedef struct Libgav1Decoder Libgav1Decoder;
 
+struct Libgav1DecoderCheckpoint;
+typedef struct Libgav1DecoderCheckpoint Libgav1DecoderCheckpoint;
+
 LIBGAV1_PUBLIC Libgav1StatusCode Libgav1DecoderCreate(
     const Libgav1DecoderSettings* settings, Libgav1Decoder** decoder_out);
 
@@ -60,14 +63,48 @@ Libgav1DecoderSignalEOS(Libgav1Decoder* decoder);
 
 LIBGAV1_PUBLIC int Libgav1DecoderGetMaxBitdepth(void);
 
+LIBGAV1_PUBLIC Libgav1StatusCode Libgav1DecoderCheckpointCreate(
+    Libgav1DecoderCheckpoint** checkpoint_out);
+
+LIBGAV1_PUBLIC void Libgav1DecoderCheckpointDestroy(
+    Libgav1DecoderCheckpoint* checkpoint);
+
+LIBGAV1_PUBLIC Libgav1StatusCode Libgav1DecoderSaveCheckpoint(
+    Libgav1Decoder* decoder, Libgav1DecoderCheckpoint* checkpoint);
+
+LIBGAV1_PUBLIC Libgav1StatusCode Libgav1DecoderRestoreCheckpoint(
+    Libgav1Decoder* decoder, const Libgav1DecoderCheckpoint* checkpoint);
+
 #if defined(__cplusplus)
 }  // extern "C"
 
 namespace libgav1 {
 
-// Forward declaration.
+// Forward declarations.
+class DecoderCheckpointImpl;
 class DecoderImpl;
 
+// A snapshot of the decoding state of a Decoder between two temporal units:
+// the reference frames (pixels, saved motion vectors, segmentation maps, CDF
+// tables, loop filter deltas and film grain parameters), the reference frame
+// ids and order hints, and the sequence header. A checkpoint owns copies of
+// the reference frames, so it does not depend on the decoder that saved it.
+class LIBGAV1_PUBLIC DecoderCheckpoint {
+ public:
+  DecoderCheckpoint();
+  ~DecoderCheckpoint();
+
+  // Not copyable or movable.
+  DecoderCheckpoint(const DecoderCheckpoint&) = delete;
+  DecoderCheckpoint& operator=(const DecoderCheckpoint&) = delete;
+
+ private:
+  friend class Decoder;
+
+  // Allocated by the first Decoder::SaveCheckpoint() call.
+  std::unique_ptr<DecoderCheckpointImpl> impl_;
+};
+
 class LIBGAV1_PUBLIC Decoder {
  public:
   Decoder();
@@ -134,6 +171,31 @@ class LIBGAV1_PUBLIC Decoder {
   // and the decoder is ready to start decoding a new coded video sequence.
   StatusCode SignalEOS();
 
+  // Saves the decoding state into |checkpoint|, replacing the state saved in
+  // it before. The reference frames are copied, so the checkpoint remains
+  // valid after this decoder decodes more frames or is destroyed.
+  //
+  // This function returns:
+  //   * kStatusOk on success
+  //   * kStatusTryAgain if there are enqueued frames that have not been
+  //     dequeued yet (the state is only saved between temporal units)
+  //   * an error status otherwise.
+  StatusCode SaveCheckpoint(DecoderCheckpoint* checkpoint);
+
+  // Restores the decoding state saved in |checkpoint|, which may have been
+  // saved by another Decoder. The next call to |EnqueueFrame()| should be the
+  // temporal unit that followed the checkpoint in the stream.
+  //
+  // Like |SignalEOS()|, this function first releases all the frames held by
+  // the decoder and discards the enqueued frames. The reference frames of
+  // |checkpoint| are copied into frame buffers obtained from the
+  // get_frame_buffer callback.
+  //
+  // Returns kStatusOk on success, kStatusInvalidArgument if nothing was saved
+  // in |checkpoint|, and an error status otherwise. On failure, the decoder is
+  // left as if |SignalEOS()| had been called.
+  StatusCode RestoreCheckpoint(const DecoderCheckpoint& checkpoint);
+
   // Returns the maximum bitdepth that is supported by this decoder.
   static int GetMaxBitdepth();
 
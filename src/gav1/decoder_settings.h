@@ -24,6 +24,7 @@
 #endif  // defined(__cplusplus)
 
 #include "gav1/frame_buffer.h"
+#include "gav1/frame_stats.h"
 #include "gav1/symbol_visibility.h"
 
 // All the declarations in this file are part of the public ABI.
@@ -40,6 +41,29 @@ extern "C" {
 typedef void (*Libgav1ReleaseInputBufferCallback)(void* callback_private_data,
                                                   void* buffer_private_data);
 
+// A job that the decoder submits to a caller-owned executor.
+typedef void (*Libgav1JobFunction)(void* job_private_data);
+
+// This callback is invoked by the decoder to run |job| on a caller-owned
+// executor, for example a thread pool that is shared by several decoders. The
+// executor must call |job|(|job_private_data|) exactly once, on one of its own
+// threads. It may do so after this callback has returned, but must not wait
+// for the decoder, and must not run |job| on the thread that calls the
+// decoder's functions.
+//
+// The jobs never block: only the thread that calls the decoder's functions
+// waits for them. A job that runs out of work returns, and the decoder submits
+// a new job once there is more work. So the decoder makes progress on an
+// executor with any number of threads, and it never holds an executor thread
+// while it waits. A job may still run for a while, e.g. to decode a whole
+// tile. Decoders that share an executor that runs jobs in FIFO order take
+// turns between jobs.
+//
+// |executor_private_data| is the value of the executor_private_data setting.
+typedef void (*Libgav1ScheduleJobCallback)(void* executor_private_data,
+                                           Libgav1JobFunction job,
+                                           void* job_private_data);
+
 typedef struct Libgav1DecoderSettings {
   // Number of threads to use when decoding. Must be greater than 0. The library
   // will create at most |threads| new threads. Defaults to 1 (no new threads
@@ -86,6 +110,23 @@ typedef struct Libgav1DecoderSettings {
   // A boolean. If set to 1, the decoder will only parse the bitstream, i.e., no
   // decoding will take place.
   int parse_only;
+  // If not NULL, the decoder will not create any threads. Instead, it will run
+  // its tile, superblock row, post filter and film grain jobs through this
+  // callback. |threads| is then the maximum number of threads (including the
+  // calling thread) that the decoder uses at a time, so at most |threads| - 1
+  // jobs of the decoder are submitted to the executor at once. See
+  // Libgav1ScheduleJobCallback for how the jobs use the executor threads.
+  // Frame parallel decoding is not used with a caller-owned executor, i.e.,
+  // |frame_parallel| is ignored.
+  Libgav1ScheduleJobCallback schedule_job;
+  // Passed as the executor_private_data argument to |schedule_job|.
+  void* executor_private_data;
+  // If not NULL, the decoder times the stages of decoding every frame and
+  // reports them through this callback. When NULL, the stages are not timed.
+  Libgav1FrameStatsCallback frame_stats_callback;
+  // Passed as the frame_stats_private_data argument to
+  // |frame_stats_callback|.
+  void* frame_stats_private_data;
 } Libgav1DecoderSettings;
 
 LIBGAV1_PUBLIC void Libgav1DecoderSettingsInitDefault(
@@ -97,6 +138,8 @@ LIBGAV1_PUBLIC void Libgav1DecoderSettingsInitDefault(
 namespace libgav1 {
 
 using ReleaseInputBufferCallback = Libgav1ReleaseInputBufferCallback;
+using JobFunction = Libgav1JobFunction;
+using ScheduleJobCallback = Libgav1ScheduleJobCallback;
 
 // Applications must populate this structure before creating a decoder instance.
 struct DecoderSettings {
@@ -145,6 +188,24 @@ struct DecoderSettings {
   // If set to true, the decoder will only parse the bitstream, i.e., no
   // decoding will take place.
   bool parse_only = false;
+  // If not nullptr, the decoder will not create any threads. Instead, it will
+  // run its tile, superblock row, post filter and film grain jobs through this
+  // callback. |threads| is then the maximum number of threads (including the
+  // calling thread) that the decoder uses at a time, so at most |threads| - 1
+  // jobs of the decoder are submitted to the executor at once. See
+  // ScheduleJobCallback for how the jobs use the executor threads. Frame
+  // parallel decoding is not used with a caller-owned executor, i.e.,
+  // |frame_parallel| is ignored.
+  ScheduleJobCallback schedule_job = nullptr;
+  // Passed as the executor_private_data argument to |schedule_job|.
+  void* executor_private_data = nullptr;
+  // If not nullptr, the decoder times the stages of decoding every frame and
+  // reports them through this callback. When nullptr, the stages are not
+  // timed.
+  FrameStatsCallback frame_stats_callback = nullptr;
+  // Passed as the frame_stats_private_data argument to
+  // |frame_stats_callback|.
+  void* frame_stats_private_data = nullptr;
 };
 
 }  // namespace libgav1
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2024 The libgav1 Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGAV1_SRC_GAV1_FRAME_STATS_H_
+#define LIBGAV1_SRC_GAV1_FRAME_STATS_H_
+
+#if defined(__cplusplus)
+#include <cstdint>
+#else
+#include <stdint.h>
+#endif  // defined(__cplusplus)
+
+// All the declarations in this file are part of the public ABI.
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// The stages of decoding a frame that are timed when frame statistics are
+// enabled.
+typedef enum Libgav1FrameStage {
+  // Entropy decoding of the tiles. Only reported when the tiles are parsed in
+  // a pass of their own (in frame parallel mode, when the superblocks of a
+  // tile are decoded by other threads than the one that parses them, or with
+  // the parse_only setting). Otherwise parsing is interleaved with
+  // reconstruction and is included in kLibgav1FrameStageReconstruction.
+  kLibgav1FrameStageParse,
+  // Prediction and reconstruction of the blocks.
+  kLibgav1FrameStageReconstruction,
+  // Inter prediction. This is a part of kLibgav1FrameStageReconstruction and
+  // includes kLibgav1FrameStageReferenceWait.
+  kLibgav1FrameStageInterPrediction,
+  kLibgav1FrameStageDeblock,
+  kLibgav1FrameStageCdef,
+  kLibgav1FrameStageSuperRes,
+  kLibgav1FrameStageLoopRestoration,
+  kLibgav1FrameStageFilmGrain,
+  // Time spent waiting for reference frames that are being decoded in
+  // parallel. Only non-zero in frame parallel mode.
+  kLibgav1FrameStageReferenceWait,
+  // Time that decoding threads spent waiting for other threads (for example,
+  // for the superblock rows above, or for the jobs of the previous stage).
+  kLibgav1FrameStageThreadStall,
+  kLibgav1NumFrameStages
+} Libgav1FrameStage;
+
+typedef struct Libgav1FrameStageTime {
+  // The time from the start of the first piece of work of the stage to the
+  // end of the last one. The stages may overlap each other.
+  int64_t wall_time_ns;
+  // The sum of the durations of the pieces of work of the stage over all the
+  // threads. This may be larger than |wall_time_ns| when the stage runs on
+  // several threads. The durations are measured with a monotonic wall clock,
+  // so this is not CPU time: it includes the time that the threads were
+  // blocked or descheduled within the stage.
+  int64_t thread_time_ns;
+  // The sum of the CPU time that the threads consumed in the pieces of work of
+  // the stage, read from the per-thread CPU clock (CLOCK_THREAD_CPUTIME_ID on
+  // POSIX systems). Unlike |thread_time_ns|, this excludes the time that the
+  // threads were blocked or descheduled. -1 if the platform has no per-thread
+  // CPU clock or if a part of the stage was not measured with it:
+  // kLibgav1FrameStageInterPrediction is timed per block, where reading the
+  // CPU clock would cost too much, and the waiting times of the frame parallel
+  // decoder are only known as totals.
+  int64_t cpu_time_ns;
+} Libgav1FrameStageTime;
+
+typedef struct Libgav1FrameStats {
+  // The user_private_data of the temporal unit that contained the frame.
+  int64_t user_private_data;
+  int width;
+  int height;
+  // The frame_type syntax element: 0 for key frames, 1 for inter frames, 2 for
+  // intra only frames and 3 for switch frames.
+  int frame_type;
+  // A boolean. Whether the frame is shown.
+  int show_frame;
+  // The time from the start to the end of decoding the frame, including any
+  // waiting.
+  int64_t decode_time_ns;
+  Libgav1FrameStageTime stages[kLibgav1NumFrameStages];
+} Libgav1FrameStats;
+
+// This callback is invoked by the decoder once for every frame that it
+// decodes, after the frame has been fully decoded. It is not invoked for
+// frames that are shown with show_existing_frame, since those are not decoded
+// again. In frame parallel mode, it may be invoked from several decoder
+// threads at the same time. |stats| is only valid during the call.
+//
+// |frame_stats_private_data| is the value of the frame_stats_private_data
+// setting.
+typedef void (*Libgav1FrameStatsCallback)(void* frame_stats_private_data,
+                                          const Libgav1FrameStats* stats);
+
+#if defined(__cplusplus)
+}  // extern "C"
+
+namespace libgav1 {
+
+using FrameStage = Libgav1FrameStage;
+constexpr FrameStage kFrameStageParse = kLibgav1FrameStageParse;
+constexpr FrameStage kFrameStageReconstruction =
+    kLibgav1FrameStageReconstruction;
+constexpr FrameStage kFrameStageInterPrediction =
+    kLibgav1FrameStageInterPrediction;
+constexpr FrameStage kFrameStageDeblock = kLibgav1FrameStageDeblock;
+constexpr FrameStage kFrameStageCdef = kLibgav1FrameStageCdef;
+constexpr FrameStage kFrameStageSuperRes = kLibgav1FrameStageSuperRes;
+constexpr FrameStage kFrameStageLoopRestoration =
+    kLibgav1FrameStageLoopRestoration;
+constexpr FrameStage kFrameStageFilmGrain = kLibgav1FrameStageFilmGrain;
+constexpr FrameStage kFrameStageReferenceWait =
+    kLibgav1FrameStageReferenceWait;
+constexpr FrameStage kFrameStageThreadStall = kLibgav1FrameStageThreadStall;
+constexpr int kNumFrameStages = kLibgav1NumFrameStages;
+
+using FrameStageTime = Libgav1FrameStageTime;
+using FrameStats = Libgav1FrameStats;
+using FrameStatsCallback = Libgav1FrameStatsCallback;
+
+}  // namespace libgav1
+#endif  // defined(__cplusplus)
+
+#endif  // LIBGAV1_SRC_GAV1_FRAME_STATS_H_
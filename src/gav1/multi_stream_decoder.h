@@ -0,0 +1,140 @@
+/*
+ * Copyright 2024 The libgav1 Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGAV1_SRC_GAV1_MULTI_STREAM_DECODER_H_
+#define LIBGAV1_SRC_GAV1_MULTI_STREAM_DECODER_H_
+
+#if defined(__cplusplus)
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#else
+#include <stddef.h>
+#include <stdint.h>
+#endif  // defined(__cplusplus)
+
+// IWYU pragma: begin_exports
+#include "gav1/decoder_buffer.h"
+#include "gav1/decoder_settings.h"
+#include "gav1/status_code.h"
+#include "gav1/symbol_visibility.h"
+// IWYU pragma: end_exports
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+struct Libgav1MultiStreamDecoder;
+typedef struct Libgav1MultiStreamDecoder Libgav1MultiStreamDecoder;
+
+LIBGAV1_PUBLIC Libgav1StatusCode Libgav1MultiStreamDecoderCreate(
+    int threads, Libgav1MultiStreamDecoder** decoder_out);
+
+LIBGAV1_PUBLIC void Libgav1MultiStreamDecoderDestroy(
+    Libgav1MultiStreamDecoder* decoder);
+
+LIBGAV1_PUBLIC Libgav1StatusCode Libgav1MultiStreamDecoderAddStream(
+    Libgav1MultiStreamDecoder* decoder, const Libgav1DecoderSettings* settings,
+    int* stream_id_out);
+
+LIBGAV1_PUBLIC Libgav1StatusCode Libgav1MultiStreamDecoderRemoveStream(
+    Libgav1MultiStreamDecoder* decoder, int stream_id);
+
+LIBGAV1_PUBLIC Libgav1StatusCode Libgav1MultiStreamDecoderEnqueueFrame(
+    Libgav1MultiStreamDecoder* decoder, int stream_id, const uint8_t* data,
+    size_t size, int64_t user_private_data, void* buffer_private_data);
+
+LIBGAV1_PUBLIC Libgav1StatusCode Libgav1MultiStreamDecoderDequeueFrame(
+    Libgav1MultiStreamDecoder* decoder, int stream_id,
+    const Libgav1DecoderBuffer** out_ptr);
+
+LIBGAV1_PUBLIC Libgav1StatusCode Libgav1MultiStreamDecoderSignalEOS(
+    Libgav1MultiStreamDecoder* decoder, int stream_id);
+
+#if defined(__cplusplus)
+}  // extern "C"
+
+namespace libgav1 {
+
+// Forward declaration.
+class MultiStreamDecoderImpl;
+
+// Decodes many independent streams on one set of worker threads. This is
+// intended for applications that decode a large number of small streams (for
+// example, thumbnails or video conferencing tiles) where giving each stream a
+// Decoder with its own threads would oversubscribe the machine.
+//
+// The temporal units of all the streams are decoded in the background by the
+// worker threads, interleaved across the streams. By default each temporal
+// unit is decoded on a single worker thread, so parallelism comes from
+// decoding several streams at once. A stream with a |threads| setting larger
+// than 1 also spreads the decoding of each frame over the worker threads. The
+// read-only tables and the per-frame scratch buffers are shared by all the
+// streams, so the memory used by a stream is mostly its frame buffers.
+//
+// The methods that take a |stream_id| may be called concurrently for
+// different streams. Calls for the same stream must not be concurrent.
+class LIBGAV1_PUBLIC MultiStreamDecoder {
+ public:
+  MultiStreamDecoder();
+  ~MultiStreamDecoder();
+
+  // Init must be called exactly once per instance. Subsequent calls will do
+  // nothing. |threads| is the number of worker threads and must be positive.
+  // Returns kStatusOk on success, an error status otherwise.
+  StatusCode Init(int threads);
+
+  // Adds a stream and sets |*stream_id| to its identifier. If |settings| is
+  // nullptr, the stream will be decoded with default settings. The |threads|
+  // field of |settings| is the number of worker threads that decode a frame
+  // of the stream, and is capped at the number of worker threads. The
+  // |frame_parallel|, |schedule_job| and |executor_private_data| fields are
+  // ignored; the other fields have the same meaning as in Decoder. The
+  // identifier of a removed stream may be reused.
+  StatusCode AddStream(const DecoderSettings* settings, int* stream_id);
+
+  // Removes the stream. All the frames held for the stream are released. The
+  // |release_input_buffer| callback is called for the compressed frames that
+  // were not decoded.
+  StatusCode RemoveStream(int stream_id);
+
+  // Enqueues a compressed frame of the stream. The frame is decoded in the
+  // background. Returns kStatusTryAgain if the stream already has the maximum
+  // number of frames that are waiting to be decoded or dequeued. The lifetime
+  // requirements on |data| are the same as for Decoder::EnqueueFrame().
+  StatusCode EnqueueFrame(int stream_id, const uint8_t* data, size_t size,
+                          int64_t user_private_data, void* buffer_private_data);
+
+  // Dequeues a decompressed frame of the stream. The frames are returned in
+  // the order in which they were enqueued, with the same semantics as
+  // Decoder::DequeueFrame(). If the next frame has not been decoded yet, this
+  // call blocks when the |blocking_dequeue| setting of the stream is true and
+  // returns kStatusTryAgain otherwise.
+  StatusCode DequeueFrame(int stream_id, const DecoderBuffer** out_ptr);
+
+  // Signals the end of the stream. All the frames held for the stream are
+  // released and the stream is ready to decode a new coded video sequence.
+  StatusCode SignalEOS(int stream_id);
+
+ private:
+  // The object is initialized if and only if impl_ != nullptr.
+  std::unique_ptr<MultiStreamDecoderImpl> impl_;
+};
+
+}  // namespace libgav1
+#endif  // defined(__cplusplus)
+
+#endif  // LIBGAV1_SRC_GAV1_MULTI_STREAM_DECODER_H_
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2024 The libgav1 Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGAV1_SRC_GAV1_STREAM_SCANNER_H_
+#define LIBGAV1_SRC_GAV1_STREAM_SCANNER_H_
+
+#if defined(__cplusplus)
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#else
+#include <stddef.h>
+#include <stdint.h>
+#endif  // defined(__cplusplus)
+
+// IWYU pragma: begin_exports
+#include "gav1/status_code.h"
+#include "gav1/symbol_visibility.h"
+// IWYU pragma: end_exports
+
+// All the declarations in this file are part of the public ABI.
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// The headers of a frame in a temporal unit.
+typedef struct Libgav1ScannedFrame {
+  // The OBUs of the frame are the |size| bytes at |offset| in the temporal
+  // unit. They include the OBUs that precede the frame header (for example,
+  // the temporal delimiter and the sequence header).
+  size_t offset;
+  size_t size;
+  int temporal_id;
+  int spatial_id;
+  // The frame_type syntax element: 0 for key frames, 1 for inter frames, 2 for
+  // intra only frames and 3 for switch frames. If |show_existing_frame| is
+  // true, this is the type of the frame that is shown.
+  int frame_type;
+  // Booleans. These are the syntax elements, so |show_frame| is 0 if
+  // |show_existing_frame| is 1.
+  int show_frame;
+  int show_existing_frame;
+  int showable_frame;
+  // The reference frame slot of the frame that is shown. Only valid if
+  // |show_existing_frame| is true.
+  int frame_to_show;
+  // The upscaled frame size, which is the size of the decoded frame.
+  int width;
+  int height;
+  int render_width;
+  int render_height;
+  // The reference frame slots that are updated with the frame, as a bitmask.
+  // If |show_existing_frame| is true, the slots updated by showing a key
+  // frame.
+  int refresh_frame_flags;
+  // The OrderHint variable in the spec. Only meaningful if the sequence
+  // enables order hints.
+  int order_hint;
+} Libgav1ScannedFrame;
+
+typedef struct Libgav1ScannedTemporalUnit {
+  // A boolean. Whether the temporal unit contains a sequence header OBU.
+  int has_sequence_header;
+  // A boolean. Whether decoding may start at the temporal unit: it contains a
+  // sequence header OBU and its first frame is a shown key frame.
+  int is_random_access_point;
+  // The frames of the temporal unit that are in the operating point, in
+  // bitstream order. Valid until the next call to the scanner.
+  const Libgav1ScannedFrame* frames;
+  int num_frames;
+} Libgav1ScannedTemporalUnit;
+
+struct Libgav1StreamScanner;
+typedef struct Libgav1StreamScanner Libgav1StreamScanner;
+
+LIBGAV1_PUBLIC Libgav1StatusCode Libgav1StreamScannerCreate(
+    int operating_point, Libgav1StreamScanner** scanner_out);
+
+LIBGAV1_PUBLIC void Libgav1StreamScannerDestroy(Libgav1StreamScanner* scanner);
+
+LIBGAV1_PUBLIC Libgav1StatusCode Libgav1StreamScannerScanTemporalUnit(
+    Libgav1StreamScanner* scanner, const uint8_t* data, size_t size,
+    Libgav1ScannedTemporalUnit* temporal_unit);
+
+LIBGAV1_PUBLIC void Libgav1StreamScannerReset(Libgav1StreamScanner* scanner);
+
+#if defined(__cplusplus)
+}  // extern "C"
+
+namespace libgav1 {
+
+using ScannedFrame = Libgav1ScannedFrame;
+using ScannedTemporalUnit = Libgav1ScannedTemporalUnit;
+
+// Forward declaration.
+class StreamScannerImpl;
+
+// Walks the sequence and frame headers of a stream without decoding it, for
+// example to build a seek index. The tile group payloads are skipped using
+// their obu_size and no frame buffers are allocated, so scanning is mostly
+// bound by reading the input.
+//
+// The scanner tracks the reference frame state across the temporal units,
+// which is needed to parse the frame headers. So the temporal units must be
+// scanned in order, from the start of the stream or from a random access
+// point after Reset().
+class LIBGAV1_PUBLIC StreamScanner {
+ public:
+  StreamScanner();
+  ~StreamScanner();
+
+  // Init must be called exactly once per instance. Subsequent calls will do
+  // nothing. |operating_point| has the same meaning as in DecoderSettings.
+  // Returns kStatusOk on success, an error status otherwise.
+  StatusCode Init(int operating_point);
+
+  // Scans the temporal unit of |size| bytes at |data| and fills in
+  // |temporal_unit|. |data| only needs to be valid during the call. Returns
+  // kStatusOk on success, an error status otherwise. After an error, Reset()
+  // must be called before scanning more temporal units.
+  StatusCode ScanTemporalUnit(const uint8_t* data, size_t size,
+                              ScannedTemporalUnit* temporal_unit);
+
+  // Forgets the reference frames and the sequence header, so that a new
+  // stream can be scanned.
+  void Reset();
+
+ private:
+  // The object is initialized if and only if impl_ != nullptr.
+  std::unique_ptr<StreamScannerImpl> impl_;
+};
+
+}  // namespace libgav1
+#endif  // defined(__cplusplus)
+
+#endif  // LIBGAV1_SRC_GAV1_STREAM_SCANNER_H_
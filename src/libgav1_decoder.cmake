@@ -30,6 +30,7 @@ list(APPEND libgav1_decoder_sources
             "${libgav1_source}/frame_buffer.cc"
             "${libgav1_source}/frame_buffer_utils.h"
             "${libgav1_source}/frame_scratch_buffer.h"
+            "${libgav1_source}/frame_stats_collector.h"
             "${libgav1_source}/inter_intra_masks.inc"
             "${libgav1_source}/internal_frame_buffer_list.cc"
             "${libgav1_source}/internal_frame_buffer_list.h"
@@ -37,6 +38,8 @@ list(APPEND libgav1_decoder_sources
             "${libgav1_source}/loop_restoration_info.h"
             "${libgav1_source}/motion_vector.cc"
             "${libgav1_source}/motion_vector.h"
+            "${libgav1_source}/multi_stream_decoder_impl.cc"
+            "${libgav1_source}/multi_stream_decoder_impl.h"
             "${libgav1_source}/obu_parser.cc"
             "${libgav1_source}/obu_parser.h"
             "${libgav1_source}/post_filter/cdef.cc"
@@ -56,6 +59,8 @@ list(APPEND libgav1_decoder_sources
             "${libgav1_source}/residual_buffer_pool.cc"
             "${libgav1_source}/residual_buffer_pool.h"
             "${libgav1_source}/scan_tables.inc"
+            "${libgav1_source}/stream_scanner_impl.cc"
+            "${libgav1_source}/stream_scanner_impl.h"
             "${libgav1_source}/symbol_decoder_context.cc"
             "${libgav1_source}/symbol_decoder_context.h"
             "${libgav1_source}/symbol_decoder_context_cdfs.inc"
@@ -77,13 +82,18 @@ list(APPEND libgav1_api_includes "${libgav1_source}/gav1/decoder.h"
             "${libgav1_source}/gav1/decoder_buffer.h"
             "${libgav1_source}/gav1/decoder_settings.h"
             "${libgav1_source}/gav1/frame_buffer.h"
+            "${libgav1_source}/gav1/frame_stats.h"
+            "${libgav1_source}/gav1/multi_stream_decoder.h"
             "${libgav1_source}/gav1/status_code.h"
+            "${libgav1_source}/gav1/stream_scanner.h"
             "${libgav1_source}/gav1/symbol_visibility.h"
             "${libgav1_source}/gav1/version.h")
 
 list(APPEND libgav1_api_sources "${libgav1_source}/decoder.cc"
             "${libgav1_source}/decoder_settings.cc"
+            "${libgav1_source}/multi_stream_decoder.cc"
             "${libgav1_source}/status_code.cc"
+            "${libgav1_source}/stream_scanner.cc"
             "${libgav1_source}/version.cc"
             ${libgav1_api_includes})
 
@@ -937,6 +937,18 @@ void SetupMotionField(
   const int x8_start = DivideBy2(column4x4_start);
   const int x8_end =
       DivideBy2(std::min(column4x4_end, frame_header.columns4x4));
+  assert((y8_start & 7) == 0);
+  // For each motion vector, only mv[0] needs to be initialized to
+  // kInvalidMvValue, mv[1] is not necessary to be initialized and can be
+  // set to an arbitrary value. For simplicity, mv[1] is set to 0.
+  MotionVector invalid_mv;
+  invalid_mv.mv[0] = kInvalidMvValue;
+  invalid_mv.mv[1] = 0;
+  for (int y8 = y8_start; y8 < y8_end; ++y8) {
+    MotionVector* const motion_field_mv = motion_field->mv[y8];
+    std::fill(motion_field_mv + x8_start, motion_field_mv + x8_end,
+              invalid_mv);
+  }
   const int last_index = frame_header.reference_frame_index[0];
   const ReferenceInfo& reference_info = *current_frame.reference_info();
   if (!IsIntraFrame(reference_frames[last_index]->frame_type())) {
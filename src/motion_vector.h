@@ -48,7 +48,9 @@ void FindWarpSamples(const Tile::Block& block, int* num_warp_samples,
                      int candidates[kMaxLeastSquaresSamples][4]);  // 7.10.4.
 
 // Section 7.9.1 in the spec. But this is done per tile instead of for the whole
-// frame.
+// frame, and may be done for a range of rows of the tile at a time.
+// |row4x4_start| must be a multiple of 16 (64 rows). The motion vectors in the
+// range are initialized to kInvalidMvValue before the projection.
 void SetupMotionField(
     const ObuFrameHeader& frame_header, const RefCountedBuffer& current_frame,
     const std::array<RefCountedBufferPtr, kNumReferenceFrameTypes>&
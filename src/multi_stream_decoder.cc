@@ -0,0 +1,138 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/gav1/multi_stream_decoder.h"
+
+#include <memory>
+#include <new>
+
+#include "src/multi_stream_decoder_impl.h"
+
+extern "C" {
+
+Libgav1StatusCode Libgav1MultiStreamDecoderCreate(
+    int threads, Libgav1MultiStreamDecoder** decoder_out) {
+  std::unique_ptr<libgav1::MultiStreamDecoder> cxx_decoder(
+      new (std::nothrow) libgav1::MultiStreamDecoder());
+  if (cxx_decoder == nullptr) return kLibgav1StatusOutOfMemory;
+
+  const Libgav1StatusCode status = cxx_decoder->Init(threads);
+  if (status == kLibgav1StatusOk) {
+    *decoder_out =
+        reinterpret_cast<Libgav1MultiStreamDecoder*>(cxx_decoder.release());
+  }
+  return status;
+}
+
+void Libgav1MultiStreamDecoderDestroy(Libgav1MultiStreamDecoder* decoder) {
+  auto* cxx_decoder = reinterpret_cast<libgav1::MultiStreamDecoder*>(decoder);
+  delete cxx_decoder;
+}
+
+Libgav1StatusCode Libgav1MultiStreamDecoderAddStream(
+    Libgav1MultiStreamDecoder* decoder, const Libgav1DecoderSettings* settings,
+    int* stream_id_out) {
+  auto* cxx_decoder = reinterpret_cast<libgav1::MultiStreamDecoder*>(decoder);
+  libgav1::DecoderSettings cxx_settings;
+  cxx_settings.blocking_dequeue = settings->blocking_dequeue != 0;
+  cxx_settings.on_frame_buffer_size_changed =
+      settings->on_frame_buffer_size_changed;
+  cxx_settings.get_frame_buffer = settings->get_frame_buffer;
+  cxx_settings.release_frame_buffer = settings->release_frame_buffer;
+  cxx_settings.release_input_buffer = settings->release_input_buffer;
+  cxx_settings.callback_private_data = settings->callback_private_data;
+  cxx_settings.output_all_layers = settings->output_all_layers != 0;
+  cxx_settings.operating_point = settings->operating_point;
+  cxx_settings.post_filter_mask = settings->post_filter_mask;
+  cxx_settings.parse_only = settings->parse_only != 0;
+  cxx_settings.frame_stats_callback = settings->frame_stats_callback;
+  cxx_settings.frame_stats_private_data = settings->frame_stats_private_data;
+  return cxx_decoder->AddStream(&cxx_settings, stream_id_out);
+}
+
+Libgav1StatusCode Libgav1MultiStreamDecoderRemoveStream(
+    Libgav1MultiStreamDecoder* decoder, int stream_id) {
+  auto* cxx_decoder = reinterpret_cast<libgav1::MultiStreamDecoder*>(decoder);
+  return cxx_decoder->RemoveStream(stream_id);
+}
+
+Libgav1StatusCode Libgav1MultiStreamDecoderEnqueueFrame(
+    Libgav1MultiStreamDecoder* decoder, int stream_id, const uint8_t* data,
+    size_t size, int64_t user_private_data, void* buffer_private_data) {
+  auto* cxx_decoder = reinterpret_cast<libgav1::MultiStreamDecoder*>(decoder);
+  return cxx_decoder->EnqueueFrame(stream_id, data, size, user_private_data,
+                                   buffer_private_data);
+}
+
+Libgav1StatusCode Libgav1MultiStreamDecoderDequeueFrame(
+    Libgav1MultiStreamDecoder* decoder, int stream_id,
+    const Libgav1DecoderBuffer** out_ptr) {
+  auto* cxx_decoder = reinterpret_cast<libgav1::MultiStreamDecoder*>(decoder);
+  return cxx_decoder->DequeueFrame(stream_id, out_ptr);
+}
+
+Libgav1StatusCode Libgav1MultiStreamDecoderSignalEOS(
+    Libgav1MultiStreamDecoder* decoder, int stream_id) {
+  auto* cxx_decoder = reinterpret_cast<libgav1::MultiStreamDecoder*>(decoder);
+  return cxx_decoder->SignalEOS(stream_id);
+}
+
+}  // extern "C"
+
+namespace libgav1 {
+
+MultiStreamDecoder::MultiStreamDecoder() = default;
+
+MultiStreamDecoder::~MultiStreamDecoder() = default;
+
+StatusCode MultiStreamDecoder::Init(int threads) {
+  if (impl_ != nullptr) return kStatusAlready;
+  return MultiStreamDecoderImpl::Create(threads, &impl_);
+}
+
+StatusCode MultiStreamDecoder::AddStream(const DecoderSettings* settings,
+                                         int* stream_id) {
+  if (impl_ == nullptr) return kStatusNotInitialized;
+  if (settings == nullptr) {
+    return impl_->AddStream(DecoderSettings(), stream_id);
+  }
+  return impl_->AddStream(*settings, stream_id);
+}
+
+StatusCode MultiStreamDecoder::RemoveStream(int stream_id) {
+  if (impl_ == nullptr) return kStatusNotInitialized;
+  return impl_->RemoveStream(stream_id);
+}
+
+StatusCode MultiStreamDecoder::EnqueueFrame(int stream_id, const uint8_t* data,
+                                            const size_t size,
+                                            int64_t user_private_data,
+                                            void* buffer_private_data) {
+  if (impl_ == nullptr) return kStatusNotInitialized;
+  return impl_->EnqueueFrame(stream_id, data, size, user_private_data,
+                             buffer_private_data);
+}
+
+StatusCode MultiStreamDecoder::DequeueFrame(int stream_id,
+                                            const DecoderBuffer** out_ptr) {
+  if (impl_ == nullptr) return kStatusNotInitialized;
+  return impl_->DequeueFrame(stream_id, out_ptr);
+}
+
+StatusCode MultiStreamDecoder::SignalEOS(int stream_id) {
+  if (impl_ == nullptr) return kStatusNotInitialized;
+  return impl_->SignalEOS(stream_id);
+}
+
+}  // namespace libgav1
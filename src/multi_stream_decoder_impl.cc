@@ -0,0 +1,352 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/multi_stream_decoder_impl.h"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+#include <utility>
+
+#include "src/utils/common.h"
+#include "src/utils/constants.h"
+#include "src/utils/logging.h"
+
+namespace libgav1 {
+namespace {
+
+// Runs |job| on the ThreadPool |executor_private_data|. This is the executor of
+// the streams that are decoded with more than one thread.
+void ScheduleOnThreadPool(void* executor_private_data, JobFunction job,
+                          void* job_private_data) {
+  static_cast<ThreadPool*>(executor_private_data)
+      ->Schedule([job, job_private_data]() { job(job_private_data); });
+}
+
+}  // namespace
+
+// static
+StatusCode MultiStreamDecoderImpl::Create(
+    int threads, std::unique_ptr<MultiStreamDecoderImpl>* output) {
+  if (threads <= 0) {
+    LIBGAV1_DLOG(ERROR, "Invalid threads: %d.", threads);
+    return kStatusInvalidArgument;
+  }
+  std::unique_ptr<MultiStreamDecoderImpl> impl(new (std::nothrow)
+                                                   MultiStreamDecoderImpl());
+  if (impl == nullptr) {
+    LIBGAV1_DLOG(ERROR, "Failed to allocate MultiStreamDecoderImpl.");
+    return kStatusOutOfMemory;
+  }
+  impl->thread_pool_ =
+      ThreadPool::Create("libgav1-ms", std::min<int>(threads, kMaxThreads));
+  if (impl->thread_pool_ == nullptr) {
+    LIBGAV1_DLOG(ERROR, "Failed to create thread pool with %d threads.",
+                 threads);
+    return kStatusOutOfMemory;
+  }
+  *output = std::move(impl);
+  return kStatusOk;
+}
+
+MultiStreamDecoderImpl::~MultiStreamDecoderImpl() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    shutting_down_ = true;
+  }
+  for (auto& stream : streams_) {
+    if (stream != nullptr) DrainStream(stream.get());
+  }
+}
+
+StatusCode MultiStreamDecoderImpl::AddStream(const DecoderSettings& settings,
+                                             int* stream_id) {
+  if (stream_id == nullptr) {
+    LIBGAV1_DLOG(ERROR, "Invalid argument: stream_id == nullptr.");
+    return kStatusInvalidArgument;
+  }
+  std::unique_ptr<Stream> stream(new (std::nothrow) Stream);
+  if (stream == nullptr) {
+    LIBGAV1_DLOG(ERROR, "Failed to allocate Stream.");
+    return kStatusOutOfMemory;
+  }
+  stream->settings = settings;
+  // The threads of a stream are taken from the worker threads. The worker
+  // thread that decodes a temporal unit of the stream also takes part in the
+  // decoding, so a stream uses at most all the worker threads.
+  stream->settings.threads =
+      Clip3(settings.threads, 1, thread_pool_->num_threads());
+  stream->settings.frame_parallel = false;
+  if (stream->settings.threads > 1) {
+    stream->settings.schedule_job = ScheduleOnThreadPool;
+    stream->settings.executor_private_data = thread_pool_.get();
+  } else {
+    stream->settings.schedule_job = nullptr;
+    stream->settings.executor_private_data = nullptr;
+  }
+  const int max_outputs_per_temporal_unit =
+      stream->settings.output_all_layers ? kMaxLayers : 1;
+  if (!stream->input.Init(kMaxDecodeAhead) ||
+      !stream->output.Init(kMaxDecodeAhead * max_outputs_per_temporal_unit)) {
+    LIBGAV1_DLOG(ERROR, "Failed to allocate the stream queues.");
+    return kStatusOutOfMemory;
+  }
+  const StatusCode status = DecoderImpl::Create(
+      &stream->settings, &stream->decoder, &shared_resources_);
+  if (status != kStatusOk) return status;
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < streams_.size(); ++i) {
+    if (streams_[i] == nullptr) {
+      streams_[i] = std::move(stream);
+      *stream_id = static_cast<int>(i);
+      return kStatusOk;
+    }
+  }
+  if (!streams_.push_back(std::move(stream))) {
+    LIBGAV1_DLOG(ERROR, "Failed to add a stream.");
+    return kStatusOutOfMemory;
+  }
+  *stream_id = static_cast<int>(streams_.size()) - 1;
+  return kStatusOk;
+}
+
+StatusCode MultiStreamDecoderImpl::RemoveStream(int stream_id) {
+  Stream* const stream = GetStream(stream_id);
+  if (stream == nullptr) return kStatusInvalidArgument;
+  DrainStream(stream);
+  std::unique_ptr<Stream> removed_stream;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    removed_stream = std::move(streams_[stream_id]);
+  }
+  return kStatusOk;
+}
+
+StatusCode MultiStreamDecoderImpl::EnqueueFrame(int stream_id,
+                                                const uint8_t* data,
+                                                size_t size,
+                                                int64_t user_private_data,
+                                                void* buffer_private_data) {
+  if (data == nullptr || size == 0) return kStatusInvalidArgument;
+  Stream* const stream = GetStream(stream_id);
+  if (stream == nullptr) return kStatusInvalidArgument;
+  bool schedule;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stream->input.Full()) return kStatusTryAgain;
+    stream->input.Push(
+        Input{data, size, user_private_data, buffer_private_data});
+    schedule = MaybeMarkReadyLocked(stream);
+  }
+  if (schedule) ScheduleDecodeJob();
+  return kStatusOk;
+}
+
+StatusCode MultiStreamDecoderImpl::DequeueFrame(int stream_id,
+                                                const DecoderBuffer** out_ptr) {
+  if (out_ptr == nullptr) {
+    LIBGAV1_DLOG(ERROR, "Invalid argument: out_ptr == nullptr.");
+    return kStatusInvalidArgument;
+  }
+  Stream* const stream = GetStream(stream_id);
+  if (stream == nullptr) return kStatusInvalidArgument;
+  // A call to DequeueFrame() indicates that the caller is no longer using the
+  // previous output frame. It is released after |mutex_| is unlocked.
+  RefCountedBufferPtr previous_frame = std::move(stream->current.frame);
+  stream->current.has_buffer = false;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (stream->output.Empty()) {
+    if (!stream->decoding && stream->input.Empty()) {
+      *out_ptr = nullptr;
+      return kStatusNothingToDequeue;
+    }
+    if (!stream->settings.blocking_dequeue) return kStatusTryAgain;
+    condvar_.wait(lock);
+  }
+  stream->current = std::move(stream->output.Front());
+  stream->output.Pop();
+  bool schedule = false;
+  if (stream->current.last_in_temporal_unit) {
+    --stream->decoded_temporal_units;
+    schedule = MaybeMarkReadyLocked(stream);
+  }
+  lock.unlock();
+  if (schedule) ScheduleDecodeJob();
+  *out_ptr = stream->current.has_buffer ? &stream->current.buffer : nullptr;
+  return stream->current.status;
+}
+
+StatusCode MultiStreamDecoderImpl::SignalEOS(int stream_id) {
+  Stream* const stream = GetStream(stream_id);
+  if (stream == nullptr) return kStatusInvalidArgument;
+  DrainStream(stream);
+  // Replace the decoder with a new instance so that all the references it
+  // holds are released and its state is cleared.
+  stream->decoder = nullptr;
+  return DecoderImpl::Create(&stream->settings, &stream->decoder,
+                             &shared_resources_);
+}
+
+MultiStreamDecoderImpl::Stream* MultiStreamDecoderImpl::GetStream(
+    int stream_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stream_id < 0 || static_cast<size_t>(stream_id) >= streams_.size()) {
+    LIBGAV1_DLOG(ERROR, "Invalid stream_id: %d.", stream_id);
+    return nullptr;
+  }
+  return streams_[stream_id].get();
+}
+
+bool MultiStreamDecoderImpl::MaybeMarkReadyLocked(Stream* stream) {
+  if (stream->decoding || stream->input.Empty() ||
+      stream->decoded_temporal_units >= kMaxDecodeAhead || shutting_down_) {
+    return false;
+  }
+  if (stream->settings.threads > 1) {
+    // The worker thread that decodes the stream waits for the jobs of the
+    // stream, which never wait. One worker thread is always left to run those
+    // jobs.
+    if (threaded_streams_decoding_ == thread_pool_->num_threads() - 1) {
+      return false;
+    }
+    ++threaded_streams_decoding_;
+  }
+  stream->decoding = true;
+  stream->next_ready = nullptr;
+  if (ready_tail_ == nullptr) {
+    ready_head_ = stream;
+  } else {
+    ready_tail_->next_ready = stream;
+  }
+  ready_tail_ = stream;
+  return true;
+}
+
+int MultiStreamDecoderImpl::FinishDecodingLocked(Stream* stream) {
+  stream->decoding = false;
+  int num_jobs = 0;
+  if (stream->settings.threads > 1) {
+    --threaded_streams_decoding_;
+    // Another stream may have been waiting for a worker thread to decode it.
+    for (auto& other_stream : streams_) {
+      if (other_stream != nullptr && other_stream.get() != stream &&
+          MaybeMarkReadyLocked(other_stream.get())) {
+        ++num_jobs;
+        break;
+      }
+    }
+  }
+  if (MaybeMarkReadyLocked(stream)) ++num_jobs;
+  return num_jobs;
+}
+
+void MultiStreamDecoderImpl::ScheduleDecodeJob() {
+  thread_pool_->Schedule([this]() { DecodeNextTemporalUnit(); });
+}
+
+void MultiStreamDecoderImpl::DecodeNextTemporalUnit() {
+  Stream* stream;
+  Input input;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Every job corresponds to one stream in the ready list.
+    assert(ready_head_ != nullptr);
+    stream = ready_head_;
+    ready_head_ = stream->next_ready;
+    if (ready_head_ == nullptr) ready_tail_ = nullptr;
+    if (stream->input.Empty()) {
+      // The inputs were dropped by DrainStream().
+      const int num_jobs = FinishDecodingLocked(stream);
+      condvar_.notify_all();
+      lock.unlock();
+      for (int i = 0; i < num_jobs; ++i) ScheduleDecodeJob();
+      return;
+    }
+    input = stream->input.Front();
+    stream->input.Pop();
+  }
+  Output outputs[kMaxLayers];
+  int num_outputs = 0;
+  StatusCode status =
+      stream->decoder->EnqueueFrame(input.data, input.size,
+                                    input.user_private_data,
+                                    input.buffer_private_data);
+  if (status != kStatusOk) {
+    // The decoder did not take the input, so it will not release it.
+    if (stream->settings.release_input_buffer != nullptr) {
+      stream->settings.release_input_buffer(
+          stream->settings.callback_private_data, input.buffer_private_data);
+    }
+    outputs[num_outputs++].status = status;
+  } else {
+    // Collect all the outputs of the temporal unit. This decodes the temporal
+    // unit on this thread, with the help of the other worker threads if the
+    // stream has more than one thread.
+    do {
+      const DecoderBuffer* buffer;
+      status = stream->decoder->DequeueFrame(&buffer);
+      if (status == kStatusNothingToDequeue) break;
+      assert(num_outputs < kMaxLayers);
+      Output& output = outputs[num_outputs++];
+      output.status = status;
+      if (buffer != nullptr) {
+        output.buffer = *buffer;
+        output.has_buffer = true;
+        output.frame = stream->decoder->output_frame();
+      }
+    } while (status == kStatusOk && num_outputs < kMaxLayers);
+  }
+  // A temporal unit without a frame to show still has an output, without a
+  // buffer.
+  if (num_outputs == 0) num_outputs = 1;
+  outputs[num_outputs - 1].last_in_temporal_unit = true;
+  int num_jobs;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < num_outputs; ++i) {
+      stream->output.Push(std::move(outputs[i]));
+    }
+    ++stream->decoded_temporal_units;
+    num_jobs = FinishDecodingLocked(stream);
+    // Notify with |mutex_| held. Once it is unlocked, the destructor may run.
+    condvar_.notify_all();
+  }
+  for (int i = 0; i < num_jobs; ++i) ScheduleDecodeJob();
+}
+
+void MultiStreamDecoderImpl::DrainStream(Stream* stream) {
+  Input inputs[kMaxDecodeAhead];
+  int num_inputs = 0;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // Take the inputs first so that the stream is not rescheduled.
+    while (!stream->input.Empty()) {
+      inputs[num_inputs++] = stream->input.Front();
+      stream->input.Pop();
+    }
+    while (stream->decoding) condvar_.wait(lock);
+    stream->output.Clear();
+    stream->decoded_temporal_units = 0;
+  }
+  stream->current = Output();
+  if (stream->settings.release_input_buffer != nullptr) {
+    for (int i = 0; i < num_inputs; ++i) {
+      stream->settings.release_input_buffer(
+          stream->settings.callback_private_data,
+          inputs[i].buffer_private_data);
+    }
+  }
+}
+
+}  // namespace libgav1
@@ -0,0 +1,137 @@
+/*
+ * Copyright 2024 The libgav1 Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGAV1_SRC_MULTI_STREAM_DECODER_IMPL_H_
+#define LIBGAV1_SRC_MULTI_STREAM_DECODER_IMPL_H_
+
+#include <condition_variable>  // NOLINT (unapproved c++11 header)
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT (unapproved c++11 header)
+
+#include "src/buffer_pool.h"
+#include "src/decoder_impl.h"
+#include "src/gav1/decoder_buffer.h"
+#include "src/gav1/decoder_settings.h"
+#include "src/gav1/status_code.h"
+#include "src/utils/compiler_attributes.h"
+#include "src/utils/memory.h"
+#include "src/utils/queue.h"
+#include "src/utils/threadpool.h"
+#include "src/utils/vector.h"
+
+namespace libgav1 {
+
+// Decodes the temporal units of many streams on one thread pool. Each stream
+// has its own DecoderImpl. Whenever a stream has a temporal unit to decode, it
+// is appended to a ready list and a job is scheduled on the thread pool. Every
+// job decodes one temporal unit of the stream at the head of the ready list,
+// so the streams take turns on the worker threads. The DecoderImpl of a
+// stream with more than one thread schedules its own jobs on the same thread
+// pool.
+class MultiStreamDecoderImpl : public Allocable {
+ public:
+  static StatusCode Create(int threads,
+                           std::unique_ptr<MultiStreamDecoderImpl>* output);
+  ~MultiStreamDecoderImpl();
+
+  StatusCode AddStream(const DecoderSettings& settings, int* stream_id);
+  StatusCode RemoveStream(int stream_id);
+  StatusCode EnqueueFrame(int stream_id, const uint8_t* data, size_t size,
+                          int64_t user_private_data, void* buffer_private_data);
+  StatusCode DequeueFrame(int stream_id, const DecoderBuffer** out_ptr);
+  StatusCode SignalEOS(int stream_id);
+
+ private:
+  // The maximum number of temporal units of a stream that may be waiting to
+  // be decoded. The same number of decoded temporal units may be waiting to
+  // be dequeued.
+  static constexpr int kMaxDecodeAhead = 2;
+
+  struct Input {
+    const uint8_t* data;
+    size_t size;
+    int64_t user_private_data;
+    void* buffer_private_data;
+  };
+
+  struct Output {
+    StatusCode status = kStatusOk;
+    DecoderBuffer buffer = {};
+    bool has_buffer = false;
+    // Keeps the planes of |buffer| valid.
+    RefCountedBufferPtr frame;
+    // True for the last output of a temporal unit.
+    bool last_in_temporal_unit = false;
+  };
+
+  struct Stream : public Allocable {
+    DecoderSettings settings;
+    // Declared first so that it is destroyed after the frames in |output| and
+    // |current|, which belong to its buffer pool.
+    std::unique_ptr<DecoderImpl> decoder;
+    Queue<Input> input;
+    Queue<Output> output;
+    // The output returned by the last DequeueFrame() call.
+    Output current;
+    // The number of temporal units in |output|.
+    int decoded_temporal_units = 0;
+    // True while the stream is in the ready list or a job is decoding it.
+    bool decoding = false;
+    Stream* next_ready = nullptr;
+  };
+
+  MultiStreamDecoderImpl() = default;
+
+  // Returns the stream with |stream_id| or nullptr if there is no such stream.
+  Stream* GetStream(int stream_id);
+
+  // Appends |stream| to the ready list and returns true if it has a temporal
+  // unit that can be decoded now. The caller must then schedule a job with
+  // ScheduleDecodeJob() after releasing |mutex_|.
+  bool MaybeMarkReadyLocked(Stream* stream);
+  // Called when a job is done with |stream|. Marks the streams that can be
+  // decoded now as ready and returns the number of jobs that the caller must
+  // schedule with ScheduleDecodeJob() after releasing |mutex_|.
+  int FinishDecodingLocked(Stream* stream);
+  void ScheduleDecodeJob();
+  // The job that decodes one temporal unit of the stream at the head of the
+  // ready list.
+  void DecodeNextTemporalUnit();
+  // Waits for the decoding of |stream| to finish and drops all the inputs and
+  // outputs of |stream|. The |release_input_buffer| callback is called for
+  // the inputs that were not decoded.
+  void DrainStream(Stream* stream);
+
+  std::mutex mutex_;
+  std::condition_variable condvar_;
+  Vector<std::unique_ptr<Stream>> streams_ LIBGAV1_GUARDED_BY(mutex_);
+  Stream* ready_head_ LIBGAV1_GUARDED_BY(mutex_) = nullptr;
+  Stream* ready_tail_ LIBGAV1_GUARDED_BY(mutex_) = nullptr;
+  bool shutting_down_ LIBGAV1_GUARDED_BY(mutex_) = false;
+  // The number of streams with more than one thread that are in the ready
+  // list or are being decoded. At most thread_pool_->num_threads() - 1.
+  int threaded_streams_decoding_ LIBGAV1_GUARDED_BY(mutex_) = 0;
+  DecoderSharedResources shared_resources_;
+  // Declared last so that the worker threads are joined before the streams
+  // are destroyed.
+  std::unique_ptr<ThreadPool> thread_pool_;
+};
+
+}  // namespace libgav1
+
+#endif  // LIBGAV1_SRC_MULTI_STREAM_DECODER_IMPL_H_
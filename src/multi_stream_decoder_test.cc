@@ -0,0 +1,273 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/gav1/multi_stream_decoder.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+#include "gtest/gtest.h"
+#include "src/decoder_test_data.h"
+
+namespace libgav1 {
+namespace {
+
+constexpr uint8_t kFrame1[] = {OBU_TEMPORAL_DELIMITER, OBU_SEQUENCE_HEADER,
+                               OBU_FRAME_1};
+
+constexpr uint8_t kFrame2[] = {OBU_TEMPORAL_DELIMITER, OBU_FRAME_2};
+
+constexpr int kNumStreams = 3;
+
+class MultiStreamDecoderTest : public testing::Test {
+ public:
+  void SetUp() override;
+  void IncrementFramesInUse() { ++frames_in_use_; }
+  void DecrementFramesInUse() { --frames_in_use_; }
+  void IncrementReleasedInputBuffers() { ++released_input_buffers_; }
+
+ protected:
+  // Enqueues kFrame1 and kFrame2 to every stream and dequeues both of their
+  // outputs.
+  void DecodeTwoFrames(bool blocking_dequeue);
+
+  std::unique_ptr<MultiStreamDecoder> decoder_;
+  int stream_ids_[kNumStreams];
+  std::atomic<int> frames_in_use_{0};
+  std::atomic<int> released_input_buffers_{0};
+};
+
+struct FrameBufferPrivate {
+  uint8_t* data[3];
+};
+
+extern "C" {
+
+static Libgav1StatusCode GetFrameBuffer(
+    void* callback_private_data, int bitdepth, Libgav1ImageFormat image_format,
+    int width, int height, int left_border, int right_border, int top_border,
+    int bottom_border, int stride_alignment, Libgav1FrameBuffer* frame_buffer) {
+  Libgav1FrameBufferInfo info;
+  Libgav1StatusCode status = Libgav1ComputeFrameBufferInfo(
+      bitdepth, image_format, width, height, left_border, right_border,
+      top_border, bottom_border, stride_alignment, &info);
+  if (status != kLibgav1StatusOk) return status;
+
+  std::unique_ptr<FrameBufferPrivate> buffer_private(new (std::nothrow)
+                                                         FrameBufferPrivate);
+  if (buffer_private == nullptr) return kLibgav1StatusOutOfMemory;
+
+  for (int i = 0; i < 3; ++i) {
+    const size_t size = (i == 0) ? info.y_buffer_size : info.uv_buffer_size;
+    buffer_private->data[i] = new (std::nothrow) uint8_t[size];
+    if (buffer_private->data[i] == nullptr) {
+      return kLibgav1StatusOutOfMemory;
+    }
+  }
+
+  uint8_t* const y_buffer = buffer_private->data[0];
+  uint8_t* const u_buffer =
+      (info.uv_buffer_size != 0) ? buffer_private->data[1] : nullptr;
+  uint8_t* const v_buffer =
+      (info.uv_buffer_size != 0) ? buffer_private->data[2] : nullptr;
+
+  status = Libgav1SetFrameBuffer(&info, y_buffer, u_buffer, v_buffer,
+                                 buffer_private.release(), frame_buffer);
+  if (status != kLibgav1StatusOk) return status;
+
+  auto* const test =
+      static_cast<MultiStreamDecoderTest*>(callback_private_data);
+  test->IncrementFramesInUse();
+  return kLibgav1StatusOk;
+}
+
+static void ReleaseFrameBuffer(void* callback_private_data,
+                               void* buffer_private_data) {
+  auto* buffer_private = static_cast<FrameBufferPrivate*>(buffer_private_data);
+  for (auto& data : buffer_private->data) {
+    delete[] data;
+  }
+  delete buffer_private;
+  auto* const test =
+      static_cast<MultiStreamDecoderTest*>(callback_private_data);
+  test->DecrementFramesInUse();
+}
+
+static void ReleaseInputBuffer(void* private_data, void* /*input_buffer*/) {
+  auto* const test = static_cast<MultiStreamDecoderTest*>(private_data);
+  test->IncrementReleasedInputBuffers();
+}
+
+}  // extern "C"
+
+void MultiStreamDecoderTest::SetUp() {
+  decoder_.reset(new (std::nothrow) MultiStreamDecoder());
+  ASSERT_NE(decoder_, nullptr);
+  ASSERT_EQ(decoder_->Init(4), kStatusOk);
+  EXPECT_EQ(decoder_->Init(4), kStatusAlready);
+}
+
+void MultiStreamDecoderTest::DecodeTwoFrames(bool blocking_dequeue) {
+  DecoderSettings settings = {};
+  settings.blocking_dequeue = blocking_dequeue;
+  settings.get_frame_buffer = GetFrameBuffer;
+  settings.release_frame_buffer = ReleaseFrameBuffer;
+  settings.callback_private_data = this;
+  settings.release_input_buffer = ReleaseInputBuffer;
+  for (auto& stream_id : stream_ids_) {
+    ASSERT_EQ(decoder_->AddStream(&settings, &stream_id), kStatusOk);
+  }
+  for (int i = 0; i < kNumStreams; ++i) {
+    ASSERT_EQ(decoder_->EnqueueFrame(stream_ids_[i], kFrame1, sizeof(kFrame1),
+                                     2 * i, nullptr),
+              kStatusOk);
+    ASSERT_EQ(decoder_->EnqueueFrame(stream_ids_[i], kFrame2, sizeof(kFrame2),
+                                     2 * i + 1, nullptr),
+              kStatusOk);
+  }
+  for (int i = 0; i < kNumStreams; ++i) {
+    for (int j = 0; j < 2; ++j) {
+      const DecoderBuffer* buffer;
+      StatusCode status;
+      do {
+        status = decoder_->DequeueFrame(stream_ids_[i], &buffer);
+      } while (status == kStatusTryAgain && !blocking_dequeue);
+      ASSERT_EQ(status, kStatusOk);
+      ASSERT_NE(buffer, nullptr);
+      EXPECT_EQ(buffer->user_private_data, 2 * i + j);
+    }
+  }
+  EXPECT_EQ(released_input_buffers_, 2 * kNumStreams);
+}
+
+TEST_F(MultiStreamDecoderTest, BlockingDequeue) {
+  DecodeTwoFrames(/*blocking_dequeue=*/true);
+  // Every stream holds frame1 as a reference and frame2 as its output.
+  EXPECT_EQ(frames_in_use_, 2 * kNumStreams);
+
+  const DecoderBuffer* buffer;
+  for (const int stream_id : stream_ids_) {
+    EXPECT_EQ(decoder_->DequeueFrame(stream_id, &buffer),
+              kStatusNothingToDequeue);
+    EXPECT_EQ(buffer, nullptr);
+    EXPECT_EQ(decoder_->SignalEOS(stream_id), kStatusOk);
+  }
+  EXPECT_EQ(frames_in_use_, 0);
+
+  // The streams are ready to decode a new coded video sequence.
+  for (const int stream_id : stream_ids_) {
+    ASSERT_EQ(decoder_->EnqueueFrame(stream_id, kFrame1, sizeof(kFrame1), 0,
+                                     nullptr),
+              kStatusOk);
+    ASSERT_EQ(decoder_->DequeueFrame(stream_id, &buffer), kStatusOk);
+    ASSERT_NE(buffer, nullptr);
+  }
+  EXPECT_EQ(frames_in_use_, kNumStreams);
+
+  decoder_ = nullptr;
+  EXPECT_EQ(frames_in_use_, 0);
+}
+
+TEST_F(MultiStreamDecoderTest, NonBlockingDequeue) {
+  DecodeTwoFrames(/*blocking_dequeue=*/false);
+  const DecoderBuffer* buffer;
+  for (const int stream_id : stream_ids_) {
+    EXPECT_EQ(decoder_->DequeueFrame(stream_id, &buffer),
+              kStatusNothingToDequeue);
+  }
+  decoder_ = nullptr;
+  EXPECT_EQ(frames_in_use_, 0);
+}
+
+TEST_F(MultiStreamDecoderTest, EnqueueTryAgainWhenQueueIsFull) {
+  DecoderSettings settings = {};
+  settings.blocking_dequeue = true;
+  settings.callback_private_data = this;
+  settings.release_input_buffer = ReleaseInputBuffer;
+  int stream_id;
+  ASSERT_EQ(decoder_->AddStream(&settings, &stream_id), kStatusOk);
+  ASSERT_EQ(
+      decoder_->EnqueueFrame(stream_id, kFrame1, sizeof(kFrame1), 0, nullptr),
+      kStatusOk);
+  int num_enqueued = 1;
+  StatusCode status;
+  while ((status = decoder_->EnqueueFrame(stream_id, kFrame2, sizeof(kFrame2),
+                                          num_enqueued, nullptr)) ==
+         kStatusOk) {
+    ++num_enqueued;
+    // At most two temporal units each may be waiting to be decoded and
+    // waiting to be dequeued, and one may be being decoded.
+    ASSERT_LE(num_enqueued, 5);
+  }
+  EXPECT_EQ(status, kStatusTryAgain);
+  EXPECT_GE(num_enqueued, 2);
+
+  for (int i = 0; i < num_enqueued; ++i) {
+    const DecoderBuffer* buffer;
+    ASSERT_EQ(decoder_->DequeueFrame(stream_id, &buffer), kStatusOk);
+    ASSERT_NE(buffer, nullptr);
+    EXPECT_EQ(buffer->user_private_data, i);
+  }
+  EXPECT_EQ(released_input_buffers_, num_enqueued);
+}
+
+TEST_F(MultiStreamDecoderTest, RemoveStream) {
+  DecoderSettings settings = {};
+  settings.get_frame_buffer = GetFrameBuffer;
+  settings.release_frame_buffer = ReleaseFrameBuffer;
+  settings.callback_private_data = this;
+  settings.release_input_buffer = ReleaseInputBuffer;
+  int stream_id;
+  ASSERT_EQ(decoder_->AddStream(&settings, &stream_id), kStatusOk);
+  ASSERT_EQ(
+      decoder_->EnqueueFrame(stream_id, kFrame1, sizeof(kFrame1), 0, nullptr),
+      kStatusOk);
+  ASSERT_EQ(
+      decoder_->EnqueueFrame(stream_id, kFrame2, sizeof(kFrame2), 1, nullptr),
+      kStatusOk);
+  // Remove the stream without dequeuing. All the inputs are released, whether
+  // or not they were decoded, and so are all the frames.
+  ASSERT_EQ(decoder_->RemoveStream(stream_id), kStatusOk);
+  EXPECT_EQ(released_input_buffers_, 2);
+  EXPECT_EQ(frames_in_use_, 0);
+
+  const DecoderBuffer* buffer;
+  EXPECT_EQ(decoder_->DequeueFrame(stream_id, &buffer), kStatusInvalidArgument);
+  EXPECT_EQ(decoder_->RemoveStream(stream_id), kStatusInvalidArgument);
+  EXPECT_EQ(decoder_->EnqueueFrame(stream_id, kFrame1, sizeof(kFrame1), 0,
+                                   nullptr),
+            kStatusInvalidArgument);
+
+  // The identifier of the removed stream is reused.
+  int new_stream_id;
+  ASSERT_EQ(decoder_->AddStream(nullptr, &new_stream_id), kStatusOk);
+  EXPECT_EQ(new_stream_id, stream_id);
+}
+
+TEST(MultiStreamDecoderInitTest, InvalidArguments) {
+  MultiStreamDecoder decoder;
+  int stream_id;
+  EXPECT_EQ(decoder.AddStream(nullptr, &stream_id), kStatusNotInitialized);
+  EXPECT_EQ(decoder.Init(0), kStatusInvalidArgument);
+  ASSERT_EQ(decoder.Init(1), kStatusOk);
+  EXPECT_EQ(decoder.AddStream(nullptr, nullptr), kStatusInvalidArgument);
+  const DecoderBuffer* buffer;
+  EXPECT_EQ(decoder.DequeueFrame(0, &buffer), kStatusInvalidArgument);
+}
+
+}  // namespace
+}  // namespace libgav1
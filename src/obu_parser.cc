@@ -2104,8 +2104,11 @@ bool ObuParser::ParseFrameParameters() {
   }
   // At this point, we have parsed the frame and render sizes and computed
   // the image size, whether it's an intra or inter frame. So we can save
-  // the sizes in the current frame now.
-  if (!current_frame_->SetFrameDimensions(frame_header_)) {
+  // the sizes in the current frame now. The per-block data of the frame is
+  // not needed when only the headers are parsed.
+  if (header_only_) {
+    current_frame_->SetFrameSize(frame_header_);
+  } else if (!current_frame_->SetFrameDimensions(frame_header_)) {
     LIBGAV1_DLOG(ERROR, "Setting current frame dimensions failed.");
     return false;
   }
@@ -2532,6 +2535,10 @@ bool ObuParser::AddTileBuffers(int start, int end, size_t total_size,
                  total_size, tg_header_size);
     return false;
   }
+  if (header_only_) {
+    bit_reader_->SkipBytes(total_size - tg_header_size);
+    return true;
+  }
   size_t bytes_left = total_size - tg_header_size;
   const uint8_t* data = data_ + bytes_consumed_so_far + tg_header_size;
   for (int tile_number = start; tile_number <= end; ++tile_number) {
@@ -2661,6 +2668,10 @@ bool ObuParser::ParseHeader() {
 #undef OBU_LOG_AND_RETURN_FALSE
 
 bool ObuParser::InitBitReader(const uint8_t* const data, size_t size) {
+  if (bit_reader_ != nullptr) {
+    bit_reader_->Reset(data, size);
+    return true;
+  }
   bit_reader_.reset(new (std::nothrow) RawBitReader(data, size));
   return bit_reader_ != nullptr;
 }
@@ -2675,6 +2686,21 @@ bool ObuParser::EnsureCurrentFrameIsNotNull() {
   return true;
 }
 
+void ObuParser::Reset(const uint8_t* const data, size_t size) {
+  assert(current_frame_ == nullptr);
+  data_ = data;
+  size_ = size;
+  obu_headers_.clear();
+  sequence_header_ = {};
+  frame_header_ = {};
+  tile_buffers_.clear();
+  next_tile_group_start_ = 0;
+  has_sequence_header_ = false;
+  sequence_header_changed_ = false;
+  extension_disallowed_ = false;
+  header_only_ = false;
+}
+
 bool ObuParser::HasData() const { return size_ > 0; }
 
 StatusCode ObuParser::ParseOneFrame(RefCountedBufferPtr* const current_frame) {
@@ -233,9 +233,17 @@ class ObuParser : public Allocable {
   ObuParser(const ObuParser& rhs) = delete;
   ObuParser& operator=(const ObuParser& rhs) = delete;
 
+  // Prepares the parser for the temporal unit in |data|, as if it had just
+  // been constructed. The memory of the parser is kept, so reusing a parser
+  // for the next temporal unit does not allocate.
+  void Reset(const uint8_t* data, size_t size);
+
   // Returns true if there is more data that needs to be parsed.
   bool HasData() const;
 
+  // Returns the number of bytes that have not been parsed yet.
+  size_t bytes_remaining() const { return size_; }
+
   // Parses a sequence of Open Bitstream Units until a decodable frame is found
   // (or until the end of stream is reached). A decodable frame is considered to
   // be found when one of the following happens:
@@ -272,6 +280,12 @@ class ObuParser : public Allocable {
     sequence_header_ = sequence_header;
     has_sequence_header_ = true;
   }
+  // If |header_only| is true, ParseOneFrame() only parses the OBU and frame
+  // headers. The tile group payloads are skipped without populating
+  // tile_buffers(), and the per-block data of the current frame (the
+  // segmentation map and the motion field) is not allocated, so the frames
+  // must not be decoded.
+  void set_header_only(bool header_only) { header_only_ = header_only; }
 
   // Moves |tile_buffers_| into |tile_buffers|.
   void MoveTileBuffers(Vector<TileBuffer>* tile_buffers) {
@@ -391,6 +405,8 @@ class ObuParser : public Allocable {
   // If true, the obu_extension_flag syntax element in the OBU header must be
   // 0. Set to true when parsing a sequence header if OperatingPointIdc is 0.
   bool extension_disallowed_ = false;
+  // If true, only the headers are parsed. See set_header_only().
+  bool header_only_ = false;
 
   BufferPool* const buffer_pool_;
   DecoderState& decoder_state_;
@@ -19,21 +19,24 @@
 
 #include <algorithm>
 #include <array>
-#include <atomic>
+#include <condition_variable>  // NOLINT (unapproved c++11 header)
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <mutex>  // NOLINT (unapproved c++11 header)
 #include <type_traits>
 
 #include "src/dsp/common.h"
 #include "src/dsp/dsp.h"
 #include "src/frame_scratch_buffer.h"
+#include "src/frame_stats_collector.h"
 #include "src/loop_restoration_info.h"
 #include "src/obu_parser.h"
 #include "src/utils/array_2d.h"
 #include "src/utils/block_parameters_holder.h"
 #include "src/utils/common.h"
 #include "src/utils/constants.h"
+#include "src/utils/dynamic_buffer.h"
 #include "src/utils/memory.h"
 #include "src/utils/threadpool.h"
 #include "src/yuv_buffer.h"
@@ -116,8 +119,36 @@ class PostFilter {
   //                as the input and the output is written into
   //                |loop_restoration_buffer_| (which is just |superres_buffer_|
   //                with a shift to the left).
+  // * Border extension: If the frame will be used as a reference frame, the
+  //                     borders of |frame_buffer_| are extended.
+  // The frame is split into rows of 64x64 loop filter units and the filters
+  // above are applied as separate stages (see FilterStage) for each unit row.
+  // There are no frame wide barriers between the stages. Each (stage, unit
+  // row) task is run by the worker threads as soon as the tasks it depends on
+  // (in the same and the neighboring unit rows) are done.
+  // If filter pipelining is enabled, the tasks that were already run in the
+  // pipeline are not run again.
   void ApplyFilteringThreaded();
 
+  // Enables pipelining of the post filters with tile decoding in the
+  // multi-threaded non frame parallel mode. Once all the tile columns have
+  // finished decoding a superblock row and the superblock row below it, the
+  // tasks of ApplyFilteringThreaded() for the unit rows of that superblock row
+  // are run on |thread_pool_| while the rest of the frame is still being
+  // decoded. The one superblock row lag guarantees that the pixels read and
+  // modified by these tasks are no longer read by the intra prediction of the
+  // blocks being decoded. Must be called before any of the tiles start
+  // decoding. Returns false on failure.
+  LIBGAV1_MUST_USE_RESULT bool EnableFilterPipelining(int superblock_size4x4);
+  // Called by the Tile class whenever it finishes decoding the superblock row
+  // starting at |row4x4|. Does nothing if filter pipelining is not enabled.
+  void SignalSuperBlockRowDecoded(int row4x4);
+  // Stops running new pipelined tasks and waits until the tasks in flight (if
+  // any) are done. Must be called before the PostFilter object is destroyed
+  // if filter pipelining is enabled and ApplyFilteringThreaded() is not
+  // called.
+  void StopFilterPipelining();
+
   // Does the overall post processing filter for one superblock row starting at
   // |row4x4| with height 4*|sb4x4|. If |do_deblock| is false, deblocking filter
   // will not be applied.
@@ -251,6 +282,10 @@ class PostFilter {
   // Extend frame boundary for referencing if the frame will be saved as a
   // reference frame.
   void ExtendBordersForReferenceFrame();
+  // Same as above, but only for the rows starting at |row4x4_start| with a
+  // height of 4*|num_rows4x4|. The top and bottom borders are extended only if
+  // the rows include the first and the last row of the frame respectively.
+  void ExtendBordersForReferenceFrame(int row4x4_start, int num_rows4x4);
   // Copies the deblocked pixels needed for loop restoration.
   void CopyDeblockedPixels(Plane plane, int row4x4);
   // Copies the border for one superblock row. If |for_loop_restoration| is
@@ -289,12 +324,64 @@ class PostFilter {
     } while (--height != 0);
   }
 
-  // Worker function used for multi-threaded implementation of Deblocking, CDEF
-  // and Loop Restoration.
-  using WorkerFunction = void (PostFilter::*)(std::atomic<int>* row4x4_atomic);
-  // Schedules |worker| jobs to the |thread_pool_|, runs them in the calling
-  // thread and returns once all the jobs are completed.
-  void RunJobs(WorkerFunction worker);
+  // Functions for the multi-threaded post filter.
+
+  // The stages that each row of 64x64 loop filter units goes through in
+  // ApplyFilteringThreaded(), in the order in which they are applied. The
+  // stages that are not needed for the current frame are skipped.
+  enum FilterStage : uint8_t {
+    kFilterStageVerticalDeblock,
+    kFilterStageHorizontalDeblock,
+    // Sets up |cdef_border_| and (if loop restoration is on) the
+    // |loop_restoration_border_| from the deblocked pixels.
+    kFilterStageCdefBorder,
+    kFilterStageCdef,
+    // Saves the last row of the SuperRes input in |superres_line_buffer_|.
+    kFilterStageSuperResLineBuffer,
+    kFilterStageSuperRes,
+    // Sets up the |loop_restoration_border_| when CDEF is off.
+    kFilterStageLoopRestorationBorder,
+    // Loop restoration lags by 8 rows, so the task for unit row i covers the
+    // last 8 rows of unit row i-1 and all but the last 8 rows of unit row i.
+    // There is one more task than there are unit rows.
+    kFilterStageLoopRestoration,
+    kFilterStageBorderExtension,
+    kNumFilterStages
+  };
+  // Returns true if the task for |stage| and the unit row at |index| is done.
+  // Tasks of stages that are skipped and tasks that are out of the frame are
+  // considered to be done. Must be called with |filter_task_mutex_| held.
+  bool IsFilterTaskDone(FilterStage stage, int index) const;
+  // Returns true if all the tasks that the task for |stage| and the unit row
+  // at |index| depends on are done and the unit row is no longer used by tile
+  // decoding. Must be called with |filter_task_mutex_| held.
+  bool IsFilterTaskReady(FilterStage stage, int index) const;
+  // Picks the next task that is ready to run (preferring the later stages) and
+  // marks it as claimed. Returns false if there is no such task. Must be
+  // called with |filter_task_mutex_| held.
+  bool GetNextFilterTask(FilterStage* stage, int* index);
+  // Runs the task for |stage| and the unit row at |index|. |cdef_block| and
+  // |border_columns| are the per thread scratch buffers for CDEF.
+  void ApplyFilterTask(FilterStage stage, int index, uint16_t* cdef_block,
+                       uint8_t border_columns[2][kMaxPlanes][256]);
+  // Sets up the tasks of ApplyFilteringThreaded() for the current frame.
+  void InitFilterTasks();
+  // Returns the number of tasks that GetNextFilterTask() could claim one after
+  // the other right now, up to |max_count|. Must be called with
+  // |filter_task_mutex_| held.
+  int CountReadyFilterTasks(int max_count) const;
+  // Schedules up to |count| workers on |thread_pool_|, without exceeding its
+  // number of threads. |lock| must hold |filter_task_mutex_|. It is released
+  // while the workers are scheduled.
+  void ScheduleFilteringWorkers(int count, std::unique_lock<std::mutex>* lock);
+  // Worker function used by ApplyFilteringThreaded(). Runs the tasks as they
+  // become ready and returns once all the tasks have been claimed. If
+  // |scheduled| is true, the worker runs on |thread_pool_|: it returns as
+  // soon as no task is ready instead of waiting, and decrements
+  // |scheduled_workers_| on return. Only the thread that calls
+  // ApplyFilteringThreaded() waits for tasks, so the jobs on |thread_pool_|
+  // never block, even if the pool runs on a caller-owned executor.
+  void ApplyFilteringWorker(bool scheduled);
 
   // Functions for the Deblocking filter.
 
@@ -306,11 +393,11 @@ class PostFilter {
                                             int* step,
                                             int* filter_length) const;
   bool GetVerticalDeblockFilterEdgeInfo(int row4x4, int column4x4,
-                                        BlockParameters* const* bp_ptr,
+                                        const DeblockParameters* dp_ptr,
                                         uint8_t* level, int* step,
                                         int* filter_length) const;
   void GetVerticalDeblockFilterEdgeInfoUV(int column4x4,
-                                          BlockParameters* const* bp_ptr,
+                                          const DeblockParameters* dp_ptr,
                                           uint8_t* level_u, uint8_t* level_v,
                                           int* step, int* filter_length) const;
   void HorizontalDeblockFilter(int row4x4_start, int row4x4_end,
@@ -325,19 +412,6 @@ class PostFilter {
   static_assert(std::is_same<decltype(&PostFilter::VerticalDeblockFilter),
                              DeblockFilter>::value,
                 "");
-  // Worker function used for multi-threaded deblocking.
-  template <LoopFilterType loop_filter_type>
-  void DeblockFilterWorker(std::atomic<int>* row4x4_atomic);
-  static_assert(
-      std::is_same<
-          decltype(&PostFilter::DeblockFilterWorker<kLoopFilterTypeVertical>),
-          WorkerFunction>::value,
-      "");
-  static_assert(
-      std::is_same<
-          decltype(&PostFilter::DeblockFilterWorker<kLoopFilterTypeHorizontal>),
-          WorkerFunction>::value,
-      "");
 
   // Functions for the cdef filter.
 
@@ -370,11 +444,6 @@ class PostFilter {
   // Applies CDEF filtering for the superblock row starting at |row4x4| with a
   // height of 4*|sb4x4|.
   void ApplyCdefForOneSuperBlockRow(int row4x4, int sb4x4, bool is_last_row);
-  // Worker function used for multi-threaded CDEF.
-  void ApplyCdefWorker(std::atomic<int>* row4x4_atomic);
-  static_assert(std::is_same<decltype(&PostFilter::ApplyCdefWorker),
-                             WorkerFunction>::value,
-                "");
 
   // Functions for the SuperRes filter.
 
@@ -393,7 +462,12 @@ class PostFilter {
   // of 4*|sb4x4|.
   void ApplySuperResForOneSuperBlockRow(int row4x4, int sb4x4,
                                         bool is_last_row);
-  void ApplySuperResThreaded();
+  // Copies the last input row of the unit row starting at |row4x4| into
+  // |superres_line_buffer_|. Used by the multi-threaded SuperRes.
+  void SetupSuperResLineBuffer(int row4x4);
+  // Applies SuperRes for the unit row starting at |row4x4|. The last input row
+  // is read from |superres_line_buffer_|. Used by the multi-threaded SuperRes.
+  void ApplySuperResForOneUnitRow(int row4x4);
 
   // Functions for the Loop Restoration filter.
 
@@ -441,11 +515,6 @@ class PostFilter {
   // Helper function that calls the right variant of
   // ApplyLoopRestorationForOneSuperBlockRow based on the bitdepth.
   void ApplyLoopRestoration(int row4x4_start, int sb4x4);
-  // Worker function used for multithreaded Loop Restoration.
-  void ApplyLoopRestorationWorker(std::atomic<int>* row4x4_atomic);
-  static_assert(std::is_same<decltype(&PostFilter::ApplyLoopRestorationWorker),
-                             WorkerFunction>::value,
-                "");
 
   // The lookup table for picking the deblock filter, according to deblock
   // filter type.
@@ -485,10 +554,12 @@ class PostFilter {
   uint8_t* const superres_coefficients_[kNumPlaneTypes];
   // Line buffer used by multi-threaded ApplySuperRes().
   // In the multi-threaded case, this buffer will store the last downscaled row
-  // input of each thread to avoid overwrites by the first upscaled row output
-  // of the thread below it.
+  // input of each unit row to avoid overwrites by the first upscaled row output
+  // of the unit row below it.
   YuvBuffer& superres_line_buffer_;
   const BlockParametersHolder& block_parameters_;
+  // Stage timings of the frame (see FrameScratchBuffer::frame_stats).
+  FrameStatsCollector& frame_stats_;
   // Frame buffer to hold cdef filtered frame.
   YuvBuffer cdef_filtered_buffer_;
   // Input frame buffer.
@@ -520,6 +591,42 @@ class PostFilter {
   // Tracks the progress of the post filters.
   int progress_row_ = -1;
 
+  // The following members are used by ApplyFilteringThreaded().
+  std::mutex filter_task_mutex_;
+  // Notified whenever a task is done.
+  std::condition_variable filter_task_condvar_;
+  // |filter_task_state_[i]| is a bitmask of the stages that are done for the
+  // unit row at index i. The size of this buffer is the number of unit rows
+  // plus one.
+  DynamicBuffer<uint16_t>& filter_task_state_;
+  // Number of tasks (unit rows) for each stage. It is 0 for the stages that
+  // are skipped.
+  int filter_task_count_[kNumFilterStages] = {};
+  // Index of the next unit row to be claimed for each stage.
+  int next_filter_task_[kNumFilterStages] LIBGAV1_GUARDED_BY(
+      filter_task_mutex_) = {};
+  // Number of tasks that have not been claimed yet.
+  int pending_filter_tasks_ LIBGAV1_GUARDED_BY(filter_task_mutex_) = 0;
+  // Only the tasks for the unit rows above |decoded_unit_rows_| may be run.
+  // It is less than the number of unit rows only while the tiles are being
+  // decoded with filter pipelining.
+  int decoded_unit_rows_ LIBGAV1_GUARDED_BY(filter_task_mutex_) = 0;
+
+  // The following members are used for filter pipelining (see
+  // EnableFilterPipelining()). |superblock_row_progress_[i]| is incremented
+  // whenever a tile finishes decoding the superblock row at index i.
+  DynamicBuffer<int>& superblock_row_progress_;
+  bool filter_pipelining_ = false;
+  int superblock_size4x4_ = 0;
+  int superblock_rows_ = 0;
+  // Number of superblock rows (from the top of the frame) that have been
+  // decoded by all the tile columns.
+  int decoded_superblock_rows_ LIBGAV1_GUARDED_BY(filter_task_mutex_) = 0;
+  // Number of workers that have been scheduled on |thread_pool_| and have not
+  // returned yet.
+  int scheduled_workers_ LIBGAV1_GUARDED_BY(filter_task_mutex_) = 0;
+  bool filter_pipeline_stopped_ LIBGAV1_GUARDED_BY(filter_task_mutex_) = false;
+
   // A block buffer to hold the input that is converted to uint16_t before
   // cdef filtering. Only used in single threaded case. Y plane is processed
   // separately. U and V planes are processed together. So it is sufficient to
@@ -11,7 +11,7 @@
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
-#include <atomic>
+#include <cstring>
 
 #include "src/post_filter.h"
 
@@ -45,12 +45,10 @@ constexpr dsp::LoopFilterSize GetLoopFilterSizeUV(int filter_length) {
   return static_cast<dsp::LoopFilterSize>(filter_length != 4);
 }
 
-bool NonBlockBorderNeedsFilter(const BlockParameters& bp, int filter_id,
+bool NonBlockBorderNeedsFilter(const DeblockParameters& dp, int filter_id,
                                uint8_t* const level) {
-  if (bp.deblock_filter_level[filter_id] == 0 || (bp.skip && bp.is_inter)) {
-    return false;
-  }
-  *level = bp.deblock_filter_level[filter_id];
+  if (dp.filter_level[filter_id] == 0 || dp.skip_inter) return false;
+  *level = dp.filter_level[filter_id];
   return true;
 }
 
@@ -126,20 +124,21 @@ bool PostFilter::GetHorizontalDeblockFilterEdgeInfo(int row4x4, int column4x4,
   *step = kTransformHeight[inter_transform_sizes_[row4x4][column4x4]];
   if (row4x4 == 0) return false;
 
-  const BlockParameters* bp = block_parameters_.Find(row4x4, column4x4);
+  const DeblockParameters* const dp =
+      block_parameters_.DeblockParametersAddress(row4x4, column4x4);
   const int row4x4_prev = row4x4 - 1;
   assert(row4x4_prev >= 0);
-  const BlockParameters* bp_prev =
-      block_parameters_.Find(row4x4_prev, column4x4);
 
-  if (bp == bp_prev) {
+  if (dp->row_offset != 0) {
     // Not a border.
-    if (!NonBlockBorderNeedsFilter(*bp, 1, level)) return false;
+    if (!NonBlockBorderNeedsFilter(*dp, 1, level)) return false;
   } else {
-    const uint8_t level_this = bp->deblock_filter_level[1];
+    const uint8_t level_this = dp->filter_level[1];
     *level = level_this;
     if (level_this == 0) {
-      const uint8_t level_prev = bp_prev->deblock_filter_level[1];
+      const DeblockParameters* const dp_prev =
+          dp - block_parameters_.columns4x4();
+      const uint8_t level_prev = dp_prev->filter_level[1];
       if (level_prev == 0) return false;
       *level = level_prev;
     }
@@ -157,10 +156,11 @@ void PostFilter::GetHorizontalDeblockFilterEdgeInfoUV(
   const int subsampling_y = subsampling_y_[kPlaneU];
   row4x4 = GetDeblockPosition(row4x4, subsampling_y);
   column4x4 = GetDeblockPosition(column4x4, subsampling_x);
-  const BlockParameters* bp = block_parameters_.Find(row4x4, column4x4);
+  const DeblockParameters* const dp =
+      block_parameters_.DeblockParametersAddress(row4x4, column4x4);
   *level_u = 0;
   *level_v = 0;
-  *step = kTransformHeight[bp->uv_transform_size];
+  *step = kTransformHeight[dp->uv_transform_size];
   if (row4x4 == subsampling_y) {
     return;
   }
@@ -172,64 +172,62 @@ void PostFilter::GetHorizontalDeblockFilterEdgeInfoUV(
       kDeblockFilterLevelIndex[kPlaneU][kLoopFilterTypeHorizontal];
   const int filter_id_v =
       kDeblockFilterLevelIndex[kPlaneV][kLoopFilterTypeHorizontal];
-  const int row4x4_prev = row4x4 - (1 << subsampling_y);
-  assert(row4x4_prev >= 0);
-  const BlockParameters* bp_prev =
-      block_parameters_.Find(row4x4_prev, column4x4);
+  assert(row4x4 - (1 << subsampling_y) >= 0);
 
-  if (bp == bp_prev) {
+  if (dp->row_offset >= (1 << subsampling_y)) {
     // Not a border.
-    const bool skip = bp->skip && bp->is_inter;
+    const bool skip = dp->skip_inter;
     need_filter_u =
-        need_filter_u && bp->deblock_filter_level[filter_id_u] != 0 && !skip;
+        need_filter_u && dp->filter_level[filter_id_u] != 0 && !skip;
     need_filter_v =
-        need_filter_v && bp->deblock_filter_level[filter_id_v] != 0 && !skip;
+        need_filter_v && dp->filter_level[filter_id_v] != 0 && !skip;
     if (!need_filter_u && !need_filter_v) return;
-    if (need_filter_u) *level_u = bp->deblock_filter_level[filter_id_u];
-    if (need_filter_v) *level_v = bp->deblock_filter_level[filter_id_v];
+    if (need_filter_u) *level_u = dp->filter_level[filter_id_u];
+    if (need_filter_v) *level_v = dp->filter_level[filter_id_v];
     *filter_length = *step;
     return;
   }
 
   // It is a border.
+  const DeblockParameters* const dp_prev =
+      dp - (block_parameters_.columns4x4() << subsampling_y);
   if (need_filter_u) {
-    const uint8_t level_u_this = bp->deblock_filter_level[filter_id_u];
+    const uint8_t level_u_this = dp->filter_level[filter_id_u];
     *level_u = level_u_this;
     if (level_u_this == 0) {
-      *level_u = bp_prev->deblock_filter_level[filter_id_u];
+      *level_u = dp_prev->filter_level[filter_id_u];
     }
   }
   if (need_filter_v) {
-    const uint8_t level_v_this = bp->deblock_filter_level[filter_id_v];
+    const uint8_t level_v_this = dp->filter_level[filter_id_v];
     *level_v = level_v_this;
     if (level_v_this == 0) {
-      *level_v = bp_prev->deblock_filter_level[filter_id_v];
+      *level_v = dp_prev->filter_level[filter_id_v];
     }
   }
-  const int step_prev = kTransformHeight[bp_prev->uv_transform_size];
+  const int step_prev = kTransformHeight[dp_prev->uv_transform_size];
   *filter_length = std::min(*step, step_prev);
 }
 
 bool PostFilter::GetVerticalDeblockFilterEdgeInfo(
-    int row4x4, int column4x4, BlockParameters* const* bp_ptr, uint8_t* level,
-    int* step, int* filter_length) const {
-  const BlockParameters* bp = *bp_ptr;
+    int row4x4, int column4x4, const DeblockParameters* const dp_ptr,
+    uint8_t* level, int* step, int* filter_length) const {
+  const DeblockParameters& dp = *dp_ptr;
   *step = kTransformWidth[inter_transform_sizes_[row4x4][column4x4]];
   if (column4x4 == 0) return false;
 
   const int filter_id = 0;
   const int column4x4_prev = column4x4 - 1;
   assert(column4x4_prev >= 0);
-  const BlockParameters* bp_prev = *(bp_ptr - 1);
-  if (bp == bp_prev) {
+  if (dp.column_offset != 0) {
     // Not a border.
-    if (!NonBlockBorderNeedsFilter(*bp, filter_id, level)) return false;
+    if (!NonBlockBorderNeedsFilter(dp, filter_id, level)) return false;
   } else {
     // It is a border.
-    const uint8_t level_this = bp->deblock_filter_level[filter_id];
+    const uint8_t level_this = dp.filter_level[filter_id];
     *level = level_this;
     if (level_this == 0) {
-      const uint8_t level_prev = bp_prev->deblock_filter_level[filter_id];
+      const uint8_t level_prev = (dp_ptr - 1)->filter_level[filter_id];
       if (level_prev == 0) return false;
       *level = level_prev;
     }
@@ -241,14 +239,13 @@ bool PostFilter::GetVerticalDeblockFilterEdgeInfo(
 }
 
 void PostFilter::GetVerticalDeblockFilterEdgeInfoUV(
-    int column4x4, BlockParameters* const* bp_ptr, uint8_t* level_u,
+    int column4x4, const DeblockParameters* const dp, uint8_t* level_u,
     uint8_t* level_v, int* step, int* filter_length) const {
   const int subsampling_x = subsampling_x_[kPlaneU];
   column4x4 = GetDeblockPosition(column4x4, subsampling_x);
-  const BlockParameters* bp = *bp_ptr;
   *level_u = 0;
   *level_v = 0;
-  *step = kTransformWidth[bp->uv_transform_size];
+  *step = kTransformWidth[dp->uv_transform_size];
   if (column4x4 == subsampling_x) {
     return;
   }
@@ -260,38 +257,37 @@ void PostFilter::GetVerticalDeblockFilterEdgeInfoUV(
       kDeblockFilterLevelIndex[kPlaneU][kLoopFilterTypeVertical];
   const int filter_id_v =
       kDeblockFilterLevelIndex[kPlaneV][kLoopFilterTypeVertical];
-  const BlockParameters* bp_prev = *(bp_ptr - (ptrdiff_t{1} << subsampling_x));
-
-  if (bp == bp_prev) {
+  if (dp->column_offset >= (1 << subsampling_x)) {
     // Not a border.
-    const bool skip = bp->skip && bp->is_inter;
+    const bool skip = dp->skip_inter;
     need_filter_u =
-        need_filter_u && bp->deblock_filter_level[filter_id_u] != 0 && !skip;
+        need_filter_u && dp->filter_level[filter_id_u] != 0 && !skip;
     need_filter_v =
-        need_filter_v && bp->deblock_filter_level[filter_id_v] != 0 && !skip;
+        need_filter_v && dp->filter_level[filter_id_v] != 0 && !skip;
     if (!need_filter_u && !need_filter_v) return;
-    if (need_filter_u) *level_u = bp->deblock_filter_level[filter_id_u];
-    if (need_filter_v) *level_v = bp->deblock_filter_level[filter_id_v];
+    if (need_filter_u) *level_u = dp->filter_level[filter_id_u];
+    if (need_filter_v) *level_v = dp->filter_level[filter_id_v];
     *filter_length = *step;
     return;
   }
 
   // It is a border.
+  const DeblockParameters* const dp_prev = dp - (1 << subsampling_x);
   if (need_filter_u) {
-    const uint8_t level_u_this = bp->deblock_filter_level[filter_id_u];
+    const uint8_t level_u_this = dp->filter_level[filter_id_u];
     *level_u = level_u_this;
     if (level_u_this == 0) {
-      *level_u = bp_prev->deblock_filter_level[filter_id_u];
+      *level_u = dp_prev->filter_level[filter_id_u];
     }
   }
   if (need_filter_v) {
-    const uint8_t level_v_this = bp->deblock_filter_level[filter_id_v];
+    const uint8_t level_v_this = dp->filter_level[filter_id_v];
     *level_v = level_v_this;
     if (level_v_this == 0) {
-      *level_v = bp_prev->deblock_filter_level[filter_id_v];
+      *level_v = dp_prev->filter_level[filter_id_v];
     }
   }
-  const int step_prev = kTransformWidth[bp_prev->uv_transform_size];
+  const int step_prev = kTransformWidth[dp_prev->uv_transform_size];
   *filter_length = std::min(*step, step_prev);
 }
 
@@ -301,6 +297,7 @@ void PostFilter::HorizontalDeblockFilter(int row4x4_start, int row4x4_end,
   const int height4x4 = row4x4_end - row4x4_start;
   const int width4x4 = column4x4_end - column4x4_start;
   if (height4x4 <= 0 || width4x4 <= 0) return;
+  ScopedFrameStageTimer timer(&frame_stats_, kFrameStageDeblock);
 
   const int column_step = 1;
   const int src_step = 4 << pixel_size_log2_;
@@ -383,6 +380,7 @@ void PostFilter::VerticalDeblockFilter(int row4x4_start, int row4x4_end,
   const int height4x4 = row4x4_end - row4x4_start;
   const int width4x4 = column4x4_end - column4x4_start;
   if (height4x4 <= 0 || width4x4 <= 0) return;
+  ScopedFrameStageTimer timer(&frame_stats_, kFrameStageDeblock);
 
   const ptrdiff_t row_stride = MultiplyBy4(frame_buffer_.stride(kPlaneY));
   const ptrdiff_t src_stride = frame_buffer_.stride(kPlaneY);
@@ -391,22 +389,23 @@ void PostFilter::VerticalDeblockFilter(int row4x4_start, int row4x4_end,
   uint8_t level;
   int filter_length;
 
-  BlockParameters* const* bp_row_base =
-      block_parameters_.Address(row4x4_start, column4x4_start);
-  const int bp_stride = block_parameters_.columns4x4();
+  const DeblockParameters* dp_row_base =
+      block_parameters_.DeblockParametersAddress(row4x4_start,
+                                                 column4x4_start);
+  const int dp_stride = block_parameters_.columns4x4();
   const int column_step_shift = pixel_size_log2_;
   const int width = frame_header_.width;
   const int height = frame_header_.height;
   for (int row4x4 = 0;
        row4x4 < height4x4 && MultiplyBy4(row4x4_start + row4x4) < height;
-       ++row4x4, src += row_stride, bp_row_base += bp_stride) {
+       ++row4x4, src += row_stride, dp_row_base += dp_stride) {
     uint8_t* src_row = src;
-    BlockParameters* const* bp = bp_row_base;
+    const DeblockParameters* dp = dp_row_base;
     for (int column4x4 = 0; column4x4 < width4x4 &&
                             MultiplyBy4(column4x4_start + column4x4) < width;
-         column4x4 += column_step, bp += column_step) {
+         column4x4 += column_step, dp += column_step) {
       const bool need_filter = GetVerticalDeblockFilterEdgeInfo(
-          row4x4_start + row4x4, column4x4_start + column4x4, bp, &level,
+          row4x4_start + row4x4, column4x4_start + column4x4, dp, &level,
           &column_step, &filter_length);
       if (need_filter) {
         assert(level > 0 && level <= kMaxLoopFilterValue);
@@ -436,21 +435,22 @@ void PostFilter::VerticalDeblockFilter(int row4x4_start, int row4x4_end,
     uint8_t level_v;
     int filter_length;
 
-    BlockParameters* const* bp_row_base = block_parameters_.Address(
-        GetDeblockPosition(row4x4_start, subsampling_y),
-        GetDeblockPosition(column4x4_start, subsampling_x));
-    const int bp_stride = block_parameters_.columns4x4() << subsampling_y;
+    const DeblockParameters* dp_row_base =
+        block_parameters_.DeblockParametersAddress(
+            GetDeblockPosition(row4x4_start, subsampling_y),
+            GetDeblockPosition(column4x4_start, subsampling_x));
+    const int dp_stride = block_parameters_.columns4x4() << subsampling_y;
     for (int row4x4 = 0;
          row4x4 < height4x4 && MultiplyBy4(row4x4_start + row4x4) < height;
          row4x4 += row_step, src_u += row_stride_u, src_v += row_stride_v,
-             bp_row_base += bp_stride) {
+             dp_row_base += dp_stride) {
       uint8_t* src_row_u = src_u;
       uint8_t* src_row_v = src_v;
-      BlockParameters* const* bp = bp_row_base;
+      const DeblockParameters* dp = dp_row_base;
       for (int column4x4 = 0; column4x4 < width4x4 &&
                               MultiplyBy4(column4x4_start + column4x4) < width;
-           column4x4 += column_step, bp += column_step) {
-        GetVerticalDeblockFilterEdgeInfoUV(column4x4_start + column4x4, bp,
+           column4x4 += column_step, dp += column_step) {
+        GetVerticalDeblockFilterEdgeInfoUV(column4x4_start + column4x4, dp,
                                            &level_u, &level_v, &column_step,
                                            &filter_length);
         if (level_u != 0) {
@@ -473,23 +473,6 @@ void PostFilter::VerticalDeblockFilter(int row4x4_start, int row4x4_end,
   }
 }
 
-template <LoopFilterType loop_filter_type>
-void PostFilter::DeblockFilterWorker(std::atomic<int>* row4x4_atomic) {
-  const int rows4x4 = frame_header_.rows4x4;
-  const int columns4x4 = frame_header_.columns4x4;
-  int row4x4;
-  while ((row4x4 = row4x4_atomic->fetch_add(
-              kNum4x4InLoopFilterUnit, std::memory_order_relaxed)) < rows4x4) {
-    (this->*deblock_filter_func_[loop_filter_type])(
-        row4x4, row4x4 + kNum4x4InLoopFilterUnit, 0, columns4x4);
-  }
-}
-
-template void PostFilter::DeblockFilterWorker<kLoopFilterTypeVertical>(
-    std::atomic<int>* row4x4_atomic);
-template void PostFilter::DeblockFilterWorker<kLoopFilterTypeHorizontal>(
-    std::atomic<int>* row4x4_atomic);
-
 void PostFilter::ApplyDeblockFilter(LoopFilterType loop_filter_type,
                                     int row4x4_start, int column4x4_start,
                                     int column4x4_end, int sb4x4) {
@@ -148,6 +148,7 @@ void PostFilter::ApplyLoopRestorationForOneSuperBlockRow(const int row4x4_start,
 }
 
 void PostFilter::ApplyLoopRestoration(const int row4x4_start, const int sb4x4) {
+  ScopedFrameStageTimer timer(&frame_stats_, kFrameStageLoopRestoration);
 #if LIBGAV1_MAX_BITDEPTH >= 10
   if (bitdepth_ >= 10) {
     ApplyLoopRestorationForOneSuperBlockRow<uint16_t>(row4x4_start, sb4x4);
@@ -157,28 +158,4 @@ void PostFilter::ApplyLoopRestoration(const int row4x4_start, const int sb4x4) {
   ApplyLoopRestorationForOneSuperBlockRow<uint8_t>(row4x4_start, sb4x4);
 }
 
-void PostFilter::ApplyLoopRestorationWorker(std::atomic<int>* row4x4_atomic) {
-  int row4x4;
-  // Loop Restoration operates with a lag of 8 rows (4 for chroma with
-  // subsampling) and hence we need to make sure to cover the last 8 rows of the
-  // last superblock row. So we run this loop for an extra iteration to
-  // accomplish that.
-  const int row4x4_end = frame_header_.rows4x4 + kNum4x4InLoopRestorationUnit;
-  while ((row4x4 = row4x4_atomic->fetch_add(kNum4x4InLoopRestorationUnit,
-                                            std::memory_order_relaxed)) <
-         row4x4_end) {
-    CopyBordersForOneSuperBlockRow(row4x4, kNum4x4InLoopRestorationUnit,
-                                   /*for_loop_restoration=*/true);
-#if LIBGAV1_MAX_BITDEPTH >= 10
-    if (bitdepth_ >= 10) {
-      ApplyLoopRestorationForOneSuperBlockRow<uint16_t>(
-          row4x4, kNum4x4InLoopRestorationUnit);
-      continue;
-    }
-#endif
-    ApplyLoopRestorationForOneSuperBlockRow<uint8_t>(
-        row4x4, kNum4x4InLoopRestorationUnit);
-  }
-}
-
 }  // namespace libgav1
@@ -15,16 +15,15 @@
 #include "src/post_filter.h"
 
 #include <algorithm>
-#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <mutex>  // NOLINT (unapproved c++11 header)
 
 #include "src/dsp/constants.h"
 #include "src/dsp/dsp.h"
 #include "src/utils/array_2d.h"
-#include "src/utils/blocking_counter.h"
 #include "src/utils/common.h"
 #include "src/utils/compiler_attributes.h"
 #include "src/utils/constants.h"
@@ -86,11 +85,14 @@ PostFilter::PostFilter(const ObuFrameHeader& frame_header,
               .get()},
       superres_line_buffer_(frame_scratch_buffer->superres_line_buffer),
       block_parameters_(frame_scratch_buffer->block_parameters_holder),
+      frame_stats_(frame_scratch_buffer->frame_stats),
       frame_buffer_(*frame_buffer),
       cdef_border_(frame_scratch_buffer->cdef_border),
       loop_restoration_border_(frame_scratch_buffer->loop_restoration_border),
       thread_pool_(
-          frame_scratch_buffer->threading_strategy.post_filter_thread_pool()) {
+          frame_scratch_buffer->threading_strategy.post_filter_thread_pool()),
+      filter_task_state_(frame_scratch_buffer->post_filter_task_state),
+      superblock_row_progress_(frame_scratch_buffer->superblock_row_progress) {
   const int8_t zero_delta_lf[kFrameLfCount] = {};
   ComputeDeblockFilterLevels(zero_delta_lf, deblock_filter_levels_);
   if (DoSuperRes()) {
@@ -281,6 +283,11 @@ void PostFilter::ExtendFrameBoundary(uint8_t* const frame_start,
 }
 
 void PostFilter::ExtendBordersForReferenceFrame() {
+  ExtendBordersForReferenceFrame(0, frame_header_.rows4x4);
+}
+
+void PostFilter::ExtendBordersForReferenceFrame(int row4x4_start,
+                                                int num_rows4x4) {
   if (frame_header_.refresh_frame_flags == 0) return;
   const int upscaled_width = frame_header_.upscaled_width;
   const int height = frame_header_.height;
@@ -289,6 +296,11 @@ void PostFilter::ExtendBordersForReferenceFrame() {
     const int plane_width =
         SubsampledValue(upscaled_width, subsampling_x_[plane]);
     const int plane_height = SubsampledValue(height, subsampling_y_[plane]);
+    const int row_start = MultiplyBy4(row4x4_start) >> subsampling_y_[plane];
+    const int row_end = std::min(
+        MultiplyBy4(row4x4_start + num_rows4x4) >> subsampling_y_[plane],
+        plane_height);
+    if (row_start >= row_end) continue;
     assert(frame_buffer_.left_border(plane) >= kMinLeftBorderPixels &&
            frame_buffer_.right_border(plane) >= kMinRightBorderPixels &&
            frame_buffer_.top_border(plane) >= kMinTopBorderPixels &&
@@ -301,11 +313,13 @@ void PostFilter::ExtendBordersForReferenceFrame() {
     // The |left| argument to ExtendFrameBoundary() must be at least
     // kMinLeftBorderPixels (13) for warp.
     static_assert(16 >= kMinLeftBorderPixels, "");
+    const ptrdiff_t stride = frame_buffer_.stride(plane);
     ExtendFrameBoundary(
-        frame_buffer_.data(plane), plane_width, plane_height,
-        frame_buffer_.stride(plane), frame_buffer_.left_border(plane),
-        frame_buffer_.right_border(plane), frame_buffer_.top_border(plane),
-        frame_buffer_.bottom_border(plane));
+        frame_buffer_.data(plane) + row_start * stride, plane_width,
+        row_end - row_start, stride, frame_buffer_.left_border(plane),
+        frame_buffer_.right_border(plane),
+        (row_start == 0) ? frame_buffer_.top_border(plane) : 0,
+        (row_end == plane_height) ? frame_buffer_.bottom_border(plane) : 0);
   } while (++plane < planes_);
 }
 
@@ -556,52 +570,309 @@ void PostFilter::SetupLoopRestorationBorder(int row4x4_start, int sb4x4) {
   }
 }
 
-void PostFilter::RunJobs(WorkerFunction worker) {
-  std::atomic<int> row4x4(0);
-  const int num_workers = thread_pool_->num_threads();
-  BlockingCounter pending_workers(num_workers);
-  for (int i = 0; i < num_workers; ++i) {
-    thread_pool_->Schedule([this, &row4x4, &pending_workers, worker]() {
-      (this->*worker)(&row4x4);
-      pending_workers.Decrement();
-    });
-  }
-  // Run the jobs on the current thread.
-  (this->*worker)(&row4x4);
-  // Wait for the threadpool jobs to finish.
-  pending_workers.Wait();
+bool PostFilter::IsFilterTaskDone(FilterStage stage, int index) const {
+  if (index < 0 || index >= filter_task_count_[stage]) return true;
+  return (filter_task_state_.get()[index] & (1 << stage)) != 0;
 }
 
-void PostFilter::ApplyFilteringThreaded() {
-  if (DoDeblock()) {
-    RunJobs(&PostFilter::DeblockFilterWorker<kLoopFilterTypeVertical>);
-    RunJobs(&PostFilter::DeblockFilterWorker<kLoopFilterTypeHorizontal>);
+bool PostFilter::IsFilterTaskReady(FilterStage stage, int index) const {
+  // The tasks for the unit row at |index| read and modify the pixels of the
+  // unit rows at |index| - 1 and |index| only.
+  if (index >= decoded_unit_rows_) return false;
+  // Returns true if the pixels of the unit row at |i| are ready to be used as
+  // the input of loop restoration, i.e. the preceding filters are done.
+  const auto is_filtered = [this](int i) {
+    return IsFilterTaskDone(kFilterStageHorizontalDeblock, i) &&
+           IsFilterTaskDone(kFilterStageHorizontalDeblock, i + 1) &&
+           IsFilterTaskDone(kFilterStageCdef, i) &&
+           IsFilterTaskDone(kFilterStageSuperRes, i);
+  };
+  switch (stage) {
+    case kFilterStageVerticalDeblock:
+      return true;
+    case kFilterStageHorizontalDeblock:
+      // The horizontal edges at the top of the unit row modify the bottom rows
+      // of the unit row above it.
+      return IsFilterTaskDone(kFilterStageVerticalDeblock, index - 1) &&
+             IsFilterTaskDone(kFilterStageVerticalDeblock, index);
+    case kFilterStageCdefBorder:
+      // The bottom rows of the unit row are modified by the horizontal
+      // deblocking of the unit row below it.
+      return IsFilterTaskDone(kFilterStageHorizontalDeblock, index) &&
+             IsFilterTaskDone(kFilterStageHorizontalDeblock, index + 1);
+    case kFilterStageCdef:
+      // CDEF is done in-place. The rows above and below the unit row are read
+      // from |cdef_border_|.
+      return IsFilterTaskDone(kFilterStageCdefBorder, index - 1) &&
+             IsFilterTaskDone(kFilterStageCdefBorder, index) &&
+             IsFilterTaskDone(kFilterStageCdefBorder, index + 1);
+    case kFilterStageSuperResLineBuffer:
+      return IsFilterTaskDone(kFilterStageHorizontalDeblock, index) &&
+             IsFilterTaskDone(kFilterStageHorizontalDeblock, index + 1) &&
+             IsFilterTaskDone(kFilterStageCdef, index);
+    case kFilterStageSuperRes:
+      // The first output row of the unit row overwrites the last input row of
+      // the unit row above it.
+      return IsFilterTaskDone(kFilterStageSuperResLineBuffer, index - 1) &&
+             IsFilterTaskDone(kFilterStageSuperResLineBuffer, index);
+    case kFilterStageLoopRestorationBorder:
+      return is_filtered(index);
+    case kFilterStageLoopRestoration:
+      return is_filtered(index - 1) && is_filtered(index) &&
+             IsFilterTaskDone(kFilterStageLoopRestorationBorder, index - 1) &&
+             IsFilterTaskDone(kFilterStageLoopRestorationBorder, index);
+    case kFilterStageBorderExtension:
+      // The right border of the frame overlaps with the input of loop
+      // restoration (which is shifted to the right).
+      return is_filtered(index) &&
+             IsFilterTaskDone(kFilterStageLoopRestoration, index) &&
+             IsFilterTaskDone(kFilterStageLoopRestoration, index + 1);
+    case kNumFilterStages:
+      break;
   }
-  if (DoCdef() && DoRestoration()) {
-    for (int row4x4 = 0; row4x4 < frame_header_.rows4x4;
-         row4x4 += kNum4x4InLoopFilterUnit) {
-      SetupLoopRestorationBorder(row4x4, kNum4x4InLoopFilterUnit);
+  assert(false);
+  return false;
+}
+
+bool PostFilter::GetNextFilterTask(FilterStage* const stage,
+                                   int* const index) {
+  // Prefer the later stages so that the unit rows are finished while their
+  // pixels are still in the cache.
+  for (int i = kNumFilterStages - 1; i >= 0; --i) {
+    const auto current_stage = static_cast<FilterStage>(i);
+    const int current_index = next_filter_task_[current_stage];
+    if (current_index < filter_task_count_[current_stage] &&
+        IsFilterTaskReady(current_stage, current_index)) {
+      ++next_filter_task_[current_stage];
+      --pending_filter_tasks_;
+      *stage = current_stage;
+      *index = current_index;
+      return true;
     }
   }
-  if (DoCdef()) {
-    for (int row4x4 = 0; row4x4 < frame_header_.rows4x4;
-         row4x4 += kNum4x4InLoopFilterUnit) {
+  return false;
+}
+
+void PostFilter::ApplyFilterTask(FilterStage stage, int index,
+                                 uint16_t* cdef_block,
+                                 uint8_t border_columns[2][kMaxPlanes][256]) {
+  const int row4x4 = MultiplyBy16(index);
+  switch (stage) {
+    case kFilterStageVerticalDeblock:
+      VerticalDeblockFilter(row4x4, row4x4 + kNum4x4InLoopFilterUnit, 0,
+                            frame_header_.columns4x4);
+      break;
+    case kFilterStageHorizontalDeblock:
+      HorizontalDeblockFilter(row4x4, row4x4 + kNum4x4InLoopFilterUnit, 0,
+                              frame_header_.columns4x4);
+      break;
+    case kFilterStageCdefBorder:
+      if (DoRestoration()) {
+        SetupLoopRestorationBorder(row4x4, kNum4x4InLoopFilterUnit);
+      }
       SetupCdefBorder(row4x4);
+      break;
+    case kFilterStageCdef:
+      ApplyCdefForOneSuperBlockRowHelper(
+          cdef_block, border_columns, row4x4,
+          std::min(static_cast<int>(kNum4x4InLoopFilterUnit),
+                   frame_header_.rows4x4 - row4x4));
+      break;
+    case kFilterStageSuperResLineBuffer:
+      SetupSuperResLineBuffer(row4x4);
+      break;
+    case kFilterStageSuperRes:
+      ApplySuperResForOneUnitRow(row4x4);
+      break;
+    case kFilterStageLoopRestorationBorder:
+      SetupLoopRestorationBorder(row4x4);
+      break;
+    case kFilterStageLoopRestoration:
+      CopyBordersForOneSuperBlockRow(row4x4, kNum4x4InLoopRestorationUnit,
+                                     /*for_loop_restoration=*/true);
+      ApplyLoopRestoration(row4x4, kNum4x4InLoopRestorationUnit);
+      break;
+    case kFilterStageBorderExtension:
+      ExtendBordersForReferenceFrame(row4x4, kNum4x4InLoopFilterUnit);
+      break;
+    case kNumFilterStages:
+      assert(false);
+      break;
+  }
+}
+
+void PostFilter::InitFilterTasks() {
+  const int unit_rows =
+      DivideBy16(frame_header_.rows4x4 + kNum4x4InLoopFilterUnit - 1);
+  assert(filter_task_state_.size() >= static_cast<size_t>(unit_rows + 1));
+  filter_task_count_[kFilterStageVerticalDeblock] =
+      DoDeblock() ? unit_rows : 0;
+  filter_task_count_[kFilterStageHorizontalDeblock] =
+      DoDeblock() ? unit_rows : 0;
+  filter_task_count_[kFilterStageCdefBorder] = DoCdef() ? unit_rows : 0;
+  filter_task_count_[kFilterStageCdef] = DoCdef() ? unit_rows : 0;
+  filter_task_count_[kFilterStageSuperResLineBuffer] =
+      DoSuperRes() ? unit_rows : 0;
+  filter_task_count_[kFilterStageSuperRes] = DoSuperRes() ? unit_rows : 0;
+  filter_task_count_[kFilterStageLoopRestorationBorder] =
+      (DoRestoration() && !DoCdef()) ? unit_rows : 0;
+  filter_task_count_[kFilterStageLoopRestoration] =
+      DoRestoration() ? unit_rows + 1 : 0;
+  filter_task_count_[kFilterStageBorderExtension] =
+      (frame_header_.refresh_frame_flags != 0) ? unit_rows : 0;
+  memset(filter_task_state_.get(), 0,
+         (unit_rows + 1) * sizeof(filter_task_state_.get()[0]));
+  std::lock_guard<std::mutex> lock(filter_task_mutex_);
+  pending_filter_tasks_ = 0;
+  for (int i = 0; i < kNumFilterStages; ++i) {
+    next_filter_task_[i] = 0;
+    pending_filter_tasks_ += filter_task_count_[i];
+  }
+  // All the unit rows (and the extra loop restoration task) may be filtered
+  // unless the filters are pipelined with tile decoding.
+  decoded_unit_rows_ = filter_pipelining_ ? 0 : unit_rows + 1;
+}
+
+int PostFilter::CountReadyFilterTasks(int max_count) const {
+  int count = 0;
+  for (int i = 0; i < kNumFilterStages && count < max_count; ++i) {
+    const auto stage = static_cast<FilterStage>(i);
+    const int index = next_filter_task_[stage];
+    if (index < filter_task_count_[stage] && IsFilterTaskReady(stage, index)) {
+      ++count;
     }
-    RunJobs(&PostFilter::ApplyCdefWorker);
   }
-  if (DoSuperRes()) ApplySuperResThreaded();
-  if (DoRestoration()) {
-    if (!DoCdef()) {
-      int row4x4 = 0;
-      do {
-        SetupLoopRestorationBorder(row4x4);
-        row4x4 += kNum4x4InLoopFilterUnit;
-      } while (row4x4 < frame_header_.rows4x4);
+  return count;
+}
+
+void PostFilter::ScheduleFilteringWorkers(
+    int count, std::unique_lock<std::mutex>* const lock) {
+  count = std::min(count, thread_pool_->num_threads() - scheduled_workers_);
+  if (count <= 0 || filter_pipeline_stopped_ || pending_filter_tasks_ == 0) {
+    return;
+  }
+  scheduled_workers_ += count;
+  // Schedule() may run the worker on this thread, so |lock| is released.
+  lock->unlock();
+  for (int i = 0; i < count; ++i) {
+    thread_pool_->Schedule(
+        [this]() { ApplyFilteringWorker(/*scheduled=*/true); });
+  }
+  lock->lock();
+}
+
+void PostFilter::ApplyFilteringWorker(bool scheduled) {
+  uint16_t cdef_block[kCdefUnitSizeWithBorders * kCdefUnitSizeWithBorders * 2];
+  // Each border_column buffer has to store 64 rows and 2 columns for each
+  // plane. For 10bit, that is 64*2*2 = 256 bytes.
+  alignas(kMaxAlignment) uint8_t border_columns[2][kMaxPlanes][256];
+  std::unique_lock<std::mutex> lock(filter_task_mutex_);
+  while (pending_filter_tasks_ > 0 && !filter_pipeline_stopped_) {
+    FilterStage stage;
+    int index;
+    if (!GetNextFilterTask(&stage, &index)) {
+      // A scheduled worker does not hold its thread (which may belong to a
+      // caller-owned executor) while it waits. Another worker is scheduled
+      // when a task becomes ready.
+      if (scheduled) break;
+      ScopedFrameStageTimer timer(&frame_stats_, kFrameStageThreadStall);
+      filter_task_condvar_.wait(lock);
+      continue;
     }
-    RunJobs(&PostFilter::ApplyLoopRestorationWorker);
+    lock.unlock();
+    ApplyFilterTask(stage, index, cdef_block, border_columns);
+    lock.lock();
+    filter_task_state_.get()[index] |= 1 << stage;
+    filter_task_condvar_.notify_all();
+    // This worker runs one of the tasks that are ready. The others are given
+    // to new workers.
+    ScheduleFilteringWorkers(CountReadyFilterTasks(kNumFilterStages) - 1,
+                             &lock);
+  }
+  if (scheduled) {
+    --scheduled_workers_;
+    // Notify while holding the lock since the PostFilter object may be
+    // destroyed as soon as the scheduled workers are done.
+    filter_task_condvar_.notify_all();
+  }
+}
+
+void PostFilter::ApplyFilteringThreaded() {
+  if (filter_pipelining_) {
+    // All the tiles have been decoded. The tasks that have not been run in the
+    // pipeline are run below.
+    std::lock_guard<std::mutex> lock(filter_task_mutex_);
+    decoded_superblock_rows_ = superblock_rows_;
+    decoded_unit_rows_ =
+        DivideBy16(frame_header_.rows4x4 + kNum4x4InLoopFilterUnit - 1) + 1;
+  } else {
+    InitFilterTasks();
+  }
+  {
+    std::unique_lock<std::mutex> lock(filter_task_mutex_);
+    ScheduleFilteringWorkers(CountReadyFilterTasks(kNumFilterStages), &lock);
+  }
+  // Run the tasks on the current thread. This is the only worker that waits
+  // for the tasks to become ready.
+  ApplyFilteringWorker(/*scheduled=*/false);
+  // Wait for the scheduled workers that may still be running a task.
+  std::unique_lock<std::mutex> lock(filter_task_mutex_);
+  if (scheduled_workers_ > 0) {
+    ScopedFrameStageTimer timer(&frame_stats_, kFrameStageThreadStall);
+    do {
+      filter_task_condvar_.wait(lock);
+    } while (scheduled_workers_ > 0);
+  }
+}
+
+bool PostFilter::EnableFilterPipelining(int superblock_size4x4) {
+  assert(thread_pool_ != nullptr);
+  superblock_size4x4_ = superblock_size4x4;
+  superblock_rows_ =
+      (frame_header_.rows4x4 + superblock_size4x4 - 1) / superblock_size4x4;
+  if (!superblock_row_progress_.Resize(superblock_rows_)) return false;
+  memset(superblock_row_progress_.get(), 0,
+         superblock_rows_ * sizeof(superblock_row_progress_.get()[0]));
+  filter_pipelining_ = true;
+  InitFilterTasks();
+  std::lock_guard<std::mutex> lock(filter_task_mutex_);
+  decoded_superblock_rows_ = 0;
+  scheduled_workers_ = 0;
+  filter_pipeline_stopped_ = false;
+  return true;
+}
+
+void PostFilter::SignalSuperBlockRowDecoded(int row4x4) {
+  if (!filter_pipelining_) return;
+  std::unique_lock<std::mutex> lock(filter_task_mutex_);
+  int* const progress = superblock_row_progress_.get();
+  ++progress[row4x4 / superblock_size4x4_];
+  const int tile_columns = frame_header_.tile_info.tile_columns;
+  const int decoded_superblock_rows = decoded_superblock_rows_;
+  while (decoded_superblock_rows_ < superblock_rows_ &&
+         progress[decoded_superblock_rows_] == tile_columns) {
+    ++decoded_superblock_rows_;
+  }
+  if (decoded_superblock_rows_ == decoded_superblock_rows) return;
+  // The bottom row of pixels of the last decoded superblock row is still
+  // needed for the intra prediction of the superblock row below it. The unit
+  // rows of the last superblock row are left to ApplyFilteringThreaded().
+  decoded_unit_rows_ = DivideBy16(std::max(decoded_superblock_rows_ - 1, 0) *
+                                  superblock_size4x4_);
+  if (CountReadyFilterTasks(1) == 0) return;
+  ScheduleFilteringWorkers(1, &lock);
+}
+
+void PostFilter::StopFilterPipelining() {
+  if (!filter_pipelining_) return;
+  std::unique_lock<std::mutex> lock(filter_task_mutex_);
+  filter_pipeline_stopped_ = true;
+  if (scheduled_workers_ > 0) {
+    ScopedFrameStageTimer timer(&frame_stats_, kFrameStageThreadStall);
+    do {
+      filter_task_condvar_.wait(lock);
+    } while (scheduled_workers_ > 0);
   }
-  ExtendBordersForReferenceFrame();
 }
 
 int PostFilter::ApplyFilteringForOneSuperBlockRow(int row4x4, int sb4x4,
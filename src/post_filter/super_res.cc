@@ -11,8 +11,9 @@
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
+#include <algorithm>
+
 #include "src/post_filter.h"
-#include "src/utils/blocking_counter.h"
 
 namespace libgav1 {
 
@@ -21,6 +22,7 @@ void PostFilter::ApplySuperRes(const std::array<uint8_t*, kMaxPlanes>& src,
                                const int line_buffer_row,
                                const std::array<uint8_t*, kMaxPlanes>& dst,
                                bool dst_is_loop_restoration_border /*=false*/) {
+  ScopedFrameStageTimer timer(&frame_stats_, kFrameStageSuperRes);
   int plane = kPlaneY;
   do {
     const int plane_width =
@@ -145,68 +147,55 @@ void PostFilter::ApplySuperResForOneSuperBlockRow(int row4x4_start, int sb4x4,
   ApplySuperRes(src, rows, /*line_buffer_row=*/-1, dst);
 }
 
-void PostFilter::ApplySuperResThreaded() {
-  int num_threads = thread_pool_->num_threads() + 1;
-  // The number of rows that will be processed by each thread in the thread pool
-  // (other than the current thread).
-  int thread_pool_rows = frame_header_.height / num_threads;
-  thread_pool_rows = std::max(thread_pool_rows, 1);
-  // Make rows of Y plane even when there is subsampling for the other planes.
-  if ((thread_pool_rows & 1) != 0 && subsampling_y_[kPlaneU] != 0) {
-    ++thread_pool_rows;
-  }
-  // Adjust the number of threads to what we really need.
-  num_threads = Clip3(frame_header_.height / thread_pool_rows, 1, num_threads);
-  // For the current thread, we round up to process all the remaining rows.
-  int current_thread_rows =
-      frame_header_.height - thread_pool_rows * (num_threads - 1);
-  // Make rows of Y plane even when there is subsampling for the other planes.
-  if ((current_thread_rows & 1) != 0 && subsampling_y_[kPlaneU] != 0) {
-    ++current_thread_rows;
-  }
-  assert(current_thread_rows > 0);
-  BlockingCounter pending_workers(num_threads - 1);
-  for (int line_buffer_row = 0, row_start = 0; line_buffer_row < num_threads;
-       ++line_buffer_row, row_start += thread_pool_rows) {
-    std::array<uint8_t*, kMaxPlanes> src;
-    std::array<uint8_t*, kMaxPlanes> dst;
-    std::array<int, kMaxPlanes> rows;
-    int plane = kPlaneY;
-    const int pixel_size_log2 = pixel_size_log2_;
-    do {
-      src[plane] =
-          GetBufferOffset(cdef_buffer_[plane], frame_buffer_.stride(plane),
-                          static_cast<Plane>(plane), row_start, 0);
-      dst[plane] =
-          GetBufferOffset(superres_buffer_[plane], frame_buffer_.stride(plane),
-                          static_cast<Plane>(plane), row_start, 0);
-      rows[plane] =
-          (((line_buffer_row < num_threads - 1) ? thread_pool_rows
-                                                : current_thread_rows) >>
-           subsampling_y_[plane]) -
-          1;
-      const int plane_width =
-          MultiplyBy4(frame_header_.columns4x4) >> subsampling_x_[plane];
-      uint8_t* const input =
-          src[plane] + rows[plane] * frame_buffer_.stride(plane);
-      uint8_t* const line_buffer_start =
-          superres_line_buffer_.data(plane) +
-          line_buffer_row * superres_line_buffer_.stride(plane) +
-          (kSuperResHorizontalBorder << pixel_size_log2);
-      memcpy(line_buffer_start, input, plane_width << pixel_size_log2);
-    } while (++plane < planes_);
-    if (line_buffer_row < num_threads - 1) {
-      thread_pool_->Schedule(
-          [this, src, rows, line_buffer_row, dst, &pending_workers]() {
-            ApplySuperRes(src, rows, line_buffer_row, dst);
-            pending_workers.Decrement();
-          });
-    } else {
-      ApplySuperRes(src, rows, line_buffer_row, dst);
-    }
-  }
-  // Wait for the threadpool jobs to finish.
-  pending_workers.Wait();
+void PostFilter::SetupSuperResLineBuffer(int row4x4) {
+  assert(row4x4 >= 0);
+  assert(DoSuperRes());
+  ScopedFrameStageTimer timer(&frame_stats_, kFrameStageSuperRes);
+  const int line_buffer_row = DivideBy16(row4x4);
+  const int height = frame_header_.height;
+  int plane = kPlaneY;
+  do {
+    const int plane_height = SubsampledValue(height, subsampling_y_[plane]);
+    const int row_start = MultiplyBy4(row4x4) >> subsampling_y_[plane];
+    const int num_rows = std::min(
+        MultiplyBy4(kNum4x4InLoopFilterUnit) >> subsampling_y_[plane],
+        plane_height - row_start);
+    assert(num_rows > 0);
+    const int plane_width =
+        MultiplyBy4(frame_header_.columns4x4) >> subsampling_x_[plane];
+    const uint8_t* const input =
+        cdef_buffer_[plane] +
+        (row_start + num_rows - 1) * frame_buffer_.stride(plane);
+    uint8_t* const line_buffer_start =
+        superres_line_buffer_.data(plane) +
+        line_buffer_row * superres_line_buffer_.stride(plane) +
+        (kSuperResHorizontalBorder << pixel_size_log2_);
+    memcpy(line_buffer_start, input, plane_width << pixel_size_log2_);
+  } while (++plane < planes_);
+}
+
+void PostFilter::ApplySuperResForOneUnitRow(int row4x4) {
+  assert(row4x4 >= 0);
+  assert(DoSuperRes());
+  std::array<uint8_t*, kMaxPlanes> src;
+  std::array<uint8_t*, kMaxPlanes> dst;
+  std::array<int, kMaxPlanes> rows;
+  const int height = frame_header_.height;
+  int plane = kPlaneY;
+  do {
+    const int plane_height = SubsampledValue(height, subsampling_y_[plane]);
+    const int row_start = MultiplyBy4(row4x4) >> subsampling_y_[plane];
+    const int num_rows = std::min(
+        MultiplyBy4(kNum4x4InLoopFilterUnit) >> subsampling_y_[plane],
+        plane_height - row_start);
+    const ptrdiff_t row_offset = row_start * frame_buffer_.stride(plane);
+    src[plane] = cdef_buffer_[plane] + row_offset;
+    dst[plane] = superres_buffer_[plane] + row_offset;
+    // The last row is processed from |superres_line_buffer_| since it may
+    // have been overwritten by the output of the unit row below.
+    rows[plane] = num_rows - 1;
+  } while (++plane < planes_);
+  ApplySuperRes(src, rows, DivideBy16(row4x4), dst);
 }
 
 }  // namespace libgav1
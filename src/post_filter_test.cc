@@ -532,10 +532,15 @@ void PostFilterSuperResTest<bitdepth, Pixel>::TestApplySuperRes(
         Align(SubsampledValue(frame_header.upscaled_width, 1), 16) *
         pixel_size));
   }
+  const int num_units = RightShiftWithCeiling(frame_header.rows4x4, 4);
+  if (multi_threaded) {
+    ASSERT_TRUE(
+        frame_scratch_buffer.post_filter_task_state.Resize(num_units + 1));
+  }
   ASSERT_TRUE(frame_scratch_buffer.superres_line_buffer.Realloc(
       sequence_header.color_config.bitdepth,
       sequence_header.color_config.is_monochrome,
-      MultiplyBy4(frame_header.columns4x4), (multi_threaded ? kNumThreads : 1),
+      MultiplyBy4(frame_header.columns4x4), (multi_threaded ? num_units : 1),
       sequence_header.color_config.subsampling_x,
       /*subsampling_y=*/0, 2 * kSuperResHorizontalBorder,
       2 * (kSuperResHorizontalBorder + kSuperResHorizontalPadding), 0, 0,
@@ -581,7 +586,8 @@ void PostFilterSuperResTest<bitdepth, Pixel>::TestApplySuperRes(
   }
 
   if (multi_threaded) {
-    post_filter.ApplySuperResThreaded();
+    // Only SuperRes is triggered, since we set the filter mask to 0x04.
+    post_filter.ApplyFilteringThreaded();
   } else {
     std::array<uint8_t*, kMaxPlanes> buffers = {
         post_filter.cdef_buffer_[kPlaneY], post_filter.cdef_buffer_[kPlaneU],
@@ -842,7 +848,9 @@ class PostFilterApplyCdefTest : public testing::TestWithParam<FrameSizeParam>,
   // Sets yuv_buffer_.
   void SetInputBuffer(libvpx_test::ACMRandom* rnd, PostFilter* post_filter);
   void CopyFilterOutputToDestBuffer();
-  void TestMultiThread(int num_threads);
+  // If |pipelined| is true, the unit rows are filtered as the superblock rows
+  // are signaled as decoded, like in the threaded non frame parallel mode.
+  void TestMultiThread(int num_threads, bool pipelined);
 
   ObuSequenceHeader sequence_header_;
   ObuFrameHeader frame_header_ = {};
@@ -877,6 +885,7 @@ void PostFilterApplyCdefTest<bitdepth, Pixel>::SetInput(
   frame_header_.columns4x4 = DivideBy4(Align(frame_header_.width, 8));
   frame_header_.rows4x4 = DivideBy4(Align(frame_header_.height, 8));
   frame_header_.tile_info.tile_count = 1;
+  frame_header_.tile_info.tile_columns = 1;
   frame_header_.refresh_frame_flags = 0;
   Cdef* const cdef = &frame_header_.cdef;
   const int coeff_shift = bitdepth - 8;
@@ -972,7 +981,7 @@ void PostFilterApplyCdefTest<bitdepth, Pixel>::CopyFilterOutputToDestBuffer() {
 
 template <int bitdepth, typename Pixel>
 void PostFilterApplyCdefTest<bitdepth, Pixel>::TestMultiThread(
-    int num_threads) {
+    int num_threads, bool pipelined) {
   libvpx_test::ACMRandom rnd(libvpx_test::ACMRandom::DeterministicSeed());
   SetInput(&rnd);
 
@@ -987,6 +996,8 @@ void PostFilterApplyCdefTest<bitdepth, Pixel>::TestMultiThread(
         sequence_header_.color_config.subsampling_x,
         /*subsampling_y=*/0, kBorderPixels, kBorderPixels, kBorderPixels,
         kBorderPixels, nullptr, nullptr, nullptr));
+    ASSERT_TRUE(frame_scratch_buffer_.post_filter_task_state.Resize(
+        RightShiftWithCeiling(frame_header_.rows4x4, 4) + 1));
   }
 
   PostFilter post_filter(frame_header_, sequence_header_,
@@ -1001,6 +1012,15 @@ void PostFilterApplyCdefTest<bitdepth, Pixel>::TestMultiThread(
 
   // Only ApplyCdef() and frame copy inside ApplyFilteringThreaded() are
   // triggered, since we set the filter mask to 0x02.
+  if (pipelined) {
+    const int superblock_size4x4 =
+        sequence_header_.use_128x128_superblock ? 32 : 16;
+    ASSERT_TRUE(post_filter.EnableFilterPipelining(superblock_size4x4));
+    for (int row4x4 = 0; row4x4 < frame_header_.rows4x4;
+         row4x4 += superblock_size4x4) {
+      post_filter.SignalSuperBlockRowDecoded(row4x4);
+    }
+  }
   post_filter.ApplyFilteringThreaded();
   elapsed_time += absl::Now() - start;
 
@@ -1040,9 +1060,15 @@ const FrameSizeParam kTestParamApplyCdef[] = {
 using PostFilterApplyCdefTest8bpp = PostFilterApplyCdefTest<8, uint8_t>;
 
 TEST_P(PostFilterApplyCdefTest8bpp, ApplyCdef) {
-  TestMultiThread(2);
-  TestMultiThread(4);
-  TestMultiThread(8);
+  TestMultiThread(2, /*pipelined=*/false);
+  TestMultiThread(4, /*pipelined=*/false);
+  TestMultiThread(8, /*pipelined=*/false);
+}
+
+TEST_P(PostFilterApplyCdefTest8bpp, ApplyCdefPipelined) {
+  TestMultiThread(2, /*pipelined=*/true);
+  TestMultiThread(4, /*pipelined=*/true);
+  TestMultiThread(8, /*pipelined=*/true);
 }
 
 INSTANTIATE_TEST_SUITE_P(PostFilterApplyCdefTestInstance,
@@ -1053,9 +1079,15 @@ INSTANTIATE_TEST_SUITE_P(PostFilterApplyCdefTestInstance,
 using PostFilterApplyCdefTest10bpp = PostFilterApplyCdefTest<10, uint16_t>;
 
 TEST_P(PostFilterApplyCdefTest10bpp, ApplyCdef) {
-  TestMultiThread(2);
-  TestMultiThread(4);
-  TestMultiThread(8);
+  TestMultiThread(2, /*pipelined=*/false);
+  TestMultiThread(4, /*pipelined=*/false);
+  TestMultiThread(8, /*pipelined=*/false);
+}
+
+TEST_P(PostFilterApplyCdefTest10bpp, ApplyCdefPipelined) {
+  TestMultiThread(2, /*pipelined=*/true);
+  TestMultiThread(4, /*pipelined=*/true);
+  TestMultiThread(8, /*pipelined=*/true);
 }
 
 INSTANTIATE_TEST_SUITE_P(PostFilterApplyCdefTestInstance,
@@ -1067,9 +1099,15 @@ INSTANTIATE_TEST_SUITE_P(PostFilterApplyCdefTestInstance,
 using PostFilterApplyCdefTest12bpp = PostFilterApplyCdefTest<12, uint16_t>;
 
 TEST_P(PostFilterApplyCdefTest12bpp, ApplyCdef) {
-  TestMultiThread(2);
-  TestMultiThread(4);
-  TestMultiThread(8);
+  TestMultiThread(2, /*pipelined=*/false);
+  TestMultiThread(4, /*pipelined=*/false);
+  TestMultiThread(8, /*pipelined=*/false);
+}
+
+TEST_P(PostFilterApplyCdefTest12bpp, ApplyCdefPipelined) {
+  TestMultiThread(2, /*pipelined=*/true);
+  TestMultiThread(4, /*pipelined=*/true);
+  TestMultiThread(8, /*pipelined=*/true);
 }
 
 INSTANTIATE_TEST_SUITE_P(PostFilterApplyCdefTestInstance,
@@ -27,6 +27,7 @@
 #include "src/utils/bit_mask_set.h"
 #include "src/utils/common.h"
 #include "src/utils/constants.h"
+#include "src/utils/lazy_instance.h"
 #include "src/utils/logging.h"
 #include "src/utils/memory.h"
 
@@ -149,6 +150,11 @@ uint8_t GetWedgeOffsetY(BlockSize block_size, int index) {
   return kWedgeCodebook[BlockShape(block_size)][index][2];
 }
 
+LazyInstance<WedgeMaskArray>& GetSharedWedgeMasksInstance() {
+  static LazyInstance<WedgeMaskArray> shared_wedge_masks;
+  return shared_wedge_masks;
+}
+
 }  // namespace
 
 bool GenerateWedgeMask(WedgeMaskArray* const wedge_masks) {
@@ -233,4 +239,12 @@ bool GenerateWedgeMask(WedgeMaskArray* const wedge_masks) {
   return true;
 }
 
+bool InitializeSharedWedgeMasks() {
+  return GetSharedWedgeMasksInstance().Initialize(GenerateWedgeMask);
+}
+
+const WedgeMaskArray& GetSharedWedgeMasks() {
+  return GetSharedWedgeMasksInstance().Get();
+}
+
 }  // namespace libgav1
@@ -34,5 +34,15 @@ constexpr BitMaskSet kIsWedgeCompoundModeAllowed(kBlock8x8, kBlock8x16,
 // 7.11.3.11.
 bool GenerateWedgeMask(WedgeMaskArray* wedge_masks);
 
+// Generates the wedge masks that are shared by all the decoders in the
+// process, if they have not been generated yet. This function is thread safe.
+// Returns true on success, false on allocation failure.
+bool InitializeSharedWedgeMasks();
+
+// Returns the wedge masks that are shared by all the decoders in the process.
+// They are read-only and are valid after InitializeSharedWedgeMasks() has
+// returned true.
+const WedgeMaskArray& GetSharedWedgeMasks();
+
 }  // namespace libgav1
 #endif  // LIBGAV1_SRC_PREDICTION_MASK_H_
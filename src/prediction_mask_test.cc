@@ -16,6 +16,7 @@
 
 #include <array>
 #include <cstdint>
+#include <cstring>
 #include <string>
 
 #include "gtest/gtest.h"
@@ -210,5 +211,34 @@ TEST(WedgePredictionMaskTest, GenerateWedgeMask) {
   }
 }
 
+TEST(WedgePredictionMaskTest, SharedWedgeMasks) {
+  ASSERT_TRUE(InitializeSharedWedgeMasks());
+  ASSERT_TRUE(InitializeSharedWedgeMasks());
+  WedgeMaskArray wedge_masks;
+  ASSERT_TRUE(GenerateWedgeMask(&wedge_masks));
+  const WedgeMaskArray& shared_wedge_masks = GetSharedWedgeMasks();
+  EXPECT_EQ(&shared_wedge_masks, &GetSharedWedgeMasks());
+
+  int block_size_index = 0;
+  for (int block_size = kBlock8x8; block_size < kMaxBlockSizes; ++block_size) {
+    const int width = kBlockWidthPixels[block_size];
+    const int height = kBlockHeightPixels[block_size];
+    if (width < 8 || height < 8 || width > 32 || height > 32) continue;
+
+    for (int flip_sign = 0; flip_sign <= 1; ++flip_sign) {
+      for (int direction = 0; direction < kWedgeDirectionTypes; ++direction) {
+        const auto& expected =
+            wedge_masks[block_size_index][flip_sign][direction];
+        const auto& actual =
+            shared_wedge_masks[block_size_index][flip_sign][direction];
+        ASSERT_EQ(actual.rows(), height);
+        ASSERT_EQ(actual.columns(), width);
+        EXPECT_EQ(memcmp(actual[0], expected[0], width * height), 0);
+      }
+    }
+    block_size_index++;
+  }
+}
+
 }  // namespace
 }  // namespace libgav1
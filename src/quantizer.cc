@@ -19,6 +19,7 @@
 
 #include "src/utils/common.h"
 #include "src/utils/constants.h"
+#include "src/utils/lazy_instance.h"
 
 #if LIBGAV1_MAX_BITDEPTH != 8 && LIBGAV1_MAX_BITDEPTH != 10 && \
     LIBGAV1_MAX_BITDEPTH != 12
@@ -245,6 +246,11 @@ void FillUpperTriangle(uint8_t* dst, const uint8_t* src, int size) {
   }
 }
 
+LazyInstance<QuantizerMatrix>& GetSharedQuantizerMatrixInstance() {
+  static LazyInstance<QuantizerMatrix> shared_quantizer_matrix;
+  return shared_quantizer_matrix;
+}
+
 }  // namespace
 
 bool InitializeQuantizerMatrix(QuantizerMatrix* quantizer_matrix_ptr) {
@@ -313,6 +319,15 @@ bool InitializeQuantizerMatrix(QuantizerMatrix* quantizer_matrix_ptr) {
   return true;
 }
 
+bool InitializeSharedQuantizerMatrix() {
+  return GetSharedQuantizerMatrixInstance().Initialize(
+      InitializeQuantizerMatrix);
+}
+
+const QuantizerMatrix& GetSharedQuantizerMatrix() {
+  return GetSharedQuantizerMatrixInstance().Get();
+}
+
 int GetQIndex(const Segmentation& segmentation, int index, int base_qindex) {
   if (segmentation.FeatureActive(index, kSegmentFeatureQuantizer)) {
     const int segment_qindex =
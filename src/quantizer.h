@@ -58,6 +58,16 @@ class Quantizer {
 // Initialize the quantizer matrix.
 bool InitializeQuantizerMatrix(QuantizerMatrix* quantizer_matrix);
 
+// Initializes the quantizer matrix that is shared by all the decoders in the
+// process, if it has not been initialized yet. This function is thread safe.
+// Returns true on success, false on allocation failure.
+bool InitializeSharedQuantizerMatrix();
+
+// Returns the quantizer matrix that is shared by all the decoders in the
+// process. It is read-only and is valid after
+// InitializeSharedQuantizerMatrix() has returned true.
+const QuantizerMatrix& GetSharedQuantizerMatrix();
+
 // Get the quantizer index for the |index|th segment.
 //
 // This function has two use cases. What should be passed as the |base_qindex|
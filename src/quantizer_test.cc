@@ -15,6 +15,8 @@
 #include "src/quantizer.h"
 
 #include <cstdint>
+#include <cstring>
+#include <memory>
 
 #include "gtest/gtest.h"
 #include "src/obu_parser.h"
@@ -216,5 +218,30 @@ TEST(QuantizerTest, GetAcValue) {
 #endif  // LIBGAV1_MAX_BITDEPTH == 12
 }
 
+TEST(QuantizerTest, SharedQuantizerMatrix) {
+  ASSERT_TRUE(InitializeSharedQuantizerMatrix());
+  ASSERT_TRUE(InitializeSharedQuantizerMatrix());
+  std::unique_ptr<QuantizerMatrix> quantizer_matrix(new QuantizerMatrix);
+  ASSERT_TRUE(InitializeQuantizerMatrix(quantizer_matrix.get()));
+  const QuantizerMatrix& shared_quantizer_matrix = GetSharedQuantizerMatrix();
+  EXPECT_EQ(&shared_quantizer_matrix, &GetSharedQuantizerMatrix());
+
+  for (int level = 0; level < kNumQuantizerLevelsForQuantizerMatrix; ++level) {
+    for (int plane_type = kPlaneTypeY; plane_type < kNumPlaneTypes;
+         ++plane_type) {
+      for (int tx_size = 0; tx_size < kNumTransformSizes; ++tx_size) {
+        if (kTransformWidth[tx_size] == 64 || kTransformHeight[tx_size] == 64) {
+          continue;
+        }
+        const int size = kTransformWidth[tx_size] * kTransformHeight[tx_size];
+        EXPECT_EQ(
+            memcmp(shared_quantizer_matrix[level][plane_type][tx_size].get(),
+                   (*quantizer_matrix)[level][plane_type][tx_size].get(), size),
+            0);
+      }
+    }
+  }
+}
+
 }  // namespace
 }  // namespace libgav1
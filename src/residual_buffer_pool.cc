@@ -135,6 +135,29 @@ void ResidualBufferPool::Release(std::unique_ptr<ResidualBuffer> buffer) {
   buffers_.Push(std::move(buffer));
 }
 
+std::unique_ptr<PredictionParameters>
+ResidualBufferPool::GetPredictionParameters() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!prediction_parameters_.empty()) {
+      std::unique_ptr<PredictionParameters> prediction_parameters =
+          std::move(prediction_parameters_.back());
+      prediction_parameters_.pop_back();
+      return prediction_parameters;
+    }
+  }
+  return std::unique_ptr<PredictionParameters>(new (std::nothrow)
+                                                   PredictionParameters());
+}
+
+void ResidualBufferPool::ReleasePredictionParameters(
+    std::unique_ptr<PredictionParameters> prediction_parameters) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // If the push fails, |prediction_parameters| is simply freed.
+  static_cast<void>(
+      prediction_parameters_.push_back(std::move(prediction_parameters)));
+}
+
 size_t ResidualBufferPool::Size() const {
   std::lock_guard<std::mutex> lock(mutex_);
   return buffers_.Size();
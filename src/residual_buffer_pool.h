@@ -29,6 +29,7 @@
 #include "src/utils/memory.h"
 #include "src/utils/queue.h"
 #include "src/utils/types.h"
+#include "src/utils/vector.h"
 
 namespace libgav1 {
 
@@ -133,12 +134,24 @@ class ResidualBufferPool : public Allocable {
   // Subsequent calls to Get() may re-use this buffer.
   void Release(std::unique_ptr<ResidualBuffer> buffer);
 
+  // Gets the prediction parameters of a block that is parsed and decoded in
+  // separate steps. Returns one of the released instances if there is any,
+  // otherwise a new instance is allocated. The contents of the returned
+  // instance are unspecified.
+  std::unique_ptr<PredictionParameters> GetPredictionParameters();
+  // Returns |prediction_parameters| back to the pool. Subsequent calls to
+  // GetPredictionParameters() may re-use it.
+  void ReleasePredictionParameters(
+      std::unique_ptr<PredictionParameters> prediction_parameters);
+
   // Used only in the tests. Returns the number of buffers in the stack.
   size_t Size() const;
 
  private:
   mutable std::mutex mutex_;
   ResidualBufferStack buffers_ LIBGAV1_GUARDED_BY(mutex_);
+  Vector<std::unique_ptr<PredictionParameters>> prediction_parameters_
+      LIBGAV1_GUARDED_BY(mutex_);
   size_t buffer_size_;
   int queue_size_;
 };
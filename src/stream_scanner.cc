@@ -0,0 +1,79 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/gav1/stream_scanner.h"
+
+#include <memory>
+#include <new>
+
+#include "src/stream_scanner_impl.h"
+
+extern "C" {
+
+Libgav1StatusCode Libgav1StreamScannerCreate(
+    int operating_point, Libgav1StreamScanner** scanner_out) {
+  std::unique_ptr<libgav1::StreamScanner> cxx_scanner(
+      new (std::nothrow) libgav1::StreamScanner());
+  if (cxx_scanner == nullptr) return kLibgav1StatusOutOfMemory;
+
+  const Libgav1StatusCode status = cxx_scanner->Init(operating_point);
+  if (status == kLibgav1StatusOk) {
+    *scanner_out =
+        reinterpret_cast<Libgav1StreamScanner*>(cxx_scanner.release());
+  }
+  return status;
+}
+
+void Libgav1StreamScannerDestroy(Libgav1StreamScanner* scanner) {
+  auto* cxx_scanner = reinterpret_cast<libgav1::StreamScanner*>(scanner);
+  delete cxx_scanner;
+}
+
+Libgav1StatusCode Libgav1StreamScannerScanTemporalUnit(
+    Libgav1StreamScanner* scanner, const uint8_t* data, size_t size,
+    Libgav1ScannedTemporalUnit* temporal_unit) {
+  auto* cxx_scanner = reinterpret_cast<libgav1::StreamScanner*>(scanner);
+  return cxx_scanner->ScanTemporalUnit(data, size, temporal_unit);
+}
+
+void Libgav1StreamScannerReset(Libgav1StreamScanner* scanner) {
+  auto* cxx_scanner = reinterpret_cast<libgav1::StreamScanner*>(scanner);
+  cxx_scanner->Reset();
+}
+
+}  // extern "C"
+
+namespace libgav1 {
+
+StreamScanner::StreamScanner() = default;
+
+StreamScanner::~StreamScanner() = default;
+
+StatusCode StreamScanner::Init(int operating_point) {
+  if (impl_ != nullptr) return kStatusAlready;
+  return StreamScannerImpl::Create(operating_point, &impl_);
+}
+
+StatusCode StreamScanner::ScanTemporalUnit(const uint8_t* data, size_t size,
+                                           ScannedTemporalUnit* temporal_unit) {
+  if (impl_ == nullptr) return kStatusNotInitialized;
+  if (temporal_unit == nullptr) return kStatusInvalidArgument;
+  return impl_->ScanTemporalUnit(data, size, temporal_unit);
+}
+
+void StreamScanner::Reset() {
+  if (impl_ != nullptr) impl_->Reset();
+}
+
+}  // namespace libgav1
@@ -0,0 +1,152 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/stream_scanner_impl.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "src/utils/constants.h"
+#include "src/utils/logging.h"
+
+namespace libgav1 {
+namespace {
+
+// Returns the header of the last OBU of type |type| that was parsed by the
+// last call to obu.ParseOneFrame(), or nullptr if there is none.
+const ObuHeader* FindObuHeader(const ObuParser& obu, ObuType type) {
+  const ObuHeader* found = nullptr;
+  for (const ObuHeader& obu_header : obu.obu_headers()) {
+    if (obu_header.type == type) found = &obu_header;
+  }
+  return found;
+}
+
+}  // namespace
+
+// static
+StatusCode StreamScannerImpl::Create(
+    int operating_point, std::unique_ptr<StreamScannerImpl>* output) {
+  if (operating_point < 0 || operating_point >= kMaxOperatingPoints) {
+    LIBGAV1_DLOG(ERROR, "Invalid operating point: %d.", operating_point);
+    return kStatusInvalidArgument;
+  }
+  std::unique_ptr<StreamScannerImpl> impl(
+      new (std::nothrow) StreamScannerImpl(operating_point));
+  if (impl == nullptr) {
+    LIBGAV1_DLOG(ERROR, "Failed to allocate StreamScannerImpl.");
+    return kStatusOutOfMemory;
+  }
+  *output = std::move(impl);
+  return kStatusOk;
+}
+
+StatusCode StreamScannerImpl::ScanTemporalUnit(
+    const uint8_t* data, size_t size, ScannedTemporalUnit* temporal_unit) {
+  if (failed_) return kStatusUnknownError;
+  *temporal_unit = {};
+  frames_.clear();
+  if (data == nullptr || size == 0) return kStatusInvalidArgument;
+  std::unique_ptr<ObuParser> obu(new (std::nothrow) ObuParser(
+      data, size, operating_point_, &buffer_pool_, &state_));
+  if (obu == nullptr) {
+    LIBGAV1_DLOG(ERROR, "Failed to allocate OBU parser.");
+    return kStatusOutOfMemory;
+  }
+  obu->set_header_only(true);
+  if (has_sequence_header_) {
+    obu->set_sequence_header(sequence_header_);
+  }
+  const StatusCode status = ScanFrames(obu.get(), size, temporal_unit);
+  if (status != kStatusOk) {
+    failed_ = true;
+    frames_.clear();
+    *temporal_unit = {};
+    return status;
+  }
+  temporal_unit->frames = frames_.data();
+  temporal_unit->num_frames = static_cast<int>(frames_.size());
+  temporal_unit->is_random_access_point =
+      temporal_unit->has_sequence_header && !frames_.empty() &&
+      frames_[0].frame_type == kFrameKey && frames_[0].show_frame;
+  return kStatusOk;
+}
+
+StatusCode StreamScannerImpl::ScanFrames(ObuParser* const obu,
+                                         const size_t size,
+                                         ScannedTemporalUnit* temporal_unit) {
+  while (obu->HasData()) {
+    const size_t offset = size - obu->bytes_remaining();
+    RefCountedBufferPtr current_frame;
+    const StatusCode status = obu->ParseOneFrame(&current_frame);
+    if (status != kStatusOk) {
+      LIBGAV1_DLOG(ERROR, "Failed to parse OBU.");
+      return status;
+    }
+    if (FindObuHeader(*obu, kObuSequenceHeader) != nullptr) {
+      sequence_header_ = obu->sequence_header();
+      has_sequence_header_ = true;
+      temporal_unit->has_sequence_header = 1;
+    }
+    // The OBUs that follow the last frame of the temporal unit (for example,
+    // metadata OBUs) are not a frame.
+    const ObuHeader* frame_obu_header = FindObuHeader(*obu, kObuFrame);
+    if (frame_obu_header == nullptr) {
+      frame_obu_header = FindObuHeader(*obu, kObuFrameHeader);
+    }
+    if (current_frame == nullptr || frame_obu_header == nullptr) continue;
+    const ObuFrameHeader& frame_header = obu->frame_header();
+    ScannedFrame frame = {};
+    frame.offset = offset;
+    frame.size = size - obu->bytes_remaining() - offset;
+    frame.temporal_id = frame_obu_header->temporal_id;
+    frame.spatial_id = frame_obu_header->spatial_id;
+    // For show_existing_frame, |current_frame| is the frame that is shown.
+    frame.frame_type = current_frame->frame_type();
+    frame.show_frame = static_cast<int>(frame_header.show_frame);
+    frame.show_existing_frame =
+        static_cast<int>(frame_header.show_existing_frame);
+    frame.showable_frame = static_cast<int>(frame_header.showable_frame);
+    frame.frame_to_show = frame_header.frame_to_show;
+    frame.width = current_frame->upscaled_width();
+    frame.height = current_frame->frame_height();
+    frame.render_width = current_frame->render_width();
+    frame.render_height = current_frame->render_height();
+    frame.refresh_frame_flags = frame_header.refresh_frame_flags;
+    frame.order_hint =
+        frame_header.show_existing_frame
+            ? state_.reference_order_hint[frame_header.frame_to_show]
+            : frame_header.order_hint;
+    if (!frames_.push_back(frame)) {
+      LIBGAV1_DLOG(ERROR, "frames_.push_back failed.");
+      return kStatusOutOfMemory;
+    }
+    state_.UpdateReferenceFrames(current_frame,
+                                 frame_header.refresh_frame_flags);
+  }
+  return kStatusOk;
+}
+
+void StreamScannerImpl::Reset() {
+  state_ = DecoderState();
+  sequence_header_ = {};
+  has_sequence_header_ = false;
+  failed_ = false;
+  frames_.clear();
+}
+
+}  // namespace libgav1
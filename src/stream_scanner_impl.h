@@ -0,0 +1,70 @@
+/*
+ * Copyright 2024 The libgav1 Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGAV1_SRC_STREAM_SCANNER_IMPL_H_
+#define LIBGAV1_SRC_STREAM_SCANNER_IMPL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "src/buffer_pool.h"
+#include "src/decoder_state.h"
+#include "src/gav1/status_code.h"
+#include "src/gav1/stream_scanner.h"
+#include "src/obu_parser.h"
+#include "src/utils/memory.h"
+#include "src/utils/vector.h"
+
+namespace libgav1 {
+
+// Parses the temporal units with an ObuParser in header only mode. The
+// RefCountedBuffers of the reference frames only carry the frame header state
+// that later frame headers depend on; their pixel buffers are never allocated.
+class StreamScannerImpl : public Allocable {
+ public:
+  static StatusCode Create(int operating_point,
+                           std::unique_ptr<StreamScannerImpl>* output);
+
+  StatusCode ScanTemporalUnit(const uint8_t* data, size_t size,
+                              ScannedTemporalUnit* temporal_unit);
+  void Reset();
+
+ private:
+  explicit StreamScannerImpl(int operating_point)
+      : operating_point_(operating_point),
+        buffer_pool_(nullptr, nullptr, nullptr, nullptr) {}
+
+  // Parses the frames of the temporal unit with |obu| and appends them to
+  // |frames_|.
+  StatusCode ScanFrames(ObuParser* obu, size_t size,
+                        ScannedTemporalUnit* temporal_unit);
+
+  const int operating_point_;
+  // |buffer_pool_| must outlive the frames held by |state_|.
+  BufferPool buffer_pool_;
+  DecoderState state_;
+  ObuSequenceHeader sequence_header_ = {};
+  bool has_sequence_header_ = false;
+  // Set when a temporal unit fails to parse. |state_| may be inconsistent
+  // until Reset() is called.
+  bool failed_ = false;
+  Vector<ScannedFrame> frames_;
+};
+
+}  // namespace libgav1
+
+#endif  // LIBGAV1_SRC_STREAM_SCANNER_IMPL_H_
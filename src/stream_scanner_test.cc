@@ -0,0 +1,121 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/gav1/stream_scanner.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include "gtest/gtest.h"
+#include "src/decoder_test_data.h"
+
+namespace libgav1 {
+namespace {
+
+constexpr uint8_t kFrame1[] = {OBU_TEMPORAL_DELIMITER, OBU_SEQUENCE_HEADER,
+                               OBU_FRAME_1};
+
+constexpr uint8_t kFrame2[] = {OBU_TEMPORAL_DELIMITER, OBU_FRAME_2};
+
+constexpr uint8_t kFrame1WithMetadata[] = {
+    OBU_TEMPORAL_DELIMITER, OBU_SEQUENCE_HEADER, OBU_FRAME_1,
+    OBU_METADATA_HDR_CLL};
+
+TEST(StreamScannerTest, Errors) {
+  StreamScanner scanner;
+  ScannedTemporalUnit temporal_unit;
+  EXPECT_EQ(scanner.ScanTemporalUnit(kFrame1, sizeof(kFrame1), &temporal_unit),
+            kStatusNotInitialized);
+  EXPECT_EQ(scanner.Init(-1), kStatusInvalidArgument);
+  ASSERT_EQ(scanner.Init(0), kStatusOk);
+  EXPECT_EQ(scanner.Init(0), kStatusAlready);
+  EXPECT_EQ(scanner.ScanTemporalUnit(nullptr, 0, &temporal_unit),
+            kStatusInvalidArgument);
+  EXPECT_EQ(scanner.ScanTemporalUnit(kFrame1, sizeof(kFrame1), nullptr),
+            kStatusInvalidArgument);
+
+  // The frame headers cannot be parsed without a sequence header.
+  EXPECT_NE(scanner.ScanTemporalUnit(kFrame2, sizeof(kFrame2), &temporal_unit),
+            kStatusOk);
+  EXPECT_EQ(temporal_unit.num_frames, 0);
+  // The scanner must be reset after an error.
+  EXPECT_NE(scanner.ScanTemporalUnit(kFrame1, sizeof(kFrame1), &temporal_unit),
+            kStatusOk);
+  scanner.Reset();
+  EXPECT_EQ(scanner.ScanTemporalUnit(kFrame1, sizeof(kFrame1), &temporal_unit),
+            kStatusOk);
+}
+
+TEST(StreamScannerTest, ScanTemporalUnits) {
+  StreamScanner scanner;
+  ASSERT_EQ(scanner.Init(0), kStatusOk);
+  for (int i = 0; i < 2; ++i) {
+    SCOPED_TRACE(i);
+    ScannedTemporalUnit temporal_unit;
+    ASSERT_EQ(
+        scanner.ScanTemporalUnit(kFrame1, sizeof(kFrame1), &temporal_unit),
+        kStatusOk);
+    EXPECT_TRUE(temporal_unit.has_sequence_header);
+    EXPECT_TRUE(temporal_unit.is_random_access_point);
+    ASSERT_EQ(temporal_unit.num_frames, 1);
+    const ScannedFrame* frame = &temporal_unit.frames[0];
+    EXPECT_EQ(frame->offset, 0);
+    EXPECT_EQ(frame->size, sizeof(kFrame1));
+    EXPECT_EQ(frame->frame_type, 0);
+    EXPECT_TRUE(frame->show_frame);
+    EXPECT_FALSE(frame->show_existing_frame);
+    EXPECT_EQ(frame->width, 32);
+    EXPECT_EQ(frame->height, 32);
+    EXPECT_EQ(frame->render_width, 32);
+    EXPECT_EQ(frame->render_height, 32);
+    EXPECT_EQ(frame->refresh_frame_flags, 0xff);
+    EXPECT_EQ(frame->order_hint, 0);
+
+    ASSERT_EQ(
+        scanner.ScanTemporalUnit(kFrame2, sizeof(kFrame2), &temporal_unit),
+        kStatusOk);
+    EXPECT_FALSE(temporal_unit.has_sequence_header);
+    EXPECT_FALSE(temporal_unit.is_random_access_point);
+    ASSERT_EQ(temporal_unit.num_frames, 1);
+    frame = &temporal_unit.frames[0];
+    EXPECT_EQ(frame->offset, 0);
+    EXPECT_EQ(frame->size, sizeof(kFrame2));
+    EXPECT_EQ(frame->frame_type, 1);
+    EXPECT_TRUE(frame->show_frame);
+    EXPECT_FALSE(frame->show_existing_frame);
+    EXPECT_EQ(frame->width, 32);
+    EXPECT_EQ(frame->height, 32);
+    EXPECT_EQ(frame->order_hint, 1);
+
+    // The reference frames of the first stream are forgotten.
+    scanner.Reset();
+  }
+}
+
+TEST(StreamScannerTest, TrailingObus) {
+  StreamScanner scanner;
+  ASSERT_EQ(scanner.Init(0), kStatusOk);
+  ScannedTemporalUnit temporal_unit;
+  ASSERT_EQ(scanner.ScanTemporalUnit(kFrame1WithMetadata,
+                                     sizeof(kFrame1WithMetadata),
+                                     &temporal_unit),
+            kStatusOk);
+  // The metadata OBU after the frame is not a frame of its own.
+  ASSERT_EQ(temporal_unit.num_frames, 1);
+  EXPECT_EQ(temporal_unit.frames[0].offset, 0);
+  EXPECT_EQ(temporal_unit.frames[0].size, sizeof(kFrame1));
+}
+
+}  // namespace
+}  // namespace libgav1
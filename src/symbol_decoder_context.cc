@@ -16,6 +16,7 @@
 
 #include <cassert>
 #include <cstring>
+#include <new>
 #include <type_traits>
 
 namespace libgav1 {
@@ -319,4 +320,49 @@ int SymbolDecoderContext::PartitionCdfSize(int block_size_log2) {
   }
 }
 
+void SymbolDecoderContextSnapshot::Release() {
+  if (context_ == nullptr) return;
+  if (context_->ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    context_->pool->Return(context_);
+  }
+  context_ = nullptr;
+}
+
+SymbolDecoderContextPool::~SymbolDecoderContextPool() {
+  while (free_list_ != nullptr) {
+    PooledSymbolDecoderContext* const context = free_list_;
+    free_list_ = context->next_free;
+    delete context;
+    --num_contexts_;
+  }
+  assert(num_contexts_ == 0 &&
+         "SymbolDecoderContextSnapshot still in use at destruction time.");
+}
+
+SymbolDecoderContextSnapshot SymbolDecoderContextPool::Get() {
+  PooledSymbolDecoderContext* context;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    context = free_list_;
+    if (context != nullptr) {
+      free_list_ = context->next_free;
+    } else {
+      context = new (std::nothrow) PooledSymbolDecoderContext;
+      if (context == nullptr) return SymbolDecoderContextSnapshot();
+      context->pool = this;
+      ++num_contexts_;
+    }
+  }
+  context->next_free = nullptr;
+  context->ref_count.store(1, std::memory_order_relaxed);
+  return SymbolDecoderContextSnapshot(context);
+}
+
+void SymbolDecoderContextPool::Return(
+    PooledSymbolDecoderContext* const context) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  context->next_free = free_list_;
+  free_list_ = context;
+}
+
 }  // namespace libgav1
@@ -17,8 +17,12 @@
 #ifndef LIBGAV1_SRC_SYMBOL_DECODER_CONTEXT_H_
 #define LIBGAV1_SRC_SYMBOL_DECODER_CONTEXT_H_
 
+#include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <mutex>  // NOLINT (unapproved c++11 header)
+#include <utility>
 
 #include "src/dsp/constants.h"
 #include "src/utils/constants.h"
@@ -90,7 +94,10 @@ enum {
   kNumMvComponents = 2,
 };  // anonymous enum
 
-struct SymbolDecoderContext {
+// The alignment requirement is due to the CDF arrays. MaxAlignedAllocable
+// allows the frame context snapshots (see SymbolDecoderContextPool) to be
+// allocated on the heap.
+struct SymbolDecoderContext : public MaxAlignedAllocable {
   SymbolDecoderContext() = default;
   explicit SymbolDecoderContext(int base_quantizer_index) {
     Initialize(base_quantizer_index);
@@ -299,5 +306,121 @@ struct SymbolDecoderContext {
                            [kBooleanFieldCdfSize];
 };
 
+class SymbolDecoderContextPool;
+
+// A SymbolDecoderContext that is owned by a SymbolDecoderContextPool. The
+// reference count is intrusive, so sharing a snapshot does not allocate.
+struct PooledSymbolDecoderContext : public SymbolDecoderContext {
+  std::atomic<int> ref_count{0};
+  SymbolDecoderContextPool* pool = nullptr;
+  // Links the contexts in the free list of |pool|.
+  PooledSymbolDecoderContext* next_free = nullptr;
+};
+
+// A reference-counted copy of the CDF tables at the end of a frame. The saved
+// frame context of a frame is never modified once it is shared, so a frame
+// that inherits it without updating it (disable_frame_end_update_cdf), and
+// every reference slot that holds the frame, share one snapshot instead of
+// copying the tables. The tiles still decode with their own mutable copy,
+// which is made once per tile from the snapshot.
+class SymbolDecoderContextSnapshot {
+ public:
+  SymbolDecoderContextSnapshot() = default;
+  SymbolDecoderContextSnapshot(std::nullptr_t) {}  // NOLINT
+  SymbolDecoderContextSnapshot(const SymbolDecoderContextSnapshot& other)
+      : context_(other.context_) {
+    if (context_ != nullptr) {
+      context_->ref_count.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  SymbolDecoderContextSnapshot(SymbolDecoderContextSnapshot&& other) noexcept
+      : context_(other.context_) {
+    other.context_ = nullptr;
+  }
+  SymbolDecoderContextSnapshot& operator=(
+      const SymbolDecoderContextSnapshot& other) {
+    SymbolDecoderContextSnapshot(other).Swap(this);
+    return *this;
+  }
+  SymbolDecoderContextSnapshot& operator=(
+      SymbolDecoderContextSnapshot&& other) noexcept {
+    SymbolDecoderContextSnapshot(std::move(other)).Swap(this);
+    return *this;
+  }
+  ~SymbolDecoderContextSnapshot() { Release(); }
+
+  const SymbolDecoderContext* get() const { return context_; }
+  const SymbolDecoderContext& operator*() const { return *context_; }
+  const SymbolDecoderContext* operator->() const { return context_; }
+  bool operator==(std::nullptr_t) const { return context_ == nullptr; }
+  bool operator!=(std::nullptr_t) const { return context_ != nullptr; }
+
+  // Returns the number of snapshots that share the tables. Only meaningful
+  // when no other thread copies or releases them concurrently.
+  int use_count() const {
+    return (context_ == nullptr)
+               ? 0
+               : context_->ref_count.load(std::memory_order_relaxed);
+  }
+
+  // Returns the tables for writing. Only allowed before the snapshot is
+  // shared, i.e. while use_count() is 1.
+  SymbolDecoderContext* Mutable() {
+    assert(use_count() == 1);
+    return context_;
+  }
+
+  // The pool that owns the tables, or nullptr.
+  const SymbolDecoderContextPool* pool() const {
+    return (context_ == nullptr) ? nullptr : context_->pool;
+  }
+
+ private:
+  friend class SymbolDecoderContextPool;
+
+  // Takes ownership of the reference that |context| was given.
+  explicit SymbolDecoderContextSnapshot(PooledSymbolDecoderContext* context)
+      : context_(context) {}
+
+  void Swap(SymbolDecoderContextSnapshot* other) {
+    PooledSymbolDecoderContext* const context = context_;
+    context_ = other->context_;
+    other->context_ = context;
+  }
+
+  void Release();
+
+  PooledSymbolDecoderContext* context_ = nullptr;
+};
+
+// Recycles the storage of the frame context snapshots. The number of live
+// snapshots is bounded by the reference frames and the frames being decoded,
+// so once the pool is warm a frame does not allocate its frame context. The
+// pool must outlive the snapshots it returns.
+class SymbolDecoderContextPool {
+ public:
+  SymbolDecoderContextPool() = default;
+  SymbolDecoderContextPool(const SymbolDecoderContextPool&) = delete;
+  SymbolDecoderContextPool& operator=(const SymbolDecoderContextPool&) =
+      delete;
+  ~SymbolDecoderContextPool();
+
+  // Returns an unshared snapshot with unspecified tables, or a null snapshot
+  // if there is not enough memory. The tables are filled in through
+  // SymbolDecoderContextSnapshot::Mutable().
+  SymbolDecoderContextSnapshot Get();
+
+ private:
+  friend class SymbolDecoderContextSnapshot;
+
+  // Called when the last snapshot of |context| is released.
+  void Return(PooledSymbolDecoderContext* context);
+
+  std::mutex mutex_;
+  PooledSymbolDecoderContext* free_list_ = nullptr;
+  // The number of contexts allocated by the pool, free or not.
+  int num_contexts_ = 0;
+};
+
 }  // namespace libgav1
 #endif  // LIBGAV1_SRC_SYMBOL_DECODER_CONTEXT_H_
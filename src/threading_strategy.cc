@@ -16,12 +16,13 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <memory>
+#include <mutex>  // NOLINT (unapproved c++11 header)
 
-#include "src/frame_scratch_buffer.h"
+#include "src/utils/common.h"
 #include "src/utils/constants.h"
 #include "src/utils/logging.h"
-#include "src/utils/vector.h"
 
 namespace libgav1 {
 namespace {
@@ -35,39 +36,43 @@ constexpr int kFrameParallelThresholdMultiplier =
 
 // Computes the number of frame threads to be used based on the following
 // heuristic:
-//   * If |thread_count| == 1, return 0.
-//   * If |thread_count| <= |tile_count| * kFrameParallelThresholdMultiplier,
-//     return 0.
-//   * Otherwise, return the largest value of i which satisfies the following
-//     condition: i + i * tile_columns <= thread_count. This ensures that there
-//     are at least |tile_columns| worker threads for each frame thread.
+//   * If |thread_count| <= kFrameParallelThresholdMultiplier, return 0.
+//   * Otherwise, return |thread_count| / 2. This is the largest number of
+//     frames in flight that still leaves a worker thread for each of them,
+//     which is what frames with a single tile can use. The
+//     FrameParallelThreadBalancer decodes fewer frames in parallel when the
+//     frames have more tiles or stall on their reference frames.
 //   * This function will never return 1 or a value > |thread_count|.
 //
 //  This heuristic is based on empirical performance data. The in-frame
 //  threading model (combination of tile multithreading, superblock row
 //  multithreading and post filter multithreading) performs better than the
 //  frame parallel model until we reach the threshold of |thread_count| >
-//  |tile_count| * kFrameParallelThresholdMultiplier.
-//
-//  It is a function of |tile_count| since tile threading and superblock row
-//  multithreading will scale only as a factor of |tile_count|. The threshold
-//  kFrameParallelThresholdMultiplier is arrived at based on empirical data.
-//  The general idea is that superblock row multithreading plateaus at 4 *
-//  |tile_count| because in most practical cases there aren't more than that
-//  many superblock rows and columns available to work on in parallel.
-int ComputeFrameThreadCount(int thread_count, int tile_count,
-                            int tile_columns) {
+//  |tile_count| * kFrameParallelThresholdMultiplier. The tile count may change
+//  at any frame and is not known when the thread pools are created, so the
+//  threshold is applied for a single tile here, and the balancer adapts the
+//  number of frames in flight to the tile count of the frames.
+int ComputeFrameThreadCount(int thread_count) {
   assert(thread_count > 0);
-  if (thread_count == 1) return 0;
-  return (thread_count <= tile_count * kFrameParallelThresholdMultiplier)
-             ? 0
-             : std::max(2, thread_count / (1 + tile_columns));
+  if (thread_count <= kFrameParallelThresholdMultiplier) return 0;
+  return std::max(2, thread_count / 2);
+}
+
+// Runs |job| on the ThreadPool |executor_private_data|. This is the executor of
+// the per-frame thread pools in frame parallel mode.
+void ScheduleOnThreadPool(void* executor_private_data,
+                          void (*job)(void* job_arg), void* job_arg) {
+  static_cast<ThreadPool*>(executor_private_data)->Schedule([job, job_arg]() {
+    job(job_arg);
+  });
 }
 
 }  // namespace
 
 bool ThreadingStrategy::Reset(const ObuFrameHeader& frame_header,
-                              int thread_count) {
+                              int thread_count,
+                              ThreadPool::ScheduleJobFunction schedule_job,
+                              void* executor_private_data) {
   assert(thread_count > 0);
   frame_parallel_ = false;
 
@@ -83,7 +88,10 @@ bool ThreadingStrategy::Reset(const ObuFrameHeader& frame_header,
   thread_count = std::min(thread_count, static_cast<int>(kMaxThreads)) - 1;
 
   if (thread_pool_ == nullptr || thread_pool_->num_threads() != thread_count) {
-    thread_pool_ = ThreadPool::Create("libgav1", thread_count);
+    thread_pool_ = (schedule_job != nullptr)
+                       ? ThreadPool::CreateOnExecutor(
+                             schedule_job, executor_private_data, thread_count)
+                       : ThreadPool::Create("libgav1", thread_count);
     if (thread_pool_ == nullptr) {
       LIBGAV1_DLOG(ERROR, "Failed to create a thread pool with %d threads.",
                    thread_count);
@@ -149,8 +157,9 @@ bool ThreadingStrategy::Reset(const ObuFrameHeader& frame_header,
   return true;
 }
 
-bool ThreadingStrategy::Reset(int thread_count) {
-  assert(thread_count > 0);
+bool ThreadingStrategy::Reset(ThreadPool* const worker_thread_pool,
+                              int thread_count) {
+  assert(thread_count >= 0);
   frame_parallel_ = true;
 
   // In frame parallel mode, we simply access the underlying |thread_pool_|
@@ -160,25 +169,118 @@ bool ThreadingStrategy::Reset(int thread_count) {
   tile_thread_count_ = 0;
   max_tile_index_for_row_threads_ = 0;
 
-  if (thread_pool_ == nullptr || thread_pool_->num_threads() != thread_count) {
-    thread_pool_ = ThreadPool::Create("libgav1-fp", thread_count);
+  if (thread_count == 0) {
+    thread_pool_.reset(nullptr);
+    worker_thread_pool_ = nullptr;
+    return true;
+  }
+  assert(worker_thread_pool != nullptr);
+  if (thread_pool_ == nullptr || worker_thread_pool_ != worker_thread_pool ||
+      thread_pool_->num_threads() != thread_count) {
+    thread_pool_ = ThreadPool::CreateOnExecutor(
+        ScheduleOnThreadPool, worker_thread_pool, thread_count);
     if (thread_pool_ == nullptr) {
       LIBGAV1_DLOG(ERROR, "Failed to create a thread pool with %d threads.",
                    thread_count);
+      worker_thread_pool_ = nullptr;
       return false;
     }
+    worker_thread_pool_ = worker_thread_pool;
   }
   return true;
 }
 
+void FrameParallelThreadBalancer::Init(int frame_threads, int worker_threads) {
+  assert(frame_threads >= 2);
+  assert(worker_threads >= 0);
+  std::lock_guard<std::mutex> lock(mutex_);
+  frame_threads_ = frame_threads;
+  worker_threads_ = worker_threads;
+  free_workers_ = worker_threads;
+  max_frames_in_flight_.store(frame_threads);
+  tile_count_ = 0;
+  ClearStats();
+}
+
+int FrameParallelThreadBalancer::AcquireWorkers(
+    const ObuFrameHeader& frame_header) {
+  const int tile_count = std::max(frame_header.tile_info.tile_count, 1);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (tile_count != tile_count_) {
+    // This is the first frame or the tile layout has changed. Start over from
+    // the number of frames in flight that fits the layout. The stall times of
+    // the previous layout no longer apply.
+    tile_count_ = tile_count;
+    max_frames_in_flight_.store(
+        Clip3((frame_threads_ + worker_threads_) / (1 + tile_count), 2,
+              frame_threads_));
+    ClearStats();
+  }
+  const int frames_in_flight = max_frames_in_flight_.load();
+  // Round up so that no worker thread is left idle when all the frames in
+  // flight have many tiles.
+  const int share =
+      (worker_threads_ + frames_in_flight - 1) / frames_in_flight;
+  const int num_workers = std::min({tile_count, share, free_workers_});
+  free_workers_ -= num_workers;
+  if (num_workers < std::min(tile_count, worker_threads_)) {
+    ++num_starved_frames_;
+  }
+  return num_workers;
+}
+
+void FrameParallelThreadBalancer::ReleaseWorkers(int num_workers,
+                                                 int64_t decode_time_ns,
+                                                 int64_t reference_wait_time_ns,
+                                                 int64_t row_wait_time_ns) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  free_workers_ += num_workers;
+  assert(free_workers_ <= worker_threads_);
+  thread_time_ns_ += decode_time_ns * (num_workers + 1);
+  reference_wait_time_ns_ += reference_wait_time_ns;
+  decode_time_ns_ += decode_time_ns;
+  row_wait_time_ns_ += row_wait_time_ns;
+  if (++num_frames_ == kAdaptationInterval) Adapt();
+}
+
+void FrameParallelThreadBalancer::Adapt() {
+  int frames_in_flight = max_frames_in_flight_.load();
+  // More than half of the thread time was spent waiting for the reference
+  // frames.
+  const bool reference_bound = 2 * reference_wait_time_ns_ > thread_time_ns_;
+  // The post filter waited on superblock rows for more than half of the time
+  // while most frames got fewer worker threads than they have tiles.
+  const bool starved = 2 * row_wait_time_ns_ > decode_time_ns_ &&
+                       2 * num_starved_frames_ > num_frames_;
+  if (reference_bound || starved) {
+    frames_in_flight = std::max(frames_in_flight - 1, 2);
+  } else if (8 * reference_wait_time_ns_ < thread_time_ns_) {
+    // Less than an eighth of the thread time was spent waiting for the
+    // reference frames. The gap between the two thresholds keeps the number of
+    // frames in flight from oscillating.
+    frames_in_flight = std::min(frames_in_flight + 1, frame_threads_);
+  }
+  max_frames_in_flight_.store(frames_in_flight);
+  ClearStats();
+}
+
+void FrameParallelThreadBalancer::ClearStats() {
+  num_frames_ = 0;
+  num_starved_frames_ = 0;
+  thread_time_ns_ = 0;
+  reference_wait_time_ns_ = 0;
+  decode_time_ns_ = 0;
+  row_wait_time_ns_ = 0;
+}
+
 bool InitializeThreadPoolsForFrameParallel(
-    int thread_count, int tile_count, int tile_columns,
-    std::unique_ptr<ThreadPool>* const frame_thread_pool,
-    FrameScratchBufferPool* const frame_scratch_buffer_pool) {
+    int thread_count, std::unique_ptr<ThreadPool>* const frame_thread_pool,
+    std::unique_ptr<ThreadPool>* const worker_thread_pool,
+    FrameParallelThreadBalancer* const balancer) {
   assert(*frame_thread_pool == nullptr);
+  assert(*worker_thread_pool == nullptr);
   thread_count = std::min(thread_count, static_cast<int>(kMaxThreads));
-  const int frame_threads =
-      ComputeFrameThreadCount(thread_count, tile_count, tile_columns);
+  const int frame_threads = ComputeFrameThreadCount(thread_count);
   if (frame_threads == 0) return true;
   *frame_thread_pool = ThreadPool::Create(frame_threads);
   if (*frame_thread_pool == nullptr) {
@@ -186,37 +288,16 @@ bool InitializeThreadPoolsForFrameParallel(
                  frame_threads);
     return false;
   }
-  int remaining_threads = thread_count - frame_threads;
-  if (remaining_threads == 0) return true;
-  int threads_per_frame = remaining_threads / frame_threads;
-  const int extra_threads = remaining_threads % frame_threads;
-  Vector<std::unique_ptr<FrameScratchBuffer>> frame_scratch_buffers;
-  if (!frame_scratch_buffers.reserve(frame_threads)) return false;
-  // Create the tile thread pools.
-  for (int i = 0; i < frame_threads && remaining_threads > 0; ++i) {
-    std::unique_ptr<FrameScratchBuffer> frame_scratch_buffer =
-        frame_scratch_buffer_pool->Get();
-    if (frame_scratch_buffer == nullptr) {
-      return false;
-    }
-    // If the number of tile threads cannot be divided equally amongst all the
-    // frame threads, assign one extra thread to the first |extra_threads| frame
-    // threads.
-    const int current_frame_thread_count =
-        threads_per_frame + static_cast<int>(i < extra_threads);
-    if (!frame_scratch_buffer->threading_strategy.Reset(
-            current_frame_thread_count)) {
+  const int worker_threads = thread_count - frame_threads;
+  if (worker_threads > 0) {
+    *worker_thread_pool = ThreadPool::Create("libgav1-fp", worker_threads);
+    if (*worker_thread_pool == nullptr) {
+      LIBGAV1_DLOG(ERROR, "Failed to create a thread pool with %d threads.",
+                   worker_threads);
       return false;
     }
-    remaining_threads -= current_frame_thread_count;
-    frame_scratch_buffers.push_back_unchecked(std::move(frame_scratch_buffer));
-  }
-  // We release the frame scratch buffers in reverse order so that the extra
-  // threads are allocated to buffers in the top of the stack.
-  for (int i = static_cast<int>(frame_scratch_buffers.size()) - 1; i >= 0;
-       --i) {
-    frame_scratch_buffer_pool->Release(std::move(frame_scratch_buffers[i]));
   }
+  balancer->Init(frame_threads, worker_threads);
   return true;
 }
 
@@ -17,7 +17,10 @@
 #ifndef LIBGAV1_SRC_THREADING_STRATEGY_H_
 #define LIBGAV1_SRC_THREADING_STRATEGY_H_
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <mutex>  // NOLINT (unapproved c++11 header)
 
 #include "src/obu_parser.h"
 #include "src/utils/compiler_attributes.h"
@@ -25,8 +28,6 @@
 
 namespace libgav1 {
 
-class FrameScratchBufferPool;
-
 // This class allocates and manages the worker threads among thread pools used
 // for multi-threaded decoding.
 class ThreadingStrategy {
@@ -47,18 +48,29 @@ class ThreadingStrategy {
   //   * One thread is allocated for decoding each Tile.
   //   * Any remaining threads are allocated for superblock row multi-threading
   //     within each of the tile in a round robin fashion.
+  // If |schedule_job| is not nullptr, no threads are created. The thread pool
+  // runs its jobs on the caller-owned executor instead (see
+  // ThreadPool::CreateOnExecutor()) and the threads above are the threads of
+  // the executor that the thread pool may use at a time.
   // Note: During the lifetime of a ThreadingStrategy object, only one of the
   // Reset() variants will be used.
-  LIBGAV1_MUST_USE_RESULT bool Reset(const ObuFrameHeader& frame_header,
-                                     int thread_count);
-
-  // Creates or re-allocates a thread pool with |thread_count| threads. This
-  // function is used only in frame parallel mode. This function is idempotent
-  // if the |thread_count| doesn't change between calls (it will only create new
-  // threads on the first call and do nothing on the subsequent calls).
+  LIBGAV1_MUST_USE_RESULT bool Reset(
+      const ObuFrameHeader& frame_header, int thread_count,
+      ThreadPool::ScheduleJobFunction schedule_job = nullptr,
+      void* executor_private_data = nullptr);
+
+  // Creates or re-allocates a thread pool that runs its jobs on at most
+  // |thread_count| of the worker threads of |worker_thread_pool|. The
+  // |worker_thread_pool| is shared by all the frame threads and no threads are
+  // created by this function. If |thread_count| is 0, thread_pool() returns
+  // nullptr. This function is used only in frame parallel mode, where it is
+  // called whenever a frame starts decoding with the number of worker threads
+  // that the FrameParallelThreadBalancer granted to it. This function is
+  // idempotent if the arguments don't change between calls.
   // Note: During the lifetime of a ThreadingStrategy object, only one of the
   // Reset() variants will be used.
-  LIBGAV1_MUST_USE_RESULT bool Reset(int thread_count);
+  LIBGAV1_MUST_USE_RESULT bool Reset(ThreadPool* worker_thread_pool,
+                                     int thread_count);
 
   // Returns a pointer to the ThreadPool that is to be used for Tile
   // multi-threading.
@@ -95,36 +107,138 @@ class ThreadingStrategy {
 
  private:
   std::unique_ptr<ThreadPool> thread_pool_;
+  // The executor of |thread_pool_| in frame parallel mode.
+  ThreadPool* worker_thread_pool_ = nullptr;
   int tile_thread_count_ = 0;
   int max_tile_index_for_row_threads_ = 0;
   bool frame_parallel_ = false;
 };
 
-// Initializes the |frame_thread_pool| and the necessary worker threadpools (the
-// threading_strategy objects in each of the frame scratch buffer in
-// |frame_scratch_buffer_pool|) as follows:
+// Distributes the worker threads that are shared by the frame threads in frame
+// parallel mode among the frames that are being decoded, and adapts the number
+// of frames that are decoded in parallel to the measured stall times. This
+// class is thread safe.
+//
+// A frame acquires its worker threads when it starts decoding and releases
+// them when it is done. A frame is granted at most one worker thread per tile
+// (more cannot be kept busy by tile parsing and superblock row decoding) and at
+// most its share of the worker threads given the current number of frames in
+// flight. The worker threads granted to all the frames never exceed the size
+// of the worker thread pool, so a job of a frame never waits for a worker
+// thread that is blocked on a later frame.
+//
+// The number of frames in flight follows the tile layout of the frames. When a
+// frame starts with a different tile count than the frames before it (and for
+// the first frame), it is set to the number of frames that can each use a
+// worker thread per tile, between 2 and the number of frame threads. From
+// there it is re-evaluated every kAdaptationInterval frames based on the stall
+// times reported by ReleaseWorkers():
+//   * If the frames spend most of their thread time waiting for their
+//     reference frames, or if they are starved of worker threads (the post
+//     filter waits on superblock rows and the frames got fewer worker threads
+//     than they have tiles), it is decreased so that each frame gets a larger
+//     share of the worker threads.
+//   * If the frames rarely wait for their reference frames, it is increased
+//     back towards the number of frame threads.
+// This keeps the split between frame, tile and superblock row parallelism in
+// line with the tile layout of the stream, which may change at any frame, and
+// with how much the frames actually depend on each other.
+class FrameParallelThreadBalancer {
+ public:
+  FrameParallelThreadBalancer() = default;
+
+  // Not copyable or movable.
+  FrameParallelThreadBalancer(const FrameParallelThreadBalancer&) = delete;
+  FrameParallelThreadBalancer& operator=(const FrameParallelThreadBalancer&) =
+      delete;
+
+  // Starts with |frame_threads| frames in flight and |worker_threads| free
+  // worker threads, until the first frame acquires its worker threads.
+  // |frame_threads| must be at least 2.
+  void Init(int frame_threads, int worker_threads);
+
+  // Returns the number of worker threads (possibly 0) granted to a frame with
+  // |frame_header|. The caller must return them with ReleaseWorkers() once the
+  // frame no longer uses them. Resets the number of frames in flight if the
+  // tile count of the frame differs from that of the previous frame.
+  int AcquireWorkers(const ObuFrameHeader& frame_header);
+
+  // Returns the |num_workers| worker threads granted by AcquireWorkers() and
+  // reports the stall times of the frame. |decode_time_ns| is the wall time it
+  // took to decode the frame, |reference_wait_time_ns| is the total time its
+  // threads were blocked on the reference frames and |row_wait_time_ns| is the
+  // time its post filter thread was blocked on superblock rows.
+  void ReleaseWorkers(int num_workers, int64_t decode_time_ns,
+                      int64_t reference_wait_time_ns, int64_t row_wait_time_ns);
+
+  // Returns the number of frames that should be decoded in parallel. It is
+  // between 2 and the number of frame threads.
+  int max_frames_in_flight() const { return max_frames_in_flight_.load(); }
+
+ private:
+  // The number of frames after which the number of frames in flight is
+  // re-evaluated.
+  static constexpr int kAdaptationInterval = 8;
+
+  // Re-evaluates |max_frames_in_flight_| from the stall times accumulated in
+  // the last kAdaptationInterval frames.
+  // Must be called with |mutex_| held.
+  void Adapt();
+
+  // Clears the statistics that Adapt() uses.
+  // Must be called with |mutex_| held.
+  void ClearStats();
+
+  std::mutex mutex_;
+  int frame_threads_ = 0;
+  int worker_threads_ = 0;
+  int free_workers_ LIBGAV1_GUARDED_BY(mutex_) = 0;
+  std::atomic<int> max_frames_in_flight_{0};
+  // The tile count of the frame that last acquired worker threads. 0 before
+  // the first frame.
+  int tile_count_ LIBGAV1_GUARDED_BY(mutex_) = 0;
+  // Statistics of the frames that were released since the last call to
+  // Adapt().
+  int num_frames_ LIBGAV1_GUARDED_BY(mutex_) = 0;
+  // The number of frames that were granted fewer worker threads than they
+  // have tiles since the last call to Adapt().
+  int num_starved_frames_ LIBGAV1_GUARDED_BY(mutex_) = 0;
+  // Thread time (decode time multiplied by the number of threads, including
+  // the frame thread) and the part of it that was spent waiting for the
+  // reference frames.
+  int64_t thread_time_ns_ LIBGAV1_GUARDED_BY(mutex_) = 0;
+  int64_t reference_wait_time_ns_ LIBGAV1_GUARDED_BY(mutex_) = 0;
+  // Wall time of the frames and the part of it that the post filter thread
+  // spent waiting for superblock rows.
+  int64_t decode_time_ns_ LIBGAV1_GUARDED_BY(mutex_) = 0;
+  int64_t row_wait_time_ns_ LIBGAV1_GUARDED_BY(mutex_) = 0;
+};
+
+// Initializes the |frame_thread_pool|, the |worker_thread_pool| and the
+// |balancer| for frame parallel decoding as follows:
 //  * frame_threads = ComputeFrameThreadCount();
 //  * For more details on how frame_threads is computed, see the function
-//    comment in ComputeFrameThreadCount().
+//    comment in ComputeFrameThreadCount(). It only depends on |thread_count|,
+//    since the tile layout may change at any frame. The |balancer| adapts the
+//    number of frames in flight to the tile layout of each frame.
 //  * |frame_thread_pool| is created with |frame_threads| threads.
-//  * divide the remaining number of threads into each frame thread and
-//    initialize a frame_scratch_buffer.threading_strategy for each frame
-//    thread.
-//  When this function is called, |frame_scratch_buffer_pool| must be empty. If
-//  this function returns true, it means the initialization was successful and
-//  one of the following is true:
-//    * |frame_thread_pool| has been successfully initialized and
-//      |frame_scratch_buffer_pool| has been successfully populated with
-//      |frame_threads| buffers to be used by each frame thread. The total
-//      number of threads that this function creates will always be equal to
-//      |thread_count|.
-//    * |frame_thread_pool| is nullptr. |frame_scratch_buffer_pool| is not
-//      modified. This means that frame threading will not be used and the
+//  * |worker_thread_pool| is created with the remaining number of threads. It
+//    is shared by all the frame threads for in-frame multi-threading. The
+//    worker threads are handed out to the frames at runtime by |balancer|
+//    (see FrameParallelThreadBalancer and ThreadingStrategy::Reset()).
+//  If this function returns true, it means the initialization was successful
+//  and one of the following is true:
+//    * |frame_thread_pool| has been successfully initialized. The total number
+//      of threads that this function creates will always be equal to
+//      |thread_count|. |worker_thread_pool| is nullptr if there are no
+//      remaining threads.
+//    * |frame_thread_pool| is nullptr. |worker_thread_pool| and |balancer| are
+//      not modified. This means that frame threading will not be used and the
 //      decoder will continue to operate normally in non frame parallel mode.
 LIBGAV1_MUST_USE_RESULT bool InitializeThreadPoolsForFrameParallel(
-    int thread_count, int tile_count, int tile_columns,
-    std::unique_ptr<ThreadPool>* frame_thread_pool,
-    FrameScratchBufferPool* frame_scratch_buffer_pool);
+    int thread_count, std::unique_ptr<ThreadPool>* frame_thread_pool,
+    std::unique_ptr<ThreadPool>* worker_thread_pool,
+    FrameParallelThreadBalancer* balancer);
 
 }  // namespace libgav1
 
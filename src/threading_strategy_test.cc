@@ -14,14 +14,15 @@
 
 #include "src/threading_strategy.h"
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
-#include <utility>
 #include <vector>
 
 #include "absl/strings/str_cat.h"
 #include "gtest/gtest.h"
-#include "src/frame_scratch_buffer.h"
 #include "src/obu_parser.h"
+#include "src/utils/blocking_counter.h"
 #include "src/utils/constants.h"
 #include "src/utils/threadpool.h"
 #include "src/utils/types.h"
@@ -191,111 +192,282 @@ TEST_F(ThreadingStrategyTest, MultipleCalls2) {
   EXPECT_NE(strategy_.post_filter_thread_pool(), nullptr);
 }
 
-void VerifyFrameParallel(int thread_count, int tile_count, int tile_columns,
+// Verifies the thread pools created by InitializeThreadPoolsForFrameParallel()
+// and the worker threads granted to the frames with |tile_count| tiles that
+// start decoding one after another, with all of them in flight.
+void VerifyFrameParallel(int thread_count, int tile_count,
                          int expected_frame_threads,
-                         const std::vector<int>& expected_tile_threads) {
-  ASSERT_EQ(expected_frame_threads, expected_tile_threads.size());
+                         const std::vector<int>& expected_worker_threads) {
   ASSERT_GT(thread_count, 1);
   std::unique_ptr<ThreadPool> frame_thread_pool;
-  FrameScratchBufferPool frame_scratch_buffer_pool;
+  std::unique_ptr<ThreadPool> worker_thread_pool;
+  FrameParallelThreadBalancer balancer;
   ASSERT_TRUE(InitializeThreadPoolsForFrameParallel(
-      thread_count, tile_count, tile_columns, &frame_thread_pool,
-      &frame_scratch_buffer_pool));
+      thread_count, &frame_thread_pool, &worker_thread_pool, &balancer));
   if (expected_frame_threads == 0) {
     EXPECT_EQ(frame_thread_pool, nullptr);
+    EXPECT_EQ(worker_thread_pool, nullptr);
     return;
   }
   EXPECT_NE(frame_thread_pool.get(), nullptr);
   EXPECT_EQ(frame_thread_pool->num_threads(), expected_frame_threads);
-  std::vector<std::unique_ptr<FrameScratchBuffer>> frame_scratch_buffers;
+  EXPECT_EQ(balancer.max_frames_in_flight(), expected_frame_threads);
   int actual_thread_count = frame_thread_pool->num_threads();
-  for (int i = 0; i < expected_frame_threads; ++i) {
+  if (worker_thread_pool != nullptr) {
+    actual_thread_count += worker_thread_pool->num_threads();
+  }
+  EXPECT_EQ(thread_count, actual_thread_count);
+
+  ObuFrameHeader frame_header = {};
+  frame_header.tile_info.tile_count = tile_count;
+  const int frames_in_flight = static_cast<int>(expected_worker_threads.size());
+  std::vector<ThreadingStrategy> strategies(frames_in_flight);
+  std::vector<int> worker_threads;
+  for (int i = 0; i < frames_in_flight; ++i) {
     SCOPED_TRACE(absl::StrCat("i: ", i));
-    frame_scratch_buffers.push_back(frame_scratch_buffer_pool.Get());
-    ThreadPool* const thread_pool =
-        frame_scratch_buffers.back()->threading_strategy.thread_pool();
-    if (expected_tile_threads[i] > 0) {
-      EXPECT_NE(thread_pool, nullptr);
-      EXPECT_EQ(thread_pool->num_threads(), expected_tile_threads[i]);
-      actual_thread_count += thread_pool->num_threads();
+    worker_threads.push_back(balancer.AcquireWorkers(frame_header));
+    // The first frame sets the number of frames in flight for its tile count.
+    EXPECT_EQ(balancer.max_frames_in_flight(), frames_in_flight);
+    EXPECT_EQ(worker_threads.back(), expected_worker_threads[i]);
+    ASSERT_TRUE(
+        strategies[i].Reset(worker_thread_pool.get(), worker_threads.back()));
+    ThreadPool* const thread_pool = strategies[i].thread_pool();
+    if (expected_worker_threads[i] > 0) {
+      ASSERT_NE(thread_pool, nullptr);
+      EXPECT_EQ(thread_pool->num_threads(), expected_worker_threads[i]);
     } else {
       EXPECT_EQ(thread_pool, nullptr);
     }
+    EXPECT_EQ(strategies[i].tile_thread_pool(), nullptr);
+    EXPECT_EQ(strategies[i].row_thread_pool(0), nullptr);
+    EXPECT_EQ(strategies[i].post_filter_thread_pool(), nullptr);
   }
-  EXPECT_EQ(thread_count, actual_thread_count);
-  for (auto& frame_scratch_buffer : frame_scratch_buffers) {
-    frame_scratch_buffer_pool.Release(std::move(frame_scratch_buffer));
+  for (const int num_workers : worker_threads) {
+    balancer.ReleaseWorkers(num_workers, /*decode_time_ns=*/0,
+                            /*reference_wait_time_ns=*/0,
+                            /*row_wait_time_ns=*/0);
   }
 }
 
 TEST(FrameParallelStrategyTest, FrameParallel) {
-  // This loop has thread_count <= 3 * tile count. So there should be no frame
-  // threads irrespective of the number of tile columns.
-  for (int thread_count = 2; thread_count <= 6; ++thread_count) {
-    VerifyFrameParallel(thread_count, /*tile_count=*/2, /*tile_columns=*/1,
+  // With thread_count <= 3 there are no frame threads irrespective of the
+  // number of tiles.
+  for (int thread_count = 2; thread_count <= 3; ++thread_count) {
+    VerifyFrameParallel(thread_count, /*tile_count=*/1,
                         /*expected_frame_threads=*/0,
-                        /*expected_tile_threads=*/{});
-    VerifyFrameParallel(thread_count, /*tile_count=*/2, /*tile_columns=*/2,
-                        /*expected_frame_threads=*/0,
-                        /*expected_tile_threads=*/{});
+                        /*expected_worker_threads=*/{});
   }
 
-  // Equal number of tile threads for each frame thread.
-  VerifyFrameParallel(
-      /*thread_count=*/8, /*tile_count=*/1, /*tile_columns=*/1,
-      /*expected_frame_threads=*/4, /*expected_tile_threads=*/{1, 1, 1, 1});
-  VerifyFrameParallel(
-      /*thread_count=*/12, /*tile_count=*/2, /*tile_columns=*/2,
-      /*expected_frame_threads=*/4, /*expected_tile_threads=*/{2, 2, 2, 2});
-  VerifyFrameParallel(
-      /*thread_count=*/18, /*tile_count=*/2, /*tile_columns=*/2,
-      /*expected_frame_threads=*/6,
-      /*expected_tile_threads=*/{2, 2, 2, 2, 2, 2});
-  VerifyFrameParallel(
-      /*thread_count=*/16, /*tile_count=*/3, /*tile_columns=*/3,
-      /*expected_frame_threads=*/4, /*expected_tile_threads=*/{3, 3, 3, 3});
-
-  // Unequal number of tile threads for each frame thread.
-  VerifyFrameParallel(
-      /*thread_count=*/7, /*tile_count=*/1, /*tile_columns=*/1,
-      /*expected_frame_threads=*/3, /*expected_tile_threads=*/{2, 1, 1});
-  VerifyFrameParallel(
-      /*thread_count=*/14, /*tile_count=*/2, /*tile_columns=*/2,
-      /*expected_frame_threads=*/4, /*expected_tile_threads=*/{3, 3, 2, 2});
-  VerifyFrameParallel(
-      /*thread_count=*/20, /*tile_count=*/2, /*tile_columns=*/2,
-      /*expected_frame_threads=*/6,
-      /*expected_tile_threads=*/{3, 3, 2, 2, 2, 2});
-  VerifyFrameParallel(
-      /*thread_count=*/17, /*tile_count=*/3, /*tile_columns=*/3,
-      /*expected_frame_threads=*/4, /*expected_tile_threads=*/{4, 3, 3, 3});
+  // Half of the threads are frame threads. The frames with a single tile are
+  // all in flight and each gets one worker thread.
+  VerifyFrameParallel(/*thread_count=*/4, /*tile_count=*/1,
+                      /*expected_frame_threads=*/2,
+                      /*expected_worker_threads=*/{1, 1});
+  VerifyFrameParallel(/*thread_count=*/8, /*tile_count=*/1,
+                      /*expected_frame_threads=*/4,
+                      /*expected_worker_threads=*/{1, 1, 1, 1});
+  // A frame gets at most one worker thread per tile. The rest of the worker
+  // threads stay available to the frames with more tiles.
+  VerifyFrameParallel(/*thread_count=*/7, /*tile_count=*/1,
+                      /*expected_frame_threads=*/3,
+                      /*expected_worker_threads=*/{1, 1, 1});
+
+  // Frames with more tiles are decoded fewer at a time, so that each of them
+  // can use a worker thread per tile. The share is rounded up, so the last
+  // frames in flight get the worker threads that are left.
+  VerifyFrameParallel(/*thread_count=*/6, /*tile_count=*/2,
+                      /*expected_frame_threads=*/3,
+                      /*expected_worker_threads=*/{2, 1});
+  VerifyFrameParallel(/*thread_count=*/12, /*tile_count=*/2,
+                      /*expected_frame_threads=*/6,
+                      /*expected_worker_threads=*/{2, 2, 2, 0});
+  VerifyFrameParallel(/*thread_count=*/18, /*tile_count=*/2,
+                      /*expected_frame_threads=*/9,
+                      /*expected_worker_threads=*/{2, 2, 2, 2, 1, 0});
+  VerifyFrameParallel(/*thread_count=*/16, /*tile_count=*/3,
+                      /*expected_frame_threads=*/8,
+                      /*expected_worker_threads=*/{2, 2, 2, 2});
+  VerifyFrameParallel(/*thread_count=*/16, /*tile_count=*/4,
+                      /*expected_frame_threads=*/8,
+                      /*expected_worker_threads=*/{3, 3, 2});
+  // There are always at least two frames in flight.
+  VerifyFrameParallel(/*thread_count=*/29, /*tile_count=*/8,
+                      /*expected_frame_threads=*/14,
+                      /*expected_worker_threads=*/{5, 5, 5});
+  VerifyFrameParallel(/*thread_count=*/8, /*tile_count=*/8,
+                      /*expected_frame_threads=*/4,
+                      /*expected_worker_threads=*/{2, 2});
 }
 
 TEST(FrameParallelStrategyTest, ThreadCountDoesNotExceedkMaxThreads) {
   std::unique_ptr<ThreadPool> frame_thread_pool;
-  FrameScratchBufferPool frame_scratch_buffer_pool;
+  std::unique_ptr<ThreadPool> worker_thread_pool;
+  FrameParallelThreadBalancer balancer;
   ASSERT_TRUE(InitializeThreadPoolsForFrameParallel(
-      /*thread_count=*/kMaxThreads + 10, /*tile_count=*/2, /*tile_columns=*/2,
-      &frame_thread_pool, &frame_scratch_buffer_pool));
+      /*thread_count=*/kMaxThreads + 10, &frame_thread_pool,
+      &worker_thread_pool, &balancer));
   EXPECT_NE(frame_thread_pool.get(), nullptr);
-  std::vector<std::unique_ptr<FrameScratchBuffer>> frame_scratch_buffers;
   int actual_thread_count = frame_thread_pool->num_threads();
-  for (int i = 0; i < frame_thread_pool->num_threads(); ++i) {
-    SCOPED_TRACE(absl::StrCat("i: ", i));
-    frame_scratch_buffers.push_back(frame_scratch_buffer_pool.Get());
-    ThreadPool* const thread_pool =
-        frame_scratch_buffers.back()->threading_strategy.thread_pool();
-    if (thread_pool != nullptr) {
-      actual_thread_count += thread_pool->num_threads();
-    }
+  if (worker_thread_pool != nullptr) {
+    actual_thread_count += worker_thread_pool->num_threads();
   }
-  // In this case, the exact number of frame threads and tile threads depend on
-  // the value of kMaxThreads. So simply ensure that the total number of threads
-  // does not exceed kMaxThreads.
+  // In this case, the exact number of frame threads and worker threads depend
+  // on the value of kMaxThreads. So simply ensure that the total number of
+  // threads does not exceed kMaxThreads.
   EXPECT_LE(actual_thread_count, kMaxThreads);
-  for (auto& frame_scratch_buffer : frame_scratch_buffers) {
-    frame_scratch_buffer_pool.Release(std::move(frame_scratch_buffer));
+}
+
+TEST(FrameParallelStrategyTest, ResetIsIdempotent) {
+  std::unique_ptr<ThreadPool> worker_thread_pool = ThreadPool::Create(4);
+  ASSERT_NE(worker_thread_pool, nullptr);
+  ThreadingStrategy strategy;
+  ASSERT_TRUE(strategy.Reset(worker_thread_pool.get(), 2));
+  ThreadPool* const thread_pool = strategy.thread_pool();
+  ASSERT_NE(thread_pool, nullptr);
+  ASSERT_TRUE(strategy.Reset(worker_thread_pool.get(), 2));
+  EXPECT_EQ(strategy.thread_pool(), thread_pool);
+  ASSERT_TRUE(strategy.Reset(worker_thread_pool.get(), 3));
+  ASSERT_NE(strategy.thread_pool(), nullptr);
+  EXPECT_EQ(strategy.thread_pool()->num_threads(), 3);
+  ASSERT_TRUE(strategy.Reset(worker_thread_pool.get(), 0));
+  EXPECT_EQ(strategy.thread_pool(), nullptr);
+}
+
+TEST(FrameParallelStrategyTest, JobsRunOnWorkerThreads) {
+  std::unique_ptr<ThreadPool> worker_thread_pool = ThreadPool::Create(3);
+  ASSERT_NE(worker_thread_pool, nullptr);
+  constexpr int kNumJobs = 100;
+  std::atomic<int> count(0);
+  ThreadingStrategy strategies[2];
+  for (auto& strategy : strategies) {
+    ASSERT_TRUE(strategy.Reset(worker_thread_pool.get(), 2));
+  }
+  {
+    BlockingCounter pending_jobs(2 * kNumJobs);
+    for (int i = 0; i < kNumJobs; ++i) {
+      for (auto& strategy : strategies) {
+        strategy.thread_pool()->Schedule([&count, &pending_jobs]() {
+          ++count;
+          pending_jobs.Decrement();
+        });
+      }
+    }
+    pending_jobs.Wait();
   }
+  EXPECT_EQ(count, 2 * kNumJobs);
+}
+
+// Acquires and releases the worker threads of |kAdaptationInterval| (8)
+// frames with |tile_count| tiles, each of which reports the given stall times
+// for a decode time of 1000 ns.
+void DecodeFrames(FrameParallelThreadBalancer* balancer, int tile_count,
+                  int64_t reference_wait_time_ns, int64_t row_wait_time_ns) {
+  ObuFrameHeader frame_header = {};
+  frame_header.tile_info.tile_count = tile_count;
+  for (int i = 0; i < 8; ++i) {
+    const int num_workers = balancer->AcquireWorkers(frame_header);
+    balancer->ReleaseWorkers(num_workers, /*decode_time_ns=*/1000,
+                             reference_wait_time_ns, row_wait_time_ns);
+  }
+}
+
+TEST(FrameParallelThreadBalancerTest, WorkersAreLimitedByFreeWorkers) {
+  FrameParallelThreadBalancer balancer;
+  balancer.Init(/*frame_threads=*/3, /*worker_threads=*/4);
+  ObuFrameHeader frame_header = {};
+  frame_header.tile_info.tile_count = 8;
+  EXPECT_EQ(balancer.AcquireWorkers(frame_header), 2);
+  EXPECT_EQ(balancer.AcquireWorkers(frame_header), 2);
+  EXPECT_EQ(balancer.AcquireWorkers(frame_header), 0);
+  balancer.ReleaseWorkers(2, 0, 0, 0);
+  EXPECT_EQ(balancer.AcquireWorkers(frame_header), 2);
+  // A frame with a single tile never gets more than one worker thread.
+  balancer.ReleaseWorkers(2, 0, 0, 0);
+  balancer.ReleaseWorkers(2, 0, 0, 0);
+  frame_header.tile_info.tile_count = 1;
+  EXPECT_EQ(balancer.AcquireWorkers(frame_header), 1);
+}
+
+TEST(FrameParallelThreadBalancerTest, ReferenceStalls) {
+  FrameParallelThreadBalancer balancer;
+  balancer.Init(/*frame_threads=*/4, /*worker_threads=*/8);
+  EXPECT_EQ(balancer.max_frames_in_flight(), 4);
+  // Each frame gets 2 worker threads, so its thread time is 3000 ns. Waiting
+  // 2000 ns on the reference frames makes it reference bound.
+  DecodeFrames(&balancer, /*tile_count=*/2, /*reference_wait_time_ns=*/2000,
+               /*row_wait_time_ns=*/0);
+  EXPECT_EQ(balancer.max_frames_in_flight(), 3);
+  DecodeFrames(&balancer, /*tile_count=*/2, /*reference_wait_time_ns=*/2000,
+               /*row_wait_time_ns=*/0);
+  EXPECT_EQ(balancer.max_frames_in_flight(), 2);
+  // There are always at least two frames in flight.
+  DecodeFrames(&balancer, /*tile_count=*/2, /*reference_wait_time_ns=*/2000,
+               /*row_wait_time_ns=*/0);
+  EXPECT_EQ(balancer.max_frames_in_flight(), 2);
+  // Moderate stalls leave the number of frames in flight unchanged.
+  DecodeFrames(&balancer, /*tile_count=*/2, /*reference_wait_time_ns=*/1000,
+               /*row_wait_time_ns=*/0);
+  EXPECT_EQ(balancer.max_frames_in_flight(), 2);
+  // Without stalls, the number of frames in flight goes back up to the number
+  // of frame threads.
+  DecodeFrames(&balancer, /*tile_count=*/2, /*reference_wait_time_ns=*/0,
+               /*row_wait_time_ns=*/0);
+  EXPECT_EQ(balancer.max_frames_in_flight(), 3);
+  DecodeFrames(&balancer, /*tile_count=*/2, /*reference_wait_time_ns=*/0,
+               /*row_wait_time_ns=*/0);
+  EXPECT_EQ(balancer.max_frames_in_flight(), 4);
+  DecodeFrames(&balancer, /*tile_count=*/2, /*reference_wait_time_ns=*/0,
+               /*row_wait_time_ns=*/0);
+  EXPECT_EQ(balancer.max_frames_in_flight(), 4);
+}
+
+TEST(FrameParallelThreadBalancerTest, StarvedFrames) {
+  FrameParallelThreadBalancer balancer;
+  balancer.Init(/*frame_threads=*/8, /*worker_threads=*/8);
+  ObuFrameHeader frame_header = {};
+  frame_header.tile_info.tile_count = 4;
+  EXPECT_EQ(balancer.AcquireWorkers(frame_header), 3);
+  EXPECT_EQ(balancer.max_frames_in_flight(), 3);
+  balancer.ReleaseWorkers(3, 0, 0, 0);
+  // The frames have more tiles than worker threads and their post filter
+  // waits on the superblock rows most of the time.
+  DecodeFrames(&balancer, /*tile_count=*/4, /*reference_wait_time_ns=*/0,
+               /*row_wait_time_ns=*/600);
+  EXPECT_EQ(balancer.max_frames_in_flight(), 2);
+  EXPECT_EQ(balancer.AcquireWorkers(frame_header), 4);
+  balancer.ReleaseWorkers(4, 0, 0, 0);
+  // Row stalls alone (without starvation) do not reduce the number of frames
+  // in flight.
+  balancer.Init(/*frame_threads=*/4, /*worker_threads=*/16);
+  DecodeFrames(&balancer, /*tile_count=*/4, /*reference_wait_time_ns=*/0,
+               /*row_wait_time_ns=*/600);
+  EXPECT_EQ(balancer.max_frames_in_flight(), 4);
+}
+
+TEST(FrameParallelThreadBalancerTest, TileLayoutChanges) {
+  FrameParallelThreadBalancer balancer;
+  balancer.Init(/*frame_threads=*/8, /*worker_threads=*/8);
+  ObuFrameHeader frame_header = {};
+  frame_header.tile_info.tile_count = 1;
+  EXPECT_EQ(balancer.AcquireWorkers(frame_header), 1);
+  EXPECT_EQ(balancer.max_frames_in_flight(), 8);
+  balancer.ReleaseWorkers(1, 0, 0, 0);
+  // The reference stalls of the single tile frames reduce the number of frames
+  // in flight.
+  DecodeFrames(&balancer, /*tile_count=*/1, /*reference_wait_time_ns=*/2000,
+               /*row_wait_time_ns=*/0);
+  EXPECT_EQ(balancer.max_frames_in_flight(), 7);
+  // A frame with more tiles sets the number of frames in flight for its tile
+  // layout right away, without waiting for the stall times.
+  frame_header.tile_info.tile_count = 4;
+  EXPECT_EQ(balancer.AcquireWorkers(frame_header), 3);
+  EXPECT_EQ(balancer.max_frames_in_flight(), 3);
+  balancer.ReleaseWorkers(3, 0, 0, 0);
+  // And so does a frame with a single tile again.
+  frame_header.tile_info.tile_count = 1;
+  EXPECT_EQ(balancer.AcquireWorkers(frame_header), 1);
+  EXPECT_EQ(balancer.max_frames_in_flight(), 8);
+  balancer.ReleaseWorkers(1, 0, 0, 0);
 }
 
 }  // namespace
@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <cmath>
 #include <condition_variable>  // NOLINT (unapproved c++11 header)
@@ -33,6 +34,7 @@
 #include "src/dsp/constants.h"
 #include "src/dsp/dsp.h"
 #include "src/frame_scratch_buffer.h"
+#include "src/frame_stats_collector.h"
 #include "src/loop_restoration_info.h"
 #include "src/obu_parser.h"
 #include "src/post_filter.h"
@@ -65,11 +67,16 @@ enum ProcessingMode {
   kProcessingModeParseAndDecode,
 };
 
-// The alignment requirement is due to the SymbolDecoderContext member
-// symbol_decoder_context_.
-class Tile : public MaxAlignedAllocable {
+// The Tile objects are constructed in FrameScratchBuffer::tile_memory, which
+// meets the alignment requirement of the SymbolDecoderContext member
+// own_symbol_decoder_context_.
+class Tile {
  public:
-  static std::unique_ptr<Tile> Create(
+  // Constructs the tile with the number |tile_number| in the memory that
+  // |frame_scratch_buffer| holds for it (see FrameScratchBuffer::tile_memory).
+  // Returns nullptr on failure. The tile must be destroyed by calling its
+  // destructor explicitly.
+  static Tile* Create(
       int tile_number, const uint8_t* const data, size_t size,
       const ObuSequenceHeader& sequence_header,
       const ObuFrameHeader& frame_header, RefCountedBuffer* const current_frame,
@@ -81,13 +88,23 @@ class Tile : public MaxAlignedAllocable {
       const dsp::Dsp* const dsp, ThreadPool* const thread_pool,
       BlockingCounterWithStatus* const pending_tiles, bool frame_parallel,
       bool use_intra_prediction_buffer, bool parse_only) {
-    std::unique_ptr<Tile> tile(new (std::nothrow) Tile(
-        tile_number, data, size, sequence_header, frame_header, current_frame,
-        state, frame_scratch_buffer, wedge_masks, quantizer_matrix,
-        saved_symbol_decoder_context, prev_segment_ids, post_filter, dsp,
-        thread_pool, pending_tiles, frame_parallel, use_intra_prediction_buffer,
-        parse_only));
-    return (tile != nullptr && tile->Init()) ? std::move(tile) : nullptr;
+    static_assert(alignof(Tile) <= kMaxAlignment, "");
+    assert(frame_scratch_buffer->tile_memory.size() >=
+           (tile_number + 1) * sizeof(Tile));
+    assert(frame_scratch_buffer->tile_buffers.size() >
+           static_cast<size_t>(tile_number));
+    Tile* const tile = ::new (frame_scratch_buffer->tile_memory.get() +
+                              tile_number * sizeof(Tile))
+        Tile(tile_number, data, size, sequence_header, frame_header,
+             current_frame, state, frame_scratch_buffer, wedge_masks,
+             quantizer_matrix, saved_symbol_decoder_context, prev_segment_ids,
+             post_filter, dsp, thread_pool, pending_tiles, frame_parallel,
+             use_intra_prediction_buffer, parse_only);
+    if (!tile->Init()) {
+      tile->~Tile();
+      return nullptr;
+    }
+    return tile;
   }
 
   // Move only.
@@ -212,24 +229,20 @@ class Tile : public MaxAlignedAllocable {
     int depth;
   };
 
-  // Enum to track the processing state of a superblock.
-  enum SuperBlockState : uint8_t {
-    kSuperBlockStateNone,       // Not yet parsed or decoded.
-    kSuperBlockStateParsed,     // Parsed but not yet decoded.
-    kSuperBlockStateScheduled,  // Scheduled for decoding.
-    kSuperBlockStateDecoded     // Parsed and decoded.
-  };
-
-  // Parameters used to facilitate multi-threading within the Tile.
+  // Parameters used to facilitate multi-threading within the Tile. They are
+  // atomic so that the parsing thread and the decoding jobs do not have to
+  // take a lock for every superblock.
   struct ThreadingParameters {
-    std::mutex mutex;
     // 2d array of size |superblock_rows_| by |superblock_columns_| containing
-    // the processing state of each superblock.
-    Array2D<SuperBlockState> sb_state LIBGAV1_GUARDED_BY(mutex);
+    // the number of prerequisites of each superblock that are not satisfied
+    // yet (see DecodeDependencies()). The job that satisfies the last one
+    // schedules the decoding of the superblock. The memory is owned by
+    // |tile_buffers_|.
+    Array2DView<std::atomic<int>> sb_dependencies;
     // Variable used to indicate either parse or decode failure.
-    bool abort LIBGAV1_GUARDED_BY(mutex) = false;
-    int pending_jobs LIBGAV1_GUARDED_BY(mutex) = 0;
-    std::condition_variable pending_jobs_zero_condvar;
+    std::atomic<bool> abort{false};
+    // The parsing job and the scheduled decoding jobs that have not finished.
+    std::atomic<int> pending_jobs{0};
   };
 
   // The residual pointer is used to traverse the |residual_buffer_|. It is
@@ -266,24 +279,35 @@ class Tile : public MaxAlignedAllocable {
   // |saved_symbol_decoder_context_| if necessary.
   void SaveSymbolDecoderContext();
 
+  // Sets up the temporal motion field of this tile for the rows that have not
+  // been set up yet, up to |row4x4_end|. The motion field is set up one
+  // superblock row at a time, right before the superblock row is parsed.
+  void SetupMotionFieldRows(int row4x4_end);
+
   // Entry point for multi-threaded decoding. This function performs the same
   // functionality as ParseAndDecode(). The current thread does the "parse" step
   // while the worker threads do the "decode" step.
   bool ThreadedParseAndDecode();
 
-  // Returns whether or not the prerequisites for decoding the superblock at
-  // |row_index| and |column_index| are satisfied. |threading_.mutex| must be
-  // held when calling this function.
-  bool CanDecode(int row_index, int column_index) const;
+  // Returns the number of prerequisites for decoding the superblock at
+  // |row_index| and |column_index|: the superblock has to be parsed, and the
+  // superblock to the left of it (if one exists) and the superblock to the
+  // top right of it with a lag of |intra_block_copy_lag_| (if one exists) have
+  // to be decoded. The top right superblock is not counted when the superblock
+  // to the left of it depends on the same one.
+  int DecodeDependencies(int row_index, int column_index) const;
+
+  // Marks one of the prerequisites for decoding the superblock at |row_index|
+  // and |column_index| as satisfied. Schedules the decoding of the superblock
+  // if it was the last one.
+  void SatisfyDecodeDependency(int row_index, int column_index,
+                               int block_width4x4);
 
   // This function is run by the worker threads when multi-threaded decoding is
-  // enabled. Once a superblock is decoded, this function will set the
-  // corresponding |threading_.sb_state| entry to kSuperBlockStateDecoded. On
-  // failure, |threading_.abort| will be set to true. If at any point
-  // |threading_.abort| becomes true, this function will return as early as it
-  // can. If the decoding succeeds, this function will also schedule the
-  // decoding jobs for the superblock to the bottom-left and the superblock to
-  // the right of this superblock (if it is allowed).
+  // enabled. On failure, |threading_.abort| will be set to true. If the
+  // decoding succeeds, this function will also satisfy the dependencies of the
+  // superblock to the bottom-left and the superblock to the right of this
+  // superblock.
   void DecodeSuperBlock(int row_index, int column_index, int block_width4x4);
 
   // If |use_intra_prediction_buffer_| is true, then this function copies the
@@ -336,7 +360,8 @@ class Tile : public MaxAlignedAllocable {
   void ReadQuantizerIndexDelta(const Block& block);  // 5.11.12.
   void ReadLoopFilterDelta(const Block& block);      // 5.11.13.
   // Populates |BlockParameters::deblock_filter_level| for the given |block|
-  // using |deblock_filter_levels_|.
+  // using |deblock_filter_levels_|, and the DeblockParameters of its 4x4
+  // blocks. The other fields that the deblocking filter reads must be set.
   void PopulateDeblockFilterLevel(const Block& block);
   void PopulateCdefSkip(const Block& block);
   void ReadPredictionModeY(const Block& block, bool intra_y_mode);
@@ -632,6 +657,9 @@ class Tile : public MaxAlignedAllocable {
   int column4x4_end_;
   int superblock_rows_;
   int superblock_columns_;
+  // The rows of |motion_field_| in [row4x4_start_, motion_field_row4x4_) have
+  // been set up for this tile.
+  int motion_field_row4x4_;
   bool read_deltas_;
   const int8_t subsampling_x_[kMaxPlanes];
   const int8_t subsampling_y_[kMaxPlanes];
@@ -661,7 +689,11 @@ class Tile : public MaxAlignedAllocable {
   // GetTransformAllZeroContext. In that function, we only care about the
   // following values: 0, 1, 2, 3 and >= 4. So instead of clamping to 63, we
   // clamp to 4 (i.e.) all the values greater than 4 are stored as 4.
-  std::array<Array2D<uint8_t>, 2> coefficient_levels_;
+  //
+  // These arrays and the other buffers of the tile that are kept across frames
+  // are stored in |tile_buffers_|.
+  TileBuffers& tile_buffers_;
+  std::array<Array2D<uint8_t>, 2>& coefficient_levels_;
   // This is equivalent to the LeftDcContext and AboveDcContext arrays in the
   // spec. In the spec, it can store 3 possible values: 0, 1 and 2 (where 1
   // means the value is < 0, 2 means the value is > 0 and 0 means the value is
@@ -679,7 +711,7 @@ class Tile : public MaxAlignedAllocable {
   //
   // The usage on GetTransformAllZeroContext is unaffected since there we
   // only care about whether it is 0 or not.
-  std::array<Array2D<int8_t>, 2> dc_categories_;
+  std::array<Array2D<int8_t>, 2>& dc_categories_;
   const ObuSequenceHeader& sequence_header_;
   const ObuFrameHeader& frame_header_;
   const std::array<bool, kNumReferenceFrameTypes>& reference_frame_sign_bias_;
@@ -690,7 +722,11 @@ class Tile : public MaxAlignedAllocable {
   const WedgeMaskArray& wedge_masks_;
   const QuantizerMatrix& quantizer_matrix_;
   EntropyDecoder reader_;
-  SymbolDecoderContext symbol_decoder_context_;
+  // The working copy of the CDF tables, only used if the tile adapts them
+  // (enable_cdf_update). Otherwise the tables are never written, and
+  // |symbol_decoder_context_| refers to the frame context without copying it.
+  SymbolDecoderContext own_symbol_decoder_context_;
+  SymbolDecoderContext& symbol_decoder_context_;
   SymbolDecoderContext* const saved_symbol_decoder_context_;
   const SegmentationMap* prev_segment_ids_;
   const dsp::Dsp& dsp_;
@@ -714,20 +750,21 @@ class Tile : public MaxAlignedAllocable {
   //   transform process.
   // The size of this buffer would be:
   //    For |residual_buffer_|: (4096 + 32 * |kResidualPaddingVertical|) *
-  //        |residual_size_|. Where 4096 = 64x64 which is the maximum transform
+  //        sizeof(int32_t). Where 4096 = 64x64 which is the maximum transform
   //        size, and 32 * |kResidualPaddingVertical| is the padding to avoid
   //        bottom boundary checks when parsing quantized coefficients. This
-  //        memory is allocated and owned by the Tile class.
+  //        memory is allocated by the Tile class and kept in |tile_buffers_|.
+  //        It is large enough for any bitdepth so that it can be reused.
   //    For |residual_buffer_threaded_|: See the comment below. This memory is
   //        not allocated or owned by the Tile class.
-  AlignedUniquePtr<uint8_t> residual_buffer_;
+  AlignedUniquePtr<uint8_t>& residual_buffer_;
   // This is a 2d array of pointers of size |superblock_rows_| by
   // |superblock_columns_| where each pointer points to a ResidualBuffer for a
   // single super block. The array is populated when the parsing process begins
   // by calling |residual_buffer_pool_->Get()| and the memory is released back
   // to the pool by calling |residual_buffer_pool_->Release()| when the decoding
-  // process is complete.
-  Array2D<std::unique_ptr<ResidualBuffer>> residual_buffer_threaded_;
+  // process is complete. The array of pointers is kept in |tile_buffers_|.
+  Array2DView<std::unique_ptr<ResidualBuffer>> residual_buffer_threaded_;
   // sizeof(int16_t or int32_t) depending on |bitdepth|.
   const size_t residual_size_;
   // Number of superblocks on the top-right that will have to be decoded before
@@ -766,8 +803,14 @@ class Tile : public MaxAlignedAllocable {
   TileScratchBufferPool* const tile_scratch_buffer_pool_;
   BlockingCounterWithStatus* const pending_tiles_;
   bool split_parse_and_decode_;
+  // If true, the parts of the block processing that are not needed for parsing
+  // (PopulateDeblockFilterLevel(), PopulateCdefSkip() and
+  // StoreMotionFieldMvsIntoCurrentFrame()) are moved from the parsing thread
+  // to the decoding jobs. This is done when the parsing and the decoding of
+  // the tile run concurrently within the frame (ThreadedParseAndDecode()).
+  bool defer_block_setup_;
   // This is used only when |split_parse_and_decode_| is false.
-  std::unique_ptr<PredictionParameters> prediction_parameters_ = nullptr;
+  std::unique_ptr<PredictionParameters>& prediction_parameters_;
   // Stores the |transform_type| for the super block being decoded at a 4x4
   // granularity. The spec uses absolute indices for this array but it is
   // sufficient to use indices relative to the super block being decoded.
@@ -784,6 +827,12 @@ class Tile : public MaxAlignedAllocable {
   // one row buffer for each tile row. This tile will have to use the buffer
   // corresponding to this tile's row.
   IntraPredictionBuffer* const intra_prediction_buffer_;
+  // Time spent blocked on the reference frames in frame parallel mode. It is
+  // shared by all the tiles of the frame (see
+  // FrameScratchBuffer::reference_wait_time_ns).
+  std::atomic<int64_t>& reference_wait_time_ns_;
+  // Stage timings of the frame (see FrameScratchBuffer::frame_stats).
+  FrameStatsCollector& frame_stats_;
   // Stores the progress of the reference frames. This will be used to avoid
   // unnecessary calls into RefCountedBuffer::WaitUntil().
   std::array<int, kNumReferenceFrameTypes> reference_frame_progress_cache_;
@@ -793,7 +842,7 @@ class Tile : public MaxAlignedAllocable {
   // buffer is the number of superblock columns in this tile. For each block,
   // the access index will be the corresponding SuperBlockColumnIndex()'th
   // entry.
-  DynamicBuffer<BlockCdfContext> top_context_;
+  DynamicBuffer<BlockCdfContext>& top_context_;
   // Whether the tile should only be parsed and not decoded.
   const bool parse_only_;
 };
@@ -1160,7 +1160,8 @@ bool Tile::BlockInterPrediction(
             reference_y_max &&
         !reference_frames_[reference_frame_index]->WaitUntil(
             reference_y_max,
-            &reference_frame_progress_cache_[reference_frame_index])) {
+            &reference_frame_progress_cache_[reference_frame_index],
+            &reference_wait_time_ns_)) {
       return false;
     }
   }
@@ -1304,7 +1305,8 @@ bool Tile::BlockWarpProcess(const Block& block, const Plane plane,
             reference_y_max &&
         !reference_frames_[reference_frame_index]->WaitUntil(
             reference_y_max,
-            &reference_frame_progress_cache_[reference_frame_index])) {
+            &reference_frame_progress_cache_[reference_frame_index],
+            &reference_wait_time_ns_)) {
       return false;
     }
   }
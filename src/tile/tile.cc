@@ -27,6 +27,7 @@
 #include <utility>
 
 #include "src/frame_scratch_buffer.h"
+#include "src/frame_stats_collector.h"
 #include "src/motion_vector.h"
 #include "src/reconstruction.h"
 #include "src/utils/bit_mask_set.h"
@@ -437,6 +438,9 @@ Tile::Tile(int tile_number, const uint8_t* const data, size_t size,
       subsampling_y_{0, sequence_header.color_config.subsampling_y,
                      sequence_header.color_config.subsampling_y},
       current_quantizer_index_(frame_header.quantizer.base_index),
+      tile_buffers_(frame_scratch_buffer->tile_buffers.get()[tile_number]),
+      coefficient_levels_(tile_buffers_.coefficient_levels),
+      dc_categories_(tile_buffers_.dc_categories),
       sequence_header_(sequence_header),
       frame_header_(frame_header),
       reference_frame_sign_bias_(state.reference_frame_sign_bias),
@@ -446,7 +450,12 @@ Tile::Tile(int tile_number, const uint8_t* const data, size_t size,
       wedge_masks_(wedge_masks),
       quantizer_matrix_(quantizer_matrix),
       reader_(data_, size_, frame_header_.enable_cdf_update),
-      symbol_decoder_context_(frame_scratch_buffer->symbol_decoder_context),
+      // The entropy decoder only writes the CDF tables if enable_cdf_update
+      // is true, so the shared frame context can be read in place otherwise.
+      symbol_decoder_context_(frame_header_.enable_cdf_update
+                                  ? own_symbol_decoder_context_
+                                  : const_cast<SymbolDecoderContext&>(
+                                        *frame_scratch_buffer->frame_context)),
       saved_symbol_decoder_context_(saved_symbol_decoder_context),
       prev_segment_ids_(prev_segment_ids),
       dsp_(*dsp),
@@ -454,6 +463,7 @@ Tile::Tile(int tile_number, const uint8_t* const data, size_t size,
       block_parameters_holder_(frame_scratch_buffer->block_parameters_holder),
       quantizer_(sequence_header_.color_config.bitdepth,
                  &frame_header_.quantizer),
+      residual_buffer_(tile_buffers_.residual_buffer),
       residual_size_((sequence_header_.color_config.bitdepth == 8)
                          ? sizeof(int16_t)
                          : sizeof(int32_t)),
@@ -470,13 +480,20 @@ Tile::Tile(int tile_number, const uint8_t* const data, size_t size,
       tile_scratch_buffer_pool_(
           &frame_scratch_buffer->tile_scratch_buffer_pool),
       pending_tiles_(pending_tiles),
+      prediction_parameters_(tile_buffers_.prediction_parameters),
       frame_parallel_(frame_parallel),
       use_intra_prediction_buffer_(use_intra_prediction_buffer),
       intra_prediction_buffer_(
           use_intra_prediction_buffer_
               ? &frame_scratch_buffer->intra_prediction_buffers.get()[row_]
               : nullptr),
+      reference_wait_time_ns_(frame_scratch_buffer->reference_wait_time_ns),
+      frame_stats_(frame_scratch_buffer->frame_stats),
+      top_context_(tile_buffers_.top_context),
       parse_only_(parse_only) {
+  if (frame_header_.enable_cdf_update) {
+    own_symbol_decoder_context_ = *frame_scratch_buffer->frame_context;
+  }
   row4x4_start_ = frame_header.tile_info.tile_row_start[row_];
   row4x4_end_ = frame_header.tile_info.tile_row_start[row_ + 1];
   column4x4_start_ = frame_header.tile_info.tile_column_start[column_];
@@ -499,6 +516,11 @@ Tile::Tile(int tile_number, const uint8_t* const data, size_t size,
   split_parse_and_decode_ = (thread_pool_ != nullptr &&
                              superblock_columns_ > intra_block_copy_lag_) ||
                             frame_parallel || parse_only_;
+  // In frame parallel mode the motion field mvs of the frame are used by the
+  // next frames as soon as it is parsed, and with |parse_only_| nothing is
+  // decoded.
+  defer_block_setup_ =
+      split_parse_and_decode_ && !frame_parallel && !parse_only_;
   if (frame_parallel_) {
     reference_frame_progress_cache_.fill(INT_MIN);
   }
@@ -564,32 +586,39 @@ bool Tile::Init() {
   }
   if (split_parse_and_decode_) {
     assert(residual_buffer_pool_ != nullptr);
-    if (!residual_buffer_threaded_.Reset(superblock_rows_, superblock_columns_,
-                                         /*zero_initialize=*/false)) {
-      LIBGAV1_DLOG(ERROR, "residual_buffer_threaded_.Reset() failed.");
+    if (!tile_buffers_.residual_buffer_threaded.Resize(superblock_rows_ *
+                                                        superblock_columns_)) {
+      LIBGAV1_DLOG(ERROR, "residual_buffer_threaded_ allocation failed.");
       return false;
     }
+    residual_buffer_threaded_.Reset(
+        superblock_rows_, superblock_columns_,
+        tile_buffers_.residual_buffer_threaded.get());
   } else {
-    // Add 32 * |kResidualPaddingVertical| padding to avoid bottom boundary
-    // checks when parsing quantized coefficients.
-    residual_buffer_ = MakeAlignedUniquePtr<uint8_t>(
-        32, (4096 + 32 * kResidualPaddingVertical) * residual_size_);
     if (residual_buffer_ == nullptr) {
-      LIBGAV1_DLOG(ERROR, "Allocation of residual_buffer_ failed.");
-      return false;
+      // Add 32 * |kResidualPaddingVertical| padding to avoid bottom boundary
+      // checks when parsing quantized coefficients.
+      residual_buffer_ = MakeAlignedUniquePtr<uint8_t>(
+          32, (4096 + 32 * kResidualPaddingVertical) * sizeof(int32_t));
+      if (residual_buffer_ == nullptr) {
+        LIBGAV1_DLOG(ERROR, "Allocation of residual_buffer_ failed.");
+        return false;
+      }
     }
-    prediction_parameters_.reset(new (std::nothrow) PredictionParameters());
+    // |prediction_parameters_| is left in the BlockParameters of a block if
+    // the previous frame failed to decode.
     if (prediction_parameters_ == nullptr) {
-      LIBGAV1_DLOG(ERROR, "Allocation of prediction_parameters_ failed.");
-      return false;
+      prediction_parameters_.reset(new (std::nothrow) PredictionParameters());
+      if (prediction_parameters_ == nullptr) {
+        LIBGAV1_DLOG(ERROR, "Allocation of prediction_parameters_ failed.");
+        return false;
+      }
     }
   }
-  if (frame_header_.use_ref_frame_mvs) {
-    assert(sequence_header_.enable_order_hint);
-    SetupMotionField(frame_header_, current_frame_, reference_frames_,
-                     row4x4_start_, row4x4_end_, column4x4_start_,
-                     column4x4_end_, &motion_field_);
-  }
+  // The temporal motion field is set up lazily by SetupMotionFieldRows().
+  assert(!frame_header_.use_ref_frame_mvs ||
+         sequence_header_.enable_order_hint);
+  motion_field_row4x4_ = row4x4_start_;
   ResetLoopRestorationParams();
   if (!top_context_.Resize(superblock_columns_)) {
     LIBGAV1_DLOG(ERROR, "Allocation of top_context_ failed.");
@@ -631,6 +660,18 @@ template bool Tile::ProcessSuperBlockRow<kProcessingModeDecodeOnly, false>(
 template bool Tile::ProcessSuperBlockRow<kProcessingModeParseAndDecode, true>(
     int row4x4, TileScratchBuffer* scratch_buffer);
 
+void Tile::SetupMotionFieldRows(int row4x4_end) {
+  row4x4_end = std::min(row4x4_end, row4x4_end_);
+  if (motion_field_row4x4_ >= row4x4_end) return;
+  // The projection of a motion vector never crosses a 64 row boundary
+  // (Section 7.9.2), so the motion field can be set up in any number of
+  // superblock rows independently.
+  SetupMotionField(frame_header_, current_frame_, reference_frames_,
+                   motion_field_row4x4_, row4x4_end, column4x4_start_,
+                   column4x4_end_, &motion_field_);
+  motion_field_row4x4_ = row4x4_end;
+}
+
 void Tile::SaveSymbolDecoderContext() {
   if (frame_header_.enable_frame_end_update_cdf &&
       number_ == frame_header_.tile_info.context_update_id) {
@@ -659,6 +700,7 @@ bool Tile::ParseAndDecode() {
       pending_tiles_->Decrement(false);
       return false;
     }
+    post_filter_.SignalSuperBlockRowDecoded(row4x4);
   }
   tile_scratch_buffer_pool_->Release(std::move(scratch_buffer));
   pending_tiles_->Decrement(true);
@@ -744,16 +786,24 @@ bool Tile::Decode(
 }
 
 bool Tile::ThreadedParseAndDecode() {
-  {
-    std::lock_guard<std::mutex> lock(threading_.mutex);
-    if (!threading_.sb_state.Reset(superblock_rows_, superblock_columns_)) {
-      pending_tiles_->Decrement(false);
-      LIBGAV1_DLOG(ERROR, "threading.sb_state.Reset() failed.");
-      return false;
+  if (!tile_buffers_.sb_dependencies.Resize(superblock_rows_ *
+                                            superblock_columns_)) {
+    pending_tiles_->Decrement(false);
+    LIBGAV1_DLOG(ERROR, "threading.sb_dependencies allocation failed.");
+    return false;
+  }
+  threading_.sb_dependencies.Reset(superblock_rows_, superblock_columns_,
+                                   tile_buffers_.sb_dependencies.get());
+  for (int row_index = 0; row_index < superblock_rows_; ++row_index) {
+    for (int column_index = 0; column_index < superblock_columns_;
+         ++column_index) {
+      threading_.sb_dependencies[row_index][column_index].store(
+          DecodeDependencies(row_index, column_index),
+          std::memory_order_relaxed);
     }
-    // Account for the parsing job.
-    ++threading_.pending_jobs;
   }
+  // Account for the parsing job. No decoding job has been scheduled yet.
+  threading_.pending_jobs.store(1, std::memory_order_relaxed);
 
   const int block_width4x4 = kNum4x4BlocksWide[SuperBlockSize()];
 
@@ -772,27 +822,14 @@ bool Tile::ThreadedParseAndDecode() {
          column4x4 += block_width4x4, ++column_index) {
       if (!ProcessSuperBlock(row4x4, column4x4, scratch_buffer.get(),
                              kProcessingModeParseOnly)) {
-        std::lock_guard<std::mutex> lock(threading_.mutex);
-        threading_.abort = true;
+        threading_.abort.store(true, std::memory_order_relaxed);
         break;
       }
-      std::unique_lock<std::mutex> lock(threading_.mutex);
-      if (threading_.abort) break;
-      threading_.sb_state[row_index][column_index] = kSuperBlockStateParsed;
+      if (threading_.abort.load(std::memory_order_relaxed)) break;
       // Schedule the decoding of this superblock if it is allowed.
-      if (CanDecode(row_index, column_index)) {
-        ++threading_.pending_jobs;
-        threading_.sb_state[row_index][column_index] =
-            kSuperBlockStateScheduled;
-        lock.unlock();
-        thread_pool_->Schedule(
-            [this, row_index, column_index, block_width4x4]() {
-              DecodeSuperBlock(row_index, column_index, block_width4x4);
-            });
-      }
+      SatisfyDecodeDependency(row_index, column_index, block_width4x4);
     }
-    std::lock_guard<std::mutex> lock(threading_.mutex);
-    if (threading_.abort) break;
+    if (threading_.abort.load(std::memory_order_relaxed)) break;
   }
   tile_scratch_buffer_pool_->Release(std::move(scratch_buffer));
 
@@ -801,51 +838,49 @@ bool Tile::ThreadedParseAndDecode() {
   //
   // Finish using |threading_| before |pending_tiles_->Decrement()| because the
   // Tile object could go out of scope as soon as |pending_tiles_->Decrement()|
-  // is called.
-  threading_.mutex.lock();
-  const bool no_pending_jobs = (--threading_.pending_jobs == 0);
-  const bool job_succeeded = !threading_.abort;
-  threading_.mutex.unlock();
-  if (no_pending_jobs) {
+  // is called. |threading_.abort| is read first since the other jobs may
+  // finish as soon as |threading_.pending_jobs| is decremented.
+  const bool job_succeeded = !threading_.abort.load(std::memory_order_relaxed);
+  if (threading_.pending_jobs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
     // We are done parsing and decoding this tile.
-    pending_tiles_->Decrement(job_succeeded);
+    pending_tiles_->Decrement(
+        !threading_.abort.load(std::memory_order_relaxed));
   }
   return job_succeeded;
 }
 
-bool Tile::CanDecode(int row_index, int column_index) const {
-  assert(row_index >= 0);
-  assert(column_index >= 0);
-  // If |threading_.sb_state[row_index][column_index]| is not equal to
-  // kSuperBlockStateParsed, then return false. This is ok because if
-  // |threading_.sb_state[row_index][column_index]| is equal to:
-  //   kSuperBlockStateNone - then the superblock is not yet parsed.
-  //   kSuperBlockStateScheduled - then the superblock is already scheduled for
-  //                               decode.
-  //   kSuperBlockStateDecoded - then the superblock has already been decoded.
-  if (row_index >= superblock_rows_ || column_index >= superblock_columns_ ||
-      threading_.sb_state[row_index][column_index] != kSuperBlockStateParsed) {
-    return false;
-  }
-  // First superblock has no dependencies.
-  if (row_index == 0 && column_index == 0) {
-    return true;
+int Tile::DecodeDependencies(int row_index, int column_index) const {
+  assert(row_index >= 0 && row_index < superblock_rows_);
+  assert(column_index >= 0 && column_index < superblock_columns_);
+  // The superblock has to be parsed.
+  int dependencies = 1;
+  // All superblocks other than the first one of a row depend on the superblock
+  // to the left of it.
+  if (column_index > 0) ++dependencies;
+  // Superblocks other than the ones in the first row depend on the superblock
+  // at |top_right_column_index| in the row above. If the superblock to the left
+  // has the same top right superblock, the dependency is implied by the one on
+  // the superblock to the left.
+  if (row_index > 0 &&
+      (column_index == 0 ||
+       column_index - 1 + intra_block_copy_lag_ < superblock_columns_ - 1)) {
+    ++dependencies;
+  }
+  return dependencies;
+}
+
+void Tile::SatisfyDecodeDependency(int row_index, int column_index,
+                                   int block_width4x4) {
+  // The acquire-release ordering makes the parsing and the decoding of the
+  // prerequisites visible to the job that decodes the superblock.
+  if (threading_.sb_dependencies[row_index][column_index].fetch_sub(
+          1, std::memory_order_acq_rel) != 1) {
+    return;
   }
-  // Superblocks in the first row only depend on the superblock to the left of
-  // it.
-  if (row_index == 0) {
-    return threading_.sb_state[0][column_index - 1] == kSuperBlockStateDecoded;
-  }
-  // All other superblocks depend on superblock to the left of it (if one
-  // exists) and superblock to the top right with a lag of
-  // |intra_block_copy_lag_| (if one exists).
-  const int top_right_column_index =
-      std::min(column_index + intra_block_copy_lag_, superblock_columns_ - 1);
-  return threading_.sb_state[row_index - 1][top_right_column_index] ==
-             kSuperBlockStateDecoded &&
-         (column_index == 0 ||
-          threading_.sb_state[row_index][column_index - 1] ==
-              kSuperBlockStateDecoded);
+  threading_.pending_jobs.fetch_add(1, std::memory_order_relaxed);
+  thread_pool_->Schedule([this, row_index, column_index, block_width4x4]() {
+    DecodeSuperBlock(row_index, column_index, block_width4x4);
+  });
 }
 
 void Tile::DecodeSuperBlock(int row_index, int column_index,
@@ -860,49 +895,44 @@ void Tile::DecodeSuperBlock(int row_index, int column_index,
                            kProcessingModeDecodeOnly);
     tile_scratch_buffer_pool_->Release(std::move(scratch_buffer));
   }
-  std::unique_lock<std::mutex> lock(threading_.mutex);
+  if (ok && column_index == superblock_columns_ - 1) {
+    // Superblocks within a row are decoded from left to right, so the whole
+    // superblock row has been decoded.
+    post_filter_.SignalSuperBlockRowDecoded(row4x4);
+  }
   if (ok) {
-    threading_.sb_state[row_index][column_index] = kSuperBlockStateDecoded;
-    // Candidate rows and columns that we could potentially begin the decoding
-    // (if it is allowed to do so). The candidates are:
+    // The superblocks that depend on this superblock (see
+    // DecodeDependencies()) are:
     //   1) The superblock to the bottom-left of the current superblock with a
     //   lag of |intra_block_copy_lag_| (or the beginning of the next superblock
     //   row in case there are less than |intra_block_copy_lag_| superblock
-    //   columns in the Tile).
+    //   columns in the Tile). For the last superblock of a row this is the
+    //   first superblock of the next row whose top right superblock is clipped
+    //   to the last column.
     //   2) The superblock to the right of the current superblock.
-    const int candidate_row_indices[] = {row_index + 1, row_index};
-    const int candidate_column_indices[] = {
-        std::max(0, column_index - intra_block_copy_lag_), column_index + 1};
-    for (size_t i = 0; i < std::extent<decltype(candidate_row_indices)>::value;
-         ++i) {
-      const int candidate_row_index = candidate_row_indices[i];
-      const int candidate_column_index = candidate_column_indices[i];
-      if (!CanDecode(candidate_row_index, candidate_column_index)) {
-        continue;
+    if (row_index + 1 < superblock_rows_) {
+      const int candidate_column_index =
+          (column_index == superblock_columns_ - 1)
+              ? std::max(0, column_index - intra_block_copy_lag_)
+              : column_index - intra_block_copy_lag_;
+      if (candidate_column_index >= 0) {
+        SatisfyDecodeDependency(row_index + 1, candidate_column_index,
+                                block_width4x4);
       }
-      ++threading_.pending_jobs;
-      threading_.sb_state[candidate_row_index][candidate_column_index] =
-          kSuperBlockStateScheduled;
-      lock.unlock();
-      thread_pool_->Schedule([this, candidate_row_index, candidate_column_index,
-                              block_width4x4]() {
-        DecodeSuperBlock(candidate_row_index, candidate_column_index,
-                         block_width4x4);
-      });
-      lock.lock();
+    }
+    if (column_index + 1 < superblock_columns_) {
+      SatisfyDecodeDependency(row_index, column_index + 1, block_width4x4);
     }
   } else {
-    threading_.abort = true;
+    threading_.abort.store(true, std::memory_order_relaxed);
   }
   // Finish using |threading_| before |pending_tiles_->Decrement()| because the
   // Tile object could go out of scope as soon as |pending_tiles_->Decrement()|
   // is called.
-  const bool no_pending_jobs = (--threading_.pending_jobs == 0);
-  const bool job_succeeded = !threading_.abort;
-  lock.unlock();
-  if (no_pending_jobs) {
+  if (threading_.pending_jobs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
     // We are done parsing and decoding this tile.
-    pending_tiles_->Decrement(job_succeeded);
+    pending_tiles_->Decrement(
+        !threading_.abort.load(std::memory_order_relaxed));
   }
 }
 
@@ -2007,6 +2037,9 @@ void Tile::ResetEntropyContext(const Block& block) {
 bool Tile::ComputePrediction(const Block& block) {
   const BlockParameters& bp = *block.bp;
   if (!bp.is_inter) return true;
+  ScopedBlockStageTimer timer(frame_stats_,
+                              &block.scratch_buffer->frame_stage_times,
+                              kFrameStageInterPrediction);
   const int mask =
       (1 << (4 + static_cast<int>(sequence_header_.use_128x128_superblock))) -
       1;
@@ -2129,6 +2162,8 @@ void Tile::PopulateDeblockFilterLevel(const Block& block) {
                                 [bp.reference_frame[0]][mode_id];
     }
   }
+  block_parameters_holder_.FillDeblockParameters(block.row4x4,
+                                                 block.column4x4, bp);
 }
 
 void Tile::PopulateCdefSkip(const Block& block) {
@@ -2202,8 +2237,7 @@ bool Tile::ProcessBlock(int row4x4, int column4x4, BlockSize block_size,
   Block block(this, block_size, row4x4, column4x4, scratch_buffer, residual);
   bp.size = block_size;
   bp.prediction_parameters =
-      split_parse_and_decode_ ? std::unique_ptr<PredictionParameters>(
-                                    new (std::nothrow) PredictionParameters())
+      split_parse_and_decode_ ? residual_buffer_pool_->GetPredictionParameters()
                               : std::move(prediction_parameters_);
   if (bp.prediction_parameters == nullptr) return false;
   if (!DecodeModeInfo(block)) return false;
@@ -2212,7 +2246,6 @@ bool Tile::ProcessBlock(int row4x4, int column4x4, BlockSize block_size,
     weighted_cumulative_block_qp_ += current_quantizer_index_ * block_weight;
     cumulative_block_weights_ += block_weight;
   }
-  PopulateDeblockFilterLevel(block);
   if (!ReadPaletteTokens(block)) return false;
   DecodeTransformSize(block);
   // Part of Section 5.11.37 in the spec (implemented as a simple lookup).
@@ -2220,8 +2253,13 @@ bool Tile::ProcessBlock(int row4x4, int column4x4, BlockSize block_size,
       frame_header_.segmentation.lossless[bp.prediction_parameters->segment_id]
           ? kTransformSize4x4
           : kUVTransformSize[block.residual_size[kPlaneU]];
+  // The deblock filter levels depend on the delta_lf values, which change
+  // while the tile is parsed when they are present.
+  if (!defer_block_setup_ || frame_header_.delta_lf.present) {
+    PopulateDeblockFilterLevel(block);
+  }
   if (bp.skip) ResetEntropyContext(block);
-  PopulateCdefSkip(block);
+  if (!defer_block_setup_) PopulateCdefSkip(block);
   if (split_parse_and_decode_) {
     if (!Residual(block, kProcessingModeParseOnly)) return false;
   } else {
@@ -2249,7 +2287,7 @@ bool Tile::ProcessBlock(int row4x4, int column4x4, BlockSize block_size,
         row4x4, column4x4, x_limit, y_limit,
         bp.prediction_parameters->segment_id);
   }
-  StoreMotionFieldMvsIntoCurrentFrame(block);
+  if (!defer_block_setup_) StoreMotionFieldMvsIntoCurrentFrame(block);
   if (!split_parse_and_decode_) {
     prediction_parameters_ = std::move(bp.prediction_parameters);
   }
@@ -2264,11 +2302,17 @@ bool Tile::DecodeBlock(int row4x4, int column4x4, BlockSize block_size,
     return true;
   }
   Block block(this, block_size, row4x4, column4x4, scratch_buffer, residual);
+  if (defer_block_setup_) {
+    if (!frame_header_.delta_lf.present) PopulateDeblockFilterLevel(block);
+    PopulateCdefSkip(block);
+    StoreMotionFieldMvsIntoCurrentFrame(block);
+  }
   if (!ComputePrediction(block) ||
       !Residual(block, kProcessingModeDecodeOnly)) {
     return false;
   }
-  block.bp->prediction_parameters.reset(nullptr);
+  residual_buffer_pool_->ReleasePredictionParameters(
+      std::move(block.bp->prediction_parameters));
   return true;
 }
 
@@ -2493,7 +2537,15 @@ bool Tile::ProcessSuperBlock(int row4x4, int column4x4,
       mode == kProcessingModeParseOnly || mode == kProcessingModeParseAndDecode;
   const bool decoding = mode == kProcessingModeDecodeOnly ||
                         mode == kProcessingModeParseAndDecode;
+  // The inter prediction times of the blocks of the superblock are added to
+  // the collector along with the time of the superblock.
+  ScopedFrameStageTimer timer(
+      &frame_stats_, decoding ? kFrameStageReconstruction : kFrameStageParse,
+      &scratch_buffer->frame_stage_times);
   if (parsing) {
+    if (frame_header_.use_ref_frame_mvs && column4x4 == column4x4_start_) {
+      SetupMotionFieldRows(row4x4 + kNum4x4BlocksHigh[SuperBlockSize()]);
+    }
     read_deltas_ = frame_header_.delta_q.present;
     ResetCdef(row4x4, column4x4);
   }
@@ -26,6 +26,7 @@
 #include <utility>
 
 #include "src/dsp/constants.h"
+#include "src/frame_stats_collector.h"
 #include "src/utils/common.h"
 #include "src/utils/compiler_attributes.h"
 #include "src/utils/constants.h"
@@ -122,6 +123,11 @@ struct TileScratchBuffer : public MaxAlignedAllocable {
   // all accesses into this array will be offset by +1 when compared with the
   // spec.
   bool block_decoded[kMaxPlanes][kBlockDecodedStride][kBlockDecodedStride];
+
+  // The stage times of the blocks of the superblock that is being processed.
+  // They are flushed to the frame's FrameStatsCollector at the end of the
+  // superblock.
+  FrameStageAccumulator frame_stage_times;
 };
 
 class TileScratchBufferPool {
@@ -15,6 +15,12 @@
 #include "src/utils/block_parameters_holder.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>  // NOLINT (unapproved c++11 header)
+#include <new>
+#include <utility>
 
 #include "src/utils/common.h"
 #include "src/utils/constants.h"
@@ -23,25 +29,92 @@
 
 namespace libgav1 {
 
-bool BlockParametersHolder::Reset(int rows4x4, int columns4x4) {
+BlockParametersHolder::~BlockParametersHolder() {
+  for (int i = 0; i < num_chunks_; ++i) {
+    delete[] chunks_[i].load(std::memory_order_relaxed);
+  }
+}
+
+bool BlockParametersHolder::Reset(int rows4x4, int columns4x4, bool deblock) {
   rows4x4_ = rows4x4;
   columns4x4_ = columns4x4;
   index_ = 0;
+  max_blocks_ = rows4x4_ * columns4x4_;
+  const int num_chunks = (max_blocks_ + kChunkSize - 1) >> kChunkSizeLog2;
+  if (num_chunks > num_chunks_) {
+    // Keep the chunks that are already allocated.
+    std::unique_ptr<std::atomic<BlockParameters*>[]> chunks(
+        new (std::nothrow) std::atomic<BlockParameters*>[num_chunks]);
+    if (chunks == nullptr) {
+      max_blocks_ = 0;
+      return false;
+    }
+    for (int i = 0; i < num_chunks; ++i) {
+      chunks[i].store(
+          (i < num_chunks_) ? chunks_[i].load(std::memory_order_relaxed)
+                            : nullptr,
+          std::memory_order_relaxed);
+    }
+    chunks_ = std::move(chunks);
+    num_chunks_ = num_chunks;
+  }
+  // The deblocking filter only reads the DeblockParameters of the 4x4 blocks
+  // of the frame, which are all filled in. So the plane is not cleared.
   return block_parameters_cache_.Reset(rows4x4_, columns4x4_) &&
-         block_parameters_.Resize(rows4x4_ * columns4x4_);
+         (!deblock || deblock_parameters_.Reset(rows4x4_, columns4x4_,
+                                                /*zero_initialize=*/false));
 }
 
 BlockParameters* BlockParametersHolder::Get(int row4x4, int column4x4,
                                             BlockSize block_size) {
-  const size_t index = index_.fetch_add(1, std::memory_order_relaxed);
-  if (index >= block_parameters_.size()) return nullptr;
-  auto& bp = block_parameters_.get()[index];
-  if (bp == nullptr) {
-    bp.reset(new (std::nothrow) BlockParameters);
-    if (bp == nullptr) return nullptr;
+  const int index = index_.fetch_add(1, std::memory_order_relaxed);
+  if (index >= max_blocks_) return nullptr;
+  BlockParameters* const chunk = GetChunk(index >> kChunkSizeLog2);
+  if (chunk == nullptr) return nullptr;
+  BlockParameters* const bp = chunk + (index & (kChunkSize - 1));
+  FillCache(row4x4, column4x4, block_size, bp);
+  return bp;
+}
+
+BlockParameters* BlockParametersHolder::GetChunk(int chunk_index) {
+  std::atomic<BlockParameters*>& chunk = chunks_[chunk_index];
+  BlockParameters* chunk_ptr = chunk.load(std::memory_order_acquire);
+  if (chunk_ptr != nullptr) return chunk_ptr;
+  // The tiles of a frame may be parsed in parallel.
+  std::lock_guard<std::mutex> lock(chunk_mutex_);
+  chunk_ptr = chunk.load(std::memory_order_relaxed);
+  if (chunk_ptr == nullptr) {
+    chunk_ptr = new (std::nothrow) BlockParameters[kChunkSize];
+    if (chunk_ptr == nullptr) {
+      LIBGAV1_DLOG(ERROR, "Failed to allocate BlockParameters.");
+      return nullptr;
+    }
+    chunk.store(chunk_ptr, std::memory_order_release);
+  }
+  return chunk_ptr;
+}
+
+void BlockParametersHolder::FillDeblockParameters(int row4x4, int column4x4,
+                                                  const BlockParameters& bp) {
+  const int rows = std::min(static_cast<int>(kNum4x4BlocksHigh[bp.size]),
+                            rows4x4_ - row4x4);
+  const int columns = std::min(static_cast<int>(kNum4x4BlocksWide[bp.size]),
+                               columns4x4_ - column4x4);
+  DeblockParameters params;
+  static_assert(sizeof(params.filter_level) == sizeof(bp.deblock_filter_level),
+                "");
+  memcpy(params.filter_level, bp.deblock_filter_level,
+         sizeof(params.filter_level));
+  params.uv_transform_size = bp.uv_transform_size;
+  params.skip_inter = bp.skip && bp.is_inter;
+  DeblockParameters* dst = &deblock_parameters_[row4x4][column4x4];
+  for (int y = 0; y < rows; ++y, dst += columns4x4_) {
+    params.row_offset = y;
+    for (int x = 0; x < columns; ++x) {
+      params.column_offset = x;
+      dst[x] = params;
+    }
   }
-  FillCache(row4x4, column4x4, block_size, bp.get());
-  return bp.get();
 }
 
 void BlockParametersHolder::FillCache(int row4x4, int column4x4,
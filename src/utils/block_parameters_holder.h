@@ -18,16 +18,33 @@
 #define LIBGAV1_SRC_UTILS_BLOCK_PARAMETERS_HOLDER_H_
 
 #include <atomic>
+#include <cstdint>
 #include <memory>
+#include <mutex>  // NOLINT (unapproved c++11 header)
 
 #include "src/utils/array_2d.h"
 #include "src/utils/compiler_attributes.h"
 #include "src/utils/constants.h"
-#include "src/utils/dynamic_buffer.h"
 #include "src/utils/types.h"
 
 namespace libgav1 {
 
+// The fields of a block that the deblocking filter reads, stored for each 4x4
+// block. The edge scans read them in raster order instead of following the
+// BlockParameters pointers of the 4x4 blocks.
+struct DeblockParameters {
+  // See BlockParameters::deblock_filter_level.
+  uint8_t filter_level[kFrameLfCount];
+  // The position of the 4x4 block in its block, in units of 4x4. The 4x4
+  // block at |row4x4| - n (resp. |column4x4| - n) is in the same block if and
+  // only if |row_offset| (resp. |column_offset|) is at least n.
+  uint8_t row_offset;
+  uint8_t column_offset;
+  TransformSize uv_transform_size;
+  // BlockParameters::skip && BlockParameters::is_inter.
+  bool skip_inter;
+};
+
 // Holds the BlockParameters pointers to each 4x4 block in the frame.
 class BlockParametersHolder {
  public:
@@ -37,12 +54,18 @@ class BlockParametersHolder {
   BlockParametersHolder(const BlockParametersHolder&) = delete;
   BlockParametersHolder& operator=(const BlockParametersHolder&) = delete;
 
-  LIBGAV1_MUST_USE_RESULT bool Reset(int rows4x4, int columns4x4);
+  ~BlockParametersHolder();
+
+  // Prepares the holder for a frame of |rows4x4| x |columns4x4| 4x4 blocks.
+  // The DeblockParameters plane is only allocated if |deblock| is true.
+  LIBGAV1_MUST_USE_RESULT bool Reset(int rows4x4, int columns4x4,
+                                     bool deblock = false);
 
   // Returns a pointer to a BlockParameters object that can be used safely until
-  // the next call to Reset(). Returns nullptr on memory allocation failure. It
-  // also fills the cache matrix for the block starting at |row4x4|, |column4x4|
-  // of size |block_size| with the returned pointer.
+  // the next call to Reset(). Returns nullptr if all the objects of the frame
+  // have been handed out, or if there is not enough memory. It also fills the
+  // cache matrix for the block starting at |row4x4|, |column4x4| of size
+  // |block_size| with the returned pointer.
   BlockParameters* Get(int row4x4, int column4x4, BlockSize block_size);
 
   // Finds the BlockParameters corresponding to |row4x4| and |column4x4|. This
@@ -62,29 +85,62 @@ class BlockParametersHolder {
 
   int columns4x4() const { return columns4x4_; }
 
+  // Copies the deblocking fields of |bp| to the DeblockParameters of the 4x4
+  // blocks of the block at |row4x4|, |column4x4|. |bp| must have its final
+  // deblock_filter_level, skip, is_inter, uv_transform_size and size. Only
+  // valid if Reset() was called with |deblock| set to true.
+  void FillDeblockParameters(int row4x4, int column4x4,
+                             const BlockParameters& bp);
+
+  const DeblockParameters* DeblockParametersAddress(int row4x4,
+                                                    int column4x4) const {
+    return deblock_parameters_.data() + row4x4 * columns4x4_ + column4x4;
+  }
+
  private:
   // Needs access to FillCache for testing Cdef.
   template <int bitdepth, typename Pixel>
   friend class PostFilterApplyCdefTest;
 
+  enum {
+    kChunkSizeLog2 = 10,
+    kChunkSize = 1 << kChunkSizeLog2,
+  };
+
   void FillCache(int row4x4, int column4x4, BlockSize block_size,
                  BlockParameters* bp);
+  // Returns the chunk at |chunk_index|, allocating it if it is the first time
+  // the chunk is used. Returns nullptr if there is not enough memory.
+  BlockParameters* GetChunk(int chunk_index);
 
   int rows4x4_ = 0;
   int columns4x4_ = 0;
 
-  // Owns the memory of BlockParameters pointers for the entire frame. It can
-  // hold upto |rows4x4_| * |columns4x4_| objects. Each object will be allocated
-  // on demand and re-used across frames.
-  DynamicBuffer<std::unique_ptr<BlockParameters>> block_parameters_;
-
-  // Points to the next available index of |block_parameters_|.
+  // The BlockParameters objects are handed out in decoding order from chunks
+  // of kChunkSize objects. At most |rows4x4_| * |columns4x4_| objects are
+  // handed out per frame, but the blocks are usually larger than 4x4, so the
+  // chunks are only allocated when they are first reached. They are kept
+  // until the holder is destroyed, so after the first frames Get() does not
+  // allocate. Blocks that are decoded close to each other are also close to
+  // each other in memory, which helps the neighbor look ups of the motion
+  // vector search.
+  std::unique_ptr<std::atomic<BlockParameters*>[]> chunks_;
+  int num_chunks_ = 0;
+  // Serializes the allocation of the chunks.
+  std::mutex chunk_mutex_;
+  int max_blocks_ = 0;
+
+  // Points to the next available index of the BlockParameters objects.
   std::atomic<int> index_;
 
   // This is a 2d array of size |rows4x4_| * |columns4x4_|. This is filled in by
   // FillCache() and used by Find() to perform look ups using exactly one look
   // up (instead of traversing the entire tree).
   Array2D<BlockParameters*> block_parameters_cache_;
+
+  // This is a 2d array of size |rows4x4_| * |columns4x4_|, filled in by
+  // FillDeblockParameters() and read by the deblocking filter.
+  Array2D<DeblockParameters> deblock_parameters_;
 };
 
 }  // namespace libgav1
@@ -72,5 +72,64 @@ TEST(BlockParametersHolder, TestBasic) {
   EXPECT_NE(bp4, nullptr);
 }
 
+TEST(BlockParametersHolder, DeblockParameters) {
+  BlockParametersHolder holder;
+  ASSERT_TRUE(holder.Reset(20, 20, /*deblock=*/true));
+
+  BlockParameters* const bp = holder.Get(4, 6, kBlock16x8);
+  ASSERT_NE(bp, nullptr);
+  bp->size = kBlock16x8;
+  bp->skip = true;
+  bp->is_inter = true;
+  bp->uv_transform_size = kTransformSize8x4;
+  for (int i = 0; i < kFrameLfCount; ++i) {
+    bp->deblock_filter_level[i] = i + 1;
+  }
+  holder.FillDeblockParameters(4, 6, *bp);
+  // The block covers 2 rows and 4 columns of 4x4 blocks.
+  for (int i = 0; i < 2; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      const DeblockParameters& dp =
+          *holder.DeblockParametersAddress(4 + i, 6 + j);
+      EXPECT_EQ(dp.row_offset, i);
+      EXPECT_EQ(dp.column_offset, j);
+      EXPECT_EQ(dp.uv_transform_size, kTransformSize8x4);
+      EXPECT_TRUE(dp.skip_inter);
+      for (int k = 0; k < kFrameLfCount; ++k) {
+        EXPECT_EQ(dp.filter_level[k], k + 1);
+      }
+    }
+  }
+
+  // A block at the bottom right corner is clipped to the holder.
+  BlockParameters* const bp2 = holder.Get(18, 18, kBlock32x32);
+  ASSERT_NE(bp2, nullptr);
+  bp2->size = kBlock32x32;
+  bp2->skip = false;
+  bp2->is_inter = true;
+  holder.FillDeblockParameters(18, 18, *bp2);
+  EXPECT_EQ(holder.DeblockParametersAddress(19, 19)->row_offset, 1);
+  EXPECT_EQ(holder.DeblockParametersAddress(19, 19)->column_offset, 1);
+  EXPECT_FALSE(holder.DeblockParametersAddress(19, 19)->skip_inter);
+}
+
+TEST(BlockParametersHolder, LargeFrame) {
+  BlockParametersHolder holder;
+  // More objects than fit in one chunk.
+  ASSERT_TRUE(holder.Reset(100, 100));
+  BlockParameters* first = nullptr;
+  for (int i = 0; i < 100 * 100; ++i) {
+    BlockParameters* const bp = holder.Get(i / 100, i % 100, kBlock4x4);
+    ASSERT_NE(bp, nullptr) << "Mismatch in index " << i;
+    EXPECT_EQ(holder.Find(i / 100, i % 100), bp);
+    if (i == 0) first = bp;
+  }
+  EXPECT_EQ(holder.Get(0, 0, kBlock4x4), nullptr);
+
+  // The objects are kept when the holder grows.
+  ASSERT_TRUE(holder.Reset(200, 200));
+  EXPECT_EQ(holder.Get(0, 0, kBlock4x4), first);
+}
+
 }  // namespace
 }  // namespace libgav1
@@ -0,0 +1,146 @@
+/*
+ * Copyright 2024 The libgav1 Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGAV1_SRC_UTILS_CLOSURE_H_
+#define LIBGAV1_SRC_UTILS_CLOSURE_H_
+
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace libgav1 {
+
+// A move-only replacement for std::function<void()> that stores the callable
+// object inline and therefore never allocates memory. A callable object whose
+// size exceeds kStorageSize bytes is rejected at compile time; capture
+// pointers or references to larger state instead.
+//
+// Example usage:
+//   Closure closure = [&counter, value]() { counter += value; };
+//   closure();
+class Closure {
+ public:
+  // Large enough for the lambdas scheduled by the decoder, which capture up to
+  // eight pointers or integers.
+  static constexpr size_t kStorageSize = 64;
+
+  Closure() = default;
+  Closure(std::nullptr_t) {}  // NOLINT(google-explicit-constructor)
+
+  // Allows implicit conversion from lambdas so that Executor::Schedule() can
+  // be called with a lambda.
+  template <typename F, typename Callable = typename std::decay<F>::type,
+            typename = typename std::enable_if<
+                !std::is_same<Callable, Closure>::value>::type>
+  Closure(F&& f)  // NOLINT(google-explicit-constructor)
+      : ops_(&OpsFor<Callable>::kOps) {
+    static_assert(sizeof(Callable) <= kStorageSize,
+                  "The callable object does not fit in Closure::kStorageSize "
+                  "bytes.");
+    static_assert(alignof(Callable) <= alignof(Storage),
+                  "The callable object is over-aligned.");
+    new (&storage_) Callable(std::forward<F>(f));
+  }
+
+  Closure(Closure&& other) noexcept : ops_(other.ops_) {
+    if (ops_ != nullptr) {
+      ops_->move(&storage_, &other.storage_);
+      other.ops_ = nullptr;
+    }
+  }
+
+  Closure& operator=(Closure&& other) noexcept {
+    if (this != &other) {
+      Reset();
+      ops_ = other.ops_;
+      if (ops_ != nullptr) {
+        ops_->move(&storage_, &other.storage_);
+        other.ops_ = nullptr;
+      }
+    }
+    return *this;
+  }
+
+  Closure& operator=(std::nullptr_t) {
+    Reset();
+    return *this;
+  }
+
+  // Not copyable.
+  Closure(const Closure&) = delete;
+  Closure& operator=(const Closure&) = delete;
+
+  ~Closure() { Reset(); }
+
+  explicit operator bool() const { return ops_ != nullptr; }
+
+  // It is an error to call an empty Closure.
+  void operator()() {
+    assert(ops_ != nullptr);
+    ops_->invoke(&storage_);
+  }
+
+ private:
+  using Storage =
+      typename std::aligned_storage<kStorageSize, alignof(std::max_align_t)>::type;
+
+  // The type-erased operations on the stored callable object. |move|
+  // move-constructs the object at |dst| from the one at |src| and destroys the
+  // latter.
+  struct Ops {
+    void (*invoke)(void* callable);
+    void (*move)(void* dst, void* src);
+    void (*destroy)(void* callable);
+  };
+
+  template <typename Callable>
+  struct OpsFor {
+    static void Invoke(void* callable) {
+      (*static_cast<Callable*>(callable))();
+    }
+    static void Move(void* dst, void* src) {
+      Callable* const src_callable = static_cast<Callable*>(src);
+      new (dst) Callable(std::move(*src_callable));
+      src_callable->~Callable();
+    }
+    static void Destroy(void* callable) {
+      static_cast<Callable*>(callable)->~Callable();
+    }
+
+    static const Ops kOps;
+  };
+
+  void Reset() {
+    if (ops_ != nullptr) {
+      ops_->destroy(&storage_);
+      ops_ = nullptr;
+    }
+  }
+
+  Storage storage_;
+  const Ops* ops_ = nullptr;
+};
+
+template <typename Callable>
+const Closure::Ops Closure::OpsFor<Callable>::kOps = {
+    &Closure::OpsFor<Callable>::Invoke, &Closure::OpsFor<Callable>::Move,
+    &Closure::OpsFor<Callable>::Destroy};
+
+}  // namespace libgav1
+
+#endif  // LIBGAV1_SRC_UTILS_CLOSURE_H_
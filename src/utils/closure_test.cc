@@ -0,0 +1,111 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/utils/closure.h"
+
+#include <cstdint>
+#include <utility>
+
+#include "gtest/gtest.h"
+
+namespace libgav1 {
+namespace {
+
+// Counts the number of live instances through |*count|.
+class Counted {
+ public:
+  explicit Counted(int* count) : count_(count) { ++*count_; }
+  Counted(const Counted& other) : count_(other.count_) { ++*count_; }
+  Counted(Counted&& other) : count_(other.count_) { ++*count_; }
+  Counted& operator=(const Counted&) = delete;
+  Counted& operator=(Counted&&) = delete;
+  ~Counted() { --*count_; }
+
+ private:
+  int* count_;
+};
+
+TEST(ClosureTest, Empty) {
+  Closure closure;
+  EXPECT_FALSE(closure);
+  Closure null_closure = nullptr;
+  EXPECT_FALSE(null_closure);
+}
+
+TEST(ClosureTest, Invoke) {
+  int value = 0;
+  Closure closure = [&value]() { value += 3; };
+  ASSERT_TRUE(closure);
+  closure();
+  closure();
+  EXPECT_EQ(value, 6);
+}
+
+TEST(ClosureTest, Move) {
+  int value = 0;
+  Closure closure = [&value]() { ++value; };
+  Closure moved(std::move(closure));
+  EXPECT_FALSE(closure);  // NOLINT(bugprone-use-after-move)
+  ASSERT_TRUE(moved);
+  moved();
+  EXPECT_EQ(value, 1);
+
+  Closure assigned;
+  assigned = std::move(moved);
+  EXPECT_FALSE(moved);  // NOLINT(bugprone-use-after-move)
+  ASSERT_TRUE(assigned);
+  assigned();
+  EXPECT_EQ(value, 2);
+}
+
+// The captured state is destroyed exactly once, when the last Closure holding
+// it is reset or destroyed.
+TEST(ClosureTest, CapturesAreDestroyed) {
+  int count = 0;
+  {
+    Counted counted(&count);
+    Closure closure = [counted]() {};
+    EXPECT_EQ(count, 2);
+    Closure moved(std::move(closure));
+    EXPECT_EQ(count, 2);
+    closure = std::move(moved);
+    EXPECT_EQ(count, 2);
+    closure = nullptr;
+    EXPECT_EQ(count, 1);
+    closure = [counted]() {};
+    EXPECT_EQ(count, 2);
+  }
+  EXPECT_EQ(count, 0);
+}
+
+// A callable object of exactly Closure::kStorageSize bytes is accepted.
+TEST(ClosureTest, LargestCapture) {
+  struct Payload {
+    uint8_t bytes[Closure::kStorageSize - sizeof(int*)];
+  };
+  Payload payload = {};
+  payload.bytes[sizeof(payload.bytes) - 1] = 5;
+  int value = 0;
+  int* const value_ptr = &value;
+  const auto lambda = [payload, value_ptr]() {
+    *value_ptr = payload.bytes[sizeof(payload.bytes) - 1];
+  };
+  static_assert(sizeof(lambda) == Closure::kStorageSize, "");
+  Closure closure = lambda;
+  closure();
+  EXPECT_EQ(value, 5);
+}
+
+}  // namespace
+}  // namespace libgav1
@@ -66,11 +66,18 @@ uint32_t GetCpuInfo() {
   // Bits 27 (OSXSAVE) & 28 (256-bit AVX)
   if ((info[2] & (3 << 27)) == (3 << 27)) {
     // XMM state and YMM state enabled by the OS
-    if ((Xgetbv() & 0x6) == 0x6) {
+    const uint64_t xcr0 = Xgetbv();
+    if ((xcr0 & 0x6) == 0x6) {
       features |= kAVX;
       if (max_cpuid_value >= 7) {
         CpuId(7, info);
         if ((info[1] & (1 << 5)) != 0) features |= kAVX2;
+        // Opmask, upper 256 bits of ZMM0-15 and ZMM16-31 state enabled by the
+        // OS. Bit 16 (AVX-512F) is a prerequisite of the other extensions.
+        if ((xcr0 & 0xe0) == 0xe0 && (info[1] & (1 << 16)) != 0) {
+          if ((info[1] & (1U << 30)) != 0) features |= kAVX512BW;
+          if ((info[1] & (1U << 31)) != 0) features |= kAVX512VL;
+        }
       }
     }
   }
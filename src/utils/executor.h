@@ -17,7 +17,7 @@
 #ifndef LIBGAV1_SRC_UTILS_EXECUTOR_H_
 #define LIBGAV1_SRC_UTILS_EXECUTOR_H_
 
-#include <functional>
+#include "src/utils/closure.h"
 
 namespace libgav1 {
 
@@ -27,8 +27,9 @@ class Executor {
 
   // Schedules the specified "callback" for execution in this executor.
   // Depending on the subclass implementation, this may block in some
-  // situations.
-  virtual void Schedule(std::function<void()> callback) = 0;
+  // situations. The callable object converted to |callback| must fit in
+  // Closure::kStorageSize bytes.
+  virtual void Schedule(Closure callback) = 0;
 };
 
 }  // namespace libgav1
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2024 The libgav1 Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGAV1_SRC_UTILS_LAZY_INSTANCE_H_
+#define LIBGAV1_SRC_UTILS_LAZY_INSTANCE_H_
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>  // NOLINT (unapproved c++11 header)
+#include <new>
+
+namespace libgav1 {
+
+// A process-wide instance of T that is allocated and initialized on first use.
+// It is meant to be a function-local static:
+//   LazyInstance<Foo>& GetFoo() {
+//     static LazyInstance<Foo> foo;
+//     return foo;
+//   }
+// The instance itself is never freed, so that decoder threads that outlive the
+// static destructors at exit can still read it.
+template <typename T>
+class LazyInstance {
+ public:
+  LazyInstance() = default;
+
+  // Not copyable or movable.
+  LazyInstance(const LazyInstance&) = delete;
+  LazyInstance& operator=(const LazyInstance&) = delete;
+
+  // Allocates the instance and calls |initialize|(T*) on it, unless an earlier
+  // call has already succeeded. Both steps run under a mutex, so concurrent
+  // callers wait for the first one. Returns false if the allocation or
+  // |initialize| failed; nothing is kept in that case and the next call tries
+  // again.
+  template <typename Initializer>
+  bool Initialize(Initializer initialize) {
+    if (instance_.load(std::memory_order_acquire) != nullptr) return true;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (instance_.load(std::memory_order_relaxed) != nullptr) return true;
+    std::unique_ptr<T> instance(new (std::nothrow) T);
+    if (instance == nullptr || !initialize(instance.get())) return false;
+    instance_.store(instance.release(), std::memory_order_release);
+    return true;
+  }
+
+  // Returns the instance. Only valid after Initialize() has returned true.
+  const T& Get() const {
+    const T* const instance = instance_.load(std::memory_order_acquire);
+    assert(instance != nullptr);
+    return *instance;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::atomic<T*> instance_{nullptr};
+};
+
+}  // namespace libgav1
+
+#endif  // LIBGAV1_SRC_UTILS_LAZY_INSTANCE_H_
@@ -0,0 +1,78 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/utils/lazy_instance.h"
+
+#include <atomic>
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "src/utils/blocking_counter.h"
+#include "src/utils/threadpool.h"
+
+namespace libgav1 {
+namespace {
+
+constexpr int kNumWorkers = 8;
+constexpr int kNumJobs = 64;
+
+TEST(LazyInstanceTest, RetriesAfterFailure) {
+  static LazyInstance<int> instance;
+  int attempts = 0;
+  EXPECT_FALSE(instance.Initialize([&attempts](int* /*value*/) {
+    ++attempts;
+    return false;
+  }));
+  EXPECT_TRUE(instance.Initialize([&attempts](int* value) {
+    ++attempts;
+    *value = 42;
+    return true;
+  }));
+  EXPECT_EQ(attempts, 2);
+  EXPECT_EQ(instance.Get(), 42);
+
+  // Once initialized, the initializer is not called again.
+  EXPECT_TRUE(instance.Initialize([&attempts](int* /*value*/) {
+    ++attempts;
+    return false;
+  }));
+  EXPECT_EQ(attempts, 2);
+  EXPECT_EQ(instance.Get(), 42);
+}
+
+TEST(LazyInstanceTest, ConcurrentInitialize) {
+  static LazyInstance<int> instance;
+  std::unique_ptr<ThreadPool> pool = ThreadPool::Create(kNumWorkers);
+  ASSERT_NE(pool, nullptr);
+  BlockingCounter counter(kNumJobs);
+  std::atomic<int> attempts(0);
+  std::atomic<int> failures(0);
+  for (int i = 0; i < kNumJobs; ++i) {
+    pool->Schedule([&]() {
+      const bool ok = instance.Initialize([&attempts](int* value) {
+        *value = attempts.fetch_add(1) + 1;
+        return true;
+      });
+      if (!ok || instance.Get() != 1) failures.fetch_add(1);
+      counter.Decrement();
+    });
+  }
+  counter.Wait();
+  EXPECT_EQ(attempts.load(), 1);
+  EXPECT_EQ(failures.load(), 0);
+  EXPECT_EQ(&instance.Get(), &instance.Get());
+}
+
+}  // namespace
+}  // namespace libgav1
@@ -25,6 +25,7 @@ list(APPEND libgav1_utils_sources
             "${libgav1_source}/utils/block_parameters_holder.cc"
             "${libgav1_source}/utils/block_parameters_holder.h"
             "${libgav1_source}/utils/blocking_counter.h"
+            "${libgav1_source}/utils/closure.h"
             "${libgav1_source}/utils/common.h"
             "${libgav1_source}/utils/compiler_attributes.h"
             "${libgav1_source}/utils/constants.cc"
@@ -36,6 +37,7 @@ list(APPEND libgav1_utils_sources
             "${libgav1_source}/utils/entropy_decoder.h"
             "${libgav1_source}/utils/executor.cc"
             "${libgav1_source}/utils/executor.h"
+            "${libgav1_source}/utils/lazy_instance.h"
             "${libgav1_source}/utils/logging.cc"
             "${libgav1_source}/utils/logging.h"
             "${libgav1_source}/utils/memory.h"
@@ -52,7 +54,8 @@ list(APPEND libgav1_utils_sources
             "${libgav1_source}/utils/threadpool.h"
             "${libgav1_source}/utils/types.h"
             "${libgav1_source}/utils/unbounded_queue.h"
-            "${libgav1_source}/utils/vector.h")
+            "${libgav1_source}/utils/vector.h"
+            "${libgav1_source}/utils/work_stealing_deque.h")
 
 macro(libgav1_add_utils_targets)
   libgav1_add_library(NAME
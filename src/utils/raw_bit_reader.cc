@@ -48,6 +48,13 @@ RawBitReader::RawBitReader(const uint8_t* data, size_t size)
   assert(data_ != nullptr || size_ == 0);
 }
 
+void RawBitReader::Reset(const uint8_t* data, size_t size) {
+  data_ = data;
+  bit_offset_ = 0;
+  size_ = size;
+  assert(data_ != nullptr || size_ == 0);
+}
+
 int RawBitReader::ReadBitImpl() {
   const size_t byte_offset = DivideBy8(bit_offset_, false);
   const uint8_t byte = data_[byte_offset];
@@ -165,6 +165,21 @@ TEST_P(RawBitReaderTest, ZeroSize) {
   EXPECT_EQ(raw_bit_reader_->ReadLiteral(2), -1);
 }
 
+TEST_P(RawBitReaderTest, Reset) {
+  if (RunOnlyOnce()) return;
+  CreateReader(test_data_size_);
+  EXPECT_EQ(raw_bit_reader_->ReadLiteral(8), data_[0]);
+  const std::vector<uint8_t> data = {0xa5, 0x0f};
+  raw_bit_reader_->Reset(data.data(), data.size());
+  EXPECT_EQ(raw_bit_reader_->bit_offset(), 0);
+  EXPECT_EQ(raw_bit_reader_->size(), data.size());
+  EXPECT_EQ(raw_bit_reader_->ReadLiteral(8), 0xa5);
+  EXPECT_EQ(raw_bit_reader_->ReadLiteral(8), 0x0f);
+  EXPECT_TRUE(raw_bit_reader_->Finished());
+  raw_bit_reader_->Reset(nullptr, 0);
+  EXPECT_EQ(raw_bit_reader_->ReadBit(), -1);
+}
+
 TEST_P(RawBitReaderTest, AlignToNextByte) {
   if (RunOnlyOnce()) return;
   CreateReader({0x00, 0x00, 0x00, 0x0f});
@@ -56,16 +56,32 @@ static pid_t GetTid() { return static_cast<pid_t>(syscall(SYS_gettid)); }
 
 namespace libgav1 {
 
-#if defined(__ANDROID__)
 namespace {
 
+#if defined(__ANDROID__)
 using Clock = std::chrono::steady_clock;
 using Duration = Clock::duration;
 constexpr Duration kBusyWaitDuration =
     std::chrono::duration_cast<Duration>(std::chrono::duration<double>(2e-3));
+#endif  // defined(__ANDROID__)
+
+// The pool whose worker function is running on the current thread and the
+// index of the worker in that pool. Used by Schedule() to find the deque of
+// the calling worker.
+thread_local const void* current_pool = nullptr;
+thread_local int current_worker_index = -1;
+
+// Returns a pseudo-random number (xorshift32). |*state| must not be zero.
+uint32_t NextRandom(uint32_t* const state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
 
 }  // namespace
-#endif  // defined(__ANDROID__)
 
 // static
 std::unique_ptr<ThreadPool> ThreadPool::Create(int num_threads) {
@@ -79,18 +95,37 @@ std::unique_ptr<ThreadPool> ThreadPool::Create(const char name_prefix[],
   std::unique_ptr<WorkerThread*[]> threads(new (std::nothrow)
                                                WorkerThread*[num_threads]);
   if (threads == nullptr) return nullptr;
+  std::unique_ptr<WorkerQueue[]> worker_queues(new (std::nothrow)
+                                                   WorkerQueue[num_threads]);
+  if (worker_queues == nullptr) return nullptr;
   std::unique_ptr<ThreadPool> pool(new (std::nothrow) ThreadPool(
-      name_prefix, std::move(threads), num_threads));
+      name_prefix, std::move(threads), std::move(worker_queues), num_threads));
   if (pool != nullptr && !pool->StartWorkers()) {
     pool = nullptr;
   }
   return pool;
 }
 
+// static
+std::unique_ptr<ThreadPool> ThreadPool::CreateOnExecutor(
+    ScheduleJobFunction schedule_job, void* executor_private_data,
+    int num_threads) {
+  if (schedule_job == nullptr || num_threads <= 0) return nullptr;
+  std::unique_ptr<ThreadPool> pool(new (std::nothrow) ThreadPool(
+      schedule_job, executor_private_data, num_threads));
+  if (pool != nullptr && !pool->queue_.Init()) {
+    pool = nullptr;
+  }
+  return pool;
+}
+
 ThreadPool::ThreadPool(const char name_prefix[],
                        std::unique_ptr<WorkerThread*[]> threads,
+                       std::unique_ptr<WorkerQueue[]> worker_queues,
                        int num_threads)
-    : threads_(std::move(threads)), num_threads_(num_threads) {
+    : threads_(std::move(threads)),
+      worker_queues_(std::move(worker_queues)),
+      num_threads_(num_threads) {
   threads_[0] = nullptr;
   assert(name_prefix != nullptr);
   const size_t name_prefix_len =
@@ -99,9 +134,38 @@ ThreadPool::ThreadPool(const char name_prefix[],
   name_prefix_[name_prefix_len] = '\0';
 }
 
+ThreadPool::ThreadPool(ScheduleJobFunction schedule_job,
+                       void* executor_private_data, int num_threads)
+    : num_threads_(num_threads),
+      schedule_job_(schedule_job),
+      executor_private_data_(executor_private_data) {
+  name_prefix_[0] = '\0';
+}
+
 ThreadPool::~ThreadPool() { Shutdown(); }
 
-void ThreadPool::Schedule(std::function<void()> closure) {
+void ThreadPool::Schedule(Closure closure) {
+  if (current_pool == this) {
+    // Called from one of our worker threads. Push the job to its deque.
+    const int index = current_worker_index;
+    JobNode* const node = AllocateJobNode(index);
+    if (node == nullptr) {
+      closure();
+      return;
+    }
+    node->closure = std::move(closure);
+    if (!worker_queues_[index].deque.Push(node)) {
+      // The deque is full and we can't grow it. Run the job directly.
+      TakeJobFromNode(index, node, &closure);
+      closure();
+      return;
+    }
+    // The push above and this load are sequentially consistent. So either
+    // this load sees the increment done by a worker that is going to sleep, or
+    // that worker's final look for jobs sees |job|.
+    if (num_idle_workers_.load() > 0) WakeOne();
+    return;
+  }
   LockMutex();
   if (!queue_.GrowIfNeeded()) {
     // queue_ is full and we can't grow it. Run |closure| directly.
@@ -110,6 +174,54 @@ void ThreadPool::Schedule(std::function<void()> closure) {
     return;
   }
   queue_.Push(std::move(closure));
+  queue_size_.fetch_add(1, std::memory_order_relaxed);
+  if (schedule_job_ != nullptr) {
+    const bool submit = num_executor_jobs_ < num_threads_;
+    if (submit) ++num_executor_jobs_;
+    UnlockMutex();
+    if (submit) schedule_job_(executor_private_data_, RunExecutorJob, this);
+    return;
+  }
+  ++wake_epoch_;
+  UnlockMutex();
+  SignalOne();
+}
+
+// static
+void ThreadPool::RunExecutorJob(void* arg) {
+  auto* const pool = static_cast<ThreadPool*>(arg);
+  pool->LockMutex();
+  // Another executor job may have taken the job this one was submitted for.
+  if (pool->queue_.Empty()) {
+    // Signal while holding the mutex because Shutdown() may destroy the pool
+    // as soon as the mutex is released.
+    if (--pool->num_executor_jobs_ == 0) pool->SignalAll();
+    pool->UnlockMutex();
+    return;
+  }
+  Closure job = std::move(pool->queue_.Front());
+  pool->queue_.Pop();
+  pool->queue_size_.fetch_sub(1, std::memory_order_relaxed);
+  pool->UnlockMutex();
+
+  job();
+  job = nullptr;
+
+  pool->LockMutex();
+  if (pool->queue_.Empty()) {
+    if (--pool->num_executor_jobs_ == 0) pool->SignalAll();
+    pool->UnlockMutex();
+    return;
+  }
+  pool->UnlockMutex();
+  // Give the jobs of the other users of the executor a turn before running the
+  // next job.
+  pool->schedule_job_(pool->executor_private_data_, RunExecutorJob, pool);
+}
+
+void ThreadPool::WakeOne() {
+  LockMutex();
+  ++wake_epoch_;
   UnlockMutex();
   SignalOne();
 }
@@ -121,8 +233,8 @@ int ThreadPool::num_threads() const { return num_threads_; }
 // Thread, or replace it at such a time as one is implemented.
 class ThreadPool::WorkerThread : public Allocable {
  public:
-  // Creates and starts a thread that runs pool->WorkerFunction().
-  explicit WorkerThread(ThreadPool* pool);
+  // Creates and starts a thread that runs pool->WorkerFunction(index).
+  WorkerThread(ThreadPool* pool, int index);
 
   // Not copyable or movable.
   WorkerThread(const WorkerThread&) = delete;
@@ -148,6 +260,7 @@ class ThreadPool::WorkerThread : public Allocable {
   void Run();
 
   ThreadPool* pool_;
+  const int index_;
 #if defined(_MSC_VER)
   HANDLE handle_;
 #else
@@ -155,7 +268,8 @@ class ThreadPool::WorkerThread : public Allocable {
 #endif
 };
 
-ThreadPool::WorkerThread::WorkerThread(ThreadPool* pool) : pool_(pool) {}
+ThreadPool::WorkerThread::WorkerThread(ThreadPool* pool, int index)
+    : pool_(pool), index_(index) {}
 
 #if defined(_MSC_VER)
 
@@ -236,13 +350,17 @@ void ThreadPool::WorkerThread::SetupName() {
 
 void ThreadPool::WorkerThread::Run() {
   SetupName();
-  pool_->WorkerFunction();
+  pool_->WorkerFunction(index_);
 }
 
 bool ThreadPool::StartWorkers() {
   if (!queue_.Init()) return false;
+  // All the deques must be ready before any worker can try to steal from them.
+  for (int i = 0; i < num_threads_; ++i) {
+    if (!worker_queues_[i].deque.Init()) return false;
+  }
   for (int i = 0; i < num_threads_; ++i) {
-    threads_[i] = new (std::nothrow) WorkerThread(this);
+    threads_[i] = new (std::nothrow) WorkerThread(this, i);
     if (threads_[i] == nullptr) return false;
     if (!threads_[i]->Start()) {
       delete threads_[i];
@@ -253,67 +371,159 @@ bool ThreadPool::StartWorkers() {
   return true;
 }
 
-void ThreadPool::WorkerFunction() {
-  LockMutex();
-  while (true) {
-    if (queue_.Empty()) {
-      if (exit_threads_) {
-        break;  // Queue is empty and exit was requested.
+ThreadPool::WorkerQueue::~WorkerQueue() {
+  // All the nodes are back in the free lists of their owners once the worker
+  // threads have exited.
+  assert(deque.Empty());
+  JobNode* node = remote_free_nodes.load(std::memory_order_acquire);
+  while (node != nullptr) {
+    JobNode* const next = node->next;
+    delete node;
+    node = next;
+  }
+  node = free_nodes;
+  while (node != nullptr) {
+    JobNode* const next = node->next;
+    delete node;
+    node = next;
+  }
+}
+
+ThreadPool::JobNode* ThreadPool::AllocateJobNode(int index) {
+  WorkerQueue& worker_queue = worker_queues_[index];
+  if (worker_queue.free_nodes == nullptr) {
+    worker_queue.free_nodes =
+        worker_queue.remote_free_nodes.exchange(nullptr,
+                                                std::memory_order_acquire);
+  }
+  JobNode* node = worker_queue.free_nodes;
+  if (node != nullptr) {
+    worker_queue.free_nodes = node->next;
+    return node;
+  }
+  node = new (std::nothrow) JobNode;
+  if (node != nullptr) node->owner = index;
+  return node;
+}
+
+void ThreadPool::TakeJobFromNode(int index, JobNode* node, Closure* job) {
+  *job = std::move(node->closure);
+  WorkerQueue& owner_queue = worker_queues_[node->owner];
+  if (node->owner == index) {
+    node->next = owner_queue.free_nodes;
+    owner_queue.free_nodes = node;
+    return;
+  }
+  node->next = owner_queue.remote_free_nodes.load(std::memory_order_relaxed);
+  while (!owner_queue.remote_free_nodes.compare_exchange_weak(
+      node->next, node, std::memory_order_release,
+      std::memory_order_relaxed)) {
+  }
+}
+
+bool ThreadPool::FindJob(int index, uint32_t* random_state, Closure* job) {
+  JobNode* node;
+  if (worker_queues_[index].deque.Pop(&node)) {
+    TakeJobFromNode(index, node, job);
+    return true;
+  }
+  if (queue_size_.load(std::memory_order_relaxed) > 0) {
+    LockMutex();
+    if (!queue_.Empty()) {
+      *job = std::move(queue_.Front());
+      queue_.Pop();
+      queue_size_.fetch_sub(1, std::memory_order_relaxed);
+      UnlockMutex();
+      return true;
+    }
+    UnlockMutex();
+  }
+  if (num_threads_ > 1) {
+    const int start = NextRandom(random_state) % num_threads_;
+    for (int i = 0; i < num_threads_; ++i) {
+      int victim = start + i;
+      if (victim >= num_threads_) victim -= num_threads_;
+      if (victim != index && worker_queues_[victim].deque.Steal(&node)) {
+        TakeJobFromNode(index, node, job);
+        return true;
       }
+    }
+  }
+  return false;
+}
+
+void ThreadPool::WorkerFunction(int index) {
+  current_pool = this;
+  current_worker_index = index;
+  uint32_t random_state = static_cast<uint32_t>(index) + 1;
+  Closure job;
+  while (true) {
+    bool found_job = FindJob(index, &random_state, &job);
 #if defined(__ANDROID__)
-      // On android, if we go to a conditional wait right away, the CPU governor
-      // kicks in and starts shutting the cores down. So we do a very small busy
-      // wait to see if we get our next job within that period. This
-      // significantly improves the performance of common cases of tile parallel
-      // decoding. If we don't receive a job in the busy wait time, we then go
-      // to an actual conditional wait as usual.
-      UnlockMutex();
-      bool found_job = false;
+    // On android, if we go to a conditional wait right away, the CPU governor
+    // kicks in and starts shutting the cores down. So we do a very small busy
+    // wait to see if we get our next job within that period. This
+    // significantly improves the performance of common cases of tile parallel
+    // decoding. If we don't receive a job in the busy wait time, we then go
+    // to an actual conditional wait as usual.
+    if (!found_job) {
       const auto wait_start = Clock::now();
       while (Clock::now() - wait_start < kBusyWaitDuration) {
-        LockMutex();
-        if (!queue_.Empty()) {
-          found_job = true;
+        found_job = FindJob(index, &random_state, &job);
+        if (found_job) break;
+      }
+    }
+#endif  // defined(__ANDROID__)
+    if (!found_job) {
+      // Announce that we are about to sleep before looking for jobs one last
+      // time. A job scheduled after the last look either increments
+      // |wake_epoch_| or is seen by the last look (see Schedule()).
+      num_idle_workers_.fetch_add(1);
+      LockMutex();
+      const uint64_t wake_epoch = wake_epoch_;
+      const bool exit_threads = exit_threads_;
+      UnlockMutex();
+      found_job = FindJob(index, &random_state, &job);
+      if (!found_job) {
+        if (exit_threads) {
+          // No jobs are left and exit was requested.
+          num_idle_workers_.fetch_sub(1);
           break;
         }
+        LockMutex();
+        while (wake_epoch_ == wake_epoch && !exit_threads_) {
+          Wait();
+        }
         UnlockMutex();
       }
-      // If |found_job| is true, we simply continue since we already hold the
-      // mutex and we know for sure that the |queue_| is not empty.
-      if (found_job) continue;
-      // Since |found_job_| was false, the mutex is not being held at this
-      // point.
-      LockMutex();
-      // Ensure that the queue is still empty.
-      if (!queue_.Empty()) continue;
-      if (exit_threads_) {
-        break;  // Queue is empty and exit was requested.
-      }
-#endif  // defined(__ANDROID__)
-      // Queue is still empty, wait for signal or broadcast.
-      Wait();
-    } else {
-      // Take a job from the queue.
-      std::function<void()> job = std::move(queue_.Front());
-      queue_.Pop();
-
-      UnlockMutex();
-      // Note that it is good practice to surround this with a try/catch so
-      // the thread pool doesn't go to hell if the job throws an exception.
-      // This is omitted here because Google3 doesn't like exceptions.
-      std::move(job)();
-      job = nullptr;
-
-      LockMutex();
+      num_idle_workers_.fetch_sub(1);
+      if (!found_job) continue;
     }
+    // Note that it is good practice to surround this with a try/catch so
+    // the thread pool doesn't go to hell if the job throws an exception.
+    // This is omitted here because Google3 doesn't like exceptions.
+    job();
+    job = nullptr;
   }
-  UnlockMutex();
+  current_pool = nullptr;
+  current_worker_index = -1;
 }
 
 void ThreadPool::Shutdown() {
+  if (schedule_job_ != nullptr) {
+    // Wait until the executor has run all the jobs.
+    LockMutex();
+    exit_threads_ = true;
+    while (num_executor_jobs_ != 0) {
+      Wait();
+    }
+    UnlockMutex();
+    return;
+  }
   // Tell worker threads how to exit.
   LockMutex();
   exit_threads_ = true;
+  ++wake_epoch_;
   UnlockMutex();
   SignalAll();
 
@@ -17,7 +17,8 @@
 #ifndef LIBGAV1_SRC_UTILS_THREADPOOL_H_
 #define LIBGAV1_SRC_UTILS_THREADPOOL_H_
 
-#include <functional>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 
 #if defined(__APPLE__)
@@ -43,10 +44,12 @@
 #include "absl/synchronization/mutex.h"
 #endif
 
+#include "src/utils/closure.h"
 #include "src/utils/compiler_attributes.h"
 #include "src/utils/executor.h"
 #include "src/utils/memory.h"
 #include "src/utils/unbounded_queue.h"
+#include "src/utils/work_stealing_deque.h"
 
 namespace libgav1 {
 
@@ -56,6 +59,12 @@ namespace libgav1 {
 // - The pool allocates a fixed number of worker threads on instantiation.
 // - The worker threads will pick up work jobs as they arrive.
 // - If all workers are busy, work jobs are queued for later execution.
+// - Jobs scheduled by threads outside the pool go to a shared FIFO queue.
+//   Jobs scheduled by a worker thread of the pool go to that worker's own
+//   work-stealing deque. A worker runs the jobs in its own deque in LIFO
+//   order, then the jobs in the shared queue, and then steals the oldest job
+//   from the deque of a randomly chosen worker. This keeps the shared queue
+//   mutex out of the path of jobs that schedule further jobs.
 //
 // The thread pool is shut down when the pool is destroyed.
 //
@@ -68,14 +77,34 @@ namespace libgav1 {
 //   } // ThreadPool gets destroyed only when all jobs are done.
 class ThreadPool : public Executor, public Allocable {
  public:
+  // The signature of the function through which a pool created by
+  // CreateOnExecutor() submits work to a caller-owned executor. The executor
+  // must eventually call |job|(|job_arg|) exactly once, on any thread. It is
+  // the same as the Libgav1ScheduleJobCallback type of the public API.
+  using ScheduleJobFunction = void (*)(void* executor_private_data,
+                                       void (*job)(void* job_arg),
+                                       void* job_arg);
+
   // Creates the thread pool with the specified number of worker threads.
-  // If num_threads is 1, the closures are run in FIFO order.
+  // If num_threads is 1, the closures scheduled from outside the pool are run
+  // in FIFO order.
   static std::unique_ptr<ThreadPool> Create(int num_threads);
 
   // Like the above factory method, but also sets the name prefix for threads.
   static std::unique_ptr<ThreadPool> Create(const char name_prefix[],
                                             int num_threads);
 
+  // Creates a thread pool that does not create any threads. Instead, its jobs
+  // are run on the caller-owned executor through |schedule_job|, which is
+  // called with |executor_private_data|. At most |num_threads| jobs of the
+  // pool run at a time. Each executor job runs one job of the pool and then
+  // resubmits itself, so pools that share a FIFO executor take turns between
+  // jobs. A job that blocks keeps its executor thread until it returns. The
+  // closures are run in FIFO order if num_threads is 1.
+  static std::unique_ptr<ThreadPool> CreateOnExecutor(
+      ScheduleJobFunction schedule_job, void* executor_private_data,
+      int num_threads);
+
   // The destructor will shut down the thread pool and all jobs are executed.
   // Note that after shutdown, the thread pool does not accept further jobs.
   ~ThreadPool() override;
@@ -84,28 +113,83 @@ class ThreadPool : public Executor, public Allocable {
   // are available, "closure" will run immediately. Otherwise "closure" is
   // queued for later execution.
   //
-  // NOTE: If the internal queue is full and cannot be resized because of an
-  // out-of-memory error, the current thread runs "closure" before returning
-  // from Schedule(). For our use cases, this seems better than the
+  // NOTE: If the internal queue or deque is full and cannot be resized because
+  // of an out-of-memory error, the current thread runs "closure" before
+  // returning from Schedule(). For our use cases, this seems better than the
   // alternatives:
   //   1. Return a failure status.
   //   2. Have the current thread wait until the queue is not full.
-  void Schedule(std::function<void()> closure) override;
+  //
+  // Once the pool has warmed up, Schedule() does not allocate memory.
+  void Schedule(Closure closure) override;
 
   int num_threads() const;
 
  private:
   class WorkerThread;
 
+  // A job scheduled by a worker thread. The nodes are recycled through the
+  // free lists of the worker that allocated them, so Schedule() does not
+  // allocate memory once enough nodes exist.
+  struct JobNode : public Allocable {
+    Closure closure;
+    JobNode* next = nullptr;
+    // The index of the worker that allocated the node.
+    int owner;
+  };
+
+  // The parts of the state of a worker thread that other threads access.
+  struct WorkerQueue : public Allocable {
+    ~WorkerQueue();
+
+    WorkStealingDeque<JobNode*> deque;
+    // Free nodes of this worker. Only accessed by this worker.
+    JobNode* free_nodes = nullptr;
+    // Free nodes of this worker that were released by other workers. The other
+    // workers push onto this list and this worker takes the whole list at
+    // once, so the list does not suffer from the ABA problem.
+    std::atomic<JobNode*> remote_free_nodes{nullptr};
+  };
+
   // Creates the thread pool with the specified number of worker threads.
-  // If num_threads is 1, the closures are run in FIFO order.
+  // If num_threads is 1, the closures scheduled from outside the pool are run
+  // in FIFO order.
   ThreadPool(const char name_prefix[], std::unique_ptr<WorkerThread*[]> threads,
+             std::unique_ptr<WorkerQueue[]> worker_queues,
+             int num_threads);
+
+  // Creates a thread pool that runs its jobs on a caller-owned executor. See
+  // CreateOnExecutor().
+  ThreadPool(ScheduleJobFunction schedule_job, void* executor_private_data,
              int num_threads);
 
   // Starts the worker pool.
   LIBGAV1_MUST_USE_RESULT bool StartWorkers();
 
-  void WorkerFunction();
+  // The job submitted to the caller-owned executor. |arg| is the ThreadPool.
+  // Runs the job at the front of |queue_|.
+  static void RunExecutorJob(void* arg);
+
+  // |index| is the index of the worker thread in |threads_| and
+  // |worker_queues_|.
+  void WorkerFunction(int index);
+
+  // Takes a job from the deque of the worker thread |index|, the shared queue
+  // or the deque of another worker thread, in that order, and moves it into
+  // |job|. |random_state| is the state of the worker's random number generator
+  // used to choose the victims of stealing. Returns false if no job was found.
+  bool FindJob(int index, uint32_t* random_state, Closure* job);
+
+  // Returns a free node for the worker thread |index|, or nullptr on
+  // allocation failure.
+  JobNode* AllocateJobNode(int index);
+
+  // Moves the job in |node| into |job| and returns |node| to the free lists of
+  // its owner. Called by the worker thread |index|.
+  void TakeJobFromNode(int index, JobNode* node, Closure* job);
+
+  // Wakes up one sleeping worker thread.
+  void WakeOne();
 
   // Shuts down the thread pool, i.e. worker threads finish their work and
   // pick up new jobs until the queue is empty. This call will block until
@@ -147,13 +231,32 @@ class ThreadPool : public Executor, public Allocable {
 
 #endif  // LIBGAV1_THREADPOOL_USE_STD_MUTEX
 
-  UnboundedQueue<std::function<void()>> queue_ LIBGAV1_GUARDED_BY(queue_mutex_);
+  UnboundedQueue<Closure> queue_ LIBGAV1_GUARDED_BY(queue_mutex_);
+  // The number of jobs in |queue_|. It is only modified with |queue_mutex_|
+  // held but is read without it so that the workers can skip locking the mutex
+  // when |queue_| is empty.
+  std::atomic<int> queue_size_{0};
   // If not all the worker threads are created, the first entry after the
   // created worker threads is a null pointer.
   const std::unique_ptr<WorkerThread*[]> threads_;
+  // The work-stealing deques and job node free lists of the worker threads.
+  const std::unique_ptr<WorkerQueue[]> worker_queues_;
+  // The number of worker threads that are about to sleep or are sleeping.
+  // Schedule() only wakes up a worker after a push to a deque if this is
+  // nonzero.
+  std::atomic<int> num_idle_workers_{0};
+  // Incremented whenever a sleeping worker should wake up and look for jobs.
+  uint64_t wake_epoch_ LIBGAV1_GUARDED_BY(queue_mutex_) = 0;
 
   bool exit_threads_ LIBGAV1_GUARDED_BY(queue_mutex_) = false;
   const int num_threads_ = 0;
+  // The caller-owned executor if the pool was created by CreateOnExecutor().
+  // |threads_| and |worker_queues_| are null in that case.
+  const ScheduleJobFunction schedule_job_ = nullptr;
+  void* const executor_private_data_ = nullptr;
+  // The number of jobs submitted to the caller-owned executor that have not
+  // finished yet. At most |num_threads_|.
+  int num_executor_jobs_ LIBGAV1_GUARDED_BY(queue_mutex_) = 0;
   // name_prefix_ is a C string, whose length is restricted to 16 characters,
   // including the terminating null byte ('\0'). This restriction comes from
   // the Linux pthread_setname_np() function.
@@ -14,16 +14,29 @@
 
 #include "src/utils/threadpool.h"
 
+#include <atomic>
 #include <cassert>
+#include <condition_variable>  // NOLINT (unapproved c++11 header)
+#include <cstddef>
 #include <cstdint>
+#include <cstdio>
 #include <memory>
+#include <mutex>   // NOLINT (unapproved c++11 header)
+#include <new>
+#include <thread>  // NOLINT (unapproved c++11 header)
+#include <utility>
+#include <vector>
 
 #include "absl/synchronization/mutex.h"
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "gtest/gtest.h"
+#include "src/utils/blocking_counter.h"
+#include "src/utils/closure.h"
 #include "src/utils/compiler_attributes.h"
 #include "src/utils/executor.h"
+#include "src/utils/unbounded_queue.h"
+#include "tests/counting_allocator.h"
 
 namespace libgav1 {
 namespace {
@@ -115,7 +128,8 @@ TEST(ThreadPoolTest, NumThreadsZero) {
   EXPECT_EQ(thread_pool, nullptr);
 }
 
-// If num_threads is 1, the closures are run in FIFO order.
+// If num_threads is 1, the closures scheduled from outside the pool are run in
+// FIFO order.
 TEST(ThreadPoolTest, OneThreadRunsClosuresFIFO) {
   int count = 0;  // Declare first so that it outlives the thread pool.
   std::unique_ptr<ThreadPool> pool = ThreadPool::Create(1);
@@ -129,5 +143,289 @@ TEST(ThreadPoolTest, OneThreadRunsClosuresFIFO) {
   }
 }
 
+// Schedules a binary tree of jobs of the given |depth| from within the jobs
+// themselves, so that most jobs are pushed to and stolen from the deques of
+// the worker threads. |pending| is decremented when a job is done.
+void ScheduleTree(Executor* executor, int depth, SimpleGuardedInteger* pending,
+                  std::atomic<int>* count) {
+  count->fetch_add(1, std::memory_order_relaxed);
+  if (depth > 0) {
+    for (int i = 0; i < 2; ++i) {
+      pending->Increment();
+      executor->Schedule([executor, depth, pending, count]() {
+        ScheduleTree(executor, depth - 1, pending, count);
+      });
+    }
+  }
+  pending->Decrement();
+}
+
+TEST(ThreadPoolTest, WorkersScheduleJobs) {
+  for (const int num_threads : {1, 2, 8}) {
+    std::unique_ptr<ThreadPool> thread_pool = ThreadPool::Create(num_threads);
+    ASSERT_NE(thread_pool, nullptr);
+    SimpleGuardedInteger pending(1);
+    std::atomic<int> count(0);
+    ThreadPool* const pool = thread_pool.get();
+    thread_pool->Schedule([pool, &pending, &count]() {
+      ScheduleTree(pool, 12, &pending, &count);
+    });
+    pending.WaitForZero();
+    EXPECT_EQ(count.load(), (1 << 13) - 1) << "num_threads: " << num_threads;
+  }
+}
+
+// The jobs scheduled by a worker thread before the pool is destroyed must all
+// run.
+TEST(ThreadPoolTest, ShutdownRunsJobsScheduledByWorkers) {
+  std::atomic<int> count(0);
+  {
+    std::unique_ptr<ThreadPool> thread_pool = ThreadPool::Create(4);
+    ASSERT_NE(thread_pool, nullptr);
+    ThreadPool* const pool = thread_pool.get();
+    for (int i = 0; i < 10; ++i) {
+      thread_pool->Schedule([pool, &count]() {
+        for (int j = 0; j < 100; ++j) {
+          pool->Schedule([&count]() { ++count; });
+        }
+      });
+    }
+  }
+  EXPECT_EQ(count.load(), 1000);
+}
+
+// Blocks the jobs that call Wait() until Open() is called.
+class Gate {
+ public:
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this]() { return open_; });
+  }
+
+  void Open() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      open_ = true;
+    }
+    condition_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool open_ = false;
+};
+
+// Schedules |num_roots| jobs from the calling thread, each of which schedules
+// |fan_out| jobs from the worker thread, and waits for all of them. The
+// captures of the jobs are as large as a Closure allows. The worker is held
+// until all the root jobs are queued so that the queue sizes do not depend on
+// timing.
+void RunFanOut(ThreadPool* thread_pool, int num_roots, int fan_out) {
+  Gate gate;
+  BlockingCounter pending(num_roots * (fan_out + 1));
+  thread_pool->Schedule([&gate]() { gate.Wait(); });
+  struct Payload {
+    uint8_t bytes[Closure::kStorageSize - 3 * sizeof(void*)];
+  };
+  const Payload payload = {};
+  for (int i = 0; i < num_roots; ++i) {
+    thread_pool->Schedule([thread_pool, fan_out, &pending, payload]() {
+      for (int j = 0; j < fan_out; ++j) {
+        thread_pool->Schedule([&pending, payload]() {
+          static_cast<void>(payload);
+          pending.Decrement();
+        });
+      }
+      pending.Decrement();
+    });
+  }
+  gate.Open();
+  pending.Wait();
+}
+
+// Once the pool has warmed up, scheduling jobs from outside the pool and from
+// its worker threads does not allocate memory. One worker thread is used so
+// that the jobs are spread over the internal queues in the same way each time.
+TEST(ThreadPoolTest, ScheduleDoesNotAllocate) {
+  constexpr int kNumRoots = 100;
+  constexpr int kFanOut = 300;
+  std::unique_ptr<ThreadPool> thread_pool = ThreadPool::Create(1);
+  ASSERT_NE(thread_pool, nullptr);
+  RunFanOut(thread_pool.get(), kNumRoots, kFanOut);
+  const int count_before = test_utils::allocation_count.load();
+  for (int i = 0; i < 10; ++i) {
+    RunFanOut(thread_pool.get(), kNumRoots, kFanOut);
+  }
+  EXPECT_EQ(test_utils::allocation_count.load(), count_before);
+}
+
+// Runs the jobs of a pool created by ThreadPool::CreateOnExecutor() on
+// |executor_private_data|, which is a ThreadPool.
+void ScheduleOnThreadPool(void* executor_private_data, void (*job)(void*),
+                          void* job_arg) {
+  static_cast<ThreadPool*>(executor_private_data)->Schedule([job, job_arg]() {
+    job(job_arg);
+  });
+}
+
+// The jobs of pools that share an executor all run, and no pool runs more
+// jobs at a time than its number of threads.
+TEST(ThreadPoolTest, CreateOnExecutor) {
+  constexpr int kNumPools = 3;
+  constexpr int kNumJobs = 500;
+  std::unique_ptr<ThreadPool> executor = ThreadPool::Create(6);
+  ASSERT_NE(executor, nullptr);
+  EXPECT_EQ(ThreadPool::CreateOnExecutor(nullptr, nullptr, 2), nullptr);
+  EXPECT_EQ(ThreadPool::CreateOnExecutor(ScheduleOnThreadPool, executor.get(),
+                                         0),
+            nullptr);
+
+  std::atomic<int> count[kNumPools];
+  std::atomic<int> running[kNumPools];
+  std::atomic<int> max_running[kNumPools];
+  for (int i = 0; i < kNumPools; ++i) {
+    count[i] = running[i] = max_running[i] = 0;
+  }
+  {
+    std::unique_ptr<ThreadPool> pools[kNumPools];
+    for (int i = 0; i < kNumPools; ++i) {
+      pools[i] = ThreadPool::CreateOnExecutor(ScheduleOnThreadPool,
+                                              executor.get(), i + 1);
+      ASSERT_NE(pools[i], nullptr);
+      EXPECT_EQ(pools[i]->num_threads(), i + 1);
+    }
+    for (int j = 0; j < kNumJobs; ++j) {
+      for (int i = 0; i < kNumPools; ++i) {
+        std::atomic<int>* const pool_count = &count[i];
+        std::atomic<int>* const pool_running = &running[i];
+        std::atomic<int>* const pool_max_running = &max_running[i];
+        pools[i]->Schedule([pool_count, pool_running, pool_max_running]() {
+          const int now_running = ++*pool_running;
+          int max = pool_max_running->load();
+          while (now_running > max &&
+                 !pool_max_running->compare_exchange_weak(max, now_running)) {
+          }
+          ++*pool_count;
+          --*pool_running;
+        });
+      }
+    }
+    // The destructors of |pools| wait for their jobs.
+  }
+  for (int i = 0; i < kNumPools; ++i) {
+    EXPECT_EQ(count[i].load(), kNumJobs) << "pool " << i;
+    EXPECT_GE(max_running[i].load(), 1) << "pool " << i;
+    EXPECT_LE(max_running[i].load(), i + 1) << "pool " << i;
+  }
+}
+
+// The thread pool design that ThreadPool used before the work-stealing deques
+// were added: all the jobs go through a single queue protected by a mutex.
+// Used as the baseline in the Speed test.
+class SingleQueueThreadPool : public Executor {
+ public:
+  explicit SingleQueueThreadPool(int num_threads) {
+    const bool ok = queue_.Init();
+    assert(ok);
+    static_cast<void>(ok);
+    for (int i = 0; i < num_threads; ++i) {
+      threads_.emplace_back([this]() { WorkerFunction(); });
+    }
+  }
+
+  ~SingleQueueThreadPool() override {
+    {
+      absl::MutexLock l(&mutex_);
+      exit_threads_ = true;
+      condition_.SignalAll();
+    }
+    for (auto& thread : threads_) thread.join();
+  }
+
+  void Schedule(Closure callback) override {
+    absl::MutexLock l(&mutex_);
+    const bool ok = queue_.GrowIfNeeded();
+    assert(ok);
+    static_cast<void>(ok);
+    queue_.Push(std::move(callback));
+    condition_.Signal();
+  }
+
+ private:
+  void WorkerFunction() {
+    mutex_.Lock();
+    while (true) {
+      if (queue_.Empty()) {
+        if (exit_threads_) break;
+        condition_.Wait(&mutex_);
+        continue;
+      }
+      Closure job = std::move(queue_.Front());
+      queue_.Pop();
+      mutex_.Unlock();
+      job();
+      job = nullptr;
+      mutex_.Lock();
+    }
+    mutex_.Unlock();
+  }
+
+  absl::Mutex mutex_;
+  absl::CondVar condition_;
+  UnboundedQueue<Closure> queue_ LIBGAV1_GUARDED_BY(mutex_);
+  bool exit_threads_ LIBGAV1_GUARDED_BY(mutex_) = false;
+  std::vector<std::thread> threads_;
+};
+
+// Returns the number of jobs per second the executor runs when |num_roots| jobs
+// scheduled from the calling thread each schedule |fan_out| tiny jobs from a
+// worker thread. This resembles the scheduling of superblock rows and post
+// filter units by the decoder.
+double MeasureThroughput(Executor* executor, int num_roots, int fan_out) {
+  const int num_jobs = num_roots * (fan_out + 1);
+  // Only the last job touches |done| so that the bookkeeping does not
+  // serialize the jobs.
+  std::atomic<int> pending(num_jobs);
+  BlockingCounter done(1);
+  const auto finish_job = [&pending, &done]() {
+    if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) done.Decrement();
+  };
+  const absl::Time start = absl::Now();
+  for (int i = 0; i < num_roots; ++i) {
+    executor->Schedule([executor, fan_out, &finish_job]() {
+      for (int j = 0; j < fan_out; ++j) {
+        executor->Schedule(finish_job);
+      }
+      finish_job();
+    });
+  }
+  done.Wait();
+  return num_jobs / absl::ToDoubleSeconds(absl::Now() - start);
+}
+
+TEST(ThreadPoolTest, DISABLED_Speed) {
+  constexpr int kNumRoots = 1000;
+  constexpr int kFanOut = 200;
+  for (const int num_threads : {2, 4, 8, 16, 32}) {
+    double single_queue_throughput;
+    {
+      SingleQueueThreadPool pool(num_threads);
+      single_queue_throughput = MeasureThroughput(&pool, kNumRoots, kFanOut);
+    }
+    double work_stealing_throughput;
+    {
+      std::unique_ptr<ThreadPool> pool = ThreadPool::Create(num_threads);
+      ASSERT_NE(pool, nullptr);
+      work_stealing_throughput =
+          MeasureThroughput(pool.get(), kNumRoots, kFanOut);
+    }
+    printf("threads: %2d single queue: %10.0f jobs/s work stealing: %10.0f "
+           "jobs/s (%.2fx)\n",
+           num_threads, single_queue_throughput, work_stealing_throughput,
+           work_stealing_throughput / single_queue_throughput);
+  }
+}
+
 }  // namespace
 }  // namespace libgav1
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2024 The libgav1 Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGAV1_SRC_UTILS_WORK_STEALING_DEQUE_H_
+#define LIBGAV1_SRC_UTILS_WORK_STEALING_DEQUE_H_
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+#include "src/utils/compiler_attributes.h"
+#include "src/utils/memory.h"
+
+namespace libgav1 {
+
+// A Chase-Lev work-stealing deque of an unbounded capacity.
+//
+// The deque has a single owner thread that calls Push() and Pop() on the
+// bottom end. Any number of other threads may concurrently call Steal() on the
+// top end. So the owner sees the elements in LIFO order and the thieves see
+// them in FIFO order.
+//
+// The implementation follows "Correct and Efficient Work-Stealing for Weak
+// Memory Models" by Le, Pop, Cohen and Zappa Nardelli (PPoPP 2013). For
+// simplicity, the accesses to |top_| and |bottom_| that need to be ordered
+// with respect to each other are sequentially consistent instead of relying on
+// standalone fences. The owner also relies on this when it publishes an
+// element and then checks for sleeping threads (see ThreadPool::Schedule()).
+//
+// The circular buffer grows by doubling. The old buffers may still be read by
+// thieves, so they are kept until the deque is destroyed.
+//
+// T must be trivially copyable (it is typically a pointer) because the
+// elements are read by thieves that may lose the race for them.
+template <typename T>
+class WorkStealingDeque : public Allocable {
+ public:
+  static_assert(std::is_trivially_copyable<T>::value,
+                "T must be trivially copyable.");
+
+  WorkStealingDeque() = default;
+
+  // Not copyable or movable.
+  WorkStealingDeque(const WorkStealingDeque&) = delete;
+  WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+  ~WorkStealingDeque() {
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    while (buffer != nullptr) {
+      Buffer* const previous = buffer->previous;
+      delete buffer;
+      buffer = previous;
+    }
+  }
+
+  // Allocates the initial buffer. Returns false if the allocation failed.
+  LIBGAV1_MUST_USE_RESULT bool Init() {
+    assert(buffer_.load(std::memory_order_relaxed) == nullptr);
+    Buffer* const buffer = Buffer::Create(kInitialCapacity);
+    if (buffer == nullptr) return false;
+    buffer_.store(buffer, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Pushes |value| to the bottom of the deque. Returns false if the deque is
+  // full and the attempt to grow it failed. Must only be called by the owner.
+  LIBGAV1_MUST_USE_RESULT bool Push(T value) {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    const int64_t top = top_.load(std::memory_order_acquire);
+    Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+    if (bottom - top >= buffer->capacity) {
+      buffer = Grow(buffer, top, bottom);
+      if (buffer == nullptr) return false;
+    }
+    buffer->Store(bottom, value);
+    bottom_.store(bottom + 1);
+    return true;
+  }
+
+  // Pops the element at the bottom of the deque (the one that was pushed
+  // last) into |value|. Returns false if the deque is empty. Must only be
+  // called by the owner.
+  LIBGAV1_MUST_USE_RESULT bool Pop(T* value) {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Buffer* const buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(bottom);
+    int64_t top = top_.load();
+    if (top > bottom) {
+      // The deque was empty.
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return false;
+    }
+    *value = buffer->Load(bottom);
+    if (top == bottom) {
+      // This is the last element. Race against the thieves for it.
+      const bool won = top_.compare_exchange_strong(top, top + 1);
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return won;
+    }
+    return true;
+  }
+
+  // Steals the element at the top of the deque (the oldest one) into |value|.
+  // Returns false if the deque is empty. May be called by any thread.
+  LIBGAV1_MUST_USE_RESULT bool Steal(T* value) {
+    int64_t top = top_.load();
+    while (top < bottom_.load()) {
+      Buffer* const buffer = buffer_.load(std::memory_order_acquire);
+      const T candidate = buffer->Load(top);
+      if (top_.compare_exchange_strong(top, top + 1)) {
+        *value = candidate;
+        return true;
+      }
+      // Another thief or the owner took the element. |top| has been updated
+      // by compare_exchange_strong(), so try the next one.
+    }
+    return false;
+  }
+
+  // Returns true if the deque appears empty. The result may be stale by the
+  // time it is returned unless it is called by the owner with no concurrent
+  // thieves.
+  bool Empty() const {
+    return top_.load(std::memory_order_relaxed) >=
+           bottom_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Must be a power of 2.
+  static constexpr int64_t kInitialCapacity = 256;
+
+  struct Buffer : public Allocable {
+    static Buffer* Create(int64_t capacity) {
+      std::unique_ptr<Buffer> buffer(new (std::nothrow) Buffer);
+      if (buffer == nullptr) return nullptr;
+      buffer->elements.reset(new (std::nothrow) std::atomic<T>[capacity]);
+      if (buffer->elements == nullptr) return nullptr;
+      buffer->capacity = capacity;
+      return buffer.release();
+    }
+
+    T Load(int64_t index) const {
+      return elements[index & (capacity - 1)].load(std::memory_order_relaxed);
+    }
+    void Store(int64_t index, T value) {
+      elements[index & (capacity - 1)].store(value, std::memory_order_relaxed);
+    }
+
+    std::unique_ptr<std::atomic<T>[]> elements;
+    int64_t capacity = 0;
+    // The buffer this one replaced. It is freed in the destructor.
+    Buffer* previous = nullptr;
+  };
+
+  // Replaces |buffer| with one of twice its capacity holding the elements in
+  // [top, bottom). Returns the new buffer, or nullptr on allocation failure.
+  Buffer* Grow(Buffer* buffer, int64_t top, int64_t bottom) {
+    Buffer* const new_buffer = Buffer::Create(2 * buffer->capacity);
+    if (new_buffer == nullptr) return nullptr;
+    for (int64_t i = top; i < bottom; ++i) {
+      new_buffer->Store(i, buffer->Load(i));
+    }
+    new_buffer->previous = buffer;
+    buffer_.store(new_buffer, std::memory_order_release);
+    return new_buffer;
+  }
+
+  std::atomic<int64_t> top_{0};
+  std::atomic<int64_t> bottom_{0};
+  std::atomic<Buffer*> buffer_{nullptr};
+};
+
+}  // namespace libgav1
+
+#endif  // LIBGAV1_SRC_UTILS_WORK_STEALING_DEQUE_H_
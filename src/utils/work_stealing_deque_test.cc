@@ -0,0 +1,132 @@
+// Copyright 2024 The libgav1 Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "src/utils/work_stealing_deque.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>  // NOLINT (unapproved c++11 header)
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace libgav1 {
+namespace {
+
+TEST(WorkStealingDequeTest, PopIsLifo) {
+  WorkStealingDeque<int> deque;
+  ASSERT_TRUE(deque.Init());
+  EXPECT_TRUE(deque.Empty());
+
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_TRUE(deque.Push(i));
+    EXPECT_FALSE(deque.Empty());
+  }
+
+  int value;
+  for (int i = 7; i >= 0; --i) {
+    ASSERT_TRUE(deque.Pop(&value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_TRUE(deque.Empty());
+  EXPECT_FALSE(deque.Pop(&value));
+  EXPECT_FALSE(deque.Steal(&value));
+}
+
+TEST(WorkStealingDequeTest, StealIsFifo) {
+  WorkStealingDeque<int> deque;
+  ASSERT_TRUE(deque.Init());
+
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_TRUE(deque.Push(i));
+  }
+
+  int value;
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_TRUE(deque.Steal(&value));
+    EXPECT_EQ(value, i);
+  }
+  // The remaining elements are still popped from the bottom.
+  for (int i = 7; i >= 4; --i) {
+    ASSERT_TRUE(deque.Pop(&value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_TRUE(deque.Empty());
+}
+
+TEST(WorkStealingDequeTest, Grow) {
+  WorkStealingDeque<int> deque;
+  ASSERT_TRUE(deque.Init());
+
+  // Move the indices away from zero so that the elements wrap around the
+  // circular buffer before it grows.
+  int value;
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_TRUE(deque.Push(i));
+    ASSERT_TRUE(deque.Steal(&value));
+    EXPECT_EQ(value, i);
+  }
+  for (int i = 0; i < 5000; ++i) {
+    EXPECT_TRUE(deque.Push(i));
+  }
+  for (int i = 0; i < 2500; ++i) {
+    ASSERT_TRUE(deque.Steal(&value));
+    EXPECT_EQ(value, i);
+  }
+  for (int i = 4999; i >= 2500; --i) {
+    ASSERT_TRUE(deque.Pop(&value));
+    EXPECT_EQ(value, i);
+  }
+  EXPECT_TRUE(deque.Empty());
+}
+
+// The owner pushes and pops while several thieves steal. Every element must be
+// taken exactly once.
+TEST(WorkStealingDequeTest, ConcurrentSteal) {
+  constexpr int kNumElements = 200000;
+  constexpr int kNumThieves = 4;
+  WorkStealingDeque<int> deque;
+  ASSERT_TRUE(deque.Init());
+  std::vector<std::atomic<int>> taken(kNumElements);
+  for (auto& count : taken) count = 0;
+  std::atomic<bool> done(false);
+
+  std::vector<std::thread> thieves;
+  for (int i = 0; i < kNumThieves; ++i) {
+    thieves.emplace_back([&deque, &taken, &done]() {
+      int value;
+      while (!done.load()) {
+        if (deque.Steal(&value)) ++taken[value];
+      }
+      while (deque.Steal(&value)) ++taken[value];
+    });
+  }
+
+  int value;
+  for (int i = 0; i < kNumElements; ++i) {
+    ASSERT_TRUE(deque.Push(i));
+    // Pop every third element back to exercise the race for the last element.
+    if (i % 3 == 0 && deque.Pop(&value)) ++taken[value];
+  }
+  while (deque.Pop(&value)) ++taken[value];
+  done = true;
+  for (auto& thief : thieves) thief.join();
+
+  for (int i = 0; i < kNumElements; ++i) {
+    EXPECT_EQ(taken[i].load(), 1) << "element " << i;
+  }
+}
+
+}  // namespace
+}  // namespace libgav1
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2024 The libgav1 Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tests/counting_allocator.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace libgav1 {
+namespace test_utils {
+
+std::atomic<int> allocation_count(0);
+
+}  // namespace test_utils
+}  // namespace libgav1
+
+namespace {
+
+void* CountedAllocate(size_t size) {
+  libgav1::test_utils::allocation_count.fetch_add(1,
+                                                  std::memory_order_relaxed);
+  return malloc(size == 0 ? 1 : size);
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+  void* const ptr = CountedAllocate(size);
+  if (ptr == nullptr) abort();
+  return ptr;
+}
+void* operator new[](size_t size) {
+  void* const ptr = CountedAllocate(size);
+  if (ptr == nullptr) abort();
+  return ptr;
+}
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return CountedAllocate(size);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return CountedAllocate(size);
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* ptr, size_t /*size*/) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t /*size*/) noexcept { free(ptr); }
+#endif
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  free(ptr);
+}
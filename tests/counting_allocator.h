@@ -0,0 +1,34 @@
+/*
+ * Copyright 2024 The libgav1 Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGAV1_TESTS_COUNTING_ALLOCATOR_H_
+#define LIBGAV1_TESTS_COUNTING_ALLOCATOR_H_
+
+#include <atomic>
+
+namespace libgav1 {
+namespace test_utils {
+
+// The number of calls to the global allocation functions. Linking
+// counting_allocator.cc into a test replaces the global operator new and
+// operator delete with versions that forward to malloc() and free() and
+// increment this counter.
+extern std::atomic<int> allocation_count;
+
+}  // namespace test_utils
+}  // namespace libgav1
+
+#endif  // LIBGAV1_TESTS_COUNTING_ALLOCATOR_H_
@@ -62,6 +62,10 @@ list(APPEND libgav1_tests_block_utils_sources
             "${libgav1_root}/tests/block_utils.h"
             "${libgav1_root}/tests/block_utils.cc")
 
+list(APPEND libgav1_tests_counting_allocator_sources
+            "${libgav1_root}/tests/counting_allocator.h"
+            "${libgav1_root}/tests/counting_allocator.cc")
+
 list(APPEND libgav1_tests_utils_sources
             "${libgav1_root}/tests/third_party/libvpx/acm_random.h"
             "${libgav1_root}/tests/third_party/libvpx/md5_helper.h"
@@ -74,6 +78,8 @@ list(APPEND libgav1_tests_utils_test_sources
 
 list(APPEND libgav1_array_2d_test_sources
             "${libgav1_source}/utils/array_2d_test.cc")
+list(APPEND libgav1_async_file_writer_test_sources
+            "${libgav1_examples}/async_file_writer_test.cc")
 list(APPEND libgav1_average_blend_test_sources
             "${libgav1_source}/dsp/average_blend_test.cc")
 list(APPEND libgav1_block_parameters_holder_test_sources
@@ -83,6 +89,8 @@ list(APPEND libgav1_blocking_counter_test_sources
 list(APPEND libgav1_buffer_pool_test_sources
             "${libgav1_source}/buffer_pool_test.cc")
 list(APPEND libgav1_cdef_test_sources "${libgav1_source}/dsp/cdef_test.cc")
+list(APPEND libgav1_closure_test_sources
+            "${libgav1_source}/utils/closure_test.cc")
 list(
   APPEND libgav1_common_test_sources "${libgav1_source}/utils/common_test.cc")
 list(APPEND libgav1_common_avx2_test_sources
@@ -142,16 +150,26 @@ list(APPEND libgav1_intrapred_test_sources
             "${libgav1_source}/dsp/intrapred_test.cc")
 list(APPEND libgav1_inverse_transform_test_sources
             "${libgav1_source}/dsp/inverse_transform_test.cc")
+list(APPEND libgav1_lazy_instance_test_sources
+            "${libgav1_source}/utils/lazy_instance_test.cc")
 list(APPEND libgav1_loop_filter_test_sources
             "${libgav1_source}/dsp/loop_filter_test.cc")
 list(APPEND libgav1_loop_restoration_test_sources
             "${libgav1_source}/dsp/loop_restoration_test.cc")
+list(APPEND libgav1_mapped_file_reader_test_sources
+            "${libgav1_examples}/mapped_file_reader_test.cc")
 list(APPEND libgav1_mask_blend_test_sources
             "${libgav1_source}/dsp/mask_blend_test.cc")
 list(APPEND libgav1_motion_field_projection_test_sources
             "${libgav1_source}/dsp/motion_field_projection_test.cc")
 list(APPEND libgav1_motion_vector_search_test_sources
             "${libgav1_source}/dsp/motion_vector_search_test.cc")
+list(APPEND libgav1_multi_stream_decoder_test_sources
+            "${libgav1_source}/multi_stream_decoder_test.cc"
+            "${libgav1_source}/decoder_test_data.h")
+list(APPEND libgav1_stream_scanner_test_sources
+            "${libgav1_source}/stream_scanner_test.cc"
+            "${libgav1_source}/decoder_test_data.h")
 list(APPEND libgav1_super_res_test_sources
             "${libgav1_source}/dsp/super_res_test.cc")
 list(APPEND libgav1_weight_mask_test_sources
@@ -159,6 +177,8 @@ list(APPEND libgav1_weight_mask_test_sources
 list(
   APPEND libgav1_memory_test_sources "${libgav1_source}/utils/memory_test.cc")
 list(APPEND libgav1_obmc_test_sources "${libgav1_source}/dsp/obmc_test.cc")
+list(APPEND libgav1_obu_file_reader_test_sources
+            "${libgav1_examples}/obu_file_reader_test.cc")
 list(APPEND libgav1_obu_parser_test_sources
             "${libgav1_source}/obu_parser_test.cc")
 list(APPEND libgav1_post_filter_test_sources
@@ -180,6 +200,8 @@ list(APPEND libgav1_segmentation_map_test_sources
 list(APPEND libgav1_segmentation_test_sources
             "${libgav1_source}/utils/segmentation_test.cc")
 list(APPEND libgav1_stack_test_sources "${libgav1_source}/utils/stack_test.cc")
+list(APPEND libgav1_stream_generator_test_sources
+            "${libgav1_examples}/stream_generator_test.cc")
 list(APPEND libgav1_symbol_decoder_context_test_sources
             "${libgav1_source}/symbol_decoder_context_test.cc")
 list(APPEND libgav1_threadpool_test_sources
@@ -194,6 +216,8 @@ list(APPEND libgav1_version_test_sources "${libgav1_source}/version_test.cc")
 list(APPEND libgav1_warp_test_sources "${libgav1_source}/dsp/warp_test.cc")
 list(APPEND libgav1_warp_prediction_test_sources
             "${libgav1_source}/warp_prediction_test.cc")
+list(APPEND libgav1_work_stealing_deque_test_sources
+            "${libgav1_source}/utils/work_stealing_deque_test.cc")
 
 macro(libgav1_add_tests_targets)
   if(NOT LIBGAV1_ENABLE_TESTS)
@@ -281,6 +305,22 @@ macro(libgav1_add_tests_targets)
                          libgav1_gtest
                          libgav1_gtest_main)
 
+  libgav1_add_executable(TEST
+                         NAME
+                         closure_test
+                         SOURCES
+                         ${libgav1_closure_test_sources}
+                         DEFINES
+                         ${libgav1_defines}
+                         INCLUDES
+                         ${libgav1_test_include_paths}
+                         OBJLIB_DEPS
+                         libgav1_utils
+                         LIB_DEPS
+                         ${libgav1_common_test_absl_deps}
+                         libgav1_gtest
+                         libgav1_gtest_main)
+
   if(libgav1_have_avx2)
     list(APPEND libgav1_common_dsp_test_sources
                 ${libgav1_common_avx2_test_sources})
@@ -414,6 +454,48 @@ macro(libgav1_add_tests_targets)
                          libgav1_gtest
                          libgav1_gtest_main)
 
+  libgav1_add_executable(TEST
+                         NAME
+                         mapped_file_reader_test
+                         SOURCES
+                         ${libgav1_mapped_file_reader_test_sources}
+                         DEFINES
+                         ${libgav1_defines}
+                         INCLUDES
+                         ${libgav1_test_include_paths}
+                         OBJLIB_DEPS
+                         libgav1_dsp
+                         libgav1_file_reader
+                         libgav1_utils
+                         libgav1_tests_utils
+                         LIB_DEPS
+                         absl::strings
+                         absl::time
+                         ${libgav1_common_test_absl_deps}
+                         libgav1_gtest
+                         libgav1_gtest_main)
+
+  libgav1_add_executable(TEST
+                         NAME
+                         obu_file_reader_test
+                         SOURCES
+                         ${libgav1_obu_file_reader_test_sources}
+                         DEFINES
+                         ${libgav1_defines}
+                         INCLUDES
+                         ${libgav1_test_include_paths}
+                         OBJLIB_DEPS
+                         libgav1_dsp
+                         libgav1_file_reader
+                         libgav1_utils
+                         libgav1_tests_utils
+                         LIB_DEPS
+                         absl::strings
+                         absl::time
+                         ${libgav1_common_test_absl_deps}
+                         libgav1_gtest
+                         libgav1_gtest_main)
+
   libgav1_add_executable(TEST
                          NAME
                          film_grain_test
@@ -436,6 +518,22 @@ macro(libgav1_add_tests_targets)
                          libgav1_gtest
                          libgav1_gtest_main)
 
+  libgav1_add_executable(TEST
+                         NAME
+                         lazy_instance_test
+                         SOURCES
+                         ${libgav1_lazy_instance_test_sources}
+                         DEFINES
+                         ${libgav1_defines}
+                         INCLUDES
+                         ${libgav1_test_include_paths}
+                         OBJLIB_DEPS
+                         libgav1_utils
+                         LIB_DEPS
+                         ${libgav1_common_test_absl_deps}
+                         libgav1_gtest
+                         libgav1_gtest_main)
+
   libgav1_add_executable(TEST
                          NAME
                          memory_test
@@ -543,6 +641,7 @@ macro(libgav1_add_tests_targets)
                          ${libgav1_test_include_paths}
                          OBJLIB_DEPS
                          libgav1_utils
+                         libgav1_tests_counting_allocator
                          LIB_DEPS
                          absl::synchronization
                          libgav1_gtest
@@ -627,6 +726,18 @@ macro(libgav1_add_tests_targets)
                       INCLUDES
                       ${libgav1_test_include_paths})
 
+  libgav1_add_library(TEST
+                      NAME
+                      libgav1_tests_counting_allocator
+                      TYPE
+                      OBJECT
+                      SOURCES
+                      ${libgav1_tests_counting_allocator_sources}
+                      DEFINES
+                      ${libgav1_defines}
+                      INCLUDES
+                      ${libgav1_test_include_paths})
+
   libgav1_add_library(TEST
                       NAME
                       libgav1_tests_utils
@@ -675,6 +786,7 @@ macro(libgav1_add_tests_targets)
                          libgav1_dsp
                          libgav1_utils
                          LIB_DEPS
+                         absl::time
                          ${libgav1_common_test_absl_deps}
                          libgav1_gtest
                          libgav1_gtest_main)
@@ -755,8 +867,11 @@ macro(libgav1_add_tests_targets)
                          ${libgav1_defines}
                          INCLUDES
                          ${libgav1_test_include_paths}
+                         OBJLIB_DEPS
+                         libgav1_tests_counting_allocator
                          LIB_DEPS
                          ${libgav1_dependency}
+                         absl::time
                          ${libgav1_common_test_absl_deps}
                          libgav1_gtest
                          libgav1_gtest_main)
@@ -841,6 +956,27 @@ macro(libgav1_add_tests_targets)
                          libgav1_gtest
                          libgav1_gtest_main)
 
+  libgav1_add_executable(TEST
+                         NAME
+                         async_file_writer_test
+                         SOURCES
+                         ${libgav1_async_file_writer_test_sources}
+                         DEFINES
+                         ${libgav1_defines}
+                         INCLUDES
+                         ${libgav1_test_include_paths}
+                         OBJLIB_DEPS
+                         libgav1_file_reader
+                         libgav1_file_writer
+                         libgav1_tests_utils
+                         LIB_DEPS
+                         ${libgav1_dependency}
+                         absl::strings
+                         absl::time
+                         ${libgav1_common_test_absl_deps}
+                         libgav1_gtest
+                         libgav1_gtest_main)
+
   libgav1_add_executable(TEST
                          NAME
                          intrapred_cfl_test
@@ -1091,6 +1227,36 @@ macro(libgav1_add_tests_targets)
                          libgav1_gtest
                          libgav1_gtest_main)
 
+  libgav1_add_executable(TEST
+                         NAME
+                         multi_stream_decoder_test
+                         SOURCES
+                         ${libgav1_multi_stream_decoder_test_sources}
+                         DEFINES
+                         ${libgav1_defines}
+                         INCLUDES
+                         ${libgav1_test_include_paths}
+                         LIB_DEPS
+                         ${libgav1_dependency}
+                         ${libgav1_common_test_absl_deps}
+                         libgav1_gtest
+                         libgav1_gtest_main)
+
+  libgav1_add_executable(TEST
+                         NAME
+                         stream_scanner_test
+                         SOURCES
+                         ${libgav1_stream_scanner_test_sources}
+                         DEFINES
+                         ${libgav1_defines}
+                         INCLUDES
+                         ${libgav1_test_include_paths}
+                         LIB_DEPS
+                         ${libgav1_dependency}
+                         ${libgav1_common_test_absl_deps}
+                         libgav1_gtest
+                         libgav1_gtest_main)
+
   libgav1_add_executable(TEST
                          NAME
                          obmc_test
@@ -1266,6 +1432,27 @@ macro(libgav1_add_tests_targets)
                          libgav1_gtest
                          libgav1_gtest_main)
 
+  libgav1_add_executable(TEST
+                         NAME
+                         stream_generator_test
+                         SOURCES
+                         ${libgav1_stream_generator_test_sources}
+                         DEFINES
+                         ${libgav1_defines}
+                         INCLUDES
+                         ${libgav1_test_include_paths}
+                         OBJLIB_DEPS
+                         libgav1_file_reader
+                         libgav1_stream_generator
+                         libgav1_tests_utils
+                         LIB_DEPS
+                         ${libgav1_dependency}
+                         absl::strings
+                         absl::time
+                         ${libgav1_common_test_absl_deps}
+                         libgav1_gtest
+                         libgav1_gtest_main)
+
   libgav1_add_executable(TEST
                          NAME
                          super_res_test
@@ -1367,4 +1554,20 @@ macro(libgav1_add_tests_targets)
                          ${libgav1_common_test_absl_deps}
                          libgav1_gtest
                          libgav1_gtest_main)
+
+  libgav1_add_executable(TEST
+                         NAME
+                         work_stealing_deque_test
+                         SOURCES
+                         ${libgav1_work_stealing_deque_test_sources}
+                         DEFINES
+                         ${libgav1_defines}
+                         INCLUDES
+                         ${libgav1_test_include_paths}
+                         OBJLIB_DEPS
+                         libgav1_utils
+                         LIB_DEPS
+                         ${libgav1_common_test_absl_deps}
+                         libgav1_gtest
+                         libgav1_gtest_main)
 endmacro()